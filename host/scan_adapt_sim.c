@@ -0,0 +1,356 @@
+/***************************************************************************************/
+/*
+ * scan_adapt_sim
+ *
+ *  Runs the scan window controller (scan_adapt) against a model of the report queue,
+ *  to see how it converges when the load changes. Reports arrive at random, at a
+ *  rate proportional to the scan window, into a queue of a given size that the
+ *  output empties at a fixed rate. The load goes through phases of constant rate,
+ *  given as the reports per second the advertisers would produce with the window
+ *  fully open.
+ *
+ *  For each phase it prints the window the output can keep up with, the time the
+ *  controller took to settle, and once settled the cuts (those in a row counted once),
+ *  the window range and the reports lost. The controller has settled once the window
+ *  stays within the band it is expected to hold for the rest of the phase: the full
+ *  window when the output keeps up, from half the sustainable window to two steps
+ *  above it otherwise. The exit status is not 0 if a phase did not settle in time,
+ *  kept losing reports once settled, or cut the window more often than the longest
+ *  hold time allows (oscillation).
+ *
+ *  The controller settings and the scan interval are those of main.c and sdk_config.h.
+ *
+ *  Usage: scan_adapt_sim [-c reports/s] [-q queue size] [-l rate:seconds,...]
+ *                        [-s seed] [-v]
+*/
+/***************************************************************************************/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_adapt.h"
+
+#define PERIOD_MS           1000                                        /**< SCANNER_ADAPT_PERIOD_MS. */
+#define TICK_MS             10                                          /**< Time step of the queue model. */
+#define INTERVAL            800                                         /**< Scan interval of main.c, in units of 0.625 ms. */
+#define WINDOW_MIN          80                                          /**< SCANNER_ADAPT_WINDOW_MIN_MS. */
+#define STEP                40                                          /**< SCANNER_ADAPT_STEP_MS. */
+#define HOLD_MIN            2                                           /**< ADAPT_HOLD_MIN of main.c. */
+#define HOLD_MAX            64                                          /**< ADAPT_HOLD_MAX of main.c. */
+#define PHASES_MAX          16
+#define SETTLE_MAX_S        30                                          /**< Longest settling time accepted. */
+#define LOSS_MAX            0.02                                        /**< Largest share of the reports lost once settled. */
+
+/**@brief A phase of constant load. */
+typedef struct
+{
+    double   rate;                                                      /**< Reports per second with the window fully open. */
+    uint32_t seconds;
+} phase_t;
+
+/**@brief Queue model. */
+typedef struct
+{
+    double             capacity;                                        /**< Reports per second the output takes. */
+    double             drain;                                           /**< Output credit not used yet, in reports. */
+    scan_adapt_input_t input;
+} queue_t;
+
+/**@brief Figures of a phase. */
+typedef struct
+{
+    uint16_t target;                                                    /**< Widest window the output keeps up with. */
+    int32_t  settled;                                                   /**< Periods before settling, -1 if it did not. */
+    uint32_t cuts;                                                      /**< Cuts once settled, those in a row counted once. */
+    uint64_t arrived;                                                   /**< Reports once settled. */
+    uint64_t lost;                                                      /**< Reports lost once settled. */
+    uint16_t window_lo;                                                 /**< Window range once settled. */
+    uint16_t window_hi;
+} result_t;
+
+
+/**@brief Function for drawing a Poisson distributed number of reports. */
+static uint32_t poisson(double mean)
+{
+    double   limit = exp(-mean);
+    double   p     = (double)rand() / RAND_MAX;
+    uint32_t n     = 0;
+
+    while (p > limit)
+    {
+        p *= (double)rand() / RAND_MAX;
+        n++;
+    }
+
+    return n;
+}
+
+
+/**@brief Function for running the queue for one period with a given window. */
+static void queue_run(queue_t * p_queue, double rate, uint16_t window)
+{
+    double mean = rate * window / INTERVAL * TICK_MS / 1000;
+
+    for (uint32_t t = 0; t < PERIOD_MS; t += TICK_MS)
+    {
+        uint32_t arrived = poisson(mean);
+        uint32_t free    = p_queue->input.queue_size - p_queue->input.queued;
+        uint32_t taken   = (arrived < free) ? arrived : free;
+
+        p_queue->input.published += taken;
+        p_queue->input.overflows += arrived - taken;
+        p_queue->input.queued    += taken;
+
+        p_queue->drain += p_queue->capacity * TICK_MS / 1000;
+        while ((p_queue->drain >= 1) && (p_queue->input.queued > 0))
+        {
+            p_queue->input.queued--;
+            p_queue->drain -= 1;
+        }
+        if (p_queue->input.queued == 0)
+        {
+            // No credit saved up while the output is idle.
+            p_queue->drain = (p_queue->drain < 1) ? p_queue->drain : 1;
+        }
+    }
+}
+
+
+/**@brief Function for checking whether a window is in the band expected once settled. */
+static bool window_in_band(uint16_t window, uint16_t target)
+{
+    if (target >= INTERVAL)
+    {
+        return window == INTERVAL;
+    }
+
+    // The window is widened once more before the loss shows.
+    return (window * 2 >= target) && (window <= target + 2 * STEP);
+}
+
+
+/**@brief Function for running a phase.
+ *
+ * @param[in]   p_adapt     Controller, carried from the previous phase.
+ * @param[in]   p_queue     Queue, carried from the previous phase.
+ * @param[in]   p_phase     Load.
+ * @param[in]   verbose     Print every period.
+ * @param[out]  p_result    Figures of the phase.
+ */
+static void phase_run(scan_adapt_t  * p_adapt,
+                      queue_t       * p_queue,
+                      phase_t const * p_phase,
+                      bool            verbose,
+                      result_t      * p_result)
+{
+    uint16_t   window[p_phase->seconds];
+    uint32_t   cut[p_phase->seconds];
+    uint32_t   arrived[p_phase->seconds];
+    uint32_t   lost[p_phase->seconds];
+    double     target = p_queue->capacity / p_phase->rate * INTERVAL;
+    uint32_t   start;
+
+    memset(p_result, 0, sizeof(*p_result));
+    p_result->target = (target >= INTERVAL) ? INTERVAL : (uint16_t)target;
+
+    for (uint32_t i = 0; i < p_phase->seconds; i++)
+    {
+        uint32_t published = p_queue->input.published;
+        uint32_t overflows = p_queue->input.overflows;
+        uint32_t cuts      = p_adapt->cuts;
+
+        queue_run(p_queue, p_phase->rate, p_adapt->window);
+        arrived[i] = (p_queue->input.published - published) + (p_queue->input.overflows - overflows);
+        lost[i]    = p_queue->input.overflows - overflows;
+        window[i]  = scan_adapt_update(p_adapt, &p_queue->input);
+        cut[i]     = p_adapt->cuts - cuts;
+
+        if (verbose)
+        {
+            printf("%6.0f %5u %5u %5u %5u %s\n", p_phase->rate, i, window[i], arrived[i], lost[i],
+                   cut[i] ? "cut" : "");
+        }
+    }
+
+    // Settled from the first period after which the window stays in the band.
+    start = p_phase->seconds;
+    while ((start > 0) && window_in_band(window[start - 1], p_result->target))
+    {
+        start--;
+    }
+    if (start == p_phase->seconds)
+    {
+        p_result->settled = -1;
+        return;
+    }
+
+    p_result->settled   = (int32_t)start;
+    p_result->window_lo = UINT16_MAX;
+    for (uint32_t i = start; i < p_phase->seconds; i++)
+    {
+        // The backlog of a cut period may cause a second cut right after it.
+        p_result->cuts      += (cut[i] != 0) && ((i == 0) || (cut[i - 1] == 0));
+        p_result->arrived   += arrived[i];
+        p_result->lost      += lost[i];
+        p_result->window_lo  = (window[i] < p_result->window_lo) ? window[i] : p_result->window_lo;
+        p_result->window_hi  = (window[i] > p_result->window_hi) ? window[i] : p_result->window_hi;
+    }
+}
+
+
+/**@brief Function for checking the figures of a phase.
+ *
+ * @return true if the controller settled in time, without losing reports or oscillating.
+ */
+static bool result_check(phase_t const * p_phase, result_t const * p_result)
+{
+    uint32_t steady;
+
+    if ((p_result->settled < 0) || (p_result->settled > SETTLE_MAX_S * 1000 / PERIOD_MS))
+    {
+        return false;
+    }
+    if ((p_result->arrived > 0) && ((double)p_result->lost / p_result->arrived > LOSS_MAX))
+    {
+        return false;
+    }
+
+    // Once the hold time has grown to its longest, a cut every HOLD_MAX periods at most.
+    steady = p_phase->seconds * 1000 / PERIOD_MS - (uint32_t)p_result->settled;
+
+    return p_result->cuts <= steady / HOLD_MAX + 5;
+}
+
+
+/**@brief Function for parsing the phases, "rate:seconds,rate:seconds...". */
+static uint32_t phases_parse(char const * p_arg, phase_t * p_phases)
+{
+    uint32_t count = 0;
+
+    while ((*p_arg != '\0') && (count < PHASES_MAX))
+    {
+        char * p_end;
+
+        p_phases[count].rate = strtod(p_arg, &p_end);
+        if ((*p_end != ':') || (p_phases[count].rate <= 0))
+        {
+            return 0;
+        }
+        p_phases[count].seconds = (uint32_t)strtoul(p_end + 1, &p_end, 10);
+        if ((p_phases[count].seconds == 0) || ((*p_end != ',') && (*p_end != '\0')))
+        {
+            return 0;
+        }
+        count++;
+        p_arg = (*p_end == ',') ? p_end + 1 : p_end;
+    }
+
+    return (*p_arg == '\0') ? count : 0;
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "Usage: %s [-c reports/s] [-q queue size] [-l rate:seconds,...] [-s seed] [-v]\n",
+            p_name);
+}
+
+
+int main(int argc, char * argv[])
+{
+    static phase_t            phases[PHASES_MAX];
+    static scan_adapt_t       adapt;
+    scan_adapt_config_t const config =
+    {
+        .window_min = WINDOW_MIN,
+        .window_max = INTERVAL,
+        .step       = STEP,
+        .hold_min   = HOLD_MIN,
+        .hold_max   = HOLD_MAX,
+    };
+    queue_t                   queue;
+    uint32_t                  count   = 0;
+    bool                      verbose = false;
+    bool                      ok      = true;
+    int                       opt;
+
+    memset(&queue, 0, sizeof(queue));
+    queue.capacity         = 1000;
+    queue.input.queue_size = 64;
+
+    srand(1);
+    while ((opt = getopt(argc, argv, "c:q:l:s:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':
+                queue.capacity = strtod(optarg, NULL);
+                break;
+
+            case 'q':
+                queue.input.queue_size = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'l':
+                count = phases_parse(optarg, phases);
+                if (count == 0)
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 's':
+                srand((unsigned int)strtoul(optarg, NULL, 10));
+                break;
+
+            case 'v':
+                verbose = true;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((queue.capacity <= 0) || (queue.input.queue_size == 0) || (optind != argc))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (count == 0)
+    {
+        // Under the capacity, a step well over it, less over it, and back under.
+        count = phases_parse("500:300,4000:600,1500:600,400:300", phases);
+    }
+
+    scan_adapt_init(&adapt, &config, &queue.input);
+
+    printf("  load target settled   cuts   window     lost\n");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        result_t result;
+        bool     phase_ok;
+
+        phase_run(&adapt, &queue, &phases[i], verbose, &result);
+        phase_ok = result_check(&phases[i], &result);
+        ok      &= phase_ok;
+
+        if (result.settled < 0)
+        {
+            printf("%6.0f %6u   never %6s %8s %8s  FAIL\n", phases[i].rate, result.target, "-", "-", "-");
+            continue;
+        }
+        printf("%6.0f %6u %6ds %6u %4u-%-4u %7.2f%%  %s\n", phases[i].rate, result.target, result.settled,
+               result.cuts, result.window_lo, result.window_hi,
+               result.arrived ? 100.0 * result.lost / result.arrived : 0.0, phase_ok ? "ok" : "FAIL");
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
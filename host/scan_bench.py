@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+#
+# scan_bench.py
+#
+#  Benchmark of the report path: CPU cycles per report, bytes sent per report and the
+#  highest rate of reports the scanner sustains, for each output format. The results
+#  are written as JSON, to be kept along with each release and compared.
+#
+#  Host half: the firmware is built into scan_sim once per output format, then run on
+#  the simulated advertisers. The cycles are counted with the perf events interface
+#  (the time stamp counter if the kernel does not allow it), around the BLE observers
+#  and the main loop. The highest sustained rate is searched for by running the
+#  simulator at increasing rates: a rate is sustained if every packet on the air is
+#  reported and sent, without the report queue filling past a quarter, the UART being
+#  busy more than 95 % of the time or any log entry being lost.
+#
+#  Target half: the firmware built with SCANNER_PROFILE_ENABLED counts the cycles of
+#  the BLE_GAP_EVT_ADV_REPORT handling and of the main loop with the DWT cycle
+#  counter. Its output is read for a while, from the serial port or from a capture,
+#  and the cycles and bytes per report are taken from the first and last profile and
+#  statistics records. The highest rate is estimated from the CPU and the UART, the
+#  first one to run out.
+#
+#  Usage: scan_bench.py [-o results.json] [--seconds s] [--advertisers n] [--len bytes]
+#                       [--baudrate baud] [--formats binary,text]
+#                       [--target device|capture] [--target-format binary|text]
+#                       [--target-seconds s] [--no-host]
+#
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Settings of the firmware built for the benchmark. The scan window must not shrink
+# under load, otherwise the reports are lost before they reach the output.
+SIM_DEFS = {
+    'binary': '-DSCANNER_ADAPT_ENABLED=0',
+    'text': '-DSCANNER_ADAPT_ENABLED=0 -DSCANNER_OUTPUT_FORMAT=0 -DNRF_LOG_BACKEND_UART_ENABLED=1',
+}
+
+REFERENCE_RATE = 50                     # Reports per second the costs are measured at, far from any limit.
+SEARCH_PRECISION = 0.02                 # Relative precision of the highest sustained rate.
+QUEUE_FILL_MAX = 0.25                   # Share of the report queue a sustained rate may fill.
+LINE_BUSY_MAX = 0.95                    # Share of the time a sustained rate may keep the UART busy.
+
+UART_BITS_PER_BYTE = 10
+
+PROFILE_LINE = re.compile(r'^profile t=(\S+) hz=(\d+) reports=(\d+) .* cycles=(\d+)/(\d+)$')
+STATS_LINE = re.compile(r'^stats t=(\S+) received=(\d+) .* tx=(\d+) ')
+HELLO_LINE = re.compile(r'^hello .* baudrate=(\d+)')
+TEXT_PROFILE_LINE = re.compile(rb'Profile: (\d+) reports, (\d+) cycles per report in the handler '
+                               rb'\(max (\d+)\), (\d+) in the main loop\.')
+TEXT_SEPARATOR = b'----------------------------------\r\n'
+
+
+def sim_build(fmt):
+    out = os.path.join('_build', 'bench-' + fmt)
+    subprocess.run(['make', '-s', '-C', HOST_DIR, 'OUTPUT_DIRECTORY=' + out, 'SIM_DEFS=' + SIM_DEFS[fmt],
+                    os.path.join(out, 'scan_sim')], check=True)
+    return os.path.join(HOST_DIR, out, 'scan_sim')
+
+
+def sim_run(sim, args, rate):
+    with tempfile.NamedTemporaryFile(suffix='.json') as result:
+        cmd = [sim, '-d', str(args.seconds), '-r', str(rate), '-a', str(args.advertisers),
+               '-l', str(args.len), '-c', '-j', result.name]
+        if args.baudrate:
+            cmd += ['-b', str(args.baudrate)]
+        subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+        return json.load(open(result.name))
+
+
+def sustained(run):
+    return (run['not_scanned'] == 0 and run['paused'] == 0 and run['queue_dropped'] == 0
+            and run['log_dropped'] == 0 and run['queue_high_water'] <= run['queue_size'] * QUEUE_FILL_MAX
+            and run['line_busy'] <= LINE_BUSY_MAX)
+
+
+def rate_search(sim, args):
+    """Doubles the rate until it is not sustained, then bisects."""
+    low, high = 0.0, float(REFERENCE_RATE)
+    while sustained(sim_run(sim, args, high)):
+        low, high = high, high * 2
+    while high - low > low * SEARCH_PRECISION:
+        mid = (low + high) / 2
+        if sustained(sim_run(sim, args, mid)):
+            low = mid
+        else:
+            high = mid
+    return low
+
+
+def host_bench(fmt, args):
+    sim = sim_build(fmt)
+    run = sim_run(sim, args, REFERENCE_RATE)
+    return {
+        'cycles_source': run['cycles_source'],
+        'cycles_hz': run['cycles_hz'],
+        'handler_cycles_per_report': round(run['handler_cycles_per_report'], 1),
+        'loop_cycles_per_report': round(run['loop_cycles_per_report'], 1),
+        'cycles_per_report': round(run['handler_cycles_per_report'] + run['loop_cycles_per_report'], 1),
+        'bytes_per_report': round(run['bytes_per_report'], 2),
+        'baudrate': run['baudrate'],
+        'max_reports_per_s': round(rate_search(sim, args)),
+    }
+
+
+def target_read(args):
+    """Reads the scanner output for --target-seconds, or a whole capture file."""
+    if os.path.isfile(args.target):
+        return open(args.target, 'rb').read()
+    data = b''
+    with open(args.target, 'rb', buffering=0) as port:
+        os.set_blocking(port.fileno(), False)
+        end = time.monotonic() + args.target_seconds
+        while time.monotonic() < end:
+            chunk = port.read(4096)
+            if chunk:
+                data += chunk
+            else:
+                time.sleep(0.01)
+    return data
+
+
+def estimate(result, baudrate):
+    cycles = result['handler_cycles_per_report'] + result['loop_cycles_per_report']
+    limits = []
+    if cycles > 0:
+        limits.append(result['cpu_hz'] / cycles)
+    if baudrate and result['bytes_per_report'] > 0:
+        limits.append(baudrate / UART_BITS_PER_BYTE / result['bytes_per_report'])
+    result['cycles_per_report'] = round(cycles, 1)
+    result['baudrate'] = baudrate
+    result['max_reports_per_s'] = round(min(limits)) if limits else None
+    return result
+
+
+def target_binary(args):
+    if os.path.isfile(args.target):
+        dump = subprocess.run([os.path.join(HOST_DIR, '_build', 'scan_dump'), args.target],
+                              check=True, capture_output=True).stdout
+    else:
+        try:
+            dump = subprocess.run([os.path.join(HOST_DIR, '_build', 'scan_dump'), '-b', str(args.baudrate or 115200),
+                                   args.target], capture_output=True, timeout=args.target_seconds).stdout
+        except subprocess.TimeoutExpired as e:
+            dump = e.stdout or b''
+
+    profiles, stats, baudrate = [], [], args.baudrate
+    for line in dump.decode(errors='replace').splitlines():
+        m = PROFILE_LINE.match(line)
+        if m:
+            profiles.append([int(v) for v in m.groups()[1:]])
+        m = STATS_LINE.match(line)
+        if m:
+            stats.append([int(v) for v in m.groups()[1:]])
+        m = HELLO_LINE.match(line)
+        if m:
+            baudrate = int(m.group(1))
+
+    if len(profiles) < 2 or len(stats) < 2:
+        sys.exit('%s: need two profile and statistics records at least, '
+                 'is the firmware built with SCANNER_PROFILE_ENABLED?' % args.target)
+
+    hz = profiles[-1][0]
+    reports = max(profiles[-1][1] - profiles[0][1], 1)
+    received = max(stats[-1][0] - stats[0][0], 1)
+    return estimate({
+        'cpu_hz': hz,
+        'reports': reports,
+        'handler_cycles_per_report': round((profiles[-1][2] - profiles[0][2]) / reports, 1),
+        'loop_cycles_per_report': round((profiles[-1][3] - profiles[0][3]) / reports, 1),
+        'bytes_per_report': round((stats[-1][1] - stats[0][1]) / received, 2),
+    }, baudrate)
+
+
+def target_text(args):
+    data = target_read(args)
+    periods = [[int(v) for v in m.groups()] for m in TEXT_PROFILE_LINE.finditer(data)]
+    separators = data.count(TEXT_SEPARATOR)
+
+    if not periods or separators == 0:
+        sys.exit('%s: no report or profile line, is the firmware built with SCANNER_PROFILE_ENABLED?'
+                 % args.target)
+
+    reports = max(sum(p[0] for p in periods), 1)
+    return estimate({
+        'cpu_hz': args.cpu_hz,
+        'reports': separators,
+        'handler_cycles_per_report': round(sum(p[0] * p[1] for p in periods) / reports, 1),
+        'loop_cycles_per_report': round(sum(p[0] * p[3] for p in periods) / reports, 1),
+        'bytes_per_report': round(len(data) / separators, 2),
+    }, args.baudrate or 115200)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark of the scanner report path.')
+    parser.add_argument('-o', '--output', help='JSON file to write, stdout if not given')
+    parser.add_argument('--seconds', type=float, default=5, help='simulated time per run')
+    parser.add_argument('--advertisers', type=int, default=500)
+    parser.add_argument('--len', type=int, default=31, help='advertising data length')
+    parser.add_argument('--baudrate', type=int, default=0, help='UART rate, the firmware one if not given')
+    parser.add_argument('--formats', default='binary,text')
+    parser.add_argument('--no-host', action='store_true', help='only run the target half')
+    parser.add_argument('--target', help='serial port or capture of a scanner built with SCANNER_PROFILE_ENABLED')
+    parser.add_argument('--target-format', choices=('binary', 'text'), default='binary')
+    parser.add_argument('--target-seconds', type=float, default=30, help='time the serial port is read')
+    parser.add_argument('--cpu-hz', type=int, default=64000000, help='CPU clock of a text format target')
+    args = parser.parse_args()
+
+    results = {
+        'config': {
+            'seconds': args.seconds,
+            'advertisers': args.advertisers,
+            'len': args.len,
+            'baudrate': args.baudrate,
+        },
+    }
+
+    if not args.no_host:
+        subprocess.run(['make', '-s', '-C', HOST_DIR], check=True)
+        results['host'] = {fmt: host_bench(fmt, args) for fmt in args.formats.split(',')}
+
+    if args.target:
+        results['target'] = {args.target_format: target_binary(args) if args.target_format == 'binary'
+                             else target_text(args)}
+
+    text = json.dumps(results, indent=2) + '\n'
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
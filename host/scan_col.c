@@ -0,0 +1,931 @@
+/***************************************************************************************/
+/*
+ * scan_col
+ *
+ *  Columnar capture files.
+ *
+ *  The writer appends the fields of each report to the buffers of the columns, and
+ *  the address to the dictionary of the chunk (found through a hash table of its
+ *  entries). A full chunk has each column compressed into a block; a block that does
+ *  not shrink is stored as it is.
+ *
+ *  A query decodes the TIME and ADDR columns of the chunks it reads first, and the
+ *  other columns only if some report matched.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "scan_col.h"
+#include "scan_lz.h"
+
+#define DICT_ENTRY_LEN      7                                           /**< Address and address type. */
+#define PHY_LEN             2                                           /**< Primary and secondary PHY. */
+#define META_LEN            6                                           /**< Flags, TX power, channel, SID and data ID. */
+#define VARINT_MAX_LEN      10
+#define BLOOM_HASHES        4
+#define DATA_MAX            (SCAN_FRAME_MAX_PAYLOAD - sizeof(scan_report_hdr_t))
+
+/**@brief A growing buffer. */
+typedef struct
+{
+    uint8_t * p_data;
+    size_t    len;
+    size_t    size;
+} buf_t;
+
+struct scan_col_writer_s
+{
+    FILE                 * p_file;
+    uint64_t               offset;                                      /**< Bytes written to the file. */
+    uint32_t               chunk_reports;
+    buf_t                  columns[SCAN_COL_COUNT];
+    buf_t                  block;                                       /**< Compressed block. */
+    scan_col_chunk_hdr_t   hdr;                                         /**< Header of the chunk being filled. */
+    uint64_t               t_prev;
+    uint32_t             * p_dict_table;                                /**< DICT entry + 1 of each address, 0 for none. */
+    uint32_t               dict_mask;
+    scan_col_index_t     * p_index;
+    uint32_t               chunks;
+    uint32_t               index_size;
+};
+
+struct scan_col_reader_s
+{
+    int                    fd;
+    scan_col_index_t     * p_index;
+    uint32_t               chunks;
+    buf_t                  block;                                       /**< Block as read. */
+    buf_t                  columns[SCAN_COL_COUNT];                     /**< Decoded blocks of the current chunk. */
+    buf_t                  rows;                                        /**< Timestamps and DICT entries of the current chunk. */
+    buf_t                  selected;                                    /**< DICT entries that match the query. */
+};
+
+/**@brief Decoded row of the TIME and ADDR columns. */
+typedef struct
+{
+    uint64_t timestamp_us;
+    uint32_t entry;
+} row_t;
+
+
+static int buf_reserve(buf_t * p_buf, size_t len)
+{
+    if (p_buf->len + len > p_buf->size)
+    {
+        size_t    size   = (p_buf->size > 0) ? p_buf->size : 4096;
+        uint8_t * p_data;
+
+        while (size < p_buf->len + len)
+        {
+            size *= 2;
+        }
+        p_data = realloc(p_buf->p_data, size);
+        if (p_data == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        p_buf->p_data = p_data;
+        p_buf->size   = size;
+    }
+
+    return 0;
+}
+
+
+static void varint_put(buf_t * p_buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        p_buf->p_data[p_buf->len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p_buf->p_data[p_buf->len++] = (uint8_t)value;
+}
+
+
+/**@brief Function for reading a varint.
+ *
+ * @return 0 on success, -1 if the column ends first.
+ */
+static int varint_get(uint8_t const ** pp_in, uint8_t const * p_end, uint64_t * p_value)
+{
+    uint64_t value = 0;
+
+    for (unsigned shift = 0; (shift < 64) && (*pp_in < p_end); shift += 7)
+    {
+        uint8_t byte = *(*pp_in)++;
+
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *p_value = value;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/**@brief FNV-1a hash of an address. */
+static uint64_t addr_hash(uint8_t const * p_addr, size_t len)
+{
+    uint64_t h = 14695981039346656037ull;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        h = (h ^ p_addr[i]) * 1099511628211ull;
+    }
+
+    return h;
+}
+
+
+static uint32_t bloom_bit(uint64_t h, unsigned k)
+{
+    return (uint32_t)(((h & 0xFFFFFFFF) + k * ((h >> 32) | 1)) % (SCAN_COL_BLOOM_SIZE * 8));
+}
+
+
+static void bloom_add(uint8_t * p_bloom, uint8_t const * p_addr)
+{
+    uint64_t h = addr_hash(p_addr, 6);
+
+    for (unsigned k = 0; k < BLOOM_HASHES; k++)
+    {
+        uint32_t bit = bloom_bit(h, k);
+
+        p_bloom[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+
+static bool bloom_test(uint8_t const * p_bloom, uint8_t const * p_addr)
+{
+    uint64_t h = addr_hash(p_addr, 6);
+
+    for (unsigned k = 0; k < BLOOM_HASHES; k++)
+    {
+        uint32_t bit = bloom_bit(h, k);
+
+        if ((p_bloom[bit / 8] & (1 << (bit % 8))) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**@brief Function for writing the chunk being filled, if it has reports. */
+static int chunk_write(scan_col_writer_t * p_writer)
+{
+    scan_col_chunk_hdr_t * p_hdr = &p_writer->hdr;
+    scan_col_index_t     * p_entry;
+    uint64_t               offset = p_writer->offset;
+
+    if (p_hdr->reports == 0)
+    {
+        return 0;
+    }
+
+    if (p_writer->chunks == p_writer->index_size)
+    {
+        uint32_t           size    = (p_writer->index_size > 0) ? p_writer->index_size * 2 : 64;
+        scan_col_index_t * p_index = realloc(p_writer->p_index, size * sizeof(scan_col_index_t));
+
+        if (p_index == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        p_writer->p_index    = p_index;
+        p_writer->index_size = size;
+    }
+
+    p_hdr->magic = SCAN_COL_CHUNK_MAGIC;
+    p_hdr->addresses = (uint32_t)(p_writer->columns[SCAN_COL_DICT].len / DICT_ENTRY_LEN);
+
+    // The blocks go after the header, which is written last with their lengths.
+    if (fseeko(p_writer->p_file, (off_t)(offset + sizeof(*p_hdr)), SEEK_SET) != 0)
+    {
+        return -1;
+    }
+    for (int column = 0; column < SCAN_COL_COUNT; column++)
+    {
+        buf_t              * p_column = &p_writer->columns[column];
+        scan_col_block_hdr_t block    = { .encoding = SCAN_COL_ENCODING_LZ, .raw_len = (uint32_t)p_column->len };
+        size_t               len;
+
+        p_writer->block.len = 0;
+        if (buf_reserve(&p_writer->block, SCAN_LZ_BOUND(p_column->len)) != 0)
+        {
+            return -1;
+        }
+        len = scan_lz_compress(p_column->p_data, p_column->len, p_writer->block.p_data, p_writer->block.size);
+        if ((len == 0) || (len >= p_column->len))
+        {
+            block.encoding = SCAN_COL_ENCODING_RAW;
+            len            = p_column->len;
+        }
+
+        if ((fwrite(&block, sizeof(block), 1, p_writer->p_file) != 1) ||
+            ((len > 0) && (fwrite((block.encoding == SCAN_COL_ENCODING_RAW) ? p_column->p_data : p_writer->block.p_data,
+                                  len, 1, p_writer->p_file) != 1)))
+        {
+            return -1;
+        }
+        p_hdr->block_len[column] = (uint32_t)(sizeof(block) + len);
+        p_writer->offset        += sizeof(block) + len;
+        p_column->len            = 0;
+    }
+
+    if ((fseeko(p_writer->p_file, (off_t)offset, SEEK_SET) != 0) ||
+        (fwrite(p_hdr, sizeof(*p_hdr), 1, p_writer->p_file) != 1) ||
+        (fseeko(p_writer->p_file, 0, SEEK_END) != 0) ||
+        (fflush(p_writer->p_file) != 0))
+    {
+        return -1;
+    }
+    p_writer->offset += sizeof(*p_hdr);
+
+    p_entry         = &p_writer->p_index[p_writer->chunks++];
+    p_entry->offset = offset;
+    p_entry->hdr    = *p_hdr;
+
+    memset(p_hdr, 0, sizeof(*p_hdr));
+    memset(p_writer->p_dict_table, 0, (p_writer->dict_mask + 1) * sizeof(uint32_t));
+    p_writer->t_prev = 0;
+
+    return 0;
+}
+
+
+static void writer_free(scan_col_writer_t * p_writer)
+{
+    for (int column = 0; column < SCAN_COL_COUNT; column++)
+    {
+        free(p_writer->columns[column].p_data);
+    }
+    free(p_writer->block.p_data);
+    free(p_writer->p_dict_table);
+    free(p_writer->p_index);
+    free(p_writer);
+}
+
+
+int scan_col_writer_open(scan_col_writer_t ** pp_writer, char const * p_path, uint32_t chunk_reports)
+{
+    scan_col_file_hdr_t file_hdr = { .magic = SCAN_COL_MAGIC, .version = SCAN_COL_VERSION };
+    scan_col_writer_t * p_writer;
+    uint32_t            table_size = 1;
+
+    chunk_reports = (chunk_reports > 0) ? chunk_reports : SCAN_COL_CHUNK_REPORTS;
+    if (chunk_reports > (1u << 24))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    while (table_size < chunk_reports * 2)
+    {
+        table_size *= 2;
+    }
+
+    p_writer = calloc(1, sizeof(*p_writer));
+    if (p_writer == NULL)
+    {
+        return -1;
+    }
+    p_writer->chunk_reports = chunk_reports;
+    p_writer->dict_mask     = table_size - 1;
+    p_writer->p_dict_table  = calloc(table_size, sizeof(uint32_t));
+    if (p_writer->p_dict_table == NULL)
+    {
+        writer_free(p_writer);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    p_writer->p_file = fopen(p_path, "w+b");
+    if (p_writer->p_file == NULL)
+    {
+        int err = errno;
+
+        writer_free(p_writer);
+        errno = err;
+        return -1;
+    }
+
+    file_hdr.chunk_reports = chunk_reports;
+    if (fwrite(&file_hdr, sizeof(file_hdr), 1, p_writer->p_file) != 1)
+    {
+        int err = errno;
+
+        fclose(p_writer->p_file);
+        writer_free(p_writer);
+        errno = err;
+        return -1;
+    }
+    p_writer->offset = sizeof(file_hdr);
+
+    *pp_writer = p_writer;
+
+    return 0;
+}
+
+
+/**@brief Function for finding the DICT entry of an address, adding it if needed. */
+static uint32_t dict_entry_get(scan_col_writer_t * p_writer, uint8_t const * p_key)
+{
+    buf_t  * p_dict = &p_writer->columns[SCAN_COL_DICT];
+    uint32_t slot   = (uint32_t)addr_hash(p_key, DICT_ENTRY_LEN) & p_writer->dict_mask;
+
+    while (p_writer->p_dict_table[slot] != 0)
+    {
+        uint32_t entry = p_writer->p_dict_table[slot] - 1;
+
+        if (memcmp(&p_dict->p_data[entry * DICT_ENTRY_LEN], p_key, DICT_ENTRY_LEN) == 0)
+        {
+            return entry;
+        }
+        slot = (slot + 1) & p_writer->dict_mask;
+    }
+
+    // The table has room for twice the reports of a chunk, and the buffer was reserved.
+    memcpy(&p_dict->p_data[p_dict->len], p_key, DICT_ENTRY_LEN);
+    p_dict->len                  += DICT_ENTRY_LEN;
+    p_writer->p_dict_table[slot]  = (uint32_t)(p_dict->len / DICT_ENTRY_LEN);
+
+    return p_writer->p_dict_table[slot] - 1;
+}
+
+
+int scan_col_writer_add(scan_col_writer_t * p_writer, scan_record_t const * p_record)
+{
+    scan_col_chunk_hdr_t * p_hdr = &p_writer->hdr;
+    buf_t                * p_columns = p_writer->columns;
+    scan_report_hdr_t      report;
+    uint8_t const        * p_data;
+    uint8_t                key[DICT_ENTRY_LEN];
+    int64_t                delta;
+
+    if ((p_record->type != SCAN_FRAME_TYPE_ADV_REPORT) || (scan_record_adv_parse(p_record, &report, &p_data) != 0))
+    {
+        return 0;
+    }
+
+    if ((buf_reserve(&p_columns[SCAN_COL_DICT], DICT_ENTRY_LEN) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_TIME], VARINT_MAX_LEN) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_ADDR], VARINT_MAX_LEN) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_RSSI], 1) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_PHY], PHY_LEN) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_META], META_LEN) != 0) ||
+        (buf_reserve(&p_columns[SCAN_COL_DATA], VARINT_MAX_LEN + report.data_len) != 0))
+    {
+        return -1;
+    }
+
+    if (p_hdr->reports == 0)
+    {
+        p_hdr->t_min = report.timestamp_us;
+        p_hdr->t_max = report.timestamp_us;
+    }
+    p_hdr->t_min = (report.timestamp_us < p_hdr->t_min) ? report.timestamp_us : p_hdr->t_min;
+    p_hdr->t_max = (report.timestamp_us > p_hdr->t_max) ? report.timestamp_us : p_hdr->t_max;
+    p_hdr->reports++;
+
+    // Zigzag, as the scanner clock starts again from 0 when it reboots.
+    delta            = (int64_t)(report.timestamp_us - p_writer->t_prev);
+    p_writer->t_prev = report.timestamp_us;
+    varint_put(&p_columns[SCAN_COL_TIME], ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+
+    memcpy(key, report.addr, sizeof(report.addr));
+    key[6] = report.addr_type;
+    varint_put(&p_columns[SCAN_COL_ADDR], dict_entry_get(p_writer, key));
+    bloom_add(p_hdr->bloom, report.addr);
+
+    p_columns[SCAN_COL_RSSI].p_data[p_columns[SCAN_COL_RSSI].len++] = (uint8_t)report.rssi;
+    p_columns[SCAN_COL_PHY].p_data[p_columns[SCAN_COL_PHY].len++]   = report.primary_phy;
+    p_columns[SCAN_COL_PHY].p_data[p_columns[SCAN_COL_PHY].len++]   = report.secondary_phy;
+
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = report.flags;
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = (uint8_t)report.tx_power;
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = report.ch_index;
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = report.set_id;
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = (uint8_t)report.data_id;
+    p_columns[SCAN_COL_META].p_data[p_columns[SCAN_COL_META].len++] = (uint8_t)(report.data_id >> 8);
+
+    varint_put(&p_columns[SCAN_COL_DATA], report.data_len);
+    memcpy(&p_columns[SCAN_COL_DATA].p_data[p_columns[SCAN_COL_DATA].len], p_data, report.data_len);
+    p_columns[SCAN_COL_DATA].len += report.data_len;
+
+    return (p_hdr->reports == p_writer->chunk_reports) ? chunk_write(p_writer) : 0;
+}
+
+
+int scan_col_writer_close(scan_col_writer_t * p_writer)
+{
+    scan_col_trailer_t trailer = { .footer_offset = 0, .magic = SCAN_COL_FOOTER_MAGIC };
+    int                err     = 0;
+
+    if (chunk_write(p_writer) != 0)
+    {
+        err = errno;
+    }
+
+    trailer.footer_offset = p_writer->offset;
+    trailer.chunks        = p_writer->chunks;
+    if ((err == 0) &&
+        (((p_writer->chunks > 0) &&
+          (fwrite(p_writer->p_index, sizeof(scan_col_index_t), p_writer->chunks, p_writer->p_file) != p_writer->chunks)) ||
+         (fwrite(&trailer, sizeof(trailer), 1, p_writer->p_file) != 1)))
+    {
+        err = errno;
+    }
+    if ((fclose(p_writer->p_file) != 0) && (err == 0))
+    {
+        err = errno;
+    }
+    writer_free(p_writer);
+
+    errno = err;
+
+    return (err == 0) ? 0 : -1;
+}
+
+
+/**@brief Function for reading the whole of a range of the file.
+ *
+ * @return 0 on success, -1 on error or if the file ends first.
+ */
+static int read_at(int fd, void * p_buf, size_t len, uint64_t offset)
+{
+    uint8_t * p = p_buf;
+
+    while (len > 0)
+    {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        p      += n;
+        len    -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+
+    return 0;
+}
+
+
+static uint64_t chunk_len(scan_col_chunk_hdr_t const * p_hdr)
+{
+    uint64_t len = sizeof(*p_hdr);
+
+    for (int column = 0; column < SCAN_COL_COUNT; column++)
+    {
+        len += p_hdr->block_len[column];
+    }
+
+    return len;
+}
+
+
+/**@brief Function for adding an entry to the index of a reader. */
+static int index_add(scan_col_reader_t * p_reader, uint32_t * p_size, uint64_t offset, scan_col_chunk_hdr_t const * p_hdr)
+{
+    if (p_reader->chunks == *p_size)
+    {
+        uint32_t           size    = (*p_size > 0) ? *p_size * 2 : 64;
+        scan_col_index_t * p_index = realloc(p_reader->p_index, size * sizeof(scan_col_index_t));
+
+        if (p_index == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        p_reader->p_index = p_index;
+        *p_size           = size;
+    }
+    p_reader->p_index[p_reader->chunks].offset = offset;
+    p_reader->p_index[p_reader->chunks].hdr    = *p_hdr;
+    p_reader->chunks++;
+
+    return 0;
+}
+
+
+/**@brief Function for reading the footer of a file.
+ *
+ * @return 0 on success, -1 if the file has no valid footer.
+ */
+static int footer_read(scan_col_reader_t * p_reader, uint64_t file_size)
+{
+    scan_col_trailer_t trailer;
+
+    if ((file_size < sizeof(scan_col_file_hdr_t) + sizeof(trailer)) ||
+        (read_at(p_reader->fd, &trailer, sizeof(trailer), file_size - sizeof(trailer)) != 0) ||
+        (trailer.magic != SCAN_COL_FOOTER_MAGIC) ||
+        (trailer.footer_offset + (uint64_t)trailer.chunks * sizeof(scan_col_index_t) + sizeof(trailer) != file_size))
+    {
+        return -1;
+    }
+
+    p_reader->p_index = malloc(((trailer.chunks > 0) ? trailer.chunks : 1) * sizeof(scan_col_index_t));
+    if ((p_reader->p_index == NULL) ||
+        (read_at(p_reader->fd, p_reader->p_index, trailer.chunks * sizeof(scan_col_index_t), trailer.footer_offset) != 0))
+    {
+        return -1;
+    }
+    for (uint32_t i = 0; i < trailer.chunks; i++)
+    {
+        if ((p_reader->p_index[i].hdr.magic != SCAN_COL_CHUNK_MAGIC) ||
+            (p_reader->p_index[i].offset + chunk_len(&p_reader->p_index[i].hdr) > trailer.footer_offset))
+        {
+            return -1;
+        }
+    }
+    p_reader->chunks = trailer.chunks;
+
+    return 0;
+}
+
+
+/**@brief Function for indexing a file without footer by walking its chunks. */
+static int index_rebuild(scan_col_reader_t * p_reader, uint64_t file_size)
+{
+    uint64_t offset = sizeof(scan_col_file_hdr_t);
+    uint32_t size   = 0;
+
+    free(p_reader->p_index);
+    p_reader->p_index = NULL;
+    p_reader->chunks  = 0;
+
+    while (offset + sizeof(scan_col_chunk_hdr_t) <= file_size)
+    {
+        scan_col_chunk_hdr_t hdr;
+
+        if ((read_at(p_reader->fd, &hdr, sizeof(hdr), offset) != 0) ||
+            (hdr.magic != SCAN_COL_CHUNK_MAGIC) || (offset + chunk_len(&hdr) > file_size))
+        {
+            break;
+        }
+        if (index_add(p_reader, &size, offset, &hdr) != 0)
+        {
+            return -1;
+        }
+        offset += chunk_len(&hdr);
+    }
+
+    return 0;
+}
+
+
+int scan_col_reader_open(scan_col_reader_t ** pp_reader, char const * p_path)
+{
+    scan_col_reader_t * p_reader;
+    scan_col_file_hdr_t file_hdr;
+    struct stat         st;
+    int                 err;
+
+    p_reader = calloc(1, sizeof(*p_reader));
+    if (p_reader == NULL)
+    {
+        return -1;
+    }
+    p_reader->fd = open(p_path, O_RDONLY | O_CLOEXEC);
+    if (p_reader->fd < 0)
+    {
+        err = errno;
+        free(p_reader);
+        errno = err;
+        return -1;
+    }
+
+    if ((fstat(p_reader->fd, &st) != 0) || (read_at(p_reader->fd, &file_hdr, sizeof(file_hdr), 0) != 0))
+    {
+        err = errno;
+        scan_col_reader_close(p_reader);
+        errno = err;
+        return -1;
+    }
+    if ((file_hdr.magic != SCAN_COL_MAGIC) || (file_hdr.version != SCAN_COL_VERSION))
+    {
+        scan_col_reader_close(p_reader);
+        errno = EBADMSG;
+        return -1;
+    }
+
+    if ((footer_read(p_reader, (uint64_t)st.st_size) != 0) && (index_rebuild(p_reader, (uint64_t)st.st_size) != 0))
+    {
+        err = errno;
+        scan_col_reader_close(p_reader);
+        errno = err;
+        return -1;
+    }
+
+    *pp_reader = p_reader;
+
+    return 0;
+}
+
+
+uint32_t scan_col_reader_index(scan_col_reader_t const * p_reader, scan_col_index_t const ** pp_index)
+{
+    *pp_index = p_reader->p_index;
+
+    return p_reader->chunks;
+}
+
+
+/**@brief Function for reading and decoding a block of a chunk.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int block_load(scan_col_reader_t      * p_reader,
+                      scan_col_index_t const * p_entry,
+                      int                      column,
+                      scan_col_query_stats_t * p_stats)
+{
+    uint64_t             offset   = p_entry->offset + sizeof(scan_col_chunk_hdr_t);
+    uint32_t             len      = p_entry->hdr.block_len[column];
+    buf_t              * p_column = &p_reader->columns[column];
+    scan_col_block_hdr_t block;
+
+    for (int i = 0; i < column; i++)
+    {
+        offset += p_entry->hdr.block_len[i];
+    }
+    if (len < sizeof(block))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    p_reader->block.len = 0;
+    if ((buf_reserve(&p_reader->block, len) != 0) ||
+        (read_at(p_reader->fd, p_reader->block.p_data, len, offset) != 0))
+    {
+        return -1;
+    }
+    p_stats->bytes_read += len;
+
+    memcpy(&block, p_reader->block.p_data, sizeof(block));
+    len -= sizeof(block);
+    p_column->len = 0;
+    if (buf_reserve(p_column, block.raw_len) != 0)
+    {
+        return -1;
+    }
+    p_column->len = block.raw_len;
+
+    if ((block.encoding == SCAN_COL_ENCODING_RAW) && (len == block.raw_len))
+    {
+        memcpy(p_column->p_data, &p_reader->block.p_data[sizeof(block)], len);
+        return 0;
+    }
+    if ((block.encoding == SCAN_COL_ENCODING_LZ) &&
+        (scan_lz_decompress(&p_reader->block.p_data[sizeof(block)], len, p_column->p_data, block.raw_len) == 0))
+    {
+        return 0;
+    }
+
+    errno = EBADMSG;
+
+    return -1;
+}
+
+
+/**@brief Function for finding the matching reports of a chunk.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int chunk_query(scan_col_reader_t      * p_reader,
+                       scan_col_index_t const * p_entry,
+                       scan_col_query_t const * p_query,
+                       scan_decoder_handler_t   handler,
+                       void                   * p_context,
+                       scan_col_query_stats_t * p_stats)
+{
+    scan_col_chunk_hdr_t const * p_hdr     = &p_entry->hdr;
+    buf_t                const * p_columns = p_reader->columns;
+    uint8_t                      payload[SCAN_FRAME_MAX_PAYLOAD];
+    uint8_t                    * p_selected;
+    row_t                      * p_rows;
+    uint8_t const              * p_in;
+    uint8_t const              * p_end;
+    uint64_t                     timestamp = 0;
+    uint32_t                     matches   = 0;
+
+    // Which addresses of the chunk the query wants.
+    if (block_load(p_reader, p_entry, SCAN_COL_DICT, p_stats) != 0)
+    {
+        return -1;
+    }
+    if (p_columns[SCAN_COL_DICT].len != (size_t)p_hdr->addresses * DICT_ENTRY_LEN)
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+    p_reader->selected.len = 0;
+    if (buf_reserve(&p_reader->selected, p_hdr->addresses) != 0)
+    {
+        return -1;
+    }
+    p_selected = p_reader->selected.p_data;
+    for (uint32_t i = 0; i < p_hdr->addresses; i++)
+    {
+        p_selected[i] = !p_query->by_addr ||
+                        (memcmp(&p_columns[SCAN_COL_DICT].p_data[i * DICT_ENTRY_LEN], p_query->addr, 6) == 0);
+        matches      += p_selected[i];
+    }
+    if (matches == 0)
+    {
+        return 0;
+    }
+
+    // Which reports.
+    if ((block_load(p_reader, p_entry, SCAN_COL_TIME, p_stats) != 0) ||
+        (block_load(p_reader, p_entry, SCAN_COL_ADDR, p_stats) != 0))
+    {
+        return -1;
+    }
+    p_reader->rows.len = 0;
+    if (buf_reserve(&p_reader->rows, (size_t)p_hdr->reports * sizeof(row_t)) != 0)
+    {
+        return -1;
+    }
+    p_rows  = (row_t *)p_reader->rows.p_data;
+    matches = 0;
+    p_in    = p_columns[SCAN_COL_TIME].p_data;
+    p_end   = p_in + p_columns[SCAN_COL_TIME].len;
+    for (uint32_t i = 0; i < p_hdr->reports; i++)
+    {
+        uint64_t zigzag;
+
+        if (varint_get(&p_in, p_end, &zigzag) != 0)
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        timestamp              += (zigzag >> 1) ^ (0 - (zigzag & 1));
+        p_rows[i].timestamp_us  = timestamp;
+    }
+    p_in  = p_columns[SCAN_COL_ADDR].p_data;
+    p_end = p_in + p_columns[SCAN_COL_ADDR].len;
+    for (uint32_t i = 0; i < p_hdr->reports; i++)
+    {
+        uint64_t entry;
+
+        if ((varint_get(&p_in, p_end, &entry) != 0) || (entry >= p_hdr->addresses))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        p_rows[i].entry = (uint32_t)entry;
+        if (p_selected[entry] &&
+            (p_rows[i].timestamp_us >= p_query->t_min) && (p_rows[i].timestamp_us <= p_query->t_max))
+        {
+            matches++;
+        }
+        else
+        {
+            p_rows[i].entry = UINT32_MAX;
+        }
+    }
+    if (matches == 0)
+    {
+        return 0;
+    }
+
+    // The reports themselves.
+    for (int column = SCAN_COL_RSSI; column < SCAN_COL_COUNT; column++)
+    {
+        if (block_load(p_reader, p_entry, column, p_stats) != 0)
+        {
+            return -1;
+        }
+    }
+    if ((p_columns[SCAN_COL_RSSI].len != p_hdr->reports) || (p_columns[SCAN_COL_PHY].len != (size_t)p_hdr->reports * PHY_LEN) ||
+        (p_columns[SCAN_COL_META].len != (size_t)p_hdr->reports * META_LEN))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+    p_in  = p_columns[SCAN_COL_DATA].p_data;
+    p_end = p_in + p_columns[SCAN_COL_DATA].len;
+    for (uint32_t i = 0; i < p_hdr->reports; i++)
+    {
+        uint64_t data_len;
+
+        if ((varint_get(&p_in, p_end, &data_len) != 0) || (data_len > (uint64_t)(p_end - p_in)) ||
+            (data_len > DATA_MAX))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+
+        if (p_rows[i].entry != UINT32_MAX)
+        {
+            uint8_t const   * p_key  = &p_columns[SCAN_COL_DICT].p_data[p_rows[i].entry * DICT_ENTRY_LEN];
+            uint8_t const   * p_meta = &p_columns[SCAN_COL_META].p_data[i * META_LEN];
+            uint8_t const   * p_phy  = &p_columns[SCAN_COL_PHY].p_data[i * PHY_LEN];
+            scan_report_hdr_t report =
+            {
+                .timestamp_us  = p_rows[i].timestamp_us,
+                .addr_type     = p_key[6],
+                .flags         = p_meta[0],
+                .rssi          = (int8_t)p_columns[SCAN_COL_RSSI].p_data[i],
+                .tx_power      = (int8_t)p_meta[1],
+                .primary_phy   = p_phy[0],
+                .secondary_phy = p_phy[1],
+                .ch_index      = p_meta[2],
+                .set_id        = p_meta[3],
+                .data_id       = (uint16_t)(p_meta[4] | (p_meta[5] << 8)),
+                .data_len      = (uint16_t)data_len,
+            };
+            scan_record_t record =
+            {
+                .type      = SCAN_FRAME_TYPE_ADV_REPORT,
+                .len       = (uint16_t)(sizeof(report) + data_len),
+                .p_payload = payload,
+            };
+
+            memcpy(report.addr, p_key, sizeof(report.addr));
+            memcpy(payload, &report, sizeof(report));
+            memcpy(&payload[sizeof(report)], p_in, data_len);
+            handler(&record, p_context);
+            p_stats->reports++;
+        }
+        p_in += data_len;
+    }
+
+    return 0;
+}
+
+
+int scan_col_query(scan_col_reader_t            * p_reader,
+                   scan_col_query_t const       * p_query,
+                   scan_decoder_handler_t         handler,
+                   void                         * p_context,
+                   scan_col_query_stats_t       * p_stats)
+{
+    scan_col_query_stats_t stats = { .chunks = p_reader->chunks };
+    int                    err   = 0;
+
+    for (uint32_t i = 0; (i < p_reader->chunks) && (err == 0); i++)
+    {
+        scan_col_index_t const * p_entry = &p_reader->p_index[i];
+
+        if ((p_entry->hdr.t_max < p_query->t_min) || (p_entry->hdr.t_min > p_query->t_max) ||
+            (p_query->by_addr && !bloom_test(p_entry->hdr.bloom, p_query->addr)))
+        {
+            continue;
+        }
+        stats.chunks_read++;
+        err = chunk_query(p_reader, p_entry, p_query, handler, p_context, &stats);
+    }
+
+    if (p_stats != NULL)
+    {
+        *p_stats = stats;
+    }
+
+    return err;
+}
+
+
+void scan_col_reader_close(scan_col_reader_t * p_reader)
+{
+    if (p_reader->fd >= 0)
+    {
+        close(p_reader->fd);
+    }
+    for (int column = 0; column < SCAN_COL_COUNT; column++)
+    {
+        free(p_reader->columns[column].p_data);
+    }
+    free(p_reader->block.p_data);
+    free(p_reader->rows.p_data);
+    free(p_reader->selected.p_data);
+    free(p_reader->p_index);
+    free(p_reader);
+}
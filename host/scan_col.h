@@ -0,0 +1,219 @@
+/***************************************************************************************/
+/*
+ * scan_col
+ *
+ *  Columnar capture files, for surveys that run for weeks. The advertising reports
+ *  are stored in chunks of a fixed number of reports; each chunk stores each field
+ *  of the reports as a column, in its own compressed block (scan_lz):
+ *
+ *      DICT    addresses of the chunk, 7 bytes each (address, type)
+ *      TIME    timestamp minus the previous one, zigzag varint
+ *      ADDR    index of the address in DICT, varint
+ *      RSSI    1 byte
+ *      PHY     primary and secondary PHY
+ *      META    flags, TX power, channel index, SID, data ID (LE16)
+ *      DATA    data length (varint) and advertising data
+ *
+ *  A chunk starts with a header holding the time range of its reports, the length
+ *  of its blocks and a Bloom filter of its addresses. The footer repeats the headers,
+ *  so a query reads the footer, then only the chunks whose time range and filter
+ *  match, and of those only the columns it needs to find the matching reports.
+ *
+ *      "SCOL" header | chunk | chunk | ... | footer | trailer
+ *
+ *  Files without their footer (a writer that did not close, or a file still being
+ *  written) are indexed again by walking the chunk headers; a truncated last chunk
+ *  is ignored.
+ *
+ *  Only advertising reports are stored; the other records are left out.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_COL_H__
+#define SCAN_COL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "scan_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_COL_MAGIC              0x4C4F4353                          /**< "SCOL", at the start of the file. */
+#define SCAN_COL_CHUNK_MAGIC        0x48434353                          /**< "SCCH", at the start of each chunk. */
+#define SCAN_COL_FOOTER_MAGIC       0x54464353                          /**< "SCFT", at the end of the file. */
+#define SCAN_COL_VERSION            1
+#define SCAN_COL_BLOOM_SIZE         1024                                /**< Bytes of the address filter of a chunk. */
+#define SCAN_COL_CHUNK_REPORTS      16384                               /**< Default reports per chunk. */
+
+/**@brief Columns of a chunk, in the order of their blocks. */
+typedef enum
+{
+    SCAN_COL_DICT,
+    SCAN_COL_TIME,
+    SCAN_COL_ADDR,
+    SCAN_COL_RSSI,
+    SCAN_COL_PHY,
+    SCAN_COL_META,
+    SCAN_COL_DATA,
+    SCAN_COL_COUNT
+} scan_col_column_t;
+
+/**@brief Encodings of a block. */
+typedef enum
+{
+    SCAN_COL_ENCODING_RAW = 0,
+    SCAN_COL_ENCODING_LZ  = 1,
+} scan_col_encoding_t;
+
+#pragma pack(push, 1)
+
+/**@brief Header of the file. */
+typedef struct
+{
+    uint32_t magic;                                                     /**< @ref SCAN_COL_MAGIC. */
+    uint16_t version;                                                   /**< @ref SCAN_COL_VERSION. */
+    uint16_t reserved;
+    uint32_t chunk_reports;                                             /**< Most reports per chunk. */
+} scan_col_file_hdr_t;
+
+/**@brief Header of a chunk, also repeated in the footer. */
+typedef struct
+{
+    uint32_t magic;                                                     /**< @ref SCAN_COL_CHUNK_MAGIC. */
+    uint32_t reports;                                                   /**< Reports in the chunk. */
+    uint64_t t_min;                                                     /**< Earliest timestamp, microseconds. */
+    uint64_t t_max;                                                     /**< Latest timestamp, microseconds. */
+    uint32_t addresses;                                                 /**< Entries of the DICT column. */
+    uint32_t block_len[SCAN_COL_COUNT];                                 /**< Length of each block, header included. */
+    uint8_t  bloom[SCAN_COL_BLOOM_SIZE];                                /**< Bloom filter of the addresses. */
+} scan_col_chunk_hdr_t;
+
+/**@brief Header of a block, followed by its data. */
+typedef struct
+{
+    uint8_t  encoding;                                                  /**< @ref scan_col_encoding_t. */
+    uint8_t  reserved[3];
+    uint32_t raw_len;                                                   /**< Length of the data once decoded. */
+} scan_col_block_hdr_t;
+
+/**@brief Entry of the footer. */
+typedef struct
+{
+    uint64_t             offset;                                        /**< Offset of the chunk in the file. */
+    scan_col_chunk_hdr_t hdr;
+} scan_col_index_t;
+
+/**@brief End of the file. */
+typedef struct
+{
+    uint64_t footer_offset;
+    uint32_t chunks;                                                    /**< Entries of the footer. */
+    uint32_t magic;                                                     /**< @ref SCAN_COL_FOOTER_MAGIC. */
+} scan_col_trailer_t;
+
+#pragma pack(pop)
+
+/**@brief Writer instance. */
+typedef struct scan_col_writer_s scan_col_writer_t;
+
+/**@brief Reader instance. */
+typedef struct scan_col_reader_s scan_col_reader_t;
+
+/**@brief A query. Reports match when they match every condition. */
+typedef struct
+{
+    bool     by_addr;                                                   /**< Match on @ref addr, any address type. */
+    uint8_t  addr[6];                                                   /**< Address, least significant byte first. */
+    uint64_t t_min;                                                     /**< Earliest timestamp, microseconds. */
+    uint64_t t_max;                                                     /**< Latest timestamp, microseconds. */
+} scan_col_query_t;
+
+/**@brief Counters of a query. */
+typedef struct
+{
+    uint32_t chunks;                                                    /**< Chunks in the file. */
+    uint32_t chunks_read;                                               /**< Chunks whose blocks were read. */
+    uint64_t bytes_read;                                                /**< Bytes of blocks read. */
+    uint64_t reports;                                                   /**< Reports that matched. */
+} scan_col_query_stats_t;
+
+
+/**@brief Function for creating a file.
+ *
+ * @param[out]  pp_writer       Writer instance.
+ * @param[in]   p_path          File, replaced.
+ * @param[in]   chunk_reports   Reports per chunk, 0 for @ref SCAN_COL_CHUNK_REPORTS.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_col_writer_open(scan_col_writer_t ** pp_writer, char const * p_path, uint32_t chunk_reports);
+
+
+/**@brief Function for adding a record.
+ *
+ * @details A chunk is compressed and written when it is full.
+ *
+ * @param[in]   p_writer    Writer instance.
+ * @param[in]   p_record    Record, ignored unless it is an advertising report.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_col_writer_add(scan_col_writer_t * p_writer, scan_record_t const * p_record);
+
+
+/**@brief Function for writing the last chunk and the footer, and freeing the writer.
+ *
+ * @return 0 on success, -1 on error (errno is set). The writer is freed either way.
+ */
+int scan_col_writer_close(scan_col_writer_t * p_writer);
+
+
+/**@brief Function for opening a file and reading its index.
+ *
+ * @param[out]  pp_reader   Reader instance.
+ * @param[in]   p_path      File.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_col_reader_open(scan_col_reader_t ** pp_reader, char const * p_path);
+
+
+/**@brief Function for getting the index of an open file.
+ *
+ * @param[in]   p_reader    Reader instance.
+ * @param[out]  pp_index    Entries of the index, one per chunk, valid while the file is open.
+ *
+ * @return Number of chunks.
+ */
+uint32_t scan_col_reader_index(scan_col_reader_t const * p_reader, scan_col_index_t const ** pp_index);
+
+
+/**@brief Function for finding the reports that match a query.
+ *
+ * @param[in]   p_reader    Reader instance.
+ * @param[in]   p_query     Query.
+ * @param[in]   handler     Called with every matching report, as an advertising
+ *                          report record, in the order of the file.
+ * @param[in]   p_context   Passed to @p handler.
+ * @param[out]  p_stats     Counters. Can be NULL.
+ *
+ * @return 0 on success, -1 on error (errno is set, EBADMSG for a corrupted chunk).
+ */
+int scan_col_query(scan_col_reader_t            * p_reader,
+                   scan_col_query_t const       * p_query,
+                   scan_decoder_handler_t         handler,
+                   void                         * p_context,
+                   scan_col_query_stats_t       * p_stats);
+
+
+/**@brief Function for closing a file. */
+void scan_col_reader_close(scan_col_reader_t * p_reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_COL_H__
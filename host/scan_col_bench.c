@@ -0,0 +1,374 @@
+/***************************************************************************************/
+/*
+ * scan_col_bench
+ *
+ *  Compares the columnar capture files (scan_col) with the text log scan_dump writes,
+ *  on a survey made in memory: advertisers that each repeat their own data, with a
+ *  counter that changes now and then, heard at a steady rate for as long as it takes.
+ *
+ *  Both are written from the same reports, and their rate and size printed, with the
+ *  size of the binary capture for reference. Then the reports of a few advertisers
+ *  within a tenth of the survey are looked up in both: in the text by searching for
+ *  the address and reading the time of the lines found, in the columnar file with a
+ *  query. Both must find the same reports.
+ *
+ *  The files are read from the page cache.
+ *
+ *  Usage: scan_col_bench [-n reports] [-d devices] [-r reports_per_second] [-t directory]
+*/
+/***************************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_col.h"
+#include "scan_text.h"
+
+#define QUERIES         16
+#define ADDR_TEXT_LEN   sizeof("addr=00:00:00:00:00:00/")
+
+/**@brief Survey generator. */
+typedef struct
+{
+    uint32_t seed;
+    uint32_t devices;
+    uint64_t timestamp_us;
+    uint32_t interval_us;                                               /**< Time between reports. */
+} survey_t;
+
+/**@brief A report and its record. */
+typedef struct
+{
+    scan_record_t record;
+    uint8_t       payload[sizeof(scan_report_hdr_t) + 31];
+} report_t;
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static uint32_t random_next(survey_t * p_survey)
+{
+    p_survey->seed = p_survey->seed * 1103515245 + 12345;
+
+    return p_survey->seed >> 8;
+}
+
+
+static void addr_make(uint32_t device, uint8_t * p_addr)
+{
+    memcpy(p_addr, &device, sizeof(device));
+    p_addr[4] = 0x00;
+    p_addr[5] = 0xC0;
+}
+
+
+/**@brief Function for making the next report of the survey. */
+static void report_next(survey_t * p_survey, report_t * p_report)
+{
+    scan_report_hdr_t hdr    = { 0 };
+    uint32_t          device = random_next(p_survey) % p_survey->devices;
+    uint8_t         * p_data = &p_report->payload[sizeof(hdr)];
+
+    p_survey->timestamp_us += p_survey->interval_us / 2 + random_next(p_survey) % p_survey->interval_us;
+
+    hdr.timestamp_us  = p_survey->timestamp_us;
+    addr_make(device, hdr.addr);
+    hdr.addr_type     = 1;
+    hdr.flags         = SCAN_REPORT_FLAG_SCANNABLE;
+    hdr.rssi          = (int8_t)(-40 - (int)(random_next(p_survey) % 50));
+    hdr.tx_power      = SCAN_REPORT_TX_POWER_INVALID;
+    hdr.primary_phy   = 1;
+    hdr.secondary_phy = 0;
+    hdr.ch_index      = (uint8_t)(37 + random_next(p_survey) % 3);
+    hdr.set_id        = SCAN_REPORT_SET_ID_INVALID;
+    hdr.data_len      = (uint16_t)(20 + device % 12);
+
+    // Flags, then manufacturer data made of the device number and a counter.
+    p_data[0] = 0x02;
+    p_data[1] = 0x01;
+    p_data[2] = 0x06;
+    p_data[3] = (uint8_t)(hdr.data_len - 4);
+    p_data[4] = 0xFF;
+    for (size_t i = 5; i < hdr.data_len; i++)
+    {
+        p_data[i] = (uint8_t)(device * 31 + i);
+    }
+    p_data[hdr.data_len - 1] = (uint8_t)(p_survey->timestamp_us >> 26);
+
+    memcpy(p_report->payload, &hdr, sizeof(hdr));
+    p_report->record.type      = SCAN_FRAME_TYPE_ADV_REPORT;
+    p_report->record.len       = (uint16_t)(sizeof(hdr) + hdr.data_len);
+    p_report->record.p_payload = p_report->payload;
+}
+
+
+static void survey_init(survey_t * p_survey, uint32_t devices, uint32_t rate)
+{
+    p_survey->seed         = 1;
+    p_survey->devices      = devices;
+    p_survey->timestamp_us = 0;
+    p_survey->interval_us  = 1000000 / rate;
+}
+
+
+static uint64_t file_size(char const * p_path)
+{
+    struct stat st;
+
+    return (stat(p_path, &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+
+static void fail(char const * p_path)
+{
+    fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+
+static void write_print(char const * p_name, uint64_t reports, uint64_t size, double elapsed, double baseline)
+{
+    printf("%-10s %12.0f %8.1f MB %8.1f %8.1fx\n", p_name, (double)reports / elapsed,
+           (double)size / 1e6, (double)size / (double)reports, (baseline > 0) ? baseline / elapsed : 1.0);
+}
+
+
+/**@brief The baseline: the lines of the address, then their time.
+ *
+ * @return Reports found.
+ */
+static uint64_t text_query(char const * p_text, size_t len, scan_col_query_t const * p_query)
+{
+    char         needle[ADDR_TEXT_LEN];
+    char const * p     = p_text;
+    char const * p_end = p_text + len;
+    uint64_t     found = 0;
+
+    snprintf(needle, sizeof(needle), "addr=%02x:%02x:%02x:%02x:%02x:%02x/",
+             p_query->addr[5], p_query->addr[4], p_query->addr[3],
+             p_query->addr[2], p_query->addr[1], p_query->addr[0]);
+
+    while ((p = memmem(p, (size_t)(p_end - p), needle, sizeof(needle) - 1)) != NULL)
+    {
+        char const * p_line = p;
+        char       * p_frac;
+        uint64_t     t_us;
+
+        while ((p_line > p_text) && (p_line[-1] != '\n'))
+        {
+            p_line--;
+        }
+        p_line = strstr(p_line, "t=");
+        t_us   = strtoull(p_line + 2, &p_frac, 10) * 1000000;
+        t_us  += strtoull(p_frac + 1, NULL, 10);
+        if ((t_us >= p_query->t_min) && (t_us <= p_query->t_max))
+        {
+            found++;
+        }
+        p += sizeof(needle) - 1;
+    }
+
+    return found;
+}
+
+
+static void report_count(scan_record_t const * p_record, void * p_context)
+{
+    (void)p_record;
+    (*(uint64_t *)p_context)++;
+}
+
+
+int main(int argc, char * argv[])
+{
+    survey_t            survey;
+    report_t            report;
+    scan_text_t         text;
+    scan_col_writer_t * p_writer;
+    scan_col_reader_t * p_reader;
+    scan_col_query_t    queries[QUERIES];
+    uint32_t            reports = 2000000;
+    uint32_t            devices = 2000;
+    uint32_t            rate    = 1000;
+    char const        * p_dir   = "/tmp";
+    char                text_path[256];
+    char                col_path[256];
+    uint64_t            capture_size = 0;
+    uint64_t            text_found = 0;
+    uint64_t            col_found  = 0;
+    uint64_t            col_bytes  = 0;
+    double              start;
+    double              text_elapsed;
+    double              col_elapsed;
+    FILE              * p_file;
+    char              * p_text;
+    size_t              text_len;
+    int                 fd;
+    int                 opt;
+
+    while ((opt = getopt(argc, argv, "n:d:r:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                reports = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'd':
+                devices = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'r':
+                rate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 't':
+                p_dir = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n reports] [-d devices] [-r reports_per_second] [-t directory]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((reports == 0) || (devices == 0) || (rate == 0) || (rate > 1000000))
+    {
+        fprintf(stderr, "bad survey\n");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(text_path, sizeof(text_path), "%s/scan_col_bench.txt", p_dir);
+    snprintf(col_path, sizeof(col_path), "%s/scan_col_bench.scol", p_dir);
+
+    // The text log, as scan_dump writes it.
+    survey_init(&survey, devices, rate);
+    p_file = fopen(text_path, "w");
+    if (p_file == NULL)
+    {
+        fail(text_path);
+    }
+    scan_text_init(&text, p_file);
+    start = now_s();
+    for (uint32_t i = 0; i < reports; i++)
+    {
+        report_next(&survey, &report);
+        scan_text_record_print(&text, &report.record);
+        capture_size += SCAN_FRAME_OVERHEAD + report.record.len;
+    }
+    if (fclose(p_file) != 0)
+    {
+        fail(text_path);
+    }
+    text_elapsed = now_s() - start;
+
+    // The columnar file.
+    survey_init(&survey, devices, rate);
+    if (scan_col_writer_open(&p_writer, col_path, 0) != 0)
+    {
+        fail(col_path);
+    }
+    start = now_s();
+    for (uint32_t i = 0; i < reports; i++)
+    {
+        report_next(&survey, &report);
+        if (scan_col_writer_add(p_writer, &report.record) != 0)
+        {
+            fail(col_path);
+        }
+    }
+    if (scan_col_writer_close(p_writer) != 0)
+    {
+        fail(col_path);
+    }
+    col_elapsed = now_s() - start;
+
+    printf("%u reports from %u advertisers over %.1f hours\n\n", reports, devices,
+           (double)survey.timestamp_us / 3600e6);
+    printf("%-10s %12s %11s %8s %9s\n", "write", "reports/s", "size", "B/report", "speedup");
+    printf("%-10s %12s %8.1f MB %8.1f\n", "capture", "-", (double)capture_size / 1e6,
+           (double)capture_size / (double)reports);
+    write_print("text", reports, file_size(text_path), text_elapsed, 0);
+    write_print("columnar", reports, file_size(col_path), col_elapsed, text_elapsed);
+
+    // A tenth of the survey, for a few advertisers.
+    for (uint32_t i = 0; i < QUERIES; i++)
+    {
+        queries[i].by_addr = true;
+        addr_make((i * 7919) % devices, queries[i].addr);
+        queries[i].t_min   = survey.timestamp_us / QUERIES * i;
+        queries[i].t_max   = queries[i].t_min + survey.timestamp_us / 10;
+    }
+
+    fd = open(text_path, O_RDONLY);
+    if (fd < 0)
+    {
+        fail(text_path);
+    }
+    text_len = (size_t)file_size(text_path);
+    p_text   = mmap(NULL, text_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_text == MAP_FAILED)
+    {
+        fail(text_path);
+    }
+    (void)text_query(p_text, text_len, &queries[0]);
+    start = now_s();
+    for (uint32_t i = 0; i < QUERIES; i++)
+    {
+        text_found += text_query(p_text, text_len, &queries[i]);
+    }
+    text_elapsed = (now_s() - start) / QUERIES;
+    munmap(p_text, text_len);
+
+    if (scan_col_reader_open(&p_reader, col_path) != 0)
+    {
+        fail(col_path);
+    }
+    start = now_s();
+    for (uint32_t i = 0; i < QUERIES; i++)
+    {
+        scan_col_query_stats_t stats;
+
+        if (scan_col_query(p_reader, &queries[i], report_count, &col_found, &stats) != 0)
+        {
+            fail(col_path);
+        }
+        col_bytes += stats.bytes_read;
+    }
+    col_elapsed = (now_s() - start) / QUERIES;
+    scan_col_reader_close(p_reader);
+
+    printf("\n%-10s %12s %11s %8s %9s\n", "query", "ms", "read", "reports", "speedup");
+    printf("%-10s %12.2f %8.1f MB %8.1f %9s\n", "text", text_elapsed * 1e3,
+           (double)text_len / 1e6, (double)text_found / QUERIES, "1.0x");
+    printf("%-10s %12.2f %8.1f MB %8.1f %8.1fx\n", "columnar", col_elapsed * 1e3,
+           (double)col_bytes / QUERIES / 1e6, (double)col_found / QUERIES, text_elapsed / col_elapsed);
+
+    unlink(text_path);
+    unlink(col_path);
+
+    if (text_found != col_found)
+    {
+        printf("MISMATCH\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,507 @@
+/***************************************************************************************/
+/*
+ * scan_ctl
+ *
+ *  Sends one command to the scanner over its serial port and prints the answer, so
+ *  the scan parameters, PHYs, filters and output can be changed without rebuilding
+ *  the firmware. The scanner is found at whatever baud rate it runs.
+ *
+ *  Usage: scan_ctl [-b baudrate] <device> <command> [arguments]
+ *
+ *    start | stop                      start or stop scanning
+ *    params <interval> <window> [active|passive]
+ *                                      scan interval and window in ms
+ *    phys 1m | coded | both [<dwell 1m> <dwell coded>]
+ *                                      primary PHYs, in turns if both dwell times in ms are given
+ *    output [dedup] [beacon] [rssi]    records sent, plain reports if none is given
+ *    stats                             ask for a statistics record and print it
+ *    filter clear [any | all]          remove every filter, then keep what matches any or all
+ *    filter company <id>               manufacturer data of a company, e.g. 0x004C
+ *    filter uuid <hex>                 UUID starting with these bytes, e.g. E2C56DB5
+ *    filter addr <hex>                 address starting with these bytes, e.g. D0:00
+ *    filter range <addr> <addr>        address in this range, bounds included
+ *    filter rssi <dBm>                 RSSI floor
+ *    filter data <offset> <hex>[/<mask>]
+ *                                      advertising data bytes from offset
+ *
+ *  Bytes are written most significant first, colons are allowed between them. The
+ *  options come before the device, so that negative numbers can follow it.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_link.h"
+#include "serial_port.h"
+
+#define ADDR_LEN                6
+#define UNIT_0_625_US           625                                     /**< Unit of the scan interval and window. */
+#define BLE_PHY_1M              0x01                                    /**< BLE_GAP_PHY_1MBPS. */
+#define BLE_PHY_CODED           0x04                                    /**< BLE_GAP_PHY_CODED. */
+
+/**@brief A command ready to be sent. */
+typedef struct
+{
+    uint8_t  cmd;
+    uint16_t len;
+    union
+    {
+        scan_cmd_scan_params_t  params;
+        scan_cmd_scan_phys_t    phys;
+        scan_cmd_output_mode_t  output;
+        scan_cmd_filter_clear_t clear;
+        scan_filter_rule_t      rule;
+    } payload;
+} ctl_cmd_t;
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr,
+            "Usage: %s [-b baudrate] <device> <command> [arguments]\n"
+            "  start | stop\n"
+            "  params <interval ms> <window ms> [active|passive]\n"
+            "  phys 1m|coded|both [<dwell 1m ms> <dwell coded ms>]\n"
+            "  output [dedup] [beacon] [rssi]\n"
+            "  stats\n"
+            "  filter clear [any|all]\n"
+            "  filter company <id> | uuid <hex> | addr <hex> | range <addr> <addr>\n"
+            "  filter rssi <dBm> | data <offset> <hex>[/<mask>]\n",
+            p_name);
+}
+
+
+/**@brief Function for reading a number, in any base strtol takes.
+ *
+ * @return 0 on success, -1 if the text is not a number between @p min and @p max.
+ */
+static int number_parse(char const * p_text, long min, long max, long * p_value)
+{
+    char * p_end;
+    long   value;
+
+    errno = 0;
+    value = strtol(p_text, &p_end, 0);
+    if ((errno != 0) || (p_end == p_text) || (*p_end != '\0') || (value < min) || (value > max))
+    {
+        return -1;
+    }
+    *p_value = value;
+
+    return 0;
+}
+
+
+/**@brief Function for reading a duration in ms as a count of 0.625 ms units.
+ *
+ * @return 0 on success, -1 if the text is not a duration that fits.
+ */
+static int units_parse(char const * p_text, uint16_t * p_units)
+{
+    char * p_end;
+    double ms = strtod(p_text, &p_end);
+    double units;
+
+    if ((p_end == p_text) || (*p_end != '\0'))
+    {
+        return -1;
+    }
+    units = ms * 1000 / UNIT_0_625_US + 0.5;
+    if ((units < 1) || (units > UINT16_MAX))
+    {
+        return -1;
+    }
+    *p_units = (uint16_t)units;
+
+    return 0;
+}
+
+
+/**@brief Function for reading bytes written in hexadecimal, colons allowed between them.
+ *
+ * @param[in]   p_text      Text, ended by NUL or '/'.
+ * @param[out]  p_bytes     Bytes read.
+ * @param[in]   size        Room in @p p_bytes.
+ *
+ * @return Number of bytes read, -1 if the text is not hexadecimal or too long.
+ */
+static int hex_parse(char const * p_text, uint8_t * p_bytes, size_t size)
+{
+    size_t count = 0;
+
+    while ((*p_text != '\0') && (*p_text != '/'))
+    {
+        char digits[3] = { p_text[0], '\0', '\0' };
+        char * p_end;
+
+        if (*p_text == ':')
+        {
+            p_text++;
+            continue;
+        }
+        digits[1] = p_text[1];
+        if ((count >= size) || (digits[1] == '\0'))
+        {
+            return -1;
+        }
+        p_bytes[count] = (uint8_t)strtoul(digits, &p_end, 16);
+        if (*p_end != '\0')
+        {
+            return -1;
+        }
+        count++;
+        p_text += 2;
+    }
+
+    return (count > 0) ? (int)count : -1;
+}
+
+
+/**@brief Function for building a filter command.
+ *
+ * @return 0 on success, -1 if the arguments are not valid.
+ */
+static int filter_build(int argc, char * argv[], ctl_cmd_t * p_cmd)
+{
+    scan_filter_rule_t * p_rule = &p_cmd->payload.rule;
+    long                 value;
+    int                  len;
+
+    if (argc < 1)
+    {
+        return -1;
+    }
+
+    if (strcmp(argv[0], "clear") == 0)
+    {
+        p_cmd->cmd                = SCAN_CMD_FILTER_CLEAR;
+        p_cmd->len                = sizeof(scan_cmd_filter_clear_t);
+        p_cmd->payload.clear.mode = SCAN_FILTER_MODE_ANY;
+        if ((argc == 2) && (strcmp(argv[1], "all") == 0))
+        {
+            p_cmd->payload.clear.mode = SCAN_FILTER_MODE_ALL;
+        }
+        else if ((argc != 1) && !((argc == 2) && (strcmp(argv[1], "any") == 0)))
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    p_cmd->cmd = SCAN_CMD_FILTER_ADD;
+    p_cmd->len = sizeof(scan_filter_rule_t);
+
+    if ((strcmp(argv[0], "company") == 0) && (argc == 2))
+    {
+        if (number_parse(argv[1], 0, UINT16_MAX, &value) != 0)
+        {
+            return -1;
+        }
+        p_rule->type     = SCAN_FILTER_COMPANY_ID;
+        p_rule->len      = 2;
+        p_rule->value[0] = (uint8_t)value;
+        p_rule->value[1] = (uint8_t)(value >> 8);
+    }
+    else if ((strcmp(argv[0], "uuid") == 0) && (argc == 2))
+    {
+        len          = hex_parse(argv[1], p_rule->value, SCAN_FILTER_VALUE_MAX);
+        p_rule->type = SCAN_FILTER_UUID_PREFIX;
+        p_rule->len  = (uint8_t)len;
+        if (len < 0)
+        {
+            return -1;
+        }
+    }
+    else if ((strcmp(argv[0], "addr") == 0) && (argc == 2))
+    {
+        len          = hex_parse(argv[1], p_rule->value, ADDR_LEN);
+        p_rule->type = SCAN_FILTER_ADDR_PREFIX;
+        p_rule->len  = (uint8_t)len;
+        if (len < 0)
+        {
+            return -1;
+        }
+    }
+    else if ((strcmp(argv[0], "range") == 0) && (argc == 3))
+    {
+        if ((hex_parse(argv[1], &p_rule->value[0], ADDR_LEN) != ADDR_LEN) ||
+            (hex_parse(argv[2], &p_rule->value[ADDR_LEN], ADDR_LEN) != ADDR_LEN))
+        {
+            return -1;
+        }
+        p_rule->type = SCAN_FILTER_ADDR_RANGE;
+        p_rule->len  = 2 * ADDR_LEN;
+    }
+    else if ((strcmp(argv[0], "rssi") == 0) && (argc == 2))
+    {
+        if (number_parse(argv[1], INT8_MIN, INT8_MAX, &value) != 0)
+        {
+            return -1;
+        }
+        p_rule->type     = SCAN_FILTER_RSSI_MIN;
+        p_rule->len      = 1;
+        p_rule->value[0] = (uint8_t)(int8_t)value;
+    }
+    else if ((strcmp(argv[0], "data") == 0) && (argc == 3))
+    {
+        char const * p_mask = strchr(argv[2], '/');
+
+        if ((number_parse(argv[1], 0, UINT8_MAX, &value) != 0) ||
+            ((len = hex_parse(argv[2], p_rule->value, SCAN_FILTER_VALUE_MAX)) < 0))
+        {
+            return -1;
+        }
+        memset(p_rule->mask, 0xFF, (size_t)len);
+        if ((p_mask != NULL) && (hex_parse(p_mask + 1, p_rule->mask, (size_t)len) != len))
+        {
+            return -1;
+        }
+        p_rule->type   = SCAN_FILTER_DATA;
+        p_rule->len    = (uint8_t)len;
+        p_rule->offset = (uint8_t)value;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for building a command from the command line.
+ *
+ * @return 0 on success, -1 if the command or its arguments are not valid.
+ */
+static int cmd_build(int argc, char * argv[], ctl_cmd_t * p_cmd)
+{
+    long value;
+
+    memset(p_cmd, 0, sizeof(*p_cmd));
+
+    if ((strcmp(argv[0], "start") == 0) && (argc == 1))
+    {
+        p_cmd->cmd = SCAN_CMD_SCAN_START;
+    }
+    else if ((strcmp(argv[0], "stop") == 0) && (argc == 1))
+    {
+        p_cmd->cmd = SCAN_CMD_SCAN_STOP;
+    }
+    else if ((strcmp(argv[0], "stats") == 0) && (argc == 1))
+    {
+        p_cmd->cmd = SCAN_CMD_STATS_GET;
+    }
+    else if ((strcmp(argv[0], "params") == 0) && ((argc == 3) || (argc == 4)))
+    {
+        scan_cmd_scan_params_t * p_params = &p_cmd->payload.params;
+
+        if ((units_parse(argv[1], &p_params->interval) != 0) ||
+            (units_parse(argv[2], &p_params->window) != 0))
+        {
+            return -1;
+        }
+        if (argc == 4)
+        {
+            if (strcmp(argv[3], "active") == 0)
+            {
+                p_params->active = 1;
+            }
+            else if (strcmp(argv[3], "passive") != 0)
+            {
+                return -1;
+            }
+        }
+        p_cmd->cmd = SCAN_CMD_SCAN_PARAMS;
+        p_cmd->len = sizeof(*p_params);
+    }
+    else if ((strcmp(argv[0], "phys") == 0) && ((argc == 2) || (argc == 4)))
+    {
+        scan_cmd_scan_phys_t * p_phys = &p_cmd->payload.phys;
+
+        if (strcmp(argv[1], "1m") == 0)
+        {
+            p_phys->phys = BLE_PHY_1M;
+        }
+        else if (strcmp(argv[1], "coded") == 0)
+        {
+            p_phys->phys = BLE_PHY_CODED;
+        }
+        else if (strcmp(argv[1], "both") == 0)
+        {
+            p_phys->phys = BLE_PHY_1M | BLE_PHY_CODED;
+        }
+        else
+        {
+            return -1;
+        }
+        if (argc == 4)
+        {
+            if (number_parse(argv[2], 0, UINT16_MAX, &value) != 0)
+            {
+                return -1;
+            }
+            p_phys->dwell_1m_ms = (uint16_t)value;
+            if (number_parse(argv[3], 0, UINT16_MAX, &value) != 0)
+            {
+                return -1;
+            }
+            p_phys->dwell_coded_ms = (uint16_t)value;
+        }
+        p_cmd->cmd = SCAN_CMD_SCAN_PHYS;
+        p_cmd->len = sizeof(*p_phys);
+    }
+    else if (strcmp(argv[0], "output") == 0)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "dedup") == 0)
+            {
+                p_cmd->payload.output.flags |= SCAN_OUTPUT_FLAG_DEDUP;
+            }
+            else if (strcmp(argv[i], "beacon") == 0)
+            {
+                p_cmd->payload.output.flags |= SCAN_OUTPUT_FLAG_BEACON;
+            }
+            else if (strcmp(argv[i], "rssi") == 0)
+            {
+                p_cmd->payload.output.flags |= SCAN_OUTPUT_FLAG_RSSI_AGG;
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        p_cmd->cmd = SCAN_CMD_OUTPUT_MODE;
+        p_cmd->len = sizeof(scan_cmd_output_mode_t);
+    }
+    else if (strcmp(argv[0], "filter") == 0)
+    {
+        return filter_build(argc - 1, &argv[1], p_cmd);
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static char const * status_name(uint8_t status)
+{
+    switch (status)
+    {
+        case SCAN_CMD_STATUS_OK:
+            return "ok";
+
+        case SCAN_CMD_STATUS_INVALID:
+            return "invalid";
+
+        case SCAN_CMD_STATUS_UNSUPPORTED:
+            return "unsupported";
+
+        case SCAN_CMD_STATUS_BUSY:
+            return "busy";
+
+        case SCAN_CMD_STATUS_FULL:
+            return "full";
+
+        default:
+            return "unknown status";
+    }
+}
+
+
+static void stats_print(scan_stats_t const * p_stats)
+{
+    printf("timestamp_us=%llu received=%u sent=%u summaries=%u queue_full=%u duplicates=%u filtered=%u "
+           "output_drops=%u tx_bytes=%u tx_busy=%u queue=%u/%u output=%u/%u window=%u cpu=%u.%02u%%\n",
+           (unsigned long long)p_stats->timestamp_us, p_stats->reports_received, p_stats->reports_sent,
+           p_stats->summaries_sent, p_stats->drop_queue_full, p_stats->drop_duplicate,
+           p_stats->drop_filtered, p_stats->drop_output, p_stats->tx_bytes, p_stats->tx_busy,
+           p_stats->queue_high_water, p_stats->queue_size, p_stats->output_high_water,
+           p_stats->output_size, p_stats->scan_window, p_stats->cpu_load / 100, p_stats->cpu_load % 100);
+}
+
+
+int main(int argc, char * argv[])
+{
+    ctl_cmd_t    cmd;
+    scan_hello_t hello;
+    scan_stats_t stats;
+    uint32_t     baudrate = 115200;
+    uint8_t      status   = SCAN_CMD_STATUS_OK;
+    int          opt;
+    int          fd;
+    int          err;
+
+    while ((opt = getopt(argc, argv, "+b:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((argc - optind < 2) || (cmd_build(argc - optind - 1, &argv[optind + 1], &cmd) != 0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fd = serial_port_open(argv[optind], baudrate, O_RDWR);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (scan_link_probe(fd, &hello) != 0)
+    {
+        fprintf(stderr, "%s: no answer from the scanner\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    if (cmd.cmd == SCAN_CMD_STATS_GET)
+    {
+        err = scan_link_stats_get(fd, &stats, &status);
+        if (err == 0)
+        {
+            stats_print(&stats);
+        }
+    }
+    else
+    {
+        err = scan_link_command(fd, cmd.cmd, &cmd.payload, cmd.len, &status);
+    }
+
+    close(fd);
+
+    if (status != SCAN_CMD_STATUS_OK)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind + 1], status_name(status));
+        return EXIT_FAILURE;
+    }
+    if (err != 0)
+    {
+        fprintf(stderr, "%s: no response\n", argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+
+    if (cmd.cmd != SCAN_CMD_STATS_GET)
+    {
+        printf("%s\n", status_name(status));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/***************************************************************************************/
+/*
+ * scan_decoder
+ *
+ *  Host side decoder of the binary scanner output.
+*/
+/***************************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "scan_beacon.h"
+#include "scan_decoder.h"
+
+
+/**@brief CRC of each byte value, polynomial 0x1021. */
+static uint16_t const m_crc16_table[256] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+
+/**@brief CRC of each byte value followed by a zero byte, to go through two bytes at a time. */
+static uint16_t const m_crc16_table2[256] =
+{
+    0x0000, 0x3331, 0x6662, 0x5553, 0xCCC4, 0xFFF5, 0xAAA6, 0x9997,
+    0x89A9, 0xBA98, 0xEFCB, 0xDCFA, 0x456D, 0x765C, 0x230F, 0x103E,
+    0x0373, 0x3042, 0x6511, 0x5620, 0xCFB7, 0xFC86, 0xA9D5, 0x9AE4,
+    0x8ADA, 0xB9EB, 0xECB8, 0xDF89, 0x461E, 0x752F, 0x207C, 0x134D,
+    0x06E6, 0x35D7, 0x6084, 0x53B5, 0xCA22, 0xF913, 0xAC40, 0x9F71,
+    0x8F4F, 0xBC7E, 0xE92D, 0xDA1C, 0x438B, 0x70BA, 0x25E9, 0x16D8,
+    0x0595, 0x36A4, 0x63F7, 0x50C6, 0xC951, 0xFA60, 0xAF33, 0x9C02,
+    0x8C3C, 0xBF0D, 0xEA5E, 0xD96F, 0x40F8, 0x73C9, 0x269A, 0x15AB,
+    0x0DCC, 0x3EFD, 0x6BAE, 0x589F, 0xC108, 0xF239, 0xA76A, 0x945B,
+    0x8465, 0xB754, 0xE207, 0xD136, 0x48A1, 0x7B90, 0x2EC3, 0x1DF2,
+    0x0EBF, 0x3D8E, 0x68DD, 0x5BEC, 0xC27B, 0xF14A, 0xA419, 0x9728,
+    0x8716, 0xB427, 0xE174, 0xD245, 0x4BD2, 0x78E3, 0x2DB0, 0x1E81,
+    0x0B2A, 0x381B, 0x6D48, 0x5E79, 0xC7EE, 0xF4DF, 0xA18C, 0x92BD,
+    0x8283, 0xB1B2, 0xE4E1, 0xD7D0, 0x4E47, 0x7D76, 0x2825, 0x1B14,
+    0x0859, 0x3B68, 0x6E3B, 0x5D0A, 0xC49D, 0xF7AC, 0xA2FF, 0x91CE,
+    0x81F0, 0xB2C1, 0xE792, 0xD4A3, 0x4D34, 0x7E05, 0x2B56, 0x1867,
+    0x1B98, 0x28A9, 0x7DFA, 0x4ECB, 0xD75C, 0xE46D, 0xB13E, 0x820F,
+    0x9231, 0xA100, 0xF453, 0xC762, 0x5EF5, 0x6DC4, 0x3897, 0x0BA6,
+    0x18EB, 0x2BDA, 0x7E89, 0x4DB8, 0xD42F, 0xE71E, 0xB24D, 0x817C,
+    0x9142, 0xA273, 0xF720, 0xC411, 0x5D86, 0x6EB7, 0x3BE4, 0x08D5,
+    0x1D7E, 0x2E4F, 0x7B1C, 0x482D, 0xD1BA, 0xE28B, 0xB7D8, 0x84E9,
+    0x94D7, 0xA7E6, 0xF2B5, 0xC184, 0x5813, 0x6B22, 0x3E71, 0x0D40,
+    0x1E0D, 0x2D3C, 0x786F, 0x4B5E, 0xD2C9, 0xE1F8, 0xB4AB, 0x879A,
+    0x97A4, 0xA495, 0xF1C6, 0xC2F7, 0x5B60, 0x6851, 0x3D02, 0x0E33,
+    0x1654, 0x2565, 0x7036, 0x4307, 0xDA90, 0xE9A1, 0xBCF2, 0x8FC3,
+    0x9FFD, 0xACCC, 0xF99F, 0xCAAE, 0x5339, 0x6008, 0x355B, 0x066A,
+    0x1527, 0x2616, 0x7345, 0x4074, 0xD9E3, 0xEAD2, 0xBF81, 0x8CB0,
+    0x9C8E, 0xAFBF, 0xFAEC, 0xC9DD, 0x504A, 0x637B, 0x3628, 0x0519,
+    0x10B2, 0x2383, 0x76D0, 0x45E1, 0xDC76, 0xEF47, 0xBA14, 0x8925,
+    0x991B, 0xAA2A, 0xFF79, 0xCC48, 0x55DF, 0x66EE, 0x33BD, 0x008C,
+    0x13C1, 0x20F0, 0x75A3, 0x4692, 0xDF05, 0xEC34, 0xB967, 0x8A56,
+    0x9A68, 0xA959, 0xFC0A, 0xCF3B, 0x56AC, 0x659D, 0x30CE, 0x03FF,
+};
+
+
+uint16_t scan_crc16(uint8_t const * p_data, size_t size, uint16_t const * p_crc)
+{
+    // Same result as crc16_compute() of the nRF5 SDK, two bytes at a time through tables.
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+    size_t   i   = 0;
+
+    for (; i + 2 <= size; i += 2)
+    {
+        crc = m_crc16_table2[(crc >> 8) ^ p_data[i]] ^ m_crc16_table[(crc & 0xFF) ^ p_data[i + 1]];
+    }
+    if (i < size)
+    {
+        crc = (uint16_t)(crc << 8) ^ m_crc16_table[(crc >> 8) ^ p_data[i]];
+    }
+
+    return crc;
+}
+
+
+void scan_decoder_init(scan_decoder_t * p_dec, scan_decoder_handler_t handler, void * p_context)
+{
+    memset(p_dec, 0, sizeof(*p_dec));
+    p_dec->handler   = handler;
+    p_dec->p_context = p_context;
+}
+
+
+/**@brief Function for dropping the first @p count bytes of the decoder buffer. */
+static void consume(scan_decoder_t * p_dec, size_t count)
+{
+    memmove(p_dec->buf, &p_dec->buf[count], p_dec->fill - count);
+    p_dec->fill -= count;
+}
+
+
+/**@brief Function for extracting every complete frame held in the decoder buffer. */
+static void process(scan_decoder_t * p_dec)
+{
+    for (;;)
+    {
+        uint8_t const * p_sof;
+        uint16_t        len;
+        uint16_t        crc;
+        uint16_t        rx_crc;
+
+        // Search for the start of a frame.
+        p_sof = memchr(p_dec->buf, SCAN_FRAME_SOF, p_dec->fill);
+        if (p_sof == NULL)
+        {
+            p_dec->skipped += p_dec->fill;
+            p_dec->fill     = 0;
+            return;
+        }
+        if (p_sof != p_dec->buf)
+        {
+            size_t skip = (size_t)(p_sof - p_dec->buf);
+
+            p_dec->skipped += skip;
+            consume(p_dec, skip);
+        }
+
+        if (p_dec->fill < SCAN_FRAME_HEADER_LEN)
+        {
+            return;
+        }
+
+        len = (uint16_t)(p_dec->buf[2] | (p_dec->buf[3] << 8));
+        if (len > SCAN_FRAME_MAX_PAYLOAD)
+        {
+            // Not a real frame, look for the next marker.
+            p_dec->skipped++;
+            consume(p_dec, 1);
+            continue;
+        }
+
+        if (p_dec->fill < (size_t)len + SCAN_FRAME_OVERHEAD)
+        {
+            return;
+        }
+
+        crc    = scan_crc16(&p_dec->buf[1], SCAN_FRAME_HEADER_LEN - 1 + len, NULL);
+        rx_crc = (uint16_t)(p_dec->buf[SCAN_FRAME_HEADER_LEN + len] |
+                            (p_dec->buf[SCAN_FRAME_HEADER_LEN + len + 1] << 8));
+        if (crc != rx_crc)
+        {
+            p_dec->crc_errors++;
+            p_dec->skipped++;
+            consume(p_dec, 1);
+            continue;
+        }
+
+        p_dec->frames++;
+        if (p_dec->handler != NULL)
+        {
+            scan_record_t record =
+            {
+                .type      = p_dec->buf[1],
+                .len       = len,
+                .p_payload = &p_dec->buf[SCAN_FRAME_HEADER_LEN],
+            };
+
+            p_dec->handler(&record, p_dec->p_context);
+        }
+        consume(p_dec, (size_t)len + SCAN_FRAME_OVERHEAD);
+    }
+}
+
+
+void scan_decoder_feed(scan_decoder_t * p_dec, uint8_t const * p_data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t room  = sizeof(p_dec->buf) - p_dec->fill;
+        size_t chunk = (len < room) ? len : room;
+
+        memcpy(&p_dec->buf[p_dec->fill], p_data, chunk);
+        p_dec->fill += chunk;
+        p_data      += chunk;
+        len         -= chunk;
+
+        process(p_dec);
+    }
+}
+
+
+
+void scan_decoder_flush(scan_decoder_t * p_dec)
+{
+    while (p_dec->fill > 0)
+    {
+        p_dec->skipped++;
+        consume(p_dec, 1);
+        process(p_dec);
+    }
+}
+
+
+size_t scan_frame_build(uint8_t      type,
+                        void const * p_payload,
+                        uint16_t     len,
+                        uint8_t    * p_out,
+                        size_t       out_size)
+{
+    uint16_t crc;
+
+    if ((len > SCAN_FRAME_MAX_PAYLOAD) || ((size_t)len + SCAN_FRAME_OVERHEAD > out_size))
+    {
+        return 0;
+    }
+
+    p_out[0] = SCAN_FRAME_SOF;
+    p_out[1] = type;
+    p_out[2] = (uint8_t)(len & 0xFF);
+    p_out[3] = (uint8_t)(len >> 8);
+    if (len > 0)
+    {
+        memcpy(&p_out[SCAN_FRAME_HEADER_LEN], p_payload, len);
+    }
+
+    crc = scan_crc16(&p_out[1], SCAN_FRAME_HEADER_LEN - 1 + len, NULL);
+    p_out[SCAN_FRAME_HEADER_LEN + len]     = (uint8_t)(crc & 0xFF);
+    p_out[SCAN_FRAME_HEADER_LEN + len + 1] = (uint8_t)(crc >> 8);
+
+    return (size_t)len + SCAN_FRAME_OVERHEAD;
+}
+
+
+int scan_record_adv_parse(scan_record_t const * p_record,
+                          scan_report_hdr_t   * p_hdr,
+                          uint8_t const      ** pp_data)
+{
+    if ((p_record->type != SCAN_FRAME_TYPE_ADV_REPORT) || (p_record->len < sizeof(*p_hdr)))
+    {
+        return -1;
+    }
+
+    // The wire format is little endian, as are the hosts this library targets.
+    memcpy(p_hdr, p_record->p_payload, sizeof(*p_hdr));
+    if (p_hdr->data_len != p_record->len - sizeof(*p_hdr))
+    {
+        return -1;
+    }
+
+    *pp_data = p_record->p_payload + sizeof(*p_hdr);
+
+    return 0;
+}
+
+
+int scan_record_stats_parse(scan_record_t const * p_record, scan_stats_t * p_stats)
+{
+    size_t len = (p_record->len < sizeof(*p_stats)) ? p_record->len : sizeof(*p_stats);
+
+    // drop_filtered came with protocol version 2.
+    if ((p_record->type != SCAN_FRAME_TYPE_STATS) || (p_record->len < offsetof(scan_stats_t, drop_filtered)))
+    {
+        return -1;
+    }
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    memcpy(p_stats, p_record->p_payload, len);
+
+    return 0;
+}
+
+
+int scan_record_beacon_parse(scan_record_t const * p_record,
+                             scan_beacon_hdr_t   * p_hdr,
+                             scan_beacon_body_t  * p_body)
+{
+    uint8_t body_len;
+
+    if ((p_record->type != SCAN_FRAME_TYPE_BEACON) || (p_record->len < sizeof(*p_hdr)))
+    {
+        return -1;
+    }
+
+    memcpy(p_hdr, p_record->p_payload, sizeof(*p_hdr));
+    body_len = scan_beacon_body_len(p_hdr->type);
+    if ((body_len == 0) || (p_record->len != sizeof(*p_hdr) + body_len))
+    {
+        return -1;
+    }
+
+    memcpy(p_body, p_record->p_payload + sizeof(*p_hdr), body_len);
+
+    return 0;
+}
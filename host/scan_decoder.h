@@ -0,0 +1,145 @@
+/***************************************************************************************/
+/*
+ * scan_decoder
+ *
+ *  Host side decoder of the binary scanner output. Bytes read from the serial port
+ *  are fed in arbitrary chunks; complete and CRC-valid frames are handed to a
+ *  callback. Corrupted or truncated frames are skipped by resynchronizing on the
+ *  next start of frame marker.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_DECODER_H__
+#define SCAN_DECODER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief A decoded record. The payload is only valid during the callback. */
+typedef struct
+{
+    uint8_t         type;                                               /**< Record type, see @ref scan_frame_type_t. */
+    uint16_t        len;                                                /**< Length of the payload. */
+    uint8_t const * p_payload;                                          /**< Payload of the record. */
+} scan_record_t;
+
+/**@brief Record handler type. */
+typedef void (*scan_decoder_handler_t)(scan_record_t const * p_record, void * p_context);
+
+/**@brief Decoder instance. */
+typedef struct
+{
+    uint8_t                buf[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t                 fill;                                        /**< Bytes held in @ref buf. */
+    scan_decoder_handler_t handler;
+    void                 * p_context;
+    uint64_t               frames;                                      /**< Valid frames decoded. */
+    uint64_t               crc_errors;                                  /**< Candidate frames rejected by the CRC. */
+    uint64_t               skipped;                                     /**< Bytes discarded while searching for a frame. */
+} scan_decoder_t;
+
+
+/**@brief Function for computing the CRC-16/CCITT used by the frames.
+ *
+ * @param[in]   p_data  Data to compute the CRC over.
+ * @param[in]   size    Length of the data.
+ * @param[in]   p_crc   Previous CRC to chain from, or NULL to start a new one.
+ */
+uint16_t scan_crc16(uint8_t const * p_data, size_t size, uint16_t const * p_crc);
+
+
+/**@brief Function for initializing a decoder.
+ *
+ * @param[out]  p_dec       Decoder instance.
+ * @param[in]   handler     Function called for every decoded record.
+ * @param[in]   p_context   Context passed to @p handler.
+ */
+void scan_decoder_init(scan_decoder_t * p_dec, scan_decoder_handler_t handler, void * p_context);
+
+
+/**@brief Function for feeding received bytes to the decoder.
+ *
+ * @param[in]   p_dec   Decoder instance.
+ * @param[in]   p_data  Received bytes.
+ * @param[in]   len     Number of received bytes.
+ */
+void scan_decoder_feed(scan_decoder_t * p_dec, uint8_t const * p_data, size_t len);
+
+
+/**@brief Function for flushing the decoder at the end of the input.
+ *
+ * @details A false start of frame marker followed by a plausible length makes the
+ *          decoder wait for more data. At the end of a capture no more data will
+ *          come, so the pending bytes are rescanned for frames that may hide behind
+ *          the false marker.
+ *
+ * @param[in]   p_dec   Decoder instance.
+ */
+void scan_decoder_flush(scan_decoder_t * p_dec);
+
+
+/**@brief Function for encoding a frame, the same way the scanner does.
+ *
+ * @param[in]   type        Frame type.
+ * @param[in]   p_payload   Payload. Can be NULL if @p len is 0.
+ * @param[in]   len         Payload length.
+ * @param[out]  p_out       Buffer for the frame.
+ * @param[in]   out_size    Size of @p p_out.
+ *
+ * @return Length of the frame, or 0 if it does not fit in @p p_out.
+ */
+size_t scan_frame_build(uint8_t      type,
+                        void const * p_payload,
+                        uint16_t     len,
+                        uint8_t    * p_out,
+                        size_t       out_size);
+
+
+/**@brief Function for splitting an advertising report record into header and data.
+ *
+ * @param[in]   p_record    Record of type @ref SCAN_FRAME_TYPE_ADV_REPORT.
+ * @param[out]  p_hdr       Report metadata.
+ * @param[out]  pp_data     Advertising data, @ref scan_report_hdr_t::data_len bytes.
+ *
+ * @return 0 on success, -1 if the record is malformed.
+ */
+int scan_record_adv_parse(scan_record_t const * p_record,
+                          scan_report_hdr_t   * p_hdr,
+                          uint8_t const      ** pp_data);
+
+
+
+/**@brief Function for reading a statistics record.
+ *
+ * @details Records of older scanners lack the last fields, which are then set to 0.
+ *
+ * @param[in]   p_record    Record of type @ref SCAN_FRAME_TYPE_STATS.
+ * @param[out]  p_stats     Statistics.
+ *
+ * @return 0 on success, -1 if the record is malformed.
+ */
+int scan_record_stats_parse(scan_record_t const * p_record, scan_stats_t * p_stats);
+
+
+/**@brief Function for splitting a beacon record into header and body.
+ *
+ * @param[in]   p_record    Record of type @ref SCAN_FRAME_TYPE_BEACON.
+ * @param[out]  p_hdr       Report metadata and beacon type.
+ * @param[out]  p_body      Beacon, the member of @ref scan_beacon_hdr_t::type is set.
+ *
+ * @return 0 on success, -1 if the record is malformed or of an unknown beacon type.
+ */
+int scan_record_beacon_parse(scan_record_t const * p_record,
+                             scan_beacon_hdr_t   * p_hdr,
+                             scan_beacon_body_t  * p_body);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_DECODER_H__
@@ -0,0 +1,157 @@
+/***************************************************************************************/
+/*
+ * scan_dedup_bench
+ *
+ *  Measures the lookup rate of the duplicate suppression table (scan_dedup) with
+ *  1k to 8k tracked advertisers. Each advertiser is inserted once, then reports with
+ *  the same data are looked up in random order, the way a scanner surrounded by
+ *  beacons sees them.
+ *
+ *  Usage: scan_dedup_bench [-n lookups] [-l data_len]
+*/
+/***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_dedup.h"
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static void hdr_make(scan_report_hdr_t * p_hdr, uint32_t device, uint16_t data_len)
+{
+    memset(p_hdr, 0, sizeof(*p_hdr));
+    memcpy(p_hdr->addr, &device, sizeof(device));
+    p_hdr->addr[5]   = 0xC0;
+    p_hdr->addr_type = 1;
+    p_hdr->set_id    = SCAN_REPORT_SET_ID_INVALID;
+    p_hdr->data_len  = data_len;
+}
+
+
+/**@brief Function for sizing the table for @p devices advertisers, at half load. */
+static uint32_t capacity_get(uint32_t devices)
+{
+    uint32_t capacity = 1;
+
+    while (capacity < devices * 2)
+    {
+        capacity *= 2;
+    }
+
+    return capacity;
+}
+
+
+/**@brief Function for measuring the lookup rate with @p devices advertisers.
+ *
+ * @return Lookups per second.
+ */
+static double bench_run(uint32_t devices, uint32_t lookups, uint16_t data_len)
+{
+    scan_dedup_t      dedup;
+    scan_report_hdr_t hdr;
+    uint8_t           data[SCAN_FRAME_MAX_PAYLOAD];
+    uint32_t          capacity = capacity_get(devices);
+    uint32_t        * p_order;
+    uint32_t          dropped  = 0;
+    double            start;
+    double            elapsed;
+
+    dedup.p_entries = malloc(capacity * sizeof(scan_dedup_entry_t));
+    dedup.capacity  = capacity;
+    p_order         = malloc(lookups * sizeof(uint32_t));
+    if ((dedup.p_entries == NULL) || (p_order == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint16_t i = 0; i < data_len; i++)
+    {
+        data[i] = (uint8_t)(i * 31);
+    }
+
+    scan_dedup_init(&dedup, 0, UINT64_MAX);
+    for (uint32_t i = 0; i < devices; i++)
+    {
+        hdr_make(&hdr, i, data_len);
+        scan_dedup_record(&dedup, &hdr, data);
+    }
+
+    srand(devices);
+    for (uint32_t i = 0; i < lookups; i++)
+    {
+        p_order[i] = (uint32_t)rand() % devices;
+    }
+
+    start = now_s();
+    for (uint32_t i = 0; i < lookups; i++)
+    {
+        hdr_make(&hdr, p_order[i], data_len);
+        hdr.timestamp_us = i;
+        dropped += (scan_dedup_check(&dedup, &hdr, data) == SCAN_DEDUP_DUPLICATE);
+    }
+    elapsed = now_s() - start;
+
+    if (dropped != lookups)
+    {
+        fprintf(stderr, "%u devices: %u lookups missed\n", devices, lookups - dropped);
+    }
+
+    free(p_order);
+    free(dedup.p_entries);
+
+    return lookups / elapsed;
+}
+
+
+int main(int argc, char * argv[])
+{
+    uint32_t lookups  = 4000000;
+    uint16_t data_len = 31;
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "n:l:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                lookups = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'l':
+                data_len = (uint16_t)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n lookups] [-l data_len]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((lookups == 0) || (data_len > SCAN_FRAME_MAX_PAYLOAD))
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%8s %10s %14s\n", "devices", "capacity", "lookups/s");
+    for (uint32_t devices = 1024; devices <= 8192; devices *= 2)
+    {
+        printf("%8u %10u %14.0f\n", devices, capacity_get(devices), bench_run(devices, lookups, data_len));
+    }
+
+    return EXIT_SUCCESS;
+}
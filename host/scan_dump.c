@@ -0,0 +1,185 @@
+/***************************************************************************************/
+/*
+ * scan_dump
+ *
+ *  Reads the binary output of the beacon scanner from a serial port (or a capture
+ *  file) and prints every record as text.
+ *
+ *  Usage: scan_dump [-b baudrate] [-B baudrate [-f]] [-m metrics_file] <device | file | ->
+ *         scan_dump -x [-m metrics_file] <text_file>
+ *
+ *  With -B the scanner is found at whatever baud rate it runs and moved to the
+ *  given one (with RTS/CTS flow control if -f is set) before dumping.
+ *
+ *  With -m every statistics record also replaces metrics_file with its content in
+ *  Prometheus text format.
+ *
+ *  With -x the file is a capture of the text output (SCANNER_OUTPUT_FORMAT 0) instead,
+ *  whose reports are printed the same way, with the fields the text lacks left empty.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_decoder.h"
+#include "scan_hexdump.h"
+#include "scan_link.h"
+#include "scan_metrics.h"
+#include "scan_text.h"
+#include "serial_port.h"
+
+
+/**@brief Where the records go. */
+typedef struct
+{
+    scan_text_t  text;                                                  /**< Text output. */
+    char const * p_metrics;                                             /**< Metrics file, or NULL. */
+} dump_ctx_t;
+
+
+/**@brief Function for printing a record, and writing the metrics of a statistics record. */
+static void record_print(scan_record_t const * p_record, void * p_context)
+{
+    dump_ctx_t * p_ctx = p_context;
+
+    scan_text_record_print(&p_ctx->text, p_record);
+
+    if ((p_record->type == SCAN_FRAME_TYPE_STATS) && (p_ctx->p_metrics != NULL))
+    {
+        scan_stats_t stats;
+
+        if ((scan_record_stats_parse(p_record, &stats) == 0) &&
+            (scan_metrics_file_write(p_ctx->p_metrics, &stats) != 0))
+        {
+            fprintf(stderr, "%s: %s\n", p_ctx->p_metrics, strerror(errno));
+        }
+    }
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "Usage: %s [-b baudrate] [-B baudrate [-f]] [-m metrics_file] <device | file | ->\n"
+                    "       %s -x [-m metrics_file] <text_file>\n", p_name, p_name);
+}
+
+
+int main(int argc, char * argv[])
+{
+    scan_decoder_t decoder;
+    dump_ctx_t     ctx = { .p_metrics = NULL };
+    uint32_t       baudrate = 115200;
+    uint32_t       link_baudrate = 0;
+    bool           hwfc = false;
+    bool           text = false;
+    uint8_t        buf[4096];
+    int            opt;
+    int            fd;
+
+    while ((opt = getopt(argc, argv, "b:B:fm:xh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'B':
+                link_baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'f':
+                hwfc = true;
+                break;
+
+            case 'm':
+                ctx.p_metrics = optarg;
+                break;
+
+            case 'x':
+                text = true;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    scan_text_init(&ctx.text, stdout);
+
+    if (text)
+    {
+        scan_hexdump_stats_t stats;
+
+        if (scan_hexdump_file_parse(argv[optind], SCAN_HEXDUMP_KERNEL_AUTO, record_print, &ctx, &stats) != 0)
+        {
+            fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "lines: %llu, reports: %llu, skipped lines: %llu, oversized: %llu\n",
+                (unsigned long long)stats.lines,
+                (unsigned long long)stats.records,
+                (unsigned long long)stats.skipped_lines,
+                (unsigned long long)stats.oversized);
+        return EXIT_SUCCESS;
+    }
+
+    fd = serial_port_open(argv[optind], baudrate, (link_baudrate != 0) ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (link_baudrate != 0)
+    {
+        scan_hello_t hello;
+
+        if (scan_link_negotiate(fd, link_baudrate, hwfc, &hello) != 0)
+        {
+            fprintf(stderr, "%s: cannot switch to %u baud\n", argv[optind], link_baudrate);
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "link: %u baud, hwfc %s\n", hello.baudrate,
+                (hello.flags & SCAN_LINK_FLAG_HWFC) ? "on" : "off");
+    }
+
+    scan_decoder_init(&decoder, record_print, &ctx);
+
+    for (;;)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        scan_decoder_feed(&decoder, buf, (size_t)n);
+        fflush(stdout);
+    }
+
+    scan_decoder_flush(&decoder);
+
+    fprintf(stderr, "frames: %llu, crc errors: %llu, skipped bytes: %llu\n",
+            (unsigned long long)decoder.frames,
+            (unsigned long long)decoder.crc_errors,
+            (unsigned long long)decoder.skipped);
+
+    return EXIT_SUCCESS;
+}
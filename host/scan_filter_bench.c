@@ -0,0 +1,232 @@
+/***************************************************************************************/
+/*
+ * scan_filter_bench
+ *
+ *  Measures the rate at which the report filters (scan_filter) check and reject
+ *  advertising reports, for each kind of filter. The reports are a mix of iBeacons,
+ *  Eddystone-UID frames and other manufacturer data from random addresses, with
+ *  random RSSI, the way a scanner in a busy place hears them. Every set of filters
+ *  keeps only a few of them.
+ *
+ *  Usage: scan_filter_bench [-n reports] [-d devices]
+*/
+/***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_filter.h"
+
+#define DATA_LEN        31                                              /**< Legacy advertising data. */
+#define RULES_MAX       4
+
+/**@brief A simulated report. */
+typedef struct
+{
+    uint8_t addr[6];
+    int8_t  rssi;
+    uint8_t len;
+    uint8_t data[DATA_LEN];
+} report_t;
+
+/**@brief A set of filters measured. */
+typedef struct
+{
+    char const       * p_name;
+    uint8_t            mode;
+    uint8_t            count;
+    scan_filter_rule_t rules[RULES_MAX];
+} bench_set_t;
+
+static bench_set_t const m_sets[] =
+{
+    { "none",           SCAN_FILTER_MODE_ANY, 0, { { 0 } } },
+    { "rssi floor",     SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_RSSI_MIN, .len = 1, .value = { (uint8_t)-55 } } } },
+    { "company id",     SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x82, 0x01 } } } },
+    { "uuid prefix",    SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_UUID_PREFIX, .len = 3, .value = { 0xE2, 0xC5, 0x6D } } } },
+    { "addr prefix",    SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_ADDR_PREFIX, .len = 2, .value = { 0xD0, 0x00 } } } },
+    { "addr range",     SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_ADDR_RANGE, .len = 12,
+          .value = { 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00, 0x07, 0xFF } } } },
+    { "data mask",      SCAN_FILTER_MODE_ANY, 1, {
+        { .type = SCAN_FILTER_DATA, .len = 2, .offset = 7, .value = { 0x02, 0x15 }, .mask = { 0xFF, 0xFF } } } },
+    { "any of 4",       SCAN_FILTER_MODE_ANY, 4, {
+        { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x59, 0x00 } },
+        { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x06, 0x00 } },
+        { .type = SCAN_FILTER_UUID_PREFIX, .len = 2, .value = { 0xFE, 0xAA } },
+        { .type = SCAN_FILTER_ADDR_PREFIX, .len = 1, .value = { 0xD0 } } } },
+    { "all of 3",       SCAN_FILTER_MODE_ALL, 3, {
+        { .type = SCAN_FILTER_RSSI_MIN, .len = 1, .value = { (uint8_t)-80 } },
+        { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x4C, 0x00 } },
+        { .type = SCAN_FILTER_UUID_PREFIX, .len = 3, .value = { 0xE2, 0xC5, 0x6D } } } },
+};
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/**@brief Function for making the advertising data of a device: flags, then a beacon or other data. */
+static void report_make(report_t * p_report, uint32_t device)
+{
+    static uint8_t const ibeacon[] = { 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5, 0x6D, 0xB5 };
+    static uint8_t const eddystone[] = { 0x03, 0x03, 0xAA, 0xFE, 0x15, 0x16, 0xAA, 0xFE, 0x00, 0xE7 };
+    uint8_t            * p_data = p_report->data;
+
+    memset(p_report, 0, sizeof(*p_report));
+    p_report->addr[5] = (device % 8 == 0) ? 0xD0 : 0xC0;
+    memcpy(p_report->addr, &device, 3);
+    p_report->rssi = (int8_t)(-40 - rand() % 60);
+    p_report->len  = DATA_LEN;
+
+    for (uint8_t i = 0; i < DATA_LEN; i++)
+    {
+        p_data[i] = (uint8_t)rand();
+    }
+
+    p_data[0] = 0x02;
+    p_data[1] = 0x01;
+    p_data[2] = 0x06;
+    switch (device % 4)
+    {
+        case 0:
+            memcpy(&p_data[3], ibeacon, sizeof(ibeacon));
+            p_report->len = 30;
+            break;
+
+        case 1:
+            memcpy(&p_data[3], eddystone, sizeof(eddystone));
+            p_report->len = 25;
+            break;
+
+        default:
+            // Manufacturer data of an unknown company.
+            p_data[3] = DATA_LEN - 4;
+            p_data[4] = 0xFF;
+            p_data[5] = (uint8_t)(0x80 + device % 16);
+            p_data[6] = 0x01;
+            break;
+    }
+}
+
+
+/**@brief Function for measuring a set of filters.
+ *
+ * @param[out]  p_rejected  Reports rejected.
+ *
+ * @return Checks per second.
+ */
+static double bench_run(bench_set_t const * p_set, report_t const * p_reports,
+                        uint32_t const * p_order, uint32_t count, uint32_t * p_rejected)
+{
+    SCAN_FILTER_DEF(filter, SCAN_FILTER_COUNT_MAX);
+    scan_filter_report_t report = { .set_id = SCAN_REPORT_SET_ID_INVALID };
+    uint32_t             rejected;
+    double               start;
+
+    (void)scan_filter_clear(&filter, p_set->mode);
+    for (uint8_t i = 0; i < p_set->count; i++)
+    {
+        if (!scan_filter_add(&filter, &p_set->rules[i]))
+        {
+            fprintf(stderr, "%s: filter %u refused\n", p_set->p_name, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    rejected = filter.rejected;
+    start    = now_s();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        report_t const * p_report = &p_reports[p_order[i]];
+
+        report.p_addr = p_report->addr;
+        report.p_data = p_report->data;
+        report.len    = p_report->len;
+        report.rssi   = p_report->rssi;
+        (void)scan_filter_check(&filter, &report);
+    }
+    start       = now_s() - start;
+    *p_rejected = filter.rejected - rejected;
+
+    return count / start;
+}
+
+
+int main(int argc, char * argv[])
+{
+    uint32_t   count   = 10000000;
+    uint32_t   devices = 4096;
+    report_t * p_reports;
+    uint32_t * p_order;
+    int        opt;
+
+    while ((opt = getopt(argc, argv, "n:d:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'd':
+                devices = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n reports] [-d devices]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((count == 0) || (devices == 0))
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    p_reports = malloc(devices * sizeof(report_t));
+    p_order   = malloc(count * sizeof(uint32_t));
+    if ((p_reports == NULL) || (p_order == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    for (uint32_t i = 0; i < devices; i++)
+    {
+        report_make(&p_reports[i], i);
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        p_order[i] = (uint32_t)rand() % devices;
+    }
+
+    printf("%-14s %14s %14s %9s\n", "filters", "reports/s", "rejected/s", "rejected");
+    for (size_t i = 0; i < sizeof(m_sets) / sizeof(m_sets[0]); i++)
+    {
+        uint32_t rejected;
+        double   rate = bench_run(&m_sets[i], p_reports, p_order, count, &rejected);
+
+        printf("%-14s %14.0f %14.0f %8.1f%%\n", m_sets[i].p_name, rate,
+               rate * rejected / count, 100.0 * rejected / count);
+    }
+
+    free(p_order);
+    free(p_reports);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,455 @@
+/***************************************************************************************/
+/*
+ * scan_hexdump
+ *
+ *  Parser of the text captures.
+ *
+ *  A line of a hexdump is LINE_BYTES groups of three characters, " xx" for a byte
+ *  or "   " past the end of the data, then '|' and the bytes as characters. The
+ *  vector kernels take the 32 first characters of a full line at once: they check
+ *  the spaces and the digits with masks and put the nibbles together. Whatever they
+ *  do not recognize goes through the scalar code, which has the last word.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scan_hexdump.h"
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <immintrin.h>
+#define HEXDUMP_SSE2        1
+#else
+#define HEXDUMP_SSE2        0
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HEXDUMP_AVX2        1
+#else
+#define HEXDUMP_AVX2        0
+#endif
+
+#define LINE_BYTES          8                                           /**< Bytes per line, NRF_LOG_HEXDUMP_BYTES_IN_LINE of the SDK. */
+#define LINE_BAR            (LINE_BYTES * 3)                            /**< Position of the '|' after the bytes. */
+#define LINE_FULL_LEN       (LINE_BAR + 1 + LINE_BYTES)                 /**< Length of a full line, without its end. */
+#define LINE_VECTOR_LEN     32                                          /**< Characters the vector kernels read. */
+#define LINE_HEX_MASK       0x00DB6DB6u                                 /**< Digits among the 32 first characters of a full line. */
+#define LINE_SPACE_MASK     0x00249249u                                 /**< Spaces among the 32 first characters of a full line. */
+
+#define SEPARATOR           "----------------------------------"
+
+/**@brief Kernel decoding the bytes of a full line.
+ *
+ * @return LINE_BYTES, or -1 if the line is not a full line of a hexdump.
+ */
+typedef int (*line_kernel_t)(char const * p_line, uint8_t * p_out);
+
+
+static int hex_value(uint8_t c)
+{
+    if ((unsigned)(c - '0') < 10)
+    {
+        return c - '0';
+    }
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6)
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+
+/**@brief Function for decoding the bytes of any line of a hexdump.
+ *
+ * @return Bytes decoded, 1 to LINE_BYTES, or -1 if the line is not part of a hexdump.
+ */
+static int line_decode_scalar(char const * p_line, size_t len, uint8_t * p_out)
+{
+    int count = 0;
+
+    if ((len <= LINE_BAR) || (p_line[LINE_BAR] != '|'))
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < LINE_BYTES; i++)
+    {
+        char const * p = &p_line[i * 3];
+
+        if (count == i)
+        {
+            int hi = hex_value((uint8_t)p[1]);
+            int lo = hex_value((uint8_t)p[2]);
+
+            if ((p[0] == ' ') && (hi >= 0) && (lo >= 0))
+            {
+                p_out[count++] = (uint8_t)((hi << 4) | lo);
+                continue;
+            }
+        }
+        // Past the data, the group is blank.
+        if ((p[0] != ' ') || (p[1] != ' ') || (p[2] != ' '))
+        {
+            return -1;
+        }
+    }
+
+    return (count > 0) ? count : -1;
+}
+
+
+static inline int line_kernel_scalar(char const * p_line, uint8_t * p_out)
+{
+    return (line_decode_scalar(p_line, LINE_VECTOR_LEN, p_out) == LINE_BYTES) ? LINE_BYTES : -1;
+}
+
+
+#if HEXDUMP_SSE2
+/**@brief Function for turning hexadecimal digits into their values.
+ *
+ * @param[in]   c           Characters.
+ * @param[out]  p_valid     Mask of the characters that are digits.
+ */
+static inline __m128i nibbles_sse2(__m128i c, uint32_t * p_valid)
+{
+    __m128i digit    = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i letter   = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)),
+                                     _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8(-1)),
+                                     _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+
+    *p_valid = (uint32_t)_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_alpha, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+
+/**@brief SSE2 kernel: the checks and the nibbles in vectors, the bytes picked one by one. */
+static inline int line_kernel_sse2(char const * p_line, uint8_t * p_out)
+{
+    __m128i  c0 = _mm_loadu_si128((__m128i const *)p_line);
+    __m128i  c1 = _mm_loadu_si128((__m128i const *)&p_line[16]);
+    uint8_t  pairs[LINE_VECTOR_LEN];
+    uint32_t valid0;
+    uint32_t valid1;
+    uint32_t space;
+    __m128i  n0 = nibbles_sse2(c0, &valid0);
+    __m128i  n1 = nibbles_sse2(c1, &valid1);
+
+    space = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c0, _mm_set1_epi8(' '))) |
+            ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c1, _mm_set1_epi8(' '))) << 16);
+    if ((((valid0 | (valid1 << 16)) & LINE_HEX_MASK) != LINE_HEX_MASK) ||
+        ((space & LINE_SPACE_MASK) != LINE_SPACE_MASK) || (p_line[LINE_BAR] != '|'))
+    {
+        return -1;
+    }
+
+    // Each character holds its nibble in the high half and the next one in the low half.
+    _mm_storeu_si128((__m128i *)pairs,
+                     _mm_or_si128(_mm_slli_epi16(n0, 4),
+                                  _mm_or_si128(_mm_srli_si128(n0, 1), _mm_slli_si128(n1, 15))));
+    _mm_storeu_si128((__m128i *)&pairs[16], _mm_or_si128(_mm_slli_epi16(n1, 4), _mm_srli_si128(n1, 1)));
+    for (int i = 0; i < LINE_BYTES; i++)
+    {
+        p_out[i] = pairs[i * 3 + 1];
+    }
+
+    return LINE_BYTES;
+}
+#endif // HEXDUMP_SSE2
+
+
+#if HEXDUMP_AVX2
+/**@brief AVX2 kernel: the bytes are also gathered with shuffles, one per lane. */
+__attribute__((target("avx2")))
+static inline int line_kernel_avx2(char const * p_line, uint8_t * p_out)
+{
+    // Digits of each byte, in order: bytes 0 to 4 in the low lane, 5 to 7 in the high one.
+    __m256i const hi_index  = _mm256_setr_epi8( 1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               -1, -1, -1, -1, -1,  0,  3,  6, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i const lo_index  = _mm256_setr_epi8( 2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               -1, -1, -1, -1, -1,  1,  4,  7, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i       c         = _mm256_loadu_si256((__m256i const *)p_line);
+    __m256i       digit     = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i       letter    = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i       is_digit  = _mm256_and_si256(_mm256_cmpgt_epi8(digit, _mm256_set1_epi8(-1)),
+                                               _mm256_cmpgt_epi8(_mm256_set1_epi8(10), digit));
+    __m256i       is_alpha  = _mm256_and_si256(_mm256_cmpgt_epi8(letter, _mm256_set1_epi8(-1)),
+                                               _mm256_cmpgt_epi8(_mm256_set1_epi8(6), letter));
+    __m256i       nibbles   = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                                              _mm256_and_si256(is_alpha, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+    uint32_t      valid     = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha));
+    uint32_t      space     = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')));
+    __m256i       bytes;
+
+    if (((valid & LINE_HEX_MASK) != LINE_HEX_MASK) || ((space & LINE_SPACE_MASK) != LINE_SPACE_MASK) ||
+        (p_line[LINE_BAR] != '|'))
+    {
+        return -1;
+    }
+
+    bytes = _mm256_or_si256(_mm256_slli_epi16(_mm256_shuffle_epi8(nibbles, hi_index), 4),
+                            _mm256_shuffle_epi8(nibbles, lo_index));
+    _mm_storel_epi64((__m128i *)p_out, _mm_or_si128(_mm256_castsi256_si128(bytes),
+                                                    _mm256_extracti128_si256(bytes, 1)));
+
+    return LINE_BYTES;
+}
+#endif // HEXDUMP_AVX2
+
+
+int scan_hexdump_kernel_supported(scan_hexdump_kernel_t kernel)
+{
+    switch (kernel)
+    {
+        case SCAN_HEXDUMP_KERNEL_AUTO:
+        case SCAN_HEXDUMP_KERNEL_SCALAR:
+            return 1;
+
+        case SCAN_HEXDUMP_KERNEL_SSE2:
+            return HEXDUMP_SSE2;
+
+        case SCAN_HEXDUMP_KERNEL_AVX2:
+#if HEXDUMP_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return 0;
+#endif
+
+        default:
+            return 0;
+    }
+}
+
+
+/**@brief Parser state. */
+typedef struct
+{
+    scan_decoder_handler_t handler;
+    void                 * p_context;
+    scan_hexdump_stats_t   stats;
+    size_t                 data_len;
+    uint64_t               data_lines;                                  /**< Lines of the hexdump being read. */
+    uint8_t                overflow[LINE_BYTES];                        /**< Bytes of the lines past the longest data. */
+    uint8_t                payload[sizeof(scan_report_hdr_t) + SCAN_HEXDUMP_DATA_MAX + LINE_BYTES];
+} parser_t;
+
+
+/**@brief Function for telling whether 8 characters hold a line feed. */
+static inline int newline_find(char const * p)
+{
+    uint64_t x;
+
+    memcpy(&x, p, sizeof(x));
+    x ^= 0x0A0A0A0A0A0A0A0Aull;
+
+    return ((x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull) != 0;
+}
+
+
+/**@brief Function for handling a line that is not part of a hexdump. */
+static void line_other(parser_t * p_parser, char const * p_line, size_t line_len)
+{
+    if ((line_len == sizeof(SEPARATOR) - 1) && (memcmp(p_line, SEPARATOR, line_len) == 0))
+    {
+        if (p_parser->data_len > SCAN_HEXDUMP_DATA_MAX)
+        {
+            p_parser->stats.oversized++;
+        }
+        else
+        {
+            scan_report_hdr_t hdr    = { .tx_power = SCAN_REPORT_TX_POWER_INVALID,
+                                         .set_id   = SCAN_REPORT_SET_ID_INVALID,
+                                         .data_len = (uint16_t)p_parser->data_len };
+            scan_record_t     record = { .type      = SCAN_FRAME_TYPE_ADV_REPORT,
+                                         .len       = (uint16_t)(sizeof(hdr) + p_parser->data_len),
+                                         .p_payload = p_parser->payload };
+
+            memcpy(p_parser->payload, &hdr, sizeof(hdr));
+            p_parser->handler(&record, p_parser->p_context);
+            p_parser->stats.records++;
+        }
+    }
+    else
+    {
+        // The hexdump read so far was not a report.
+        p_parser->stats.skipped_lines += p_parser->data_lines + 1;
+    }
+    p_parser->data_len   = 0;
+    p_parser->data_lines = 0;
+}
+
+
+/**@brief Function for parsing text with a given kernel, inlined in each of its callers.
+ *
+ * @details Most lines are full lines of a hexdump: when the line has the length of one,
+ *          the kernel is tried before looking for its end.
+ */
+static inline __attribute__((always_inline))
+void parse_run(parser_t * p_parser, char const * p_text, size_t len, line_kernel_t line_kernel)
+{
+    char const * p_end = p_text + len;
+
+    while (p_text < p_end)
+    {
+        char const * p_eol;
+        char const * p_line = p_text;
+        size_t       line_len;
+        int          count  = -1;
+        uint8_t    * p_out  = (p_parser->data_len <= SCAN_HEXDUMP_DATA_MAX) ?
+                              &p_parser->payload[sizeof(scan_report_hdr_t) + p_parser->data_len] :
+                              p_parser->overflow;
+
+        p_parser->stats.lines++;
+
+        if ((p_line[0] == ' ') && (p_end - p_line >= LINE_FULL_LEN + 2) &&
+            ((p_line[LINE_FULL_LEN] == '\n') || ((p_line[LINE_FULL_LEN] == '\r') && (p_line[LINE_FULL_LEN + 1] == '\n'))) &&
+            !newline_find(&p_line[LINE_BAR + 1]) &&
+            (line_kernel(p_line, p_out) == LINE_BYTES))
+        {
+            p_parser->data_len += LINE_BYTES;
+            p_parser->data_lines++;
+            p_text = &p_line[LINE_FULL_LEN + ((p_line[LINE_FULL_LEN] == '\r') ? 2 : 1)];
+            continue;
+        }
+
+        p_eol    = memchr(p_line, '\n', (size_t)(p_end - p_line));
+        p_eol    = (p_eol != NULL) ? p_eol : p_end;
+        line_len = (size_t)(p_eol - p_line);
+        p_text   = p_eol + 1;
+        if ((line_len > 0) && (p_line[line_len - 1] == '\r'))
+        {
+            line_len--;
+        }
+
+        if (p_line[0] == ' ')
+        {
+            count = line_decode_scalar(p_line, line_len, p_out);
+        }
+        if (count > 0)
+        {
+            p_parser->data_len += (size_t)count;
+            p_parser->data_lines++;
+        }
+        else
+        {
+            line_other(p_parser, p_line, line_len);
+        }
+    }
+}
+
+
+static void parse_scalar(parser_t * p_parser, char const * p_text, size_t len)
+{
+    parse_run(p_parser, p_text, len, line_kernel_scalar);
+}
+
+
+#if HEXDUMP_SSE2
+static void parse_sse2(parser_t * p_parser, char const * p_text, size_t len)
+{
+    parse_run(p_parser, p_text, len, line_kernel_sse2);
+}
+#endif
+
+
+#if HEXDUMP_AVX2
+__attribute__((target("avx2")))
+static void parse_avx2(parser_t * p_parser, char const * p_text, size_t len)
+{
+    parse_run(p_parser, p_text, len, line_kernel_avx2);
+}
+#endif
+
+
+void scan_hexdump_parse(char const           * p_text,
+                        size_t                 len,
+                        scan_hexdump_kernel_t  kernel,
+                        scan_decoder_handler_t handler,
+                        void                 * p_context,
+                        scan_hexdump_stats_t * p_stats)
+{
+    parser_t parser = { .handler = handler, .p_context = p_context };
+
+    if (kernel == SCAN_HEXDUMP_KERNEL_AUTO)
+    {
+        kernel = scan_hexdump_kernel_supported(SCAN_HEXDUMP_KERNEL_AVX2) ? SCAN_HEXDUMP_KERNEL_AVX2 :
+                 scan_hexdump_kernel_supported(SCAN_HEXDUMP_KERNEL_SSE2) ? SCAN_HEXDUMP_KERNEL_SSE2 :
+                                                                           SCAN_HEXDUMP_KERNEL_SCALAR;
+    }
+
+    switch (kernel)
+    {
+#if HEXDUMP_SSE2
+        case SCAN_HEXDUMP_KERNEL_SSE2:
+            parse_sse2(&parser, p_text, len);
+            break;
+#endif
+#if HEXDUMP_AVX2
+        case SCAN_HEXDUMP_KERNEL_AVX2:
+            parse_avx2(&parser, p_text, len);
+            break;
+#endif
+        default:
+            parse_scalar(&parser, p_text, len);
+            break;
+    }
+
+    if (p_stats != NULL)
+    {
+        *p_stats = parser.stats;
+    }
+}
+
+
+int scan_hexdump_file_parse(char const           * p_path,
+                            scan_hexdump_kernel_t  kernel,
+                            scan_decoder_handler_t handler,
+                            void                 * p_context,
+                            scan_hexdump_stats_t * p_stats)
+{
+    struct stat st;
+    void      * p_map;
+    int         fd = open(p_path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0)
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        scan_hexdump_parse(NULL, 0, kernel, handler, p_context, p_stats);
+        return 0;
+    }
+
+    p_map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_map == MAP_FAILED)
+    {
+        return -1;
+    }
+    (void)madvise(p_map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    scan_hexdump_parse(p_map, (size_t)st.st_size, kernel, handler, p_context, p_stats);
+
+    munmap(p_map, (size_t)st.st_size);
+
+    return 0;
+}
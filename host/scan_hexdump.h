@@ -0,0 +1,104 @@
+/***************************************************************************************/
+/*
+ * scan_hexdump
+ *
+ *  Parser of the text output of the scanner (SCANNER_OUTPUT_FORMAT 0), the format of
+ *  the older captures: the advertising data of each report as printed by
+ *  NRF_LOG_RAW_HEXDUMP_INFO, eight bytes per line, closed by a line of dashes.
+ *
+ *       02 01 06 1a ff 4c 00 02|.....L..
+ *       15 e2 c5 6d b5 df fb 48|...m...H
+ *      ----------------------------------
+ *
+ *  Every report is handed over as the record the binary decoder gives for it, so
+ *  the same code handles both kinds of capture. The text has the advertising data
+ *  only: the header of the record carries data_len, and otherwise the values of a
+ *  field that is missing (0, SCAN_REPORT_TX_POWER_INVALID, SCAN_REPORT_SET_ID_INVALID).
+ *
+ *  Hexdumps followed by something else than the separator (the address of an ALIVE
+ *  or RSSI summary line) and the other log lines are skipped.
+ *
+ *  Full lines are decoded with SSE2 or AVX2 on x86-64, picked at run time; other
+ *  lines and other processors use the scalar code.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_HEXDUMP_H__
+#define SCAN_HEXDUMP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scan_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_HEXDUMP_DATA_MAX   (SCAN_FRAME_MAX_PAYLOAD - sizeof(scan_report_hdr_t))    /**< Longest advertising data of a report. */
+
+/**@brief Code decoding the hexadecimal bytes of the lines. */
+typedef enum
+{
+    SCAN_HEXDUMP_KERNEL_AUTO,                                           /**< The fastest the processor has. */
+    SCAN_HEXDUMP_KERNEL_SCALAR,
+    SCAN_HEXDUMP_KERNEL_SSE2,
+    SCAN_HEXDUMP_KERNEL_AVX2,
+} scan_hexdump_kernel_t;
+
+/**@brief Parser counters. */
+typedef struct
+{
+    uint64_t lines;                                                     /**< Lines read. */
+    uint64_t records;                                                   /**< Reports handed over. */
+    uint64_t skipped_lines;                                             /**< Lines that are neither part of a report nor a separator. */
+    uint64_t oversized;                                                 /**< Reports dropped for having more than @ref SCAN_HEXDUMP_DATA_MAX bytes. */
+} scan_hexdump_stats_t;
+
+
+/**@brief Function for telling whether a kernel can run on this processor.
+ *
+ * @param[in]   kernel      Kernel, @ref SCAN_HEXDUMP_KERNEL_AUTO always can.
+ */
+int scan_hexdump_kernel_supported(scan_hexdump_kernel_t kernel);
+
+
+/**@brief Function for parsing a text capture held in memory.
+ *
+ * @details A report not closed by its separator at the end of the buffer is dropped.
+ *
+ * @param[in]   p_text      Text.
+ * @param[in]   len         Length of the text.
+ * @param[in]   kernel      Kernel to use, it must be supported.
+ * @param[in]   handler     Called for every report, in order.
+ * @param[in]   p_context   Passed to @p handler.
+ * @param[out]  p_stats     Counters. Can be NULL.
+ */
+void scan_hexdump_parse(char const           * p_text,
+                        size_t                 len,
+                        scan_hexdump_kernel_t  kernel,
+                        scan_decoder_handler_t handler,
+                        void                 * p_context,
+                        scan_hexdump_stats_t * p_stats);
+
+
+/**@brief Function for parsing a text capture file, mapped in memory.
+ *
+ * @param[in]   p_path      File.
+ * @param[in]   kernel      Kernel to use, it must be supported.
+ * @param[in]   handler     Called for every report, in order.
+ * @param[in]   p_context   Passed to @p handler.
+ * @param[out]  p_stats     Counters. Can be NULL.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_hexdump_file_parse(char const           * p_path,
+                            scan_hexdump_kernel_t  kernel,
+                            scan_decoder_handler_t handler,
+                            void                 * p_context,
+                            scan_hexdump_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_HEXDUMP_H__
@@ -0,0 +1,300 @@
+/***************************************************************************************/
+/*
+ * scan_hexdump_bench
+ *
+ *  Measures the rate at which the text captures are parsed (scan_hexdump), with each
+ *  kernel, against the obvious way of doing it: a line at a time, and sscanf for the
+ *  bytes. The capture is made in memory, the way the scanner prints it: reports of
+ *  3 to 31 bytes, with an ALIVE line now and then. Every parser must find the same
+ *  reports with the same data.
+ *
+ *  The file parser is measured as well, on the capture written to a temporary file
+ *  (read from the page cache).
+ *
+ *  Usage: scan_hexdump_bench [-m megabytes] [-t directory]
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_hexdump.h"
+
+#define LINE_BYTES      8
+#define SEPARATOR       "----------------------------------\r\n"
+
+/**@brief What a parser found, to compare the parsers. */
+typedef struct
+{
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t sum;                                                       /**< Sum of the data bytes weighted by their position. */
+} result_t;
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/**@brief Function for adding the data of a report to the result. */
+static void data_add(result_t * p_result, uint8_t const * p_data, size_t len)
+{
+    p_result->records++;
+    p_result->bytes += len;
+    for (size_t i = 0; i < len; i++)
+    {
+        p_result->sum += (uint64_t)p_data[i] * (i + 1);
+    }
+}
+
+
+static void record_add(scan_record_t const * p_record, void * p_context)
+{
+    data_add(p_context, &p_record->p_payload[sizeof(scan_report_hdr_t)], p_record->len - sizeof(scan_report_hdr_t));
+}
+
+
+/**@brief Function for printing a hexdump the way the scanner does (see sim_sdk.c).
+ *
+ * @return Length of the text.
+ */
+static size_t hexdump_print(uint8_t const * p_data, size_t len, char * p_text)
+{
+    char * p = p_text;
+
+    for (size_t line = 0; line < len; line += LINE_BYTES)
+    {
+        size_t count = (len - line < LINE_BYTES) ? len - line : LINE_BYTES;
+
+        for (size_t i = 0; i < LINE_BYTES; i++)
+        {
+            p += (i < count) ? sprintf(p, " %02x", p_data[line + i]) : sprintf(p, "   ");
+        }
+        *p++ = '|';
+        for (size_t i = 0; i < count; i++)
+        {
+            char c = (char)p_data[line + i];
+
+            *p++ = ((c <= ' ') || (c > '~')) ? '.' : c;
+        }
+        *p++ = '\r';
+        *p++ = '\n';
+    }
+
+    return (size_t)(p - p_text);
+}
+
+
+/**@brief Function for making a capture of at least @p size bytes.
+ *
+ * @return The capture, its length in @p p_len.
+ */
+static char * capture_make(size_t size, size_t * p_len, result_t * p_expected)
+{
+    char   * p_text = malloc(size + 4096);
+    size_t   len    = 0;
+    uint32_t seed   = 1;
+
+    if (p_text == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (len < size)
+    {
+        uint8_t data[31];
+        size_t  data_len;
+
+        seed     = seed * 1103515245 + 12345;
+        data_len = 3 + (seed >> 16) % 29;
+        for (size_t i = 0; i < data_len; i++)
+        {
+            seed    = seed * 1103515245 + 12345;
+            data[i] = (uint8_t)(seed >> 24);
+        }
+
+        len += hexdump_print(data, data_len, &p_text[len]);
+        if ((seed & 0x0F) == 0)
+        {
+            // The address of an ALIVE record, which is not a report.
+            len += (size_t)sprintf(&p_text[len], "alive -60 dBm, 3 duplicates\r\n");
+        }
+        else
+        {
+            memcpy(&p_text[len], SEPARATOR, sizeof(SEPARATOR) - 1);
+            len += sizeof(SEPARATOR) - 1;
+            data_add(p_expected, data, data_len);
+        }
+    }
+
+    *p_len = len;
+
+    return p_text;
+}
+
+
+/**@brief The baseline: each line copied out and read with sscanf. */
+static void sscanf_parse(char const * p_text, size_t len, result_t * p_result)
+{
+    char const * p_end = p_text + len;
+    uint8_t      data[256];
+    size_t       data_len = 0;
+
+    while (p_text < p_end)
+    {
+        char         line[128];
+        char const * p_eol = memchr(p_text, '\n', (size_t)(p_end - p_text));
+        size_t       line_len;
+        uint8_t      b[LINE_BYTES];
+        char         bar;
+        int          n;
+
+        p_eol    = (p_eol != NULL) ? p_eol + 1 : p_end;
+        line_len = (size_t)(p_eol - p_text);
+        line_len = (line_len < sizeof(line) - 1) ? line_len : sizeof(line) - 1;
+        memcpy(line, p_text, line_len);
+        line[line_len] = '\0';
+        p_text = p_eol;
+
+        if (strcmp(line, SEPARATOR) == 0)
+        {
+            data_add(p_result, data, data_len);
+            data_len = 0;
+            continue;
+        }
+
+        n = sscanf(line, " %2hhx %2hhx %2hhx %2hhx %2hhx %2hhx %2hhx %2hhx",
+                   &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7]);
+        if ((n > 0) && (sscanf(&line[LINE_BYTES * 3], "%c", &bar) == 1) && (bar == '|') &&
+            (data_len + (size_t)n <= sizeof(data)))
+        {
+            memcpy(&data[data_len], b, (size_t)n);
+            data_len += (size_t)n;
+        }
+        else
+        {
+            data_len = 0;
+        }
+    }
+}
+
+
+/**@brief Function for printing the rate of a parser and checking what it found.
+ *
+ * @return 0 if it found the expected reports.
+ */
+static int result_print(char const * p_name, size_t len, double elapsed, double baseline,
+                        result_t const * p_result, result_t const * p_expected)
+{
+    int ok = (p_result->records == p_expected->records) && (p_result->bytes == p_expected->bytes) &&
+             (p_result->sum == p_expected->sum);
+
+    printf("%-10s %8.3f %14.0f %8.1fx   %s\n", p_name, (double)len / elapsed / 1e9,
+           (double)p_result->records / elapsed, (baseline > 0) ? baseline / elapsed : 1.0,
+           ok ? "ok" : "MISMATCH");
+
+    return ok ? 0 : -1;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static struct
+    {
+        char const          * p_name;
+        scan_hexdump_kernel_t kernel;
+    } const kernels[] =
+    {
+        { "scalar", SCAN_HEXDUMP_KERNEL_SCALAR },
+        { "sse2",   SCAN_HEXDUMP_KERNEL_SSE2   },
+        { "avx2",   SCAN_HEXDUMP_KERNEL_AVX2   },
+    };
+    result_t     expected = { 0 };
+    result_t     result   = { 0 };
+    uint32_t     megabytes = 256;
+    char const * p_dir = "/tmp";
+    char         path[256];
+    char       * p_text;
+    size_t       len;
+    double       start;
+    double       baseline;
+    int          failed = 0;
+    int          opt;
+    FILE       * p_file;
+
+    while ((opt = getopt(argc, argv, "m:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                megabytes = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 't':
+                p_dir = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-m megabytes] [-t directory]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    p_text = capture_make((size_t)megabytes * 1000000, &len, &expected);
+    printf("%.0f MB, %llu reports\n\n", (double)len / 1e6, (unsigned long long)expected.records);
+    printf("%-10s %8s %14s %9s\n", "parser", "GB/s", "reports/s", "speedup");
+
+    start = now_s();
+    sscanf_parse(p_text, len, &result);
+    baseline = now_s() - start;
+    failed |= result_print("sscanf", len, baseline, 0, &result, &expected);
+
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+    {
+        if (!scan_hexdump_kernel_supported(kernels[i].kernel))
+        {
+            printf("%-10s %8s\n", kernels[i].p_name, "-");
+            continue;
+        }
+        memset(&result, 0, sizeof(result));
+        start = now_s();
+        scan_hexdump_parse(p_text, len, kernels[i].kernel, record_add, &result, NULL);
+        failed |= result_print(kernels[i].p_name, len, now_s() - start, baseline, &result, &expected);
+    }
+
+    // The same through the file parser, once the file is in the page cache.
+    snprintf(path, sizeof(path), "%s/scan_hexdump_bench.txt", p_dir);
+    p_file = fopen(path, "wb");
+    if ((p_file == NULL) || (fwrite(p_text, 1, len, p_file) != len) || (fclose(p_file) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memset(&result, 0, sizeof(result));
+    (void)scan_hexdump_file_parse(path, SCAN_HEXDUMP_KERNEL_AUTO, record_add, &result, NULL);
+    memset(&result, 0, sizeof(result));
+    start = now_s();
+    if (scan_hexdump_file_parse(path, SCAN_HEXDUMP_KERNEL_AUTO, record_add, &result, NULL) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        failed = -1;
+    }
+    else
+    {
+        failed |= result_print("mmap", len, now_s() - start, baseline, &result, &expected);
+    }
+    unlink(path);
+    free(p_text);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
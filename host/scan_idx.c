@@ -0,0 +1,1493 @@
+/***************************************************************************************/
+/*
+ * scan_idx
+ *
+ *  Index of a binary capture.
+ *
+ *  An update walks the frames appended to the capture (CRC checked), up to
+ *  @ref SCAN_IDX_SEGMENT_BYTES at a time. The records of a segment get an address
+ *  number from a hash table as they are found; once the segment is complete, the
+ *  addresses are sorted and the offsets of the records are scattered to where the
+ *  postings of their address start, which keeps them in the order of the capture.
+ *
+ *  The index is only ever appended to, but for its header: segments, then the
+ *  directory of the segments in use, then the header pointing to that directory.
+ *  When there are too many segments, the newest ones (and the older ones that are
+ *  not larger than them) are merged into a new segment appended to the index. Once
+ *  the segments no longer in use take more room than the others, the index is
+ *  copied to a new file.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scan_idx.h"
+
+#define OUT_BUF_SIZE        (1u << 20)
+#define KEY_LEN             (sizeof(uint64_t) + 6)                      /**< Time and address, at the start of the indexed records. */
+#define MERGE_KEEP          (SCAN_IDX_SEGMENTS_MAX / 2)                 /**< Segments left after a merge, at least. */
+#define PREFETCH_POSTINGS   1024                                        /**< Frames of a lookup asked from the disk ahead of reading them. */
+#define PREFETCH_LEN        256                                         /**< Bytes asked for each of them, enough for most frames. */
+
+/**@brief Buffered writer at the end of the index. */
+typedef struct
+{
+    int      fd;
+    uint64_t offset;                                                    /**< Offset of the first byte of the buffer. */
+    size_t   len;                                                       /**< Bytes in the buffer. */
+    uint8_t  buf[OUT_BUF_SIZE];
+} out_t;
+
+/**@brief A segment being built. */
+typedef struct
+{
+    uint64_t        * p_offsets;                                        /**< Offset of each record. */
+    size_t            offsets_size;
+    uint32_t        * p_ids;                                            /**< Address number of each record. */
+    size_t            ids_size;
+    size_t            records;
+    scan_idx_addr_t * p_addrs;                                          /**< Addresses by number; reserved holds the number once sorted. */
+    uint32_t          addresses;
+    uint32_t          addresses_size;
+    uint32_t        * p_table;                                          /**< Address number + 1 of each slot, 0 for none. */
+    uint32_t          table_mask;
+    scan_idx_time_t * p_times;
+    uint32_t          times;
+    uint32_t          times_size;
+    uint64_t          t_latest;                                         /**< Latest time seen. */
+    uint64_t          t_min;
+} builder_t;
+
+/**@brief An update in progress. */
+typedef struct
+{
+    char               * p_path;                                        /**< Index. */
+    int                  fd;
+    scan_idx_hdr_t       hdr;
+    scan_idx_segment_t * p_segments;                                    /**< Segments in use. */
+    uint32_t             segments_size;
+    out_t              * p_out;
+} update_t;
+
+struct scan_idx_s
+{
+    uint8_t const            * p_index;
+    size_t                     index_len;
+    uint8_t const            * p_capture;
+    size_t                     capture_len;                             /**< Bytes mapped, the ones indexed. */
+    scan_idx_hdr_t const     * p_hdr;
+    scan_idx_segment_t const * p_segments;
+};
+
+
+/**@brief Function for making the path of the index of a capture.
+ *
+ * @return The path, to be freed, or NULL if out of memory.
+ */
+static char * index_path(char const * p_capture, char const * p_suffix)
+{
+    size_t len    = strlen(p_capture) + strlen(p_suffix) + 1;
+    char * p_path = malloc(len);
+
+    if (p_path == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    snprintf(p_path, len, "%s%s", p_capture, p_suffix);
+
+    return p_path;
+}
+
+
+/**@brief Function for writing the whole of a buffer at an offset.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int write_at(int fd, void const * p_buf, size_t len, uint64_t offset)
+{
+    uint8_t const * p = p_buf;
+
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p      += n;
+        len    -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for reading the whole of a range of a file.
+ *
+ * @return 0 on success, -1 on error or if the file ends first.
+ */
+static int read_at(int fd, void * p_buf, size_t len, uint64_t offset)
+{
+    uint8_t * p = p_buf;
+
+    while (len > 0)
+    {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        p      += n;
+        len    -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for mapping a whole file, read only.
+ *
+ * @return 0 on success, -1 on error. An empty file is mapped to NULL.
+ */
+static int file_map(int fd, uint64_t len, uint8_t const ** pp_data)
+{
+    void * p_data;
+
+    *pp_data = NULL;
+    if (len == 0)
+    {
+        return 0;
+    }
+    p_data = mmap(NULL, (size_t)len, PROT_READ, MAP_SHARED, fd, 0);
+    if (p_data == MAP_FAILED)
+    {
+        return -1;
+    }
+    *pp_data = p_data;
+
+    return 0;
+}
+
+
+static void file_unmap(uint8_t const * p_data, uint64_t len)
+{
+    if (p_data != NULL)
+    {
+        munmap((void *)p_data, (size_t)len);
+    }
+}
+
+
+static uint64_t out_pos(out_t const * p_out)
+{
+    return p_out->offset + p_out->len;
+}
+
+
+static int out_flush(out_t * p_out)
+{
+    if (write_at(p_out->fd, p_out->buf, p_out->len, p_out->offset) != 0)
+    {
+        return -1;
+    }
+    p_out->offset += p_out->len;
+    p_out->len     = 0;
+
+    return 0;
+}
+
+
+static int out_write(out_t * p_out, void const * p_data, size_t len)
+{
+    uint8_t const * p = p_data;
+
+    while (len > 0)
+    {
+        size_t count = OUT_BUF_SIZE - p_out->len;
+
+        count = (len < count) ? len : count;
+        memcpy(&p_out->buf[p_out->len], p, count);
+        p_out->len += count;
+        p          += count;
+        len        -= count;
+        if ((p_out->len == OUT_BUF_SIZE) && (out_flush(p_out) != 0))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for making room for @p count elements in an array.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int array_reserve(void ** pp_array, size_t * p_size, size_t count, size_t element)
+{
+    size_t size = (*p_size > 0) ? *p_size : 1024;
+    void * p_array;
+
+    if (count <= *p_size)
+    {
+        return 0;
+    }
+    while (size < count)
+    {
+        size *= 2;
+    }
+    p_array = realloc(*pp_array, size * element);
+    if (p_array == NULL)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+    *pp_array = p_array;
+    *p_size   = size;
+
+    return 0;
+}
+
+
+/**@brief Function for getting the time and address of a record.
+ *
+ * @return true if the record is one of an advertiser.
+ */
+static bool record_key(scan_record_t const * p_record, uint64_t * p_t_us, uint64_t * p_addr)
+{
+    switch (p_record->type)
+    {
+        case SCAN_FRAME_TYPE_ADV_REPORT:
+        case SCAN_FRAME_TYPE_ALIVE:
+        case SCAN_FRAME_TYPE_RSSI_SUMMARY:
+        case SCAN_FRAME_TYPE_BEACON:
+            break;
+
+        default:
+            return false;
+    }
+    if (p_record->len < KEY_LEN)
+    {
+        return false;
+    }
+
+    memcpy(p_t_us, p_record->p_payload, sizeof(*p_t_us));
+    *p_addr = 0;
+    memcpy(p_addr, &p_record->p_payload[sizeof(uint64_t)], 6);
+
+    return true;
+}
+
+
+/**@brief Function for finding the next valid frame of a capture.
+ *
+ * @param[in]       p_capture   Capture.
+ * @param[in,out]   p_pos       Where to search from; the frame found, or where to
+ *                              search from once more of the capture is there.
+ * @param[in]       end         End of the capture.
+ * @param[out]      p_record    Record of the frame found.
+ *
+ * @return true if a frame was found.
+ */
+static bool frame_next(uint8_t const * p_capture, uint64_t * p_pos, uint64_t end, scan_record_t * p_record)
+{
+    uint64_t pos = *p_pos;
+
+    while (pos < end)
+    {
+        uint8_t const * p_sof = memchr(&p_capture[pos], SCAN_FRAME_SOF, (size_t)(end - pos));
+        uint16_t        len;
+        uint16_t        crc;
+
+        if (p_sof == NULL)
+        {
+            pos = end;
+            break;
+        }
+        pos = (uint64_t)(p_sof - p_capture);
+        if (end - pos < SCAN_FRAME_HEADER_LEN)
+        {
+            break;
+        }
+        len = (uint16_t)(p_sof[2] | (p_sof[3] << 8));
+        if (len > SCAN_FRAME_MAX_PAYLOAD)
+        {
+            pos++;
+            continue;
+        }
+        if (end - pos < (uint64_t)len + SCAN_FRAME_OVERHEAD)
+        {
+            break;
+        }
+        crc = scan_crc16(&p_sof[1], SCAN_FRAME_HEADER_LEN - 1 + len, NULL);
+        if (crc != (uint16_t)(p_sof[SCAN_FRAME_HEADER_LEN + len] | (p_sof[SCAN_FRAME_HEADER_LEN + len + 1] << 8)))
+        {
+            pos++;
+            continue;
+        }
+
+        p_record->type      = p_sof[1];
+        p_record->len       = len;
+        p_record->p_payload = &p_sof[SCAN_FRAME_HEADER_LEN];
+        *p_pos              = pos;
+        return true;
+    }
+
+    *p_pos = pos;
+
+    return false;
+}
+
+
+static uint32_t addr_hash(uint64_t addr)
+{
+    return (uint32_t)((addr * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+
+/**@brief Function for getting the number of an address in a segment being built.
+ *
+ * @return The number, or UINT32_MAX if out of memory.
+ */
+static uint32_t builder_addr_get(builder_t * p_builder, uint64_t addr)
+{
+    uint32_t slot;
+
+    // Grown at half load, the slots are given again.
+    if ((p_builder->addresses + 1) * 2 > p_builder->table_mask + 1)
+    {
+        uint32_t   size    = (p_builder->table_mask + 1) * 2;
+        uint32_t * p_table = calloc(size, sizeof(uint32_t));
+
+        if (p_table == NULL)
+        {
+            return UINT32_MAX;
+        }
+        free(p_builder->p_table);
+        p_builder->p_table    = p_table;
+        p_builder->table_mask = size - 1;
+        for (uint32_t id = 0; id < p_builder->addresses; id++)
+        {
+            slot = addr_hash(p_builder->p_addrs[id].addr) & p_builder->table_mask;
+            while (p_table[slot] != 0)
+            {
+                slot = (slot + 1) & p_builder->table_mask;
+            }
+            p_table[slot] = id + 1;
+        }
+    }
+
+    slot = addr_hash(addr) & p_builder->table_mask;
+    while (p_builder->p_table[slot] != 0)
+    {
+        uint32_t id = p_builder->p_table[slot] - 1;
+
+        if (p_builder->p_addrs[id].addr == addr)
+        {
+            return id;
+        }
+        slot = (slot + 1) & p_builder->table_mask;
+    }
+
+    if (p_builder->addresses == p_builder->addresses_size)
+    {
+        size_t size = p_builder->addresses_size;
+
+        if (array_reserve((void **)&p_builder->p_addrs, &size, p_builder->addresses + 1, sizeof(scan_idx_addr_t)) != 0)
+        {
+            return UINT32_MAX;
+        }
+        p_builder->addresses_size = (uint32_t)size;
+    }
+    p_builder->p_addrs[p_builder->addresses] = (scan_idx_addr_t){ .addr = addr };
+    p_builder->p_table[slot]                 = p_builder->addresses + 1;
+
+    return p_builder->addresses++;
+}
+
+
+/**@brief Function for adding a record to the segment being built.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int builder_add(builder_t * p_builder, uint64_t offset, uint64_t t_us, uint64_t addr)
+{
+    uint32_t id = builder_addr_get(p_builder, addr);
+
+    if ((id == UINT32_MAX) ||
+        (array_reserve((void **)&p_builder->p_offsets, &p_builder->offsets_size, p_builder->records + 1, sizeof(uint64_t)) != 0) ||
+        (array_reserve((void **)&p_builder->p_ids, &p_builder->ids_size, p_builder->records + 1, sizeof(uint32_t)) != 0))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    p_builder->t_latest = (t_us > p_builder->t_latest) ? t_us : p_builder->t_latest;
+    p_builder->t_min    = (t_us < p_builder->t_min) ? t_us : p_builder->t_min;
+    if ((p_builder->records % SCAN_IDX_TIME_STRIDE) == 0)
+    {
+        size_t size = p_builder->times_size;
+
+        if (array_reserve((void **)&p_builder->p_times, &size, p_builder->times + 1, sizeof(scan_idx_time_t)) != 0)
+        {
+            return -1;
+        }
+        p_builder->times_size                  = (uint32_t)size;
+        p_builder->p_times[p_builder->times++] = (scan_idx_time_t)
+        {
+            .t_latest   = p_builder->t_latest,
+            .t_earliest = t_us,
+            .offset     = offset,
+        };
+    }
+    else if (t_us < p_builder->p_times[p_builder->times - 1].t_earliest)
+    {
+        // Earliest of the records up to the next entry, until the segment is written.
+        p_builder->p_times[p_builder->times - 1].t_earliest = t_us;
+    }
+
+    p_builder->p_addrs[id].count++;
+    p_builder->p_offsets[p_builder->records] = offset;
+    p_builder->p_ids[p_builder->records]     = id;
+    p_builder->records++;
+
+    return 0;
+}
+
+
+static void builder_reset(builder_t * p_builder, uint64_t t_latest)
+{
+    p_builder->records   = 0;
+    p_builder->addresses = 0;
+    p_builder->times     = 0;
+    p_builder->t_latest  = t_latest;
+    p_builder->t_min     = UINT64_MAX;
+    if (p_builder->p_table != NULL)
+    {
+        memset(p_builder->p_table, 0, (p_builder->table_mask + 1) * sizeof(uint32_t));
+    }
+}
+
+
+static void builder_free(builder_t * p_builder)
+{
+    free(p_builder->p_offsets);
+    free(p_builder->p_ids);
+    free(p_builder->p_addrs);
+    free(p_builder->p_table);
+    free(p_builder->p_times);
+}
+
+
+static int addr_compare(void const * p_a, void const * p_b)
+{
+    uint64_t a = ((scan_idx_addr_t const *)p_a)->addr;
+    uint64_t b = ((scan_idx_addr_t const *)p_b)->addr;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for indexing the frames of a range of the capture into a builder.
+ *
+ * @param[in]   start   Where to start.
+ * @param[in]   limit   No frame starting from here is indexed.
+ * @param[in]   end     End of the capture.
+ *
+ * @return Where the next segment starts, or UINT64_MAX if out of memory.
+ */
+static uint64_t builder_run(builder_t     * p_builder,
+                            uint8_t const * p_capture,
+                            uint64_t        start,
+                            uint64_t        limit,
+                            uint64_t        end)
+{
+    uint64_t      pos = start;
+    scan_record_t record;
+
+    while ((pos < limit) && frame_next(p_capture, &pos, end, &record))
+    {
+        uint64_t t_us;
+        uint64_t addr;
+
+        if (record_key(&record, &t_us, &addr) && (builder_add(p_builder, pos, t_us, addr) != 0))
+        {
+            return UINT64_MAX;
+        }
+        pos += (uint64_t)record.len + SCAN_FRAME_OVERHEAD;
+    }
+
+    return (pos < limit) ? pos : limit;
+}
+
+
+/**@brief Function for writing the segment built.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int builder_write(builder_t * p_builder, out_t * p_out, scan_idx_segment_t * p_segment)
+{
+    uint64_t * p_postings = malloc(p_builder->records * sizeof(uint64_t));
+    uint64_t * p_next     = malloc(p_builder->addresses * sizeof(uint64_t));
+    uint64_t   first      = 0;
+    int        err        = 0;
+
+    if ((p_postings == NULL) || (p_next == NULL))
+    {
+        free(p_postings);
+        free(p_next);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (uint32_t id = 0; id < p_builder->addresses; id++)
+    {
+        p_builder->p_addrs[id].reserved = id;
+    }
+    qsort(p_builder->p_addrs, p_builder->addresses, sizeof(scan_idx_addr_t), addr_compare);
+    for (uint32_t i = 0; i < p_builder->addresses; i++)
+    {
+        p_next[p_builder->p_addrs[i].reserved] = first;
+        p_builder->p_addrs[i].first            = first;
+        p_builder->p_addrs[i].reserved         = 0;
+        first                                 += p_builder->p_addrs[i].count;
+    }
+    for (size_t i = 0; i < p_builder->records; i++)
+    {
+        p_postings[p_next[p_builder->p_ids[i]]++] = p_builder->p_offsets[i];
+    }
+    for (uint32_t i = p_builder->times; i > 1; i--)
+    {
+        scan_idx_time_t * p_time = &p_builder->p_times[i - 2];
+
+        p_time->t_earliest = (p_time[1].t_earliest < p_time->t_earliest) ? p_time[1].t_earliest : p_time->t_earliest;
+    }
+
+    p_segment->t_min            = p_builder->t_min;
+    p_segment->t_max            = p_builder->t_latest;
+    p_segment->postings         = p_builder->records;
+    p_segment->addresses        = p_builder->addresses;
+    p_segment->times            = p_builder->times;
+    p_segment->addresses_offset = out_pos(p_out);
+    err |= out_write(p_out, p_builder->p_addrs, p_builder->addresses * sizeof(scan_idx_addr_t));
+    p_segment->postings_offset  = out_pos(p_out);
+    err |= out_write(p_out, p_postings, p_builder->records * sizeof(uint64_t));
+    p_segment->times_offset     = out_pos(p_out);
+    err |= out_write(p_out, p_builder->p_times, p_builder->times * sizeof(scan_idx_time_t));
+
+    free(p_postings);
+    free(p_next);
+
+    return (err == 0) ? 0 : -1;
+}
+
+
+static uint64_t segment_bytes(scan_idx_segment_t const * p_segment)
+{
+    return p_segment->addresses * sizeof(scan_idx_addr_t) +
+           p_segment->postings * sizeof(uint64_t) +
+           p_segment->times * sizeof(scan_idx_time_t);
+}
+
+
+/**@brief Function for checking that the directory of an index points inside it.
+ *
+ * @return 0 if it does, -1 otherwise (errno is EBADMSG).
+ */
+static int directory_check(scan_idx_hdr_t const * p_hdr, scan_idx_segment_t const * p_segments, uint64_t index_len)
+{
+    uint64_t capture_pos = 0;
+
+    for (uint32_t i = 0; i < p_hdr->segments; i++)
+    {
+        scan_idx_segment_t const * p_segment = &p_segments[i];
+
+        if ((p_segment->capture_start < capture_pos) || (p_segment->capture_end < p_segment->capture_start) ||
+            (p_segment->capture_end > p_hdr->indexed_len) ||
+            (p_segment->addresses_offset > index_len) ||
+            (p_segment->addresses > (index_len - p_segment->addresses_offset) / sizeof(scan_idx_addr_t)) ||
+            (p_segment->postings_offset > index_len) ||
+            (p_segment->postings > (index_len - p_segment->postings_offset) / sizeof(uint64_t)) ||
+            (p_segment->times_offset > index_len) ||
+            (p_segment->times > (index_len - p_segment->times_offset) / sizeof(scan_idx_time_t)) ||
+            ((p_segment->addresses_offset | p_segment->postings_offset | p_segment->times_offset) % 8 != 0))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        capture_pos = p_segment->capture_end;
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for checking a header read from an index of @p index_len bytes. */
+static int hdr_check(scan_idx_hdr_t const * p_hdr, uint64_t index_len)
+{
+    if ((p_hdr->magic != SCAN_IDX_MAGIC) || (p_hdr->version != SCAN_IDX_VERSION) ||
+        (p_hdr->directory_offset > index_len) ||
+        (p_hdr->segments > (index_len - p_hdr->directory_offset) / sizeof(scan_idx_segment_t)))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for making the segments written visible: directory, then header.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int update_commit(update_t * p_update)
+{
+    p_update->hdr.directory_offset = out_pos(p_update->p_out);
+    if ((out_write(p_update->p_out, p_update->p_segments, p_update->hdr.segments * sizeof(scan_idx_segment_t)) != 0) ||
+        (out_flush(p_update->p_out) != 0) ||
+        (fdatasync(p_update->fd) != 0))
+    {
+        return -1;
+    }
+
+    return write_at(p_update->fd, &p_update->hdr, sizeof(p_update->hdr), 0);
+}
+
+
+/**@brief Function for adding a segment to the directory of an update.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int update_segment_add(update_t * p_update, scan_idx_segment_t const * p_segment)
+{
+    size_t size = p_update->segments_size;
+
+    if (array_reserve((void **)&p_update->p_segments, &size, p_update->hdr.segments + 1, sizeof(scan_idx_segment_t)) != 0)
+    {
+        return -1;
+    }
+    p_update->segments_size                         = (uint32_t)size;
+    p_update->p_segments[p_update->hdr.segments++] = *p_segment;
+
+    return 0;
+}
+
+
+/**@brief Function for merging the segments from @p first on into one, appended to the index.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int segments_merge(update_t * p_update, uint32_t first)
+{
+    scan_idx_segment_t   merged    = { 0 };
+    scan_idx_segment_t * p_inputs  = &p_update->p_segments[first];
+    uint32_t             count     = p_update->hdr.segments - first;
+    uint64_t             cursors[SCAN_IDX_SEGMENTS_MAX + 1] = { 0 };
+    scan_idx_addr_t    * p_addrs   = NULL;
+    size_t               addrs_size = 0;
+    uint8_t const      * p_index;
+    uint64_t             index_len;
+    int                  err = 0;
+
+    if ((count > SCAN_IDX_SEGMENTS_MAX + 1) || (out_flush(p_update->p_out) != 0))
+    {
+        return -1;
+    }
+    index_len = out_pos(p_update->p_out);
+    if (file_map(p_update->fd, index_len, &p_index) != 0)
+    {
+        return -1;
+    }
+
+    merged.capture_start = p_inputs[0].capture_start;
+    merged.capture_end   = p_inputs[count - 1].capture_end;
+    merged.t_min         = UINT64_MAX;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        merged.t_min     = (p_inputs[i].t_min < merged.t_min) ? p_inputs[i].t_min : merged.t_min;
+        merged.t_max     = (p_inputs[i].t_max > merged.t_max) ? p_inputs[i].t_max : merged.t_max;
+        merged.postings += p_inputs[i].postings;
+        merged.times    += p_inputs[i].times;
+    }
+
+    // The postings of each address, from the segments in turn, which keeps them in order.
+    merged.postings_offset = out_pos(p_update->p_out);
+    for (;;)
+    {
+        uint64_t        addr  = UINT64_MAX;
+        bool            found = false;
+        scan_idx_addr_t entry;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scan_idx_addr_t const * p_addr = (scan_idx_addr_t const *)&p_index[p_inputs[i].addresses_offset];
+
+            if ((cursors[i] < p_inputs[i].addresses) && (!found || (p_addr[cursors[i]].addr < addr)))
+            {
+                addr  = p_addr[cursors[i]].addr;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            break;
+        }
+
+        entry = (scan_idx_addr_t){ .addr = addr, .first = (out_pos(p_update->p_out) - merged.postings_offset) / sizeof(uint64_t) };
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scan_idx_addr_t const * p_addr = (scan_idx_addr_t const *)&p_index[p_inputs[i].addresses_offset];
+
+            if ((cursors[i] < p_inputs[i].addresses) && (p_addr[cursors[i]].addr == addr))
+            {
+                scan_idx_addr_t const * p_entry = &p_addr[cursors[i]++];
+
+                if ((p_entry->first > p_inputs[i].postings) || (p_entry->count > p_inputs[i].postings - p_entry->first))
+                {
+                    errno = EBADMSG;
+                    err   = -1;
+                    break;
+                }
+                err   |= out_write(p_update->p_out, &p_index[p_inputs[i].postings_offset + p_entry->first * sizeof(uint64_t)],
+                                   p_entry->count * sizeof(uint64_t));
+                entry.count += p_entry->count;
+            }
+        }
+        if ((err != 0) || (array_reserve((void **)&p_addrs, &addrs_size, merged.addresses + 1, sizeof(scan_idx_addr_t)) != 0))
+        {
+            err = -1;
+            break;
+        }
+        p_addrs[merged.addresses++] = entry;
+    }
+
+    if (err == 0)
+    {
+        uint64_t later[SCAN_IDX_SEGMENTS_MAX + 1];
+
+        // The earliest times now run to the end of the merged segment.
+        later[count - 1] = UINT64_MAX;
+        for (uint32_t i = count - 1; i > 0; i--)
+        {
+            later[i - 1] = (p_inputs[i].t_min < later[i]) ? p_inputs[i].t_min : later[i];
+        }
+        merged.times_offset = out_pos(p_update->p_out);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scan_idx_time_t const * p_times = (scan_idx_time_t const *)&p_index[p_inputs[i].times_offset];
+
+            for (uint32_t j = 0; j < p_inputs[i].times; j++)
+            {
+                scan_idx_time_t time = p_times[j];
+
+                time.t_earliest = (later[i] < time.t_earliest) ? later[i] : time.t_earliest;
+                err            |= out_write(p_update->p_out, &time, sizeof(time));
+            }
+        }
+        merged.addresses_offset = out_pos(p_update->p_out);
+        err |= out_write(p_update->p_out, p_addrs, merged.addresses * sizeof(scan_idx_addr_t));
+    }
+
+    file_unmap(p_index, index_len);
+    free(p_addrs);
+    if (err != 0)
+    {
+        return -1;
+    }
+
+    p_update->hdr.segments                = first;
+    p_update->p_segments[p_update->hdr.segments++] = merged;
+
+    return update_commit(p_update);
+}
+
+
+/**@brief Function for merging segments once there are too many.
+ *
+ * @details The newest segments are merged to leave @ref MERGE_KEEP of them, with
+ *          the older ones that are not larger than what is merged, so that a large
+ *          segment is only merged again once as much was added after it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int update_merge(update_t * p_update, bool * p_merged)
+{
+    uint32_t first;
+    uint64_t postings = 0;
+
+    if (p_update->hdr.segments <= SCAN_IDX_SEGMENTS_MAX)
+    {
+        return 0;
+    }
+
+    first = MERGE_KEEP - 1;
+    for (uint32_t i = first; i < p_update->hdr.segments; i++)
+    {
+        postings += p_update->p_segments[i].postings;
+    }
+    while ((first > 0) && (p_update->p_segments[first - 1].postings <= postings))
+    {
+        first--;
+        postings += p_update->p_segments[first].postings;
+    }
+
+    *p_merged = true;
+
+    return segments_merge(p_update, first);
+}
+
+
+/**@brief Function for copying the segments in use to a new index, once the others take more room.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int update_compact(update_t * p_update)
+{
+    uint64_t        used = sizeof(scan_idx_hdr_t) + p_update->hdr.segments * sizeof(scan_idx_segment_t);
+    uint64_t        index_len;
+    uint8_t const * p_index;
+    char          * p_tmp;
+    out_t         * p_out;
+    int             fd;
+    int             err = 0;
+
+    for (uint32_t i = 0; i < p_update->hdr.segments; i++)
+    {
+        used += segment_bytes(&p_update->p_segments[i]);
+    }
+    index_len = out_pos(p_update->p_out);
+    if (index_len - used <= used)
+    {
+        return 0;
+    }
+
+    p_tmp = index_path(p_update->p_path, ".tmp");
+    p_out = malloc(sizeof(out_t));
+    if ((p_tmp == NULL) || (p_out == NULL))
+    {
+        free(p_tmp);
+        free(p_out);
+        errno = ENOMEM;
+        return -1;
+    }
+    fd = open(p_tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if ((fd < 0) || (file_map(p_update->fd, index_len, &p_index) != 0))
+    {
+        err = -1;
+    }
+    else
+    {
+        p_out->fd     = fd;
+        p_out->offset = sizeof(scan_idx_hdr_t);
+        p_out->len    = 0;
+        for (uint32_t i = 0; (err == 0) && (i < p_update->hdr.segments); i++)
+        {
+            scan_idx_segment_t * p_segment = &p_update->p_segments[i];
+            scan_idx_segment_t   moved     = *p_segment;
+
+            moved.addresses_offset = out_pos(p_out);
+            err |= out_write(p_out, &p_index[p_segment->addresses_offset], p_segment->addresses * sizeof(scan_idx_addr_t));
+            moved.postings_offset  = out_pos(p_out);
+            err |= out_write(p_out, &p_index[p_segment->postings_offset], p_segment->postings * sizeof(uint64_t));
+            moved.times_offset     = out_pos(p_out);
+            err |= out_write(p_out, &p_index[p_segment->times_offset], p_segment->times * sizeof(scan_idx_time_t));
+            *p_segment             = moved;
+        }
+        file_unmap(p_index, index_len);
+    }
+
+    if (err == 0)
+    {
+        // The new file takes the place of the old one, for this update and the next lookups.
+        close(p_update->fd);
+        free(p_update->p_out);
+        p_update->fd    = fd;
+        p_update->p_out = p_out;
+        fd              = -1;
+        if ((update_commit(p_update) != 0) || (rename(p_tmp, p_update->p_path) != 0))
+        {
+            (void)unlink(p_tmp);
+            err = -1;
+        }
+    }
+    else
+    {
+        free(p_out);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+        (void)unlink(p_tmp);
+    }
+    free(p_tmp);
+
+    return err;
+}
+
+
+/**@brief Function for opening the index of an update, or creating it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int update_open(update_t * p_update, uint64_t capture_len, bool * p_rebuilt)
+{
+    struct stat st;
+
+    p_update->fd = open(p_update->p_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if ((p_update->fd < 0) || (fstat(p_update->fd, &st) != 0))
+    {
+        return -1;
+    }
+
+    if (st.st_size > 0)
+    {
+        if ((read_at(p_update->fd, &p_update->hdr, sizeof(p_update->hdr), 0) != 0) ||
+            (hdr_check(&p_update->hdr, (uint64_t)st.st_size) != 0))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        if (p_update->hdr.indexed_len <= capture_len)
+        {
+            p_update->segments_size = p_update->hdr.segments;
+            p_update->p_segments    = malloc((p_update->segments_size + 1) * sizeof(scan_idx_segment_t));
+            if (p_update->p_segments == NULL)
+            {
+                errno = ENOMEM;
+                return -1;
+            }
+            if ((read_at(p_update->fd, p_update->p_segments, p_update->hdr.segments * sizeof(scan_idx_segment_t),
+                         p_update->hdr.directory_offset) != 0) ||
+                (directory_check(&p_update->hdr, p_update->p_segments, (uint64_t)st.st_size) != 0))
+            {
+                errno = EBADMSG;
+                return -1;
+            }
+            p_update->p_out->offset = ((uint64_t)st.st_size + 7) & ~(uint64_t)7;
+            return 0;
+        }
+
+        // The capture was replaced.
+        *p_rebuilt = true;
+        if (ftruncate(p_update->fd, 0) != 0)
+        {
+            return -1;
+        }
+    }
+
+    p_update->hdr = (scan_idx_hdr_t)
+    {
+        .magic            = SCAN_IDX_MAGIC,
+        .version          = SCAN_IDX_VERSION,
+        .directory_offset = sizeof(scan_idx_hdr_t),
+    };
+    p_update->p_out->offset = sizeof(scan_idx_hdr_t);
+
+    return write_at(p_update->fd, &p_update->hdr, sizeof(p_update->hdr), 0);
+}
+
+
+int scan_idx_update(char const * p_capture, scan_idx_update_stats_t * p_stats)
+{
+    scan_idx_update_stats_t stats   = { 0 };
+    update_t                update  = { .fd = -1 };
+    builder_t               builder = { 0 };
+    uint8_t const         * p_data  = NULL;
+    uint64_t                capture_len = 0;
+    uint64_t                pos;
+    struct stat             st;
+    int                     capture_fd;
+    int                     saved;
+    int                     err = -1;
+
+    capture_fd = open(p_capture, O_RDONLY | O_CLOEXEC);
+    if (capture_fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(capture_fd, &st) == 0)
+    {
+        capture_len = (uint64_t)st.st_size;
+        err         = file_map(capture_fd, capture_len, &p_data);
+    }
+    close(capture_fd);
+    if (err != 0)
+    {
+        return -1;
+    }
+
+    update.p_path = index_path(p_capture, ".idx");
+    update.p_out  = malloc(sizeof(out_t));
+    err = -1;
+    if ((update.p_path == NULL) || (update.p_out == NULL))
+    {
+        errno = ENOMEM;
+        goto exit;
+    }
+    update.p_out->len = 0;
+    if (update_open(&update, capture_len, &stats.rebuilt) != 0)
+    {
+        goto exit;
+    }
+    update.p_out->fd = update.fd;
+
+    pos = update.hdr.indexed_len;
+    while (pos < capture_len)
+    {
+        uint64_t           t_latest = (update.hdr.segments > 0) ? update.p_segments[update.hdr.segments - 1].t_max : 0;
+        uint64_t           limit    = (capture_len - pos > SCAN_IDX_SEGMENT_BYTES) ? pos + SCAN_IDX_SEGMENT_BYTES : capture_len;
+        scan_idx_segment_t segment  = { .capture_start = pos };
+
+        builder_reset(&builder, t_latest);
+        segment.capture_end = builder_run(&builder, p_data, pos, limit, capture_len);
+        if (segment.capture_end == UINT64_MAX)
+        {
+            errno = ENOMEM;
+            goto exit;
+        }
+        if (segment.capture_end == pos)
+        {
+            // Only part of a frame, for the next update.
+            break;
+        }
+
+        stats.bytes   += segment.capture_end - pos;
+        stats.records += builder.records;
+        pos            = segment.capture_end;
+        if (builder.records > 0)
+        {
+            if ((builder_write(&builder, update.p_out, &segment) != 0) || (update_segment_add(&update, &segment) != 0))
+            {
+                goto exit;
+            }
+            stats.segments++;
+        }
+        update.hdr.indexed_len = pos;
+        if ((update_commit(&update) != 0) || (update_merge(&update, &stats.merged) != 0))
+        {
+            goto exit;
+        }
+    }
+
+    err = update_compact(&update);
+
+exit:
+    saved = errno;
+    if (update.fd >= 0)
+    {
+        close(update.fd);
+    }
+    builder_free(&builder);
+    file_unmap(p_data, capture_len);
+    free(update.p_segments);
+    free(update.p_out);
+    free(update.p_path);
+    errno = saved;
+
+    if ((err == 0) && (p_stats != NULL))
+    {
+        *p_stats = stats;
+    }
+
+    return err;
+}
+
+
+int scan_idx_open(scan_idx_t ** pp_idx, char const * p_capture)
+{
+    scan_idx_t * p_idx = calloc(1, sizeof(*p_idx));
+    char       * p_path = index_path(p_capture, ".idx");
+    struct stat  st;
+    int          fd = -1;
+    int          err = -1;
+
+    if ((p_idx == NULL) || (p_path == NULL))
+    {
+        errno = ENOMEM;
+        goto exit;
+    }
+
+    fd = open(p_path, O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        goto exit;
+    }
+    if ((size_t)st.st_size < sizeof(scan_idx_hdr_t))
+    {
+        errno = EBADMSG;
+        goto exit;
+    }
+    p_idx->index_len = (size_t)st.st_size;
+    if (file_map(fd, p_idx->index_len, &p_idx->p_index) != 0)
+    {
+        goto exit;
+    }
+    close(fd);
+    fd = -1;
+
+    p_idx->p_hdr      = (scan_idx_hdr_t const *)p_idx->p_index;
+    p_idx->p_segments = (scan_idx_segment_t const *)&p_idx->p_index[p_idx->p_hdr->directory_offset];
+    if ((hdr_check(p_idx->p_hdr, p_idx->index_len) != 0) ||
+        (directory_check(p_idx->p_hdr, p_idx->p_segments, p_idx->index_len) != 0))
+    {
+        goto exit;
+    }
+
+    fd = open(p_capture, O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        goto exit;
+    }
+    if ((uint64_t)st.st_size < p_idx->p_hdr->indexed_len)
+    {
+        errno = EBADMSG;
+        goto exit;
+    }
+    p_idx->capture_len = (size_t)p_idx->p_hdr->indexed_len;
+    if (file_map(fd, p_idx->capture_len, &p_idx->p_capture) != 0)
+    {
+        goto exit;
+    }
+    if (p_idx->p_capture != NULL)
+    {
+        // Lookups read a frame here and there; reading around each one wastes the disk.
+        madvise((void *)p_idx->p_capture, p_idx->capture_len, MADV_RANDOM);
+    }
+    err = 0;
+
+exit:
+    if (fd >= 0)
+    {
+        int saved = errno;
+
+        close(fd);
+        errno = saved;
+    }
+    free(p_path);
+    if (err != 0)
+    {
+        if (p_idx != NULL)
+        {
+            int saved = errno;
+
+            scan_idx_close(p_idx);
+            errno = saved;
+        }
+        return -1;
+    }
+    *pp_idx = p_idx;
+
+    return 0;
+}
+
+
+scan_idx_hdr_t const * scan_idx_info(scan_idx_t const * p_idx, scan_idx_segment_t const ** pp_segments)
+{
+    *pp_segments = p_idx->p_segments;
+
+    return p_idx->p_hdr;
+}
+
+
+/**@brief Function for finding the range of a segment that can hold the records of a time range.
+ *
+ * @param[out]  p_start     First byte of the capture to look at.
+ * @param[out]  p_end       Byte after the last one.
+ */
+static void segment_range(scan_idx_t const         * p_idx,
+                          scan_idx_segment_t const * p_segment,
+                          scan_idx_query_t const   * p_query,
+                          uint64_t                 * p_start,
+                          uint64_t                 * p_end)
+{
+    scan_idx_time_t const * p_times = (scan_idx_time_t const *)&p_idx->p_index[p_segment->times_offset];
+    uint32_t                lo      = 0;
+    uint32_t                hi      = p_segment->times;
+
+    // The records before the last entry whose latest time is earlier than t_min are earlier still.
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (p_times[mid].t_latest < p_query->t_min)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    *p_start = (lo > 0) ? p_times[lo - 1].offset : p_segment->capture_start;
+
+    // The records from the first entry whose earliest time is later than t_max on are later still.
+    lo = 0;
+    hi = p_segment->times;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (p_times[mid].t_earliest <= p_query->t_max)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    *p_end = (lo < p_segment->times) ? p_times[lo].offset : p_segment->capture_end;
+}
+
+
+/**@brief Function for passing a record to the handler if it matches the lookup. */
+static void record_match(scan_record_t const       * p_record,
+                         scan_idx_query_t const    * p_query,
+                         scan_decoder_handler_t      handler,
+                         void                      * p_context,
+                         scan_idx_lookup_stats_t   * p_stats)
+{
+    uint64_t t_us;
+    uint64_t addr;
+    uint64_t query_addr = 0;
+
+    memcpy(&query_addr, p_query->addr, sizeof(p_query->addr));
+    if (record_key(p_record, &t_us, &addr) &&
+        (!p_query->by_addr || (addr == query_addr)) &&
+        (t_us >= p_query->t_min) && (t_us <= p_query->t_max))
+    {
+        p_stats->records++;
+        handler(p_record, p_context);
+    }
+}
+
+
+/**@brief Function for telling how a range of the capture is about to be read. */
+static void range_advise(scan_idx_t const * p_idx, uint64_t start, uint64_t end, int advice)
+{
+    uintptr_t page_mask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t from      = (uintptr_t)&p_idx->p_capture[start] & ~page_mask;
+
+    if (start < end)
+    {
+        madvise((void *)from, (uintptr_t)&p_idx->p_capture[end] - from, advice);
+    }
+}
+
+
+/**@brief Function for asking the frames of postings from the disk ahead of reading them.
+ *
+ * @details The frames of an address are spread over the capture; asked all at once,
+ *          the disk reads them side by side instead of one page fault at a time.
+ */
+static void capture_prefetch(scan_idx_t const * p_idx, uint64_t const * p_postings, uint64_t count, uint64_t end)
+{
+    uintptr_t page_mask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t done      = 0;
+
+    for (uint64_t i = 0; (i < count) && (p_postings[i] < end); i++)
+    {
+        uint64_t  len;
+        uintptr_t from;
+        uintptr_t to;
+
+        if (p_postings[i] >= p_idx->capture_len)
+        {
+            break;                                                      // segment_lookup() reports it.
+        }
+        len  = p_idx->capture_len - p_postings[i];
+        len  = (len < PREFETCH_LEN) ? len : PREFETCH_LEN;
+        from = (uintptr_t)&p_idx->p_capture[p_postings[i]] & ~page_mask;
+        to   = ((uintptr_t)&p_idx->p_capture[p_postings[i] + len] + page_mask) & ~page_mask;
+        from = (from < done) ? done : from;
+        if (from < to)
+        {
+            madvise((void *)from, to - from, MADV_WILLNEED);
+            done = to;
+        }
+    }
+}
+
+
+/**@brief Function for looking up the postings of an address in a range of a segment.
+ *
+ * @return 0 on success, -1 if a posting does not point to a frame.
+ */
+static int segment_lookup(scan_idx_t const         * p_idx,
+                          scan_idx_segment_t const * p_segment,
+                          scan_idx_query_t const   * p_query,
+                          uint64_t                   start,
+                          uint64_t                   end,
+                          scan_decoder_handler_t     handler,
+                          void                     * p_context,
+                          scan_idx_lookup_stats_t  * p_stats)
+{
+    scan_idx_addr_t const * p_addrs    = (scan_idx_addr_t const *)&p_idx->p_index[p_segment->addresses_offset];
+    uint64_t const        * p_postings = (uint64_t const *)&p_idx->p_index[p_segment->postings_offset];
+    uint64_t                addr       = 0;
+    uint32_t                lo         = 0;
+    uint32_t                hi         = p_segment->addresses;
+    uint64_t                first;
+    uint64_t                last;
+    uint64_t                prefetched = 0;
+
+    memcpy(&addr, p_query->addr, sizeof(p_query->addr));
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (p_addrs[mid].addr < addr)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if ((lo == p_segment->addresses) || (p_addrs[lo].addr != addr))
+    {
+        return 0;
+    }
+    if ((p_addrs[lo].first > p_segment->postings) || (p_addrs[lo].count > p_segment->postings - p_addrs[lo].first))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    // The first posting of the range.
+    first = p_addrs[lo].first;
+    last  = first + p_addrs[lo].count;
+    while (first < last)
+    {
+        uint64_t mid = first + (last - first) / 2;
+
+        if (p_postings[mid] < start)
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+
+    for (last = p_addrs[lo].first + p_addrs[lo].count; (first < last) && (p_postings[first] < end); first++)
+    {
+        uint64_t        offset = p_postings[first];
+        uint8_t const * p_sof  = &p_idx->p_capture[offset];
+        scan_record_t   record;
+
+        if (first >= prefetched)
+        {
+            prefetched = ((last - first) < PREFETCH_POSTINGS) ? last : first + PREFETCH_POSTINGS;
+            capture_prefetch(p_idx, &p_postings[first], prefetched - first, end);
+        }
+        if ((offset > p_idx->capture_len - SCAN_FRAME_OVERHEAD) || (p_sof[0] != SCAN_FRAME_SOF))
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        record.type      = p_sof[1];
+        record.len       = (uint16_t)(p_sof[2] | (p_sof[3] << 8));
+        record.p_payload = &p_sof[SCAN_FRAME_HEADER_LEN];
+        if (record.len > p_idx->capture_len - SCAN_FRAME_OVERHEAD - offset)
+        {
+            errno = EBADMSG;
+            return -1;
+        }
+        p_stats->frames_read++;
+        record_match(&record, p_query, handler, p_context, p_stats);
+    }
+
+    return 0;
+}
+
+
+int scan_idx_lookup(scan_idx_t                    * p_idx,
+                    scan_idx_query_t const        * p_query,
+                    scan_decoder_handler_t          handler,
+                    void                          * p_context,
+                    scan_idx_lookup_stats_t       * p_stats)
+{
+    scan_idx_lookup_stats_t stats = { .segments = p_idx->p_hdr->segments };
+    int                     err   = 0;
+
+    if (p_idx->capture_len < SCAN_FRAME_OVERHEAD)
+    {
+        stats.segments = 0;
+    }
+
+    for (uint32_t i = 0; (err == 0) && (i < stats.segments); i++)
+    {
+        scan_idx_segment_t const * p_segment = &p_idx->p_segments[i];
+        uint64_t                   start;
+        uint64_t                   end;
+
+        if ((p_segment->t_max < p_query->t_min) || (p_segment->t_min > p_query->t_max))
+        {
+            continue;
+        }
+        segment_range(p_idx, p_segment, p_query, &start, &end);
+
+        if (p_query->by_addr)
+        {
+            err = segment_lookup(p_idx, p_segment, p_query, start, end, handler, p_context, &stats);
+        }
+        else
+        {
+            scan_record_t record;
+
+            range_advise(p_idx, start, end, MADV_SEQUENTIAL);
+            while (frame_next(p_idx->p_capture, &start, end, &record))
+            {
+                stats.frames_read++;
+                record_match(&record, p_query, handler, p_context, &stats);
+                start += (uint64_t)record.len + SCAN_FRAME_OVERHEAD;
+            }
+            range_advise(p_idx, p_segment->capture_start, end, MADV_RANDOM);
+        }
+    }
+
+    if (p_stats != NULL)
+    {
+        *p_stats = stats;
+    }
+
+    return err;
+}
+
+
+void scan_idx_close(scan_idx_t * p_idx)
+{
+    file_unmap(p_idx->p_index, p_idx->index_len);
+    file_unmap(p_idx->p_capture, p_idx->capture_len);
+    free(p_idx);
+}
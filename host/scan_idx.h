@@ -0,0 +1,186 @@
+/***************************************************************************************/
+/*
+ * scan_idx
+ *
+ *  Index of a binary capture (scan_ingestd -c, scan_sim -o), to find the records of
+ *  an advertiser, or of a time range, without reading the capture. The index of a
+ *  capture is kept next to it, in capture.idx.
+ *
+ *  The records indexed are those of an advertiser: advertising reports, ALIVE and
+ *  RSSI summary records and beacons. The index is made of segments, each covering
+ *  a range of the capture:
+ *
+ *      addresses   sorted table of the addresses: where their postings start, how many
+ *      postings    offsets of the frames of each address in the capture, in order
+ *      times       every @ref SCAN_IDX_TIME_STRIDE records: offset, latest time up
+ *                  to the record and earliest time from it on
+ *
+ *  A lookup finds the range of the capture of its time range in the times, then the
+ *  postings of its address in that range with two binary searches, and only reads
+ *  the frames they point to. Index and capture are read through mmap.
+ *
+ *  An update indexes what was appended to the capture since the previous one, up
+ *  to its last whole frame, into new segments, then makes them visible by rewriting
+ *  the header of the index. Once there are more than @ref SCAN_IDX_SEGMENTS_MAX,
+ *  the newest are merged into one; once most of the index is no longer in use, it
+ *  is copied to a new file that replaces it.
+ *
+ *      header | segment | ... | directory | segment | ... | directory
+ *
+ *  The times of the records do not always grow (summaries of an earlier window, a
+ *  restart of the scanner); lookups stay exact, but read more of the capture.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_IDX_H__
+#define SCAN_IDX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_IDX_MAGIC              0x58494353                          /**< "SCIX", at the start of the index. */
+#define SCAN_IDX_VERSION            1
+#define SCAN_IDX_TIME_STRIDE        1024                                /**< Records between two entries of the times. */
+#define SCAN_IDX_SEGMENT_BYTES      (256u << 20)                        /**< Most bytes of capture per segment. */
+#define SCAN_IDX_SEGMENTS_MAX       8                                   /**< Segments left after an update before they are merged. */
+
+/**@brief Header of the index, rewritten by each update. */
+typedef struct
+{
+    uint32_t magic;                                                     /**< @ref SCAN_IDX_MAGIC. */
+    uint16_t version;                                                   /**< @ref SCAN_IDX_VERSION. */
+    uint16_t reserved;
+    uint64_t indexed_len;                                               /**< Bytes of the capture indexed. */
+    uint64_t directory_offset;                                          /**< Offset of the directory, an array of @ref scan_idx_segment_t. */
+    uint32_t segments;                                                  /**< Entries of the directory. */
+    uint32_t reserved2;
+} scan_idx_hdr_t;
+
+/**@brief Entry of the directory. Offsets are in the index, multiples of 8. */
+typedef struct
+{
+    uint64_t capture_start;                                             /**< First byte of the capture covered. */
+    uint64_t capture_end;                                               /**< Byte after the last one covered. */
+    uint64_t t_min;                                                     /**< Earliest time of its records, microseconds. */
+    uint64_t t_max;                                                     /**< Latest time of the capture up to its end, microseconds. */
+    uint64_t addresses_offset;                                          /**< Array of @ref scan_idx_addr_t. */
+    uint64_t postings_offset;                                           /**< Array of offsets in the capture, uint64_t. */
+    uint64_t times_offset;                                              /**< Array of @ref scan_idx_time_t. */
+    uint64_t postings;                                                  /**< Records indexed. */
+    uint32_t addresses;
+    uint32_t times;
+} scan_idx_segment_t;
+
+/**@brief Entry of the addresses of a segment. */
+typedef struct
+{
+    uint64_t addr;                                                      /**< Address, least significant byte first, as a number. */
+    uint64_t first;                                                     /**< First of its postings. */
+    uint32_t count;                                                     /**< Postings of the address. */
+    uint32_t reserved;
+} scan_idx_addr_t;
+
+/**@brief Entry of the times of a segment. */
+typedef struct
+{
+    uint64_t t_latest;                                                  /**< Latest time of the capture up to the record. */
+    uint64_t t_earliest;                                                /**< Earliest time of the segment from the record on. */
+    uint64_t offset;                                                    /**< Offset of the record in the capture. */
+} scan_idx_time_t;
+
+/**@brief Index instance, for lookups. */
+typedef struct scan_idx_s scan_idx_t;
+
+/**@brief A lookup. Records match when they match every condition. */
+typedef struct
+{
+    bool     by_addr;                                                   /**< Match on @ref addr, any address type. */
+    uint8_t  addr[6];                                                   /**< Address, least significant byte first. */
+    uint64_t t_min;                                                     /**< Earliest time, microseconds. */
+    uint64_t t_max;                                                     /**< Latest time, microseconds. */
+} scan_idx_query_t;
+
+/**@brief Counters of an update. */
+typedef struct
+{
+    uint64_t bytes;                                                     /**< Bytes of the capture indexed. */
+    uint64_t records;                                                   /**< Records indexed. */
+    uint32_t segments;                                                  /**< Segments added. */
+    bool     merged;                                                    /**< The segments were merged. */
+    bool     rebuilt;                                                   /**< The capture was shorter than the index, which was made again. */
+} scan_idx_update_stats_t;
+
+/**@brief Counters of a lookup. */
+typedef struct
+{
+    uint32_t segments;                                                  /**< Segments of the index. */
+    uint64_t frames_read;                                               /**< Frames of the capture read. */
+    uint64_t records;                                                   /**< Records that matched. */
+} scan_idx_lookup_stats_t;
+
+
+/**@brief Function for indexing what was appended to a capture since the last update.
+ *
+ * @details Creates the index if there is none. Only one update of an index should
+ *          run at a time; lookups can run alongside.
+ *
+ * @param[in]   p_capture   Capture.
+ * @param[out]  p_stats     Counters. Can be NULL.
+ *
+ * @return 0 on success, -1 on error (errno is set, EBADMSG for a corrupted index).
+ */
+int scan_idx_update(char const * p_capture, scan_idx_update_stats_t * p_stats);
+
+
+/**@brief Function for opening the index of a capture for lookups.
+ *
+ * @details The lookups see the capture as it was indexed when it was opened.
+ *
+ * @param[out]  pp_idx      Index instance.
+ * @param[in]   p_capture   Capture.
+ *
+ * @return 0 on success, -1 on error (errno is set, EBADMSG for a corrupted index).
+ */
+int scan_idx_open(scan_idx_t ** pp_idx, char const * p_capture);
+
+
+/**@brief Function for getting the header and the directory of an open index.
+ *
+ * @param[in]   p_idx           Index instance.
+ * @param[out]  pp_segments     Directory, valid while the index is open.
+ *
+ * @return Header of the index.
+ */
+scan_idx_hdr_t const * scan_idx_info(scan_idx_t const * p_idx, scan_idx_segment_t const ** pp_segments);
+
+
+/**@brief Function for finding the records that match a lookup.
+ *
+ * @param[in]   p_idx       Index instance.
+ * @param[in]   p_query     Lookup.
+ * @param[in]   handler     Called with every matching record, in the order of the capture.
+ * @param[in]   p_context   Passed to @p handler.
+ * @param[out]  p_stats     Counters. Can be NULL.
+ *
+ * @return 0 on success, -1 on error (errno is EBADMSG if the index does not match the capture).
+ */
+int scan_idx_lookup(scan_idx_t                    * p_idx,
+                    scan_idx_query_t const        * p_query,
+                    scan_decoder_handler_t          handler,
+                    void                          * p_context,
+                    scan_idx_lookup_stats_t       * p_stats);
+
+
+/**@brief Function for closing an index. */
+void scan_idx_close(scan_idx_t * p_idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_IDX_H__
@@ -0,0 +1,343 @@
+/***************************************************************************************/
+/*
+ * scan_index
+ *
+ *  Builds and searches the index of a binary capture (see scan_idx.h), kept next to
+ *  it in capture.idx.
+ *
+ *  Usage: scan_index update <capture>
+ *         scan_index watch [-i seconds] <capture>
+ *         scan_index lookup [-a addr] [-s seconds] [-e seconds] <capture>
+ *         scan_index info <capture>
+ *
+ *    update    index what was appended to the capture since the last update
+ *    watch     update every few seconds (10 by default) until SIGINT/SIGTERM, to
+ *              keep up with the capture of a running scan_ingestd -c
+ *    lookup    print the records of an address (written as scan_dump prints it,
+ *              e.g. c0:55:44:33:22:11) and of a time range, as scan_dump does
+ *    info      print the segments of the index
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_idx.h"
+#include "scan_text.h"
+
+#define ADDR_LEN                6
+#define WATCH_INTERVAL_S        10
+
+static volatile sig_atomic_t m_stop;
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr,
+            "Usage: %s update <capture>\n"
+            "       %s watch [-i seconds] <capture>\n"
+            "       %s lookup [-a addr] [-s seconds] [-e seconds] <capture>\n"
+            "       %s info <capture>\n",
+            p_name, p_name, p_name, p_name);
+}
+
+
+/**@brief Function for reading an address written most significant byte first.
+ *
+ * @return 0 on success, -1 if the text is not an address.
+ */
+static int addr_parse(char const * p_text, uint8_t * p_addr)
+{
+    unsigned bytes[ADDR_LEN];
+    char     end;
+
+    if (sscanf(p_text, "%2x:%2x:%2x:%2x:%2x:%2x%c",
+               &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0], &end) != ADDR_LEN)
+    {
+        return -1;
+    }
+    for (int i = 0; i < ADDR_LEN; i++)
+    {
+        p_addr[i] = (uint8_t)bytes[i];
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for reading a time in seconds as microseconds.
+ *
+ * @return 0 on success, -1 if the text is not a time.
+ */
+static int time_parse(char const * p_text, uint64_t * p_us)
+{
+    char * p_end;
+    double seconds = strtod(p_text, &p_end);
+
+    if ((p_end == p_text) || (*p_end != '\0') || (seconds < 0))
+    {
+        return -1;
+    }
+    *p_us = (uint64_t)(seconds * 1e6 + 0.5);
+
+    return 0;
+}
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/**@brief Function for updating the index and printing what was done.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int update_print(char const * p_capture, bool quiet)
+{
+    scan_idx_update_stats_t stats;
+    double                  start = now_s();
+
+    if (scan_idx_update(p_capture, &stats) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", p_capture, strerror(errno));
+        return -1;
+    }
+    if (!quiet || (stats.bytes > 0) || stats.rebuilt)
+    {
+        fprintf(stderr, "indexed: %llu bytes, %llu records in %.3f s, segments added: %u%s%s\n",
+                (unsigned long long)stats.bytes, (unsigned long long)stats.records, now_s() - start,
+                stats.segments, stats.merged ? ", merged" : "", stats.rebuilt ? ", rebuilt" : "");
+    }
+
+    return 0;
+}
+
+
+static int update_run(int argc, char * argv[])
+{
+    if (argc != 2)
+    {
+        return -1;
+    }
+    if (update_print(argv[1], false) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+
+static void signal_handle(int sig)
+{
+    (void)sig;
+    m_stop = 1;
+}
+
+
+static int watch_run(int argc, char * argv[])
+{
+    struct sigaction sa = { .sa_handler = signal_handle };
+    unsigned         interval = WATCH_INTERVAL_S;
+    int              opt;
+
+    while ((opt = getopt(argc, argv, "i:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                interval = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                return -1;
+        }
+    }
+    if ((optind != argc - 1) || (interval == 0))
+    {
+        return -1;
+    }
+
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (!m_stop)
+    {
+        if (update_print(argv[optind], true) != 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+        for (unsigned i = 0; (i < interval) && !m_stop; i++)
+        {
+            sleep(1);
+        }
+    }
+
+    // What came in since the last update.
+    if (update_print(argv[optind], true) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+
+static void record_print(scan_record_t const * p_record, void * p_context)
+{
+    scan_text_record_print(p_context, p_record);
+}
+
+
+static int lookup_run(int argc, char * argv[])
+{
+    scan_idx_query_t        query = { .t_max = UINT64_MAX };
+    scan_idx_lookup_stats_t stats;
+    scan_idx_t            * p_idx;
+    scan_text_t             text;
+    double                  start;
+    int                     opt;
+
+    while ((opt = getopt(argc, argv, "a:s:e:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                if (addr_parse(optarg, query.addr) != 0)
+                {
+                    return -1;
+                }
+                query.by_addr = true;
+                break;
+
+            case 's':
+                if (time_parse(optarg, &query.t_min) != 0)
+                {
+                    return -1;
+                }
+                break;
+
+            case 'e':
+                if (time_parse(optarg, &query.t_max) != 0)
+                {
+                    return -1;
+                }
+                break;
+
+            default:
+                return -1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        return -1;
+    }
+
+    start = now_s();
+    if (scan_idx_open(&p_idx, argv[optind]) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    scan_text_init(&text, stdout);
+    if (scan_idx_lookup(p_idx, &query, record_print, &text, &stats) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    scan_idx_close(p_idx);
+
+    fprintf(stderr, "records: %llu, frames read: %llu, segments: %u, %.3f ms\n",
+            (unsigned long long)stats.records, (unsigned long long)stats.frames_read, stats.segments,
+            (now_s() - start) * 1e3);
+
+    return 0;
+}
+
+
+static int info_run(int argc, char * argv[])
+{
+    scan_idx_segment_t const * p_segments;
+    scan_idx_hdr_t const     * p_hdr;
+    scan_idx_t               * p_idx;
+    uint64_t                   postings = 0;
+
+    if (argc != 2)
+    {
+        return -1;
+    }
+
+    if (scan_idx_open(&p_idx, argv[1]) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    p_hdr = scan_idx_info(p_idx, &p_segments);
+
+    printf("%-24s %12s %10s %12s %24s\n", "capture bytes", "records", "addresses", "times", "time");
+    for (uint32_t i = 0; i < p_hdr->segments; i++)
+    {
+        scan_idx_segment_t const * p_segment = &p_segments[i];
+        char                       range[32];
+
+        snprintf(range, sizeof(range), "%llu-%llu",
+                 (unsigned long long)p_segment->capture_start, (unsigned long long)p_segment->capture_end);
+        printf("%-24s %12llu %10u %12u %11llu.%06llu-%llu.%06llu\n", range,
+               (unsigned long long)p_segment->postings, p_segment->addresses, p_segment->times,
+               (unsigned long long)(p_segment->t_min / 1000000), (unsigned long long)(p_segment->t_min % 1000000),
+               (unsigned long long)(p_segment->t_max / 1000000), (unsigned long long)(p_segment->t_max % 1000000));
+        postings += p_segment->postings;
+    }
+    printf("segments: %u, records: %llu, capture bytes indexed: %llu\n", p_hdr->segments,
+           (unsigned long long)postings, (unsigned long long)p_hdr->indexed_len);
+    scan_idx_close(p_idx);
+
+    return 0;
+}
+
+
+int main(int argc, char * argv[])
+{
+    int err = -1;
+
+    if (argc >= 2)
+    {
+        // The options of the command follow it.
+        if (strcmp(argv[1], "update") == 0)
+        {
+            err = update_run(argc - 1, &argv[1]);
+        }
+        else if (strcmp(argv[1], "watch") == 0)
+        {
+            err = watch_run(argc - 1, &argv[1]);
+        }
+        else if (strcmp(argv[1], "lookup") == 0)
+        {
+            err = lookup_run(argc - 1, &argv[1]);
+        }
+        else if (strcmp(argv[1], "info") == 0)
+        {
+            err = info_run(argc - 1, &argv[1]);
+        }
+    }
+
+    if (err != 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
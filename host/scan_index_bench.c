@@ -0,0 +1,403 @@
+/***************************************************************************************/
+/*
+ * scan_index_bench
+ *
+ *  Measures the index of the binary captures (scan_idx) on a capture generated on
+ *  disk: a survey of advertisers heard at a steady rate, with a statistics record
+ *  now and then, 10 GB by default. Nine tenths of the capture are written and
+ *  indexed, then the rest is appended and indexed by an update, as scan_index watch
+ *  does behind scan_ingestd.
+ *
+ *  The lookups are made with capture and index out of the page cache: the history
+ *  of a few advertisers, whole and within a tenth of the survey. The last lookup is
+ *  also made the way it is without an index, reading the whole capture through the
+ *  decoder, and both must find the same records.
+ *
+ *  Usage: scan_index_bench [-g gigabytes] [-d devices] [-r reports_per_second] [-t directory]
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "scan_idx.h"
+
+#define QUERIES         8
+#define WRITE_BUF_SIZE  (4u << 20)
+#define STATS_INTERVAL  100000                                          /**< Reports between two statistics records. */
+
+/**@brief Capture generator. */
+typedef struct
+{
+    uint32_t seed;
+    uint32_t devices;
+    uint64_t timestamp_us;
+    uint32_t interval_us;                                               /**< Time between reports. */
+    uint64_t reports;
+} survey_t;
+
+/**@brief Records found by a lookup. */
+typedef struct
+{
+    uint64_t records;
+    uint64_t sum;                                                       /**< Sum of their times, to compare the lookups. */
+} result_t;
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static uint32_t random_next(survey_t * p_survey)
+{
+    p_survey->seed = p_survey->seed * 1103515245 + 12345;
+
+    return p_survey->seed >> 8;
+}
+
+
+static void addr_make(uint32_t device, uint8_t * p_addr)
+{
+    memcpy(p_addr, &device, sizeof(device));
+    p_addr[4] = 0x00;
+    p_addr[5] = 0xC0;
+}
+
+
+static void fail(char const * p_path)
+{
+    fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+
+/**@brief Function for writing the next frames of the survey to a buffer.
+ *
+ * @return Bytes written, at most @p size.
+ */
+static size_t frames_make(survey_t * p_survey, uint8_t * p_buf, size_t size)
+{
+    size_t len = 0;
+
+    while (size - len >= SCAN_FRAME_OVERHEAD + SCAN_FRAME_MAX_PAYLOAD)
+    {
+        uint8_t           payload[sizeof(scan_report_hdr_t) + 31];
+        scan_report_hdr_t hdr    = { 0 };
+        uint32_t          device = random_next(p_survey) % p_survey->devices;
+        uint8_t         * p_data = &payload[sizeof(hdr)];
+
+        p_survey->timestamp_us += p_survey->interval_us / 2 + random_next(p_survey) % p_survey->interval_us;
+
+        if ((p_survey->reports % STATS_INTERVAL) == 0)
+        {
+            scan_stats_t stats = { .timestamp_us = p_survey->timestamp_us, .reports_sent = (uint32_t)p_survey->reports };
+
+            len += scan_frame_build(SCAN_FRAME_TYPE_STATS, &stats, sizeof(stats), &p_buf[len], size - len);
+        }
+
+        hdr.timestamp_us  = p_survey->timestamp_us;
+        addr_make(device, hdr.addr);
+        hdr.addr_type     = 1;
+        hdr.rssi          = (int8_t)(-40 - (int)(random_next(p_survey) % 50));
+        hdr.tx_power      = SCAN_REPORT_TX_POWER_INVALID;
+        hdr.primary_phy   = 1;
+        hdr.ch_index      = (uint8_t)(37 + random_next(p_survey) % 3);
+        hdr.set_id        = SCAN_REPORT_SET_ID_INVALID;
+        hdr.data_len      = (uint16_t)(20 + device % 12);
+        for (size_t i = 0; i < hdr.data_len; i++)
+        {
+            p_data[i] = (uint8_t)(device * 31 + i);
+        }
+        memcpy(payload, &hdr, sizeof(hdr));
+
+        len += scan_frame_build(SCAN_FRAME_TYPE_ADV_REPORT, payload, (uint16_t)(sizeof(hdr) + hdr.data_len),
+                                &p_buf[len], size - len);
+        p_survey->reports++;
+    }
+
+    return len;
+}
+
+
+/**@brief Function for appending @p bytes of the survey to the capture.
+ *
+ * @return Seconds taken.
+ */
+static double capture_write(char const * p_path, survey_t * p_survey, uint64_t bytes)
+{
+    uint8_t * p_buf   = malloc(WRITE_BUF_SIZE);
+    uint64_t  written = 0;
+    double    start   = now_s();
+    int       fd      = open(p_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if ((fd < 0) || (p_buf == NULL))
+    {
+        fail(p_path);
+    }
+    while (written < bytes)
+    {
+        size_t len = frames_make(p_survey, p_buf, WRITE_BUF_SIZE);
+
+        for (size_t done = 0; done < len; )
+        {
+            ssize_t n = write(fd, &p_buf[done], len - done);
+
+            if (n < 0)
+            {
+                fail(p_path);
+            }
+            done += (size_t)n;
+        }
+        written += len;
+    }
+    if ((fsync(fd) != 0) || (close(fd) != 0))
+    {
+        fail(p_path);
+    }
+    free(p_buf);
+
+    return now_s() - start;
+}
+
+
+/**@brief Function for taking a file out of the page cache. */
+static void cache_drop(char const * p_path)
+{
+    int fd = open(p_path, O_RDONLY);
+
+    if (fd >= 0)
+    {
+        (void)fdatasync(fd);
+        (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+static void record_add(scan_record_t const * p_record, void * p_context)
+{
+    result_t * p_result = p_context;
+    uint64_t   t_us;
+
+    memcpy(&t_us, p_record->p_payload, sizeof(t_us));
+    p_result->records++;
+    p_result->sum += t_us;
+}
+
+
+/**@brief The baseline: the whole capture through the decoder. */
+typedef struct
+{
+    scan_idx_query_t const * p_query;
+    result_t                 result;
+} scan_ctx_t;
+
+
+static void record_scan(scan_record_t const * p_record, void * p_context)
+{
+    scan_ctx_t        * p_ctx = p_context;
+    scan_report_hdr_t   hdr;
+
+    if ((p_record->type == SCAN_FRAME_TYPE_ADV_REPORT) && (p_record->len >= sizeof(hdr)))
+    {
+        memcpy(&hdr, p_record->p_payload, sizeof(hdr));
+        if ((memcmp(hdr.addr, p_ctx->p_query->addr, sizeof(hdr.addr)) == 0) &&
+            (hdr.timestamp_us >= p_ctx->p_query->t_min) && (hdr.timestamp_us <= p_ctx->p_query->t_max))
+        {
+            record_add(p_record, &p_ctx->result);
+        }
+    }
+}
+
+
+static result_t capture_scan(char const * p_path, scan_idx_query_t const * p_query)
+{
+    static uint8_t buf[1u << 20];
+    scan_decoder_t decoder;
+    scan_ctx_t     ctx = { .p_query = p_query };
+    int            fd  = open(p_path, O_RDONLY);
+    ssize_t        n;
+
+    if (fd < 0)
+    {
+        fail(p_path);
+    }
+    scan_decoder_init(&decoder, record_scan, &ctx);
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+    {
+        scan_decoder_feed(&decoder, buf, (size_t)n);
+    }
+    scan_decoder_flush(&decoder);
+    close(fd);
+
+    return ctx.result;
+}
+
+
+static uint64_t file_size(char const * p_path)
+{
+    struct stat st;
+
+    return (stat(p_path, &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+
+int main(int argc, char * argv[])
+{
+    survey_t                survey = { .seed = 1 };
+    scan_idx_update_stats_t update;
+    scan_idx_query_t        queries[QUERIES * 2];
+    result_t                results[QUERIES * 2] = { { 0 } };
+    result_t                baseline;
+    scan_idx_t            * p_idx;
+    double                  gigabytes = 10;
+    uint32_t                devices   = 10000;
+    uint32_t                rate      = 1000;
+    char const            * p_dir     = "/tmp";
+    char                    path[256];
+    char                    index[272];
+    uint64_t                bytes;
+    uint64_t                first_bytes;
+    double                  elapsed;
+    double                  max_ms[2] = { 0 };
+    double                  total_ms[2] = { 0 };
+    int                     opt;
+
+    while ((opt = getopt(argc, argv, "g:d:r:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'g':
+                gigabytes = strtod(optarg, NULL);
+                break;
+
+            case 'd':
+                devices = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'r':
+                rate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 't':
+                p_dir = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-g gigabytes] [-d devices] [-r reports_per_second] [-t directory]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((gigabytes <= 0) || (devices == 0) || (rate == 0) || (rate > 1000000))
+    {
+        fprintf(stderr, "bad survey\n");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(path, sizeof(path), "%s/scan_index_bench.bin", p_dir);
+    snprintf(index, sizeof(index), "%s.idx", path);
+    unlink(path);
+    unlink(index);
+    survey.devices     = devices;
+    survey.interval_us = 1000000 / rate;
+    bytes              = (uint64_t)(gigabytes * 1e9);
+    first_bytes        = bytes / 10 * 9;
+
+    // Nine tenths, indexed at once.
+    elapsed = capture_write(path, &survey, first_bytes);
+    printf("capture: %.2f GB written at %.0f MB/s\n", (double)file_size(path) / 1e9,
+           (double)file_size(path) / elapsed / 1e6);
+    cache_drop(path);
+    elapsed = now_s();
+    if (scan_idx_update(path, &update) != 0)
+    {
+        fail(index);
+    }
+    elapsed = now_s() - elapsed;
+    printf("build:   %llu records, %.2f GB in %.1f s, %.0f MB/s, %u segments%s\n",
+           (unsigned long long)update.records, (double)update.bytes / 1e9, elapsed,
+           (double)update.bytes / elapsed / 1e6, update.segments, update.merged ? ", merged" : "");
+
+    // The rest, appended and indexed by an update.
+    elapsed = capture_write(path, &survey, bytes - first_bytes);
+    elapsed = now_s();
+    if (scan_idx_update(path, &update) != 0)
+    {
+        fail(index);
+    }
+    elapsed = now_s() - elapsed;
+    printf("update:  %llu records, %.2f GB in %.1f s, %.0f MB/s, %u segments%s\n",
+           (unsigned long long)update.records, (double)update.bytes / 1e9, elapsed,
+           (double)update.bytes / elapsed / 1e6, update.segments, update.merged ? ", merged" : "");
+    printf("index:   %.2f GB, %.1f%% of the capture, %llu reports over %.1f hours\n\n",
+           (double)file_size(index) / 1e9, 100.0 * (double)file_size(index) / (double)file_size(path),
+           (unsigned long long)survey.reports, (double)survey.timestamp_us / 3600e6);
+
+    // The whole history of a few advertisers, then a tenth of it.
+    for (uint32_t i = 0; i < QUERIES; i++)
+    {
+        scan_idx_query_t * p_query = &queries[i];
+
+        *p_query = (scan_idx_query_t){ .by_addr = true, .t_max = UINT64_MAX };
+        addr_make((i * 7919 + 13) % devices, p_query->addr);
+        queries[QUERIES + i]       = *p_query;
+        addr_make((i * 7919 + 5003) % devices, queries[QUERIES + i].addr);
+        queries[QUERIES + i].t_min = survey.timestamp_us / QUERIES * i;
+        queries[QUERIES + i].t_max = queries[QUERIES + i].t_min + survey.timestamp_us / 10;
+    }
+
+    cache_drop(path);
+    cache_drop(index);
+    elapsed = now_s();
+    if (scan_idx_open(&p_idx, path) != 0)
+    {
+        fail(index);
+    }
+    printf("open:    %.3f ms\n", (now_s() - elapsed) * 1e3);
+    for (uint32_t i = 0; i < QUERIES * 2; i++)
+    {
+        double ms = now_s();
+
+        if (scan_idx_lookup(p_idx, &queries[i], record_add, &results[i], NULL) != 0)
+        {
+            fail(index);
+        }
+        ms = (now_s() - ms) * 1e3;
+        total_ms[i / QUERIES] += ms;
+        max_ms[i / QUERIES]    = (ms > max_ms[i / QUERIES]) ? ms : max_ms[i / QUERIES];
+    }
+    scan_idx_close(p_idx);
+    printf("lookup:  whole history, %.0f records: %.1f ms on average, %.1f ms at most\n",
+           (double)(results[0].records + results[QUERIES - 1].records) / 2, total_ms[0] / QUERIES, max_ms[0]);
+    printf("lookup:  tenth of the survey, %.0f records: %.1f ms on average, %.1f ms at most\n",
+           (double)(results[QUERIES].records + results[2 * QUERIES - 1].records) / 2, total_ms[1] / QUERIES, max_ms[1]);
+
+    cache_drop(path);
+    elapsed  = now_s();
+    baseline = capture_scan(path, &queries[2 * QUERIES - 1]);
+    elapsed  = now_s() - elapsed;
+    printf("scan:    tenth of the survey, %llu records: %.1f s, %.0fx the lookup\n",
+           (unsigned long long)baseline.records, elapsed, elapsed * 1e3 / (total_ms[1] / QUERIES));
+
+    unlink(path);
+    unlink(index);
+
+    if ((baseline.records != results[2 * QUERIES - 1].records) || (baseline.sum != results[2 * QUERIES - 1].sum))
+    {
+        printf("MISMATCH\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
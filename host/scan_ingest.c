@@ -0,0 +1,839 @@
+/***************************************************************************************/
+/*
+ * scan_ingest
+ *
+ *  Ingest pipeline of the scanner output.
+ *
+ *  The batches are a fixed pool used in turn: the framer fills batch n, the workers
+ *  format any filled batch, and the writer waits for batch n to be formatted before
+ *  writing it and giving it back to the framer. The text therefore comes out in the
+ *  order of the stream, and a slow writer ends up holding the framer, then the reader,
+ *  back, with the ring as the last buffer.
+*/
+/***************************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "scan_col.h"
+#include "scan_decoder.h"
+#include "scan_ingest.h"
+#include "scan_text.h"
+
+#define BATCH_SIZE              65536                                   /**< Bytes of records per batch. */
+#define BATCHES_PER_WORKER      4
+#define RECORD_HDR_LEN          3                                       /**< Type and length in front of each record of a batch. */
+#define POLL_TIMEOUT_MS         100                                     /**< Longest time before the reader sees a stop request. */
+#define ACCEPT_INTERVAL_MS      100                                     /**< Longest time before an idle writer takes new clients. */
+
+/**@brief States of a batch, in the order it goes through them. */
+typedef enum
+{
+    BATCH_FREE,                                                         /**< Owned by the framer, being filled. */
+    BATCH_FILLED,                                                       /**< Waiting for a worker. */
+    BATCH_FORMATTING,                                                   /**< Owned by a worker. */
+    BATCH_DONE,                                                         /**< Waiting for the writer. */
+} batch_state_t;
+
+/**@brief A batch of records and their text. */
+typedef struct
+{
+    batch_state_t  state;
+    uint8_t      * p_records;                                           /**< Records: type, length (LE16) and payload, one after another. */
+    size_t         len;                                                 /**< Bytes of records. */
+    scan_profile_t last_profile;                                        /**< Last profile record of the stream before the batch. */
+    FILE         * p_text;                                              /**< Text of the records, in memory. */
+    char         * p_text_buf;                                          /**< Buffer of @ref p_text. */
+    size_t         text_size;
+    size_t         text_len;                                            /**< Bytes of text. */
+} batch_t;
+
+struct scan_ingest_s
+{
+    scan_ingest_config_t config;
+    atomic_bool          stop;
+    pthread_t            reader;
+    pthread_t            framer;
+    pthread_t            writer;
+    pthread_t            workers[SCAN_INGEST_WORKERS_MAX];
+
+    // Ring between the reader and the framer. head and tail run freely.
+    pthread_mutex_t      ring_lock;
+    pthread_cond_t       ring_data;                                     /**< Bytes or end of stream for the framer. */
+    pthread_cond_t       ring_room;                                     /**< Room for the reader. */
+    uint8_t            * p_ring;
+    size_t               head;                                          /**< Bytes written by the reader. */
+    size_t               tail;                                          /**< Bytes taken by the framer. */
+    bool                 eof;                                           /**< The reader has ended. */
+
+    // Batches.
+    pthread_mutex_t      batch_lock;
+    pthread_cond_t       batch_filled;                                  /**< A batch for the workers, or the end of the framer. */
+    pthread_cond_t       batch_done;                                    /**< A batch for the writer. */
+    pthread_cond_t       batch_free;                                    /**< A batch for the framer. */
+    batch_t            * p_batches;
+    unsigned             batch_count;
+    uint64_t             fill_seq;                                      /**< Next batch the framer fills. */
+    uint64_t             work_seq;                                      /**< Next batch a worker takes. */
+    uint64_t             write_seq;                                     /**< Next batch the writer writes. */
+    bool                 framer_done;
+
+    // Framer state.
+    scan_decoder_t       decoder;
+    batch_t            * p_fill;                                        /**< Batch being filled, NULL if none. */
+    scan_profile_t       last_profile;                                  /**< Last profile record seen. */
+
+    // Socket clients, writer only.
+    int                  listen_fd;
+    int                  clients[SCAN_INGEST_CLIENTS_MAX];
+
+    scan_col_writer_t  * p_store;                                       /**< Columnar file, writer only, or NULL. */
+
+    scan_ingest_stats_t  stats;                                         /**< Each counter is updated under the lock of its thread's data. */
+};
+
+
+/**@brief Function for writing a whole buffer to a file descriptor.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int write_all(int fd, void const * p_data, size_t len)
+{
+    uint8_t const * p = p_data;
+
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+
+/**@brief Reader thread: moves the bytes of the source into the ring. */
+static void * reader_run(void * p_arg)
+{
+    scan_ingest_t * p_ingest = p_arg;
+    size_t          size     = p_ingest->config.ring_size;
+    int             fd       = p_ingest->config.fd;
+
+    while (!atomic_load(&p_ingest->stop))
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        size_t        room;
+        size_t        offset;
+        ssize_t       n;
+
+        pthread_mutex_lock(&p_ingest->ring_lock);
+        if (p_ingest->head - p_ingest->tail == size)
+        {
+            p_ingest->stats.reader_stalls++;
+            while ((p_ingest->head - p_ingest->tail == size) && !atomic_load(&p_ingest->stop))
+            {
+                pthread_cond_wait(&p_ingest->ring_room, &p_ingest->ring_lock);
+            }
+        }
+        offset = p_ingest->head & (size - 1);
+        room   = size - (p_ingest->head - p_ingest->tail);
+        pthread_mutex_unlock(&p_ingest->ring_lock);
+
+        // Up to the end of the ring, the next read wraps around.
+        room = (room < size - offset) ? room : size - offset;
+        if (room == 0)
+        {
+            continue;
+        }
+
+        if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0)
+        {
+            continue;
+        }
+
+        n = read(fd, &p_ingest->p_ring[offset], room);
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EINTR))
+            {
+                continue;
+            }
+            // EIO: the other end of a pty has gone.
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&p_ingest->ring_lock);
+        p_ingest->head += (size_t)n;
+        if (p_ingest->head - p_ingest->tail > p_ingest->stats.ring_high_water)
+        {
+            p_ingest->stats.ring_high_water = p_ingest->head - p_ingest->tail;
+        }
+        p_ingest->stats.bytes_read += (uint64_t)n;
+        p_ingest->stats.reads++;
+        pthread_cond_signal(&p_ingest->ring_data);
+        pthread_mutex_unlock(&p_ingest->ring_lock);
+    }
+
+    pthread_mutex_lock(&p_ingest->ring_lock);
+    p_ingest->eof = true;
+    pthread_cond_signal(&p_ingest->ring_data);
+    pthread_mutex_unlock(&p_ingest->ring_lock);
+
+    return NULL;
+}
+
+
+/**@brief Function for handing the batch being filled over to the workers. */
+static void batch_push(scan_ingest_t * p_ingest)
+{
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    p_ingest->p_fill->state = BATCH_FILLED;
+    p_ingest->fill_seq++;
+    p_ingest->stats.frames     = p_ingest->decoder.frames;
+    p_ingest->stats.crc_errors = p_ingest->decoder.crc_errors;
+    p_ingest->stats.skipped    = p_ingest->decoder.skipped;
+    pthread_cond_signal(&p_ingest->batch_filled);
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+
+    p_ingest->p_fill = NULL;
+}
+
+
+/**@brief Function for getting the next batch to fill, once the writer has given it back. */
+static batch_t * batch_get(scan_ingest_t * p_ingest)
+{
+    batch_t * p_batch = &p_ingest->p_batches[p_ingest->fill_seq % p_ingest->batch_count];
+
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    while (p_batch->state != BATCH_FREE)
+    {
+        pthread_cond_wait(&p_ingest->batch_free, &p_ingest->batch_lock);
+    }
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+
+    p_batch->len          = 0;
+    p_batch->last_profile = p_ingest->last_profile;
+
+    return p_batch;
+}
+
+
+/**@brief Function for adding a decoded record to the batch being filled. */
+static void record_add(scan_record_t const * p_record, void * p_context)
+{
+    scan_ingest_t * p_ingest = p_context;
+    batch_t       * p_batch;
+
+    if ((p_ingest->p_fill != NULL) && (p_ingest->p_fill->len + RECORD_HDR_LEN + p_record->len > BATCH_SIZE))
+    {
+        batch_push(p_ingest);
+    }
+    if (p_ingest->p_fill == NULL)
+    {
+        p_ingest->p_fill = batch_get(p_ingest);
+    }
+    p_batch = p_ingest->p_fill;
+
+    p_batch->p_records[p_batch->len]     = p_record->type;
+    p_batch->p_records[p_batch->len + 1] = (uint8_t)p_record->len;
+    p_batch->p_records[p_batch->len + 2] = (uint8_t)(p_record->len >> 8);
+    memcpy(&p_batch->p_records[p_batch->len + RECORD_HDR_LEN], p_record->p_payload, p_record->len);
+    p_batch->len += RECORD_HDR_LEN + p_record->len;
+
+    if ((p_record->type == SCAN_FRAME_TYPE_PROFILE) && (p_record->len >= sizeof(scan_profile_t)))
+    {
+        memcpy(&p_ingest->last_profile, p_record->p_payload, sizeof(scan_profile_t));
+    }
+}
+
+
+/**@brief Function for telling the workers and the writer that no more batches will come. */
+static void framer_end(scan_ingest_t * p_ingest)
+{
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    p_ingest->stats.frames     = p_ingest->decoder.frames;
+    p_ingest->stats.crc_errors = p_ingest->decoder.crc_errors;
+    p_ingest->stats.skipped    = p_ingest->decoder.skipped;
+    p_ingest->framer_done      = true;
+    pthread_cond_broadcast(&p_ingest->batch_filled);
+    pthread_cond_broadcast(&p_ingest->batch_done);
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+}
+
+
+/**@brief Framer thread: cuts the bytes of the ring into records and batches them.
+ *
+ * @details A batch is handed over when it is full, or when the ring runs dry so that
+ *          the records do not wait for more traffic.
+ */
+static void * framer_run(void * p_arg)
+{
+    scan_ingest_t * p_ingest = p_arg;
+    size_t          size     = p_ingest->config.ring_size;
+
+    for (;;)
+    {
+        uint8_t const * p_data;
+        size_t          len;
+        bool            drained;
+
+        pthread_mutex_lock(&p_ingest->ring_lock);
+        while ((p_ingest->head == p_ingest->tail) && !p_ingest->eof)
+        {
+            pthread_cond_wait(&p_ingest->ring_data, &p_ingest->ring_lock);
+        }
+        len = p_ingest->head - p_ingest->tail;
+        pthread_mutex_unlock(&p_ingest->ring_lock);
+
+        if (len == 0)
+        {
+            break;
+        }
+
+        // Up to the end of the ring, the rest comes on the next turn.
+        p_data = &p_ingest->p_ring[p_ingest->tail & (size - 1)];
+        if (len > size - (p_ingest->tail & (size - 1)))
+        {
+            len = size - (p_ingest->tail & (size - 1));
+        }
+
+        if ((p_ingest->config.raw_fd >= 0) && (write_all(p_ingest->config.raw_fd, p_data, len) != 0))
+        {
+            perror("raw capture");
+            p_ingest->config.raw_fd = -1;
+        }
+        scan_decoder_feed(&p_ingest->decoder, p_data, len);
+
+        pthread_mutex_lock(&p_ingest->ring_lock);
+        p_ingest->tail += len;
+        drained = (p_ingest->head == p_ingest->tail);
+        pthread_cond_signal(&p_ingest->ring_room);
+        pthread_mutex_unlock(&p_ingest->ring_lock);
+
+        if (drained && (p_ingest->p_fill != NULL))
+        {
+            batch_push(p_ingest);
+        }
+    }
+
+    scan_decoder_flush(&p_ingest->decoder);
+    if (p_ingest->p_fill != NULL)
+    {
+        batch_push(p_ingest);
+    }
+
+    framer_end(p_ingest);
+
+    return NULL;
+}
+
+
+/**@brief Function for turning the records of a batch into text. */
+static void batch_format(batch_t * p_batch)
+{
+    scan_text_t text;
+    size_t      offset = 0;
+
+    rewind(p_batch->p_text);
+    scan_text_init(&text, p_batch->p_text);
+    text.last_profile = p_batch->last_profile;
+
+    while (offset + RECORD_HDR_LEN <= p_batch->len)
+    {
+        scan_record_t record =
+        {
+            .type      = p_batch->p_records[offset],
+            .len       = (uint16_t)(p_batch->p_records[offset + 1] | (p_batch->p_records[offset + 2] << 8)),
+            .p_payload = &p_batch->p_records[offset + RECORD_HDR_LEN],
+        };
+
+        scan_text_record_print(&text, &record);
+        offset += RECORD_HDR_LEN + record.len;
+    }
+
+    fflush(p_batch->p_text);
+    p_batch->text_len = (size_t)ftell(p_batch->p_text);
+}
+
+
+/**@brief Worker thread: formats the filled batches, in any order. */
+static void * worker_run(void * p_arg)
+{
+    scan_ingest_t * p_ingest = p_arg;
+
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    for (;;)
+    {
+        batch_t * p_batch;
+
+        while ((p_ingest->work_seq == p_ingest->fill_seq) && !p_ingest->framer_done)
+        {
+            pthread_cond_wait(&p_ingest->batch_filled, &p_ingest->batch_lock);
+        }
+        if (p_ingest->work_seq == p_ingest->fill_seq)
+        {
+            break;
+        }
+
+        p_batch        = &p_ingest->p_batches[p_ingest->work_seq % p_ingest->batch_count];
+        p_batch->state = BATCH_FORMATTING;
+        p_ingest->work_seq++;
+        pthread_mutex_unlock(&p_ingest->batch_lock);
+
+        batch_format(p_batch);
+
+        pthread_mutex_lock(&p_ingest->batch_lock);
+        p_batch->state = BATCH_DONE;
+        pthread_cond_broadcast(&p_ingest->batch_done);
+    }
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+
+    return NULL;
+}
+
+
+/**@brief Function for taking the clients waiting on the socket. */
+static void clients_accept(scan_ingest_t * p_ingest)
+{
+    int fd;
+
+    if (p_ingest->listen_fd < 0)
+    {
+        return;
+    }
+
+    while ((fd = accept4(p_ingest->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        size_t i;
+
+        for (i = 0; i < SCAN_INGEST_CLIENTS_MAX; i++)
+        {
+            if (p_ingest->clients[i] < 0)
+            {
+                p_ingest->clients[i] = fd;
+                p_ingest->stats.clients++;
+                break;
+            }
+        }
+        if (i == SCAN_INGEST_CLIENTS_MAX)
+        {
+            close(fd);
+        }
+    }
+}
+
+
+/**@brief Function for sending text to every client, dropping those that fall behind. */
+static void clients_send(scan_ingest_t * p_ingest, char const * p_text, size_t len)
+{
+    for (size_t i = 0; i < SCAN_INGEST_CLIENTS_MAX; i++)
+    {
+        size_t done = 0;
+
+        if (p_ingest->clients[i] < 0)
+        {
+            continue;
+        }
+
+        while (done < len)
+        {
+            ssize_t n = send(p_ingest->clients[i], &p_text[done], len - done, MSG_NOSIGNAL);
+
+            if (n < 0)
+            {
+                break;
+            }
+            done += (size_t)n;
+        }
+
+        if (done < len)
+        {
+            // Gone, or its socket buffer is full: it cannot keep up.
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                p_ingest->stats.clients_dropped++;
+            }
+            close(p_ingest->clients[i]);
+            p_ingest->clients[i] = -1;
+            p_ingest->stats.clients--;
+        }
+    }
+}
+
+
+/**@brief Function for storing the advertising reports of a batch in the columnar file. */
+static void batch_store(scan_ingest_t * p_ingest, batch_t const * p_batch)
+{
+    size_t offset = 0;
+
+    while (offset + RECORD_HDR_LEN <= p_batch->len)
+    {
+        scan_record_t record =
+        {
+            .type      = p_batch->p_records[offset],
+            .len       = (uint16_t)(p_batch->p_records[offset + 1] | (p_batch->p_records[offset + 2] << 8)),
+            .p_payload = &p_batch->p_records[offset + RECORD_HDR_LEN],
+        };
+
+        if (scan_col_writer_add(p_ingest->p_store, &record) != 0)
+        {
+            perror("store");
+            (void)scan_col_writer_close(p_ingest->p_store);
+            p_ingest->p_store = NULL;
+            return;
+        }
+        offset += RECORD_HDR_LEN + record.len;
+    }
+}
+
+
+/**@brief Writer thread: writes the formatted batches in order. */
+static void * writer_run(void * p_arg)
+{
+    scan_ingest_t * p_ingest = p_arg;
+
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    for (;;)
+    {
+        batch_t * p_batch = &p_ingest->p_batches[p_ingest->write_seq % p_ingest->batch_count];
+
+        while ((p_batch->state != BATCH_DONE)
+               && !(p_ingest->framer_done && (p_ingest->write_seq == p_ingest->fill_seq)))
+        {
+            struct timespec deadline;
+
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += ACCEPT_INTERVAL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&p_ingest->batch_done, &p_ingest->batch_lock, &deadline) == ETIMEDOUT)
+            {
+                clients_accept(p_ingest);
+            }
+        }
+        if (p_batch->state != BATCH_DONE)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&p_ingest->batch_lock);
+
+        if ((p_ingest->config.text_fd >= 0) &&
+            (write_all(p_ingest->config.text_fd, p_batch->p_text_buf, p_batch->text_len) != 0))
+        {
+            perror("text output");
+            p_ingest->config.text_fd = -1;
+        }
+        if (p_ingest->p_store != NULL)
+        {
+            batch_store(p_ingest, p_batch);
+        }
+
+        // Under the lock, for the client counters: the sends do not block.
+        pthread_mutex_lock(&p_ingest->batch_lock);
+        clients_accept(p_ingest);
+        clients_send(p_ingest, p_batch->p_text_buf, p_batch->text_len);
+        p_ingest->stats.text_bytes += p_batch->text_len;
+        p_ingest->stats.batches++;
+        p_batch->state = BATCH_FREE;
+        p_ingest->write_seq++;
+        pthread_cond_signal(&p_ingest->batch_free);
+    }
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+
+    return NULL;
+}
+
+
+/**@brief Function for creating the listening socket. */
+static int socket_listen(char const * p_path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int                fd;
+
+    if (strlen(p_path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, p_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    // Left over by a previous run.
+    (void)unlink(p_path);
+    if ((bind(fd, (struct sockaddr const *)&addr, sizeof(addr)) != 0) ||
+        (listen(fd, SCAN_INGEST_CLIENTS_MAX) != 0))
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/**@brief Function for freeing a pipeline whose threads are not running. */
+static void ingest_free(scan_ingest_t * p_ingest)
+{
+    for (unsigned i = 0; (p_ingest->p_batches != NULL) && (i < p_ingest->batch_count); i++)
+    {
+        if (p_ingest->p_batches[i].p_text != NULL)
+        {
+            fclose(p_ingest->p_batches[i].p_text);
+        }
+        free(p_ingest->p_batches[i].p_text_buf);
+        free(p_ingest->p_batches[i].p_records);
+    }
+    for (size_t i = 0; i < SCAN_INGEST_CLIENTS_MAX; i++)
+    {
+        if (p_ingest->clients[i] >= 0)
+        {
+            close(p_ingest->clients[i]);
+        }
+    }
+    if (p_ingest->listen_fd >= 0)
+    {
+        close(p_ingest->listen_fd);
+        (void)unlink(p_ingest->config.p_socket_path);
+    }
+    if ((p_ingest->p_store != NULL) && (scan_col_writer_close(p_ingest->p_store) != 0))
+    {
+        perror("store");
+    }
+
+    pthread_mutex_destroy(&p_ingest->ring_lock);
+    pthread_cond_destroy(&p_ingest->ring_data);
+    pthread_cond_destroy(&p_ingest->ring_room);
+    pthread_mutex_destroy(&p_ingest->batch_lock);
+    pthread_cond_destroy(&p_ingest->batch_filled);
+    pthread_cond_destroy(&p_ingest->batch_done);
+    pthread_cond_destroy(&p_ingest->batch_free);
+
+    free(p_ingest->p_batches);
+    free(p_ingest->p_ring);
+    free(p_ingest);
+}
+
+
+int scan_ingest_start(scan_ingest_t ** pp_ingest, scan_ingest_config_t const * p_config)
+{
+    scan_ingest_t * p_ingest;
+    unsigned        workers        = 0;
+    bool            framer_started = false;
+    int             err            = 0;
+    int             flags;
+
+    if ((p_config->ring_size < BATCH_SIZE) || ((p_config->ring_size & (p_config->ring_size - 1)) != 0) ||
+        (p_config->workers == 0) || (p_config->workers > SCAN_INGEST_WORKERS_MAX))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The reader must see the stop request, a read that blocks would hold it.
+    flags = fcntl(p_config->fd, F_GETFL);
+    if ((flags < 0) || (fcntl(p_config->fd, F_SETFL, flags | O_NONBLOCK) < 0))
+    {
+        return -1;
+    }
+
+    p_ingest = calloc(1, sizeof(*p_ingest));
+    if (p_ingest == NULL)
+    {
+        return -1;
+    }
+    p_ingest->config      = *p_config;
+    p_ingest->listen_fd   = -1;
+    p_ingest->batch_count = p_config->workers * BATCHES_PER_WORKER;
+    for (size_t i = 0; i < SCAN_INGEST_CLIENTS_MAX; i++)
+    {
+        p_ingest->clients[i] = -1;
+    }
+    atomic_init(&p_ingest->stop, false);
+    pthread_mutex_init(&p_ingest->ring_lock, NULL);
+    pthread_cond_init(&p_ingest->ring_data, NULL);
+    pthread_cond_init(&p_ingest->ring_room, NULL);
+    pthread_mutex_init(&p_ingest->batch_lock, NULL);
+    pthread_cond_init(&p_ingest->batch_filled, NULL);
+    pthread_cond_init(&p_ingest->batch_done, NULL);
+    pthread_cond_init(&p_ingest->batch_free, NULL);
+    scan_decoder_init(&p_ingest->decoder, record_add, p_ingest);
+
+    p_ingest->p_ring    = malloc(p_config->ring_size);
+    p_ingest->p_batches = calloc(p_ingest->batch_count, sizeof(batch_t));
+    if ((p_ingest->p_ring == NULL) || (p_ingest->p_batches == NULL))
+    {
+        ingest_free(p_ingest);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (unsigned i = 0; i < p_ingest->batch_count; i++)
+    {
+        batch_t * p_batch = &p_ingest->p_batches[i];
+
+        p_batch->p_records = malloc(BATCH_SIZE);
+        p_batch->p_text    = open_memstream(&p_batch->p_text_buf, &p_batch->text_size);
+        if ((p_batch->p_records == NULL) || (p_batch->p_text == NULL))
+        {
+            ingest_free(p_ingest);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    if (p_config->p_socket_path != NULL)
+    {
+        p_ingest->listen_fd = socket_listen(p_config->p_socket_path);
+        if (p_ingest->listen_fd < 0)
+        {
+            err = errno;
+            ingest_free(p_ingest);
+            errno = err;
+            return -1;
+        }
+    }
+
+    if ((p_config->p_store_path != NULL) &&
+        (scan_col_writer_open(&p_ingest->p_store, p_config->p_store_path, 0) != 0))
+    {
+        err = errno;
+        p_ingest->p_store = NULL;
+        ingest_free(p_ingest);
+        errno = err;
+        return -1;
+    }
+
+    // Consumers first, so that nothing waits on a thread that failed to start.
+    err = pthread_create(&p_ingest->writer, NULL, writer_run, p_ingest);
+    if (err != 0)
+    {
+        ingest_free(p_ingest);
+        errno = err;
+        return -1;
+    }
+    while ((err == 0) && (workers < p_config->workers))
+    {
+        err = pthread_create(&p_ingest->workers[workers], NULL, worker_run, p_ingest);
+        workers += (err == 0) ? 1 : 0;
+    }
+    if (err == 0)
+    {
+        err = pthread_create(&p_ingest->framer, NULL, framer_run, p_ingest);
+        framer_started = (err == 0);
+    }
+    if (err == 0)
+    {
+        err = pthread_create(&p_ingest->reader, NULL, reader_run, p_ingest);
+    }
+
+    if (err != 0)
+    {
+        if (framer_started)
+        {
+            // Ends the framer, which ends the others.
+            pthread_mutex_lock(&p_ingest->ring_lock);
+            p_ingest->eof = true;
+            pthread_cond_signal(&p_ingest->ring_data);
+            pthread_mutex_unlock(&p_ingest->ring_lock);
+            pthread_join(p_ingest->framer, NULL);
+        }
+        else
+        {
+            framer_end(p_ingest);
+        }
+        for (unsigned i = 0; i < workers; i++)
+        {
+            pthread_join(p_ingest->workers[i], NULL);
+        }
+        pthread_join(p_ingest->writer, NULL);
+        ingest_free(p_ingest);
+        errno = err;
+        return -1;
+    }
+
+    *pp_ingest = p_ingest;
+
+    return 0;
+}
+
+
+void scan_ingest_stop(scan_ingest_t * p_ingest)
+{
+    atomic_store(&p_ingest->stop, true);
+}
+
+
+void scan_ingest_stats_get(scan_ingest_t * p_ingest, scan_ingest_stats_t * p_stats)
+{
+    scan_ingest_stats_t stats;
+
+    pthread_mutex_lock(&p_ingest->ring_lock);
+    stats = p_ingest->stats;
+    pthread_mutex_unlock(&p_ingest->ring_lock);
+
+    pthread_mutex_lock(&p_ingest->batch_lock);
+    stats.frames          = p_ingest->stats.frames;
+    stats.crc_errors      = p_ingest->stats.crc_errors;
+    stats.skipped         = p_ingest->stats.skipped;
+    stats.batches         = p_ingest->stats.batches;
+    stats.text_bytes      = p_ingest->stats.text_bytes;
+    stats.clients         = p_ingest->stats.clients;
+    stats.clients_dropped = p_ingest->stats.clients_dropped;
+    pthread_mutex_unlock(&p_ingest->batch_lock);
+
+    *p_stats = stats;
+}
+
+
+void scan_ingest_wait(scan_ingest_t * p_ingest, scan_ingest_stats_t * p_stats)
+{
+    pthread_join(p_ingest->reader, NULL);
+    pthread_join(p_ingest->framer, NULL);
+    for (unsigned i = 0; i < p_ingest->config.workers; i++)
+    {
+        pthread_join(p_ingest->workers[i], NULL);
+    }
+    pthread_join(p_ingest->writer, NULL);
+
+    if (p_stats != NULL)
+    {
+        *p_stats = p_ingest->stats;
+    }
+
+    ingest_free(p_ingest);
+}
@@ -0,0 +1,102 @@
+/***************************************************************************************/
+/*
+ * scan_ingest
+ *
+ *  Ingest pipeline of the scanner output, for a daemon that has to keep up with the
+ *  serial stream whatever the consumers do.
+ *
+ *  A reader thread does non-blocking reads of the source into a large byte ring, so
+ *  the kernel buffer of the port is emptied as soon as data arrives. A framer thread
+ *  takes the bytes out of the ring, keeps an optional raw copy, cuts them into frames
+ *  (CRC checked) and packs the records into batches. A pool of worker threads turns
+ *  the batches into text lines (scan_text), in parallel. A writer thread writes the
+ *  lines of the batches, in order, to a file and to the clients of a Unix socket, and
+ *  stores their advertising reports in a columnar file (scan_col).
+ *
+ *  A socket client that cannot take the lines as fast as they come is disconnected
+ *  rather than slowing the pipeline down.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_INGEST_H__
+#define SCAN_INGEST_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_INGEST_WORKERS_MAX     16                                  /**< Most worker threads. */
+#define SCAN_INGEST_CLIENTS_MAX     16                                  /**< Most socket clients at once. */
+
+/**@brief Pipeline settings. */
+typedef struct
+{
+    int          fd;                                                    /**< Source: serial port, pty or capture file. Made non-blocking, left open. */
+    size_t       ring_size;                                             /**< Bytes of the ring between the reader and the framer, a power of two. */
+    unsigned     workers;                                               /**< Worker threads, 1 to @ref SCAN_INGEST_WORKERS_MAX. */
+    int          text_fd;                                               /**< Text lines, or -1. */
+    int          raw_fd;                                                /**< Copy of the raw stream, or -1. */
+    char const * p_socket_path;                                         /**< Unix socket serving the text lines, or NULL. */
+    char const * p_store_path;                                          /**< Columnar file of the advertising reports, or NULL. */
+} scan_ingest_config_t;
+
+/**@brief Pipeline counters. */
+typedef struct
+{
+    uint64_t bytes_read;                                                /**< Bytes read from the source. */
+    uint64_t reads;                                                     /**< read() calls that returned data. */
+    uint64_t reader_stalls;                                             /**< Times the reader found the ring full. */
+    size_t   ring_high_water;                                           /**< Most bytes held in the ring. */
+    uint64_t frames;                                                    /**< Valid frames decoded. */
+    uint64_t crc_errors;                                                /**< Candidate frames rejected by the CRC. */
+    uint64_t skipped;                                                   /**< Bytes discarded while searching for a frame. */
+    uint64_t batches;                                                   /**< Batches written. */
+    uint64_t text_bytes;                                                /**< Bytes of text lines written. */
+    uint32_t clients;                                                   /**< Socket clients connected now. */
+    uint64_t clients_dropped;                                           /**< Socket clients disconnected because they fell behind. */
+} scan_ingest_stats_t;
+
+/**@brief Pipeline instance. */
+typedef struct scan_ingest_s scan_ingest_t;
+
+
+/**@brief Function for starting the pipeline threads.
+ *
+ * @param[out]  pp_ingest   Pipeline instance.
+ * @param[in]   p_config    Settings, copied.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_ingest_start(scan_ingest_t ** pp_ingest, scan_ingest_config_t const * p_config);
+
+
+/**@brief Function for asking the pipeline to stop.
+ *
+ * @details The reader stops within 100 ms, the bytes already read are still decoded
+ *          and written. Can be called from a signal handler.
+ */
+void scan_ingest_stop(scan_ingest_t * p_ingest);
+
+
+/**@brief Function for reading the counters while the pipeline runs. */
+void scan_ingest_stats_get(scan_ingest_t * p_ingest, scan_ingest_stats_t * p_stats);
+
+
+/**@brief Function for waiting for the end of the pipeline and freeing it.
+ *
+ * @details The pipeline ends when it is stopped or when the source ends: end of
+ *          file, or hang-up of the port.
+ *
+ * @param[in]   p_ingest    Pipeline instance, freed.
+ * @param[out]  p_stats     Final counters. Can be NULL.
+ */
+void scan_ingest_wait(scan_ingest_t * p_ingest, scan_ingest_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_INGEST_H__
@@ -0,0 +1,272 @@
+/***************************************************************************************/
+/*
+ * scan_ingest_bench
+ *
+ *  Measures the rate the ingest pipeline (scan_ingest) sustains when fed from a pty
+ *  at full speed, with 1 to 8 worker threads. A mix of advertising reports, beacons,
+ *  summaries and statistics records is written to the master side as fast as the
+ *  kernel takes it; the pipeline reads the slave side and formats every record, the
+ *  text going to /dev/null.
+ *
+ *  The rate is compared with the most the scanner can send: 100000 bytes per second,
+ *  at 1000000 baud with 10 bits per byte. A run that does not decode every frame, or
+ *  finds CRC errors, is reported as failed.
+ *
+ *  Usage: scan_ingest_bench [-m megabytes] [-r ring_mb]
+*/
+/***************************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "scan_decoder.h"
+#include "scan_ingest.h"
+
+#define LINE_RATE               100000                                  /**< Bytes per second of the scanner at 1000000 baud. */
+#define PATTERN_FRAMES          4096                                    /**< Frames of the pattern written over and over. */
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/**@brief Function for making the pattern: mostly advertising reports of 20 to 60
+ *        bytes, with beacons, summaries and a statistics record now and then.
+ *
+ * @return Length of the pattern.
+ */
+static size_t pattern_make(uint8_t * p_buf, size_t size)
+{
+    size_t   len = 0;
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; i < PATTERN_FRAMES; i++)
+    {
+        uint8_t payload[SCAN_FRAME_MAX_PAYLOAD];
+        uint8_t type;
+        size_t  payload_len;
+
+        seed = seed * 1103515245 + 12345;
+        memset(payload, 0, sizeof(payload));
+
+        if (i % 256 == 0)
+        {
+            scan_stats_t stats = { .timestamp_us = i * 1000ull, .reports_received = i, .reports_sent = i };
+
+            type        = SCAN_FRAME_TYPE_STATS;
+            payload_len = sizeof(stats);
+            memcpy(payload, &stats, sizeof(stats));
+        }
+        else if (i % 16 == 0)
+        {
+            scan_alive_t alive = { .timestamp_us = i * 1000ull, .addr = { (uint8_t)i, 0x22, 0x33, 0x44, 0x55, 0xC0 },
+                                   .addr_type = 1, .rssi = -70, .count = 5 };
+
+            type        = SCAN_FRAME_TYPE_ALIVE;
+            payload_len = sizeof(alive);
+            memcpy(payload, &alive, sizeof(alive));
+        }
+        else if (i % 8 == 0)
+        {
+            scan_beacon_hdr_t hdr = { .timestamp_us = i * 1000ull, .addr = { (uint8_t)i, 0x22, 0x33, 0x44, 0x55, 0xC0 },
+                                      .addr_type = 1, .rssi = -60, .type = SCAN_BEACON_IBEACON };
+            scan_ibeacon_t    ibeacon = { .major = (uint16_t)i, .minor = 7, .measured_power = -59 };
+
+            memset(ibeacon.uuid, 0xE2, sizeof(ibeacon.uuid));
+            type        = SCAN_FRAME_TYPE_BEACON;
+            payload_len = sizeof(hdr) + sizeof(ibeacon);
+            memcpy(payload, &hdr, sizeof(hdr));
+            memcpy(&payload[sizeof(hdr)], &ibeacon, sizeof(ibeacon));
+        }
+        else
+        {
+            scan_report_hdr_t hdr = { .timestamp_us = i * 1000ull, .addr = { (uint8_t)i, (uint8_t)(i >> 8), 0x33, 0x44, 0x55, 0xC0 },
+                                      .addr_type = 1, .rssi = (int8_t)(-40 - (int)(seed >> 28) * 4),
+                                      .tx_power = SCAN_REPORT_TX_POWER_INVALID, .primary_phy = 1,
+                                      .set_id = SCAN_REPORT_SET_ID_INVALID };
+
+            hdr.data_len = (uint16_t)(20 + (seed >> 16) % 41);
+            type         = SCAN_FRAME_TYPE_ADV_REPORT;
+            payload_len  = sizeof(hdr) + hdr.data_len;
+            memcpy(payload, &hdr, sizeof(hdr));
+            for (uint16_t j = 0; j < hdr.data_len; j++)
+            {
+                payload[sizeof(hdr) + j] = (uint8_t)(seed >> (j % 24));
+            }
+        }
+
+        len += scan_frame_build(type, payload, (uint16_t)payload_len, &p_buf[len], size - len);
+    }
+
+    return len;
+}
+
+
+/**@brief Function for opening a pty pair, the slave side in raw mode.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int pty_open(int * p_master, int * p_slave)
+{
+    struct termios tio;
+    char const   * p_name;
+
+    *p_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((*p_master < 0) || (grantpt(*p_master) != 0) || (unlockpt(*p_master) != 0) ||
+        ((p_name = ptsname(*p_master)) == NULL))
+    {
+        return -1;
+    }
+
+    *p_slave = open(p_name, O_RDWR | O_NOCTTY);
+    if ((*p_slave < 0) || (tcgetattr(*p_slave, &tio) != 0))
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+
+    return tcsetattr(*p_slave, TCSANOW, &tio);
+}
+
+
+/**@brief Function for feeding @p total bytes of the pattern through a pty.
+ *
+ * @return true if every frame was decoded.
+ */
+static bool bench_run(unsigned workers, size_t ring_size, uint8_t const * p_pattern, size_t pattern_len,
+                      uint64_t repeats)
+{
+    scan_ingest_config_t config = { .ring_size = ring_size, .workers = workers, .raw_fd = -1 };
+    scan_ingest_stats_t  stats;
+    scan_ingest_t      * p_ingest;
+    uint64_t             total = pattern_len * repeats;
+    double               start;
+    double               elapsed;
+    int                  master;
+    int                  slave;
+
+    if (pty_open(&master, &slave) != 0)
+    {
+        perror("pty");
+        exit(EXIT_FAILURE);
+    }
+    config.fd      = slave;
+    config.text_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    if (scan_ingest_start(&p_ingest, &config) != 0)
+    {
+        perror("scan_ingest");
+        exit(EXIT_FAILURE);
+    }
+
+    start = now_s();
+    for (uint64_t i = 0; i < repeats; i++)
+    {
+        size_t done = 0;
+
+        while (done < pattern_len)
+        {
+            ssize_t n = write(master, &p_pattern[done], pattern_len - done);
+
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                perror("pty write");
+                exit(EXIT_FAILURE);
+            }
+            done += (size_t)n;
+        }
+    }
+
+    // Until everything written has been read, the rest is drained by the stop.
+    do
+    {
+        usleep(1000);
+        scan_ingest_stats_get(p_ingest, &stats);
+    } while (stats.bytes_read < total);
+    scan_ingest_stop(p_ingest);
+    scan_ingest_wait(p_ingest, &stats);
+    elapsed = now_s() - start;
+
+    close(master);
+    close(slave);
+    close(config.text_fd);
+
+    printf("%7u %10.1f %12.0f %8.0fx %12zu %8llu   %s\n",
+           workers,
+           (double)total / elapsed / 1e6,
+           (double)stats.frames / elapsed,
+           (double)total / elapsed / LINE_RATE,
+           stats.ring_high_water,
+           (unsigned long long)stats.reader_stalls,
+           ((stats.frames == PATTERN_FRAMES * repeats) && (stats.crc_errors == 0)) ? "ok" : "FAILED");
+
+    return (stats.frames == PATTERN_FRAMES * repeats) && (stats.crc_errors == 0);
+}
+
+
+int main(int argc, char * argv[])
+{
+    static uint8_t pattern[PATTERN_FRAMES * (SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD)];
+    uint32_t       megabytes = 256;
+    uint32_t       ring_mb = 16;
+    size_t         ring_size = 1024 * 1024;
+    size_t         pattern_len;
+    bool           ok = true;
+    int            opt;
+
+    while ((opt = getopt(argc, argv, "m:r:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                megabytes = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'r':
+                ring_mb = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-m megabytes] [-r ring_mb]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // The ring size is a power of two.
+    while (ring_size < (size_t)ring_mb * 1024 * 1024)
+    {
+        ring_size *= 2;
+    }
+    pattern_len = pattern_make(pattern, sizeof(pattern));
+
+    printf("%llu MB through a pty, %zu MB ring\n\n",
+           (unsigned long long)pattern_len * (megabytes * 1000000ull / pattern_len + 1) / 1000000,
+           ring_size / (1024 * 1024));
+    printf("workers       MB/s    records/s line rate   high water   stalls\n");
+
+    for (unsigned workers = 1; workers <= 8; workers *= 2)
+    {
+        ok &= bench_run(workers, ring_size, pattern, pattern_len,
+                        megabytes * 1000000ull / pattern_len + 1);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,222 @@
+/***************************************************************************************/
+/*
+ * scan_ingestd
+ *
+ *  Ingest daemon of the beacon scanner output (see scan_ingest). Reads the binary
+ *  stream from a serial port (or a capture file) and publishes the records as text
+ *  lines, the same as scan_dump prints, to a file and to the clients of a Unix socket.
+ *
+ *  Usage: scan_ingestd [-b baudrate] [-B baudrate [-f]] [-w workers] [-r ring_mb]
+ *                      [-o text_file] [-c raw_file] [-u socket] [-s store_file]
+ *                      <device | file | ->
+ *
+ *  The text goes to standard output unless -o is given; "-o -" with -u or -c keeps
+ *  it there, -o "" drops it. With -c the raw stream is also written to raw_file,
+ *  for scan_dump or a later replay. With -s the advertising reports are also stored
+ *  in a columnar file, for scan_store to query. A client reads the lines with, for instance:
+ *
+ *      socat - UNIX-CONNECT:/tmp/scan.sock
+ *
+ *  The daemon runs until the port hangs up, the end of the file, or SIGINT/SIGTERM,
+ *  then prints its counters to standard error.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_ingest.h"
+#include "scan_link.h"
+#include "serial_port.h"
+
+#define RING_MB_DEFAULT     16
+
+
+static scan_ingest_t * volatile mp_ingest;
+
+
+static void signal_handle(int sig)
+{
+    (void)sig;
+
+    if (mp_ingest != NULL)
+    {
+        scan_ingest_stop(mp_ingest);
+    }
+}
+
+
+/**@brief Function for opening an output file, "-" being standard output and "" none.
+ *
+ * @return File descriptor, -1 for none, -2 on error.
+ */
+static int output_open(char const * p_path)
+{
+    int fd;
+
+    if (p_path[0] == '\0')
+    {
+        return -1;
+    }
+    if (strcmp(p_path, "-") == 0)
+    {
+        return STDOUT_FILENO;
+    }
+
+    fd = open(p_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", p_path, strerror(errno));
+        return -2;
+    }
+
+    return fd;
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "Usage: %s [-b baudrate] [-B baudrate [-f]] [-w workers] [-r ring_mb]\n"
+                    "       %*s [-o text_file] [-c raw_file] [-u socket] [-s store_file]\n"
+                    "       %*s <device | file | ->\n",
+            p_name, (int)strlen(p_name), "", (int)strlen(p_name), "");
+}
+
+
+int main(int argc, char * argv[])
+{
+    scan_ingest_config_t config = { .workers = 2, .text_fd = STDOUT_FILENO, .raw_fd = -1 };
+    scan_ingest_stats_t  stats;
+    struct sigaction     sa = { .sa_handler = signal_handle };
+    uint32_t             baudrate = 115200;
+    uint32_t             link_baudrate = 0;
+    uint32_t             ring_mb = RING_MB_DEFAULT;
+    bool                 hwfc = false;
+    char const         * p_text = "-";
+    char const         * p_raw = "";
+    scan_ingest_t      * p_ingest;
+    int                  opt;
+
+    while ((opt = getopt(argc, argv, "b:B:fw:r:o:c:u:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'B':
+                link_baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'f':
+                hwfc = true;
+                break;
+
+            case 'w':
+                config.workers = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'r':
+                ring_mb = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'o':
+                p_text = optarg;
+                break;
+
+            case 'c':
+                p_raw = optarg;
+                break;
+
+            case 'u':
+                config.p_socket_path = optarg;
+                break;
+
+            case 's':
+                config.p_store_path = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The ring size is a power of two.
+    config.ring_size = 1024 * 1024;
+    while ((config.ring_size < (size_t)ring_mb * 1024 * 1024) && (config.ring_size < ((size_t)1 << 30)))
+    {
+        config.ring_size *= 2;
+    }
+
+    config.text_fd = output_open(p_text);
+    config.raw_fd  = output_open(p_raw);
+    if ((config.text_fd == -2) || (config.raw_fd == -2))
+    {
+        return EXIT_FAILURE;
+    }
+
+    config.fd = serial_port_open(argv[optind], baudrate, (link_baudrate != 0) ? O_RDWR : O_RDONLY);
+    if (config.fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (link_baudrate != 0)
+    {
+        scan_hello_t hello;
+
+        if (scan_link_negotiate(config.fd, link_baudrate, hwfc, &hello) != 0)
+        {
+            fprintf(stderr, "%s: cannot switch to %u baud\n", argv[optind], link_baudrate);
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "link: %u baud, hwfc %s\n", hello.baudrate,
+                (hello.flags & SCAN_LINK_FLAG_HWFC) ? "on" : "off");
+    }
+
+    // A client that goes away must not end the daemon.
+    signal(SIGPIPE, SIG_IGN);
+
+    if (scan_ingest_start(&p_ingest, &config) != 0)
+    {
+        fprintf(stderr, "scan_ingest: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    mp_ingest = p_ingest;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    scan_ingest_wait(p_ingest, &stats);
+    mp_ingest = NULL;
+
+    fprintf(stderr, "bytes: %llu in %llu reads, ring high water: %zu, reader stalls: %llu\n",
+            (unsigned long long)stats.bytes_read,
+            (unsigned long long)stats.reads,
+            stats.ring_high_water,
+            (unsigned long long)stats.reader_stalls);
+    fprintf(stderr, "frames: %llu, crc errors: %llu, skipped bytes: %llu\n",
+            (unsigned long long)stats.frames,
+            (unsigned long long)stats.crc_errors,
+            (unsigned long long)stats.skipped);
+    fprintf(stderr, "batches: %llu, text bytes: %llu, clients dropped: %llu\n",
+            (unsigned long long)stats.batches,
+            (unsigned long long)stats.text_bytes,
+            (unsigned long long)stats.clients_dropped);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+/***************************************************************************************/
+/*
+ * scan_link
+ *
+ *  Host side of the scanner link handshake.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include "scan_decoder.h"
+#include "scan_link.h"
+#include "serial_port.h"
+
+#define PROBE_TIMEOUT_MS        300                                     /**< Wait for a HELLO at each probed baud rate. */
+#define RSP_TIMEOUT_MS          1000                                    /**< Wait for a command response. */
+
+/**@brief Baud rates probed, in order. */
+static const uint32_t m_baudrates[] = { 115200, 1000000, 921600, 460800, 230400 };
+
+/**@brief What the link functions are waiting for. */
+typedef struct
+{
+    uint8_t        type;                                                /**< Frame type waited for. */
+    uint8_t        cmd;                                                 /**< Command answered, for @ref SCAN_FRAME_TYPE_CMD_RSP. */
+    bool           received;
+    scan_hello_t   hello;
+    scan_cmd_rsp_t rsp;
+    scan_stats_t   stats;
+} link_wait_t;
+
+
+/**@brief Function for catching the expected frame among the advertising reports.
+ *
+ * @details While waiting for the record a command asks for, a failed response to
+ *          the command ends the wait too.
+ */
+static void wait_handler(scan_record_t const * p_record, void * p_context)
+{
+    link_wait_t  * p_wait = p_context;
+    scan_cmd_rsp_t rsp;
+
+    if (p_wait->received)
+    {
+        return;
+    }
+
+    switch (p_record->type)
+    {
+        case SCAN_FRAME_TYPE_HELLO:
+            if ((p_wait->type == SCAN_FRAME_TYPE_HELLO) && (p_record->len >= sizeof(scan_hello_t)))
+            {
+                memcpy(&p_wait->hello, p_record->p_payload, sizeof(scan_hello_t));
+                p_wait->received = true;
+            }
+            break;
+
+        case SCAN_FRAME_TYPE_CMD_RSP:
+            if (p_record->len < sizeof(rsp))
+            {
+                break;
+            }
+            memcpy(&rsp, p_record->p_payload, sizeof(rsp));
+            if ((rsp.cmd != p_wait->cmd)
+                || ((p_wait->type != SCAN_FRAME_TYPE_CMD_RSP) && (p_wait->type != SCAN_FRAME_TYPE_STATS)))
+            {
+                break;
+            }
+            p_wait->rsp      = rsp;
+            p_wait->received = (p_wait->type == SCAN_FRAME_TYPE_CMD_RSP) || (rsp.status != SCAN_CMD_STATUS_OK);
+            break;
+
+        case SCAN_FRAME_TYPE_STATS:
+            if (p_wait->type == SCAN_FRAME_TYPE_STATS)
+            {
+                p_wait->received = (scan_record_stats_parse(p_record, &p_wait->stats) == 0);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+
+/**@brief Function for reading until the expected frame arrives or the timeout expires.
+ *
+ * @return 0 if the frame was received, -1 otherwise.
+ */
+static int wait_for(int fd, link_wait_t * p_wait, uint32_t timeout_ms)
+{
+    static scan_decoder_t decoder;
+    uint64_t              deadline = now_ms() + timeout_ms;
+    uint8_t               buf[512];
+
+    scan_decoder_init(&decoder, wait_handler, p_wait);
+    p_wait->received = false;
+
+    while (!p_wait->received)
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        uint64_t      now = now_ms();
+        ssize_t       n;
+
+        if (now >= deadline)
+        {
+            return -1;
+        }
+        if (poll(&pfd, 1, (int)(deadline - now)) <= 0)
+        {
+            continue;
+        }
+
+        n = read(fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        scan_decoder_feed(&decoder, buf, (size_t)n);
+    }
+
+    return 0;
+}
+
+
+int scan_link_send(int fd, uint8_t type, void const * p_payload, uint16_t len)
+{
+    uint8_t frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t  frame_len = scan_frame_build(type, p_payload, len, frame, sizeof(frame));
+    size_t  done      = 0;
+
+    if (frame_len == 0)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    while (done < frame_len)
+    {
+        ssize_t n = write(fd, &frame[done], frame_len - done);
+
+        if (n < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+
+    return 0;
+}
+
+
+int scan_link_probe(int fd, scan_hello_t * p_hello)
+{
+    link_wait_t wait = { .type = SCAN_FRAME_TYPE_HELLO };
+
+    for (size_t i = 0; i < sizeof(m_baudrates) / sizeof(m_baudrates[0]); i++)
+    {
+        if (serial_port_baudrate_set(fd, m_baudrates[i]) != 0)
+        {
+            continue;
+        }
+        tcflush(fd, TCIOFLUSH);
+
+        if ((scan_link_send(fd, SCAN_CMD_HELLO, NULL, 0) == 0) &&
+            (wait_for(fd, &wait, PROBE_TIMEOUT_MS) == 0))
+        {
+            *p_hello = wait.hello;
+            serial_port_hwfc_set(fd, (wait.hello.flags & SCAN_LINK_FLAG_HWFC) != 0);
+
+            // Pseudo terminals ignore the baud rate, use what the scanner reports.
+            serial_port_baudrate_set(fd, wait.hello.baudrate);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+int scan_link_negotiate(int fd, uint32_t baudrate, bool hwfc, scan_hello_t * p_hello)
+{
+    scan_cmd_uart_config_t cmd   = { .baudrate = baudrate, .flags = hwfc ? SCAN_LINK_FLAG_HWFC : 0 };
+    link_wait_t            wait  = { .type = SCAN_FRAME_TYPE_CMD_RSP, .cmd = SCAN_CMD_UART_CONFIG };
+    scan_hello_t           hello;
+
+    if (scan_link_probe(fd, &hello) != 0)
+    {
+        return -1;
+    }
+    *p_hello = hello;
+
+    if ((hello.baudrate == baudrate) && (((hello.flags & SCAN_LINK_FLAG_HWFC) != 0) == hwfc))
+    {
+        return 0;
+    }
+
+    if ((scan_link_send(fd, SCAN_CMD_UART_CONFIG, &cmd, sizeof(cmd)) != 0) ||
+        (wait_for(fd, &wait, RSP_TIMEOUT_MS) != 0) ||
+        (wait.rsp.status != SCAN_CMD_STATUS_OK))
+    {
+        return -1;
+    }
+
+    // Follow the scanner and wait for its HELLO at the new rate.
+    tcdrain(fd);
+    if ((serial_port_baudrate_set(fd, baudrate) != 0) || (serial_port_hwfc_set(fd, hwfc) != 0))
+    {
+        return -1;
+    }
+
+    wait.type = SCAN_FRAME_TYPE_HELLO;
+    if (wait_for(fd, &wait, RSP_TIMEOUT_MS) != 0)
+    {
+        // The scanner goes back to the previous configuration on its own.
+        serial_port_baudrate_set(fd, hello.baudrate);
+        serial_port_hwfc_set(fd, (hello.flags & SCAN_LINK_FLAG_HWFC) != 0);
+        return -1;
+    }
+
+    // Confirm, otherwise the scanner reverts.
+    if (scan_link_send(fd, SCAN_CMD_HELLO, NULL, 0) != 0)
+    {
+        return -1;
+    }
+
+    *p_hello = wait.hello;
+
+    return 0;
+}
+
+
+int scan_link_command(int fd, uint8_t cmd, void const * p_payload, uint16_t len, uint8_t * p_status)
+{
+    link_wait_t wait = { .type = SCAN_FRAME_TYPE_CMD_RSP, .cmd = cmd };
+
+    if ((scan_link_send(fd, cmd, p_payload, len) != 0) ||
+        (wait_for(fd, &wait, RSP_TIMEOUT_MS) != 0))
+    {
+        return -1;
+    }
+    *p_status = wait.rsp.status;
+
+    return 0;
+}
+
+
+int scan_link_stats_get(int fd, scan_stats_t * p_stats, uint8_t * p_status)
+{
+    link_wait_t wait = { .type = SCAN_FRAME_TYPE_STATS, .cmd = SCAN_CMD_STATS_GET };
+
+    // The record follows the response, both are caught by the same wait.
+    wait.rsp.status = SCAN_CMD_STATUS_OK;
+    if ((scan_link_send(fd, SCAN_CMD_STATS_GET, NULL, 0) != 0) ||
+        (wait_for(fd, &wait, RSP_TIMEOUT_MS) != 0))
+    {
+        return -1;
+    }
+    *p_status = wait.rsp.status;
+    if (wait.rsp.status != SCAN_CMD_STATUS_OK)
+    {
+        return -1;
+    }
+    *p_stats = wait.stats;
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/***************************************************************************************/
+/*
+ * scan_link
+ *
+ *  Host side of the scanner link handshake: finds the baud rate the scanner is
+ *  running at and moves it to the fastest rate both sides agree on.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_LINK_H__
+#define SCAN_LINK_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for sending a command frame to the scanner.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_link_send(int fd, uint8_t type, void const * p_payload, uint16_t len);
+
+
+/**@brief Function for finding the scanner on a serial port.
+ *
+ * @details Sends a HELLO at each supported baud rate until the scanner answers.
+ *          On success the port is left at the scanner's baud rate.
+ *
+ * @param[in]   fd          Serial port, opened for reading and writing.
+ * @param[out]  p_hello     Link parameters reported by the scanner.
+ *
+ * @return 0 on success, -1 if the scanner did not answer.
+ */
+int scan_link_probe(int fd, scan_hello_t * p_hello);
+
+
+/**@brief Function for negotiating the link configuration.
+ *
+ * @details Probes the scanner, asks it to switch to @p baudrate and @p hwfc, follows
+ *          it and confirms the change. If any step fails, the scanner falls back to
+ *          the previous configuration on its own and so does the port.
+ *
+ * @param[in]   fd          Serial port, opened for reading and writing.
+ * @param[in]   baudrate    Requested baud rate.
+ * @param[in]   hwfc        Requested RTS/CTS flow control.
+ * @param[out]  p_hello     Link parameters in use when the function returns.
+ *
+ * @return 0 if the requested configuration is in use, -1 otherwise.
+ */
+int scan_link_negotiate(int fd, uint32_t baudrate, bool hwfc, scan_hello_t * p_hello);
+
+
+/**@brief Function for sending a command and waiting for its response.
+ *
+ * @param[in]   fd          Serial port, at the scanner's baud rate.
+ * @param[in]   cmd         Command, @ref scan_cmd_type_t.
+ * @param[in]   p_payload   Payload of the command.
+ * @param[in]   len         Length of the payload.
+ * @param[out]  p_status    @ref scan_cmd_status_t of the response.
+ *
+ * @return 0 if the scanner answered, -1 otherwise.
+ */
+int scan_link_command(int fd, uint8_t cmd, void const * p_payload, uint16_t len, uint8_t * p_status);
+
+
+/**@brief Function for asking the scanner for a statistics record.
+ *
+ * @param[in]   fd          Serial port, at the scanner's baud rate.
+ * @param[out]  p_stats     Record received.
+ * @param[out]  p_status    @ref scan_cmd_status_t of the response, if it came.
+ *
+ * @return 0 if the record was received, -1 otherwise.
+ */
+int scan_link_stats_get(int fd, scan_stats_t * p_stats, uint8_t * p_status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_LINK_H__
@@ -0,0 +1,233 @@
+/***************************************************************************************/
+/*
+ * scan_lz
+ *
+ *  Block compression of the columnar captures.
+ *
+ *  The compressor looks up the 4 bytes at each position in a hash table of the last
+ *  position they were seen at, and extends the matches it finds forward. Positions
+ *  are skipped faster and faster while nothing matches, so incompressible data goes
+ *  through quickly.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_lz.h"
+
+#define MIN_MATCH           4
+#define MAX_OFFSET          65535
+#define HASH_BITS           14
+#define LAST_LITERALS       5                                           /**< A match ends this far from the end at least. */
+#define MATCH_LIMIT         12                                          /**< A match starts this far from the end at least. */
+#define SKIP_SHIFT          6                                           /**< Misses before the step grows by one. */
+#define NO_POSITION         UINT32_MAX
+
+
+static uint32_t read32(uint8_t const * p)
+{
+    uint32_t value;
+
+    memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+
+static uint32_t hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+/**@brief Function for writing a length past its nibble: 255 per byte, then the rest. */
+static uint8_t * length_write(uint8_t * p_out, size_t len)
+{
+    while (len >= 255)
+    {
+        *p_out++ = 255;
+        len     -= 255;
+    }
+    *p_out++ = (uint8_t)len;
+
+    return p_out;
+}
+
+
+/**@brief Function for writing a sequence.
+ *
+ * @param[in]   match_len   Length of the match, 0 for the last sequence.
+ *
+ * @return End of the sequence, NULL if it does not fit before @p p_end.
+ */
+static uint8_t * sequence_write(uint8_t       * p_out,
+                                uint8_t const * p_end,
+                                uint8_t const * p_literals,
+                                size_t          literal_len,
+                                size_t          offset,
+                                size_t          match_len)
+{
+    size_t    extra = (match_len > 0) ? match_len - MIN_MATCH : 0;
+    uint8_t * p_token;
+
+    if ((size_t)(p_end - p_out) < 1 + literal_len + literal_len / 255 + 1 + 2 + extra / 255 + 1)
+    {
+        return NULL;
+    }
+
+    p_token  = p_out++;
+    *p_token = (uint8_t)(((literal_len < 15) ? literal_len : 15) << 4);
+    if (literal_len >= 15)
+    {
+        p_out = length_write(p_out, literal_len - 15);
+    }
+    memcpy(p_out, p_literals, literal_len);
+    p_out += literal_len;
+
+    if (match_len == 0)
+    {
+        return p_out;
+    }
+
+    *p_out++  = (uint8_t)offset;
+    *p_out++  = (uint8_t)(offset >> 8);
+    *p_token |= (uint8_t)((extra < 15) ? extra : 15);
+    if (extra >= 15)
+    {
+        p_out = length_write(p_out, extra - 15);
+    }
+
+    return p_out;
+}
+
+
+size_t scan_lz_compress(uint8_t const * p_src, size_t len, uint8_t * p_dst, size_t dst_size)
+{
+    uint32_t        table[1 << HASH_BITS];
+    uint8_t       * p_out    = p_dst;
+    uint8_t const * p_end    = p_dst + dst_size;
+    size_t          anchor   = 0;
+    size_t          pos      = 0;
+    size_t          misses   = 0;
+
+    memset(table, 0xFF, sizeof(table));
+
+    while ((len > MATCH_LIMIT) && (pos < len - MATCH_LIMIT))
+    {
+        uint32_t value = read32(&p_src[pos]);
+        uint32_t h     = hash(value);
+        uint32_t ref   = table[h];
+        size_t   match_len;
+
+        table[h] = (uint32_t)pos;
+        if ((ref == NO_POSITION) || (pos - ref > MAX_OFFSET) || (read32(&p_src[ref]) != value))
+        {
+            pos += 1 + (misses++ >> SKIP_SHIFT);
+            continue;
+        }
+
+        match_len = MIN_MATCH;
+        while ((pos + match_len < len - LAST_LITERALS) && (p_src[ref + match_len] == p_src[pos + match_len]))
+        {
+            match_len++;
+        }
+
+        p_out = sequence_write(p_out, p_end, &p_src[anchor], pos - anchor, pos - ref, match_len);
+        if (p_out == NULL)
+        {
+            return 0;
+        }
+        pos   += match_len;
+        anchor = pos;
+        misses = 0;
+    }
+
+    p_out = sequence_write(p_out, p_end, &p_src[anchor], len - anchor, 0, 0);
+
+    return (p_out != NULL) ? (size_t)(p_out - p_dst) : 0;
+}
+
+
+/**@brief Function for reading a length past its nibble.
+ *
+ * @return 0 on success, -1 if the block ends first.
+ */
+static int length_read(uint8_t const ** pp_in, uint8_t const * p_end, size_t * p_len)
+{
+    uint8_t byte;
+
+    do
+    {
+        if (*pp_in >= p_end)
+        {
+            return -1;
+        }
+        byte    = *(*pp_in)++;
+        *p_len += byte;
+    } while (byte == 255);
+
+    return 0;
+}
+
+
+int scan_lz_decompress(uint8_t const * p_src, size_t len, uint8_t * p_dst, size_t dst_len)
+{
+    uint8_t const * p_in     = p_src;
+    uint8_t const * p_in_end = p_src + len;
+    size_t          out      = 0;
+
+    while (p_in < p_in_end)
+    {
+        uint8_t token       = *p_in++;
+        size_t  literal_len = token >> 4;
+        size_t  match_len   = (token & 0x0F) + MIN_MATCH;
+        size_t  offset;
+
+        if ((literal_len == 15) && (length_read(&p_in, p_in_end, &literal_len) != 0))
+        {
+            return -1;
+        }
+        if ((literal_len > (size_t)(p_in_end - p_in)) || (literal_len > dst_len - out))
+        {
+            return -1;
+        }
+        memcpy(&p_dst[out], p_in, literal_len);
+        p_in += literal_len;
+        out  += literal_len;
+
+        if (p_in == p_in_end)
+        {
+            break;
+        }
+
+        if (p_in_end - p_in < 2)
+        {
+            return -1;
+        }
+        offset = (size_t)p_in[0] | ((size_t)p_in[1] << 8);
+        p_in  += 2;
+        if (((token & 0x0F) == 15) && (length_read(&p_in, p_in_end, &match_len) != 0))
+        {
+            return -1;
+        }
+        if ((offset == 0) || (offset > out) || (match_len > dst_len - out))
+        {
+            return -1;
+        }
+
+        // The match may overlap what it writes.
+        if (offset >= match_len)
+        {
+            memcpy(&p_dst[out], &p_dst[out - offset], match_len);
+        }
+        else
+        {
+            for (size_t i = 0; i < match_len; i++)
+            {
+                p_dst[out + i] = p_dst[out - offset + i];
+            }
+        }
+        out += match_len;
+    }
+
+    return (out == dst_len) ? 0 : -1;
+}
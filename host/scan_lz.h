@@ -0,0 +1,54 @@
+/***************************************************************************************/
+/*
+ * scan_lz
+ *
+ *  Block compression of the columnar captures (scan_col): LZ77 with the sequence
+ *  layout of LZ4. Each sequence is a token (literal length in the high nibble, match
+ *  length minus 4 in the low one, 15 meaning more length bytes follow), the literals,
+ *  and the match as a 16-bit offset back into the output; the last sequence has
+ *  literals only. Fast rather than tight, for blocks of up to a few megabytes.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_LZ_H__
+#define SCAN_LZ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Room the compressed form of @p len bytes can take at worst. */
+#define SCAN_LZ_BOUND(len)      ((len) + (len) / 255 + 16)
+
+
+/**@brief Function for compressing a block.
+ *
+ * @param[in]   p_src       Data.
+ * @param[in]   len         Length of the data.
+ * @param[out]  p_dst       Compressed data.
+ * @param[in]   dst_size    Room in @p p_dst.
+ *
+ * @return Length of the compressed data, 0 if it does not fit in @p dst_size.
+ */
+size_t scan_lz_compress(uint8_t const * p_src, size_t len, uint8_t * p_dst, size_t dst_size);
+
+
+/**@brief Function for decompressing a block.
+ *
+ * @param[in]   p_src       Compressed data.
+ * @param[in]   len         Length of the compressed data.
+ * @param[out]  p_dst       Data.
+ * @param[in]   dst_len     Length of the data, known beforehand.
+ *
+ * @return 0 on success, -1 if the block is corrupted.
+ */
+int scan_lz_decompress(uint8_t const * p_src, size_t len, uint8_t * p_dst, size_t dst_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_LZ_H__
@@ -0,0 +1,127 @@
+/***************************************************************************************/
+/*
+ * scan_metrics
+ *
+ *  Rendering of the scanner statistics records in the Prometheus text exposition
+ *  format.
+*/
+/***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_metrics.h"
+
+#define METRIC_PREFIX   "beacon_scanner_"
+
+/**@brief Kind of a metric. */
+typedef enum
+{
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+} metric_type_t;
+
+
+static int metric_write(FILE        * p_out,
+                        char const  * p_name,
+                        metric_type_t type,
+                        char const  * p_help,
+                        char const  * p_labels,
+                        double        value)
+{
+    int ret = 0;
+
+    // HELP and TYPE come once per metric, before the first sample.
+    if (p_help != NULL)
+    {
+        ret |= fprintf(p_out, "# HELP " METRIC_PREFIX "%s %s\n", p_name, p_help) < 0;
+        ret |= fprintf(p_out, "# TYPE " METRIC_PREFIX "%s %s\n", p_name,
+                       (type == METRIC_COUNTER) ? "counter" : "gauge") < 0;
+    }
+    ret |= fprintf(p_out, METRIC_PREFIX "%s%s %.17g\n", p_name, (p_labels != NULL) ? p_labels : "", value) < 0;
+
+    return ret ? -1 : 0;
+}
+
+
+int scan_metrics_write(FILE * p_out, scan_stats_t const * p_stats)
+{
+    int ret = 0;
+
+    ret |= metric_write(p_out, "uptime_seconds", METRIC_GAUGE,
+                        "Time since the scanner booted.", NULL, p_stats->timestamp_us / 1e6);
+    ret |= metric_write(p_out, "reports_received_total", METRIC_COUNTER,
+                        "Advertising reports received from the radio.", NULL, p_stats->reports_received);
+    ret |= metric_write(p_out, "reports_sent_total", METRIC_COUNTER,
+                        "Advertising reports sent to the host.", NULL, p_stats->reports_sent);
+    ret |= metric_write(p_out, "summaries_sent_total", METRIC_COUNTER,
+                        "Alive and RSSI summary records sent to the host.", NULL, p_stats->summaries_sent);
+    ret |= metric_write(p_out, "reports_dropped_total", METRIC_COUNTER,
+                        "Advertising reports not sent to the host, by cause.",
+                        "{cause=\"queue_full\"}", p_stats->drop_queue_full);
+    ret |= metric_write(p_out, "reports_dropped_total", METRIC_COUNTER, NULL,
+                        "{cause=\"duplicate\"}", p_stats->drop_duplicate);
+    ret |= metric_write(p_out, "reports_dropped_total", METRIC_COUNTER, NULL,
+                        "{cause=\"output\"}", p_stats->drop_output);
+    ret |= metric_write(p_out, "reports_dropped_total", METRIC_COUNTER, NULL,
+                        "{cause=\"filtered\"}", p_stats->drop_filtered);
+    ret |= metric_write(p_out, "uart_tx_bytes_total", METRIC_COUNTER,
+                        "Bytes sent through the UART.", NULL, p_stats->tx_bytes);
+    ret |= metric_write(p_out, "uart_tx_busy_total", METRIC_COUNTER,
+                        "Records held back because the UART could not keep up.", NULL, p_stats->tx_busy);
+    ret |= metric_write(p_out, "queue_high_water", METRIC_GAUGE,
+                        "Most reports queued at once since boot.", NULL, p_stats->queue_high_water);
+    ret |= metric_write(p_out, "queue_size", METRIC_GAUGE,
+                        "Capacity of the report queue.", NULL, p_stats->queue_size);
+    ret |= metric_write(p_out, "output_high_water_bytes", METRIC_GAUGE,
+                        "Most bytes waiting in an output buffer since boot.", NULL, p_stats->output_high_water);
+    ret |= metric_write(p_out, "output_size_bytes", METRIC_GAUGE,
+                        "Size of an output buffer.", NULL, p_stats->output_size);
+    ret |= metric_write(p_out, "scan_window_seconds", METRIC_GAUGE,
+                        "Current scan window.", NULL, p_stats->scan_window * 0.000625);
+    ret |= metric_write(p_out, "cpu_utilization_ratio", METRIC_GAUGE,
+                        "Fraction of the last period the CPU was awake.", NULL, p_stats->cpu_load / 10000.0);
+
+    return ret ? -1 : 0;
+}
+
+
+int scan_metrics_file_write(char const * p_path, scan_stats_t const * p_stats)
+{
+    size_t len    = strlen(p_path);
+    char * p_tmp  = malloc(len + sizeof(".tmp"));
+    FILE * p_file;
+    int    ret;
+
+    if (p_tmp == NULL)
+    {
+        return -1;
+    }
+    memcpy(p_tmp, p_path, len);
+    memcpy(&p_tmp[len], ".tmp", sizeof(".tmp"));
+
+    p_file = fopen(p_tmp, "w");
+    if (p_file == NULL)
+    {
+        free(p_tmp);
+        return -1;
+    }
+
+    ret = scan_metrics_write(p_file, p_stats);
+    if (fclose(p_file) != 0)
+    {
+        ret = -1;
+    }
+    if (ret == 0)
+    {
+        ret = rename(p_tmp, p_path);
+    }
+    else
+    {
+        remove(p_tmp);
+    }
+
+    free(p_tmp);
+
+    return ret;
+}
@@ -0,0 +1,43 @@
+/***************************************************************************************/
+/*
+ * scan_metrics
+ *
+ *  Rendering of the scanner statistics records in the Prometheus text exposition
+ *  format, for the node exporter textfile collector or any scraper.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_METRICS_H__
+#define SCAN_METRICS_H__
+
+#include <stdio.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for writing a statistics record as Prometheus metrics.
+ *
+ * @param[in]   p_out       Output stream.
+ * @param[in]   p_stats     Statistics record.
+ *
+ * @return 0 on success, -1 on write error.
+ */
+int scan_metrics_write(FILE * p_out, scan_stats_t const * p_stats);
+
+
+/**@brief Function for replacing a metrics file atomically.
+ *
+ * @details Writes a temporary file next to @p p_path and renames it, so a scraper
+ *          never reads a partial file.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int scan_metrics_file_write(char const * p_path, scan_stats_t const * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_METRICS_H__
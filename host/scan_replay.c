@@ -0,0 +1,881 @@
+/***************************************************************************************/
+/*
+ * scan_replay
+ *
+ *  Plays a binary capture (scan_ingestd -c, scan_sim -o) back through a pty, to run
+ *  the tools that read the scanner (scan_dump, scan_ingestd, ...) without it. The
+ *  bytes of the capture are written as they were recorded, at the pace given by the
+ *  times of its records: as they came (-x 1, the default), up to 100 times faster
+ *  (-x), or as fast as the reader takes them (-m). Records without a time (HELLO,
+ *  STATS, ...) go out with the record before them. With -b the pace is also held to
+ *  what the UART of the scanner sends at that baud rate.
+ *
+ *  The pty answers the HELLO and UART_CONFIG commands as the scanner does, so
+ *  scan_link finds it and moves it to another baud rate (which -b then follows);
+ *  other commands are answered as unsupported.
+ *
+ *  The replay starts once the pty is opened, and ends with the capture (played -n
+ *  times, 0 for ever), when the reader closes the pty, or on SIGINT/SIGTERM. Every
+ *  second, and at the end, it prints the rate of records asked for by the times of
+ *  the capture, the rate the reader took them at and how late the replay is: a
+ *  reader that does not keep up shows as a growing delay and time blocked on it.
+ *
+ *  Usage: scan_replay [-x multiplier | -m] [-b baudrate] [-n loops] [-l link] [-q] <capture>
+ *
+ *  The pty is printed on standard output; -l also makes a symbolic link to it, e.g.
+ *  /tmp/ttyACM0, to give the readers a fixed name.
+*/
+/***************************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scan_decoder.h"
+
+#define MULTIPLIER_MAX          100
+#define BITS_PER_BYTE           10                                      /**< Start, 8 data bits, stop. */
+#define LINK_BAUDRATE_DEFAULT   115200                                  /**< Reported by HELLO when -b is not given. */
+#define RESTART_GAP_US          (60ull * 1000000)                       /**< A time this much earlier than the latest one is a restart of the scanner. */
+#define OUT_BUF_SIZE            65536
+#define OUT_FRAMES_MAX          (OUT_BUF_SIZE / SCAN_FRAME_OVERHEAD + 1)
+#define REPLY_BUF_SIZE          512
+#define REPORT_INTERVAL_S       1.0
+#define OPEN_POLL_MS            50                                      /**< Check for the pty to be opened this often. */
+#define OPEN_SETTLE_MS          200                                     /**< Left to the reader to set the port up once opened. */
+#define DRAIN_TIMEOUT_MS        2000                                    /**< Wait for the reader to take the end of the capture. */
+#define DRAIN_SETTLE_MS         20                                      /**< Left empty this long, the last bytes written reached the reader. */
+#define LINK_SWITCH_S           0.02                                    /**< From the answer to UART_CONFIG to the HELLO at the new baud rate. */
+
+/**@brief Position in the capture and in the schedule of the replay. */
+typedef struct
+{
+    uint64_t pos;                                                       /**< Next byte of the capture. */
+    uint32_t loop;                                                      /**< Times the capture was played through. */
+    bool     anchored;                                                  /**< A record with a time was seen in this loop. */
+    uint64_t t_anchor;                                                  /**< Time of the record due at due_anchor, microseconds. */
+    uint64_t t_latest;                                                  /**< Latest time since then. */
+    double   due_anchor;
+    double   line_free;                                                 /**< When the UART is done with the last chunk, with -b. */
+    bool     ready;                                                     /**< The next chunk is below. */
+    bool     done;                                                      /**< The capture was played as many times as asked for. */
+    uint64_t chunk_start;                                               /**< Next chunk: a frame and the bytes before it. */
+    uint64_t chunk_end;
+    uint32_t chunk_records;
+    double   due;                                                       /**< When the chunk is due, seconds from the start. */
+} cursor_t;
+
+/**@brief Counters of the replay. */
+typedef struct
+{
+    uint64_t requested;                                                 /**< Records due. */
+    uint64_t records;                                                   /**< Records written. */
+    uint64_t bytes;
+    double   behind_max;                                                /**< Most seconds a chunk was written after it was due. */
+    double   blocked;                                                   /**< Seconds the reader was not taking any more. */
+} replay_stats_t;
+
+typedef struct
+{
+    uint8_t const * p_capture;
+    uint64_t        capture_len;
+    double          multiplier;                                         /**< 0 for as fast as the reader takes it. */
+    uint32_t        loops;
+    uint32_t        baudrate;                                           /**< Pace of the UART, 0 for none. */
+    uint32_t        link_baudrate;                                      /**< Reported by HELLO. */
+    uint8_t         link_flags;
+    uint32_t        switch_baudrate;                                    /**< Asked for by UART_CONFIG, 0 for none. */
+    uint8_t         switch_flags;
+    double          switch_due;                                         /**< When the switch is made. */
+    cursor_t        sched;                                              /**< What is due. */
+    cursor_t        send;                                               /**< What is written. */
+    uint8_t         out[OUT_BUF_SIZE];
+    size_t          out_len;
+    size_t          out_done;
+    uint32_t        out_ends[OUT_FRAMES_MAX];                           /**< End of each record in out... */
+    double          out_dues[OUT_FRAMES_MAX];                           /**< ...and when it was due. */
+    uint32_t        out_frames;
+    uint32_t        out_frames_done;                                    /**< Records of out written. */
+    uint8_t         reply[REPLY_BUF_SIZE];                              /**< Answers to commands, written before the next chunks. */
+    size_t          reply_len;
+    scan_decoder_t  decoder;                                            /**< Of the commands of the reader. */
+    replay_stats_t  stats;
+} replay_t;
+
+static volatile sig_atomic_t m_stop;
+
+
+static void signal_handle(int sig)
+{
+    (void)sig;
+    m_stop = 1;
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "Usage: %s [-x multiplier | -m] [-b baudrate] [-n loops] [-l link] [-q] <capture>\n", p_name);
+}
+
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/**@brief Function for finding the next valid frame of a capture.
+ *
+ * @param[in]       p_capture   Capture.
+ * @param[in,out]   p_pos       Where to search from; the frame found.
+ * @param[in]       end         End of the capture.
+ * @param[out]      p_record    Record of the frame found.
+ *
+ * @return true if a frame was found.
+ */
+static bool frame_next(uint8_t const * p_capture, uint64_t * p_pos, uint64_t end, scan_record_t * p_record)
+{
+    uint64_t pos = *p_pos;
+
+    while (pos < end)
+    {
+        uint8_t const * p_sof = memchr(&p_capture[pos], SCAN_FRAME_SOF, (size_t)(end - pos));
+        uint16_t        len;
+        uint16_t        crc;
+
+        if (p_sof == NULL)
+        {
+            break;
+        }
+        pos = (uint64_t)(p_sof - p_capture);
+        if (end - pos < SCAN_FRAME_HEADER_LEN)
+        {
+            break;
+        }
+        len = (uint16_t)(p_sof[2] | (p_sof[3] << 8));
+        if ((len > SCAN_FRAME_MAX_PAYLOAD) || (end - pos < (uint64_t)len + SCAN_FRAME_OVERHEAD))
+        {
+            pos++;
+            continue;
+        }
+        crc = scan_crc16(&p_sof[1], SCAN_FRAME_HEADER_LEN - 1 + len, NULL);
+        if (crc != (uint16_t)(p_sof[SCAN_FRAME_HEADER_LEN + len] | (p_sof[SCAN_FRAME_HEADER_LEN + len + 1] << 8)))
+        {
+            pos++;
+            continue;
+        }
+
+        p_record->type      = p_sof[1];
+        p_record->len       = len;
+        p_record->p_payload = &p_sof[SCAN_FRAME_HEADER_LEN];
+        *p_pos              = pos;
+        return true;
+    }
+
+    return false;
+}
+
+
+/**@brief Function for getting the time of a record, for the records that have one. */
+static bool record_time(scan_record_t const * p_record, uint64_t * p_t_us)
+{
+    switch (p_record->type)
+    {
+        case SCAN_FRAME_TYPE_ADV_REPORT:
+        case SCAN_FRAME_TYPE_ALIVE:
+        case SCAN_FRAME_TYPE_RSSI_SUMMARY:
+        case SCAN_FRAME_TYPE_BEACON:
+            break;
+
+        default:
+            return false;
+    }
+    if (p_record->len < sizeof(*p_t_us))
+    {
+        return false;
+    }
+    memcpy(p_t_us, p_record->p_payload, sizeof(*p_t_us));
+
+    return true;
+}
+
+
+/**@brief Function for finding the next chunk of a cursor and when it is due.
+ *
+ * @details The chunk runs from the end of the previous one to the end of the next
+ *          valid frame, or to the end of the capture, so that every byte is played.
+ *          A record earlier than the latest one (summaries of a window, alive
+ *          records) goes out with the records around it; much earlier, the scanner
+ *          was restarted and the times start over from there.
+ *
+ * @return false once the capture was played as many times as asked for.
+ */
+static bool cursor_peek(replay_t const * p_replay, cursor_t * p_cursor)
+{
+    scan_record_t record;
+    uint64_t      pos;
+    uint64_t      t_us;
+
+    if (p_cursor->ready || p_cursor->done)
+    {
+        return p_cursor->ready;
+    }
+
+    if (p_cursor->pos >= p_replay->capture_len)
+    {
+        p_cursor->loop++;
+        if ((p_replay->loops != 0) && (p_cursor->loop >= p_replay->loops))
+        {
+            p_cursor->done = true;
+            return false;
+        }
+        p_cursor->pos      = 0;
+        p_cursor->anchored = false;
+    }
+
+    pos                     = p_cursor->pos;
+    p_cursor->chunk_start   = pos;
+    p_cursor->chunk_end     = p_replay->capture_len;
+    p_cursor->chunk_records = 0;
+    if (frame_next(p_replay->p_capture, &pos, p_replay->capture_len, &record))
+    {
+        p_cursor->chunk_end     = pos + record.len + SCAN_FRAME_OVERHEAD;
+        p_cursor->chunk_records = 1;
+
+        if (record_time(&record, &t_us))
+        {
+            if (!p_cursor->anchored || (t_us + RESTART_GAP_US < p_cursor->t_latest))
+            {
+                p_cursor->anchored   = true;
+                p_cursor->t_anchor   = t_us;
+                p_cursor->t_latest   = t_us;
+                p_cursor->due_anchor = p_cursor->due;
+            }
+            else if (t_us > p_cursor->t_latest)
+            {
+                p_cursor->t_latest = t_us;
+            }
+            if (p_replay->multiplier > 0)
+            {
+                p_cursor->due = p_cursor->due_anchor +
+                                (double)(p_cursor->t_latest - p_cursor->t_anchor) / 1e6 / p_replay->multiplier;
+            }
+        }
+    }
+
+    if (p_replay->baudrate != 0)
+    {
+        if (p_cursor->due < p_cursor->line_free)
+        {
+            p_cursor->due = p_cursor->line_free;
+        }
+        p_cursor->line_free = p_cursor->due + (double)((p_cursor->chunk_end - p_cursor->chunk_start) * BITS_PER_BYTE) /
+                                              p_replay->baudrate;
+    }
+    p_cursor->ready = true;
+
+    return true;
+}
+
+
+static void cursor_advance(cursor_t * p_cursor)
+{
+    p_cursor->pos   = p_cursor->chunk_end;
+    p_cursor->ready = false;
+}
+
+
+/**@brief Function for queueing a frame in answer to a command. Dropped if the reader
+ *        sends commands faster than it reads. */
+static void reply_add(replay_t * p_replay, uint8_t type, void const * p_payload, uint16_t len)
+{
+    p_replay->reply_len += scan_frame_build(type, p_payload, len, &p_replay->reply[p_replay->reply_len],
+                                            sizeof(p_replay->reply) - p_replay->reply_len);
+}
+
+
+static void hello_add(replay_t * p_replay)
+{
+    scan_hello_t hello = { .version  = SCAN_PROTOCOL_VERSION,
+                           .flags    = p_replay->link_flags,
+                           .baudrate = p_replay->link_baudrate };
+
+    reply_add(p_replay, SCAN_FRAME_TYPE_HELLO, &hello, sizeof(hello));
+}
+
+
+/**@brief Function for answering a command of the reader, as the scanner does. */
+static void command_handle(scan_record_t const * p_record, void * p_context)
+{
+    replay_t             * p_replay = p_context;
+    scan_cmd_rsp_t         rsp      = { .cmd = p_record->type, .status = SCAN_CMD_STATUS_UNSUPPORTED };
+    scan_cmd_uart_config_t config;
+
+    switch (p_record->type)
+    {
+        case SCAN_CMD_HELLO:
+            hello_add(p_replay);
+            return;
+
+        case SCAN_CMD_UART_CONFIG:
+            if (p_record->len < sizeof(config))
+            {
+                rsp.status = SCAN_CMD_STATUS_INVALID;
+                break;
+            }
+            memcpy(&config, p_record->p_payload, sizeof(config));
+            switch (config.baudrate)
+            {
+                case 115200:
+                case 230400:
+                case 460800:
+                case 921600:
+                case 1000000:
+                    break;
+
+                default:
+                    rsp.status = SCAN_CMD_STATUS_INVALID;
+                    break;
+            }
+            if (rsp.status == SCAN_CMD_STATUS_INVALID)
+            {
+                break;
+            }
+
+            // Answered at the current rate; the HELLO at the new one comes once switched.
+            rsp.status = SCAN_CMD_STATUS_OK;
+            p_replay->switch_baudrate = config.baudrate;
+            p_replay->switch_flags    = config.flags & SCAN_LINK_FLAG_HWFC;
+            p_replay->switch_due      = -1;
+            break;
+
+        default:
+            if (p_record->type < SCAN_CMD_HELLO)
+            {
+                return;
+            }
+            break;
+    }
+
+    reply_add(p_replay, SCAN_FRAME_TYPE_CMD_RSP, &rsp, sizeof(rsp));
+}
+
+
+/**@brief Function for making the baud rate change asked for by the reader, once due. */
+static void link_switch(replay_t * p_replay, double now)
+{
+    if (p_replay->switch_baudrate == 0)
+    {
+        return;
+    }
+    if (p_replay->switch_due < 0)
+    {
+        p_replay->switch_due = now + LINK_SWITCH_S;
+    }
+    if (now < p_replay->switch_due)
+    {
+        return;
+    }
+
+    p_replay->link_baudrate = p_replay->switch_baudrate;
+    p_replay->link_flags    = p_replay->switch_flags;
+    if (p_replay->baudrate != 0)
+    {
+        p_replay->baudrate = p_replay->switch_baudrate;
+    }
+    p_replay->switch_baudrate = 0;
+    hello_add(p_replay);
+}
+
+
+/**@brief Function for filling the output with the answers to commands and the chunks due. */
+static void out_fill(replay_t * p_replay, double now)
+{
+    cursor_t * p_send = &p_replay->send;
+
+    memcpy(p_replay->out, p_replay->reply, p_replay->reply_len);
+    p_replay->out_len         = p_replay->reply_len;
+    p_replay->out_done        = 0;
+    p_replay->out_frames      = 0;
+    p_replay->out_frames_done = 0;
+    p_replay->reply_len       = 0;
+
+    while ((p_replay->out_len < sizeof(p_replay->out)) && cursor_peek(p_replay, p_send) && (p_send->due <= now))
+    {
+        uint64_t len  = p_send->chunk_end - p_send->chunk_start;
+        size_t   room = sizeof(p_replay->out) - p_replay->out_len;
+
+        // Only bytes that are not frames make a chunk longer than the output.
+        if (len > room)
+        {
+            memcpy(&p_replay->out[p_replay->out_len], &p_replay->p_capture[p_send->chunk_start], room);
+            p_replay->out_len   += room;
+            p_send->chunk_start += room;
+            break;
+        }
+        memcpy(&p_replay->out[p_replay->out_len], &p_replay->p_capture[p_send->chunk_start], (size_t)len);
+        p_replay->out_len += (size_t)len;
+        if (p_send->chunk_records > 0)
+        {
+            p_replay->out_ends[p_replay->out_frames] = (uint32_t)p_replay->out_len;
+            p_replay->out_dues[p_replay->out_frames] = p_send->due;
+            p_replay->out_frames++;
+        }
+        cursor_advance(p_send);
+    }
+}
+
+
+/**@brief Function for counting the records written, and how late.
+ *
+ * @return Seconds the last one, or the next one still to be written, is late.
+ */
+static double out_count(replay_t * p_replay, double now)
+{
+    double behind = 0;
+
+    while ((p_replay->out_frames_done < p_replay->out_frames) &&
+           (p_replay->out_ends[p_replay->out_frames_done] <= p_replay->out_done))
+    {
+        behind = now - p_replay->out_dues[p_replay->out_frames_done];
+        p_replay->stats.records++;
+        p_replay->out_frames_done++;
+    }
+    if (p_replay->out_frames_done < p_replay->out_frames)
+    {
+        behind = now - p_replay->out_dues[p_replay->out_frames_done];
+    }
+    if (behind > p_replay->stats.behind_max)
+    {
+        p_replay->stats.behind_max = behind;
+    }
+
+    return behind;
+}
+
+
+/**@brief Function for counting the records due by now. */
+static void sched_run(replay_t * p_replay, double now)
+{
+    while (cursor_peek(p_replay, &p_replay->sched) && (p_replay->sched.due <= now))
+    {
+        p_replay->stats.requested += p_replay->sched.chunk_records;
+        cursor_advance(&p_replay->sched);
+    }
+}
+
+
+/**@brief Function for making the pty, its slave side in raw mode.
+ *
+ * @return Master side, -1 on error.
+ */
+static int pty_open(char const ** pp_name)
+{
+    struct termios tio;
+    int            master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    int            slave;
+
+    if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0) ||
+        ((*pp_name = ptsname(master)) == NULL))
+    {
+        return -1;
+    }
+
+    // Set up once; the settings stay when it is closed, and the reader opens it next.
+    slave = open(*pp_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((slave < 0) || (tcgetattr(slave, &tio) != 0))
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    if (tcsetattr(slave, TCSANOW, &tio) != 0)
+    {
+        return -1;
+    }
+    close(slave);
+
+    return master;
+}
+
+
+/**@brief Function for waiting for the reader to open the pty.
+ *
+ * @return true once opened, false if stopped.
+ */
+static bool reader_wait(int master)
+{
+    while (!m_stop)
+    {
+        struct pollfd pfd = { .fd = master, .events = POLLOUT };
+
+        if ((poll(&pfd, 1, 0) == 1) && !(pfd.revents & POLLHUP))
+        {
+            usleep(OPEN_SETTLE_MS * 1000);
+            return true;
+        }
+        usleep(OPEN_POLL_MS * 1000);
+    }
+
+    return false;
+}
+
+
+/**@brief Function for waiting for the reader to take what is left in the pty, which
+ *        goes when the master side is closed.
+ *
+ * @details Only the slave side tells how much is left; while it is open the reader
+ *          leaving is not seen, so the wait ends once the reader stops taking any.
+ *          The last bytes written only show there once the kernel has moved them
+ *          across, so an empty side must stay empty for a while.
+ */
+static void reader_drain(char const * p_name)
+{
+    int slave = open(p_name, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    int left  = 0;
+    int idle  = 0;
+    int empty = 0;
+
+    while ((slave >= 0) && !m_stop && (idle < DRAIN_TIMEOUT_MS) && (empty < DRAIN_SETTLE_MS))
+    {
+        int prev = left;
+
+        if (ioctl(slave, TIOCINQ, &left) != 0)
+        {
+            break;
+        }
+        idle  = ((left == prev) && (left > 0)) ? idle + 1 : 0;
+        empty = (left == 0) ? empty + 1 : 0;
+        usleep(1000);
+    }
+    if (slave >= 0)
+    {
+        close(slave);
+    }
+}
+
+
+static void report_print(replay_t const * p_replay, replay_stats_t const * p_last, double elapsed, double interval,
+                         double behind)
+{
+    char requested[16];
+    char late[16];
+
+    if (p_replay->multiplier > 0)
+    {
+        snprintf(requested, sizeof(requested), "%9.0f",
+                 (double)(p_replay->stats.requested - p_last->requested) / interval);
+    }
+    else
+    {
+        snprintf(requested, sizeof(requested), "%9s", "max");
+    }
+    // As fast as the reader takes them, nothing is ever late.
+    if ((p_replay->multiplier > 0) || (p_replay->baudrate != 0))
+    {
+        snprintf(late, sizeof(late), "%8.1f", behind * 1e3);
+    }
+    else
+    {
+        snprintf(late, sizeof(late), "%8s", "-");
+    }
+    fprintf(stderr, "%8.1f s  requested %s rec/s  achieved %9.0f rec/s  %8.1f kB/s  behind %s ms\n",
+            elapsed, requested,
+            (double)(p_replay->stats.records - p_last->records) / interval,
+            (double)(p_replay->stats.bytes - p_last->bytes) / interval / 1e3,
+            late);
+}
+
+
+/**@brief Function for playing the capture until it ends, the reader goes or a signal.
+ *
+ * @return Seconds the replay took.
+ */
+static double replay_run(replay_t * p_replay, int master, char const * p_name, bool quiet, char const ** pp_end)
+{
+    replay_stats_t last = { 0 };
+    double         start = now_s();
+    double         report = REPORT_INTERVAL_S;
+    double         behind = 0;
+    double         now = 0;
+
+    *pp_end = "end of the capture";
+    while (!m_stop)
+    {
+        struct pollfd   pfd = { .fd = master, .events = POLLIN };
+        struct timespec timeout;
+        double          wait;
+
+        now = now_s() - start;
+        link_switch(p_replay, now);
+        if (p_replay->multiplier > 0)
+        {
+            sched_run(p_replay, now);
+        }
+        if (p_replay->out_done == p_replay->out_len)
+        {
+            out_fill(p_replay, now);
+        }
+
+        if (p_replay->out_done < p_replay->out_len)
+        {
+            ssize_t n = write(master, &p_replay->out[p_replay->out_done], p_replay->out_len - p_replay->out_done);
+
+            if ((n < 0) && (errno != EAGAIN) && (errno != EINTR))
+            {
+                *pp_end = strerror(errno);
+                break;
+            }
+            if (n > 0)
+            {
+                p_replay->out_done    += (size_t)n;
+                p_replay->stats.bytes += (uint64_t)n;
+                behind = out_count(p_replay, now);
+            }
+            if (p_replay->out_done == p_replay->out_len)
+            {
+                continue;
+            }
+            pfd.events |= POLLOUT;
+        }
+        else if (!cursor_peek(p_replay, &p_replay->send) && (p_replay->reply_len == 0) &&
+                 (p_replay->switch_baudrate == 0))
+        {
+            reader_drain(p_name);
+            now = now_s() - start;
+            break;
+        }
+        else
+        {
+            behind = 0;
+        }
+
+        // Until the next chunk is due, the reader takes more or the next report.
+        wait = report - now;
+        if (!(pfd.events & POLLOUT) && cursor_peek(p_replay, &p_replay->send) && (p_replay->send.due - now < wait))
+        {
+            wait = p_replay->send.due - now;
+        }
+        if ((p_replay->switch_baudrate != 0) && (p_replay->switch_due - now < wait))
+        {
+            wait = p_replay->switch_due - now;
+        }
+        wait = (wait > 0) ? wait : 0;
+        timeout.tv_sec  = (time_t)wait;
+        timeout.tv_nsec = (long)((wait - (double)timeout.tv_sec) * 1e9);
+        if ((ppoll(&pfd, 1, &timeout, NULL) > 0) && (pfd.revents & POLLHUP))
+        {
+            *pp_end = "the reader closed the pty";
+            break;
+        }
+        if (pfd.events & POLLOUT)
+        {
+            // The reader had not taken what was written.
+            p_replay->stats.blocked += (now_s() - start) - now;
+        }
+
+        if (pfd.revents & POLLIN)
+        {
+            uint8_t buf[256];
+            ssize_t n = read(master, buf, sizeof(buf));
+
+            if (n > 0)
+            {
+                scan_decoder_feed(&p_replay->decoder, buf, (size_t)n);
+            }
+        }
+
+        now = now_s() - start;
+        if (now >= report)
+        {
+            if (p_replay->out_done < p_replay->out_len)
+            {
+                behind = out_count(p_replay, now);
+            }
+            if (!quiet)
+            {
+                report_print(p_replay, &last, now, now - (report - REPORT_INTERVAL_S), behind);
+            }
+            last    = p_replay->stats;
+            report += REPORT_INTERVAL_S;
+        }
+    }
+
+    if (m_stop)
+    {
+        *pp_end = "stopped";
+    }
+
+    return now;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static replay_t  replay = { .multiplier = 1, .loops = 1 };
+    struct sigaction sa = { .sa_handler = signal_handle };
+    struct stat      st;
+    char const     * p_link = NULL;
+    char const     * p_name;
+    char const     * p_end;
+    double           elapsed;
+    double           span;
+    bool             quiet = false;
+    int              master;
+    int              fd;
+    int              opt;
+
+    while ((opt = getopt(argc, argv, "x:mb:n:l:qh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'x':
+                replay.multiplier = strtod(optarg, NULL);
+                if ((replay.multiplier < 1) || (replay.multiplier > MULTIPLIER_MAX))
+                {
+                    fprintf(stderr, "%s: the multiplier goes from 1 to %u\n", argv[0], MULTIPLIER_MAX);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'm':
+                replay.multiplier = 0;
+                break;
+
+            case 'b':
+                replay.baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'n':
+                replay.loops = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'l':
+                p_link = optarg;
+                break;
+
+            case 'q':
+                quiet = true;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (st.st_size == 0)
+    {
+        fprintf(stderr, "%s: empty capture\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    replay.capture_len = (uint64_t)st.st_size;
+    replay.p_capture   = mmap(NULL, (size_t)replay.capture_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (replay.p_capture == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    madvise((void *)replay.p_capture, (size_t)replay.capture_len, MADV_SEQUENTIAL);
+
+    replay.link_baudrate = (replay.baudrate != 0) ? replay.baudrate : LINK_BAUDRATE_DEFAULT;
+    scan_decoder_init(&replay.decoder, command_handle, &replay);
+
+    master = pty_open(&p_name);
+    if (master < 0)
+    {
+        perror("pty");
+        return EXIT_FAILURE;
+    }
+    if (p_link != NULL)
+    {
+        // Only a link left by an earlier run is replaced.
+        if ((lstat(p_link, &st) == 0) && S_ISLNK(st.st_mode))
+        {
+            unlink(p_link);
+        }
+        if (symlink(p_name, p_link) != 0)
+        {
+            fprintf(stderr, "%s: %s\n", p_link, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    printf("%s\n", p_name);
+    fflush(stdout);
+
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (reader_wait(master))
+    {
+        elapsed = replay_run(&replay, master, p_name, quiet, &p_end);
+
+        // What the schedule asked for: up to its end when it got there, up to now otherwise.
+        span = (replay.sched.done && (replay.multiplier > 0)) ? replay.sched.due : elapsed;
+        fprintf(stderr, "\n%s after %.2f s; records: %llu, bytes: %llu, capture played: %u times\n",
+                p_end, elapsed,
+                (unsigned long long)replay.stats.records, (unsigned long long)replay.stats.bytes,
+                replay.send.loop);
+        if (replay.multiplier > 0)
+        {
+            fprintf(stderr, "requested: %.0f records/s (%gx)\n",
+                    (span > 0) ? (double)replay.stats.requested / span : 0, replay.multiplier);
+        }
+        else
+        {
+            fprintf(stderr, "requested: as fast as the reader takes them\n");
+        }
+        fprintf(stderr, "achieved:  %.0f records/s, %.1f kB/s (%.0f baud)",
+                (elapsed > 0) ? (double)replay.stats.records / elapsed : 0,
+                (elapsed > 0) ? (double)replay.stats.bytes / elapsed / 1e3 : 0,
+                (elapsed > 0) ? (double)replay.stats.bytes * BITS_PER_BYTE / elapsed : 0);
+        if ((replay.multiplier > 0) && (replay.stats.requested > 0))
+        {
+            fprintf(stderr, ", %.1f%% of the records due",
+                    100.0 * (double)replay.stats.records / (double)replay.stats.requested);
+        }
+        fprintf(stderr, "\n");
+        if ((replay.multiplier > 0) || (replay.baudrate != 0))
+        {
+            fprintf(stderr, "behind: %.1f ms at most, ", replay.stats.behind_max * 1e3);
+        }
+        fprintf(stderr, "blocked on the reader: %.1f s\n", replay.stats.blocked);
+    }
+
+    if (p_link != NULL)
+    {
+        unlink(p_link);
+    }
+    close(master);
+
+    return EXIT_SUCCESS;
+}
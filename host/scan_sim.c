@@ -0,0 +1,603 @@
+/***************************************************************************************/
+/*
+ * scan_sim
+ *
+ *  Runs the scanner firmware on the host against simulated advertisers, to see how it
+ *  copes with a given load before flashing it: time taken by the BLE handlers, UART
+ *  bytes per report and reports dropped along the way. The UART bytes are given per
+ *  report sent, what a report costs on the line, and per report received, what the
+ *  load costs once the duplicates and the drops are left out.
+ *
+ *  Each advertiser sends one packet per advertising interval, plus the random delay of
+ *  up to 10 ms the specification adds. Packets up to 31 bytes on the 1M PHY are legacy
+ *  advertisements, the others are extended ones and longer data is chained. The
+ *  advertising data does not change unless -c is given, so the duplicate suppression
+ *  works as it would with beacons.
+ *
+ *  The firmware is built with the configuration of pca10056/s140/config/sdk_config.h;
+ *  SCANNER_* settings can be overridden with SIM_DEFS on the make command line. The
+ *  report queue gets SIM_ARENA_SIZE bytes.
+ *
+ *  With -j the figures of the run are also written as JSON, for scan_bench.py.
+ *
+ *  Usage: scan_sim [-d seconds] [-r reports/s] [-a advertisers] [-l len[-max]]
+ *                  [-p 1m|2m|coded|mix] [-c] [-b baudrate] [-s seed] [-o capture]
+ *                  [-j results.json]
+*/
+/***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sdk_common.h"
+#include "sim_sdk.h"
+#include "nrf.h"
+#include "scan_decoder.h"
+#include "scan_output.h"
+#include "scan_ring.h"
+
+#define ADV_DELAY_MAX_US        10000                                   /**< Random delay added to each advertising interval. */
+#define AD_LEN_MAX              31                                      /**< Longest AD structure generated. */
+#define TEXT_SEPARATOR          "----------------------------------\r\n"  /**< Logged by main.c after each report in text mode. */
+
+/**@brief Advertiser PHY modes. */
+typedef enum
+{
+    PHY_MODE_1M,                                                        /**< Primary and secondary channels on 1M. */
+    PHY_MODE_2M,                                                        /**< Primary channels on 1M, secondary channels on 2M. */
+    PHY_MODE_CODED,                                                     /**< Primary and secondary channels on Coded. */
+    PHY_MODE_MIX,                                                       /**< One of the above for each advertiser. */
+} phy_mode_t;
+
+/**@brief A simulated advertiser. */
+typedef struct
+{
+    uint64_t next_us;                                                   /**< Time of its next packet. */
+    uint64_t interval_us;
+    uint8_t  addr[BLE_GAP_ADDR_LEN];
+    uint8_t  primary_phy;
+    uint8_t  secondary_phy;
+    uint8_t  set_id;
+    int8_t   rssi;
+    uint16_t data_id;
+    uint16_t len;
+    uint8_t  data[BLE_GAP_SCAN_BUFFER_EXTENDED_MAX];
+} advertiser_t;
+
+/**@brief Simulation state. */
+typedef struct
+{
+    advertiser_t  * p_advs;
+    uint32_t      * p_heap;                                             /**< Advertisers ordered by next_us. */
+    uint32_t        count;
+    bool            changing;                                           /**< The data changes at every packet. */
+    FILE          * p_capture;
+    scan_decoder_t  decoder;
+    uint64_t        records[256];                                       /**< Records received, per frame type. */
+    uint64_t        reports_sent;                                       /**< Reports that went out, alone or as beacons. */
+    scan_stats_t    stats;                                              /**< Last statistics record. */
+    bool            stats_valid;
+} sim_t;
+
+
+static uint32_t rand_range(uint32_t min, uint32_t max)
+{
+    return min + (uint32_t)((uint64_t)rand() * (max - min + 1) / ((uint64_t)RAND_MAX + 1));
+}
+
+
+/**@brief Function for filling advertising data with manufacturer specific AD structures. */
+static void adv_data_make(advertiser_t * p_adv, uint32_t seq)
+{
+    uint16_t pos = 0;
+
+    while (pos < p_adv->len)
+    {
+        uint16_t ad_len = MIN(AD_LEN_MAX, p_adv->len - pos);
+
+        p_adv->data[pos] = (uint8_t)(ad_len - 1);
+        if (ad_len > 1)
+        {
+            p_adv->data[pos + 1] = 0xFF;
+        }
+        for (uint16_t i = 2; i < ad_len; i++)
+        {
+            p_adv->data[pos + i] = (uint8_t)(p_adv->addr[0] + i);
+        }
+        pos += ad_len;
+    }
+
+    if (p_adv->len >= 6)
+    {
+        memcpy(&p_adv->data[2], &seq, sizeof(seq));
+    }
+}
+
+
+static bool heap_less(sim_t const * p_sim, uint32_t a, uint32_t b)
+{
+    return p_sim->p_advs[p_sim->p_heap[a]].next_us < p_sim->p_advs[p_sim->p_heap[b]].next_us;
+}
+
+
+static void heap_swap(sim_t * p_sim, uint32_t a, uint32_t b)
+{
+    uint32_t tmp = p_sim->p_heap[a];
+
+    p_sim->p_heap[a] = p_sim->p_heap[b];
+    p_sim->p_heap[b] = tmp;
+}
+
+
+/**@brief Function for restoring the heap order after the first advertiser was rescheduled. */
+static void heap_sift_down(sim_t * p_sim, uint32_t i)
+{
+    for (;;)
+    {
+        uint32_t least = i;
+        uint32_t left  = 2 * i + 1;
+        uint32_t right = left + 1;
+
+        if ((left < p_sim->count) && heap_less(p_sim, left, least))
+        {
+            least = left;
+        }
+        if ((right < p_sim->count) && heap_less(p_sim, right, least))
+        {
+            least = right;
+        }
+        if (least == i)
+        {
+            return;
+        }
+        heap_swap(p_sim, i, least);
+        i = least;
+    }
+}
+
+
+static void advertisers_init(sim_t      * p_sim,
+                             uint32_t     count,
+                             double       rate,
+                             uint16_t     len_min,
+                             uint16_t     len_max,
+                             phy_mode_t   phy_mode)
+{
+    uint64_t interval_us = (uint64_t)(count * 1e6 / rate);
+
+    p_sim->count  = count;
+    p_sim->p_advs = calloc(count, sizeof(advertiser_t));
+    p_sim->p_heap = calloc(count, sizeof(uint32_t));
+    if ((p_sim->p_advs == NULL) || (p_sim->p_heap == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        advertiser_t * p_adv = &p_sim->p_advs[i];
+        phy_mode_t     mode  = (phy_mode == PHY_MODE_MIX) ? (phy_mode_t)rand_range(PHY_MODE_1M, PHY_MODE_CODED)
+                                                          : phy_mode;
+
+        // The delay added to each interval is ADV_DELAY_MAX_US / 2 on average.
+        p_adv->interval_us   = (interval_us > ADV_DELAY_MAX_US / 2) ? interval_us - ADV_DELAY_MAX_US / 2 : 0;
+        p_adv->next_us       = rand_range(0, (uint32_t)MIN(interval_us, UINT32_MAX));
+        memcpy(p_adv->addr, &i, sizeof(i));
+        p_adv->addr[4]       = (uint8_t)rand();
+        p_adv->addr[5]       = 0xC0;
+        p_adv->primary_phy   = (mode == PHY_MODE_CODED) ? BLE_GAP_PHY_CODED : BLE_GAP_PHY_1MBPS;
+        p_adv->secondary_phy = (mode == PHY_MODE_CODED) ? BLE_GAP_PHY_CODED
+                             : (mode == PHY_MODE_2M)    ? BLE_GAP_PHY_2MBPS
+                                                        : BLE_GAP_PHY_1MBPS;
+        p_adv->set_id        = (uint8_t)(i & 0x0F);
+        p_adv->rssi          = (int8_t)-rand_range(40, 95);
+        p_adv->len           = (uint16_t)rand_range(len_min, len_max);
+        adv_data_make(p_adv, 0);
+
+        p_sim->p_heap[i] = i;
+    }
+
+    for (uint32_t i = count / 2; i-- > 0;)
+    {
+        heap_sift_down(p_sim, i);
+    }
+}
+
+
+/**@brief Function for sending the next packet of the advertiser that is due first. */
+static bool packet_next(sim_packet_t * p_packet, void * p_context)
+{
+    sim_t                    * p_sim    = p_context;
+    advertiser_t             * p_adv    = &p_sim->p_advs[p_sim->p_heap[0]];
+    ble_gap_evt_adv_report_t * p_report = &p_packet->report;
+    bool                       legacy   = (p_adv->primary_phy == BLE_GAP_PHY_1MBPS)
+                                       && (p_adv->secondary_phy == BLE_GAP_PHY_1MBPS)
+                                       && (p_adv->len <= BLE_GAP_ADV_SET_DATA_SIZE_MAX);
+
+    memset(p_packet, 0, sizeof(*p_packet));
+    p_packet->time_us = p_adv->next_us;
+
+    memcpy(p_report->peer_addr.addr, p_adv->addr, sizeof(p_adv->addr));
+    p_report->peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    p_report->type.extended_pdu   = !legacy;
+    p_report->primary_phy         = p_adv->primary_phy;
+    p_report->secondary_phy       = legacy ? BLE_GAP_PHY_NOT_SET : p_adv->secondary_phy;
+    p_report->tx_power            = BLE_GAP_POWER_LEVEL_INVALID;
+    p_report->rssi                = (int8_t)(p_adv->rssi + (int8_t)rand_range(0, 6) - 3);
+    p_report->ch_index            = legacy ? (uint8_t)rand_range(37, 39) : (uint8_t)rand_range(0, 36);
+    p_report->set_id              = legacy ? BLE_GAP_ADV_REPORT_SET_ID_NOT_AVAILABLE : p_adv->set_id;
+    p_report->data_id             = legacy ? 0 : p_adv->data_id;
+    p_report->data.p_data         = p_adv->data;
+    p_report->data.len            = p_adv->len;
+
+    // Next packet. The data sent must stay valid until the simulator asks for another one.
+    if (p_sim->changing)
+    {
+        static uint32_t seq;
+        static uint8_t  data[BLE_GAP_SCAN_BUFFER_EXTENDED_MAX];
+
+        memcpy(data, p_adv->data, p_adv->len);
+        p_report->data.p_data = data;
+
+        adv_data_make(p_adv, ++seq);
+        p_adv->data_id = (p_adv->data_id + 1) & 0x0FFF;
+    }
+    p_adv->next_us += p_adv->interval_us + rand_range(0, ADV_DELAY_MAX_US);
+    heap_sift_down(p_sim, 0);
+
+    return true;
+}
+
+
+static void record_handler(scan_record_t const * p_record, void * p_context)
+{
+    sim_t * p_sim = p_context;
+
+    p_sim->records[p_record->type]++;
+    if ((p_record->type == SCAN_FRAME_TYPE_ADV_REPORT) || (p_record->type == SCAN_FRAME_TYPE_BEACON))
+    {
+        p_sim->reports_sent++;
+    }
+    if ((p_record->type == SCAN_FRAME_TYPE_STATS) && (scan_record_stats_parse(p_record, &p_sim->stats) == 0))
+    {
+        p_sim->stats_valid = true;
+    }
+}
+
+
+static void uart_sink(uint8_t const * p_data, size_t len, void * p_context)
+{
+    sim_t * p_sim = p_context;
+
+    if ((p_sim->p_capture != NULL) && (fwrite(p_data, 1, len, p_sim->p_capture) != len))
+    {
+        perror("capture");
+        exit(EXIT_FAILURE);
+    }
+    scan_decoder_feed(&p_sim->decoder, p_data, len);
+
+    // Each log entry comes whole, the separator on its own.
+    if ((SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_TEXT) && (len == sizeof(TEXT_SEPARATOR) - 1) &&
+        (memcmp(p_data, TEXT_SEPARATOR, len) == 0))
+    {
+        p_sim->reports_sent++;
+    }
+}
+
+
+static int latency_cmp(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Figures of a run. */
+typedef struct
+{
+    double            seconds;
+    double            reports;                                          /**< Reports received, at least 1 to divide by. */
+    double            sent;                                             /**< Reports sent, at least 1 to divide by. */
+    scan_ring_stats_t ring;
+    double            latency_mean_ns;
+    uint32_t          latency_p50_ns;
+    uint32_t          latency_p99_ns;
+    uint32_t          latency_max_ns;
+    double            line_busy;                                        /**< Fraction of the time the UART was busy. */
+} results_t;
+
+
+static void results_get(sim_t const * p_sim, sim_stats_t * p_stats, double seconds, results_t * p_results)
+{
+    memset(p_results, 0, sizeof(*p_results));
+    p_results->seconds   = seconds;
+    p_results->reports   = (p_stats->reports > 0) ? (double)p_stats->reports : 1.0;
+    p_results->sent      = (p_sim->reports_sent > 0) ? (double)p_sim->reports_sent : 1.0;
+    p_results->line_busy = p_stats->tx_busy_us / (seconds * 1e6);
+    scan_ring_stats_get(&p_results->ring);
+
+    if (p_stats->latency_count > 0)
+    {
+        uint32_t * p_ns  = p_stats->p_latency_ns;
+        size_t     n     = p_stats->latency_count;
+        uint64_t   total = 0;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            total += p_ns[i];
+        }
+        qsort(p_ns, n, sizeof(p_ns[0]), latency_cmp);
+
+        p_results->latency_mean_ns = (double)total / n;
+        p_results->latency_p50_ns  = p_ns[n / 2];
+        p_results->latency_p99_ns  = p_ns[n * 99 / 100];
+        p_results->latency_max_ns  = p_ns[n - 1];
+    }
+}
+
+
+static void results_print(sim_t const * p_sim, sim_stats_t const * p_stats, results_t const * p_results)
+{
+    double reports = p_results->reports;
+
+    printf("simulated time      %.3f s\n", p_results->seconds);
+    printf("packets on air      %llu, %llu not scanned, %llu lost to a paused scanner\n",
+           (unsigned long long)p_stats->packets, (unsigned long long)p_stats->not_scanned,
+           (unsigned long long)p_stats->paused);
+    printf("reports             %llu (%.0f/s)\n", (unsigned long long)p_stats->reports,
+           p_stats->reports / p_results->seconds);
+    printf("report queue        %u slots, high water %u, %u dropped\n",
+           scan_ring_size(), p_results->ring.high_water, p_results->ring.overflows);
+
+    if (p_stats->latency_count > 0)
+    {
+        printf("handler latency     mean %.0f ns, p50 %u ns, p99 %u ns, max %u ns (host)\n",
+               p_results->latency_mean_ns, p_results->latency_p50_ns, p_results->latency_p99_ns,
+               p_results->latency_max_ns);
+    }
+    printf("main loop           %.0f ns per report, %llu wake-ups (host)\n",
+           p_stats->loop_ns / reports, (unsigned long long)p_stats->wakeups);
+    printf("cycles per report   %.0f in the handlers, %.0f in the main loop (%s, %.2f GHz)\n",
+           p_stats->handler_cycles / reports, p_stats->loop_cycles / reports,
+           sim_cycles_source(), SystemCoreClock / 1e9);
+
+    printf("uart                %u baud, %llu bytes, line busy %.1f%%\n",
+           p_stats->baudrate, (unsigned long long)p_stats->tx_bytes, 100.0 * p_results->line_busy);
+    printf("bytes per report    %.1f per report sent (%llu), %.1f per report received\n",
+           p_stats->tx_bytes / p_results->sent, (unsigned long long)p_sim->reports_sent,
+           p_stats->tx_bytes / reports);
+    if (NRF_LOG_BACKEND_UART_ENABLED || (p_stats->log_dropped > 0))
+    {
+        printf("log                 %llu bytes, %.1f bytes per report, %llu entries lost\n",
+               (unsigned long long)p_stats->log_bytes, p_stats->log_bytes / reports,
+               (unsigned long long)p_stats->log_dropped);
+    }
+    printf("records             %llu reports, %llu beacons, %llu alive, %llu rssi summaries, %llu stats\n",
+           (unsigned long long)p_sim->records[SCAN_FRAME_TYPE_ADV_REPORT],
+           (unsigned long long)p_sim->records[SCAN_FRAME_TYPE_BEACON],
+           (unsigned long long)p_sim->records[SCAN_FRAME_TYPE_ALIVE],
+           (unsigned long long)p_sim->records[SCAN_FRAME_TYPE_RSSI_SUMMARY],
+           (unsigned long long)p_sim->records[SCAN_FRAME_TYPE_STATS]);
+
+    if (p_sim->stats_valid)
+    {
+        printf("last stats record   %u received, %u sent, %u queue full, %u duplicates, "
+               "%u held back, window %u, cpu %u.%02u%%\n",
+               p_sim->stats.reports_received, p_sim->stats.reports_sent, p_sim->stats.drop_queue_full,
+               p_sim->stats.drop_duplicate, p_sim->stats.tx_busy, p_sim->stats.scan_window,
+               p_sim->stats.cpu_load / 100, p_sim->stats.cpu_load % 100);
+    }
+}
+
+
+/**@brief Function for writing the figures of the run as a JSON object, for scan_bench.py. */
+static int results_json_write(char const * p_path, sim_stats_t const * p_stats, results_t const * p_results)
+{
+    FILE   * p_file  = fopen(p_path, "w");
+    double   reports = p_results->reports;
+    int      ret     = 0;
+
+    if (p_file == NULL)
+    {
+        return -1;
+    }
+
+    ret |= fprintf(p_file,
+                   "{\n"
+                   "  \"format\": \"%s\",\n"
+                   "  \"seconds\": %.3f,\n"
+                   "  \"packets\": %llu,\n"
+                   "  \"not_scanned\": %llu,\n"
+                   "  \"paused\": %llu,\n"
+                   "  \"reports\": %llu,\n"
+                   "  \"reports_per_s\": %.1f,\n"
+                   "  \"queue_dropped\": %u,\n"
+                   "  \"queue_high_water\": %u,\n"
+                   "  \"queue_size\": %u,\n"
+                   "  \"log_dropped\": %llu,\n"
+                   "  \"baudrate\": %u,\n"
+                   "  \"tx_bytes\": %llu,\n"
+                   "  \"bytes_per_report\": %.2f,\n"
+                   "  \"bytes_per_report_sent\": %.2f,\n"
+                   "  \"line_busy\": %.4f,\n"
+                   "  \"cycles_source\": \"%s\",\n"
+                   "  \"cycles_hz\": %u,\n"
+                   "  \"handler_cycles_per_report\": %.1f,\n"
+                   "  \"loop_cycles_per_report\": %.1f,\n"
+                   "  \"handler_ns_mean\": %.1f,\n"
+                   "  \"handler_ns_p99\": %u,\n"
+                   "  \"loop_ns_per_report\": %.1f\n"
+                   "}\n",
+                   (SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY) ? "binary" : "text",
+                   p_results->seconds,
+                   (unsigned long long)p_stats->packets, (unsigned long long)p_stats->not_scanned,
+                   (unsigned long long)p_stats->paused, (unsigned long long)p_stats->reports,
+                   p_stats->reports / p_results->seconds,
+                   p_results->ring.overflows, p_results->ring.high_water, scan_ring_size(),
+                   (unsigned long long)p_stats->log_dropped,
+                   p_stats->baudrate, (unsigned long long)p_stats->tx_bytes, p_stats->tx_bytes / reports,
+                   p_stats->tx_bytes / p_results->sent, p_results->line_busy,
+                   sim_cycles_source(), SystemCoreClock,
+                   p_stats->handler_cycles / reports, p_stats->loop_cycles / reports,
+                   p_results->latency_mean_ns, p_results->latency_p99_ns,
+                   p_stats->loop_ns / reports) < 0;
+
+    if (fclose(p_file) != 0)
+    {
+        ret = 1;
+    }
+
+    return ret ? -1 : 0;
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "Usage: %s [-d seconds] [-r reports/s] [-a advertisers] [-l len[-max]]\n"
+                    "       %*s [-p 1m|2m|coded|mix] [-c] [-b baudrate] [-s seed] [-o capture] [-j results.json]\n",
+            p_name, (int)strlen(p_name), "");
+}
+
+
+int main(int argc, char * argv[])
+{
+    static sim_t sim;
+    sim_config_t config;
+    sim_stats_t  stats;
+    results_t    results;
+    double       seconds  = 10;
+    double       rate     = 1000;
+    uint32_t     count    = 100;
+    uint32_t     len_min  = 31;
+    uint32_t     len_max  = 31;
+    uint32_t     baudrate = 0;
+    phy_mode_t   phy_mode = PHY_MODE_1M;
+    char const * p_out    = NULL;
+    char const * p_json   = NULL;
+    char       * p_end;
+    int          opt;
+
+    srand(1);
+    while ((opt = getopt(argc, argv, "d:r:a:l:p:cb:s:o:j:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                seconds = strtod(optarg, NULL);
+                break;
+
+            case 'r':
+                rate = strtod(optarg, NULL);
+                break;
+
+            case 'a':
+                count = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'l':
+                len_min = (uint32_t)strtoul(optarg, &p_end, 10);
+                len_max = (*p_end == '-') ? (uint32_t)strtoul(p_end + 1, NULL, 10) : len_min;
+                break;
+
+            case 'p':
+                if (strcmp(optarg, "1m") == 0)
+                {
+                    phy_mode = PHY_MODE_1M;
+                }
+                else if (strcmp(optarg, "2m") == 0)
+                {
+                    phy_mode = PHY_MODE_2M;
+                }
+                else if (strcmp(optarg, "coded") == 0)
+                {
+                    phy_mode = PHY_MODE_CODED;
+                }
+                else if (strcmp(optarg, "mix") == 0)
+                {
+                    phy_mode = PHY_MODE_MIX;
+                }
+                else
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'c':
+                sim.changing = true;
+                break;
+
+            case 'b':
+                baudrate = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 's':
+                srand((unsigned int)strtoul(optarg, NULL, 10));
+                break;
+
+            case 'o':
+                p_out = optarg;
+                break;
+
+            case 'j':
+                p_json = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((seconds <= 0) || (rate <= 0) || (count == 0) || (len_min > len_max)
+        || (len_max > BLE_GAP_SCAN_BUFFER_EXTENDED_MAX) || (optind != argc))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (p_out != NULL)
+    {
+        sim.p_capture = fopen(p_out, "wb");
+        if (sim.p_capture == NULL)
+        {
+            perror(p_out);
+            return EXIT_FAILURE;
+        }
+    }
+    scan_decoder_init(&sim.decoder, record_handler, &sim);
+    advertisers_init(&sim, count, rate, (uint16_t)len_min, (uint16_t)len_max, phy_mode);
+
+    memset(&config, 0, sizeof(config));
+    config.duration_us = (uint64_t)(seconds * 1e6);
+    config.baudrate    = baudrate;
+    config.source      = packet_next;
+    config.sink        = uart_sink;
+    config.p_context   = &sim;
+
+    sim_run(&config, &stats);
+    scan_decoder_flush(&sim.decoder);
+
+    results_get(&sim, &stats, seconds, &results);
+    results_print(&sim, &stats, &results);
+
+    if ((p_json != NULL) && (results_json_write(p_json, &stats, &results) != 0))
+    {
+        perror(p_json);
+        return EXIT_FAILURE;
+    }
+
+    if (sim.p_capture != NULL)
+    {
+        fclose(sim.p_capture);
+    }
+    free(stats.p_latency_ns);
+    free(sim.p_advs);
+    free(sim.p_heap);
+
+    return EXIT_SUCCESS;
+}
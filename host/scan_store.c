@@ -0,0 +1,329 @@
+/***************************************************************************************/
+/*
+ * scan_store
+ *
+ *  Writes, queries and describes columnar capture files (see scan_col.h).
+ *
+ *  Usage: scan_store write [-n chunk_reports] <file> <capture | ->
+ *         scan_store query [-a addr] [-s seconds] [-e seconds] <file>
+ *         scan_store info <file>
+ *
+ *    write     store the advertising reports of a binary capture (scan_sim -o,
+ *              scan_ingestd -c) or of the standard input
+ *    query     print the reports of an address (written as scan_dump prints it,
+ *              e.g. c0:55:44:33:22:11) and of a time range, as scan_dump does
+ *    info      print the chunks, the time range and the size of each column
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_col.h"
+#include "scan_text.h"
+
+#define ADDR_LEN                6
+
+static char const * const m_column_names[SCAN_COL_COUNT] =
+{
+    [SCAN_COL_DICT] = "dict",
+    [SCAN_COL_TIME] = "time",
+    [SCAN_COL_ADDR] = "addr",
+    [SCAN_COL_RSSI] = "rssi",
+    [SCAN_COL_PHY]  = "phy",
+    [SCAN_COL_META] = "meta",
+    [SCAN_COL_DATA] = "data",
+};
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr,
+            "Usage: %s write [-n chunk_reports] <file> <capture | ->\n"
+            "       %s query [-a addr] [-s seconds] [-e seconds] <file>\n"
+            "       %s info <file>\n",
+            p_name, p_name, p_name);
+}
+
+
+/**@brief Function for reading an address written most significant byte first.
+ *
+ * @return 0 on success, -1 if the text is not an address.
+ */
+static int addr_parse(char const * p_text, uint8_t * p_addr)
+{
+    unsigned bytes[ADDR_LEN];
+    char     end;
+
+    if (sscanf(p_text, "%2x:%2x:%2x:%2x:%2x:%2x%c",
+               &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0], &end) != ADDR_LEN)
+    {
+        return -1;
+    }
+    for (int i = 0; i < ADDR_LEN; i++)
+    {
+        p_addr[i] = (uint8_t)bytes[i];
+    }
+
+    return 0;
+}
+
+
+/**@brief Function for reading a time in seconds as microseconds.
+ *
+ * @return 0 on success, -1 if the text is not a time.
+ */
+static int time_parse(char const * p_text, uint64_t * p_us)
+{
+    char * p_end;
+    double seconds = strtod(p_text, &p_end);
+
+    if ((p_end == p_text) || (*p_end != '\0') || (seconds < 0))
+    {
+        return -1;
+    }
+    *p_us = (uint64_t)(seconds * 1e6 + 0.5);
+
+    return 0;
+}
+
+
+static void record_store(scan_record_t const * p_record, void * p_context)
+{
+    scan_col_writer_t ** pp_writer = p_context;
+
+    if ((*pp_writer != NULL) && (scan_col_writer_add(*pp_writer, p_record) != 0))
+    {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+static int write_run(int argc, char * argv[])
+{
+    scan_col_writer_t * p_writer;
+    scan_decoder_t      decoder;
+    uint32_t            chunk_reports = 0;
+    uint8_t             buf[65536];
+    int                 opt;
+    int                 fd;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                chunk_reports = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                return -1;
+        }
+    }
+    if (optind != argc - 2)
+    {
+        return -1;
+    }
+
+    fd = (strcmp(argv[optind + 1], "-") == 0) ? STDIN_FILENO : open(argv[optind + 1], O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (scan_col_writer_open(&p_writer, argv[optind], chunk_reports) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    scan_decoder_init(&decoder, record_store, &p_writer);
+    for (;;)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        scan_decoder_feed(&decoder, buf, (size_t)n);
+    }
+    scan_decoder_flush(&decoder);
+
+    if (scan_col_writer_close(p_writer) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(stderr, "frames: %llu, crc errors: %llu, skipped bytes: %llu\n",
+            (unsigned long long)decoder.frames,
+            (unsigned long long)decoder.crc_errors,
+            (unsigned long long)decoder.skipped);
+
+    return 0;
+}
+
+
+static void record_print(scan_record_t const * p_record, void * p_context)
+{
+    scan_text_record_print(p_context, p_record);
+}
+
+
+static int query_run(int argc, char * argv[])
+{
+    scan_col_query_t       query = { .t_max = UINT64_MAX };
+    scan_col_query_stats_t stats;
+    scan_col_reader_t    * p_reader;
+    scan_text_t            text;
+    int                    opt;
+
+    while ((opt = getopt(argc, argv, "a:s:e:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                if (addr_parse(optarg, query.addr) != 0)
+                {
+                    return -1;
+                }
+                query.by_addr = true;
+                break;
+
+            case 's':
+                if (time_parse(optarg, &query.t_min) != 0)
+                {
+                    return -1;
+                }
+                break;
+
+            case 'e':
+                if (time_parse(optarg, &query.t_max) != 0)
+                {
+                    return -1;
+                }
+                break;
+
+            default:
+                return -1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        return -1;
+    }
+
+    if (scan_col_reader_open(&p_reader, argv[optind]) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    scan_text_init(&text, stdout);
+    if (scan_col_query(p_reader, &query, record_print, &text, &stats) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    scan_col_reader_close(p_reader);
+
+    fprintf(stderr, "reports: %llu, chunks read: %u of %u, bytes read: %llu\n",
+            (unsigned long long)stats.reports, stats.chunks_read, stats.chunks,
+            (unsigned long long)stats.bytes_read);
+
+    return 0;
+}
+
+
+static int info_run(int argc, char * argv[])
+{
+    scan_col_index_t const * p_index;
+    scan_col_reader_t      * p_reader;
+    uint64_t                 column_bytes[SCAN_COL_COUNT] = { 0 };
+    uint64_t                 reports = 0;
+    uint64_t                 t_min = UINT64_MAX;
+    uint64_t                 t_max = 0;
+    uint64_t                 total = 0;
+    uint32_t                 chunks;
+
+    if (argc != 2)
+    {
+        return -1;
+    }
+
+    if (scan_col_reader_open(&p_reader, argv[1]) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    chunks = scan_col_reader_index(p_reader, &p_index);
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+        reports += p_index[i].hdr.reports;
+        t_min    = (p_index[i].hdr.t_min < t_min) ? p_index[i].hdr.t_min : t_min;
+        t_max    = (p_index[i].hdr.t_max > t_max) ? p_index[i].hdr.t_max : t_max;
+        for (int column = 0; column < SCAN_COL_COUNT; column++)
+        {
+            column_bytes[column] += p_index[i].hdr.block_len[column];
+            total                += p_index[i].hdr.block_len[column];
+        }
+    }
+    scan_col_reader_close(p_reader);
+
+    printf("chunks: %u, reports: %llu\n", chunks, (unsigned long long)reports);
+    if (chunks > 0)
+    {
+        printf("time: %llu.%06llu to %llu.%06llu\n",
+               (unsigned long long)(t_min / 1000000), (unsigned long long)(t_min % 1000000),
+               (unsigned long long)(t_max / 1000000), (unsigned long long)(t_max % 1000000));
+    }
+    for (int column = 0; column < SCAN_COL_COUNT; column++)
+    {
+        printf("%-6s %12llu bytes %6.2f per report\n", m_column_names[column],
+               (unsigned long long)column_bytes[column],
+               (reports > 0) ? (double)column_bytes[column] / (double)reports : 0.0);
+    }
+    printf("%-6s %12llu bytes %6.2f per report\n", "total", (unsigned long long)total,
+           (reports > 0) ? (double)total / (double)reports : 0.0);
+
+    return 0;
+}
+
+
+int main(int argc, char * argv[])
+{
+    int err = -1;
+
+    if (argc >= 2)
+    {
+        // The options of the command follow it.
+        if (strcmp(argv[1], "write") == 0)
+        {
+            err = write_run(argc - 1, &argv[1]);
+        }
+        else if (strcmp(argv[1], "query") == 0)
+        {
+            err = query_run(argc - 1, &argv[1]);
+        }
+        else if (strcmp(argv[1], "info") == 0)
+        {
+            err = info_run(argc - 1, &argv[1]);
+        }
+    }
+
+    if (err != 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+/***************************************************************************************/
+/*
+ * scan_text
+ *
+ *  Text form of the scanner records, one line per record.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_beacon.h"
+#include "scan_text.h"
+
+
+/**@brief Function for printing a statistics record. */
+static void stats_print(FILE * p_out, scan_record_t const * p_record)
+{
+    scan_stats_t stats;
+
+    if (scan_record_stats_parse(p_record, &stats) != 0)
+    {
+        fprintf(p_out, "stats malformed len=%u\n", p_record->len);
+        return;
+    }
+
+    fprintf(p_out,
+            "stats t=%llu.%06llu received=%u sent=%u summaries=%u dropped=%u/%u/%u filtered=%u tx=%u busy=%u"
+            " queue=%u/%u output=%u/%u window=%u cpu=%u.%02u%%\n",
+            (unsigned long long)(stats.timestamp_us / 1000000),
+            (unsigned long long)(stats.timestamp_us % 1000000),
+            stats.reports_received, stats.reports_sent, stats.summaries_sent,
+            stats.drop_queue_full, stats.drop_duplicate, stats.drop_output, stats.drop_filtered,
+            stats.tx_bytes, stats.tx_busy,
+            stats.queue_high_water, stats.queue_size, stats.output_high_water, stats.output_size,
+            stats.scan_window, stats.cpu_load / 100, stats.cpu_load % 100);
+}
+
+
+/**@brief Function for printing a profile record, with the cycles per report since the previous one. */
+static void profile_print(scan_text_t * p_text, scan_record_t const * p_record)
+{
+    FILE           * p_out  = p_text->p_out;
+    scan_profile_t * p_last = &p_text->last_profile;
+    scan_profile_t   profile;
+    uint32_t         reports;
+
+    if (p_record->len < sizeof(profile))
+    {
+        fprintf(p_out, "profile malformed len=%u\n", p_record->len);
+        return;
+    }
+    memcpy(&profile, p_record->p_payload, sizeof(profile));
+
+    // Counters restart with the scanner.
+    if (profile.adv_reports < p_last->adv_reports)
+    {
+        memset(p_last, 0, sizeof(*p_last));
+    }
+    reports = profile.adv_reports - p_last->adv_reports;
+
+    fprintf(p_out,
+            "profile t=%llu.%06llu hz=%u reports=%u handler=%llu/%u loop=%llu cycles=%llu/%llu\n",
+            (unsigned long long)(profile.timestamp_us / 1000000),
+            (unsigned long long)(profile.timestamp_us % 1000000),
+            profile.cpu_hz, profile.adv_reports,
+            (unsigned long long)((reports > 0) ? (profile.adv_report_cycles - p_last->adv_report_cycles) / reports : 0),
+            profile.adv_report_cycles_max,
+            (unsigned long long)((reports > 0) ? (profile.loop_cycles - p_last->loop_cycles) / reports : 0),
+            (unsigned long long)profile.adv_report_cycles, (unsigned long long)profile.loop_cycles);
+
+    *p_last = profile;
+}
+
+
+/**@brief Function for printing bytes in hexadecimal, with a dash before the given offsets. */
+static void hex_print(FILE * p_out, uint8_t const * p_data, size_t len, uint32_t dash_mask)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if ((i < 32) && (dash_mask & (1u << i)))
+        {
+            fputc('-', p_out);
+        }
+        fprintf(p_out, "%02x", p_data[i]);
+    }
+}
+
+
+/**@brief Function for printing the fields of a beacon. */
+static void beacon_print(FILE * p_out, uint8_t type, scan_beacon_body_t const * p_body)
+{
+    switch (type)
+    {
+        case SCAN_BEACON_IBEACON:
+            fprintf(p_out, " ibeacon uuid=");
+            hex_print(p_out, p_body->ibeacon.uuid, sizeof(p_body->ibeacon.uuid), 0x0550);
+            fprintf(p_out, " major=%u minor=%u power=%d", p_body->ibeacon.major,
+                    p_body->ibeacon.minor, p_body->ibeacon.measured_power);
+            break;
+
+        case SCAN_BEACON_ALTBEACON:
+            fprintf(p_out, " altbeacon company=0x%04x id=", p_body->altbeacon.company_id);
+            hex_print(p_out, p_body->altbeacon.beacon_id, sizeof(p_body->altbeacon.beacon_id), 0x50550);
+            fprintf(p_out, " power=%d reserved=0x%02x", p_body->altbeacon.ref_rssi,
+                    p_body->altbeacon.mfg_reserved);
+            break;
+
+        case SCAN_BEACON_EDDYSTONE_UID:
+            fprintf(p_out, " eddystone-uid namespace=");
+            hex_print(p_out, p_body->eddystone_uid.namespace_id, sizeof(p_body->eddystone_uid.namespace_id), 0);
+            fprintf(p_out, " instance=");
+            hex_print(p_out, p_body->eddystone_uid.instance_id, sizeof(p_body->eddystone_uid.instance_id), 0);
+            fprintf(p_out, " power=%d", p_body->eddystone_uid.tx_power);
+            break;
+
+        case SCAN_BEACON_EDDYSTONE_URL:
+        {
+            char url[64];
+
+            scan_beacon_url_expand(&p_body->eddystone_url, url, sizeof(url));
+            fprintf(p_out, " eddystone-url url=%s power=%d", url, p_body->eddystone_url.tx_power);
+        } break;
+
+        case SCAN_BEACON_EDDYSTONE_TLM:
+            fprintf(p_out, " eddystone-tlm battery=%umV", p_body->eddystone_tlm.battery_mv);
+            if (p_body->eddystone_tlm.temperature != SCAN_EDDYSTONE_TEMP_INVALID)
+            {
+                fprintf(p_out, " temp=%.2f", p_body->eddystone_tlm.temperature / 256.0);
+            }
+            fprintf(p_out, " count=%u uptime=%u.%u", p_body->eddystone_tlm.adv_count,
+                    p_body->eddystone_tlm.uptime_ds / 10, p_body->eddystone_tlm.uptime_ds % 10);
+            break;
+
+        case SCAN_BEACON_EDDYSTONE_EID:
+            fprintf(p_out, " eddystone-eid eid=");
+            hex_print(p_out, p_body->eddystone_eid.eid, sizeof(p_body->eddystone_eid.eid), 0);
+            fprintf(p_out, " power=%d", p_body->eddystone_eid.tx_power);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**@brief Function for printing a beacon record. */
+static void beacon_record_print(FILE * p_out, scan_record_t const * p_record)
+{
+    scan_beacon_hdr_t  hdr;
+    scan_beacon_body_t body;
+
+    if (scan_record_beacon_parse(p_record, &hdr, &body) != 0)
+    {
+        fprintf(p_out, "beacon malformed len=%u\n", p_record->len);
+        return;
+    }
+
+    fprintf(p_out, "beacon t=%llu.%06llu addr=%02x:%02x:%02x:%02x:%02x:%02x/%u rssi=%d",
+            (unsigned long long)(hdr.timestamp_us / 1000000),
+            (unsigned long long)(hdr.timestamp_us % 1000000),
+            hdr.addr[5], hdr.addr[4], hdr.addr[3], hdr.addr[2], hdr.addr[1], hdr.addr[0],
+            hdr.addr_type, hdr.rssi);
+    beacon_print(p_out, hdr.type, &body);
+    fputc('\n', p_out);
+}
+
+
+/**@brief Function for printing an advertising report.
+ *
+ * @details A beacon is decoded the way the scanner does with SCANNER_BEACON_ENABLED
+ *          and its fields follow the data.
+ */
+static void adv_print(FILE * p_out, scan_record_t const * p_record)
+{
+    scan_report_hdr_t  hdr;
+    uint8_t const    * p_data;
+    scan_beacon_body_t beacon;
+    scan_beacon_type_t beacon_type;
+
+    if (scan_record_adv_parse(p_record, &hdr, &p_data) != 0)
+    {
+        fprintf(p_out, "adv malformed len=%u\n", p_record->len);
+        return;
+    }
+
+    fprintf(p_out, "adv t=%llu.%06llu addr=%02x:%02x:%02x:%02x:%02x:%02x/%u rssi=%d",
+            (unsigned long long)(hdr.timestamp_us / 1000000),
+            (unsigned long long)(hdr.timestamp_us % 1000000),
+            hdr.addr[5], hdr.addr[4], hdr.addr[3], hdr.addr[2], hdr.addr[1], hdr.addr[0],
+            hdr.addr_type, hdr.rssi);
+    if (hdr.tx_power != SCAN_REPORT_TX_POWER_INVALID)
+    {
+        fprintf(p_out, " tx=%d", hdr.tx_power);
+    }
+    fprintf(p_out, " phy=%u/%u ch=%u", hdr.primary_phy, hdr.secondary_phy, hdr.ch_index);
+    if (hdr.set_id != SCAN_REPORT_SET_ID_INVALID)
+    {
+        fprintf(p_out, " sid=%u", hdr.set_id);
+    }
+    fprintf(p_out, " flags=0x%02x%s data=", hdr.flags,
+            (hdr.flags & SCAN_REPORT_FLAG_TRUNCATED) ? " truncated" : "");
+    hex_print(p_out, p_data, hdr.data_len, 0);
+    beacon_type = scan_beacon_decode(p_data, hdr.data_len, &beacon);
+    beacon_print(p_out, beacon_type, &beacon);
+    fputc('\n', p_out);
+}
+
+
+void scan_text_init(scan_text_t * p_text, FILE * p_out)
+{
+    memset(p_text, 0, sizeof(*p_text));
+    p_text->p_out = p_out;
+}
+
+
+void scan_text_record_print(scan_text_t * p_text, scan_record_t const * p_record)
+{
+    FILE * p_out = p_text->p_out;
+
+    switch (p_record->type)
+    {
+        case SCAN_FRAME_TYPE_ADV_REPORT:
+            adv_print(p_out, p_record);
+            break;
+
+        case SCAN_FRAME_TYPE_ALIVE:
+        {
+            scan_alive_t alive;
+
+            if (p_record->len < sizeof(alive))
+            {
+                fprintf(p_out, "alive malformed len=%u\n", p_record->len);
+                break;
+            }
+            memcpy(&alive, p_record->p_payload, sizeof(alive));
+            fprintf(p_out, "alive t=%llu.%06llu addr=%02x:%02x:%02x:%02x:%02x:%02x/%u rssi=%d",
+                    (unsigned long long)(alive.timestamp_us / 1000000),
+                    (unsigned long long)(alive.timestamp_us % 1000000),
+                    alive.addr[5], alive.addr[4], alive.addr[3], alive.addr[2], alive.addr[1], alive.addr[0],
+                    alive.addr_type, alive.rssi);
+            if (alive.set_id != SCAN_REPORT_SET_ID_INVALID)
+            {
+                fprintf(p_out, " sid=%u", alive.set_id);
+            }
+            fprintf(p_out, " flags=0x%02x duplicates=%u\n", alive.flags, alive.count);
+        } break;
+
+        case SCAN_FRAME_TYPE_RSSI_SUMMARY:
+        {
+            scan_rssi_summary_t summary;
+
+            if (p_record->len < sizeof(summary))
+            {
+                fprintf(p_out, "rssi malformed len=%u\n", p_record->len);
+                break;
+            }
+            memcpy(&summary, p_record->p_payload, sizeof(summary));
+            fprintf(p_out, "rssi t=%llu.%06llu addr=%02x:%02x:%02x:%02x:%02x:%02x/%u min=%d mean=%d max=%d count=%u%s\n",
+                    (unsigned long long)(summary.window_us / 1000000),
+                    (unsigned long long)(summary.window_us % 1000000),
+                    summary.addr[5], summary.addr[4], summary.addr[3], summary.addr[2], summary.addr[1], summary.addr[0],
+                    summary.addr_type, summary.rssi_min, summary.rssi_mean, summary.rssi_max, summary.count,
+                    (summary.flags & SCAN_RSSI_SUMMARY_FLAG_EVICTED) ? " evicted" : "");
+        } break;
+
+        case SCAN_FRAME_TYPE_STATS:
+            stats_print(p_out, p_record);
+            break;
+
+        case SCAN_FRAME_TYPE_PROFILE:
+            profile_print(p_text, p_record);
+            break;
+
+        case SCAN_FRAME_TYPE_BEACON:
+            beacon_record_print(p_out, p_record);
+            break;
+
+        case SCAN_FRAME_TYPE_HELLO:
+        {
+            scan_hello_t hello;
+
+            if (p_record->len < sizeof(hello))
+            {
+                fprintf(p_out, "hello malformed len=%u\n", p_record->len);
+                break;
+            }
+            memcpy(&hello, p_record->p_payload, sizeof(hello));
+            fprintf(p_out, "hello version=%u baudrate=%u hwfc=%u\n", hello.version,
+                    hello.baudrate, (hello.flags & SCAN_LINK_FLAG_HWFC) ? 1 : 0);
+        } break;
+
+        default:
+            fprintf(p_out, "unknown type=0x%02x len=%u\n", p_record->type, p_record->len);
+            break;
+    }
+}
@@ -0,0 +1,47 @@
+/***************************************************************************************/
+/*
+ * scan_text
+ *
+ *  Text form of the scanner records, one line per record, as scan_dump prints them.
+ *  Advertising reports that hold a beacon get its decoded fields after the data.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_TEXT_H__
+#define SCAN_TEXT_H__
+
+#include <stdio.h>
+#include "scan_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Printer state. */
+typedef struct
+{
+    FILE         * p_out;                                               /**< Output stream. */
+    scan_profile_t last_profile;                                        /**< Previous profile record, for the cycles per report. */
+} scan_text_t;
+
+
+/**@brief Function for initializing a printer.
+ *
+ * @param[out]  p_text      Printer.
+ * @param[in]   p_out       Stream the lines are written to.
+ */
+void scan_text_init(scan_text_t * p_text, FILE * p_out);
+
+
+/**@brief Function for printing a record as one line of text.
+ *
+ * @param[in]   p_text      Printer.
+ * @param[in]   p_record    Record to print.
+ */
+void scan_text_record_print(scan_text_t * p_text, scan_record_t const * p_record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_TEXT_H__
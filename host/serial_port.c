@@ -0,0 +1,127 @@
+/***************************************************************************************/
+/*
+ * serial_port
+ *
+ *  Helpers to open the serial port of the scanner in raw mode.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "serial_port.h"
+
+
+/**@brief Function for mapping a baud rate to its termios constant. */
+static speed_t speed_get(uint32_t baudrate)
+{
+    switch (baudrate)
+    {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        default:      return B0;
+    }
+}
+
+
+int serial_port_baudrate_set(int fd, uint32_t baudrate)
+{
+    struct termios tio;
+    speed_t        speed = speed_get(baudrate);
+
+    if (speed == B0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        return -1;
+    }
+
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+
+int serial_port_hwfc_set(int fd, bool hwfc)
+{
+    struct termios tio;
+
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        return -1;
+    }
+
+    if (hwfc)
+    {
+        tio.c_cflag |= CRTSCTS;
+    }
+    else
+    {
+        tio.c_cflag &= ~CRTSCTS;
+    }
+
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+
+int serial_port_open(char const * p_path, uint32_t baudrate, int flags)
+{
+    struct termios tio;
+    struct stat    st;
+    int            fd;
+
+    if (strcmp(p_path, "-") == 0)
+    {
+        return STDIN_FILENO;
+    }
+
+    fd = open(p_path, flags | O_NOCTTY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if ((fstat(fd, &st) != 0) || !S_ISCHR(st.st_mode) || !isatty(fd))
+    {
+        return fd;
+    }
+
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+    tio.c_cc[VMIN]  = 1;
+    tio.c_cc[VTIME] = 0;
+
+    if ((tcsetattr(fd, TCSANOW, &tio) != 0) || (serial_port_baudrate_set(fd, baudrate) != 0))
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    tcflush(fd, TCIFLUSH);
+
+    return fd;
+}
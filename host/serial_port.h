@@ -0,0 +1,50 @@
+/***************************************************************************************/
+/*
+ * serial_port
+ *
+ *  Helpers to open the serial port of the scanner in raw mode.
+*/
+/***************************************************************************************/
+
+#ifndef SERIAL_PORT_H__
+#define SERIAL_PORT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for opening a serial port, or a capture file.
+ *
+ * @details Character devices are switched to raw 8N1 mode at @p baudrate.
+ *          Regular files and "-" (stdin) are returned untouched.
+ *
+ * @param[in]   p_path      Path of the device.
+ * @param[in]   baudrate    Baud rate in bits per second.
+ * @param[in]   flags       open(2) flags, e.g. O_RDONLY or O_RDWR | O_NONBLOCK.
+ *
+ * @return File descriptor, or -1 on error (errno is set).
+ */
+int serial_port_open(char const * p_path, uint32_t baudrate, int flags);
+
+
+/**@brief Function for changing the baud rate of an open serial port.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int serial_port_baudrate_set(int fd, uint32_t baudrate);
+
+
+/**@brief Function for enabling or disabling RTS/CTS flow control on an open serial port.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int serial_port_hwfc_set(int fd, bool hwfc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_PORT_H__
@@ -0,0 +1,28 @@
+/***************************************************************************************/
+/*
+ * app_error.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. An error stops the simulation with the file and line that raised it.
+*/
+/***************************************************************************************/
+
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t * p_file_name);
+
+#define APP_ERROR_CHECK(ERR_CODE)                                               \
+do                                                                              \
+{                                                                               \
+    const uint32_t LOCAL_ERR_CODE = (ERR_CODE);                                 \
+    if (LOCAL_ERR_CODE != NRF_SUCCESS)                                          \
+    {                                                                           \
+        app_error_handler(LOCAL_ERR_CODE, __LINE__, (const uint8_t *)__FILE__); \
+    }                                                                           \
+} while (0)
+
+#endif // APP_ERROR_H__
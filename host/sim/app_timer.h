@@ -0,0 +1,53 @@
+/***************************************************************************************/
+/*
+ * app_timer.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The timers run on the simulated time.
+*/
+/***************************************************************************************/
+
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#define APP_TIMER_CLOCK_FREQ        32768
+
+#define APP_TIMER_TICKS(MS)         ((uint32_t)(((uint64_t)(MS) * APP_TIMER_CLOCK_FREQ) / 1000))
+
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+/**@brief Timer state, kept by the simulator. */
+typedef struct
+{
+    app_timer_timeout_handler_t handler;
+    app_timer_mode_t            mode;
+    void                      * p_context;
+    uint64_t                    period_us;
+    uint64_t                    expiry_us;
+    bool                        active;
+    void                      * p_next;                                 /**< Next timer created. */
+} app_timer_t;
+
+typedef app_timer_t * app_timer_id_t;
+
+#define APP_TIMER_DEF(timer_id)                                 \
+    static app_timer_t timer_id##_data;                         \
+    static const app_timer_id_t timer_id = &timer_id##_data
+
+ret_code_t app_timer_init(void);
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode,
+                            app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+
+#endif // APP_TIMER_H__
@@ -0,0 +1,29 @@
+/***************************************************************************************/
+/*
+ * app_util.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Only what the scanner uses.
+*/
+/***************************************************************************************/
+
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+#include <stdint.h>
+#include "nordic_common.h"
+
+#define STATIC_ASSERT(EXPR)         _Static_assert((EXPR), #EXPR)
+
+#define ARRAY_SIZE(arr)             (sizeof(arr) / sizeof((arr)[0]))
+
+enum
+{
+    UNIT_0_625_MS = 625,                                                /**< Number of microseconds in 0.625 milliseconds. */
+    UNIT_1_25_MS  = 1250,                                               /**< Number of microseconds in 1.25 milliseconds. */
+    UNIT_10_MS    = 10000                                               /**< Number of microseconds in 10 milliseconds. */
+};
+
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+
+#endif // APP_UTIL_H__
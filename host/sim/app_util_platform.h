@@ -0,0 +1,17 @@
+/***************************************************************************************/
+/*
+ * app_util_platform.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The simulated interrupts only run while the firmware sleeps, so
+ *  critical regions need no locking.
+*/
+/***************************************************************************************/
+
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#define CRITICAL_REGION_ENTER()                 {
+#define CRITICAL_REGION_EXIT()                  }
+
+#endif // APP_UTIL_PLATFORM_H__
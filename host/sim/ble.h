@@ -0,0 +1,74 @@
+/***************************************************************************************/
+/*
+ * ble.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Only the events and configurations used by the scanner.
+*/
+/***************************************************************************************/
+
+#ifndef BLE_H__
+#define BLE_H__
+
+#include <stdint.h>
+#include "ble_gap.h"
+
+#define BLE_COMMON_CFG_VS_UUID                          0x01
+#define BLE_GATTS_CFG_SERVICE_CHANGED                   0xA0
+#define BLE_GATTS_CFG_ATTR_TAB_SIZE                     0xA1
+
+#define BLE_GATTS_ATTR_TAB_SIZE_MIN                     248
+
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_gap_evt_t gap_evt;
+    } evt;
+} ble_evt_t;
+
+typedef struct
+{
+    uint8_t vs_uuid_count;
+} ble_common_cfg_vs_uuid_t;
+
+typedef union
+{
+    ble_common_cfg_vs_uuid_t vs_uuid_cfg;
+} ble_common_cfg_t;
+
+typedef struct
+{
+    uint8_t service_changed : 1;
+} ble_gatts_cfg_service_changed_t;
+
+typedef struct
+{
+    uint32_t attr_tab_size;
+} ble_gatts_cfg_attr_tab_size_t;
+
+typedef union
+{
+    ble_gatts_cfg_service_changed_t service_changed;
+    ble_gatts_cfg_attr_tab_size_t   attr_tab_size;
+} ble_gatts_cfg_t;
+
+typedef union
+{
+    ble_common_cfg_t common_cfg;
+    ble_gap_cfg_t    gap_cfg;
+    ble_gatts_cfg_t  gatts_cfg;
+} ble_cfg_t;
+
+
+/**@brief Accepts any configuration, there is no RAM to reserve. */
+uint32_t sd_ble_cfg_set(uint32_t cfg_id, ble_cfg_t const * p_cfg, uint32_t app_ram_base);
+
+#endif // BLE_H__
@@ -0,0 +1,151 @@
+/***************************************************************************************/
+/*
+ * ble_gap.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The types and values follow the S140 6.1 API, limited to scanning.
+*/
+/***************************************************************************************/
+
+#ifndef BLE_GAP_H__
+#define BLE_GAP_H__
+
+#include <stdint.h>
+
+#define BLE_GAP_EVT_BASE                                0x10
+#define BLE_GAP_EVT_TIMEOUT                             (BLE_GAP_EVT_BASE + 11)
+#define BLE_GAP_EVT_ADV_REPORT                          (BLE_GAP_EVT_BASE + 13)
+
+#define BLE_GAP_TIMEOUT_SRC_SCAN                        0x01
+#define BLE_GAP_TIMEOUT_SRC_CONN                        0x02
+
+#define BLE_GAP_ADDR_LEN                                6
+#define BLE_GAP_ADDR_TYPE_PUBLIC                        0x00
+#define BLE_GAP_ADDR_TYPE_RANDOM_STATIC                 0x01
+
+#define BLE_GAP_PHY_AUTO                                0x00
+#define BLE_GAP_PHY_1MBPS                               0x01
+#define BLE_GAP_PHY_2MBPS                               0x02
+#define BLE_GAP_PHY_CODED                               0x04
+#define BLE_GAP_PHY_NOT_SET                             0xFF
+
+#define BLE_GAP_ADV_DATA_STATUS_COMPLETE                0x00
+#define BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_MORE_DATA    0x01
+#define BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_TRUNCATED    0x02
+#define BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_MISSING      0x03
+
+#define BLE_GAP_ADV_SET_DATA_SIZE_MAX                   31
+#define BLE_GAP_ADV_REPORT_SET_ID_NOT_AVAILABLE         0xFF
+#define BLE_GAP_POWER_LEVEL_INVALID                     127
+#define BLE_GAP_ADV_SET_COUNT_DEFAULT                   1
+
+#define BLE_GAP_SCAN_BUFFER_MIN                         31
+#define BLE_GAP_SCAN_BUFFER_MAX                         31
+#define BLE_GAP_SCAN_BUFFER_EXTENDED_MIN                255
+#define BLE_GAP_SCAN_BUFFER_EXTENDED_MAX                1650
+
+#define BLE_GAP_SCAN_INTERVAL_MIN                       0x0004
+#define BLE_GAP_SCAN_INTERVAL_MAX                       0xFFFF
+#define BLE_GAP_SCAN_WINDOW_MIN                         0x0004
+#define BLE_GAP_SCAN_WINDOW_MAX                         0xFFFF
+
+#define BLE_GAP_SCAN_FP_ACCEPT_ALL                      0x00
+
+#define BLE_GAP_CFG_ROLE_COUNT                          0x40
+
+typedef struct
+{
+    uint8_t  addr_id_peer : 1;
+    uint8_t  addr_type    : 7;
+    uint8_t  addr[BLE_GAP_ADDR_LEN];
+} ble_gap_addr_t;
+
+typedef struct
+{
+    uint8_t  * p_data;
+    uint16_t   len;
+} ble_data_t;
+
+typedef struct
+{
+    uint16_t connectable   : 1;
+    uint16_t scannable     : 1;
+    uint16_t directed      : 1;
+    uint16_t scan_response : 1;
+    uint16_t extended_pdu  : 1;
+    uint16_t status        : 2;
+    uint16_t reserved      : 9;
+} ble_gap_adv_report_type_t;
+
+typedef struct
+{
+    uint16_t aux_offset;
+    uint8_t  aux_phy;
+} ble_gap_aux_pointer_t;
+
+typedef struct
+{
+    ble_gap_adv_report_type_t type;
+    ble_gap_addr_t            peer_addr;
+    ble_gap_addr_t            direct_addr;
+    uint8_t                   primary_phy;
+    uint8_t                   secondary_phy;
+    int8_t                    tx_power;
+    int8_t                    rssi;
+    uint8_t                   ch_index;
+    uint8_t                   set_id;
+    uint16_t                  data_id : 12;
+    ble_data_t                data;
+    ble_gap_aux_pointer_t     aux_pointer;
+} ble_gap_evt_adv_report_t;
+
+typedef struct
+{
+    uint8_t src;
+} ble_gap_evt_timeout_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_timeout_t    timeout;
+        ble_gap_evt_adv_report_t adv_report;
+    } params;
+} ble_gap_evt_t;
+
+typedef struct
+{
+    uint8_t  extended               : 1;
+    uint8_t  report_incomplete_evts : 1;
+    uint8_t  active                 : 1;
+    uint8_t  filter_policy          : 2;
+    uint8_t  scan_phys;
+    uint16_t interval;
+    uint16_t window;
+    uint16_t timeout;
+    uint8_t  channel_mask[5];
+} ble_gap_scan_params_t;
+
+typedef struct
+{
+    uint8_t adv_set_count;
+    uint8_t periph_role_count;
+    uint8_t central_role_count;
+    uint8_t central_sec_count;
+    uint8_t qos_channel_survey_role_available : 1;
+} ble_gap_cfg_role_count_t;
+
+typedef union
+{
+    ble_gap_cfg_role_count_t role_count_cfg;
+} ble_gap_cfg_t;
+
+
+/**@brief Starts scanning, or resumes it after an advertising report if @p p_scan_params is NULL. */
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * p_scan_params, ble_data_t const * p_adv_report_buffer);
+
+/**@brief Stops scanning. */
+uint32_t sd_ble_gap_scan_stop(void);
+
+#endif // BLE_GAP_H__
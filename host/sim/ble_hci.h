@@ -0,0 +1,15 @@
+/***************************************************************************************/
+/*
+ * ble_hci.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Nothing of it is used by the scanner.
+*/
+/***************************************************************************************/
+
+#ifndef BLE_HCI_H_
+#define BLE_HCI_H_
+
+#include "ble.h"
+
+#endif // BLE_HCI_H_
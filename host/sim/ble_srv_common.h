@@ -0,0 +1,15 @@
+/***************************************************************************************/
+/*
+ * ble_srv_common.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Nothing of it is used by the scanner.
+*/
+/***************************************************************************************/
+
+#ifndef BLE_SRV_COMMON_H_
+#define BLE_SRV_COMMON_H_
+
+#include "ble.h"
+
+#endif // BLE_SRV_COMMON_H_
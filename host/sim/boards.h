@@ -0,0 +1,18 @@
+/***************************************************************************************/
+/*
+ * boards.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. UART pins of the PCA10056.
+*/
+/***************************************************************************************/
+
+#ifndef BOARDS_H__
+#define BOARDS_H__
+
+#define RX_PIN_NUMBER               8
+#define TX_PIN_NUMBER               6
+#define CTS_PIN_NUMBER              7
+#define RTS_PIN_NUMBER              5
+
+#endif // BOARDS_H__
@@ -0,0 +1,17 @@
+/***************************************************************************************/
+/*
+ * crc16.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Implemented by the simulator.
+*/
+/***************************************************************************************/
+
+#ifndef CRC16_H__
+#define CRC16_H__
+
+#include <stdint.h>
+
+uint16_t crc16_compute(uint8_t const * p_data, uint32_t size, uint16_t const * p_crc);
+
+#endif // CRC16_H__
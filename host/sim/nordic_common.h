@@ -0,0 +1,25 @@
+/***************************************************************************************/
+/*
+ * nordic_common.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Only what the scanner uses.
+*/
+/***************************************************************************************/
+
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+
+#define MIN(a, b)                   ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                   ((a) < (b) ? (b) : (a))
+
+#define STRINGIFY_(val)             #val
+#define STRINGIFY(val)              STRINGIFY_(val)
+
+#define IS_POWER_OF_TWO(A)          (((A) != 0) && ((((A) - 1) & (A)) == 0))
+
+#define UNUSED_VARIABLE(X)          ((void)(X))
+#define UNUSED_PARAMETER(X)         UNUSED_VARIABLE(X)
+#define UNUSED_RETURN_VALUE(X)      UNUSED_VARIABLE(X)
+
+#endif // NORDIC_COMMON_H__
@@ -0,0 +1,20 @@
+/***************************************************************************************/
+/*
+ * nrf.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Only the barrier used by the report ring and the core clock, which is
+ *  the frequency of the host cycle counter.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_H__
+#define NRF_H__
+
+#include <stdint.h>
+
+#define __DMB()                     __sync_synchronize()
+
+extern uint32_t SystemCoreClock;
+
+#endif // NRF_H__
@@ -0,0 +1,37 @@
+/***************************************************************************************/
+/*
+ * nrf_log.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Log entries go to the deferred log buffer of the simulator, which
+ *  formats them like the serial backends do and sends them through the UART backend
+ *  if NRF_LOG_BACKEND_UART_ENABLED is set.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_LOG_H__
+#define NRF_LOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdk_common.h"
+
+#define NRF_LOG_SEVERITY_ERROR                  1
+#define NRF_LOG_SEVERITY_WARNING                2
+#define NRF_LOG_SEVERITY_INFO                   3
+#define NRF_LOG_SEVERITY_DEBUG                  4
+#define NRF_LOG_SEVERITY_INFO_RAW               5                       /**< Raw entry, without prefix. */
+
+#define NRF_LOG_SEVERITY_ACTIVE(severity)       (NRF_LOG_ENABLED && ((severity) <= NRF_LOG_DEFAULT_LEVEL))
+
+#define NRF_LOG_ERROR(...)                      sim_log_printf(NRF_LOG_SEVERITY_ERROR, __VA_ARGS__)
+#define NRF_LOG_WARNING(...)                    sim_log_printf(NRF_LOG_SEVERITY_WARNING, __VA_ARGS__)
+#define NRF_LOG_INFO(...)                       sim_log_printf(NRF_LOG_SEVERITY_INFO, __VA_ARGS__)
+#define NRF_LOG_DEBUG(...)                      sim_log_printf(NRF_LOG_SEVERITY_DEBUG, __VA_ARGS__)
+#define NRF_LOG_RAW_INFO(...)                   sim_log_printf(NRF_LOG_SEVERITY_INFO_RAW, __VA_ARGS__)
+#define NRF_LOG_RAW_HEXDUMP_INFO(p_data, len)   sim_log_hexdump(NRF_LOG_SEVERITY_INFO_RAW, (p_data), (len))
+
+void sim_log_printf(uint8_t severity, char const * p_fmt, ...);
+void sim_log_hexdump(uint8_t severity, void const * p_data, size_t len);
+
+#endif // NRF_LOG_H__
@@ -0,0 +1,22 @@
+/***************************************************************************************/
+/*
+ * nrf_log_ctrl.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Processing an entry through the UART backend waits for its transfer,
+ *  interrupts keep running meanwhile.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_LOG_CTRL_H__
+#define NRF_LOG_CTRL_H__
+
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+#define NRF_LOG_INIT(timestamp_func)            ((void)(timestamp_func), NRF_SUCCESS)
+#define NRF_LOG_PROCESS()                       sim_log_process()
+
+bool sim_log_process(void);
+
+#endif // NRF_LOG_CTRL_H__
@@ -0,0 +1,15 @@
+/***************************************************************************************/
+/*
+ * nrf_log_default_backends.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Logging is compiled out.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_LOG_DEFAULT_BACKENDS_H__
+#define NRF_LOG_DEFAULT_BACKENDS_H__
+
+#define NRF_LOG_DEFAULT_BACKENDS_INIT()         ((void)0)
+
+#endif // NRF_LOG_DEFAULT_BACKENDS_H__
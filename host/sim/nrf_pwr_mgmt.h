@@ -0,0 +1,18 @@
+/***************************************************************************************/
+/*
+ * nrf_pwr_mgmt.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Sleeping moves the simulated time to the next event.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_PWR_MGMT_H__
+#define NRF_PWR_MGMT_H__
+
+#include "sdk_errors.h"
+
+ret_code_t nrf_pwr_mgmt_init(void);
+void nrf_pwr_mgmt_run(void);
+
+#endif // NRF_PWR_MGMT_H__
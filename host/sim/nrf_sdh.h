@@ -0,0 +1,17 @@
+/***************************************************************************************/
+/*
+ * nrf_sdh.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The SoftDevice is always there.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_SDH_H__
+#define NRF_SDH_H__
+
+#include "sdk_common.h"
+
+ret_code_t nrf_sdh_enable_request(void);
+
+#endif // NRF_SDH_H__
@@ -0,0 +1,28 @@
+/***************************************************************************************/
+/*
+ * nrf_sdh_ble.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The observers are registered when the macro runs, so it can only be used inside a function.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_SDH_BLE_H__
+#define NRF_SDH_BLE_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "sdk_errors.h"
+
+typedef void (*nrf_sdh_ble_evt_handler_t)(ble_evt_t const * p_ble_evt, void * p_context);
+
+#define NRF_SDH_BLE_OBSERVER(_name, _prio, _handler, _context)  \
+    nrf_sdh_ble_observer_register((_prio), (_handler), (_context))
+
+/**@brief Adds an observer. They are called by increasing priority, in registration order. */
+void nrf_sdh_ble_observer_register(uint8_t prio, nrf_sdh_ble_evt_handler_t handler, void * p_context);
+
+ret_code_t nrf_sdh_ble_app_ram_start_get(uint32_t * p_app_ram_start);
+ret_code_t nrf_sdh_ble_enable(uint32_t * p_app_ram_start);
+
+#endif // NRF_SDH_BLE_H__
@@ -0,0 +1,15 @@
+/***************************************************************************************/
+/*
+ * nrf_sdm.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Nothing of it is used by the scanner.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_SDM_H_
+#define NRF_SDM_H_
+
+#include "ble.h"
+
+#endif // NRF_SDM_H_
@@ -0,0 +1,115 @@
+/***************************************************************************************/
+/*
+ * nrfx_uarte.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. The transfers take the time the bytes need on the line at the configured baud rate.
+*/
+/***************************************************************************************/
+
+#ifndef NRFX_UARTE_H__
+#define NRFX_UARTE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+typedef ret_code_t nrfx_err_t;
+
+#define NRFX_SUCCESS                    NRF_SUCCESS
+
+#define NRF_UARTE_PSEL_DISCONNECTED     0xFFFFFFFF
+
+typedef enum
+{
+    NRF_UARTE_BAUDRATE_115200  = 0x01D7E000,
+    NRF_UARTE_BAUDRATE_230400  = 0x03AFB000,
+    NRF_UARTE_BAUDRATE_460800  = 0x075F7000,
+    NRF_UARTE_BAUDRATE_921600  = 0x0EBED000,
+    NRF_UARTE_BAUDRATE_1000000 = 0x10000000,
+} nrf_uarte_baudrate_t;
+
+typedef enum
+{
+    NRF_UARTE_HWFC_DISABLED = 0,
+    NRF_UARTE_HWFC_ENABLED  = 1,
+} nrf_uarte_hwfc_t;
+
+typedef enum
+{
+    NRF_UARTE_PARITY_EXCLUDED = 0,
+    NRF_UARTE_PARITY_INCLUDED = 0x0E,
+} nrf_uarte_parity_t;
+
+typedef struct
+{
+    uint8_t drv_inst_idx;
+} nrfx_uarte_t;
+
+#define NRFX_UARTE_INSTANCE(id)         { .drv_inst_idx = (id) }
+
+typedef enum
+{
+    NRFX_UARTE_EVT_TX_DONE,
+    NRFX_UARTE_EVT_RX_DONE,
+    NRFX_UARTE_EVT_ERROR,
+} nrfx_uarte_evt_type_t;
+
+typedef struct
+{
+    uint8_t * p_data;
+    size_t    bytes;
+} nrfx_uarte_xfer_evt_t;
+
+typedef struct
+{
+    nrfx_uarte_xfer_evt_t rxtx;
+    uint32_t              error_mask;
+} nrfx_uarte_error_evt_t;
+
+typedef struct
+{
+    nrfx_uarte_evt_type_t type;
+    union
+    {
+        nrfx_uarte_xfer_evt_t  rxtx;
+        nrfx_uarte_error_evt_t error;
+    } data;
+} nrfx_uarte_event_t;
+
+typedef void (*nrfx_uarte_event_handler_t)(nrfx_uarte_event_t const * p_event, void * p_context);
+
+typedef struct
+{
+    uint32_t             pseltxd;
+    uint32_t             pselrxd;
+    uint32_t             pselcts;
+    uint32_t             pselrts;
+    void               * p_context;
+    nrf_uarte_hwfc_t     hwfc;
+    nrf_uarte_parity_t   parity;
+    nrf_uarte_baudrate_t baudrate;
+    uint8_t              interrupt_priority;
+} nrfx_uarte_config_t;
+
+#define NRFX_UARTE_DEFAULT_CONFIG                                           \
+{                                                                           \
+    .pseltxd            = NRF_UARTE_PSEL_DISCONNECTED,                      \
+    .pselrxd            = NRF_UARTE_PSEL_DISCONNECTED,                      \
+    .pselcts            = NRF_UARTE_PSEL_DISCONNECTED,                      \
+    .pselrts            = NRF_UARTE_PSEL_DISCONNECTED,                      \
+    .p_context          = NULL,                                             \
+    .hwfc               = NRF_UARTE_HWFC_DISABLED,                          \
+    .parity             = NRF_UARTE_PARITY_EXCLUDED,                        \
+    .baudrate           = NRF_UARTE_BAUDRATE_115200,                        \
+    .interrupt_priority = 6,                                                \
+}
+
+nrfx_err_t nrfx_uarte_init(nrfx_uarte_t const * p_instance, nrfx_uarte_config_t const * p_config,
+                           nrfx_uarte_event_handler_t event_handler);
+void nrfx_uarte_uninit(nrfx_uarte_t const * p_instance);
+nrfx_err_t nrfx_uarte_tx(nrfx_uarte_t const * p_instance, uint8_t const * p_data, size_t length);
+nrfx_err_t nrfx_uarte_rx(nrfx_uarte_t const * p_instance, uint8_t * p_data, size_t length);
+
+#endif // NRFX_UARTE_H__
@@ -0,0 +1,32 @@
+/***************************************************************************************/
+/*
+ * sdk_common.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the SoftDevice
+ *  simulator. Pulls in the scanner configuration.
+*/
+/***************************************************************************************/
+
+#ifndef SDK_COMMON_H__
+#define SDK_COMMON_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sdk_config.h"
+#include "nordic_common.h"
+#include "app_util.h"
+#include "sdk_errors.h"
+
+#define VERIFY_SUCCESS(statement)                   \
+do                                                  \
+{                                                   \
+    ret_code_t _err_code = (statement);             \
+    if (_err_code != NRF_SUCCESS)                   \
+    {                                               \
+        return _err_code;                           \
+    }                                               \
+} while (0)
+
+#endif // SDK_COMMON_H__
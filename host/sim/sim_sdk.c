@@ -0,0 +1,1029 @@
+/***************************************************************************************/
+/*
+ * sim_sdk
+ *
+ *  SoftDevice simulator: the SoftDevice scanner, the UARTE driver, app_timer, power
+ *  management and the report time base, on simulated time.
+ *
+ *  The firmware runs in its own main loop. Every call to nrf_pwr_mgmt_run is a sleep:
+ *  the events due are handled there, in the order the interrupts would come, and the
+ *  run ends with a jump back to sim_run once the simulated time is over.
+ *
+ *  Log entries are kept in a deferred buffer of NRF_LOG_BUFSIZE bytes, with the cost
+ *  nrf_log gives them, and formatted when processed. The UART backend waits for each
+ *  transfer to end, handling the events meanwhile the way interrupts preempt it.
+ *
+ *  The cycle counter of the firmware is a hardware counter of the host: the CPU
+ *  cycles of the perf events interface if the kernel allows it, the time stamp
+ *  counter otherwise.
+*/
+/***************************************************************************************/
+
+#include <linux/perf_event.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "sim_sdk.h"
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "crc16.h"
+#include "nrf.h"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_pwr_mgmt.h"
+#include "nrf_sdh.h"
+#include "nrf_sdh_ble.h"
+#include "nrfx_uarte.h"
+#include "scan_decoder.h"
+#include "scan_time.h"
+
+#define OBSERVERS_MAX           8                                       /**< BLE observers that can be registered. */
+#define OBSERVER_PRIO_LEVELS    4                                       /**< NRF_SDH_BLE_OBSERVER_PRIO_LEVELS of the firmware. */
+#define SCAN_UNIT_US            625                                     /**< Unit of the scan interval and window. */
+#define SCAN_TIMEOUT_UNIT_US    10000                                   /**< Unit of the scan timeout. */
+#define UART_BITS_PER_BYTE      10                                      /**< Start bit, 8 data bits, stop bit. */
+#define APP_RAM_START           0x20001628                              /**< Reported as the start of the application RAM. */
+#define CYCLES_CALIBRATION_NS   20000000                                /**< Time the cycle counter is timed over to find its frequency. */
+
+#define LOG_ENTRY_HEADER_LEN    8                                       /**< Header of an entry in the nrf_log buffer. */
+#define LOG_ENTRIES_MAX         (NRF_LOG_BUFSIZE / LOG_ENTRY_HEADER_LEN)
+#define LOG_HEXDUMP_COLUMNS     8                                       /**< Bytes per line of a hexdump, as the serial backends print it. */
+#define LOG_TEXT_MAX            256                                     /**< Longest formatted string entry. */
+
+#ifndef SIM_ARENA_SIZE
+#define SIM_ARENA_SIZE          (192 * 1024)                            /**< Size of the report arena, the RAM left free in the firmware image. */
+#endif
+
+// The report arena the linker script gives to the report ring.
+uint8_t __report_arena_start__[SIM_ARENA_SIZE] __attribute__((aligned(4)));
+
+__asm__(".global __report_arena_end__\n"
+        ".set __report_arena_end__, __report_arena_start__ + " STRINGIFY(SIM_ARENA_SIZE) "\n");
+
+int scanner_main(void);                                                 /**< main() of the firmware, renamed by the build. */
+
+/**@brief A BLE observer. */
+typedef struct
+{
+    uint8_t                   prio;
+    nrf_sdh_ble_evt_handler_t handler;
+    void                    * p_context;
+} observer_t;
+
+static sim_config_t const * mp_config;
+static sim_stats_t        * mp_stats;
+static jmp_buf              m_end;                                      /**< Return point of sim_run. */
+static uint64_t             m_now_us;                                   /**< Simulated time. */
+static uint64_t             m_wake_ns;                                  /**< Host time the main loop last woke up. */
+static uint64_t             m_wake_cycles;                              /**< Host cycle counter at the same time. */
+static bool                 m_awake;                                    /**< The main loop is running. */
+
+static observer_t           m_observers[OBSERVERS_MAX];
+static uint32_t             m_observer_count;
+
+static app_timer_t        * mp_timers;                                  /**< Timers created, linked through p_next. */
+
+static sim_packet_t         m_packet;                                   /**< Next packet on the air. */
+static bool                 m_packet_valid;
+
+uint32_t                    SystemCoreClock;                            /**< Frequency of the host cycle counter. */
+
+/**@brief Host cycle counter. */
+static struct
+{
+    int                                  fd;                            /**< perf event, or -1. */
+    struct perf_event_mmap_page volatile * p_page;                      /**< Page of the event, if the counter can be read from user space. */
+} m_cycles = { .fd = -1 };
+
+/**@brief An entry of the deferred log buffer. */
+typedef struct
+{
+    uint8_t   severity;
+    bool      hexdump;
+    uint16_t  cost;                                                     /**< Bytes taken in the nrf_log buffer. */
+    size_t    len;
+    uint8_t * p_data;                                                   /**< Data of a hexdump, formatted text otherwise. */
+} log_entry_t;
+
+/**@brief Deferred log buffer. */
+static struct
+{
+    log_entry_t entries[LOG_ENTRIES_MAX];
+    uint32_t    head;                                                   /**< Oldest entry. */
+    uint32_t    count;
+    uint32_t    used;                                                   /**< Bytes taken. */
+    uint32_t    baudrate;                                               /**< Rate of the UART backend. */
+} m_log;
+
+/**@brief Scanner state. */
+static struct
+{
+    bool                  scanning;
+    bool                  paused;                                       /**< Waiting for a buffer after a report. */
+    ble_gap_scan_params_t params;
+    ble_data_t            buffer;                                       /**< Buffer lent for the next report. */
+    uint64_t              start_us;                                     /**< Start of the first scan interval. */
+    uint64_t              timeout_us;                                   /**< Time scanning stops, 0 if it does not. */
+} m_scan;
+
+/**@brief UARTE state. */
+static struct
+{
+    nrfx_uarte_event_handler_t handler;
+    uint32_t                   baudrate;
+    bool                       busy;
+    uint8_t const            * p_data;                                  /**< Buffer being sent. */
+    size_t                     len;
+    uint64_t                   time_us;                                 /**< Duration of the transfer. */
+    uint64_t                   done_us;                                 /**< End of the transfer. */
+} m_uarte;
+
+/**@brief Baud rate register values. */
+static const struct
+{
+    nrf_uarte_baudrate_t reg;
+    uint32_t             bps;
+} m_baudrates[] =
+{
+    { NRF_UARTE_BAUDRATE_115200,   115200 },
+    { NRF_UARTE_BAUDRATE_230400,   230400 },
+    { NRF_UARTE_BAUDRATE_460800,   460800 },
+    { NRF_UARTE_BAUDRATE_921600,   921600 },
+    { NRF_UARTE_BAUDRATE_1000000, 1000000 },
+};
+
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+/**@brief Function for opening the CPU cycles counter of the perf events interface. */
+static void cycles_init(void)
+{
+    struct perf_event_attr attr;
+    uint64_t               start_ns;
+    uint64_t               start;
+    uint64_t               ns;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    m_cycles.fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (m_cycles.fd >= 0)
+    {
+        void * p_page = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, m_cycles.fd, 0);
+
+        if (p_page != MAP_FAILED)
+        {
+            m_cycles.p_page = p_page;
+        }
+    }
+
+    // The frequency is only used to convert cycles to time.
+    start_ns = host_ns();
+    start    = sim_cycles_get();
+    do
+    {
+        ns = host_ns() - start_ns;
+    } while (ns < CYCLES_CALIBRATION_NS);
+    SystemCoreClock = (uint32_t)MIN((sim_cycles_get() - start) * 1000000000ull / ns, UINT32_MAX);
+}
+
+
+/**@brief Function for reading the counter mapped by the perf event, if possible. */
+static bool cycles_rdpmc(uint64_t * p_count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    struct perf_event_mmap_page volatile * p_page = m_cycles.p_page;
+    uint32_t                               seq;
+    uint32_t                               index;
+    uint64_t                               count;
+
+    if ((p_page == NULL) || !p_page->cap_user_rdpmc)
+    {
+        return false;
+    }
+
+    // The kernel updates the page when the counter is scheduled: retry if it did
+    // while it was read.
+    do
+    {
+        seq = p_page->lock;
+        __sync_synchronize();
+        index = p_page->index;
+        count = (uint64_t)p_page->offset;
+        if (index != 0)
+        {
+            uint16_t width = p_page->pmc_width;
+            int64_t  pmc   = (int64_t)((uint64_t)__rdpmc((int)index - 1) << (64 - width)) >> (64 - width);
+
+            count += (uint64_t)pmc;
+        }
+        __sync_synchronize();
+    } while (p_page->lock != seq);
+
+    *p_count = count;
+    return (index != 0);
+#else
+    return false;
+#endif
+}
+
+
+uint64_t sim_cycles_get(void)
+{
+    uint64_t count;
+
+    if (cycles_rdpmc(&count))
+    {
+        return count;
+    }
+    if ((m_cycles.fd >= 0) && (read(m_cycles.fd, &count, sizeof(count)) == sizeof(count)))
+    {
+        return count;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return host_ns();
+#endif
+}
+
+
+char const * sim_cycles_source(void)
+{
+    if (m_cycles.fd >= 0)
+    {
+        return "perf";
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    return "tsc";
+#else
+    return "ns";
+#endif
+}
+
+
+static void latency_add(uint64_t ns)
+{
+    if (mp_stats->latency_count == mp_stats->latency_size)
+    {
+        size_t     size = (mp_stats->latency_size == 0) ? 4096 : mp_stats->latency_size * 2;
+        uint32_t * p    = realloc(mp_stats->p_latency_ns, size * sizeof(uint32_t));
+
+        if (p == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        mp_stats->p_latency_ns = p;
+        mp_stats->latency_size = size;
+    }
+
+    mp_stats->p_latency_ns[mp_stats->latency_count++] = (uint32_t)MIN(ns, UINT32_MAX);
+}
+
+
+/**@brief Function for calling the BLE observers, by priority, and timing them. */
+static uint64_t ble_evt_dispatch(ble_evt_t const * p_ble_evt)
+{
+    uint64_t start = host_ns();
+
+    for (uint8_t prio = 0; prio < OBSERVER_PRIO_LEVELS; prio++)
+    {
+        for (uint32_t i = 0; i < m_observer_count; i++)
+        {
+            if (m_observers[i].prio == prio)
+            {
+                m_observers[i].handler(p_ble_evt, m_observers[i].p_context);
+            }
+        }
+    }
+
+    return host_ns() - start;
+}
+
+
+/**@brief Function for checking whether the radio listens to a packet. */
+static bool packet_is_scanned(sim_packet_t const * p_packet)
+{
+    uint64_t interval_us = (uint64_t)m_scan.params.interval * SCAN_UNIT_US;
+    uint64_t window_us   = (uint64_t)m_scan.params.window * SCAN_UNIT_US;
+
+    if (!m_scan.scanning || ((m_scan.params.scan_phys & p_packet->report.primary_phy) == 0))
+    {
+        return false;
+    }
+
+    return (interval_us == 0) || ((p_packet->time_us - m_scan.start_us) % interval_us < window_us);
+}
+
+
+/**@brief Function for receiving a packet, in as many reports as the lent buffers need. */
+static void packet_receive(sim_packet_t const * p_packet)
+{
+    uint8_t const * p_data    = p_packet->report.data.p_data;
+    uint16_t        remaining = p_packet->report.data.len;
+    uint64_t        cycles;
+    ble_evt_t       evt;
+
+    mp_stats->packets++;
+
+    if (!packet_is_scanned(p_packet))
+    {
+        mp_stats->not_scanned++;
+        return;
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id  = BLE_GAP_EVT_ADV_REPORT;
+    evt.header.evt_len = sizeof(evt);
+
+    do
+    {
+        ble_gap_evt_adv_report_t * p_report = &evt.evt.gap_evt.params.adv_report;
+        uint16_t                   len;
+
+        if (m_scan.paused || !m_scan.scanning)
+        {
+            mp_stats->paused++;
+            return;
+        }
+
+        len = MIN(remaining, m_scan.buffer.len);
+        memcpy(m_scan.buffer.p_data, p_data, len);
+
+        *p_report             = p_packet->report;
+        p_report->data.p_data = m_scan.buffer.p_data;
+        p_report->data.len    = len;
+        p_report->type.status = (len < remaining) ? BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_MORE_DATA
+                                                  : BLE_GAP_ADV_DATA_STATUS_COMPLETE;
+        p_data    += len;
+        remaining -= len;
+
+        m_scan.paused = true;
+        mp_stats->reports++;
+        cycles = sim_cycles_get();
+        latency_add(ble_evt_dispatch(&evt));
+        mp_stats->handler_cycles += sim_cycles_get() - cycles;
+    } while (remaining > 0);
+}
+
+
+/**@brief Function for stopping scanning at the end of its timeout. */
+static void scan_timeout(void)
+{
+    ble_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                   = BLE_GAP_EVT_TIMEOUT;
+    evt.header.evt_len                  = sizeof(evt);
+    evt.evt.gap_evt.params.timeout.src  = BLE_GAP_TIMEOUT_SRC_SCAN;
+
+    m_scan.scanning = false;
+    (void)ble_evt_dispatch(&evt);
+}
+
+
+/**@brief Function for ending the transfer in progress. */
+static void uarte_tx_done(void)
+{
+    nrfx_uarte_event_t evt;
+
+    m_uarte.busy          = false;
+    mp_stats->tx_bytes   += m_uarte.len;
+    mp_stats->tx_busy_us += m_uarte.time_us;
+    if (mp_config->sink != NULL)
+    {
+        mp_config->sink(m_uarte.p_data, m_uarte.len, mp_config->p_context);
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.type              = NRFX_UARTE_EVT_TX_DONE;
+    evt.data.rxtx.p_data  = (uint8_t *)m_uarte.p_data;
+    evt.data.rxtx.bytes   = m_uarte.len;
+    m_uarte.handler(&evt, NULL);
+}
+
+
+/**@brief Function for getting the next event time, at the latest the end of the run. */
+static uint64_t next_event_get(void)
+{
+    uint64_t next = mp_config->duration_us;
+
+    if (!m_packet_valid)
+    {
+        m_packet_valid = mp_config->source(&m_packet, mp_config->p_context);
+    }
+    if (m_packet_valid)
+    {
+        next = MIN(next, m_packet.time_us);
+    }
+    if (m_uarte.busy)
+    {
+        next = MIN(next, m_uarte.done_us);
+    }
+    if (m_scan.scanning && (m_scan.timeout_us != 0))
+    {
+        next = MIN(next, m_scan.timeout_us);
+    }
+    for (app_timer_t * p_timer = mp_timers; p_timer != NULL; p_timer = p_timer->p_next)
+    {
+        if (p_timer->active)
+        {
+            next = MIN(next, p_timer->expiry_us);
+        }
+    }
+
+    return MAX(next, m_now_us);
+}
+
+
+/**@brief Function for handling the events due at the current time. */
+static void events_handle(void)
+{
+    if (m_uarte.busy && (m_uarte.done_us <= m_now_us))
+    {
+        uarte_tx_done();
+    }
+
+    for (app_timer_t * p_timer = mp_timers; p_timer != NULL; p_timer = p_timer->p_next)
+    {
+        if (p_timer->active && (p_timer->expiry_us <= m_now_us))
+        {
+            p_timer->active = (p_timer->mode == APP_TIMER_MODE_REPEATED);
+            p_timer->expiry_us += p_timer->period_us;
+            p_timer->handler(p_timer->p_context);
+        }
+    }
+
+    if (m_scan.scanning && (m_scan.timeout_us != 0) && (m_scan.timeout_us <= m_now_us))
+    {
+        scan_timeout();
+    }
+
+    while (m_packet_valid && (m_packet.time_us <= m_now_us))
+    {
+        packet_receive(&m_packet);
+        m_packet_valid = mp_config->source(&m_packet, mp_config->p_context);
+    }
+}
+
+
+/**@brief Function for moving to the next event, ending the run when there is none left. */
+static void next_event_wait(uint64_t until_us)
+{
+    m_now_us = MIN(next_event_get(), until_us);
+    if (m_now_us >= mp_config->duration_us)
+    {
+        longjmp(m_end, 1);
+    }
+}
+
+
+/**@brief Function for waiting in the main loop, with the interrupts running.
+ *
+ * @details The host time the interrupts take is left out of the main loop time.
+ */
+static void busy_wait(uint64_t until_us)
+{
+    while (m_now_us < until_us)
+    {
+        uint64_t start_ns;
+        uint64_t start_cycles;
+
+        next_event_wait(until_us);
+
+        start_ns     = host_ns();
+        start_cycles = sim_cycles_get();
+        events_handle();
+        m_wake_cycles += sim_cycles_get() - start_cycles;
+        m_wake_ns     += host_ns() - start_ns;
+    }
+}
+
+
+void nrf_pwr_mgmt_run(void)
+{
+    uint64_t now_ns = host_ns();
+
+    mp_stats->loop_ns     += now_ns - m_wake_ns;
+    mp_stats->loop_cycles += sim_cycles_get() - m_wake_cycles;
+    m_awake                = false;
+
+    next_event_wait(UINT64_MAX);
+    events_handle();
+
+    mp_stats->wakeups++;
+    m_wake_ns     = host_ns();
+    m_wake_cycles = sim_cycles_get();
+    m_awake       = true;
+}
+
+
+ret_code_t nrf_pwr_mgmt_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for dropping the oldest log entry. */
+static void log_entry_free(void)
+{
+    log_entry_t * p_entry = &m_log.entries[m_log.head];
+
+    free(p_entry->p_data);
+    m_log.used -= p_entry->cost;
+    m_log.head  = (m_log.head + 1) % LOG_ENTRIES_MAX;
+    m_log.count--;
+}
+
+
+/**@brief Function for adding an entry to the deferred log buffer.
+ *
+ * @details Takes ownership of @p p_data. The oldest entries make room if
+ *          NRF_LOG_ALLOW_OVERFLOW is set, the new one is dropped otherwise.
+ */
+static void log_entry_add(uint8_t severity, bool hexdump, uint16_t cost, uint8_t * p_data, size_t len)
+{
+    log_entry_t * p_entry;
+
+    if ((p_data == NULL) || (cost > NRF_LOG_BUFSIZE))
+    {
+        free(p_data);
+        mp_stats->log_dropped++;
+        return;
+    }
+
+    while ((m_log.count == LOG_ENTRIES_MAX) || (m_log.used + cost > NRF_LOG_BUFSIZE))
+    {
+        if (!NRF_LOG_ALLOW_OVERFLOW)
+        {
+            free(p_data);
+            mp_stats->log_dropped++;
+            return;
+        }
+        log_entry_free();
+        mp_stats->log_dropped++;
+    }
+
+    p_entry           = &m_log.entries[(m_log.head + m_log.count) % LOG_ENTRIES_MAX];
+    p_entry->severity = severity;
+    p_entry->hexdump  = hexdump;
+    p_entry->cost     = cost;
+    p_entry->p_data   = p_data;
+    p_entry->len      = len;
+    m_log.used       += cost;
+    m_log.count++;
+}
+
+
+static bool log_severity_active(uint8_t severity)
+{
+    return NRF_LOG_SEVERITY_ACTIVE((severity == NRF_LOG_SEVERITY_INFO_RAW) ? NRF_LOG_SEVERITY_INFO : severity);
+}
+
+
+void sim_log_printf(uint8_t severity, char const * p_fmt, ...)
+{
+    static char const * const prefixes[] = { "", "<error> app: ", "<warning> app: ", "<info> app: ", "<debug> app: ", "" };
+    char                      text[LOG_TEXT_MAX];
+    char const              * p_suffix = (severity == NRF_LOG_SEVERITY_INFO_RAW) ? "" : "\r\n";
+    uint16_t                  cost     = LOG_ENTRY_HEADER_LEN;
+    va_list                   args;
+    int                       len;
+
+    if (!log_severity_active(severity))
+    {
+        return;
+    }
+
+    // The arguments are stored as words, the string itself is not copied.
+    for (char const * p = p_fmt; *p != '\0'; p++)
+    {
+        if ((p[0] == '%') && (p[1] != '%'))
+        {
+            cost += sizeof(uint32_t);
+        }
+        else if ((p[0] == '%') && (p[1] == '%'))
+        {
+            p++;
+        }
+    }
+
+    len = snprintf(text, sizeof(text), "%s", prefixes[severity]);
+    va_start(args, p_fmt);
+    len += vsnprintf(&text[len], sizeof(text) - (size_t)len, p_fmt, args);
+    va_end(args);
+    len = MIN(len, (int)sizeof(text) - 1);
+    len += snprintf(&text[len], sizeof(text) - (size_t)len, "%s", p_suffix);
+    len = MIN(len, (int)sizeof(text) - 1);
+
+    log_entry_add(severity, false, cost, (uint8_t *)strndup(text, (size_t)len), (size_t)len);
+}
+
+
+void sim_log_hexdump(uint8_t severity, void const * p_data, size_t len)
+{
+    uint8_t * p_copy;
+
+    if (!log_severity_active(severity))
+    {
+        return;
+    }
+
+    p_copy = malloc(MAX(len, 1));
+    if (p_copy != NULL)
+    {
+        memcpy(p_copy, p_data, len);
+    }
+    log_entry_add(severity, true, (uint16_t)MIN(LOG_ENTRY_HEADER_LEN + ((len + 3) & ~(size_t)3), UINT16_MAX),
+                  p_copy, len);
+}
+
+
+/**@brief Function for formatting a hexdump the way the serial backends do.
+ *
+ * @details One line per LOG_HEXDUMP_COLUMNS bytes: the bytes in hexadecimal, padded
+ *          to the full width, then the printable ones as characters.
+ *
+ * @return Length of the text.
+ */
+static size_t log_hexdump_format(uint8_t const * p_data, size_t len, char * p_text)
+{
+    char * p = p_text;
+
+    for (size_t line = 0; line < len; line += LOG_HEXDUMP_COLUMNS)
+    {
+        size_t count = MIN(len - line, LOG_HEXDUMP_COLUMNS);
+
+        for (size_t i = 0; i < LOG_HEXDUMP_COLUMNS; i++)
+        {
+            p += (i < count) ? sprintf(p, " %02x", p_data[line + i]) : sprintf(p, "   ");
+        }
+        *p++ = '|';
+        for (size_t i = 0; i < count; i++)
+        {
+            char c = (char)p_data[line + i];
+
+            *p++ = ((c <= ' ') || (c > '~')) ? '.' : c;
+        }
+        *p++ = '\r';
+        *p++ = '\n';
+    }
+
+    return (size_t)(p - p_text);
+}
+
+
+/**@brief Function for sending text through the UART backend and waiting for the end of the transfer. */
+static void log_uart_send(uint8_t const * p_text, size_t len)
+{
+    uint64_t time_us = ((uint64_t)len * UART_BITS_PER_BYTE * 1000000 + m_log.baudrate - 1) / m_log.baudrate;
+
+    busy_wait(m_now_us + time_us);
+
+    mp_stats->tx_bytes   += len;
+    mp_stats->tx_busy_us += time_us;
+    if (mp_config->sink != NULL)
+    {
+        mp_config->sink(p_text, len, mp_config->p_context);
+    }
+}
+
+
+bool sim_log_process(void)
+{
+    log_entry_t entry;
+    char      * p_text;
+    size_t      len;
+
+    if (m_log.count == 0)
+    {
+        return false;
+    }
+
+    // The entry leaves the buffer before it is formatted, like nrf_log does.
+    entry             = m_log.entries[m_log.head];
+    m_log.entries[m_log.head].p_data = NULL;
+    log_entry_free();
+
+    if (entry.hexdump)
+    {
+        size_t lines = (entry.len + LOG_HEXDUMP_COLUMNS - 1) / LOG_HEXDUMP_COLUMNS;
+
+        // Each line takes 4 characters per column, the separator and the line end.
+        p_text = malloc(lines * (LOG_HEXDUMP_COLUMNS * 4 + 3) + 1);
+        if (p_text == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        len = log_hexdump_format(entry.p_data, entry.len, p_text);
+        free(entry.p_data);
+    }
+    else
+    {
+        p_text = (char *)entry.p_data;
+        len    = entry.len;
+    }
+
+    mp_stats->log_bytes += len;
+    if (NRF_LOG_BACKEND_UART_ENABLED)
+    {
+        log_uart_send((uint8_t const *)p_text, len);
+    }
+    free(p_text);
+
+    return true;
+}
+
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * p_scan_params, ble_data_t const * p_adv_report_buffer)
+{
+    if ((p_adv_report_buffer == NULL) || (p_adv_report_buffer->p_data == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (p_scan_params == NULL)
+    {
+        if (!m_scan.scanning || !m_scan.paused)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+        if (p_adv_report_buffer->len < (m_scan.params.extended ? BLE_GAP_SCAN_BUFFER_EXTENDED_MIN
+                                                                : BLE_GAP_SCAN_BUFFER_MIN))
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+
+        m_scan.buffer = *p_adv_report_buffer;
+        m_scan.paused = false;
+        return NRF_SUCCESS;
+    }
+
+    if (m_scan.scanning)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_scan_params->window > p_scan_params->interval) || (p_scan_params->scan_phys == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_adv_report_buffer->len < (p_scan_params->extended ? BLE_GAP_SCAN_BUFFER_EXTENDED_MIN
+                                                            : BLE_GAP_SCAN_BUFFER_MIN))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    m_scan.params     = *p_scan_params;
+    m_scan.buffer     = *p_adv_report_buffer;
+    m_scan.scanning   = true;
+    m_scan.paused     = false;
+    m_scan.start_us   = m_now_us;
+    m_scan.timeout_us = (p_scan_params->timeout != 0)
+                      ? m_now_us + (uint64_t)p_scan_params->timeout * SCAN_TIMEOUT_UNIT_US
+                      : 0;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_scan_stop(void)
+{
+    if (!m_scan.scanning)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_scan.scanning = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_cfg_set(uint32_t cfg_id, ble_cfg_t const * p_cfg, uint32_t app_ram_base)
+{
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_sdh_enable_request(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_sdh_ble_app_ram_start_get(uint32_t * p_app_ram_start)
+{
+    *p_app_ram_start = APP_RAM_START;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_sdh_ble_enable(uint32_t * p_app_ram_start)
+{
+    return NRF_SUCCESS;
+}
+
+
+void nrf_sdh_ble_observer_register(uint8_t prio, nrf_sdh_ble_evt_handler_t handler, void * p_context)
+{
+    if ((m_observer_count == OBSERVERS_MAX) || (prio >= OBSERVER_PRIO_LEVELS))
+    {
+        app_error_handler(NRF_ERROR_NO_MEM, __LINE__, (const uint8_t *)__FILE__);
+    }
+
+    m_observers[m_observer_count].prio      = prio;
+    m_observers[m_observer_count].handler   = handler;
+    m_observers[m_observer_count].p_context = p_context;
+    m_observer_count++;
+}
+
+
+nrfx_err_t nrfx_uarte_init(nrfx_uarte_t const * p_instance, nrfx_uarte_config_t const * p_config,
+                           nrfx_uarte_event_handler_t event_handler)
+{
+    m_uarte.baudrate = 0;
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_baudrates); i++)
+    {
+        if (m_baudrates[i].reg == p_config->baudrate)
+        {
+            m_uarte.baudrate = m_baudrates[i].bps;
+        }
+    }
+    if (m_uarte.baudrate == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (mp_config->baudrate != 0)
+    {
+        m_uarte.baudrate = mp_config->baudrate;
+    }
+
+    m_uarte.handler    = event_handler;
+    m_uarte.busy       = false;
+    mp_stats->baudrate = m_uarte.baudrate;
+    return NRFX_SUCCESS;
+}
+
+
+void nrfx_uarte_uninit(nrfx_uarte_t const * p_instance)
+{
+    m_uarte.handler = NULL;
+    m_uarte.busy    = false;
+}
+
+
+nrfx_err_t nrfx_uarte_tx(nrfx_uarte_t const * p_instance, uint8_t const * p_data, size_t length)
+{
+    uint64_t bits = (uint64_t)length * UART_BITS_PER_BYTE;
+    uint64_t time_us;
+
+    if (m_uarte.busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    time_us = (bits * 1000000 + m_uarte.baudrate - 1) / m_uarte.baudrate;
+
+    m_uarte.busy    = true;
+    m_uarte.p_data  = p_data;
+    m_uarte.len     = length;
+    m_uarte.time_us = time_us;
+    m_uarte.done_us = m_now_us + time_us;
+    return NRFX_SUCCESS;
+}
+
+
+nrfx_err_t nrfx_uarte_rx(nrfx_uarte_t const * p_instance, uint8_t * p_data, size_t length)
+{
+    // The host never sends anything.
+    return NRFX_SUCCESS;
+}
+
+
+ret_code_t app_timer_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode,
+                            app_timer_timeout_handler_t timeout_handler)
+{
+    app_timer_t * p_timer = *p_timer_id;
+
+    p_timer->handler = timeout_handler;
+    p_timer->mode    = mode;
+    p_timer->active  = false;
+    p_timer->p_next  = mp_timers;
+    mp_timers        = p_timer;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    timer_id->p_context = p_context;
+    timer_id->period_us = (uint64_t)timeout_ticks * 1000000 / APP_TIMER_CLOCK_FREQ;
+    timer_id->expiry_us = m_now_us + timer_id->period_us;
+    timer_id->active    = true;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    timer_id->active = false;
+    return NRF_SUCCESS;
+}
+
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "%s:%u: error 0x%x at %llu us\n",
+            (char const *)p_file_name, line_num, error_code, (unsigned long long)m_now_us);
+    exit(EXIT_FAILURE);
+}
+
+
+uint16_t crc16_compute(uint8_t const * p_data, uint32_t size, uint16_t const * p_crc)
+{
+    return scan_crc16(p_data, size, p_crc);
+}
+
+
+void scan_time_init(void)
+{
+}
+
+
+uint64_t scan_time_us_get(void)
+{
+    return m_now_us;
+}
+
+
+uint32_t scan_time_cycles_get(void)
+{
+    return (uint32_t)sim_cycles_get();
+}
+
+
+uint64_t sim_time_us(void)
+{
+    return m_now_us;
+}
+
+
+void sim_run(sim_config_t const * p_config, sim_stats_t * p_stats)
+{
+    mp_config = p_config;
+    mp_stats  = p_stats;
+    memset(p_stats, 0, sizeof(*p_stats));
+
+    cycles_init();
+
+    // NRF_LOG_BACKEND_UART_BAUDRATE is a register value, the rate is 16 MHz * value / 2^32.
+    m_log.baudrate = (p_config->baudrate != 0)
+                   ? p_config->baudrate
+                   : (uint32_t)(((uint64_t)NRF_LOG_BACKEND_UART_BAUDRATE * 16000000) >> 32);
+    if (NRF_LOG_BACKEND_UART_ENABLED)
+    {
+        p_stats->baudrate = m_log.baudrate;
+    }
+
+    if (setjmp(m_end) == 0)
+    {
+        m_wake_ns     = host_ns();
+        m_wake_cycles = sim_cycles_get();
+        m_awake       = true;
+        (void)scanner_main();
+    }
+    else if (m_awake)
+    {
+        // The run ended while the main loop waited for a log transfer.
+        p_stats->loop_ns     += host_ns() - m_wake_ns;
+        p_stats->loop_cycles += sim_cycles_get() - m_wake_cycles;
+    }
+}
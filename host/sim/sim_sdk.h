@@ -0,0 +1,117 @@
+/***************************************************************************************/
+/*
+ * sim_sdk
+ *
+ *  SoftDevice simulator. Runs the scanner firmware (main.c and the modules it drives)
+ *  on the host, against the stand-in SDK headers of this folder.
+ *
+ *  Time is simulated. It only moves forward when the firmware sleeps in
+ *  nrf_pwr_mgmt_run: the simulator then jumps to the next event (a packet on the air,
+ *  the end of a UART transfer, a timer or the scan timeout) and calls the handlers the
+ *  way the SoftDevice and the drivers would, before returning to the main loop. The
+ *  processing of the main loop takes no simulated time, so the UART is the only
+ *  bottleneck; the host time spent in the handlers and in the main loop is measured
+ *  apart.
+ *
+ *  The radio receives a packet if scanning runs, on its primary PHY and inside the
+ *  scan window. Its data is written into the buffer the firmware lent for the next
+ *  report, split over several reports if it does not fit, and the scanner pauses
+ *  until the firmware lends another buffer.
+ *
+ *  Log entries are formatted the way the serial backends of nrf_log do; with
+ *  NRF_LOG_BACKEND_UART_ENABLED they take the UART, and the main loop waits for each
+ *  transfer as the UART backend does.
+*/
+/***************************************************************************************/
+
+#ifndef SIM_SDK_H__
+#define SIM_SDK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief An advertising packet on the air. */
+typedef struct
+{
+    uint64_t                 time_us;                                   /**< Time it is received. */
+    ble_gap_evt_adv_report_t report;                                    /**< Report as the SoftDevice gives it. data holds the whole advertising data and status is ignored. */
+} sim_packet_t;
+
+/**@brief Function giving the next packet on the air, in time order.
+ *
+ * @return false if there are no more packets.
+ */
+typedef bool (*sim_packet_source_t)(sim_packet_t * p_packet, void * p_context);
+
+/**@brief Function receiving the bytes sent through the UART, once their transfer is over. */
+typedef void (*sim_uart_sink_t)(uint8_t const * p_data, size_t len, void * p_context);
+
+/**@brief Simulation settings. */
+typedef struct
+{
+    uint64_t            duration_us;                                    /**< Simulated time to run for. */
+    uint32_t            baudrate;                                       /**< UART line rate, or 0 to use the one the firmware configures. */
+    sim_packet_source_t source;
+    sim_uart_sink_t     sink;                                           /**< Can be NULL. */
+    void              * p_context;                                      /**< Passed to @ref source and @ref sink. */
+} sim_config_t;
+
+/**@brief Simulation results. */
+typedef struct
+{
+    uint64_t   packets;                                                 /**< Packets on the air. */
+    uint64_t   not_scanned;                                             /**< Packets outside the scan window or on a PHY not scanned. */
+    uint64_t   paused;                                                  /**< Packets lost, fully or in part, because the scanner was not resumed. */
+    uint64_t   reports;                                                 /**< Advertising reports given to the firmware. */
+    uint32_t   baudrate;                                                /**< UART line rate. */
+    uint64_t   tx_bytes;                                                /**< Bytes sent through the UART, transfers in progress left out. Log entries included. */
+    uint64_t   tx_busy_us;                                              /**< Time the UART line was busy. */
+    uint64_t   log_bytes;                                               /**< Text of the log entries processed, whether the UART backend is enabled or not. */
+    uint64_t   log_dropped;                                             /**< Log entries lost because the log buffer was full. */
+    uint64_t   wakeups;                                                 /**< Times the main loop woke up. */
+    uint64_t   loop_ns;                                                 /**< Host time spent in the main loop, between two sleeps. */
+    uint64_t   loop_cycles;                                             /**< The same in host cycles, see @ref sim_cycles_get. */
+    uint64_t   handler_cycles;                                          /**< Host cycles taken by the BLE observers for the reports. */
+    uint32_t * p_latency_ns;                                            /**< Host time taken by the BLE observers for each report. */
+    size_t     latency_count;
+    size_t     latency_size;
+} sim_stats_t;
+
+
+/**@brief Function for running the firmware.
+ *
+ * @details Calls the main function of the firmware and stops it once the simulated
+ *          time is over. The firmware keeps its state in static variables, so it can
+ *          only run once per process.
+ *
+ * @param[in]   p_config    Simulation settings.
+ * @param[out]  p_stats     Results. Free p_latency_ns when done.
+ */
+void sim_run(sim_config_t const * p_config, sim_stats_t * p_stats);
+
+
+/**@brief Function for getting the simulated time, in microseconds. */
+uint64_t sim_time_us(void);
+
+
+/**@brief Function for reading the host cycle counter the firmware profile is taken with.
+ *
+ * @details Its frequency is in SystemCoreClock once @ref sim_run has started.
+ */
+uint64_t sim_cycles_get(void);
+
+
+/**@brief Function for getting the name of the host cycle counter: "perf", "tsc" or "ns". */
+char const * sim_cycles_source(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_SDK_H__
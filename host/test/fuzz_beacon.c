@@ -0,0 +1,135 @@
+/***************************************************************************************/
+/*
+ * fuzz_beacon
+ *
+ *  Fuzz target of the beacon decoder, for libFuzzer or AFL. Each input is taken as
+ *  the advertising data of a report. Besides the reads past the input, which the
+ *  sanitizers catch, the target aborts when the decoder breaks its contract: a type
+ *  without a body, a body written although no beacon was found, an encoded URL
+ *  longer than the frame allows or an expansion that does not fit its buffer.
+ *
+ *  Built by `make fuzz`, with clang and libFuzzer by default:
+ *
+ *    make -C host fuzz
+ *    host/_build/fuzz/fuzz_beacon -max_len=300 corpus/
+ *
+ *  With FUZZ_MAIN defined, the target has its own main() instead, which decodes each
+ *  file given, or the standard input, for AFL or to replay a crash:
+ *
+ *    make -C host fuzz FUZZ_CC=afl-clang-fast FUZZ_FLAGS="-fsanitize=address -DFUZZ_MAIN"
+ *    afl-fuzz -i corpus -o findings -- host/_build/fuzz/fuzz_beacon @@
+ *
+ *  scan_beacon.c is included, so it is built with the flags of the target.
+*/
+/***************************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_beacon.c"
+
+#define SENTINEL        0x5A
+#define INPUT_MAX       UINT16_MAX                                      /**< Longest input of FUZZ_MAIN. */
+
+
+int LLVMFuzzerTestOneInput(uint8_t const * p_data, size_t size)
+{
+    scan_beacon_body_t body;
+    scan_beacon_body_t untouched;
+    scan_beacon_type_t type;
+    char               url[64];
+
+    if (size > UINT16_MAX)
+    {
+        return 0;
+    }
+
+    memset(&body, SENTINEL, sizeof(body));
+    memset(&untouched, SENTINEL, sizeof(untouched));
+    type = scan_beacon_decode(p_data, (uint16_t)size, &body);
+
+    if (type == SCAN_BEACON_NONE)
+    {
+        if (memcmp(&body, &untouched, sizeof(body)) != 0)
+        {
+            abort();
+        }
+        return 0;
+    }
+    if (scan_beacon_body_len(type) == 0)
+    {
+        abort();
+    }
+
+    if (type == SCAN_BEACON_EDDYSTONE_URL)
+    {
+        if (body.eddystone_url.url_len > SCAN_EDDYSTONE_URL_MAX)
+        {
+            abort();
+        }
+
+        // Into a buffer of each size, cut where it ends.
+        for (size_t len = 1; len <= sizeof(url); len++)
+        {
+            memset(url, SENTINEL, sizeof(url));
+            if ((scan_beacon_url_expand(&body.eddystone_url, url, len) >= len)
+                || ((len < sizeof(url)) && (url[len] != SENTINEL)))
+            {
+                abort();
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+#ifdef FUZZ_MAIN
+
+/**@brief Function for decoding the whole content of a file. */
+static int input_run(FILE * p_file, uint8_t * p_buf)
+{
+    size_t size = fread(p_buf, 1, INPUT_MAX, p_file);
+
+    if (ferror(p_file))
+    {
+        return -1;
+    }
+
+    // An exact copy, so a read past the input is past the allocation.
+    uint8_t * p_input = malloc(size ? size : 1);
+
+    memcpy(p_input, p_buf, size);
+    (void)LLVMFuzzerTestOneInput(p_input, size);
+    free(p_input);
+
+    return 0;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static uint8_t buf[INPUT_MAX];
+
+    if (argc < 2)
+    {
+        return (input_run(stdin, buf) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        FILE * p_file = fopen(argv[i], "rb");
+
+        if ((p_file == NULL) || (input_run(p_file, buf) != 0))
+        {
+            perror(argv[i]);
+            return EXIT_FAILURE;
+        }
+        fclose(p_file);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#endif // FUZZ_MAIN
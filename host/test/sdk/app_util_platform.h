@@ -0,0 +1,24 @@
+/***************************************************************************************/
+/*
+ * app_util_platform.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the test of
+ *  scan_time. The timer model delivers its interrupt on any register access outside
+ *  a critical region, so the critical regions mask it.
+*/
+/***************************************************************************************/
+
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#include <stdint.h>
+
+#define APP_IRQ_PRIORITY_HIGH                   2
+
+uint8_t test_critical_enter(void);
+void test_critical_exit(uint8_t nested);
+
+#define CRITICAL_REGION_ENTER()                 { uint8_t CR_NESTED = test_critical_enter();
+#define CRITICAL_REGION_EXIT()                  test_critical_exit(CR_NESTED); }
+
+#endif // APP_UTIL_PLATFORM_H__
@@ -0,0 +1,52 @@
+/***************************************************************************************/
+/*
+ * nrf.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the test of
+ *  scan_time. TIMER1 is a model run by the test: it only has to be told apart from
+ *  the other timers, and the NVIC and the debug registers are the ones of the model.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_H__
+#define NRF_H__
+
+#include <stdint.h>
+
+typedef enum
+{
+    TIMER1_IRQn = 9,
+} IRQn_Type;
+
+typedef struct
+{
+    uint32_t id;
+} NRF_TIMER_Type;
+
+typedef struct
+{
+    uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+    uint32_t CTRL;
+    uint32_t CYCCNT;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+extern NRF_TIMER_Type   test_timer1;
+extern CoreDebug_Type   test_core_debug;
+extern DWT_Type         test_dwt;
+
+#define NRF_TIMER1                  (&test_timer1)
+#define CoreDebug                   (&test_core_debug)
+#define DWT                         (&test_dwt)
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irqn);
+
+#endif // NRF_H__
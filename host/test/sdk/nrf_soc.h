@@ -0,0 +1,17 @@
+/***************************************************************************************/
+/*
+ * nrf_soc.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the test of
+ *  scan_time.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+
+#include <stdint.h>
+
+uint32_t sd_clock_hfclk_request(void);
+
+#endif // NRF_SOC_H__
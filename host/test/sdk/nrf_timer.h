@@ -0,0 +1,83 @@
+/***************************************************************************************/
+/*
+ * nrf_timer.h
+ *
+ *  Host stand-in for the nRF5 SDK header of the same name, for the test of
+ *  scan_time. The functions are those of the TIMER model of the test, with the
+ *  names and the values of the SDK.
+*/
+/***************************************************************************************/
+
+#ifndef NRF_TIMER_H__
+#define NRF_TIMER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nrf.h"
+
+#define NRF_TIMER_CC_CHANNEL_COUNT  6
+
+typedef enum
+{
+    NRF_TIMER_TASK_START    = 0x000,
+    NRF_TIMER_TASK_STOP     = 0x004,
+    NRF_TIMER_TASK_COUNT    = 0x008,
+    NRF_TIMER_TASK_CLEAR    = 0x00C,
+    NRF_TIMER_TASK_SHUTDOWN = 0x010,
+    NRF_TIMER_TASK_CAPTURE0 = 0x040,
+} nrf_timer_task_t;
+
+typedef enum
+{
+    NRF_TIMER_EVENT_COMPARE0 = 0x140,
+    NRF_TIMER_EVENT_COMPARE1 = 0x144,
+} nrf_timer_event_t;
+
+typedef enum
+{
+    NRF_TIMER_CC_CHANNEL0 = 0,
+    NRF_TIMER_CC_CHANNEL1,
+    NRF_TIMER_CC_CHANNEL2,
+    NRF_TIMER_CC_CHANNEL3,
+    NRF_TIMER_CC_CHANNEL4,
+    NRF_TIMER_CC_CHANNEL5,
+} nrf_timer_cc_channel_t;
+
+typedef enum
+{
+    NRF_TIMER_MODE_TIMER = 0,
+    NRF_TIMER_MODE_COUNTER,
+} nrf_timer_mode_t;
+
+typedef enum
+{
+    NRF_TIMER_BIT_WIDTH_16 = 0,
+    NRF_TIMER_BIT_WIDTH_8,
+    NRF_TIMER_BIT_WIDTH_24,
+    NRF_TIMER_BIT_WIDTH_32,
+} nrf_timer_bit_width_t;
+
+typedef enum
+{
+    NRF_TIMER_FREQ_16MHz = 0,
+    NRF_TIMER_FREQ_8MHz,
+    NRF_TIMER_FREQ_4MHz,
+    NRF_TIMER_FREQ_2MHz,
+    NRF_TIMER_FREQ_1MHz,
+} nrf_timer_frequency_t;
+
+#define NRF_TIMER_INT_COMPARE0_MASK (1UL << 16)
+#define NRF_TIMER_INT_COMPARE1_MASK (1UL << 17)
+
+void nrf_timer_task_trigger(NRF_TIMER_Type * p_reg, nrf_timer_task_t task);
+nrf_timer_task_t nrf_timer_capture_task_get(uint32_t channel);
+uint32_t nrf_timer_cc_read(NRF_TIMER_Type * p_reg, nrf_timer_cc_channel_t cc_channel);
+void nrf_timer_cc_write(NRF_TIMER_Type * p_reg, nrf_timer_cc_channel_t cc_channel, uint32_t cc_value);
+bool nrf_timer_event_check(NRF_TIMER_Type * p_reg, nrf_timer_event_t event);
+void nrf_timer_event_clear(NRF_TIMER_Type * p_reg, nrf_timer_event_t event);
+void nrf_timer_mode_set(NRF_TIMER_Type * p_reg, nrf_timer_mode_t mode);
+void nrf_timer_bit_width_set(NRF_TIMER_Type * p_reg, nrf_timer_bit_width_t bit_width);
+void nrf_timer_frequency_set(NRF_TIMER_Type * p_reg, nrf_timer_frequency_t frequency);
+void nrf_timer_int_enable(NRF_TIMER_Type * p_reg, uint32_t timer_int);
+
+#endif // NRF_TIMER_H__
@@ -0,0 +1,85 @@
+/***************************************************************************************/
+/*
+ * test
+ *
+ *  Checks of the host tests run by `make check`. A failed check is reported with
+ *  its location and counted, and the test goes on, so one run shows every failure.
+*/
+/***************************************************************************************/
+
+#ifndef TEST_H__
+#define TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARRAY_LEN(_a)   (sizeof(_a) / sizeof((_a)[0]))
+
+static unsigned m_test_failures __attribute__((unused));                /**< Checks failed so far. */
+
+/**@brief Macro for checking a condition. */
+#define CHECK(_cond)                                                                \
+    do                                                                              \
+    {                                                                               \
+        if (!(_cond))                                                               \
+        {                                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_cond); \
+            m_test_failures++;                                                      \
+        }                                                                           \
+    } while (0)
+
+/**@brief Macro for checking that two integers are equal, printing both if not. */
+#define CHECK_EQ(_a, _b)                                                            \
+    do                                                                              \
+    {                                                                               \
+        long long _va = (long long)(_a);                                            \
+        long long _vb = (long long)(_b);                                            \
+        if (_va != _vb)                                                             \
+        {                                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n",       \
+                    __FILE__, __LINE__, #_a, #_b, _va, _vb);                        \
+            m_test_failures++;                                                      \
+        }                                                                           \
+    } while (0)
+
+
+/**@brief Function for ending a test.
+ *
+ * @return Exit status of the test program.
+ */
+static inline int test_result(char const * p_name)
+{
+    if (m_test_failures != 0)
+    {
+        fprintf(stderr, "%s: %u checks failed\n", p_name, m_test_failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: ok\n", p_name);
+    return EXIT_SUCCESS;
+}
+
+
+/**@brief Function for a reproducible pseudo-random sequence (xorshift32). */
+static inline uint32_t test_rand(uint32_t * p_state)
+{
+    uint32_t x = *p_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *p_state = x;
+
+    return x;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEST_H__
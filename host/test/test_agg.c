@@ -0,0 +1,212 @@
+/***************************************************************************************/
+/*
+ * test_agg
+ *
+ *  RSSI aggregation replayed against a reference. A stream of reports from more
+ *  devices than the table holds is fed to scan_agg the way main.c does, with flushes
+ *  in between, a summary handler that now and then refuses, and late reports, as a
+ *  chained report reassembled after later reports is. The reference aggregates the
+ *  same stream in a plain array per device and window, with the late reports added
+ *  to the latest window, and every summary must match it.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_agg.h"
+#include "test.h"
+
+#define WINDOW_US       100000
+#define WINDOWS         400                                             /**< Past the end of the stream. */
+#define DEVICES         24
+#define REPORTS         20000
+
+SCAN_AGG_DEF(m_agg_large, 32);                                          /**< Holds every device. */
+SCAN_AGG_DEF(m_agg_small, 8);                                           /**< Evicts. */
+
+/**@brief Reference aggregate of a device over a window. */
+typedef struct
+{
+    uint32_t count;
+    int32_t  sum;
+    int8_t   min;
+    int8_t   max;
+    bool     seen;                                                      /**< Its summary was produced. */
+} ref_t;
+
+/**@brief Summaries received, checked against the reference. */
+typedef struct
+{
+    ref_t    ref[DEVICES][WINDOWS];
+    bool     partial;                                                   /**< Devices are evicted: the windows are split. */
+    uint32_t state;                                                     /**< Random state of the refusals. */
+    uint32_t summaries;
+    uint32_t evicted;
+    uint32_t count;                                                     /**< Reports summarized. */
+    uint64_t last_window[DEVICES];                                      /**< Window of the last summary of each device. */
+} replay_t;
+
+static replay_t m_replay;
+
+
+static bool summary_handler(scan_rssi_summary_t const * p_summary, void * p_context)
+{
+    replay_t * p_replay = p_context;
+    uint8_t    dev      = p_summary->addr[0];
+    uint32_t   window   = (uint32_t)(p_summary->window_us / WINDOW_US);
+
+    if (test_rand(&p_replay->state) % 16 == 0)
+    {
+        return false;
+    }
+
+    p_replay->summaries++;
+    p_replay->count += p_summary->count;
+
+    CHECK(dev < DEVICES);
+    CHECK(window < WINDOWS);
+    CHECK_EQ(p_summary->window_us % WINDOW_US, 0);
+    if ((dev >= DEVICES) || (window >= WINDOWS))
+    {
+        return true;
+    }
+
+    // The windows of a device never go back.
+    CHECK((p_replay->last_window[dev] == UINT64_MAX) || (p_summary->window_us >= p_replay->last_window[dev]));
+    p_replay->last_window[dev] = p_summary->window_us;
+
+    if (p_summary->flags & SCAN_RSSI_SUMMARY_FLAG_EVICTED)
+    {
+        p_replay->evicted++;
+    }
+    if (p_replay->partial)
+    {
+        // The rest of the window comes in another summary.
+        return true;
+    }
+
+    ref_t * p_ref = &p_replay->ref[dev][window];
+    int32_t half  = (int32_t)(p_ref->count / 2);
+
+    CHECK(!p_ref->seen);
+    CHECK_EQ(p_summary->count, p_ref->count);
+    CHECK_EQ(p_summary->rssi_min, p_ref->min);
+    CHECK_EQ(p_summary->rssi_max, p_ref->max);
+    if (p_ref->count > 0)
+    {
+        CHECK_EQ(p_summary->rssi_mean, (p_ref->sum < 0) ? (p_ref->sum - half) / (int32_t)p_ref->count
+                                                        : (p_ref->sum + half) / (int32_t)p_ref->count);
+    }
+    p_ref->seen = true;
+
+    return true;
+}
+
+
+/**@brief Function for replaying the stream through a table.
+ *
+ * @param[in]   p_agg       Table.
+ * @param[in]   evicts      The table is too small for all the devices: only the totals
+ *                          can be checked.
+ */
+static void replay(scan_agg_t * p_agg, bool evicts)
+{
+    uint32_t state       = 7;
+    uint64_t now         = 0;
+    uint64_t window_last = 0;
+    uint32_t late        = 0;
+
+    memset(&m_replay, 0, sizeof(m_replay));
+    m_replay.partial = evicts;
+    m_replay.state   = 3;
+    for (uint32_t dev = 0; dev < DEVICES; dev++)
+    {
+        m_replay.last_window[dev] = UINT64_MAX;
+    }
+    scan_agg_init(p_agg, WINDOW_US);
+
+    for (uint32_t i = 0; i < REPORTS; i++)
+    {
+        scan_report_hdr_t hdr;
+        uint64_t          window;
+        ref_t           * p_ref;
+
+        now += test_rand(&state) % 1800;
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.addr[0]      = (uint8_t)(test_rand(&state) % DEVICES);
+        hdr.addr[5]      = 0xC0;
+        hdr.addr_type    = 1;
+        hdr.rssi         = (int8_t)(-40 - (int)(test_rand(&state) % 60));
+        hdr.timestamp_us = now;
+        if ((test_rand(&state) % 20 == 0) && (now > WINDOW_US))
+        {
+            // Reassembled late, stamped with the time of its first fragment.
+            hdr.timestamp_us = now - test_rand(&state) % WINDOW_US;
+        }
+
+        window = hdr.timestamp_us - hdr.timestamp_us % WINDOW_US;
+        if (window < window_last)
+        {
+            window = window_last;
+            late++;
+        }
+        window_last = window;
+
+        p_ref = &m_replay.ref[hdr.addr[0]][window / WINDOW_US];
+        if ((p_ref->count == 0) || (hdr.rssi < p_ref->min))
+        {
+            p_ref->min = hdr.rssi;
+        }
+        if ((p_ref->count == 0) || (hdr.rssi > p_ref->max))
+        {
+            p_ref->max = hdr.rssi;
+        }
+        p_ref->count++;
+        p_ref->sum += hdr.rssi;
+
+        // Refused: the report stays queued and comes again, as in main.c.
+        while (!scan_agg_add(p_agg, &hdr, summary_handler, &m_replay))
+        {
+        }
+
+        if (i % 64 == 0)
+        {
+            (void)scan_agg_flush(p_agg, now, summary_handler, &m_replay);
+        }
+    }
+
+    while (!scan_agg_flush(p_agg, now + 2 * WINDOW_US, summary_handler, &m_replay))
+    {
+    }
+
+    CHECK_EQ(p_agg->count, 0);
+    CHECK_EQ(p_agg->late, late);
+    CHECK(late > REPORTS / 100);
+    CHECK_EQ(m_replay.count, REPORTS);
+    CHECK_EQ(m_replay.evicted, p_agg->evictions);
+
+    if (evicts)
+    {
+        CHECK(p_agg->evictions > 0);
+        return;
+    }
+
+    CHECK_EQ(p_agg->evictions, 0);
+    for (uint32_t dev = 0; dev < DEVICES; dev++)
+    {
+        for (uint32_t window = 0; window < WINDOWS; window++)
+        {
+            CHECK_EQ(m_replay.ref[dev][window].seen, m_replay.ref[dev][window].count > 0);
+        }
+    }
+}
+
+
+int main(void)
+{
+    replay(&m_agg_large, false);
+    replay(&m_agg_small, true);
+
+    return test_result("test_agg");
+}
@@ -0,0 +1,439 @@
+/***************************************************************************************/
+/*
+ * test_beacon
+ *
+ *  Beacon decoding against a table of advertisements of every format, with the
+ *  fields each must give, and against malformed data: every truncation of each
+ *  advertisement, zero-length and type-only AD structures, frames of the wrong
+ *  length or version, then random corruptions of the table. The data is copied to a
+ *  buffer of its exact length each time, and the test is built with the address
+ *  sanitizer when the compiler has it, so a read past the data is caught.
+ *
+ *  scan_beacon.c is included, so it is built with the flags of the test.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_beacon.c"
+#include "test.h"
+
+#define DATA_MAX        62                                              /**< Longest advertisement of the table. */
+#define CORRUPTIONS     200000
+#define SENTINEL        0x5A                                            /**< Fill of the body, which no decode may touch unless it finds a beacon. */
+
+/**@brief Advertisement and the beacon it holds. */
+typedef struct
+{
+    char const *       p_name;
+    uint8_t            data[DATA_MAX];
+    uint16_t           len;
+    scan_beacon_type_t type;
+    scan_beacon_body_t body;                                            /**< Fields expected, the rest of the union zero. */
+} vector_t;
+
+/** Flags AD structure, in front of most beacons. */
+#define FLAGS           0x02, 0x01, 0x06
+/** Complete List of 16-bit Service UUIDs with the Eddystone UUID. */
+#define EDDYSTONE_LIST  0x03, 0x03, 0xAA, 0xFE
+#define UUID            0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2, \
+                        0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0
+
+static vector_t const m_vectors[] =
+{
+    {
+        .p_name = "ibeacon",
+        .data   = { FLAGS, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x01, 0x02, 0xC5 },
+        .len    = 30,
+        .type   = SCAN_BEACON_IBEACON,
+        .body.ibeacon =
+        {
+            .uuid           = { UUID },
+            .major          = 0x0001,
+            .minor          = 0x0102,
+            .measured_power = -59,
+        },
+    },
+    {
+        .p_name = "altbeacon",
+        .data   = { FLAGS, 0x1B, 0xFF, 0x18, 0x01, 0xBE, 0xAC, UUID, 0x12, 0x34, 0x56, 0x78, 0xBD, 0x7F },
+        .len    = 31,
+        .type   = SCAN_BEACON_ALTBEACON,
+        .body.altbeacon =
+        {
+            .company_id   = 0x0118,
+            .beacon_id    = { UUID, 0x12, 0x34, 0x56, 0x78 },
+            .ref_rssi     = -67,
+            .mfg_reserved = 0x7F,
+        },
+    },
+    {
+        .p_name = "eddystone uid",
+        .data   = { FLAGS, EDDYSTONE_LIST, 0x17, 0x16, 0xAA, 0xFE, 0x00, 0xE7,
+                    0x8B, 0x0C, 0xA7, 0x50, 0xE7, 0xA1, 0xE9, 0x10, 0xCC, 0x5A,
+                    0x00, 0x00, 0x00, 0x00, 0x01, 0x2F, 0x00, 0x00 },
+        .len    = 31,
+        .type   = SCAN_BEACON_EDDYSTONE_UID,
+        .body.eddystone_uid =
+        {
+            .tx_power     = -25,
+            .namespace_id = { 0x8B, 0x0C, 0xA7, 0x50, 0xE7, 0xA1, 0xE9, 0x10, 0xCC, 0x5A },
+            .instance_id  = { 0x00, 0x00, 0x00, 0x00, 0x01, 0x2F },
+        },
+    },
+    {
+        .p_name = "eddystone uid, no reserved bytes",
+        .data   = { EDDYSTONE_LIST, 0x15, 0x16, 0xAA, 0xFE, 0x00, 0x00,
+                    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+                    0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10 },
+        .len    = 26,
+        .type   = SCAN_BEACON_EDDYSTONE_UID,
+        .body.eddystone_uid =
+        {
+            .tx_power     = 0,
+            .namespace_id = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A },
+            .instance_id  = { 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10 },
+        },
+    },
+    {
+        .p_name = "eddystone url",
+        .data   = { FLAGS, EDDYSTONE_LIST, 0x0E, 0x16, 0xAA, 0xFE, 0x10, 0xEB, 0x00,
+                    'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x07 },
+        .len    = 22,
+        .type   = SCAN_BEACON_EDDYSTONE_URL,
+        .body.eddystone_url =
+        {
+            .tx_power = -21,
+            .scheme   = 0x00,
+            .url_len  = 8,
+            .url      = { 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x07 },
+        },
+    },
+    {
+        .p_name = "eddystone url, longest",
+        .data   = { EDDYSTONE_LIST, 0x17, 0x16, 0xAA, 0xFE, 0x10, 0x00, 0x03,
+                    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 0x00 },
+        .len    = 28,
+        .type   = SCAN_BEACON_EDDYSTONE_URL,
+        .body.eddystone_url =
+        {
+            .tx_power = 0,
+            .scheme   = 0x03,
+            .url_len  = 17,
+            .url      = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 0x00 },
+        },
+    },
+    {
+        .p_name = "eddystone tlm",
+        .data   = { FLAGS, EDDYSTONE_LIST, 0x11, 0x16, 0xAA, 0xFE, 0x20, 0x00,
+                    0x0B, 0xB8, 0x17, 0x80, 0x00, 0x00, 0x12, 0x34, 0x00, 0x01, 0xE2, 0x40 },
+        .len    = 25,
+        .type   = SCAN_BEACON_EDDYSTONE_TLM,
+        .body.eddystone_tlm =
+        {
+            .battery_mv  = 3000,
+            .temperature = 0x1780,                                      /**< 23.5 degrees Celsius. */
+            .adv_count   = 0x1234,
+            .uptime_ds   = 123456,
+        },
+    },
+    {
+        .p_name = "eddystone tlm, no temperature",
+        .data   = { EDDYSTONE_LIST, 0x11, 0x16, 0xAA, 0xFE, 0x20, 0x00,
+                    0x00, 0x00, 0x80, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00 },
+        .len    = 22,
+        .type   = SCAN_BEACON_EDDYSTONE_TLM,
+        .body.eddystone_tlm =
+        {
+            .battery_mv  = 0,
+            .temperature = SCAN_EDDYSTONE_TEMP_INVALID,
+            .adv_count   = 0xFFFFFFFF,
+            .uptime_ds   = 0,
+        },
+    },
+    {
+        .p_name = "eddystone eid",
+        .data   = { FLAGS, EDDYSTONE_LIST, 0x0D, 0x16, 0xAA, 0xFE, 0x30, 0xF0,
+                    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+        .len    = 21,
+        .type   = SCAN_BEACON_EDDYSTONE_EID,
+        .body.eddystone_eid =
+        {
+            .tx_power = -16,
+            .eid      = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+        },
+    },
+    {
+        .p_name = "ibeacon after a type-only and an empty eddystone structure",
+        .data   = { 0x01, 0xFF, 0x01, 0x16, 0x03, 0x16, 0xAA, 0xFE,
+                    0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0xFF, 0xFF, 0x00, 0x00, 0x80 },
+        .len    = 35,
+        .type   = SCAN_BEACON_IBEACON,
+        .body.ibeacon =
+        {
+            .uuid           = { UUID },
+            .major          = 0xFFFF,
+            .minor          = 0x0000,
+            .measured_power = -128,
+        },
+    },
+    {
+        .p_name = "ibeacon followed by zero padding",
+        .data   = { 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x00, 0x02, 0xC5,
+                    0x00, 0x00, 0x00, 0x00 },
+        .len    = 31,
+        .type   = SCAN_BEACON_IBEACON,
+        .body.ibeacon =
+        {
+            .uuid           = { UUID },
+            .major          = 0x0001,
+            .minor          = 0x0002,
+            .measured_power = -59,
+        },
+    },
+    {
+        .p_name = "ibeacon behind a zero length, past the significant part",
+        .data   = { FLAGS, 0x00, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x01, 0x02, 0xC5 },
+        .len    = 31,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "ibeacon one byte too long",
+        .data   = { FLAGS, 0x1B, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x01, 0x02, 0xC5, 0x00 },
+        .len    = 31,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "ibeacon of another company",
+        .data   = { FLAGS, 0x1A, 0xFF, 0x59, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x01, 0x02, 0xC5 },
+        .len    = 30,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone uid one byte short",
+        .data   = { EDDYSTONE_LIST, 0x14, 0x16, 0xAA, 0xFE, 0x00, 0x00,
+                    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+                    0x0B, 0x0C, 0x0D, 0x0E, 0x0F },
+        .len    = 25,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone url, no url",
+        .data   = { EDDYSTONE_LIST, 0x06, 0x16, 0xAA, 0xFE, 0x10, 0x00, 0x00 },
+        .len    = 11,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone url, one byte too long",
+        .data   = { EDDYSTONE_LIST, 0x18, 0x16, 0xAA, 0xFE, 0x10, 0x00, 0x03,
+                    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 0x00 },
+        .len    = 29,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone url, unknown scheme",
+        .data   = { EDDYSTONE_LIST, 0x08, 0x16, 0xAA, 0xFE, 0x10, 0x00, 0x04, 'a', 0x00 },
+        .len    = 13,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone tlm, encrypted",
+        .data   = { EDDYSTONE_LIST, 0x11, 0x16, 0xAA, 0xFE, 0x20, 0x01,
+                    0x0B, 0xB8, 0x17, 0x80, 0x00, 0x00, 0x12, 0x34, 0x00, 0x01, 0xE2, 0x40 },
+        .len    = 22,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "eddystone, unknown frame",
+        .data   = { EDDYSTONE_LIST, 0x0D, 0x16, 0xAA, 0xFE, 0x40, 0xF0,
+                    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+        .len    = 18,
+        .type   = SCAN_BEACON_NONE,
+    },
+    {
+        .p_name = "length past the end",
+        .data   = { FLAGS, 0x1B, 0xFF, 0x4C, 0x00, 0x02, 0x15, UUID, 0x00, 0x01, 0x01, 0x02, 0xC5 },
+        .len    = 30,
+        .type   = SCAN_BEACON_NONE,
+    },
+};
+
+
+/**@brief Function for decoding a copy of the data in a buffer of its exact length.
+ *
+ * @details Checks what holds for any data: a beacon type the records know, or the
+ *          body left untouched.
+ */
+static scan_beacon_type_t decode(uint8_t const * p_data, uint16_t len, scan_beacon_body_t * p_body)
+{
+    uint8_t          * p_copy = malloc(len ? len : 1);
+    scan_beacon_body_t untouched;
+    scan_beacon_type_t type;
+
+    memcpy(p_copy, p_data, len);
+    memset(p_body, SENTINEL, sizeof(*p_body));
+    memset(&untouched, SENTINEL, sizeof(untouched));
+
+    type = scan_beacon_decode(p_copy, len, p_body);
+    free(p_copy);
+
+    if (type == SCAN_BEACON_NONE)
+    {
+        CHECK(memcmp(p_body, &untouched, sizeof(untouched)) == 0);
+    }
+    else
+    {
+        CHECK(scan_beacon_body_len(type) > 0);
+    }
+    if (type == SCAN_BEACON_EDDYSTONE_URL)
+    {
+        CHECK(p_body->eddystone_url.url_len <= SCAN_EDDYSTONE_URL_MAX);
+    }
+
+    return type;
+}
+
+
+/**@brief Function for getting the length of the AD structures of a vector, without the
+ *        zero padding that may follow them.
+ */
+static uint16_t significant_len(vector_t const * p_vector)
+{
+    uint16_t len = 0;
+
+    while ((len < p_vector->len) && (p_vector->data[len] != 0))
+    {
+        len += p_vector->data[len] + 1;
+    }
+
+    return len;
+}
+
+
+/**@brief Function for checking the table, and every truncation of its advertisements. */
+static void test_vectors(void)
+{
+    for (uint32_t i = 0; i < ARRAY_LEN(m_vectors); i++)
+    {
+        vector_t const   * p_vector = &m_vectors[i];
+        scan_beacon_body_t body;
+        scan_beacon_type_t type     = decode(p_vector->data, p_vector->len, &body);
+
+        CHECK_EQ(type, p_vector->type);
+        if (type != p_vector->type)
+        {
+            fprintf(stderr, "  vector: %s\n", p_vector->p_name);
+            continue;
+        }
+        if ((type != SCAN_BEACON_NONE)
+            && (memcmp(&body, &p_vector->body, scan_beacon_body_len(type)) != 0))
+        {
+            CHECK(!"fields as expected");
+            fprintf(stderr, "  vector: %s\n", p_vector->p_name);
+        }
+
+        // The beacon is in the last AD structure: cut anywhere but in the padding, it is lost.
+        for (uint16_t len = 0; len < p_vector->len; len++)
+        {
+            CHECK_EQ(decode(p_vector->data, len, &body),
+                     (len >= significant_len(p_vector)) ? p_vector->type : SCAN_BEACON_NONE);
+        }
+    }
+}
+
+
+/**@brief Function for checking the URL expansion of a decoded frame, into buffers of every size. */
+static void test_url(void)
+{
+    static char const  expected[] = "http://www.example.com";
+    scan_beacon_body_t body;
+    char               buf[sizeof(expected) + 4];
+
+    CHECK_EQ(decode(m_vectors[4].data, m_vectors[4].len, &body), SCAN_BEACON_EDDYSTONE_URL);
+
+    for (size_t size = 1; size <= sizeof(buf); size++)
+    {
+        size_t len;
+
+        memset(buf, SENTINEL, sizeof(buf));
+        len = scan_beacon_url_expand(&body.eddystone_url, buf, size);
+        CHECK_EQ(len, (size < sizeof(expected)) ? size - 1 : sizeof(expected) - 1);
+        CHECK_EQ(buf[len], '\0');
+        CHECK(strncmp(buf, expected, len) == 0);
+        if (size < sizeof(buf))
+        {
+            CHECK_EQ(buf[size], SENTINEL);
+        }
+    }
+
+    // Reserved codes and unprintable bytes read as '?'.
+    body.eddystone_url.url_len = 3;
+    body.eddystone_url.url[0]  = 0x0E;
+    body.eddystone_url.url[1]  = 0x20;
+    body.eddystone_url.url[2]  = 0x7F;
+    body.eddystone_url.scheme  = 0x03;
+    CHECK_EQ(scan_beacon_url_expand(&body.eddystone_url, buf, sizeof(buf)), 11);
+    CHECK(strcmp(buf, "https://??\?") == 0);
+}
+
+
+/**@brief Function for decoding random corruptions of the table: bytes changed, inserted
+ *        zero lengths, lengths cut. Only the checks of decode apply.
+ */
+static void test_corrupt(void)
+{
+    uint32_t state = 11;
+    uint32_t found = 0;
+
+    for (uint32_t i = 0; i < CORRUPTIONS; i++)
+    {
+        vector_t const   * p_vector = &m_vectors[test_rand(&state) % ARRAY_LEN(m_vectors)];
+        uint8_t            data[DATA_MAX];
+        uint16_t           len      = p_vector->len;
+        scan_beacon_body_t body;
+
+        memcpy(data, p_vector->data, sizeof(data));
+        for (uint32_t n = test_rand(&state) % 4; n > 0; n--)
+        {
+            uint32_t pos = test_rand(&state) % len;
+
+            switch (test_rand(&state) % 4)
+            {
+                case 0:
+                    data[pos] = 0;
+                    break;
+
+                case 1:
+                    data[pos] = (uint8_t)(data[pos] + 1 - (test_rand(&state) % 3));
+                    break;
+
+                case 2:
+                    data[pos] = (uint8_t)test_rand(&state);
+                    break;
+
+                default:
+                    len = (uint16_t)pos;
+                    break;
+            }
+            if (len == 0)
+            {
+                break;
+            }
+        }
+
+        found += decode(data, len, &body) != SCAN_BEACON_NONE;
+    }
+
+    // Most corruptions miss the fields that are checked.
+    CHECK(found > CORRUPTIONS / 10);
+}
+
+
+int main(void)
+{
+    test_vectors();
+    test_url();
+    test_corrupt();
+
+    return test_result("test_beacon");
+}
@@ -0,0 +1,500 @@
+/***************************************************************************************/
+/*
+ * test_chain
+ *
+ *  Reassembly of extended advertising chains. The fragments of chains from several
+ *  advertisers and SIDs are interleaved, as the SoftDevice reports them, and the
+ *  handler refuses now and then, as main.c does when the output is full, so every
+ *  report is added again. The data of each chain is known from its advertiser, its
+ *  data ID and the offset, so each report produced can be checked byte by byte.
+ *
+ *  First the cases one by one: the SCAN_REPORT_CHAIN_DATA_MAX limit, chains cut by
+ *  the SoftDevice or replaced by the next one, the timeout, and a chain closed to
+ *  make room for another. Then random streams: with no more advertisers than
+ *  buffers every chain must come out whole; with more of them, and silences longer
+ *  than the timeout, chains are closed early and come out truncated, and the rest of
+ *  their fragments must be dropped. Either way each chain comes out once, from its
+ *  start, and no buffer may stay taken.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_chain.h"
+#include "test.h"
+
+#define POOL_SIZE       4
+#define FRAGMENT_MAX    255                                             /**< SCANNER_REPORT_DATA_MAX. */
+#define CHAIN_LEN_MAX   2100                                            /**< Longer than a buffer. */
+#define PAIRS_MAX       7
+#define DATA_IDS        4096
+#define TIMEOUT_US      50000
+#define STEPS           200000
+
+SCAN_CHAIN_DEF(m_chain, POOL_SIZE);
+
+/**@brief An advertiser and SID, and the chains it sent. */
+typedef struct
+{
+    uint8_t  addr_type;
+    uint8_t  set_id;
+    bool     active;                                                    /**< A chain is being sent. */
+    uint16_t data_id;                                                   /**< Chain being sent, or the last one. */
+    uint16_t sent;                                                      /**< Data of the chain sent so far. */
+    uint16_t len[DATA_IDS];                                             /**< Length of each chain. */
+    uint8_t  status[DATA_IDS];                                          /**< Status of the last fragment of each chain. */
+    uint16_t produced[DATA_IDS];                                        /**< Data of each chain produced. */
+    uint32_t reports[DATA_IDS];                                         /**< Reports produced for each chain. */
+} pair_t;
+
+/**@brief Reports produced, checked as they come. */
+typedef struct
+{
+    pair_t   pairs[PAIRS_MAX];
+    uint32_t pair_count;
+    uint32_t state;                                                     /**< Random state of the refusals. */
+    uint32_t refuse;                                                    /**< One report in this many is refused, 0 for none. */
+    bool     whole;                                                     /**< Every chain must come out whole. */
+    uint32_t reports;
+    uint32_t truncated;
+    uint32_t partial;                                                   /**< Reports of a part of a chain. */
+    scan_report_hdr_t last_hdr;
+    uint8_t  last_data[SCAN_REPORT_CHAIN_DATA_MAX];
+} test_t;
+
+static test_t m_test;
+
+
+static uint8_t chain_byte(uint32_t pair, uint16_t data_id, uint32_t offset)
+{
+    return (uint8_t)(pair * 37 + data_id * 11 + offset * 3 + (offset >> 8));
+}
+
+
+/**@brief Function for getting the data of a chain a buffer holds. */
+static uint16_t chain_kept(uint16_t len)
+{
+    return (len < SCAN_REPORT_CHAIN_DATA_MAX) ? len : SCAN_REPORT_CHAIN_DATA_MAX;
+}
+
+
+static uint8_t report_status(scan_report_hdr_t const * p_hdr)
+{
+    return (p_hdr->flags & SCAN_REPORT_FLAG_STATUS_Msk) >> SCAN_REPORT_FLAG_STATUS_Pos;
+}
+
+
+static bool data_match(uint32_t pair, uint16_t data_id, uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (p_data[i] != chain_byte(pair, data_id, offset + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for checking a report against the chain it comes from. */
+static bool report_handler(scan_report_hdr_t const * p_hdr, uint8_t const * p_data, void * p_context)
+{
+    test_t * p_test = p_context;
+    uint32_t pair   = p_hdr->addr[0];
+    pair_t * p_pair;
+    uint16_t id     = p_hdr->data_id;
+    bool     whole;
+
+    if ((p_test->refuse != 0) && (test_rand(&p_test->state) % p_test->refuse == 0))
+    {
+        return false;
+    }
+
+    p_test->reports++;
+    p_test->last_hdr = *p_hdr;
+    memcpy(p_test->last_data, p_data, p_hdr->data_len);
+
+    CHECK(pair < p_test->pair_count);
+    CHECK(p_hdr->data_len <= SCAN_REPORT_CHAIN_DATA_MAX);
+    if ((pair >= p_test->pair_count) || (p_hdr->data_len > SCAN_REPORT_CHAIN_DATA_MAX))
+    {
+        return true;
+    }
+    p_pair = &p_test->pairs[pair];
+    CHECK_EQ(p_hdr->set_id, p_pair->set_id);
+    CHECK_EQ(p_hdr->addr_type, p_pair->addr_type);
+
+    // The chain from its start, once: the fragments of a chain closed early are dropped.
+    CHECK_EQ(p_pair->reports[id], 0);
+    CHECK(p_hdr->data_len <= p_pair->len[id]);
+    CHECK(data_match(pair, id, 0, p_data, p_hdr->data_len));
+    p_pair->produced[id] = p_hdr->data_len;
+    p_pair->reports[id]++;
+
+    whole = (p_hdr->data_len == p_pair->len[id]) && (report_status(p_hdr) == SCAN_REPORT_STATUS_COMPLETE);
+    CHECK_EQ((p_hdr->flags & SCAN_REPORT_FLAG_TRUNCATED) != 0, !whole);
+    p_test->truncated += !whole;
+    p_test->partial   += p_hdr->data_len < chain_kept(p_pair->len[id]);
+
+    if (p_test->whole)
+    {
+        CHECK_EQ(p_hdr->data_len, chain_kept(p_pair->len[id]));
+        CHECK_EQ(report_status(p_hdr), p_pair->status[id]);
+    }
+
+    return true;
+}
+
+
+static void test_init(uint32_t pair_count, uint64_t timeout_us)
+{
+    memset(&m_test, 0, sizeof(m_test));
+    m_test.pair_count = pair_count;
+    for (uint32_t i = 0; i < pair_count; i++)
+    {
+        // Advertisers that differ by the SID or by the address type only.
+        m_test.pairs[i].set_id    = (uint8_t)(i % 2);
+        m_test.pairs[i].addr_type = (uint8_t)((i / 2) % 2);
+        m_test.pairs[i].data_id   = (uint16_t)(DATA_IDS - 1);
+    }
+    scan_chain_init(&m_chain, timeout_us);
+}
+
+
+/**@brief Function for starting a chain of an advertiser.
+ *
+ * @param[in]   status      Status of its last fragment.
+ */
+static void chain_start(uint32_t pair, uint16_t len, uint8_t status)
+{
+    pair_t * p_pair = &m_test.pairs[pair];
+
+    p_pair->data_id                   = (uint16_t)((p_pair->data_id + 1) % DATA_IDS);
+    p_pair->len[p_pair->data_id]      = len;
+    p_pair->status[p_pair->data_id]   = status;
+    p_pair->produced[p_pair->data_id] = 0;
+    p_pair->reports[p_pair->data_id]  = 0;
+    p_pair->sent                      = 0;
+    p_pair->active                    = true;
+}
+
+
+/**@brief Function for sending the next fragment of the chain of an advertiser.
+ *
+ * @return true if it was the last fragment.
+ */
+static bool fragment_send(uint32_t pair, uint64_t time_us)
+{
+    pair_t          * p_pair = &m_test.pairs[pair];
+    uint16_t          id     = p_pair->data_id;
+    uint16_t          len    = p_pair->len[id] - p_pair->sent;
+    scan_report_hdr_t hdr;
+    uint8_t           data[FRAGMENT_MAX];
+    bool              last;
+    uint8_t           status;
+
+    len    = (len < FRAGMENT_MAX) ? len : FRAGMENT_MAX;
+    last   = (p_pair->sent + len == p_pair->len[id]);
+    status = last ? p_pair->status[id] : SCAN_REPORT_STATUS_MORE_DATA;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.timestamp_us = time_us;
+    hdr.addr[0]      = (uint8_t)pair;
+    hdr.addr[5]      = 0xC0;
+    hdr.addr_type    = p_pair->addr_type;
+    hdr.set_id       = p_pair->set_id;
+    hdr.data_id      = id;
+    hdr.data_len     = len;
+    hdr.flags        = SCAN_REPORT_FLAG_EXTENDED_PDU | (uint8_t)(status << SCAN_REPORT_FLAG_STATUS_Pos);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        data[i] = chain_byte(pair, id, p_pair->sent + i);
+    }
+
+    // Refused: added again, as main.c does with the report left in the queue.
+    while (!scan_chain_add(&m_chain, &hdr, data, report_handler, &m_test))
+    {
+    }
+
+    p_pair->sent  += len;
+    p_pair->active = !last;
+    return last;
+}
+
+
+static void chain_send(uint32_t pair, uint16_t len, uint8_t status, uint64_t time_us)
+{
+    chain_start(pair, len, status);
+    while (!fragment_send(pair, time_us++))
+    {
+    }
+}
+
+
+static bool pool_empty(void)
+{
+    for (uint32_t i = 0; i < POOL_SIZE; i++)
+    {
+        if (m_chain.p_entries[i].used)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**@brief Chains of the longest data a buffer holds, and longer. */
+static void test_limit(void)
+{
+    test_init(1, TIMEOUT_US);
+
+    chain_send(0, SCAN_REPORT_CHAIN_DATA_MAX, SCAN_REPORT_STATUS_COMPLETE, 1000);
+    CHECK_EQ(m_test.reports, 1);
+    CHECK_EQ(m_test.last_hdr.data_len, SCAN_REPORT_CHAIN_DATA_MAX);
+    CHECK_EQ(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED, 0);
+    CHECK_EQ(m_test.last_hdr.timestamp_us, 1000);
+
+    // Cut at the limit, status of the last fragment kept.
+    chain_send(0, CHAIN_LEN_MAX, SCAN_REPORT_STATUS_COMPLETE, 2000);
+    CHECK_EQ(m_test.reports, 2);
+    CHECK_EQ(m_test.last_hdr.data_len, SCAN_REPORT_CHAIN_DATA_MAX);
+    CHECK(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED);
+    CHECK_EQ(report_status(&m_test.last_hdr), SCAN_REPORT_STATUS_COMPLETE);
+    CHECK(data_match(0, m_test.pairs[0].data_id, 0, m_test.last_data, SCAN_REPORT_CHAIN_DATA_MAX));
+
+    CHECK_EQ(m_chain.chains, 2);
+    CHECK_EQ(m_chain.truncated, 1);
+    CHECK(pool_empty());
+}
+
+
+/**@brief Chains cut by the SoftDevice, and chains whose end was lost. */
+static void test_truncated(void)
+{
+    test_init(2, TIMEOUT_US);
+
+    // Cut after three fragments.
+    chain_start(0, 3 * FRAGMENT_MAX, SCAN_REPORT_STATUS_TRUNCATED);
+    CHECK(!fragment_send(0, 1000));
+    CHECK(!fragment_send(0, 1001));
+    CHECK(fragment_send(0, 1002));
+    CHECK_EQ(m_test.reports, 1);
+    CHECK_EQ(m_test.last_hdr.data_len, 3 * FRAGMENT_MAX);
+    CHECK_EQ(report_status(&m_test.last_hdr), SCAN_REPORT_STATUS_TRUNCATED);
+    CHECK(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED);
+
+    // Cut after the first fragment: no chain to gather.
+    chain_send(1, 100, SCAN_REPORT_STATUS_TRUNCATED, 1003);
+    CHECK_EQ(m_test.reports, 2);
+    CHECK(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED);
+
+    // A new chain before the end of the previous one: the previous one comes first.
+    chain_start(0, 4 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE);
+    CHECK(!fragment_send(0, 1004));
+    CHECK(!fragment_send(0, 1005));
+    CHECK_EQ(m_test.reports, 2);
+    chain_send(0, 2 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE, 1006);
+    CHECK_EQ(m_test.reports, 4);
+    CHECK_EQ(m_test.pairs[0].produced[m_test.pairs[0].data_id - 1], 2 * FRAGMENT_MAX);
+    CHECK_EQ(m_test.pairs[0].reports[m_test.pairs[0].data_id], 1);
+    CHECK_EQ(m_test.truncated, 3);
+
+    CHECK_EQ(m_chain.truncated, 3);
+    CHECK_EQ(m_chain.evictions, 0);
+    CHECK(pool_empty());
+}
+
+
+/**@brief A chain that stops receiving fragments is given up after the timeout. */
+static void test_timeout(void)
+{
+    test_init(2, TIMEOUT_US);
+
+    chain_start(0, 5 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE);
+    chain_start(1, 2 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE);
+    CHECK(!fragment_send(0, 1000));
+    CHECK(!fragment_send(1, 1001));
+    CHECK(!fragment_send(0, 1002));
+
+    CHECK(scan_chain_flush(&m_chain, 1001 + TIMEOUT_US - 1, report_handler, &m_test));
+    CHECK_EQ(m_test.reports, 0);
+
+    // The chain of the second advertiser is given up, the other one goes on.
+    CHECK(scan_chain_flush(&m_chain, 1001 + TIMEOUT_US, report_handler, &m_test));
+    CHECK_EQ(m_test.reports, 1);
+    CHECK_EQ(m_test.last_hdr.addr[0], 1);
+    CHECK_EQ(m_test.last_hdr.data_len, FRAGMENT_MAX);
+    CHECK_EQ(report_status(&m_test.last_hdr), SCAN_REPORT_STATUS_TRUNCATED);
+    CHECK(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED);
+
+    // Its last fragment is dropped, not produced as a chain of its own.
+    CHECK(fragment_send(1, 1002 + TIMEOUT_US));
+    CHECK_EQ(m_test.reports, 1);
+    CHECK_EQ(m_chain.skipped, 1);
+
+    // The next chain of the same advertiser is gathered again.
+    chain_send(1, 3 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE, 1003 + TIMEOUT_US);
+    CHECK_EQ(m_test.reports, 2);
+    CHECK_EQ(m_test.last_hdr.data_len, 3 * FRAGMENT_MAX);
+    CHECK_EQ(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED, 0);
+
+    // The first chain timed out as well.
+    CHECK(scan_chain_flush(&m_chain, 1002 + 2 * TIMEOUT_US, report_handler, &m_test));
+    CHECK_EQ(m_test.reports, 3);
+    CHECK_EQ(m_test.last_hdr.addr[0], 0);
+    CHECK_EQ(m_test.last_hdr.data_len, 2 * FRAGMENT_MAX);
+    CHECK(pool_empty());
+}
+
+
+/**@brief One chain more than buffers: the one with the oldest fragment is closed. */
+static void test_reuse(void)
+{
+    uint64_t now = 1000;
+
+    test_init(POOL_SIZE + 1, TIMEOUT_US);
+
+    for (uint32_t pair = 0; pair < POOL_SIZE; pair++)
+    {
+        chain_start(pair, 4 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE);
+        CHECK(!fragment_send(pair, now++));
+    }
+    // The first advertiser sends again, the second one is now the oldest.
+    CHECK(!fragment_send(0, now++));
+    CHECK_EQ(m_test.reports, 0);
+
+    chain_start(POOL_SIZE, 2 * FRAGMENT_MAX, SCAN_REPORT_STATUS_COMPLETE);
+    CHECK(!fragment_send(POOL_SIZE, now++));
+    CHECK_EQ(m_test.reports, 1);
+    CHECK_EQ(m_test.last_hdr.addr[0], 1);
+    CHECK(m_test.last_hdr.flags & SCAN_REPORT_FLAG_TRUNCATED);
+    CHECK_EQ(m_chain.evictions, 1);
+
+    // The rest of the closed chain is dropped, the others end whole.
+    for (uint32_t pair = 0; pair <= POOL_SIZE; pair++)
+    {
+        while (m_test.pairs[pair].active)
+        {
+            (void)fragment_send(pair, now++);
+        }
+    }
+    CHECK_EQ(m_chain.skipped, 3);
+    CHECK_EQ(m_test.reports, POOL_SIZE + 1);
+    CHECK_EQ(m_test.truncated, 1);
+    CHECK(pool_empty());
+
+    // The buffers are taken again by new chains, whole.
+    for (uint32_t round = 0; round < 3; round++)
+    {
+        for (uint32_t pair = 0; pair < POOL_SIZE; pair++)
+        {
+            chain_start(pair, (uint16_t)(FRAGMENT_MAX * (2 + pair) + round), SCAN_REPORT_STATUS_COMPLETE);
+        }
+        for (bool more = true; more; )
+        {
+            more = false;
+            for (uint32_t pair = 0; pair < POOL_SIZE; pair++)
+            {
+                if (m_test.pairs[pair].active)
+                {
+                    (void)fragment_send(pair, now++);
+                    more = true;
+                }
+            }
+        }
+    }
+    CHECK_EQ(m_test.reports, POOL_SIZE + 1 + 3 * POOL_SIZE);
+    CHECK_EQ(m_test.truncated, 1);
+    CHECK_EQ(m_chain.evictions, 1);
+    CHECK(pool_empty());
+}
+
+
+/**@brief Random interleaved chains.
+ *
+ * @param[in]   pair_count  Advertisers. More than the buffers, chains are closed early.
+ * @param[in]   silences    Now and then, no fragment for longer than the timeout.
+ */
+static void test_random(uint32_t pair_count, bool silences)
+{
+    uint32_t state  = 11;
+    uint64_t now    = 1000;
+    uint32_t chains = 0;
+
+    test_init(pair_count, silences ? TIMEOUT_US : UINT32_MAX);
+    m_test.whole  = (pair_count <= POOL_SIZE) && !silences;
+    m_test.refuse = 8;
+    m_test.state  = 5;
+
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        uint32_t pair = test_rand(&state) % pair_count;
+
+        now += 1 + test_rand(&state) % 2000;
+        if (silences && (test_rand(&state) % 512 == 0))
+        {
+            now += TIMEOUT_US + test_rand(&state) % TIMEOUT_US;
+        }
+
+        if (!m_test.pairs[pair].active)
+        {
+            // One chain in 16 cut by the SoftDevice, some longer than a buffer.
+            chain_start(pair, (uint16_t)(1 + test_rand(&state) % CHAIN_LEN_MAX),
+                        (test_rand(&state) % 16 == 0) ? SCAN_REPORT_STATUS_TRUNCATED
+                                                      : SCAN_REPORT_STATUS_COMPLETE);
+            chains++;
+        }
+        (void)fragment_send(pair, now);
+
+        if (step % 16 == 0)
+        {
+            while (!scan_chain_flush(&m_chain, now, report_handler, &m_test))
+            {
+            }
+        }
+    }
+
+    // End the chains being sent, then give up on what is left.
+    for (uint32_t pair = 0; pair < pair_count; pair++)
+    {
+        while (m_test.pairs[pair].active)
+        {
+            (void)fragment_send(pair, ++now);
+        }
+    }
+    while (!scan_chain_flush(&m_chain, now + TIMEOUT_US, report_handler, &m_test))
+    {
+    }
+    CHECK(pool_empty());
+    CHECK_EQ(m_chain.truncated, m_test.truncated);
+
+    if (m_test.whole)
+    {
+        // Every chain once, whole if it fits a buffer and was not cut.
+        CHECK_EQ(m_test.reports, chains);
+        CHECK_EQ(m_test.partial, 0);
+        CHECK_EQ(m_chain.evictions, 0);
+        CHECK_EQ(m_chain.skipped, 0);
+        return;
+    }
+
+    CHECK(m_chain.evictions > 0);
+    CHECK(m_chain.skipped > 0);
+    CHECK(m_test.partial > 0);
+    CHECK(m_test.reports >= chains);
+}
+
+
+int main(void)
+{
+    test_limit();
+    test_truncated();
+    test_timeout();
+    test_reuse();
+    test_random(POOL_SIZE, false);
+    test_random(PAIRS_MAX, true);
+
+    return test_result("test_chain");
+}
@@ -0,0 +1,418 @@
+/***************************************************************************************/
+/*
+ * test_cmd
+ *
+ *  Command parser over a pseudo-terminal: scan_cmd and scan_output run in a thread
+ *  against the UARTE mock, wired to the master side, and the test writes raw bytes to
+ *  the slave side. Truncated frames, bad CRCs, unknown types and payloads longer than
+ *  SCANNER_CMD_MAX_LEN must not be carried out, must not keep the next commands from
+ *  being answered, and a command must be carried out exactly once per OK response,
+ *  also when the output is full as it comes.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sdk_common.h"
+#include "scan_cmd.h"
+#include "scan_decoder.h"
+#include "scan_output.h"
+#include "serial_port.h"
+#include "test.h"
+#include "test_sdk.h"
+
+#define FIRMWARE_RX_MAX     32                                          /**< Bytes received per main loop pass, less than the receive ring. */
+#define RSP_WAIT_MS         40                                          /**< Time given to the scanner to answer. */
+#define RSP_MAX             16
+#define CMD_APPLIED         SCAN_CMD_FILTER_ADD                         /**< Command the application carries out. */
+#define CMD_UNKNOWN         0x7E
+#define CMD_LEN             8                                           /**< Payload length of CMD_APPLIED. */
+
+/**@brief Responses read by @ref rsps_read. */
+typedef struct
+{
+    uint32_t       count;
+    scan_cmd_rsp_t rsp[RSP_MAX];
+} rsps_t;
+
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;              /**< Held by the firmware thread while it runs. */
+static volatile bool   m_stop;
+static uint32_t        m_applied;                                       /**< CMD_APPLIED carried out, under m_lock. */
+
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+/**@brief Main loop of the firmware, on the host time. */
+static void * firmware_run(void * p_context)
+{
+    while (!m_stop)
+    {
+        pthread_mutex_lock(&m_lock);
+        test_time_set(now_us());
+        test_timers_run();
+        test_uarte_pty_poll(FIRMWARE_RX_MAX);
+        scan_cmd_process();
+        scan_output_flush();
+        pthread_mutex_unlock(&m_lock);
+
+        usleep(100);
+    }
+
+    return NULL;
+}
+
+
+/**@brief Application commands: only CMD_APPLIED is known. */
+static uint8_t app_handler(uint8_t cmd, uint8_t const * p_payload, uint16_t len)
+{
+    if (cmd != CMD_APPLIED)
+    {
+        return SCAN_CMD_STATUS_UNSUPPORTED;
+    }
+    m_applied++;
+
+    return SCAN_CMD_STATUS_OK;
+}
+
+
+static uint32_t applied_get(void)
+{
+    uint32_t applied;
+
+    pthread_mutex_lock(&m_lock);
+    applied = m_applied;
+    pthread_mutex_unlock(&m_lock);
+
+    return applied;
+}
+
+
+static void rsp_handler(scan_record_t const * p_record, void * p_context)
+{
+    rsps_t * p_rsps = p_context;
+
+    if ((p_record->type == SCAN_FRAME_TYPE_CMD_RSP) && (p_record->len == sizeof(scan_cmd_rsp_t)) &&
+        (p_rsps->count < RSP_MAX))
+    {
+        memcpy(&p_rsps->rsp[p_rsps->count++], p_record->p_payload, sizeof(scan_cmd_rsp_t));
+    }
+}
+
+
+/**@brief Function for reading the port for a while, keeping the command responses. */
+static void rsps_read(int fd, uint32_t ms, rsps_t * p_rsps)
+{
+    static scan_decoder_t decoder;
+    uint64_t              end = now_us() + (uint64_t)ms * 1000;
+    uint8_t               buf[256];
+
+    memset(p_rsps, 0, sizeof(*p_rsps));
+    scan_decoder_init(&decoder, rsp_handler, p_rsps);
+
+    for (uint64_t now = now_us(); now < end; now = now_us())
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t       n;
+
+        if (poll(&pfd, 1, (int)((end - now) / 1000) + 1) <= 0)
+        {
+            continue;
+        }
+        n = read(fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            scan_decoder_feed(&decoder, buf, (size_t)n);
+        }
+    }
+}
+
+
+static void bytes_write(int fd, uint8_t const * p_data, size_t len)
+{
+    size_t done = 0;
+
+    while (done < len)
+    {
+        ssize_t n = write(fd, &p_data[done], len - done);
+
+        if (n < 0)
+        {
+            if ((errno == EINTR) || (errno == EAGAIN))
+            {
+                continue;
+            }
+            CHECK(false);
+            return;
+        }
+        done += (size_t)n;
+    }
+    tcdrain(fd);
+}
+
+
+/**@brief Function for encoding a command, with @p len bytes of payload counting from @p seed. */
+static size_t cmd_build(uint8_t type, uint16_t len, uint8_t seed, uint8_t * p_frame, size_t size)
+{
+    uint8_t payload[SCANNER_CMD_MAX_LEN + 16];
+    size_t  frame_len;
+
+    CHECK(len <= sizeof(payload));
+    for (uint16_t i = 0; i < len; i++)
+    {
+        payload[i] = (uint8_t)(seed + i);
+    }
+    frame_len = scan_frame_build(type, payload, len, p_frame, size);
+    CHECK(frame_len > 0);
+
+    return frame_len;
+}
+
+
+/**@brief Function for sending CMD_APPLIED until it is answered.
+ *
+ * @return Commands sent before the answer, 0 if none was answered after @p tries.
+ */
+static uint32_t cmd_retry(int fd, uint32_t tries)
+{
+    uint8_t frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t  frame_len = cmd_build(CMD_APPLIED, CMD_LEN, 0, frame, sizeof(frame));
+
+    for (uint32_t sent = 1; sent <= tries; sent++)
+    {
+        uint32_t applied = applied_get();
+        rsps_t   rsps;
+
+        bytes_write(fd, frame, frame_len);
+        rsps_read(fd, RSP_WAIT_MS, &rsps);
+
+        // Carried out once per response.
+        CHECK(rsps.count <= 1);
+        CHECK_EQ(applied_get() - applied, rsps.count);
+        if (rsps.count > 0)
+        {
+            CHECK_EQ(rsps.rsp[0].cmd, CMD_APPLIED);
+            CHECK_EQ(rsps.rsp[0].status, SCAN_CMD_STATUS_OK);
+            return sent;
+        }
+    }
+
+    return 0;
+}
+
+
+/**@brief A command is answered and carried out, an unknown one is answered UNSUPPORTED. */
+static void test_command(int fd)
+{
+    uint8_t  frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t   frame_len = cmd_build(CMD_UNKNOWN, 3, 0, frame, sizeof(frame));
+    uint32_t applied   = applied_get();
+    rsps_t   rsps;
+
+    CHECK_EQ(cmd_retry(fd, 1), 1);
+
+    bytes_write(fd, frame, frame_len);
+    rsps_read(fd, RSP_WAIT_MS, &rsps);
+    CHECK_EQ(rsps.count, 1);
+    CHECK_EQ(rsps.rsp[0].cmd, CMD_UNKNOWN);
+    CHECK_EQ(rsps.rsp[0].status, SCAN_CMD_STATUS_UNSUPPORTED);
+    CHECK_EQ(applied_get(), applied + 1);
+}
+
+
+/**@brief A frame with a bad CRC is dropped, whichever byte is wrong, and the next one answered. */
+static void test_bad_crc(int fd)
+{
+    uint8_t frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t  frame_len = cmd_build(CMD_APPLIED, CMD_LEN, 0x10, frame, sizeof(frame));
+
+    // The SOF is not covered by the CRC, and a wrong length is another test.
+    for (size_t i = 1; i < frame_len; i++)
+    {
+        uint32_t applied = applied_get();
+        rsps_t   rsps;
+
+        if ((i == 2) || (i == 3))
+        {
+            continue;
+        }
+        frame[i] ^= 0x01;
+        bytes_write(fd, frame, frame_len);
+        frame[i] ^= 0x01;
+
+        rsps_read(fd, RSP_WAIT_MS, &rsps);
+        CHECK_EQ(rsps.count, 0);
+        CHECK_EQ(applied_get(), applied);
+        CHECK_EQ(cmd_retry(fd, 1), 1);
+    }
+}
+
+
+/**@brief A payload longer than SCANNER_CMD_MAX_LEN is dropped at its length. */
+static void test_oversized(int fd)
+{
+    uint8_t  frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    uint16_t lens[] = { SCANNER_CMD_MAX_LEN + 1, SCANNER_CMD_MAX_LEN + 16 };
+    uint32_t applied = applied_get();
+    rsps_t   rsps;
+
+    // Payload bytes below 0xA5 and no SOF in the CRC: the parser skips them all.
+    for (uint32_t i = 0; i < ARRAY_LEN(lens); i++)
+    {
+        size_t frame_len = cmd_build(CMD_APPLIED, lens[i], 0, frame, sizeof(frame));
+
+        CHECK(frame[frame_len - 2] != SCAN_FRAME_SOF);
+        CHECK(frame[frame_len - 1] != SCAN_FRAME_SOF);
+        bytes_write(fd, frame, frame_len);
+        rsps_read(fd, RSP_WAIT_MS, &rsps);
+        CHECK_EQ(rsps.count, 0);
+        CHECK_EQ(applied_get(), applied);
+        CHECK_EQ(cmd_retry(fd, 1), 1);
+        applied++;
+    }
+
+    // The header alone: the parser does not wait for 64 KiB.
+    frame[0] = SCAN_FRAME_SOF;
+    frame[1] = CMD_APPLIED;
+    frame[2] = 0xFF;
+    frame[3] = 0xFF;
+    bytes_write(fd, frame, SCAN_FRAME_HEADER_LEN);
+    CHECK_EQ(cmd_retry(fd, 1), 1);
+}
+
+
+/**@brief After a frame cut anywhere, the commands sent again are answered once the parser resyncs. */
+static void test_truncated(int fd)
+{
+    uint8_t  frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t   frame_len = cmd_build(CMD_APPLIED, CMD_LEN, 0x20, frame, sizeof(frame));
+    uint32_t tries_max = 1 + (SCANNER_CMD_MAX_LEN + SCAN_FRAME_OVERHEAD) / frame_len + 1;
+    uint32_t lost      = 0;
+
+    // A longer frame cut short too, which swallows the next ones into its payload.
+    uint8_t long_frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    size_t  long_len = cmd_build(CMD_APPLIED, SCANNER_CMD_MAX_LEN, 0x20, long_frame, sizeof(long_frame));
+
+    for (size_t cut = 1; cut < frame_len; cut++)
+    {
+        uint32_t applied = applied_get();
+        uint32_t sent;
+        rsps_t   rsps;
+
+        bytes_write(fd, frame, cut);
+        rsps_read(fd, RSP_WAIT_MS / 2, &rsps);
+        CHECK_EQ(rsps.count, 0);
+        CHECK_EQ(applied_get(), applied);
+
+        sent = cmd_retry(fd, tries_max);
+        CHECK(sent > 0);
+        lost += (sent > 1);
+    }
+
+    for (size_t cut = SCAN_FRAME_HEADER_LEN; cut < long_len; cut += 7)
+    {
+        bytes_write(fd, long_frame, cut);
+        CHECK(cmd_retry(fd, tries_max) > 0);
+    }
+
+    // Most cuts lose the command that follows.
+    CHECK(lost > 0);
+}
+
+
+/**@brief A command that comes while the output is full is not carried out, it is answered BUSY later. */
+static void test_busy(int fd)
+{
+    uint8_t  frame[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD];
+    uint8_t  filler[SCAN_FRAME_MAX_PAYLOAD];
+    size_t   frame_len = cmd_build(CMD_APPLIED, CMD_LEN, 0x30, frame, sizeof(frame));
+    uint32_t applied   = applied_get();
+    rsps_t   rsps;
+
+    // Both buffers full, not even an empty frame fits.
+    memset(filler, 0, sizeof(filler));
+    pthread_mutex_lock(&m_lock);
+    test_uarte_tx_hold(true);
+    while (scan_output_send(SCAN_FRAME_TYPE_ALIVE, filler, sizeof(filler), NULL, 0) == NRF_SUCCESS)
+    {
+    }
+    while (scan_output_send(SCAN_FRAME_TYPE_ALIVE, NULL, 0, NULL, 0) == NRF_SUCCESS)
+    {
+    }
+    CHECK(!scan_output_has_room(sizeof(scan_cmd_rsp_t)));
+    pthread_mutex_unlock(&m_lock);
+
+    bytes_write(fd, frame, frame_len);
+    rsps_read(fd, RSP_WAIT_MS, &rsps);
+    CHECK_EQ(rsps.count, 0);
+    CHECK_EQ(applied_get(), applied);
+
+    // Once the host lets the scanner send, the command is refused.
+    pthread_mutex_lock(&m_lock);
+    test_uarte_tx_hold(false);
+    pthread_mutex_unlock(&m_lock);
+    rsps_read(fd, 4 * RSP_WAIT_MS, &rsps);
+    CHECK_EQ(rsps.count, 1);
+    CHECK_EQ(rsps.rsp[0].cmd, CMD_APPLIED);
+    CHECK_EQ(rsps.rsp[0].status, SCAN_CMD_STATUS_BUSY);
+    CHECK_EQ(applied_get(), applied);
+
+    // Sent again, it is carried out.
+    CHECK_EQ(cmd_retry(fd, 1), 1);
+}
+
+
+int main(void)
+{
+    pthread_t firmware;
+    int       master;
+    int       slave;
+    int       fd;
+    rsps_t    rsps;
+
+    if (openpty(&master, &slave, NULL, NULL, NULL) != 0)
+    {
+        perror("openpty");
+        return EXIT_FAILURE;
+    }
+    fd = serial_port_open(ttyname(slave), SCANNER_UART_BAUDRATE, O_RDWR);
+    if (fd < 0)
+    {
+        perror("serial_port_open");
+        return EXIT_FAILURE;
+    }
+
+    test_uarte_pty_set(master, slave);
+    test_time_set(now_us());
+    CHECK_EQ(scan_output_init(), NRF_SUCCESS);
+    CHECK_EQ(scan_cmd_init(app_handler), NRF_SUCCESS);
+    CHECK(pthread_create(&firmware, NULL, firmware_run, NULL) == 0);
+
+    // The HELLO sent at startup.
+    rsps_read(fd, RSP_WAIT_MS, &rsps);
+
+    test_command(fd);
+    test_bad_crc(fd);
+    test_oversized(fd);
+    test_truncated(fd);
+    test_busy(fd);
+
+    m_stop = true;
+    pthread_join(firmware, NULL);
+
+    return test_result("test_cmd");
+}
@@ -0,0 +1,488 @@
+/***************************************************************************************/
+/*
+ * test_col
+ *
+ *  Block compression and columnar capture files.
+ *
+ *  scan_lz: round trips over short inputs, below MATCH_LIMIT, where everything is a
+ *  literal, over incompressible, all-repeated and structured data, and matches
+ *  further back than an offset reaches. Decompression must refuse every truncation
+ *  of a block, offsets before the start of the output and a wrong output length,
+ *  and random corruptions may fail but never write past the output, which is
+ *  allocated to its exact length with the address sanitizer on.
+ *
+ *  scan_col: reports written in small chunks, each address seen over a few chunks
+ *  only, with a reboot of the scanner clock. Queries by address, by time range and
+ *  by both must give the reports a plain scan of the input gives, in order and byte
+ *  for byte, while reading fewer chunks than the file has. A copy of the file cut in
+ *  its last chunk, without its footer, must give the reports of the chunks before.
+ *
+ *  scan_lz.c is included, so it is built with the flags of the test.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_lz.c"
+#include "scan_col.h"
+#include "test.h"
+
+#define CORRUPTIONS     20000
+#define CHUNK_REPORTS   128
+#define REPORTS         (CHUNK_REPORTS * 40 + 77)                       /**< The last chunk is not full. */
+#define REBOOT_AT       3000                                            /**< Report after which the clock starts again. */
+#define ADDR_SPAN       40                                              /**< Reports before the addresses move on. */
+#define DATA_MAX        31
+
+/**@brief A report of the input. */
+typedef struct
+{
+    uint16_t len;
+    uint8_t  payload[sizeof(scan_report_hdr_t) + DATA_MAX];
+} report_t;
+
+/**@brief Reports handed over by a query. */
+typedef struct
+{
+    uint32_t count;
+    bool     same;                                                      /**< Equal to the expected ones so far. */
+    uint32_t expected_count;
+    uint32_t expected[REPORTS];                                         /**< Indexes of the input reports. */
+} result_t;
+
+static report_t m_reports[REPORTS];
+
+
+/**@brief Function for compressing and decompressing a block.
+ *
+ * @return Length of the compressed block.
+ */
+static size_t lz_round_trip(uint8_t const * p_data, size_t len)
+{
+    size_t    bound = SCAN_LZ_BOUND(len);
+    uint8_t * p_lz  = malloc(bound);
+    uint8_t * p_out = malloc(len + 1);
+    size_t    lz_len;
+
+    lz_len = scan_lz_compress(p_data, len, p_lz, bound);
+    CHECK(lz_len > 0);
+    CHECK(lz_len <= bound);
+    CHECK_EQ(scan_lz_decompress(p_lz, lz_len, p_out, len), 0);
+    CHECK(memcmp(p_out, p_data, len) == 0);
+
+    free(p_lz);
+    free(p_out);
+
+    return lz_len;
+}
+
+
+static void test_lz_round_trip(void)
+{
+    static uint8_t data[1 << 20];
+    uint32_t       state = 3;
+    size_t         lz_len;
+
+    // Too short for a match: one token and the literals.
+    for (size_t len = 0; len <= MATCH_LIMIT + 4; len++)
+    {
+        memset(data, 0xAB, len);
+        lz_len = lz_round_trip(data, len);
+        if (len <= MATCH_LIMIT)
+        {
+            CHECK_EQ(lz_len, len + 1);
+        }
+        for (size_t i = 0; i < len; i++)
+        {
+            data[i] = (uint8_t)test_rand(&state);
+        }
+        lz_round_trip(data, len);
+    }
+
+    // Incompressible: no larger than the bound, and does not fit in its own length.
+    for (size_t i = 0; i < 100000; i++)
+    {
+        data[i] = (uint8_t)test_rand(&state);
+    }
+    lz_len = lz_round_trip(data, 100000);
+    CHECK(lz_len >= 100000);
+    {
+        uint8_t * p_lz = malloc(100000 + 16);
+
+        memset(&p_lz[100000], 0x5A, 16);
+        CHECK_EQ(scan_lz_compress(data, 100000, p_lz, 100000), 0);
+        for (int i = 0; i < 16; i++)
+        {
+            CHECK_EQ(p_lz[100000 + i], 0x5A);
+        }
+        free(p_lz);
+    }
+
+    // All repeated: long matches, overlapping what they write.
+    memset(data, 0x42, sizeof(data));
+    CHECK(lz_round_trip(data, sizeof(data)) < sizeof(data) / 200);
+
+    // A random block seen again further back than an offset reaches, then within reach.
+    for (size_t i = 0; i < 4096; i++)
+    {
+        data[i] = (uint8_t)test_rand(&state);
+    }
+    memset(&data[4096], 0, MAX_OFFSET + 100);
+    memcpy(&data[4096 + MAX_OFFSET + 100], data, 4096);
+    memcpy(&data[2 * 4096 + MAX_OFFSET + 100], data, 4096);
+    lz_round_trip(data, 3 * 4096 + MAX_OFFSET + 100);
+
+    // Records of a column: short runs and repeats at every distance.
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (test_rand(&state) % 8 == 0) ? (uint8_t)test_rand(&state) : data[(i >= 64) ? i - 1 - (i % 61) : 0];
+    }
+    CHECK(lz_round_trip(data, sizeof(data)) < sizeof(data));
+}
+
+
+static void test_lz_refused(void)
+{
+    // "abcd", then a match of 4 at the offset of the case, then "e".
+    uint8_t  block[]  = { 0x40, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x10, 'e' };
+    uint8_t  out[16];
+    uint8_t  data[4096];
+    uint8_t  lz[SCAN_LZ_BOUND(sizeof(data))];
+    size_t   lz_len;
+    uint32_t state = 11;
+
+    CHECK_EQ(scan_lz_decompress(block, sizeof(block), out, 9), 0);
+    CHECK(memcmp(out, "abcdabcde", 9) == 0);
+
+    // Before the start of the output, or no offset at all.
+    block[5] = 5;
+    CHECK_EQ(scan_lz_decompress(block, sizeof(block), out, 9), -1);
+    block[5] = 0;
+    CHECK_EQ(scan_lz_decompress(block, sizeof(block), out, 9), -1);
+    block[5] = 0x00;
+    block[6] = 0x01;
+    CHECK_EQ(scan_lz_decompress(block, sizeof(block), out, 9), -1);
+
+    // Every truncation of a block, and an output of the wrong length.
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (i % 100 < 60) ? (uint8_t)(i % 7) : (uint8_t)test_rand(&state);
+    }
+    lz_len = scan_lz_compress(data, sizeof(data), lz, sizeof(lz));
+    CHECK((lz_len > 0) && (lz_len < sizeof(data)));
+    for (size_t len = 0; len < lz_len; len++)
+    {
+        uint8_t * p_cut = malloc(len + 1);
+        uint8_t * p_out = malloc(sizeof(data));
+
+        memcpy(p_cut, lz, len);
+        CHECK_EQ(scan_lz_decompress(p_cut, len, p_out, sizeof(data)), -1);
+        free(p_cut);
+        free(p_out);
+    }
+    {
+        static uint8_t out_data[sizeof(data) + 1];
+
+        CHECK_EQ(scan_lz_decompress(lz, lz_len, out_data, sizeof(data) - 1), -1);
+        CHECK_EQ(scan_lz_decompress(lz, lz_len, out_data, sizeof(data) + 1), -1);
+    }
+
+    // Corruptions: each read and write stays in the exact buffers.
+    for (uint32_t n = 0; n < CORRUPTIONS; n++)
+    {
+        uint8_t * p_bad = malloc(lz_len);
+        uint8_t * p_out = malloc(sizeof(data));
+        uint32_t  flips = 1 + test_rand(&state) % 4;
+
+        memcpy(p_bad, lz, lz_len);
+        for (uint32_t i = 0; i < flips; i++)
+        {
+            p_bad[test_rand(&state) % lz_len] ^= (uint8_t)(1 + test_rand(&state) % 255);
+        }
+        (void)scan_lz_decompress(p_bad, lz_len, p_out, sizeof(data));
+        free(p_bad);
+        free(p_out);
+    }
+}
+
+
+/**@brief Function for building the input: each address seen over a few chunks, the
+ *        clock starting again from 0 once.
+ */
+static void reports_build(void)
+{
+    uint32_t state = 5;
+    uint64_t time  = 1000000;
+
+    for (uint32_t n = 0; n < REPORTS; n++)
+    {
+        report_t        * p_report = &m_reports[n];
+        scan_report_hdr_t hdr;
+        uint32_t          addr_id  = n / ADDR_SPAN + test_rand(&state) % 4;
+
+        time = (n == REBOOT_AT) ? 500 : time + 200 + test_rand(&state) % 2000;
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.timestamp_us  = time;
+        hdr.addr[0]       = (uint8_t)addr_id;
+        hdr.addr[1]       = (uint8_t)(addr_id >> 8);
+        hdr.addr[2]       = 0x5C;
+        hdr.addr[5]       = 0xC0;
+        hdr.addr_type     = (uint8_t)(test_rand(&state) % 2);
+        hdr.flags         = (uint8_t)test_rand(&state);
+        hdr.rssi          = (int8_t)(-30 - test_rand(&state) % 70);
+        hdr.tx_power      = (int8_t)((test_rand(&state) % 4 == 0) ? SCAN_REPORT_TX_POWER_INVALID : -4);
+        hdr.primary_phy   = (uint8_t)(1 + test_rand(&state) % 2);
+        hdr.secondary_phy = (uint8_t)(test_rand(&state) % 3);
+        hdr.ch_index      = (uint8_t)(test_rand(&state) % 40);
+        hdr.set_id        = (uint8_t)test_rand(&state);
+        hdr.data_id       = (uint16_t)(test_rand(&state) & 0x0FFF);
+        hdr.data_len      = (uint16_t)(test_rand(&state) % (DATA_MAX + 1));
+
+        memcpy(p_report->payload, &hdr, sizeof(hdr));
+        for (uint16_t i = 0; i < hdr.data_len; i++)
+        {
+            p_report->payload[sizeof(hdr) + i] = (uint8_t)((i < 4) ? addr_id : test_rand(&state));
+        }
+        p_report->len = (uint16_t)(sizeof(hdr) + hdr.data_len);
+    }
+}
+
+
+static bool report_match(report_t const * p_report, scan_col_query_t const * p_query)
+{
+    scan_report_hdr_t hdr;
+
+    memcpy(&hdr, p_report->payload, sizeof(hdr));
+
+    return (!p_query->by_addr || (memcmp(hdr.addr, p_query->addr, sizeof(hdr.addr)) == 0)) &&
+           (hdr.timestamp_us >= p_query->t_min) && (hdr.timestamp_us <= p_query->t_max);
+}
+
+
+/**@brief Function for finding the time range of a chunk of the input. */
+static void chunk_range(uint32_t chunk, uint64_t * p_low, uint64_t * p_high)
+{
+    uint32_t first = chunk * CHUNK_REPORTS;
+
+    *p_low  = UINT64_MAX;
+    *p_high = 0;
+    for (uint32_t n = first; (n < first + CHUNK_REPORTS) && (n < REPORTS); n++)
+    {
+        uint64_t time;
+
+        memcpy(&time, m_reports[n].payload, sizeof(time));
+        *p_low  = (time < *p_low) ? time : *p_low;
+        *p_high = (time > *p_high) ? time : *p_high;
+    }
+}
+
+
+/**@brief Function for counting the chunks with reports in a time range. */
+static uint32_t chunks_in_range(uint64_t t_min, uint64_t t_max)
+{
+    uint32_t chunks = 0;
+
+    for (uint32_t chunk = 0; chunk * CHUNK_REPORTS < REPORTS; chunk++)
+    {
+        uint64_t low;
+        uint64_t high;
+
+        chunk_range(chunk, &low, &high);
+        chunks += ((high >= t_min) && (low <= t_max)) ? 1 : 0;
+    }
+
+    return chunks;
+}
+
+
+static void result_handler(scan_record_t const * p_record, void * p_context)
+{
+    result_t * p_result = p_context;
+
+    if (p_result->count < p_result->expected_count)
+    {
+        report_t const * p_report = &m_reports[p_result->expected[p_result->count]];
+
+        p_result->same = p_result->same && (p_record->type == SCAN_FRAME_TYPE_ADV_REPORT) &&
+                         (p_record->len == p_report->len) &&
+                         (memcmp(p_record->p_payload, p_report->payload, p_report->len) == 0);
+    }
+    p_result->count++;
+}
+
+
+/**@brief Function for running a query, checking it against a scan of the input.
+ *
+ * @param[in]   reports     Reports of the input in the file.
+ *
+ * @return Chunks read.
+ */
+static uint32_t query_check(scan_col_reader_t * p_reader, scan_col_query_t const * p_query, uint32_t reports)
+{
+    static result_t        result;
+    scan_col_query_stats_t stats;
+
+    memset(&result, 0, sizeof(result));
+    result.same = true;
+    for (uint32_t n = 0; n < reports; n++)
+    {
+        if (report_match(&m_reports[n], p_query))
+        {
+            result.expected[result.expected_count++] = n;
+        }
+    }
+
+    CHECK_EQ(scan_col_query(p_reader, p_query, result_handler, &result, &stats), 0);
+    CHECK_EQ(result.count, result.expected_count);
+    CHECK(result.same);
+    CHECK_EQ(stats.reports, result.expected_count);
+    CHECK_EQ(stats.chunks, (reports + CHUNK_REPORTS - 1) / CHUNK_REPORTS);
+
+    return stats.chunks_read;
+}
+
+
+static void test_col(char const * p_path, char const * p_cut_path)
+{
+    scan_col_writer_t * p_writer;
+    scan_col_reader_t * p_reader;
+    scan_col_query_t    query  = { .t_min = 0, .t_max = UINT64_MAX };
+    uint32_t            chunks = (REPORTS + CHUNK_REPORTS - 1) / CHUNK_REPORTS;
+    uint32_t            full   = REPORTS / CHUNK_REPORTS;
+    scan_record_t       record = { .type = SCAN_FRAME_TYPE_ALIVE };
+    uint8_t             alive[8] = { 0 };
+    uint32_t            read;
+
+    reports_build();
+
+    CHECK_EQ(scan_col_writer_open(&p_writer, p_path, CHUNK_REPORTS), 0);
+    for (uint32_t n = 0; n < REPORTS; n++)
+    {
+        scan_record_t report = { .type = SCAN_FRAME_TYPE_ADV_REPORT, .len = m_reports[n].len,
+                                 .p_payload = m_reports[n].payload };
+
+        CHECK_EQ(scan_col_writer_add(p_writer, &report), 0);
+
+        // Other records are left out.
+        if (n % 1000 == 0)
+        {
+            record.len       = sizeof(alive);
+            record.p_payload = alive;
+            CHECK_EQ(scan_col_writer_add(p_writer, &record), 0);
+        }
+    }
+    CHECK_EQ(scan_col_writer_close(p_writer), 0);
+
+    CHECK_EQ(scan_col_reader_open(&p_reader, p_path), 0);
+
+    // The footer: reports and time range of each chunk.
+    {
+        scan_col_index_t const * p_index;
+
+        CHECK_EQ(scan_col_reader_index(p_reader, &p_index), chunks);
+        for (uint32_t chunk = 0; chunk < chunks; chunk++)
+        {
+            uint64_t low;
+            uint64_t high;
+
+            chunk_range(chunk, &low, &high);
+            CHECK_EQ(p_index[chunk].hdr.reports, (chunk < full) ? CHUNK_REPORTS : REPORTS % CHUNK_REPORTS);
+            CHECK_EQ(p_index[chunk].hdr.t_min, low);
+            CHECK_EQ(p_index[chunk].hdr.t_max, high);
+        }
+    }
+
+    // Everything.
+    CHECK_EQ(query_check(p_reader, &query, REPORTS), chunks);
+
+    // An address: the chunks of its reports, and those the filter lets through.
+    query.by_addr = true;
+    memcpy(query.addr, m_reports[2000].payload + offsetof(scan_report_hdr_t, addr), sizeof(query.addr));
+    read = query_check(p_reader, &query, REPORTS);
+    CHECK((read >= 1) && (read <= 6));
+
+    // An address never seen.
+    query.addr[5] = 0x3F;
+    CHECK(query_check(p_reader, &query, REPORTS) <= 2);
+
+    // A time range, before the reboot, and after it too.
+    query.by_addr = false;
+    memcpy(&query.t_min, m_reports[1000].payload, sizeof(query.t_min));
+    memcpy(&query.t_max, m_reports[1500].payload, sizeof(query.t_max));
+    read = query_check(p_reader, &query, REPORTS);
+    CHECK_EQ(read, chunks_in_range(query.t_min, query.t_max));
+    CHECK(read < chunks / 2);
+
+    // From the last report of a chunk to the first of another: both chunks at their edge,
+    // and those after the reboot which go over the same times.
+    memcpy(&query.t_min, m_reports[3 * CHUNK_REPORTS - 1].payload, sizeof(query.t_min));
+    memcpy(&query.t_max, m_reports[5 * CHUNK_REPORTS].payload, sizeof(query.t_max));
+    CHECK_EQ(query_check(p_reader, &query, REPORTS), chunks_in_range(query.t_min, query.t_max));
+
+    // Both: an address seen in the range, then one seen outside of it.
+    query.by_addr = true;
+    memcpy(query.addr, m_reports[1200].payload + offsetof(scan_report_hdr_t, addr), sizeof(query.addr));
+    CHECK(query_check(p_reader, &query, REPORTS) <= 6);
+    memcpy(query.addr, m_reports[200].payload + offsetof(scan_report_hdr_t, addr), sizeof(query.addr));
+    CHECK(query_check(p_reader, &query, REPORTS) <= 2);
+
+    scan_col_reader_close(p_reader);
+
+    // Cut in the last full chunk: the footer is gone, the chunks are walked, the cut one is left out.
+    {
+        scan_col_index_t const * p_index;
+        FILE                   * p_in;
+        FILE                   * p_out;
+        uint64_t                 cut;
+
+        CHECK_EQ(scan_col_reader_open(&p_reader, p_path), 0);
+        CHECK_EQ(scan_col_reader_index(p_reader, &p_index), chunks);
+        cut = p_index[full - 1].offset + 100;
+        scan_col_reader_close(p_reader);
+
+        p_in  = fopen(p_path, "rb");
+        p_out = fopen(p_cut_path, "wb");
+        CHECK((p_in != NULL) && (p_out != NULL));
+        for (uint64_t i = 0; i < cut; i++)
+        {
+            fputc(fgetc(p_in), p_out);
+        }
+        fclose(p_in);
+        fclose(p_out);
+
+        CHECK_EQ(scan_col_reader_open(&p_reader, p_cut_path), 0);
+        query.by_addr = false;
+        query.t_min   = 0;
+        query.t_max   = UINT64_MAX;
+        CHECK_EQ(query_check(p_reader, &query, (full - 1) * CHUNK_REPORTS), full - 1);
+        scan_col_reader_close(p_reader);
+    }
+}
+
+
+int main(void)
+{
+    char path[]     = "/tmp/test_col_XXXXXX";
+    char cut_path[] = "/tmp/test_col_cut_XXXXXX";
+    int  fd         = mkstemp(path);
+    int  cut_fd     = mkstemp(cut_path);
+
+    if ((fd < 0) || (cut_fd < 0))
+    {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    close(cut_fd);
+
+    test_lz_round_trip();
+    test_lz_refused();
+    test_col(path, cut_path);
+
+    unlink(path);
+    unlink(cut_path);
+
+    return test_result("test_col");
+}
@@ -0,0 +1,312 @@
+/***************************************************************************************/
+/*
+ * test_dedup
+ *
+ *  Duplicate suppression table: the check results, the 3/4 fill limit, the
+ *  summaries, and the expiry of the silent advertisers. The table is small and the
+ *  advertisers are picked so their keys land on a few neighbouring entries, across
+ *  the end of the table, so the probe sequences are long and the backward shift
+ *  deletion has to move entries on every removal. A model of the table checks every
+ *  advertiser after each sweep.
+ *
+ *  scan_dedup.c is included, so the test can read the entries.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_dedup.c"
+#include "test.h"
+
+#define CAPACITY        16
+#define POOL_SIZE       40                                              /**< Advertisers of the random run, more than the table holds. */
+#define STEPS           200000
+#define EXPIRY_US       20000
+#define SUMMARY_US      5000
+
+SCAN_DEDUP_DEF(m_dedup, CAPACITY);
+
+/**@brief Advertiser of the random run, and what the table must know about it. */
+typedef struct
+{
+    scan_report_hdr_t hdr;
+    uint8_t           data[4];
+    bool              tracked;
+    uint64_t          last_seen_us;
+} advertiser_t;
+
+static advertiser_t m_pool[POOL_SIZE];
+
+
+static void hdr_make(scan_report_hdr_t * p_hdr, uint32_t id)
+{
+    memset(p_hdr, 0, sizeof(*p_hdr));
+    memcpy(p_hdr->addr, &id, sizeof(id));
+    p_hdr->addr[5]   = 0xC0;
+    p_hdr->addr_type = 1;
+    p_hdr->set_id    = SCAN_REPORT_SET_ID_INVALID;
+    p_hdr->rssi      = -60;
+}
+
+
+static uint32_t home(scan_report_hdr_t const * p_hdr)
+{
+    return key_hash(p_hdr) & (CAPACITY - 1);
+}
+
+
+static bool is_tracked(scan_report_hdr_t const * p_hdr)
+{
+    return m_dedup.p_entries[entry_find(&m_dedup, p_hdr, key_hash(p_hdr))].key_hash != 0;
+}
+
+
+/**@brief Function for checking that every entry can be reached from its home entry. */
+static void probe_check(void)
+{
+    uint32_t count = 0;
+
+    for (uint32_t idx = 0; idx < CAPACITY; idx++)
+    {
+        uint32_t hash = m_dedup.p_entries[idx].key_hash;
+
+        if (hash == 0)
+        {
+            continue;
+        }
+        count++;
+        for (uint32_t i = hash & (CAPACITY - 1); i != idx; i = (i + 1) & (CAPACITY - 1))
+        {
+            CHECK(m_dedup.p_entries[i].key_hash != 0);
+        }
+    }
+    CHECK_EQ(count, m_dedup.count);
+}
+
+
+static bool alive_count(scan_alive_t const * p_alive, void * p_context)
+{
+    (*(uint32_t *)p_context)++;
+    return true;
+}
+
+
+static bool alive_refuse(scan_alive_t const * p_alive, void * p_context)
+{
+    return false;
+}
+
+
+static bool alive_keep(scan_alive_t const * p_alive, void * p_context)
+{
+    *(scan_alive_t *)p_context = *p_alive;
+    return true;
+}
+
+
+/**@brief Check results of one advertiser, and what tells advertisers apart. */
+static void test_check(void)
+{
+    scan_report_hdr_t hdr;
+    scan_report_hdr_t other;
+    uint8_t           data[] = { 0x02, 0x01, 0x06 };
+
+    scan_dedup_init(&m_dedup, 0, EXPIRY_US);
+    hdr_make(&hdr, 1);
+    hdr.data_len = sizeof(data);
+
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_NEW);
+    // Not recorded, as when the output refused the report.
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_NEW);
+    scan_dedup_record(&m_dedup, &hdr, data);
+    CHECK_EQ(m_dedup.count, 1);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_DUPLICATE);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_DUPLICATE);
+    CHECK_EQ(m_dedup.duplicates, 2);
+
+    data[2] = 0x04;
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_CHANGED);
+    scan_dedup_record(&m_dedup, &hdr, data);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, data), SCAN_DEDUP_DUPLICATE);
+    CHECK_EQ(m_dedup.count, 1);
+
+    // Scan responses, other SIDs and other address types are other advertisers.
+    other = hdr;
+    other.flags |= SCAN_REPORT_FLAG_SCAN_RESPONSE;
+    CHECK_EQ(scan_dedup_check(&m_dedup, &other, data), SCAN_DEDUP_NEW);
+    other = hdr;
+    other.set_id = 3;
+    CHECK_EQ(scan_dedup_check(&m_dedup, &other, data), SCAN_DEDUP_NEW);
+    other = hdr;
+    other.addr_type = 0;
+    CHECK_EQ(scan_dedup_check(&m_dedup, &other, data), SCAN_DEDUP_NEW);
+
+    // Fragments are neither checked nor recorded.
+    other = hdr;
+    other.flags |= 1 << SCAN_REPORT_FLAG_STATUS_Pos;
+    CHECK_EQ(scan_dedup_check(&m_dedup, &other, data), SCAN_DEDUP_UNTRACKED);
+    scan_dedup_record(&m_dedup, &other, data);
+    CHECK_EQ(m_dedup.count, 1);
+}
+
+
+/**@brief The table takes 3/4 of its capacity, then reports go through untracked. */
+static void test_full(void)
+{
+    scan_report_hdr_t hdr;
+    uint8_t           data = 0;
+
+    scan_dedup_init(&m_dedup, 0, EXPIRY_US);
+
+    for (uint32_t id = 0; id < MAX_COUNT(&m_dedup); id++)
+    {
+        hdr_make(&hdr, 100 + id);
+        CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, &data), SCAN_DEDUP_NEW);
+        scan_dedup_record(&m_dedup, &hdr, &data);
+    }
+    CHECK_EQ(m_dedup.count, CAPACITY * 3 / 4);
+
+    hdr_make(&hdr, 99);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, &data), SCAN_DEDUP_UNTRACKED);
+    scan_dedup_record(&m_dedup, &hdr, &data);
+    CHECK_EQ(m_dedup.count, CAPACITY * 3 / 4);
+    CHECK_EQ(m_dedup.untracked, 1);
+
+    // The ones in the table are still recognised.
+    hdr_make(&hdr, 100);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, &data), SCAN_DEDUP_DUPLICATE);
+    probe_check();
+}
+
+
+/**@brief Summaries of the dropped reports, and a handler that refuses one. */
+static void test_summary(void)
+{
+    scan_report_hdr_t hdr;
+    scan_alive_t      alive;
+    uint8_t           data = 0;
+    uint32_t          count = 0;
+
+    scan_dedup_init(&m_dedup, SUMMARY_US, EXPIRY_US);
+    hdr_make(&hdr, 7);
+    hdr.timestamp_us = 1000;
+    scan_dedup_record(&m_dedup, &hdr, &data);
+
+    // No duplicate, no summary.
+    CHECK(scan_dedup_sweep(&m_dedup, 1000 + SUMMARY_US, alive_count, &count));
+    CHECK_EQ(count, 0);
+
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        hdr.timestamp_us = 1000 + i * 1000;
+        hdr.rssi         = (int8_t)(-60 - i);
+        CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, &data), SCAN_DEDUP_DUPLICATE);
+    }
+    CHECK(scan_dedup_sweep(&m_dedup, 1000 + SUMMARY_US - 1, alive_count, &count));
+    CHECK_EQ(count, 0);
+
+    // Refused: the sweep stops, and the summary comes again.
+    CHECK(!scan_dedup_sweep(&m_dedup, 1000 + SUMMARY_US, alive_refuse, NULL));
+    CHECK(scan_dedup_sweep(&m_dedup, 1000 + SUMMARY_US, alive_keep, &alive));
+    CHECK_EQ(alive.count, 3);
+    CHECK_EQ(alive.rssi, -63);
+    CHECK_EQ(alive.timestamp_us, 4000);
+    CHECK_EQ(alive.set_id, SCAN_REPORT_SET_ID_INVALID);
+    CHECK(memcmp(alive.addr, hdr.addr, sizeof(alive.addr)) == 0);
+
+    // Once sent, not again until new duplicates.
+    CHECK(scan_dedup_sweep(&m_dedup, 1000 + 2 * SUMMARY_US, alive_count, &count));
+    CHECK_EQ(count, 0);
+
+    // Silent long enough, forgotten.
+    CHECK(scan_dedup_sweep(&m_dedup, 4000 + EXPIRY_US, alive_count, &count));
+    CHECK_EQ(m_dedup.count, 0);
+    CHECK_EQ(scan_dedup_check(&m_dedup, &hdr, &data), SCAN_DEDUP_NEW);
+}
+
+
+/**@brief Random reports and sweeps of advertisers that collide, checked against a model. */
+static void test_collisions(void)
+{
+    uint32_t state   = 1;
+    uint32_t count   = 0;
+    uint32_t removed = 0;
+    uint64_t now     = 0;
+
+    // Advertisers whose home is one of the last two entries or the first two.
+    for (uint32_t id = 0, n = 0; n < POOL_SIZE; id++)
+    {
+        hdr_make(&m_pool[n].hdr, id);
+        if (((home(&m_pool[n].hdr) + 2) & (CAPACITY - 1)) < 4)
+        {
+            m_pool[n].data[0] = (uint8_t)n;
+            m_pool[n].hdr.data_len = sizeof(m_pool[n].data);
+            m_pool[n].tracked = false;
+            n++;
+        }
+    }
+
+    scan_dedup_init(&m_dedup, SUMMARY_US, EXPIRY_US);
+
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        advertiser_t      * p_adv = &m_pool[test_rand(&state) % POOL_SIZE];
+        scan_dedup_result_t result;
+
+        now += 1 + test_rand(&state) % 1000;
+        p_adv->hdr.timestamp_us = now;
+        result = scan_dedup_check(&m_dedup, &p_adv->hdr, p_adv->data);
+
+        if (p_adv->tracked)
+        {
+            CHECK_EQ(result, SCAN_DEDUP_DUPLICATE);
+            p_adv->last_seen_us = now;
+        }
+        else
+        {
+            CHECK_EQ(result, (count < MAX_COUNT(&m_dedup)) ? SCAN_DEDUP_NEW : SCAN_DEDUP_UNTRACKED);
+            scan_dedup_record(&m_dedup, &p_adv->hdr, p_adv->data);
+            if (result == SCAN_DEDUP_NEW)
+            {
+                p_adv->tracked      = true;
+                p_adv->last_seen_us = now;
+                count++;
+            }
+        }
+
+        if (test_rand(&state) % 8 == 0)
+        {
+            uint32_t alive = 0;
+
+            CHECK(scan_dedup_sweep(&m_dedup, now, alive_count, &alive));
+
+            for (uint32_t i = 0; i < POOL_SIZE; i++)
+            {
+                if (m_pool[i].tracked && (now - m_pool[i].last_seen_us >= EXPIRY_US))
+                {
+                    m_pool[i].tracked = false;
+                    count--;
+                    removed++;
+                }
+                CHECK_EQ(is_tracked(&m_pool[i].hdr), m_pool[i].tracked);
+            }
+            CHECK_EQ(m_dedup.count, count);
+            probe_check();
+        }
+    }
+
+    // Both the full table and the removals were exercised.
+    CHECK(m_dedup.untracked > 0);
+    CHECK(removed > STEPS / 100);
+}
+
+
+int main(void)
+{
+    test_check();
+    test_full();
+    test_summary();
+    test_collisions();
+
+    return test_result("test_dedup");
+}
@@ -0,0 +1,293 @@
+/***************************************************************************************/
+/*
+ * test_filter
+ *
+ *  Verdicts of the report filters on extended advertising chains. The first fragment
+ *  of a chain is judged on the data it holds: it must reject or keep the chain when
+ *  that data decides, and keep it undecided when the company ID or the data bytes a
+ *  filter looks for would only come in a later fragment, for scan_filter_match to
+ *  judge the reassembled report. Chains that differ only by address type, SID or scan
+ *  response are interleaved and each must keep its own verdict; a chain that went
+ *  silent for the timeout, or was cut by a scan restart, must not pass its verdict on
+ *  to the next chain of the same advertiser.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_filter.h"
+#include "test.h"
+
+#define TIMEOUT_US      200000
+#define FRAGMENT_LEN    8
+
+SCAN_FILTER_DEF(m_filter, 4);
+
+/** Advertising data of the chains, in two fragments of FRAGMENT_LEN bytes. */
+static uint8_t const m_data_late[2 * FRAGMENT_LEN] =                    /**< The company ID in the second fragment. */
+{
+    0x07, 0x09, 'b', 'e', 'a', 'c', 'o', 'n',
+    0x05, 0xFF, 0x59, 0x00, 0x01, 0x02, 0x00, 0x00,
+};
+static uint8_t const m_data_early[2 * FRAGMENT_LEN] =                   /**< The company ID in the first fragment. */
+{
+    0x05, 0xFF, 0x59, 0x00, 0x01, 0x02, 0x07, 0x09,
+    'b', 'e', 'a', 'c', 'o', 'n', 0x00, 0x00,
+};
+static uint8_t const m_data_none[2 * FRAGMENT_LEN] =                    /**< Another company. */
+{
+    0x07, 0x09, 'b', 'e', 'a', 'c', 'o', 'n',
+    0x05, 0xFF, 0x4C, 0x00, 0x01, 0x02, 0x00, 0x00,
+};
+
+
+/**@brief Function for getting a fragment of a chain.
+ *
+ * @param[in]   index       Fragment, 0 or 1. The second one is the last.
+ */
+static scan_filter_report_t fragment(uint8_t const * p_addr, uint8_t const * p_data, uint32_t index, uint64_t now_us)
+{
+    scan_filter_report_t report =
+    {
+        .timestamp_us = now_us,
+        .p_addr       = p_addr,
+        .addr_type    = 1,
+        .p_data       = &p_data[index * FRAGMENT_LEN],
+        .len          = FRAGMENT_LEN,
+        .rssi         = -60,
+        .set_id       = 3,
+        .extended     = true,
+        .status       = (index == 0) ? SCAN_REPORT_STATUS_MORE_DATA : SCAN_REPORT_STATUS_COMPLETE,
+    };
+
+    return report;
+}
+
+
+/**@brief Function for getting a chain reassembled, as main.c judges it again. */
+static scan_filter_report_t whole(uint8_t const * p_addr, uint8_t const * p_data)
+{
+    scan_filter_report_t report = fragment(p_addr, p_data, 0, 0);
+
+    report.p_data = p_data;
+    report.len    = 2 * FRAGMENT_LEN;
+    report.status = SCAN_REPORT_STATUS_COMPLETE;
+
+    return report;
+}
+
+
+static void filters_set(uint8_t mode, scan_filter_rule_t const * p_rules, uint32_t count)
+{
+    CHECK(scan_filter_clear(&m_filter, mode));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CHECK(scan_filter_add(&m_filter, &p_rules[i]));
+    }
+    scan_filter_chains_reset(&m_filter, TIMEOUT_US);
+}
+
+
+/**@brief Function for checking the verdicts on the company ID, in either mode. */
+static void test_company(void)
+{
+    static uint8_t const     addr[6]   = { 1, 2, 3, 4, 5, 0xC0 };
+    static uint8_t const     mode[]    = { SCAN_FILTER_MODE_ANY, SCAN_FILTER_MODE_ALL };
+    scan_filter_rule_t const rule      = { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x59, 0x00 } };
+    uint64_t                 now       = 0;
+
+    for (uint32_t m = 0; m < ARRAY_LEN(mode); m++)
+    {
+        scan_filter_report_t report;
+        uint32_t             undecided;
+        uint32_t             rejected;
+
+        filters_set(mode[m], &rule, 1);
+
+        // In the first fragment: decided, with the next fragment.
+        undecided = m_filter.undecided;
+        report    = fragment(addr, m_data_early, 0, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        report    = fragment(addr, m_data_early, 1, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        CHECK_EQ(m_filter.undecided, undecided);
+        report    = whole(addr, m_data_early);
+        CHECK(scan_filter_match(&m_filter, &report));
+
+        // In the second fragment: kept undecided, then judged whole.
+        report    = fragment(addr, m_data_late, 0, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        CHECK_EQ(m_filter.undecided, undecided + 1);
+        report    = fragment(addr, m_data_late, 1, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        report    = whole(addr, m_data_late);
+        CHECK(scan_filter_match(&m_filter, &report));
+
+        // Nowhere: kept undecided as well, rejected whole.
+        rejected  = m_filter.rejected;
+        report    = fragment(addr, m_data_none, 0, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        report    = fragment(addr, m_data_none, 1, now += 1000);
+        CHECK(scan_filter_check(&m_filter, &report));
+        CHECK_EQ(m_filter.rejected, rejected);
+        report    = whole(addr, m_data_none);
+        CHECK(!scan_filter_match(&m_filter, &report));
+
+        // A legacy report has no more data to come.
+        report          = whole(addr, m_data_late);
+        report.extended = false;
+        report.len      = FRAGMENT_LEN;
+        CHECK(!scan_filter_check(&m_filter, &report));
+    }
+}
+
+
+/**@brief Function for checking the verdicts of the first fragment with address and data
+ *        byte filters.
+ */
+static void test_first_fragment(void)
+{
+    static uint8_t const     addr_in[6]  = { 1, 2, 3, 4, 5, 0xC0 };
+    static uint8_t const     addr_out[6] = { 1, 2, 3, 4, 5, 0xD0 };
+    scan_filter_rule_t const prefix      = { .type = SCAN_FILTER_ADDR_PREFIX, .len = 1, .value = { 0xC0 } };
+    scan_filter_rule_t       rules[2];
+    scan_filter_report_t     report;
+    uint32_t                 rejected;
+    uint32_t                 undecided   = m_filter.undecided;
+    uint64_t                 now         = 0;
+
+    // Data bytes of the first fragment decide.
+    rules[0]          = prefix;
+    rules[1]          = (scan_filter_rule_t){ .type = SCAN_FILTER_DATA, .len = 2, .offset = 2 };
+    rules[1].value[0] = 'b';
+    rules[1].value[1] = 'e';
+    memset(rules[1].mask, 0xFF, sizeof(rules[1].mask));
+    filters_set(SCAN_FILTER_MODE_ALL, rules, 2);
+
+    rejected = m_filter.rejected;
+    report   = fragment(addr_in, m_data_none, 0, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    report   = fragment(addr_in, m_data_none, 1, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    report   = fragment(addr_in, m_data_early, 0, now += 1000);
+    CHECK(!scan_filter_check(&m_filter, &report));
+    report   = fragment(addr_in, m_data_early, 1, now += 1000);
+    CHECK(!scan_filter_check(&m_filter, &report));
+    CHECK_EQ(m_filter.rejected, rejected + 2);
+    CHECK_EQ(m_filter.undecided, undecided);
+
+    // Data bytes past the first fragment: undecided, unless the address decides.
+    rules[1].offset   = FRAGMENT_LEN + 2;
+    rules[1].value[0] = 0x59;
+    rules[1].value[1] = 0x00;
+    filters_set(SCAN_FILTER_MODE_ALL, rules, 2);
+
+    report = fragment(addr_out, m_data_late, 0, now += 1000);
+    CHECK(!scan_filter_check(&m_filter, &report));
+    report = fragment(addr_out, m_data_late, 1, now += 1000);
+    CHECK(!scan_filter_check(&m_filter, &report));
+    CHECK_EQ(m_filter.undecided, undecided);
+    report = fragment(addr_in, m_data_late, 0, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    CHECK_EQ(m_filter.undecided, undecided + 1);
+    report = fragment(addr_in, m_data_late, 1, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    report = whole(addr_in, m_data_late);
+    CHECK(scan_filter_match(&m_filter, &report));
+    report = whole(addr_in, m_data_none);
+    CHECK(!scan_filter_match(&m_filter, &report));
+
+    // In ANY mode the address keeps the chain at once.
+    filters_set(SCAN_FILTER_MODE_ANY, rules, 2);
+    report = fragment(addr_in, m_data_none, 0, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    report = fragment(addr_out, m_data_none, 0, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+    CHECK_EQ(m_filter.undecided, undecided + 2);
+}
+
+
+/**@brief Function for checking that interleaved chains of one advertiser keep their
+ *        own verdicts, and that no verdict outlives its chain. The chains rejected are
+ *        those whose first fragment is under the RSSI floor; the next fragments are
+ *        above it and must still be rejected.
+ */
+static void test_interleaved(void)
+{
+    static uint8_t const     addr[6]  = { 1, 2, 3, 4, 5, 0xC0 };
+    scan_filter_rule_t const rules[2] =
+    {
+        { .type = SCAN_FILTER_COMPANY_ID, .len = 2, .value = { 0x59, 0x00 } },
+        { .type = SCAN_FILTER_RSSI_MIN,   .len = 1, .value = { (uint8_t)-70 } },
+    };
+    scan_filter_report_t     report;
+    uint32_t                 undecided = m_filter.undecided;
+    uint64_t                 now       = 0;
+
+    filters_set(SCAN_FILTER_MODE_ANY, rules, 2);
+
+    // Every chain of the advertiser at once, kept and rejected in turns.
+    for (uint32_t i = 0; i < SCAN_FILTER_CHAIN_COUNT; i++)
+    {
+        report           = fragment(addr, m_data_early, 0, now += 1000);
+        report.addr_type = (uint8_t)(i & 1);
+        report.scan_rsp  = (i & 2) != 0;
+        report.set_id    = (uint8_t)(i >> 2);
+        report.rssi      = (i & 1) ? -80 : -60;
+        CHECK_EQ(scan_filter_check(&m_filter, &report), (i & 1) == 0);
+    }
+    CHECK_EQ(m_filter.undecided, undecided);
+
+    for (uint32_t i = SCAN_FILTER_CHAIN_COUNT; i > 0; i--)
+    {
+        report           = fragment(addr, m_data_none, 1, now += 1000);
+        report.addr_type = (uint8_t)((i - 1) & 1);
+        report.scan_rsp  = ((i - 1) & 2) != 0;
+        report.set_id    = (uint8_t)((i - 1) >> 2);
+        report.status    = (i % 3 == 0) ? SCAN_REPORT_STATUS_TRUNCATED : SCAN_REPORT_STATUS_COMPLETE;
+        CHECK_EQ(scan_filter_check(&m_filter, &report), ((i - 1) & 1) == 0);
+    }
+
+    // A rejected chain that goes silent: the next one after the timeout is judged anew.
+    report      = fragment(addr, m_data_early, 0, now += 1000);
+    report.rssi = -80;
+    CHECK(!scan_filter_check(&m_filter, &report));
+    report = fragment(addr, m_data_early, 0, now += TIMEOUT_US - 1);
+    CHECK(!scan_filter_check(&m_filter, &report));
+    report = fragment(addr, m_data_early, 0, now += TIMEOUT_US);
+    CHECK(scan_filter_check(&m_filter, &report));
+
+    // Cut by a scan restart.
+    report      = fragment(addr, m_data_early, 0, now += TIMEOUT_US);
+    report.rssi = -80;
+    CHECK(!scan_filter_check(&m_filter, &report));
+    scan_filter_chains_reset(&m_filter, TIMEOUT_US);
+    report = fragment(addr, m_data_early, 0, now += 1000);
+    CHECK(scan_filter_check(&m_filter, &report));
+
+    // More chains than followed: the one silent for the longest time is forgotten.
+    scan_filter_chains_reset(&m_filter, TIMEOUT_US);
+    for (uint32_t i = 0; i <= SCAN_FILTER_CHAIN_COUNT; i++)
+    {
+        report        = fragment(addr, m_data_early, 0, now += 1000);
+        report.rssi   = -80;
+        report.set_id = (uint8_t)i;
+        CHECK(!scan_filter_check(&m_filter, &report));
+    }
+    report        = fragment(addr, m_data_early, 0, now += 1000);
+    report.set_id = 0;
+    CHECK(scan_filter_check(&m_filter, &report));
+    report        = fragment(addr, m_data_early, 0, now += 1000);
+    report.set_id = SCAN_FILTER_CHAIN_COUNT;
+    CHECK(!scan_filter_check(&m_filter, &report));
+}
+
+
+int main(void)
+{
+    test_company();
+    test_first_fragment();
+    test_interleaved();
+
+    return test_result("test_filter");
+}
@@ -0,0 +1,284 @@
+/***************************************************************************************/
+/*
+ * test_frame
+ *
+ *  Round trip of the frame format: frames built by scan_frame_build, fed to the
+ *  decoder whole, byte by byte and in random chunks, with corrupted frames and noise
+ *  in between.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_decoder.h"
+#include "test.h"
+
+#define STREAM_SIZE     (1 << 20)
+#define FRAMES_MAX      4096
+
+/**@brief A frame written into the test stream, and what the decoder must give back. */
+typedef struct
+{
+    uint8_t  type;
+    uint16_t len;
+    size_t   offset;                                                    /**< Offset of the payload in the stream. */
+    bool     corrupt;                                                   /**< A payload byte was flipped, the frame must be dropped. */
+} frame_t;
+
+typedef struct
+{
+    frame_t const * p_frames;
+    uint8_t const * p_stream;
+    size_t          count;
+    size_t          next;                                               /**< Next frame expected. */
+} expect_t;
+
+static uint8_t m_stream[STREAM_SIZE];
+static frame_t m_frames[FRAMES_MAX];
+
+
+static void expect_handler(scan_record_t const * p_record, void * p_context)
+{
+    expect_t * p_expect = p_context;
+
+    while ((p_expect->next < p_expect->count) && p_expect->p_frames[p_expect->next].corrupt)
+    {
+        p_expect->next++;
+    }
+    CHECK(p_expect->next < p_expect->count);
+    if (p_expect->next >= p_expect->count)
+    {
+        return;
+    }
+
+    frame_t const * p_frame = &p_expect->p_frames[p_expect->next++];
+
+    CHECK_EQ(p_record->type, p_frame->type);
+    CHECK_EQ(p_record->len, p_frame->len);
+    CHECK((p_record->len == p_frame->len) &&
+          (memcmp(p_record->p_payload, &p_expect->p_stream[p_frame->offset], p_frame->len) == 0));
+}
+
+
+/**@brief Function for filling the stream with frames of every length class, noise and corruption.
+ *
+ * @return Length of the stream.
+ */
+static size_t stream_make(uint32_t seed, bool noise, bool corrupt, size_t * p_count)
+{
+    static const uint16_t lengths[] = { 0, 1, 2, 25, 31, 255, 256, 1650, SCAN_FRAME_MAX_PAYLOAD };
+    uint8_t               payload[SCAN_FRAME_MAX_PAYLOAD];
+    size_t                len   = 0;
+    size_t                count = 0;
+
+    while (count < FRAMES_MAX)
+    {
+        uint16_t plen = (count < 2 * ARRAY_LEN(lengths)) ? lengths[count % ARRAY_LEN(lengths)]
+                                                         : (uint16_t)(test_rand(&seed) % 300);
+        size_t   flen;
+
+        if (len + plen + SCAN_FRAME_OVERHEAD + 16 > sizeof(m_stream))
+        {
+            break;
+        }
+
+        // Noise between frames, false markers included.
+        if (noise && (test_rand(&seed) % 4 == 0))
+        {
+            uint32_t n = 1 + test_rand(&seed) % 8;
+
+            for (uint32_t i = 0; i < n; i++)
+            {
+                m_stream[len++] = (test_rand(&seed) % 3 == 0) ? SCAN_FRAME_SOF : (uint8_t)test_rand(&seed);
+            }
+        }
+
+        for (uint16_t i = 0; i < plen; i++)
+        {
+            payload[i] = (i % 7 == 0) ? SCAN_FRAME_SOF : (uint8_t)test_rand(&seed);
+        }
+
+        m_frames[count].type    = (uint8_t)(1 + test_rand(&seed) % 8);
+        m_frames[count].len     = plen;
+        m_frames[count].offset  = len + SCAN_FRAME_HEADER_LEN;
+        m_frames[count].corrupt = false;
+
+        flen = scan_frame_build(m_frames[count].type, payload, plen, &m_stream[len], sizeof(m_stream) - len);
+        CHECK_EQ(flen, plen + SCAN_FRAME_OVERHEAD);
+
+        if (corrupt && (plen > 0) && (test_rand(&seed) % 16 == 0))
+        {
+            m_stream[m_frames[count].offset + test_rand(&seed) % plen] ^= 0x10;
+            m_frames[count].corrupt = true;
+        }
+
+        len += flen;
+        count++;
+    }
+
+    *p_count = count;
+    return len;
+}
+
+
+static size_t corrupt_count(size_t count)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        n += m_frames[i].corrupt;
+    }
+
+    return n;
+}
+
+
+/**@brief Function for decoding the stream, split into chunks of at most @p chunk_max bytes (0: random). */
+static void stream_decode(size_t len, size_t count, size_t chunk_max, uint32_t seed)
+{
+    static scan_decoder_t decoder;
+    expect_t              expect = { .p_frames = m_frames, .p_stream = m_stream, .count = count };
+    size_t                done   = 0;
+
+    scan_decoder_init(&decoder, expect_handler, &expect);
+
+    while (done < len)
+    {
+        size_t chunk = (chunk_max != 0) ? chunk_max : 1 + test_rand(&seed) % 700;
+
+        if (chunk > len - done)
+        {
+            chunk = len - done;
+        }
+        scan_decoder_feed(&decoder, &m_stream[done], chunk);
+        done += chunk;
+    }
+    scan_decoder_flush(&decoder);
+
+    while ((expect.next < count) && m_frames[expect.next].corrupt)
+    {
+        expect.next++;
+    }
+    CHECK_EQ(expect.next, count);
+    CHECK_EQ(decoder.frames, count - corrupt_count(count));
+    CHECK(decoder.crc_errors >= corrupt_count(count));
+}
+
+
+static void test_crc(void)
+{
+    static const uint8_t check[] = "123456789";
+    uint16_t             crc;
+
+    // CRC-16/CCITT-FALSE check value.
+    CHECK_EQ(scan_crc16(check, 9, NULL), 0x29B1);
+
+    // Chaining gives the same CRC as one pass.
+    crc = scan_crc16(check, 4, NULL);
+    CHECK_EQ(scan_crc16(&check[4], 5, &crc), 0x29B1);
+    for (size_t split = 0; split <= 9; split++)
+    {
+        crc = scan_crc16(check, split, NULL);
+        CHECK_EQ(scan_crc16(&check[split], 9 - split, &crc), 0x29B1);
+    }
+}
+
+
+static void test_build_limits(void)
+{
+    static uint8_t payload[SCAN_FRAME_MAX_PAYLOAD + 1];
+    static uint8_t out[SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD + 1];
+
+    CHECK_EQ(scan_frame_build(1, payload, SCAN_FRAME_MAX_PAYLOAD, out, sizeof(out)),
+             SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD);
+    CHECK_EQ(scan_frame_build(1, payload, SCAN_FRAME_MAX_PAYLOAD + 1, out, sizeof(out)), 0);
+    CHECK_EQ(scan_frame_build(1, payload, 10, out, 10 + SCAN_FRAME_OVERHEAD - 1), 0);
+    CHECK_EQ(scan_frame_build(1, NULL, 0, out, SCAN_FRAME_OVERHEAD), SCAN_FRAME_OVERHEAD);
+
+    // Header layout: SOF, type, little endian length.
+    CHECK_EQ(scan_frame_build(0x42, payload, 0x123, out, sizeof(out)), 0x123 + SCAN_FRAME_OVERHEAD);
+    CHECK_EQ(out[0], SCAN_FRAME_SOF);
+    CHECK_EQ(out[1], 0x42);
+    CHECK_EQ(out[2], 0x23);
+    CHECK_EQ(out[3], 0x01);
+}
+
+
+/**@brief A frame whose length exceeds the largest payload is noise, the decoder resyncs behind it. */
+static void test_oversized(void)
+{
+    static scan_decoder_t decoder;
+    uint8_t               stream[64];
+    uint8_t               payload[4] = { 1, 2, 3, 4 };
+    size_t                len;
+    expect_t              expect;
+    frame_t               frame = { .type = 7, .len = sizeof(payload), .offset = 0 };
+
+    stream[0] = SCAN_FRAME_SOF;
+    stream[1] = 1;
+    stream[2] = (uint8_t)((SCAN_FRAME_MAX_PAYLOAD + 1) & 0xFF);
+    stream[3] = (uint8_t)((SCAN_FRAME_MAX_PAYLOAD + 1) >> 8);
+    len = 4;
+    frame.offset = len + SCAN_FRAME_HEADER_LEN;
+    len += scan_frame_build(frame.type, payload, sizeof(payload), &stream[len], sizeof(stream) - len);
+
+    expect = (expect_t){ .p_frames = &frame, .p_stream = stream, .count = 1 };
+    scan_decoder_init(&decoder, expect_handler, &expect);
+    scan_decoder_feed(&decoder, stream, len);
+
+    CHECK_EQ(expect.next, 1);
+    CHECK_EQ(decoder.frames, 1);
+    CHECK_EQ(decoder.skipped, 4);
+}
+
+
+/**@brief A truncated frame at the end of the input yields nothing, the frames hidden behind it are still found. */
+static void test_truncated(void)
+{
+    static scan_decoder_t decoder;
+    uint8_t               stream[128];
+    uint8_t               payload[20];
+    size_t                len;
+    expect_t              expect;
+    frame_t               frame = { .type = 2, .len = 8 };
+
+    memset(payload, 0x11, sizeof(payload));
+    len = scan_frame_build(1, payload, sizeof(payload), stream, sizeof(stream)) - 5;
+    frame.offset = len + SCAN_FRAME_HEADER_LEN;
+    len += scan_frame_build(frame.type, payload, frame.len, &stream[len], sizeof(stream) - len);
+
+    expect = (expect_t){ .p_frames = &frame, .p_stream = stream, .count = 1 };
+    scan_decoder_init(&decoder, expect_handler, &expect);
+    scan_decoder_feed(&decoder, stream, len);
+    scan_decoder_flush(&decoder);
+
+    CHECK_EQ(expect.next, 1);
+    CHECK_EQ(decoder.frames, 1);
+    CHECK_EQ(decoder.fill, 0);
+}
+
+
+int main(void)
+{
+    size_t count;
+    size_t len;
+
+    test_crc();
+    test_build_limits();
+    test_oversized();
+    test_truncated();
+
+    len = stream_make(1, false, false, &count);
+    stream_decode(len, count, len, 0);
+    stream_decode(len, count, 1, 0);
+    stream_decode(len, count, 0, 7);
+
+    len = stream_make(2, true, true, &count);
+    CHECK(corrupt_count(count) > 0);
+    stream_decode(len, count, len, 0);
+    stream_decode(len, count, 1, 0);
+    stream_decode(len, count, 0, 11);
+
+    return test_result("test_frame");
+}
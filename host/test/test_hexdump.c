@@ -0,0 +1,316 @@
+/***************************************************************************************/
+/*
+ * test_hexdump
+ *
+ *  Text capture parser against hand-written captures: every kernel the processor has
+ *  must hand over the same records, those the lines hold. The capture mixes full and
+ *  short lines, "\r\n" and "\n" endings, log lines and hexdumps that are not reports
+ *  between the reports, a report longer than SCANNER_REPORT_DATA_MAX, one longer than
+ *  SCAN_HEXDUMP_DATA_MAX, and a last report not closed by its separator. Then every
+ *  character of a full line is replaced by every other byte, so that each check of
+ *  the vector kernels and each of their nibbles is seen at least once.
+*/
+/***************************************************************************************/
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan_hexdump.h"
+#include "sdk_config.h"
+#include "test.h"
+
+#define SEPARATOR       "----------------------------------"
+#define RECORDS_MAX     16
+#define TEXT_SIZE       (64 * 1024)
+#define LONG_LEN        (SCANNER_REPORT_DATA_MAX + 17)                  /**< Longer than the firmware keeps, still a report. */
+#define OVERSIZED_LEN   (SCAN_HEXDUMP_DATA_MAX + 8)                     /**< Dropped by the parser. */
+#define LINE            " 5a 3c 00 ff 12 e7 9b 40|Z<.....@"
+#define LINE_BAR        24                                              /**< Position of the '|'. */
+#define SWEEP_LINES     ((LINE_BAR + 1) * 255)
+
+/**@brief A report, as expected or as handed over. */
+typedef struct
+{
+    size_t  len;
+    uint8_t data[SCAN_HEXDUMP_DATA_MAX];
+} report_t;
+
+/**@brief Reports handed over by the parser. */
+typedef struct
+{
+    uint32_t count;
+    report_t reports[RECORDS_MAX];
+} reports_t;
+
+static char      m_text[TEXT_SIZE];
+static size_t    m_text_len;
+static reports_t m_expected;
+static char    * mp_sweep;                                              /**< Capture of the sweep. */
+static size_t    m_sweep_len;
+static size_t  * mp_sweep_lens;                                         /**< Data length of each report of the sweep. */
+static uint8_t * mp_sweep_data;                                         /**< Their data, 16 bytes each. */
+
+
+static void text_add(char const * p_line)
+{
+    size_t len = strlen(p_line);
+
+    CHECK(m_text_len + len <= sizeof(m_text));
+    memcpy(&m_text[m_text_len], p_line, len);
+    m_text_len += len;
+}
+
+
+/**@brief Function for adding a report the parser must hand over. */
+static void expected_add(uint8_t const * p_data, size_t len)
+{
+    report_t * p_report = &m_expected.reports[m_expected.count++];
+
+    p_report->len = len;
+    memcpy(p_report->data, p_data, len);
+}
+
+
+/**@brief Function for printing data the way NRF_LOG_RAW_HEXDUMP_INFO does. */
+static void hexdump_add(uint8_t const * p_data, size_t len, char const * p_eol)
+{
+    for (size_t line = 0; line < len; line += 8)
+    {
+        size_t count = (len - line < 8) ? len - line : 8;
+        char   text[64];
+        char * p     = text;
+
+        for (size_t i = 0; i < 8; i++)
+        {
+            p += (i < count) ? sprintf(p, " %02x", p_data[line + i]) : sprintf(p, "   ");
+        }
+        *p++ = '|';
+        for (size_t i = 0; i < count; i++)
+        {
+            char c = (char)p_data[line + i];
+
+            *p++ = ((c <= ' ') || (c > '~')) ? '.' : c;
+        }
+        strcpy(p, p_eol);
+        text_add(text);
+    }
+}
+
+
+static void report_handler(scan_record_t const * p_record, void * p_context)
+{
+    reports_t       * p_reports = p_context;
+    scan_report_hdr_t hdr;
+
+    CHECK_EQ(p_record->type, SCAN_FRAME_TYPE_ADV_REPORT);
+    CHECK(p_record->len >= sizeof(hdr));
+    memcpy(&hdr, p_record->p_payload, sizeof(hdr));
+    CHECK_EQ(p_record->len, sizeof(hdr) + hdr.data_len);
+    CHECK_EQ(hdr.tx_power, SCAN_REPORT_TX_POWER_INVALID);
+    CHECK_EQ(hdr.set_id, SCAN_REPORT_SET_ID_INVALID);
+
+    if ((p_reports->count < RECORDS_MAX) && (hdr.data_len <= SCAN_HEXDUMP_DATA_MAX))
+    {
+        report_t * p_report = &p_reports->reports[p_reports->count];
+
+        p_report->len = hdr.data_len;
+        memcpy(p_report->data, &p_record->p_payload[sizeof(hdr)], hdr.data_len);
+    }
+    p_reports->count++;
+}
+
+
+/**@brief Function for writing the capture and the reports it holds. */
+static void capture_build(void)
+{
+    static uint8_t long_data[OVERSIZED_LEN];
+    uint8_t const  full[]  = { 0x02, 0x01, 0x06, 0x1a, 0xff, 0x4c, 0x00, 0x02 };
+    uint8_t const  short_data[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0xaa, 0xfe, 0x11, 0x16, 0xaa, 0xfe, 0x10, 0x00 };
+    uint8_t const  counting[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    uint8_t const  last[]  = { 0x0a, 0x09, 0x53, 0x63, 0x61, 0x6e, 0x6e, 0x65 };
+    uint32_t       state   = 7;
+
+    // A full line, "\n".
+    text_add(" 02 01 06 1a ff 4c 00 02|.....L..\n");
+    text_add(SEPARATOR "\n");
+    expected_add(full, sizeof(full));
+
+    // A log line between two reports.
+    text_add("<info> app: Scanning started.\r\n");
+
+    // A short last line, upper case digits, "\r\n".
+    text_add(" 02 01 06 03 03 aa fe 11|........\r\n");
+    text_add(" 16 AA FE 10 00         |.....\r\n");
+    text_add(SEPARATOR "\r\n");
+    expected_add(short_data, sizeof(short_data));
+
+    // The hexdump of an ALIVE line, closed by the address.
+    text_add(" c0 ff ee 00 11 22      |.....\"\n");
+    text_add("alive -60 dBm, 3 duplicates\n");
+
+    // A line of the length of a full one that is not hexadecimal, alone then after a
+    // line of a report: the report goes on from the next line.
+    text_add(" 02 01 06 1a ff 4c 0g 02|.....L..\n");
+    text_add(" 01 02 03 04 05 06 07 08|........\n");
+    text_add(" 02 01 06 1a ff 4c 00 0x|.....L..\r\n");
+    text_add(" 01 02 03 04 05 06 07 08|........\n");
+    text_add(SEPARATOR "\n");
+    expected_add(counting, sizeof(counting));
+
+    // Longer than the firmware keeps, then longer than a frame holds.
+    for (size_t i = 0; i < sizeof(long_data); i++)
+    {
+        long_data[i] = (uint8_t)test_rand(&state);
+    }
+    hexdump_add(long_data, LONG_LEN, "\r\n");
+    text_add(SEPARATOR "\r\n");
+    expected_add(long_data, LONG_LEN);
+    hexdump_add(long_data, OVERSIZED_LEN, "\n");
+    text_add(SEPARATOR "\n");
+
+    text_add(" 0a 09 53 63 61 6e 6e 65|..Scanne\n");
+    text_add(SEPARATOR "\n");
+    expected_add(last, sizeof(last));
+
+    // Not closed, the last line without its end.
+    text_add(" 01 02 03 04 05 06 07 08|........\n");
+    text_add(" 01 02                  |..");
+}
+
+
+/**@brief Function for writing every line one character away from LINE, each followed
+ *        by LINE and the separator, and the reports they make.
+ */
+static void sweep_build(void)
+{
+    static uint8_t const bytes[] = { 0x5a, 0x3c, 0x00, 0xff, 0x12, 0xe7, 0x9b, 0x40 };
+    size_t               size    = SWEEP_LINES * (2 * sizeof(LINE) + sizeof(SEPARATOR) + 3);
+    size_t               count   = 0;
+
+    mp_sweep      = malloc(size);
+    mp_sweep_lens = malloc(SWEEP_LINES * sizeof(size_t));
+    mp_sweep_data = malloc(SWEEP_LINES * 16);
+    CHECK((mp_sweep != NULL) && (mp_sweep_lens != NULL) && (mp_sweep_data != NULL));
+    m_sweep_len = 0;
+
+    for (int pos = 0; pos <= LINE_BAR; pos++)
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            char      line[] = LINE;
+            uint8_t * p_data = &mp_sweep_data[count * 16];
+            bool      valid;
+
+            if (c == '\n')
+            {
+                continue;
+            }
+            line[pos] = (char)c;
+
+            // A digit may become any other, the rest must stay as it is.
+            if (pos % 3 == 0)
+            {
+                valid = (pos == LINE_BAR) ? (c == '|') : (c == ' ');
+            }
+            else
+            {
+                valid = isxdigit(c);
+            }
+
+            // Copied rather than printed, a NUL included.
+            memcpy(&mp_sweep[m_sweep_len], line, sizeof(line) - 1);
+            m_sweep_len += sizeof(line) - 1;
+            m_sweep_len += (size_t)sprintf(&mp_sweep[m_sweep_len], "\n%s\n%s\n", LINE, SEPARATOR);
+            if (valid)
+            {
+                memcpy(p_data, bytes, sizeof(bytes));
+                if (pos % 3 != 0)
+                {
+                    int     shift = (pos % 3 == 1) ? 4 : 0;
+                    uint8_t value = (uint8_t)strtol((char[]){ (char)c, '\0' }, NULL, 16);
+
+                    p_data[pos / 3] = (uint8_t)((p_data[pos / 3] & ~(0x0F << shift)) | (value << shift));
+                }
+                memcpy(&p_data[8], bytes, sizeof(bytes));
+                mp_sweep_lens[count] = 16;
+            }
+            else
+            {
+                memcpy(p_data, bytes, sizeof(bytes));
+                mp_sweep_lens[count] = 8;
+            }
+            count++;
+        }
+    }
+    CHECK_EQ(count, SWEEP_LINES);
+    CHECK(m_sweep_len < size);
+}
+
+
+/**@brief Function for checking the reports of the sweep against the expected ones. */
+static void sweep_handler(scan_record_t const * p_record, void * p_context)
+{
+    size_t          * p_count = p_context;
+    scan_report_hdr_t hdr;
+
+    memcpy(&hdr, p_record->p_payload, sizeof(hdr));
+    if (*p_count < SWEEP_LINES)
+    {
+        CHECK_EQ(hdr.data_len, mp_sweep_lens[*p_count]);
+        CHECK((hdr.data_len == mp_sweep_lens[*p_count]) &&
+              (memcmp(&p_record->p_payload[sizeof(hdr)], &mp_sweep_data[*p_count * 16], hdr.data_len) == 0));
+    }
+    (*p_count)++;
+}
+
+
+int main(void)
+{
+    scan_hexdump_kernel_t const kernels[] =
+    {
+        SCAN_HEXDUMP_KERNEL_AUTO, SCAN_HEXDUMP_KERNEL_SCALAR, SCAN_HEXDUMP_KERNEL_SSE2, SCAN_HEXDUMP_KERNEL_AVX2,
+    };
+    static reports_t reports;
+
+    capture_build();
+    sweep_build();
+
+    for (uint32_t k = 0; k < ARRAY_LEN(kernels); k++)
+    {
+        scan_hexdump_stats_t stats;
+
+        if (!scan_hexdump_kernel_supported(kernels[k]))
+        {
+            printf("test_hexdump: kernel %u not supported, skipped\n", kernels[k]);
+            continue;
+        }
+
+        memset(&reports, 0, sizeof(reports));
+        scan_hexdump_parse(m_text, m_text_len, kernels[k], report_handler, &reports, &stats);
+
+        CHECK_EQ(reports.count, m_expected.count);
+        for (uint32_t i = 0; (i < reports.count) && (i < m_expected.count); i++)
+        {
+            CHECK_EQ(reports.reports[i].len, m_expected.reports[i].len);
+            CHECK(memcmp(reports.reports[i].data, m_expected.reports[i].data, m_expected.reports[i].len) == 0);
+        }
+        CHECK_EQ(stats.records, m_expected.count);
+        CHECK_EQ(stats.oversized, 1);
+
+        // The log line, the ALIVE hexdump and its address, the line that is not
+        // hexadecimal, then it again with the line before it.
+        CHECK_EQ(stats.skipped_lines, 1 + 2 + 1 + 2);
+
+        size_t count = 0;
+
+        scan_hexdump_parse(mp_sweep, m_sweep_len, kernels[k], sweep_handler, &count, &stats);
+        CHECK_EQ(count, SWEEP_LINES);
+    }
+
+    free(mp_sweep);
+    free(mp_sweep_lens);
+    free(mp_sweep_data);
+
+    return test_result("test_hexdump");
+}
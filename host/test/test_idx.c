@@ -0,0 +1,478 @@
+/***************************************************************************************/
+/*
+ * test_idx
+ *
+ *  Index of a binary capture written in pieces, as scan_ingestd appends to it, with
+ *  an update after each piece. Pieces end anywhere: between frames, in the header of
+ *  a frame, in its payload and in noise between frames. The capture holds reports,
+ *  ALIVE and RSSI summary records, beacons and statistics, which are not indexed,
+ *  summaries dated back to their window and a restart of the scanner clock.
+ *
+ *  After each update, the records of the index must be those a decoder gives from
+ *  the capture up to its last whole frame. Once it is all written, lookups by
+ *  address, by time range and by both must give the records of a full decode, in
+ *  order and byte for byte, reading only the frames of their address when they have
+ *  one, and at the edges of the entries of the times. The capture is then cut in the middle of a frame and the index made again.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "scan_idx.h"
+#include "test.h"
+
+#define RECORDS         40000
+#define REBOOT_AT       24000                                           /**< Record from which the clock starts again. */
+#define ADDRESSES       200                                             /**< Advertisers heard all along. */
+#define PASSING_SPAN    500                                             /**< Records during which a passing advertiser is heard. */
+#define PASSING         (RECORDS / PASSING_SPAN)                        /**< Advertisers heard for a while only. */
+#define PIECES          13                                              /**< More than SCAN_IDX_SEGMENTS_MAX, to merge. */
+#define CAPTURE_SIZE    (RECORDS * (SCAN_FRAME_OVERHEAD + sizeof(scan_report_hdr_t) + 40))
+#define KEY_LEN         (sizeof(uint64_t) + 6)
+
+/**@brief Records of a decode, or of a lookup. */
+typedef struct
+{
+    uint32_t  count;
+    uint8_t   types[RECORDS];
+    uint16_t  lens[RECORDS];
+    uint32_t  offsets[RECORDS];                                         /**< Offsets of the payloads in the pool. */
+    uint8_t * p_pool;
+    uint32_t  pool_len;
+} records_t;
+
+static uint8_t  * m_capture;
+static uint32_t   m_capture_len;
+static uint32_t   m_frame_start[RECORDS];                               /**< Offsets of the frames in the capture. */
+static uint32_t   m_frame_end[RECORDS];
+static uint64_t   m_times[RECORDS];
+static records_t  m_decoded;
+static records_t  m_found;
+
+
+/**@brief Function for getting the address of an advertiser. */
+static void addr_get(uint32_t id, uint8_t * p_addr)
+{
+    p_addr[0] = (uint8_t)id;
+    p_addr[1] = (uint8_t)(id >> 8);
+    p_addr[2] = 0x33;
+    p_addr[3] = 0x22;
+    p_addr[4] = 0x11;
+    p_addr[5] = 0xC0;
+}
+
+
+/**@brief Function for appending a frame, after some noise now and then. */
+static void frame_append(uint32_t n, uint8_t type, void const * p_payload, uint16_t len, uint32_t * p_state)
+{
+    if (test_rand(p_state) % 50 == 0)
+    {
+        uint32_t noise = 1 + test_rand(p_state) % 20;
+
+        for (uint32_t i = 0; i < noise; i++)
+        {
+            uint8_t byte = (uint8_t)test_rand(p_state);
+
+            m_capture[m_capture_len++] = (byte == SCAN_FRAME_SOF) ? 0 : byte;
+        }
+    }
+    m_frame_start[n] = m_capture_len;
+    m_capture_len   += (uint32_t)scan_frame_build(type, p_payload, len, &m_capture[m_capture_len],
+                                                  CAPTURE_SIZE - m_capture_len);
+    m_frame_end[n]   = m_capture_len;
+}
+
+
+/**@brief Function for building the capture. */
+static void capture_build(void)
+{
+    uint32_t state = 9;
+    uint64_t time  = 1000000;
+
+    m_capture = malloc(CAPTURE_SIZE);
+    CHECK(m_capture != NULL);
+
+    for (uint32_t n = 0; n < RECORDS; n++)
+    {
+        uint8_t  payload[sizeof(scan_report_hdr_t) + 31];
+        uint8_t  addr[6];
+        uint32_t kind = test_rand(&state) % 20;
+
+        time       = (n == REBOOT_AT) ? 300 : time + 100 + test_rand(&state) % 800;
+        m_times[n] = time;
+        addr_get((test_rand(&state) % 4 == 0) ? ADDRESSES + n / PASSING_SPAN : test_rand(&state) % ADDRESSES, addr);
+
+        if (kind < 14)
+        {
+            scan_report_hdr_t hdr = { .timestamp_us = time, .addr_type = (uint8_t)(test_rand(&state) % 2),
+                                      .rssi = -60, .primary_phy = 1,
+                                      .data_len = (uint16_t)(test_rand(&state) % 32) };
+
+            memcpy(hdr.addr, addr, sizeof(hdr.addr));
+            memcpy(payload, &hdr, sizeof(hdr));
+            for (uint16_t i = 0; i < hdr.data_len; i++)
+            {
+                payload[sizeof(hdr) + i] = (uint8_t)test_rand(&state);
+            }
+            frame_append(n, SCAN_FRAME_TYPE_ADV_REPORT, payload, (uint16_t)(sizeof(hdr) + hdr.data_len), &state);
+        }
+        else if (kind < 16)
+        {
+            scan_alive_t alive = { .timestamp_us = time, .rssi = -70, .count = (uint16_t)test_rand(&state) };
+
+            memcpy(alive.addr, addr, sizeof(alive.addr));
+            frame_append(n, SCAN_FRAME_TYPE_ALIVE, &alive, sizeof(alive), &state);
+        }
+        else if (kind < 18)
+        {
+            // Dated back to the start of its window.
+            scan_rssi_summary_t summary = { .window_us = time - time % 1000000, .rssi_min = -80,
+                                            .rssi_max = -50, .rssi_mean = -65, .count = 10 };
+
+            m_times[n] = summary.window_us;
+            memcpy(summary.addr, addr, sizeof(summary.addr));
+            frame_append(n, SCAN_FRAME_TYPE_RSSI_SUMMARY, &summary, sizeof(summary), &state);
+        }
+        else if (kind < 19)
+        {
+            scan_beacon_hdr_t beacon = { .timestamp_us = time, .rssi = -55, .type = SCAN_BEACON_IBEACON };
+
+            memcpy(beacon.addr, addr, sizeof(beacon.addr));
+            memcpy(payload, &beacon, sizeof(beacon));
+            memset(&payload[sizeof(beacon)], 0x42, sizeof(scan_ibeacon_t));
+            frame_append(n, SCAN_FRAME_TYPE_BEACON, payload, (uint16_t)(sizeof(beacon) + sizeof(scan_ibeacon_t)), &state);
+        }
+        else
+        {
+            // Not an advertiser's: never indexed, even if it starts like one.
+            scan_stats_t stats;
+
+            memset(&stats, 0, sizeof(stats));
+            memcpy(&stats, &time, sizeof(time));
+            memcpy((uint8_t *)&stats + sizeof(time), addr, sizeof(addr));
+            frame_append(n, SCAN_FRAME_TYPE_STATS, &stats, sizeof(stats), &state);
+        }
+    }
+}
+
+
+static void records_handler(scan_record_t const * p_record, void * p_context)
+{
+    records_t * p_records = p_context;
+
+    if (p_records->count < RECORDS)
+    {
+        p_records->types[p_records->count]   = p_record->type;
+        p_records->lens[p_records->count]    = p_record->len;
+        p_records->offsets[p_records->count] = p_records->pool_len;
+        memcpy(&p_records->p_pool[p_records->pool_len], p_record->p_payload, p_record->len);
+        p_records->pool_len += p_record->len;
+    }
+    p_records->count++;
+}
+
+
+static void records_clear(records_t * p_records)
+{
+    p_records->count    = 0;
+    p_records->pool_len = 0;
+}
+
+
+/**@brief Function for decoding the capture up to a length, as a reader of the whole file would. */
+static void capture_decode(uint32_t len)
+{
+    scan_decoder_t decoder;
+
+    records_clear(&m_decoded);
+    scan_decoder_init(&decoder, records_handler, &m_decoded);
+    scan_decoder_feed(&decoder, m_capture, len);
+    scan_decoder_flush(&decoder);
+}
+
+
+/**@brief Function for telling if a decoded record matches a lookup, the same way the index does. */
+static bool decoded_match(uint32_t i, scan_idx_query_t const * p_query)
+{
+    uint8_t const * p_payload = &m_decoded.p_pool[m_decoded.offsets[i]];
+    uint64_t        time;
+
+    switch (m_decoded.types[i])
+    {
+        case SCAN_FRAME_TYPE_ADV_REPORT:
+        case SCAN_FRAME_TYPE_ALIVE:
+        case SCAN_FRAME_TYPE_RSSI_SUMMARY:
+        case SCAN_FRAME_TYPE_BEACON:
+            break;
+
+        default:
+            return false;
+    }
+    if (m_decoded.lens[i] < KEY_LEN)
+    {
+        return false;
+    }
+    memcpy(&time, p_payload, sizeof(time));
+
+    return (!p_query->by_addr || (memcmp(&p_payload[sizeof(time)], p_query->addr, sizeof(p_query->addr)) == 0)) &&
+           (time >= p_query->t_min) && (time <= p_query->t_max);
+}
+
+
+/**@brief Function for running a lookup, checking it against the decoded records.
+ *
+ * @return Frames of the capture read.
+ */
+static uint64_t lookup_check(scan_idx_t * p_idx, scan_idx_query_t const * p_query)
+{
+    scan_idx_lookup_stats_t stats;
+    uint32_t                expected = 0;
+
+    records_clear(&m_found);
+    CHECK_EQ(scan_idx_lookup(p_idx, p_query, records_handler, &m_found, &stats), 0);
+    CHECK_EQ(stats.records, m_found.count);
+
+    for (uint32_t i = 0; i < m_decoded.count; i++)
+    {
+        if (decoded_match(i, p_query))
+        {
+            bool same = (expected < m_found.count) &&
+                        (m_found.types[expected] == m_decoded.types[i]) &&
+                        (m_found.lens[expected] == m_decoded.lens[i]) &&
+                        (memcmp(&m_found.p_pool[m_found.offsets[expected]],
+                                &m_decoded.p_pool[m_decoded.offsets[i]], m_decoded.lens[i]) == 0);
+
+            if (!same)
+            {
+                fprintf(stderr, "record %u of the lookup differs\n", expected);
+                CHECK(same);
+                return stats.frames_read;
+            }
+            expected++;
+        }
+    }
+    CHECK_EQ(m_found.count, expected);
+
+    return stats.frames_read;
+}
+
+
+/**@brief Function for checking that the index holds the records of the capture up to a length. */
+static void index_check(char const * p_path, uint32_t len)
+{
+    scan_idx_query_t           all = { .t_min = 0, .t_max = UINT64_MAX };
+    scan_idx_segment_t const * p_segments;
+    scan_idx_t               * p_idx;
+    uint32_t                   whole = 0;
+
+    // The index stops at the end of the last whole frame.
+    for (uint32_t n = 0; (n < RECORDS) && (m_frame_end[n] <= len); n++)
+    {
+        whole = m_frame_end[n];
+    }
+
+    CHECK_EQ(scan_idx_open(&p_idx, p_path), 0);
+    CHECK_EQ(scan_idx_info(p_idx, &p_segments)->indexed_len, whole);
+    capture_decode(whole);
+    lookup_check(p_idx, &all);
+    scan_idx_close(p_idx);
+}
+
+
+/**@brief Function for appending part of the capture to the file and updating the index. */
+static void piece_append(int fd, char const * p_path, uint32_t * p_written, uint32_t end, bool * p_merged)
+{
+    scan_idx_update_stats_t stats;
+
+    CHECK_EQ(write(fd, &m_capture[*p_written], end - *p_written), (long long)(end - *p_written));
+    *p_written = end;
+
+    CHECK_EQ(scan_idx_update(p_path, &stats), 0);
+    CHECK(!stats.rebuilt);
+    *p_merged = *p_merged || stats.merged;
+    index_check(p_path, end);
+}
+
+
+static void test_pieces(char const * p_path, int fd)
+{
+    uint32_t written = 0;
+    bool     merged  = false;
+
+    for (uint32_t i = 1; i < PIECES; i++)
+    {
+        uint32_t n    = i * (RECORDS / PIECES);
+        uint32_t end;
+
+        // Between frames, in a header, in a payload, and where noise may be.
+        switch (i % 4)
+        {
+            case 0:  end = m_frame_end[n];                                          break;
+            case 1:  end = m_frame_start[n] + 2;                                    break;
+            case 2:  end = m_frame_start[n] + SCAN_FRAME_HEADER_LEN + 9;            break;
+            default: end = m_frame_start[n] - 1;                                    break;
+        }
+        piece_append(fd, p_path, &written, end, &merged);
+
+        // Nothing appended: nothing changes.
+        piece_append(fd, p_path, &written, end, &merged);
+    }
+    piece_append(fd, p_path, &written, m_capture_len, &merged);
+    CHECK(merged);
+}
+
+
+/**@brief Function for checking lookups that start or end at an entry of the times.
+ *
+ * @details The index file is read, for the times of its segments.
+ */
+static void test_edges(scan_idx_t * p_idx, char const * p_path)
+{
+    char             idx_path[64];
+    FILE           * p_file;
+    uint8_t        * p_index;
+    long             index_len;
+    scan_idx_hdr_t   hdr;
+    scan_idx_query_t query;
+
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", p_path);
+    p_file = fopen(idx_path, "rb");
+    CHECK(p_file != NULL);
+    fseek(p_file, 0, SEEK_END);
+    index_len = ftell(p_file);
+    rewind(p_file);
+    p_index = malloc((size_t)index_len);
+    CHECK_EQ(fread(p_index, 1, (size_t)index_len, p_file), index_len);
+    fclose(p_file);
+    memcpy(&hdr, p_index, sizeof(hdr));
+
+    for (uint32_t i = 0; i < hdr.segments; i++)
+    {
+        scan_idx_segment_t segment;
+
+        memcpy(&segment, &p_index[hdr.directory_offset + i * sizeof(segment)], sizeof(segment));
+        CHECK(segment.times > 0);
+        for (uint32_t j = 0; j < segment.times; j++)
+        {
+            scan_idx_time_t time;
+
+            memcpy(&time, &p_index[segment.times_offset + j * sizeof(time)], sizeof(time));
+
+            // From the latest time before the entry, up to the earliest time after it.
+            query = (scan_idx_query_t){ .t_min = time.t_latest, .t_max = UINT64_MAX };
+            lookup_check(p_idx, &query);
+            query = (scan_idx_query_t){ .t_min = 0, .t_max = time.t_earliest };
+            lookup_check(p_idx, &query);
+
+            // The address of the record of the entry, which is where its postings are searched from.
+            query.by_addr = true;
+            memcpy(query.addr, &m_capture[time.offset + SCAN_FRAME_HEADER_LEN + sizeof(uint64_t)], sizeof(query.addr));
+            query.t_min = time.t_latest;
+            query.t_max = UINT64_MAX;
+            lookup_check(p_idx, &query);
+        }
+    }
+
+    free(p_index);
+}
+
+
+static void test_lookups(char const * p_path)
+{
+    scan_idx_t     * p_idx;
+    scan_idx_query_t query = { .t_min = 0, .t_max = UINT64_MAX };
+    uint64_t         read;
+
+    capture_decode(m_capture_len);
+    CHECK_EQ(m_decoded.count, RECORDS);
+    CHECK_EQ(scan_idx_open(&p_idx, p_path), 0);
+
+    // Everything, every frame read.
+    CHECK_EQ(lookup_check(p_idx, &query), RECORDS);
+
+    // Addresses: only their frames are read.
+    query.by_addr = true;
+    for (uint32_t id = 0; id < ADDRESSES + PASSING; id += 13)
+    {
+        addr_get(id, query.addr);
+        read = lookup_check(p_idx, &query);
+        CHECK_EQ(read, m_found.count);
+        CHECK(read > 0);
+    }
+    addr_get(ADDRESSES + PASSING, query.addr);
+    CHECK_EQ(lookup_check(p_idx, &query), 0);
+
+    // A time range before the restart, later than any time after it.
+    query.by_addr = false;
+    query.t_min   = m_times[REBOOT_AT - 3000];
+    query.t_max   = m_times[REBOOT_AT - 1000];
+    read = lookup_check(p_idx, &query);
+    CHECK(m_found.count > 1000);
+    CHECK(read < RECORDS / 2);
+
+    // A time range seen on both sides of the restart, and up to the end.
+    query.t_min = m_times[REBOOT_AT + 100];
+    query.t_max = m_times[REBOOT_AT + 3000];
+    lookup_check(p_idx, &query);
+    query.t_min = m_times[RECORDS - 10];
+    query.t_max = UINT64_MAX;
+    lookup_check(p_idx, &query);
+
+    // Both.
+    query.by_addr = true;
+    query.t_min   = m_times[REBOOT_AT - 4000];
+    query.t_max   = m_times[REBOOT_AT - 1];
+    addr_get(5, query.addr);
+    read = lookup_check(p_idx, &query);
+    CHECK(m_found.count > 0);
+    CHECK(read < RECORDS / ADDRESSES);
+
+    test_edges(p_idx, p_path);
+
+    scan_idx_close(p_idx);
+}
+
+
+static void test_rebuild(char const * p_path)
+{
+    scan_idx_update_stats_t stats;
+    uint32_t                cut = m_frame_start[RECORDS / 3] + 7;
+
+    CHECK_EQ(truncate(p_path, cut), 0);
+    CHECK_EQ(scan_idx_update(p_path, &stats), 0);
+    CHECK(stats.rebuilt);
+    index_check(p_path, cut);
+}
+
+
+int main(void)
+{
+    char path[] = "/tmp/test_idx_XXXXXX";
+    char idx_path[sizeof(path) + 4];
+    int  fd     = mkstemp(path);
+
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+
+    m_decoded.p_pool = malloc(CAPTURE_SIZE);
+    m_found.p_pool   = malloc(CAPTURE_SIZE);
+    capture_build();
+
+    test_pieces(path, fd);
+    test_lookups(path);
+    test_rebuild(path);
+
+    close(fd);
+    unlink(path);
+    unlink(idx_path);
+    free(m_capture);
+    free(m_decoded.p_pool);
+    free(m_found.p_pool);
+
+    return test_result("test_idx");
+}
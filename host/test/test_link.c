@@ -0,0 +1,268 @@
+/***************************************************************************************/
+/*
+ * test_link
+ *
+ *  Baud rate handshake over a pseudo-terminal: scan_cmd and scan_output run in a
+ *  thread against the UARTE mock, wired to the master side, and the host side of
+ *  scan_link drives them through the slave side. Bytes only go through when both
+ *  sides run at the same baud rate, so each one has to follow the other for real.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sdk_common.h"
+#include "scan_cmd.h"
+#include "scan_decoder.h"
+#include "scan_link.h"
+#include "scan_output.h"
+#include "serial_port.h"
+#include "test.h"
+#include "test_sdk.h"
+
+#define FIRMWARE_RX_MAX     32                                          /**< Bytes received per main loop pass, less than the receive ring. */
+
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;              /**< Held by the firmware thread while it runs. */
+static volatile bool   m_stop;
+
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+static void sleep_ms(uint32_t ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000 };
+
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+
+/**@brief Main loop of the firmware, on the host time. */
+static void * firmware_run(void * p_context)
+{
+    while (!m_stop)
+    {
+        pthread_mutex_lock(&m_lock);
+        test_time_set(now_us());
+        test_timers_run();
+        test_uarte_pty_poll(FIRMWARE_RX_MAX);
+        scan_cmd_process();
+        scan_output_flush();
+        pthread_mutex_unlock(&m_lock);
+
+        usleep(100);
+    }
+
+    return NULL;
+}
+
+
+static uint32_t scanner_baudrate(void)
+{
+    test_uarte_state_t state;
+
+    pthread_mutex_lock(&m_lock);
+    test_uarte_state_get(&state);
+    pthread_mutex_unlock(&m_lock);
+
+    return state.enabled ? state.baudrate : 0;
+}
+
+
+static void drop_set(uint32_t baudrate, uint32_t count)
+{
+    pthread_mutex_lock(&m_lock);
+    test_uarte_tx_drop(baudrate, count);
+    pthread_mutex_unlock(&m_lock);
+}
+
+
+static bool port_at(int fd, speed_t speed)
+{
+    struct termios tio;
+
+    return (tcgetattr(fd, &tio) == 0) && (cfgetospeed(&tio) == speed);
+}
+
+
+/**@brief HELLO frames read by @ref hellos_read. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t baudrate;                                                  /**< Baud rate announced by the last one. */
+} hellos_t;
+
+
+static void hello_handler(scan_record_t const * p_record, void * p_context)
+{
+    hellos_t   * p_hellos = p_context;
+    scan_hello_t hello;
+
+    if ((p_record->type == SCAN_FRAME_TYPE_HELLO) && (p_record->len >= sizeof(hello)))
+    {
+        memcpy(&hello, p_record->p_payload, sizeof(hello));
+        p_hellos->count++;
+        p_hellos->baudrate = hello.baudrate;
+    }
+}
+
+
+/**@brief Function for reading the port for a while, counting the HELLO frames. */
+static void hellos_read(int fd, uint32_t ms, hellos_t * p_hellos)
+{
+    static scan_decoder_t decoder;
+    uint64_t              end = now_us() + (uint64_t)ms * 1000;
+    uint8_t               buf[256];
+
+    memset(p_hellos, 0, sizeof(*p_hellos));
+    scan_decoder_init(&decoder, hello_handler, p_hellos);
+
+    for (uint64_t now = now_us(); now < end; now = now_us())
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t       n;
+
+        if (poll(&pfd, 1, (int)((end - now) / 1000) + 1) <= 0)
+        {
+            continue;
+        }
+        n = read(fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            scan_decoder_feed(&decoder, buf, (size_t)n);
+        }
+    }
+}
+
+
+/**@brief The scanner and the host move to the new rate and stay there. */
+static void test_switch(int fd)
+{
+    scan_hello_t hello;
+
+    CHECK_EQ(scan_link_negotiate(fd, 1000000, false, &hello), 0);
+    CHECK_EQ(hello.baudrate, 1000000);
+    CHECK(port_at(fd, B1000000));
+
+    // Past the confirmation time, the scanner is still there.
+    sleep_ms(SCANNER_BAUD_CONFIRM_MS + 300);
+    CHECK_EQ(scanner_baudrate(), 1000000);
+    CHECK_EQ(scan_link_probe(fd, &hello), 0);
+    CHECK_EQ(hello.baudrate, 1000000);
+
+    // Back to the boot rate for the next test.
+    CHECK_EQ(scan_link_negotiate(fd, SCANNER_UART_BAUDRATE, false, &hello), 0);
+    CHECK_EQ(scanner_baudrate(), SCANNER_UART_BAUDRATE);
+}
+
+
+/**@brief The first HELLO at the new rate is lost: the next one gets through. */
+static void test_hello_lost_once(int fd)
+{
+    scan_hello_t hello;
+
+    drop_set(921600, 1);
+    CHECK_EQ(scan_link_negotiate(fd, 921600, false, &hello), 0);
+    CHECK_EQ(hello.baudrate, 921600);
+    sleep_ms(SCANNER_BAUD_CONFIRM_MS + 300);
+    CHECK_EQ(scanner_baudrate(), 921600);
+
+    CHECK_EQ(scan_link_negotiate(fd, SCANNER_UART_BAUDRATE, false, &hello), 0);
+    CHECK_EQ(scanner_baudrate(), SCANNER_UART_BAUDRATE);
+}
+
+
+/**@brief No HELLO gets through at the new rate: both sides go back to the old one. */
+static void test_hello_lost(int fd)
+{
+    scan_hello_t hello;
+
+    drop_set(460800, UINT32_MAX);
+    CHECK_EQ(scan_link_negotiate(fd, 460800, false, &hello), -1);
+    CHECK(port_at(fd, B115200));
+
+    sleep_ms(SCANNER_BAUD_CONFIRM_MS / 2);
+    CHECK_EQ(scanner_baudrate(), SCANNER_UART_BAUDRATE);
+    CHECK_EQ(scan_link_probe(fd, &hello), 0);
+    CHECK_EQ(hello.baudrate, SCANNER_UART_BAUDRATE);
+
+    drop_set(0, 0);
+}
+
+
+/**@brief The host follows but never confirms: the scanner repeats its HELLO, then reverts. */
+static void test_no_confirm(int fd)
+{
+    scan_cmd_uart_config_t cmd = { .baudrate = 230400, .flags = 0 };
+    scan_hello_t           hello;
+    hellos_t               hellos;
+    uint8_t                status = 0xFF;
+
+    CHECK_EQ(scan_link_command(fd, SCAN_CMD_UART_CONFIG, &cmd, sizeof(cmd), &status), 0);
+    CHECK_EQ(status, SCAN_CMD_STATUS_OK);
+    tcdrain(fd);
+    CHECK_EQ(serial_port_baudrate_set(fd, 230400), 0);
+
+    // The first HELLO may have gone out before the port followed.
+    hellos_read(fd, SCANNER_BAUD_CONFIRM_MS + 300, &hellos);
+    CHECK(hellos.count >= 3);
+    CHECK_EQ(hellos.baudrate, 230400);
+    CHECK_EQ(scanner_baudrate(), SCANNER_UART_BAUDRATE);
+
+    CHECK_EQ(serial_port_baudrate_set(fd, SCANNER_UART_BAUDRATE), 0);
+    CHECK_EQ(scan_link_probe(fd, &hello), 0);
+    CHECK_EQ(hello.baudrate, SCANNER_UART_BAUDRATE);
+}
+
+
+int main(void)
+{
+    pthread_t firmware;
+    int       master;
+    int       slave;
+    int       fd;
+
+    if (openpty(&master, &slave, NULL, NULL, NULL) != 0)
+    {
+        perror("openpty");
+        return EXIT_FAILURE;
+    }
+    fd = serial_port_open(ttyname(slave), SCANNER_UART_BAUDRATE, O_RDWR);
+    if (fd < 0)
+    {
+        perror("serial_port_open");
+        return EXIT_FAILURE;
+    }
+
+    test_uarte_pty_set(master, slave);
+    test_time_set(now_us());
+    CHECK_EQ(scan_output_init(), NRF_SUCCESS);
+    CHECK_EQ(scan_cmd_init(NULL), NRF_SUCCESS);
+    CHECK(pthread_create(&firmware, NULL, firmware_run, NULL) == 0);
+
+    test_switch(fd);
+    test_hello_lost_once(fd);
+    test_hello_lost(fd);
+    test_no_confirm(fd);
+
+    m_stop = true;
+    pthread_join(firmware, NULL);
+
+    return test_result("test_link");
+}
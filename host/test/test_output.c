@@ -0,0 +1,371 @@
+/***************************************************************************************/
+/*
+ * test_output
+ *
+ *  scan_output against the UARTE mock: framing of the records, both buffers busy,
+ *  records too long, a baud rate change applied only once both buffers are empty,
+ *  and the reception of host frames.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "sdk_common.h"
+#include "scan_decoder.h"
+#include "scan_output.h"
+#include "test.h"
+#include "test_sdk.h"
+
+#define HEAD_LEN        8
+#define BODY_MAX        200
+
+/**@brief Frames seen on the line. */
+typedef struct
+{
+    scan_decoder_t decoder;
+    uint32_t       frames;
+    uint32_t       next_seq;                                            /**< Sequence number expected in the next frame. */
+    uint32_t       baudrate;                                            /**< Baud rate of the transfer being decoded. */
+    uint32_t       last_baudrate[2];                                    /**< Baud rate of the last frame of each sequence range, see @ref m_switch_seq. */
+    uint32_t       bad;
+    uint64_t       bytes;
+} line_t;
+
+static line_t   m_line;
+static uint32_t m_switch_seq = UINT32_MAX;                              /**< First sequence number queued after the baud rate change. */
+static uint32_t m_seq;                                                  /**< Sequence number of the next record sent. */
+
+
+/**@brief Function for checking a frame: its body is derived from the sequence number in its head. */
+static void line_record_handler(scan_record_t const * p_record, void * p_context)
+{
+    line_t * p_line = p_context;
+    uint32_t seq;
+    uint16_t body_len;
+    bool     ok;
+
+    p_line->frames++;
+    if (p_record->type != SCAN_FRAME_TYPE_ADV_REPORT)
+    {
+        return;
+    }
+
+    ok = (p_record->len >= HEAD_LEN);
+    if (ok)
+    {
+        memcpy(&seq, p_record->p_payload, sizeof(seq));
+        body_len = (uint16_t)(seq % BODY_MAX);
+        ok = (seq == p_line->next_seq) && (p_record->len == HEAD_LEN + body_len);
+        for (uint16_t i = 0; ok && (i < body_len); i++)
+        {
+            ok = (p_record->p_payload[HEAD_LEN + i] == (uint8_t)(seq + i));
+        }
+        p_line->next_seq = seq + 1;
+        p_line->last_baudrate[seq >= m_switch_seq] = p_line->baudrate;
+    }
+    p_line->bad += !ok;
+}
+
+
+static void line_sink(uint8_t const * p_data, size_t len, uint32_t baudrate, void * p_context)
+{
+    line_t * p_line = p_context;
+
+    p_line->baudrate = baudrate;
+    p_line->bytes   += len;
+    scan_decoder_feed(&p_line->decoder, p_data, len);
+}
+
+
+/**@brief Function for sending the next record of the sequence.
+ *
+ * @details The head holds the sequence number, the body is derived from it.
+ */
+static ret_code_t record_send(void)
+{
+    uint8_t  head[HEAD_LEN] = { 0 };
+    uint8_t  body[BODY_MAX];
+    uint16_t body_len = (uint16_t)(m_seq % BODY_MAX);
+    ret_code_t err_code;
+
+    memcpy(head, &m_seq, sizeof(m_seq));
+    for (uint16_t i = 0; i < body_len; i++)
+    {
+        body[i] = (uint8_t)(m_seq + i);
+    }
+
+    err_code = scan_output_send(SCAN_FRAME_TYPE_ADV_REPORT, head, sizeof(head), body, body_len);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_seq++;
+    }
+
+    return err_code;
+}
+
+
+/**@brief Function for sending records until they are refused.
+ *
+ * @return Number of records queued.
+ */
+static uint32_t records_fill(void)
+{
+    uint32_t count = 0;
+
+    while (record_send() == NRF_SUCCESS)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+
+/**@brief Function for sending everything queued. */
+static void output_drain(void)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        scan_output_flush();
+        if (!test_uarte_tx_done())
+        {
+            break;
+        }
+    }
+}
+
+
+static void test_init(void)
+{
+    test_uarte_state_t state;
+    uint32_t           baudrate;
+    bool               hwfc;
+
+    CHECK_EQ(scan_output_init(), NRF_SUCCESS);
+    test_uarte_state_get(&state);
+    CHECK(state.enabled);
+    CHECK_EQ(state.baudrate, SCANNER_UART_BAUDRATE);
+    CHECK_EQ(state.hwfc, SCANNER_UART_HWFC);
+    CHECK_EQ(state.rx_lent, 2);
+
+    scan_output_uart_config_get(&baudrate, &hwfc);
+    CHECK_EQ(baudrate, SCANNER_UART_BAUDRATE);
+
+    // Nothing goes out before a flush, nor with nothing queued.
+    scan_output_flush();
+    test_uarte_state_get(&state);
+    CHECK(!state.tx_busy);
+}
+
+
+/**@brief Both buffers in use: the record is refused as a whole and goes through once a transfer ends. */
+static void test_buffers_busy(void)
+{
+    test_uarte_state_t  state;
+    scan_output_stats_t before;
+    scan_output_stats_t after;
+    uint32_t            count;
+
+    scan_output_stats_get(&before);
+
+    // Buffer A fills up, the next record hands it over to EasyDMA and B fills up too.
+    count = records_fill();
+    test_uarte_state_get(&state);
+    CHECK(count > 0);
+    CHECK(state.tx_busy);
+    CHECK_EQ(state.transfers, 0);
+    CHECK_EQ(record_send(), NRF_ERROR_NO_MEM);
+    CHECK_EQ(record_send(), NRF_ERROR_NO_MEM);
+
+    // A flush during the transfer does not start another one.
+    scan_output_flush();
+    test_uarte_state_get(&state);
+    CHECK(state.tx_busy);
+    CHECK_EQ(state.transfers, 0);
+
+    scan_output_stats_get(&after);
+    CHECK_EQ(after.busy, before.busy + 3);
+    CHECK_EQ(after.frames, before.frames + count);
+    CHECK(after.fill_high_water <= SCANNER_OUTPUT_BUFFER_SIZE);
+    CHECK(after.fill_high_water + SCAN_FRAME_OVERHEAD + HEAD_LEN + BODY_MAX > SCANNER_OUTPUT_BUFFER_SIZE);
+
+    // A is done: the next record goes into A while B is sent.
+    CHECK(test_uarte_tx_done());
+    CHECK_EQ(record_send(), NRF_SUCCESS);
+    test_uarte_state_get(&state);
+    CHECK(state.tx_busy);
+    CHECK_EQ(state.transfers, 1);
+
+    output_drain();
+    CHECK_EQ(m_line.frames, count + 1);
+    CHECK_EQ(m_line.bad, 0);
+    CHECK_EQ(m_line.next_seq, m_seq);
+
+    scan_output_stats_get(&after);
+    CHECK_EQ(after.tx_bytes - before.tx_bytes, m_line.bytes);
+}
+
+
+static void test_too_long(void)
+{
+    static uint8_t      body[SCAN_FRAME_MAX_PAYLOAD + 1];
+    scan_output_stats_t before;
+    scan_output_stats_t after;
+    uint8_t             head[4] = { 0 };
+    uint32_t            frames  = m_line.frames;
+
+    scan_output_stats_get(&before);
+
+    CHECK_EQ(scan_output_send(SCAN_FRAME_TYPE_HELLO, NULL, 0, body, SCAN_FRAME_MAX_PAYLOAD + 1),
+             NRF_ERROR_INVALID_LENGTH);
+    CHECK_EQ(scan_output_send(SCAN_FRAME_TYPE_HELLO, head, sizeof(head), body, SCAN_FRAME_MAX_PAYLOAD - 3),
+             NRF_ERROR_INVALID_LENGTH);
+    CHECK_EQ(scan_output_send(SCAN_FRAME_TYPE_HELLO, head, UINT16_MAX, body, UINT16_MAX),
+             NRF_ERROR_INVALID_LENGTH);
+
+    scan_output_stats_get(&after);
+    CHECK_EQ(after.frames, before.frames);
+    CHECK_EQ(after.busy, before.busy);
+
+    // The largest payload fits.
+    CHECK_EQ(scan_output_send(SCAN_FRAME_TYPE_HELLO, head, sizeof(head), body, SCAN_FRAME_MAX_PAYLOAD - 4),
+             NRF_SUCCESS);
+    output_drain();
+    CHECK_EQ(m_line.frames, frames + 1);
+    CHECK_EQ(m_line.decoder.crc_errors, 0);
+}
+
+
+/**@brief A baud rate change waits for both buffers to be sent at the old rate. */
+static void test_switch(void)
+{
+    test_uarte_state_t state;
+    uint32_t           inits;
+    uint32_t           baudrate;
+    bool               hwfc;
+
+    m_line.last_baudrate[0] = 0;
+    m_line.last_baudrate[1] = 0;
+
+    CHECK_EQ(scan_output_uart_config_set(1000001, false), NRF_ERROR_INVALID_PARAM);
+    CHECK(!scan_output_switch_pending());
+
+    // A in flight, B full.
+    CHECK(records_fill() > 0);
+    test_uarte_state_get(&state);
+    CHECK(state.tx_busy);
+    inits = state.inits;
+
+    CHECK_EQ(scan_output_uart_config_set(1000000, true), NRF_SUCCESS);
+    CHECK(scan_output_switch_pending());
+    CHECK_EQ(scan_output_uart_config_set(460800, false), NRF_ERROR_BUSY);
+
+    m_switch_seq = m_seq;
+
+    // A done: B goes out, still at the old rate. New records are held back until
+    // the change is applied.
+    CHECK(test_uarte_tx_done());
+    CHECK_EQ(record_send(), NRF_ERROR_NO_MEM);
+    scan_output_flush();
+    test_uarte_state_get(&state);
+    CHECK(state.tx_busy);
+    CHECK_EQ(state.inits, inits);
+    CHECK_EQ(state.baudrate, SCANNER_UART_BAUDRATE);
+    CHECK(scan_output_switch_pending());
+    CHECK_EQ(record_send(), NRF_ERROR_NO_MEM);
+
+    // B done: both buffers are empty, the change is applied.
+    CHECK(test_uarte_tx_done());
+    scan_output_flush();
+    test_uarte_state_get(&state);
+    CHECK(!scan_output_switch_pending());
+    CHECK_EQ(state.inits, inits + 1);
+    CHECK(state.enabled);
+    CHECK_EQ(state.baudrate, 1000000);
+    CHECK(state.hwfc);
+    CHECK_EQ(state.rx_lent, 2);
+    scan_output_uart_config_get(&baudrate, &hwfc);
+    CHECK_EQ(baudrate, 1000000);
+    CHECK(hwfc);
+
+    CHECK_EQ(record_send(), NRF_SUCCESS);
+    output_drain();
+    CHECK_EQ(m_line.last_baudrate[0], SCANNER_UART_BAUDRATE);
+    CHECK_EQ(m_line.last_baudrate[1], 1000000);
+    CHECK_EQ(m_line.bad, 0);
+
+    // With nothing queued the change is applied on the next flush.
+    CHECK_EQ(scan_output_uart_config_set(SCANNER_UART_BAUDRATE, false), NRF_SUCCESS);
+    scan_output_flush();
+    CHECK(!scan_output_switch_pending());
+    test_uarte_state_get(&state);
+    CHECK_EQ(state.baudrate, SCANNER_UART_BAUDRATE);
+    CHECK(!state.hwfc);
+}
+
+
+/**@brief Frames received from the host. */
+typedef struct
+{
+    uint32_t count;
+    uint8_t  type;
+    uint16_t len;
+    uint8_t  payload[SCANNER_CMD_MAX_LEN];
+} rx_t;
+
+static rx_t m_rx;
+
+
+static void rx_handler(uint8_t type, uint8_t const * p_payload, uint16_t len)
+{
+    m_rx.count++;
+    m_rx.type = type;
+    m_rx.len  = len;
+    memcpy(m_rx.payload, p_payload, MIN(len, sizeof(m_rx.payload)));
+}
+
+
+static void test_rx(void)
+{
+    uint8_t frame[SCANNER_CMD_MAX_LEN + SCAN_FRAME_OVERHEAD];
+    uint8_t payload[SCANNER_CMD_MAX_LEN];
+    size_t  len;
+
+    for (uint16_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t)(0xA5 ^ i);
+    }
+
+    len = scan_frame_build(SCAN_CMD_UART_CONFIG, payload, 8, frame, sizeof(frame));
+    CHECK_EQ(test_uarte_rx(frame, len), len);
+    scan_output_rx_process(rx_handler);
+    CHECK_EQ(m_rx.count, 1);
+    CHECK_EQ(m_rx.type, SCAN_CMD_UART_CONFIG);
+    CHECK_EQ(m_rx.len, 8);
+    CHECK(memcmp(m_rx.payload, payload, 8) == 0);
+
+    // The longest command, received in two parts.
+    len = scan_frame_build(SCAN_CMD_FILTER_ADD, payload, SCANNER_CMD_MAX_LEN, frame, sizeof(frame));
+    CHECK_EQ(test_uarte_rx(frame, 10), 10);
+    scan_output_rx_process(rx_handler);
+    CHECK_EQ(m_rx.count, 1);
+    CHECK_EQ(test_uarte_rx(&frame[10], len - 10), len - 10);
+    scan_output_rx_process(rx_handler);
+    CHECK_EQ(m_rx.count, 2);
+    CHECK_EQ(m_rx.len, SCANNER_CMD_MAX_LEN);
+    CHECK(memcmp(m_rx.payload, payload, SCANNER_CMD_MAX_LEN) == 0);
+}
+
+
+int main(void)
+{
+    scan_decoder_init(&m_line.decoder, line_record_handler, &m_line);
+    test_uarte_sink_set(line_sink, &m_line);
+
+    test_init();
+    test_buffers_busy();
+    test_too_long();
+    test_switch();
+    test_rx();
+
+    return test_result("test_output");
+}
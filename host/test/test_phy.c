@@ -0,0 +1,167 @@
+/***************************************************************************************/
+/*
+ * test_phy
+ *
+ *  PHY schedule of the firmware, run by the SoftDevice simulator on its simulated
+ *  clock. The firmware is built with the rotation between the 1M and the Coded PHYs
+ *  on and unequal dwell times. Advertisers send on both PHYs in turns, so the
+ *  reports received tell which PHY was scanned when: each BLE_GAP_EVT_TIMEOUT must
+ *  move the scan to the other PHY, each step must last its dwell time, and the share
+ *  of the time spent on each PHY must follow the dwell times.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_decoder.h"
+#include "sim_sdk.h"
+#include "test.h"
+
+#define DURATION_US     20000000
+#define PERIOD_US       1000                                            /**< Time between two packets, on one PHY then the other. */
+#define DATA_LEN        8
+#define CYCLE_MS        (SCANNER_PHY_DWELL_1M_MS + SCANNER_PHY_DWELL_CODED_MS)
+#define SLACK_US        (4 * PERIOD_US)                                 /**< Packets missed at the edges of a step. */
+
+/**@brief Runs of reports on the same PHY. */
+typedef struct
+{
+    scan_decoder_t decoder;
+    uint8_t        data[DATA_LEN];
+    uint32_t       next;                                                /**< Next packet to send. */
+    uint32_t       reports[2];                                          /**< Reports per PHY, 1M then Coded. */
+    uint8_t        phy;                                                 /**< PHY of the current run. */
+    uint64_t       run_first_us;                                        /**< First report of the current run. */
+    uint64_t       run_last_us;                                         /**< Last report of the current run. */
+    uint32_t       runs[2];                                             /**< Complete runs per PHY. */
+} test_t;
+
+
+static uint32_t phy_idx(uint8_t phy)
+{
+    return (phy == BLE_GAP_PHY_CODED) ? 1 : 0;
+}
+
+
+static uint32_t dwell_us(uint8_t phy)
+{
+    return ((phy == BLE_GAP_PHY_CODED) ? SCANNER_PHY_DWELL_CODED_MS : SCANNER_PHY_DWELL_1M_MS) * 1000;
+}
+
+
+static bool packet_next(sim_packet_t * p_packet, void * p_context)
+{
+    test_t * p_test = p_context;
+    uint32_t i      = p_test->next++;
+
+    if ((uint64_t)(i + 1) * PERIOD_US >= DURATION_US)
+    {
+        return false;
+    }
+
+    // A new advertiser each time, so that no report is dropped as a duplicate.
+    memset(p_packet, 0, sizeof(*p_packet));
+    p_packet->time_us                    = (uint64_t)(i + 1) * PERIOD_US;
+    p_packet->report.type.connectable    = 1;
+    p_packet->report.peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    p_packet->report.peer_addr.addr[0]   = (uint8_t)i;
+    p_packet->report.peer_addr.addr[1]   = (uint8_t)(i >> 8);
+    p_packet->report.peer_addr.addr[2]   = (uint8_t)(i >> 16);
+    p_packet->report.peer_addr.addr[5]   = 0xC0;
+    p_packet->report.primary_phy         = (i & 1) ? BLE_GAP_PHY_CODED : BLE_GAP_PHY_1MBPS;
+    p_packet->report.secondary_phy       = BLE_GAP_PHY_NOT_SET;
+    p_packet->report.tx_power            = BLE_GAP_POWER_LEVEL_INVALID;
+    p_packet->report.rssi                = -60;
+    p_packet->report.set_id              = BLE_GAP_ADV_REPORT_SET_ID_NOT_AVAILABLE;
+    p_packet->report.data.p_data         = p_test->data;
+    p_packet->report.data.len            = sizeof(p_test->data);
+
+    return true;
+}
+
+
+static void record_handler(scan_record_t const * p_record, void * p_context)
+{
+    test_t          * p_test = p_context;
+    scan_report_hdr_t hdr;
+    uint8_t const   * p_data;
+
+    if (p_record->type != SCAN_FRAME_TYPE_ADV_REPORT)
+    {
+        return;
+    }
+    CHECK(scan_record_adv_parse(p_record, &hdr, &p_data) == 0);
+    CHECK((hdr.primary_phy == BLE_GAP_PHY_1MBPS) || (hdr.primary_phy == BLE_GAP_PHY_CODED));
+    p_test->reports[phy_idx(hdr.primary_phy)]++;
+
+    if (hdr.primary_phy == p_test->phy)
+    {
+        p_test->run_last_us = hdr.timestamp_us;
+        return;
+    }
+
+    // The PHY changed: the run that ended is complete unless it was the first one.
+    if (p_test->phy != BLE_GAP_PHY_AUTO)
+    {
+        uint64_t len = p_test->run_last_us - p_test->run_first_us;
+
+        if (p_test->run_first_us > 0)
+        {
+            CHECK(len <= dwell_us(p_test->phy));
+            CHECK(len + SLACK_US >= dwell_us(p_test->phy));
+            p_test->runs[phy_idx(p_test->phy)]++;
+        }
+        // No time lost between two steps.
+        CHECK(hdr.timestamp_us - p_test->run_last_us <= SLACK_US);
+        p_test->run_first_us = hdr.timestamp_us;
+    }
+    p_test->phy         = hdr.primary_phy;
+    p_test->run_last_us = hdr.timestamp_us;
+}
+
+
+static void uart_sink(uint8_t const * p_data, size_t len, void * p_context)
+{
+    test_t * p_test = p_context;
+
+    scan_decoder_feed(&p_test->decoder, p_data, len);
+}
+
+
+int main(void)
+{
+    static test_t test;
+    sim_stats_t   stats;
+    sim_config_t  config =
+    {
+        .duration_us = DURATION_US + 100000,
+        .baudrate    = 1000000,
+        .source      = packet_next,
+        .sink        = uart_sink,
+        .p_context   = &test,
+    };
+    uint32_t      total;
+
+    test.phy = BLE_GAP_PHY_AUTO;
+    scan_decoder_init(&test.decoder, record_handler, &test);
+    sim_run(&config, &stats);
+
+    total = test.reports[0] + test.reports[1];
+    CHECK(total > DURATION_US / PERIOD_US / 2 * 9 / 10);
+    CHECK_EQ(stats.paused, 0);
+
+    // Every step ran for its dwell time, in turns.
+    CHECK(test.runs[0] + 1 >= DURATION_US / 1000 / CYCLE_MS);
+    CHECK(test.runs[1] + 1 >= DURATION_US / 1000 / CYCLE_MS);
+    CHECK(test.runs[0] <= test.runs[1] + 1);
+    CHECK(test.runs[1] <= test.runs[0] + 1);
+
+    // The share of each PHY follows the dwell times, within the packets missed at the
+    // edges of the steps.
+    CHECK((uint64_t)test.reports[1] * CYCLE_MS * 100 / total >= SCANNER_PHY_DWELL_CODED_MS * 98);
+    CHECK((uint64_t)test.reports[1] * CYCLE_MS * 100 / total <= SCANNER_PHY_DWELL_CODED_MS * 102);
+
+    printf("test_phy: %u reports on 1M, %u on Coded, %u and %u steps\n",
+           test.reports[0], test.reports[1], test.runs[0], test.runs[1]);
+
+    return test_result("test_phy");
+}
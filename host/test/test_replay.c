@@ -0,0 +1,286 @@
+/***************************************************************************************/
+/*
+ * test_replay
+ *
+ *  Replay of a generated capture through the pty of scan_replay, run in a child
+ *  process, once as fast as the test reads (-m) and once at ten times the pace of
+ *  the capture (-x 10). The capture holds records without a time, noise, a restart
+ *  of the scanner clock and the start of a frame at its end. Every byte read from the
+ *  pty must be the byte of the capture, and the summary printed at the end must
+ *  count them all. Paced, the rate asked for must be the one of the times of the
+ *  capture, and the rate achieved close to it but not above; as fast as possible, it
+ *  must be well above it.
+ *
+ *  scan_replay.c is included, its main renamed, so that no path to the tool is needed.
+*/
+/***************************************************************************************/
+
+#define main replay_main
+#include "scan_replay.c"
+#undef main
+
+#include <sys/wait.h>
+#include "test.h"
+
+#define REPORTS         2000
+#define RESTART_AT      1200                                            /**< Report from which the clock starts again. */
+#define REPORT_GAP_US   2000                                            /**< Between reports, on average. */
+#define MULTIPLIER      10
+#define READ_TIMEOUT_MS 5000
+#define CAPTURE_SIZE    (REPORTS * 64 + 1024)
+#define SUMMARY_SIZE    4096
+
+/**@brief What scan_replay printed at the end. */
+typedef struct
+{
+    double             elapsed;
+    unsigned long long records;
+    unsigned long long bytes;
+    double             requested;                                       /**< Records per second, 0 for as fast as possible. */
+    double             achieved;
+} summary_t;
+
+static uint8_t  m_capture[CAPTURE_SIZE];
+static uint32_t m_capture_len;
+static uint32_t m_frames;
+static double   m_span_s;                                               /**< Of the times of the capture, at its own pace. */
+
+
+static void frame_add(uint8_t type, void const * p_payload, uint16_t len)
+{
+    m_capture_len += (uint32_t)scan_frame_build(type, p_payload, len, &m_capture[m_capture_len],
+                                                sizeof(m_capture) - m_capture_len);
+    m_frames++;
+}
+
+
+/**@brief Function for building the capture. */
+static void capture_build(void)
+{
+    uint32_t     state = 17;
+    uint64_t     time  = 100000000;
+    uint64_t     first = time;
+    scan_hello_t hello;
+    scan_stats_t stats;
+
+    memset(&hello, 0, sizeof(hello));
+    memset(&stats, 0, sizeof(stats));
+    frame_add(SCAN_FRAME_TYPE_HELLO, &hello, sizeof(hello));
+
+    for (uint32_t n = 0; n < REPORTS; n++)
+    {
+        uint8_t           payload[sizeof(scan_report_hdr_t) + 31];
+        scan_report_hdr_t hdr = { .rssi = -60, .primary_phy = 1, .data_len = (uint16_t)(test_rand(&state) % 32) };
+
+        if (n == RESTART_AT)
+        {
+            // Much earlier: the replay goes on from where it was.
+            m_span_s += (double)(time - first) / 1e6;
+            time      = 500000;
+            first     = time;
+        }
+        else if (n > 0)
+        {
+            time += REPORT_GAP_US / 2 + test_rand(&state) % REPORT_GAP_US;
+        }
+        hdr.timestamp_us = time;
+        hdr.addr[0]      = (uint8_t)n;
+        memcpy(payload, &hdr, sizeof(hdr));
+        for (uint16_t i = 0; i < hdr.data_len; i++)
+        {
+            payload[sizeof(hdr) + i] = (uint8_t)test_rand(&state);
+        }
+        frame_add(SCAN_FRAME_TYPE_ADV_REPORT, payload, (uint16_t)(sizeof(hdr) + hdr.data_len));
+
+        if (n % 500 == 250)
+        {
+            frame_add(SCAN_FRAME_TYPE_STATS, &stats, sizeof(stats));
+        }
+        if (n % 300 == 150)
+        {
+            for (uint32_t i = 0; i < 7; i++)
+            {
+                m_capture[m_capture_len++] = (uint8_t)test_rand(&state);
+            }
+        }
+    }
+    m_span_s += (double)(time - first) / 1e6;
+
+    // The start of a frame that never ends: played all the same.
+    m_capture[m_capture_len++] = SCAN_FRAME_SOF;
+    m_capture[m_capture_len++] = SCAN_FRAME_TYPE_ADV_REPORT;
+}
+
+
+/**@brief Function for reading a line, or what is left, of a pipe. */
+static size_t pipe_read(int fd, char * p_buf, size_t size, bool line)
+{
+    size_t len = 0;
+
+    while (len < size - 1)
+    {
+        ssize_t n = read(fd, &p_buf[len], 1);
+
+        if (n <= 0)
+        {
+            break;
+        }
+        len += (size_t)n;
+        if (line && (p_buf[len - 1] == '\n'))
+        {
+            break;
+        }
+    }
+    p_buf[len] = '\0';
+
+    return len;
+}
+
+
+/**@brief Function for reading the summary printed by scan_replay. */
+static void summary_parse(char const * p_text, summary_t * p_summary)
+{
+    char const * p_line;
+
+    memset(p_summary, 0, sizeof(*p_summary));
+
+    p_line = strstr(p_text, " after ");
+    CHECK((p_line != NULL) &&
+          (sscanf(p_line, " after %lf s; records: %llu, bytes: %llu",
+                  &p_summary->elapsed, &p_summary->records, &p_summary->bytes) == 3));
+    p_line = strstr(p_text, "requested: ");
+    CHECK(p_line != NULL);
+    if ((p_line != NULL) && (strncmp(p_line, "requested: as fast", 18) != 0))
+    {
+        CHECK(sscanf(p_line, "requested: %lf", &p_summary->requested) == 1);
+    }
+    p_line = strstr(p_text, "achieved: ");
+    CHECK((p_line != NULL) && (sscanf(p_line, "achieved: %lf", &p_summary->achieved) == 1));
+}
+
+
+/**@brief Function for replaying the capture and reading it from the pty.
+ *
+ * @param[in]   p_path      Capture.
+ * @param[in]   p_pace      Option for the pace, -m or -x.
+ * @param[in]   p_value     Value of the option, or NULL.
+ * @param[out]  p_summary   What scan_replay printed at the end.
+ */
+static void replay_check(char const * p_path, char const * p_pace, char const * p_value, summary_t * p_summary)
+{
+    static uint8_t read_buf[CAPTURE_SIZE];
+    static char    summary[SUMMARY_SIZE];
+    char           pty[256];
+    int            out_pipe[2];
+    int            err_pipe[2];
+    int            status;
+    uint32_t       got = 0;
+    pid_t          pid;
+    int            fd;
+
+    CHECK((pipe(out_pipe) == 0) && (pipe(err_pipe) == 0));
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0)
+    {
+        char * argv[] = { "scan_replay", (char *)p_pace, (char *)p_value, (char *)p_path, NULL };
+
+        if (p_value == NULL)
+        {
+            argv[2] = (char *)p_path;
+            argv[3] = NULL;
+        }
+        dup2(out_pipe[1], STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        _exit(replay_main((p_value == NULL) ? 3 : 4, argv));
+    }
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+
+    // The name of the pty, then everything it is given.
+    CHECK(pipe_read(out_pipe[0], pty, sizeof(pty), true) > 0);
+    pty[strcspn(pty, "\n")] = '\0';
+    fd = open(pty, O_RDWR | O_NOCTTY);
+    CHECK(fd >= 0);
+    while ((fd >= 0) && (got < m_capture_len))
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t       n;
+
+        if (poll(&pfd, 1, READ_TIMEOUT_MS) <= 0)
+        {
+            break;
+        }
+        n = read(fd, &read_buf[got], sizeof(read_buf) - got);
+        if (n <= 0)
+        {
+            break;
+        }
+        got += (uint32_t)n;
+    }
+    CHECK_EQ(got, m_capture_len);
+    CHECK(memcmp(read_buf, m_capture, m_capture_len) == 0);
+    if (got < m_capture_len)
+    {
+        // Stuck, maybe where it does not look for SIGTERM.
+        kill(pid, SIGKILL);
+    }
+
+    // The replay ends with the capture once it was all taken.
+    pipe_read(err_pipe[0], summary, sizeof(summary), false);
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS));
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+
+    CHECK(strstr(summary, "end of the capture after ") != NULL);
+    summary_parse(summary, p_summary);
+    CHECK_EQ(p_summary->records, m_frames);
+    CHECK_EQ(p_summary->bytes, m_capture_len);
+}
+
+
+int main(void)
+{
+    char      path[] = "/tmp/test_replay_XXXXXX";
+    int       fd     = mkstemp(path);
+    char      multiplier[8];
+    summary_t paced;
+    summary_t fast;
+    double    rate;
+
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    capture_build();
+    CHECK_EQ(write(fd, m_capture, m_capture_len), m_capture_len);
+    close(fd);
+
+    // Paced: no faster than the times of the capture, and not much slower. Times are printed to 10 ms.
+    rate = (double)m_frames / (m_span_s / MULTIPLIER);
+    snprintf(multiplier, sizeof(multiplier), "%u", MULTIPLIER);
+    replay_check(path, "-x", multiplier, &paced);
+    CHECK((paced.requested > rate * 0.99) && (paced.requested < rate * 1.01));
+    CHECK(paced.elapsed >= m_span_s / MULTIPLIER - 0.01);
+    CHECK(paced.achieved <= paced.requested + 1);
+    CHECK(paced.achieved > paced.requested * 0.8);
+
+    // As fast as it is read.
+    replay_check(path, "-m", NULL, &fast);
+    CHECK_EQ(fast.requested, 0);
+    CHECK(fast.achieved > rate * 2);
+
+    unlink(path);
+
+    return test_result("test_replay");
+}
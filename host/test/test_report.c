@@ -0,0 +1,213 @@
+/***************************************************************************************/
+/*
+ * test_report
+ *
+ *  Metadata round trip: synthetic advertising reports go through the BLE event
+ *  handler of the firmware, run by the SoftDevice simulator, and every field of the
+ *  ADV_REPORT records decoded from the UART output is checked against the report.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_decoder.h"
+#include "sim_sdk.h"
+#include "test.h"
+
+#define PACKETS         400
+#define PERIOD_US       10000                                           /**< Time between two packets, well within the UART rate. */
+
+/**@brief Reports sent and received. */
+typedef struct
+{
+    uint8_t        data[PACKETS][200];
+    scan_decoder_t decoder;
+    uint32_t       next;                                                /**< Next packet to send. */
+    uint32_t       received;                                            /**< ADV_REPORT records received. */
+    bool           seen[PACKETS];
+} test_t;
+
+
+/**@brief Function for making the report of packet @p i, every field derived from @p i. */
+static void report_make(test_t * p_test, uint32_t i, ble_gap_evt_adv_report_t * p_report)
+{
+    bool     extended = (i & 0x10) != 0;
+    uint16_t len      = extended ? (uint16_t)(i % 200) : (uint16_t)(i % 32);
+
+    memset(p_report, 0, sizeof(*p_report));
+    p_report->type.connectable    = i & 1;
+    p_report->type.scannable      = (i >> 1) & 1;
+    p_report->type.directed       = (i >> 2) & 1;
+    p_report->type.scan_response  = (i >> 3) & 1;
+    p_report->type.extended_pdu   = extended;
+    p_report->peer_addr.addr_type = i % 4;
+    p_report->peer_addr.addr[0]   = (uint8_t)i;
+    p_report->peer_addr.addr[1]   = (uint8_t)(i >> 8);
+    p_report->peer_addr.addr[2]   = 0x5A;
+    p_report->peer_addr.addr[3]   = 0xC3;
+    p_report->peer_addr.addr[4]   = 0x11;
+    p_report->peer_addr.addr[5]   = 0xC0;
+    p_report->primary_phy         = BLE_GAP_PHY_1MBPS;
+    p_report->secondary_phy       = extended ? ((i & 0x20) ? BLE_GAP_PHY_2MBPS : BLE_GAP_PHY_CODED) : BLE_GAP_PHY_NOT_SET;
+    p_report->tx_power            = extended ? (int8_t)(-20 + (int)(i % 30)) : BLE_GAP_POWER_LEVEL_INVALID;
+    p_report->rssi                = (int8_t)(-30 - (int)(i % 70));
+    p_report->ch_index            = (uint8_t)(i % 40);
+    p_report->set_id              = extended ? (uint8_t)(i % 16) : BLE_GAP_ADV_REPORT_SET_ID_NOT_AVAILABLE;
+    p_report->data_id             = extended ? (uint16_t)((i * 37) & 0x0FFF) : 0;
+
+    for (uint16_t j = 0; j < len; j++)
+    {
+        p_test->data[i][j] = (uint8_t)(i * 7 + j);
+    }
+    p_report->data.p_data = p_test->data[i];
+    p_report->data.len    = len;
+}
+
+
+static bool packet_next(sim_packet_t * p_packet, void * p_context)
+{
+    test_t * p_test = p_context;
+
+    if (p_test->next == PACKETS)
+    {
+        return false;
+    }
+
+    memset(p_packet, 0, sizeof(*p_packet));
+    p_packet->time_us = (uint64_t)(p_test->next + 1) * PERIOD_US;
+    report_make(p_test, p_test->next, &p_packet->report);
+    p_test->next++;
+
+    return true;
+}
+
+
+static void record_handler(scan_record_t const * p_record, void * p_context)
+{
+    test_t                 * p_test = p_context;
+    scan_report_hdr_t        hdr;
+    ble_gap_evt_adv_report_t report;
+    uint8_t const          * p_data;
+    uint32_t                 i;
+
+    if (p_record->type != SCAN_FRAME_TYPE_ADV_REPORT)
+    {
+        return;
+    }
+    p_test->received++;
+
+    CHECK_EQ(sizeof(hdr), 26);
+    CHECK(scan_record_adv_parse(p_record, &hdr, &p_data) == 0);
+
+    i = hdr.addr[0] | ((uint32_t)hdr.addr[1] << 8);
+    CHECK(i < PACKETS);
+    if (i >= PACKETS)
+    {
+        return;
+    }
+    CHECK(!p_test->seen[i]);
+    p_test->seen[i] = true;
+
+    report_make(p_test, i, &report);
+
+    CHECK_EQ(hdr.timestamp_us, (uint64_t)(i + 1) * PERIOD_US);
+    CHECK(memcmp(hdr.addr, report.peer_addr.addr, sizeof(hdr.addr)) == 0);
+    CHECK_EQ(hdr.addr_type, report.peer_addr.addr_type);
+    CHECK_EQ(hdr.flags & SCAN_REPORT_FLAG_CONNECTABLE, report.type.connectable ? SCAN_REPORT_FLAG_CONNECTABLE : 0);
+    CHECK_EQ(hdr.flags & SCAN_REPORT_FLAG_SCANNABLE, report.type.scannable ? SCAN_REPORT_FLAG_SCANNABLE : 0);
+    CHECK_EQ(hdr.flags & SCAN_REPORT_FLAG_DIRECTED, report.type.directed ? SCAN_REPORT_FLAG_DIRECTED : 0);
+    CHECK_EQ(hdr.flags & SCAN_REPORT_FLAG_SCAN_RESPONSE, report.type.scan_response ? SCAN_REPORT_FLAG_SCAN_RESPONSE : 0);
+    CHECK_EQ(hdr.flags & SCAN_REPORT_FLAG_EXTENDED_PDU, report.type.extended_pdu ? SCAN_REPORT_FLAG_EXTENDED_PDU : 0);
+    CHECK_EQ(hdr.flags & (SCAN_REPORT_FLAG_STATUS_Msk | SCAN_REPORT_FLAG_TRUNCATED), 0);
+    CHECK_EQ(hdr.rssi, report.rssi);
+    CHECK_EQ(hdr.tx_power, report.tx_power);
+    CHECK_EQ(hdr.primary_phy, report.primary_phy);
+    CHECK_EQ(hdr.secondary_phy, report.secondary_phy);
+    CHECK_EQ(hdr.ch_index, report.ch_index);
+    CHECK_EQ(hdr.set_id, report.set_id);
+    CHECK_EQ(hdr.data_id, report.data_id);
+    CHECK_EQ(hdr.data_len, report.data.len);
+    CHECK((hdr.data_len == report.data.len) && (memcmp(p_data, report.data.p_data, hdr.data_len) == 0));
+}
+
+
+static void uart_sink(uint8_t const * p_data, size_t len, void * p_context)
+{
+    test_t * p_test = p_context;
+
+    scan_decoder_feed(&p_test->decoder, p_data, len);
+}
+
+
+/**@brief The wire layout of the header, independent of the struct the decoder uses. */
+static void test_layout(void)
+{
+    scan_report_hdr_t hdr;
+    uint8_t const   * p = (uint8_t const *)&hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.timestamp_us = 0x0102030405060708ULL;
+    hdr.addr[0]      = 0x11;
+    hdr.addr[5]      = 0x16;
+    hdr.addr_type    = 0x21;
+    hdr.flags        = 0x22;
+    hdr.rssi         = -3;
+    hdr.tx_power     = 0x24;
+    hdr.primary_phy  = 0x25;
+    hdr.secondary_phy = 0x26;
+    hdr.ch_index     = 0x27;
+    hdr.set_id       = 0x28;
+    hdr.data_id      = 0x0ABC;
+    hdr.data_len     = 0x0123;
+
+    CHECK_EQ(p[0], 0x08);
+    CHECK_EQ(p[7], 0x01);
+    CHECK_EQ(p[8], 0x11);
+    CHECK_EQ(p[13], 0x16);
+    CHECK_EQ(p[14], 0x21);
+    CHECK_EQ(p[15], 0x22);
+    CHECK_EQ(p[16], 0xFD);
+    CHECK_EQ(p[17], 0x24);
+    CHECK_EQ(p[18], 0x25);
+    CHECK_EQ(p[19], 0x26);
+    CHECK_EQ(p[20], 0x27);
+    CHECK_EQ(p[21], 0x28);
+    CHECK_EQ(p[22], 0xBC);
+    CHECK_EQ(p[23], 0x0A);
+    CHECK_EQ(p[24], 0x23);
+    CHECK_EQ(p[25], 0x01);
+}
+
+
+int main(void)
+{
+    static test_t test;
+    sim_config_t  config =
+    {
+        .duration_us = (uint64_t)(PACKETS + 100) * PERIOD_US,
+        .source      = packet_next,
+        .sink        = uart_sink,
+        .p_context   = &test,
+    };
+    sim_stats_t   stats;
+    uint32_t      seen = 0;
+
+    test_layout();
+
+    scan_decoder_init(&test.decoder, record_handler, &test);
+    sim_run(&config, &stats);
+    free(stats.p_latency_ns);
+
+    for (uint32_t i = 0; i < PACKETS; i++)
+    {
+        seen += test.seen[i];
+    }
+
+    // Every report the firmware got is on the wire, whatever the scan window let through.
+    CHECK(stats.reports > PACKETS / 4);
+    CHECK_EQ(stats.paused, 0);
+    CHECK_EQ(test.received, stats.reports);
+    CHECK_EQ(seen, test.received);
+    CHECK_EQ(test.decoder.crc_errors, 0);
+
+    return test_result("test_report");
+}
@@ -0,0 +1,274 @@
+/***************************************************************************************/
+/*
+ * test_ring
+ *
+ *  Report ring under a producer and a consumer thread. The producer plays the
+ *  SoftDevice observer of main.c: the report is received into the slot lent, or into
+ *  the spare buffer when the ring was full, and copied into the slot then. The
+ *  consumer checks that the reports come out in order and intact. The ring is small
+ *  and of a size that is not a power of two, and the free-running indices start
+ *  close to their wrap, so both the slot positions and the indices wrap many times.
+ *
+ *  scan_ring.c is included, so the test can move the indices.
+*/
+/***************************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "scan_ring.c"
+#include "test.h"
+
+#define SLOTS           7
+#define REPORTS         1000000
+#define INDEX_START     (UINT32_MAX - 100000)                           /**< The indices wrap early in the run. */
+
+// Arena of 7 slots and a partial one, which must be left unused.
+uint8_t __report_arena_start__[SLOTS * SLOT_SIZE + SLOT_SIZE / 2] __attribute__((aligned(4)));
+
+__asm__(".global __report_arena_end__\n"
+        ".set __report_arena_end__, __report_arena_start__ + " STRINGIFY(SLOTS * SLOT_SIZE + SLOT_SIZE / 2) "\n");
+
+/**@brief Counters of the producer, read once both threads are done. */
+typedef struct
+{
+    uint32_t published;
+    uint32_t dropped;
+    uint32_t spare_copies;                                              /**< Reports received into the spare buffer and copied into a slot. */
+    uint64_t seq_sum;                                                   /**< Sum of the sequence numbers published. */
+} producer_t;
+
+/**@brief Counters of the consumer. */
+typedef struct
+{
+    uint32_t consumed;
+    uint32_t bad;                                                       /**< Reports out of order or damaged. */
+    uint64_t seq_sum;
+} consumer_t;
+
+static volatile bool m_producer_done;
+
+
+static uint16_t report_len(uint32_t seq)
+{
+    return (uint16_t)(seq % (SCANNER_REPORT_DATA_MAX + 1));
+}
+
+
+static uint8_t report_byte(uint32_t seq, uint16_t i)
+{
+    return (uint8_t)(seq * 31 + i);
+}
+
+
+/**@brief Function for receiving a report into the buffer lent, as the SoftDevice does. */
+static void report_receive(uint32_t seq, uint8_t * p_buf)
+{
+    uint16_t len = report_len(seq);
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        p_buf[i] = report_byte(seq, i);
+    }
+}
+
+
+static void * producer_run(void * p_context)
+{
+    producer_t    * p_prod = p_context;
+    static uint8_t  spare[SCANNER_REPORT_DATA_MAX];
+    uint8_t       * p_lent = spare;                                     // Scanning starts on the spare buffer.
+
+    for (uint32_t seq = 0; seq < REPORTS; seq++)
+    {
+        scan_ring_slot_t * p_slot;
+
+        report_receive(seq, p_lent);
+
+        // The consumer usually frees a slot before the report is handled, the report
+        // then goes from the spare buffer to that slot. Now and then it does not.
+        if ((p_lent == spare) && (seq % 8 != 0))
+        {
+            while (scan_ring_alloc() == NULL)
+            {
+                sched_yield();
+            }
+        }
+
+        p_slot = scan_ring_alloc();
+        if (p_slot != NULL)
+        {
+            if (p_lent != p_slot->data)
+            {
+                memcpy(p_slot->data, p_lent, report_len(seq));
+                p_prod->spare_copies++;
+            }
+            memset(&p_slot->hdr, 0, sizeof(p_slot->hdr));
+            p_slot->hdr.timestamp_us = seq;
+            p_slot->hdr.data_len     = report_len(seq);
+            scan_ring_publish();
+            p_prod->published++;
+            p_prod->seq_sum += seq;
+        }
+        else
+        {
+            scan_ring_drop();
+            p_prod->dropped++;
+        }
+
+        // Lend the next free slot, or the spare buffer if the ring is full.
+        p_slot = scan_ring_alloc();
+        p_lent = (p_slot != NULL) ? p_slot->data : spare;
+
+    }
+
+    m_producer_done = true;
+
+    return NULL;
+}
+
+
+static void * consumer_run(void * p_context)
+{
+    consumer_t * p_cons = p_context;
+    uint64_t     last   = UINT64_MAX;
+
+    for (;;)
+    {
+        scan_ring_slot_t const * p_slot = scan_ring_peek();
+        bool                     done   = m_producer_done;
+
+        if (p_slot == NULL)
+        {
+            if (done && (scan_ring_peek() == NULL))
+            {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        uint32_t seq = (uint32_t)p_slot->hdr.timestamp_us;
+        bool     ok  = ((last == UINT64_MAX) || (p_slot->hdr.timestamp_us > last))
+                    && (p_slot->hdr.data_len == report_len(seq));
+
+        for (uint16_t i = 0; ok && (i < p_slot->hdr.data_len); i++)
+        {
+            ok = (p_slot->data[i] == report_byte(seq, i));
+        }
+        p_cons->bad += !ok;
+        p_cons->consumed++;
+        p_cons->seq_sum += seq;
+        last = p_slot->hdr.timestamp_us;
+
+        scan_ring_release();
+
+        // A slow consumer now and then, so reports land in the spare buffer.
+        if (seq % 8192 == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+
+/**@brief Single thread checks of the full and empty conditions across the index wrap.
+ *
+ * @details Each round publishes a different number of slots, so the positions do not
+ *          move by a multiple of the size.
+ */
+static void test_fill(void)
+{
+    scan_ring_stats_t stats;
+    uint32_t          seq = 0;
+
+    scan_ring_init();
+    CHECK_EQ(scan_ring_size(), SLOTS);
+
+    m_wr = m_rd = UINT32_MAX - 2;
+
+    for (uint32_t round = 0; round < 5 * SLOTS; round++)
+    {
+        uint32_t count = (round % 3 == 0) ? SLOTS : 1 + round % SLOTS;
+        uint32_t first = seq;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scan_ring_slot_t * p_slot = scan_ring_alloc();
+
+            CHECK(p_slot != NULL);
+            if (p_slot == NULL)
+            {
+                return;
+            }
+            CHECK(scan_ring_alloc() == p_slot);
+            CHECK((uint8_t *)p_slot >= __report_arena_start__);
+            CHECK((uint8_t *)(p_slot + 1) <= __report_arena_end__);
+            p_slot->hdr.timestamp_us = seq++;
+            scan_ring_publish();
+            CHECK_EQ(scan_ring_count(), i + 1);
+        }
+        CHECK((scan_ring_alloc() == NULL) == (count == SLOTS));
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scan_ring_slot_t const * p_slot = scan_ring_peek();
+
+            CHECK(p_slot != NULL);
+            if (p_slot == NULL)
+            {
+                return;
+            }
+            CHECK_EQ(p_slot->hdr.timestamp_us, first + i);
+            scan_ring_release();
+        }
+        CHECK(scan_ring_peek() == NULL);
+        CHECK_EQ(scan_ring_count(), 0);
+    }
+
+    scan_ring_stats_get(&stats);
+    CHECK_EQ(stats.high_water, SLOTS);
+    CHECK(stats.published < 5 * SLOTS * SLOTS);                         // The write index wrapped.
+}
+
+
+int main(void)
+{
+    static producer_t prod;
+    static consumer_t cons;
+    pthread_t         producer;
+    pthread_t         consumer;
+    scan_ring_stats_t stats;
+
+    test_fill();
+
+    scan_ring_init();
+    m_wr = m_rd = INDEX_START;
+
+    CHECK(pthread_create(&consumer, NULL, consumer_run, &cons) == 0);
+    CHECK(pthread_create(&producer, NULL, producer_run, &prod) == 0);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    scan_ring_stats_get(&stats);
+
+    CHECK_EQ(cons.bad, 0);
+    CHECK_EQ(cons.consumed, prod.published);
+    CHECK_EQ(cons.seq_sum, prod.seq_sum);
+    CHECK_EQ(prod.published + prod.dropped, REPORTS);
+    CHECK_EQ(stats.published, (uint32_t)(INDEX_START + prod.published));
+    CHECK_EQ(stats.overflows, prod.dropped);
+    CHECK(stats.published < INDEX_START);                               // The indices wrapped.
+
+    // Both paths ran: the ring filled up and reports went through the spare buffer.
+    CHECK(prod.dropped > 0);
+    CHECK(prod.spare_copies > 0);
+    CHECK_EQ(stats.high_water, SLOTS);
+
+    printf("test_ring: %u published, %u dropped, %u through the spare buffer\n",
+           prod.published, prod.dropped, prod.spare_copies);
+
+    return test_result("test_ring");
+}
@@ -0,0 +1,362 @@
+/***************************************************************************************/
+/*
+ * test_sdk
+ *
+ *  Mock of the SDK functions the firmware modules call, for the tests of `make check`.
+*/
+/***************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "crc16.h"
+#include "nrfx_uarte.h"
+#include "scan_decoder.h"
+#include "test_sdk.h"
+
+#define RX_LENT_MAX     2                                               /**< Buffers EasyDMA takes at a time: the one receiving and the next one. */
+
+/**@brief Baud rates and their register values. */
+static const struct
+{
+    uint32_t             bps;
+    nrf_uarte_baudrate_t reg;
+    speed_t              speed;                                         /**< termios constant of the pseudo-terminal. */
+} m_baudrates[] =
+{
+    {  115200, NRF_UARTE_BAUDRATE_115200,  B115200  },
+    {  230400, NRF_UARTE_BAUDRATE_230400,  B230400  },
+    {  460800, NRF_UARTE_BAUDRATE_460800,  B460800  },
+    {  921600, NRF_UARTE_BAUDRATE_921600,  B921600  },
+    { 1000000, NRF_UARTE_BAUDRATE_1000000, B1000000 },
+};
+
+/**@brief UARTE mock. */
+static struct
+{
+    test_uarte_state_t         state;
+    nrfx_uarte_event_handler_t handler;
+    void                     * p_context;
+    uint8_t const            * p_tx_data;
+    size_t                     tx_len;
+    uint8_t                  * p_rx[RX_LENT_MAX];                       /**< Buffers lent, in the order they fill. */
+    test_uarte_sink_t          sink;
+    void                     * p_sink_context;
+    int                        master_fd;                               /**< Pseudo-terminal, -1 if not wired. */
+    int                        slave_fd;
+    uint32_t                   drop_baudrate;                           /**< Transfers at this baud rate are lost. */
+    uint32_t                   drop_count;
+    bool                       tx_hold;                                 /**< Transfers do not complete. */
+} m_uarte = { .master_fd = -1, .slave_fd = -1 };
+
+static uint64_t      m_now_us;                                          /**< Time app_timer runs on. */
+static app_timer_t * mp_timers;                                         /**< Timers created. */
+
+
+void test_uarte_state_get(test_uarte_state_t * p_state)
+{
+    *p_state = m_uarte.state;
+}
+
+
+void test_uarte_sink_set(test_uarte_sink_t sink, void * p_context)
+{
+    m_uarte.sink           = sink;
+    m_uarte.p_sink_context = p_context;
+}
+
+
+bool test_uarte_tx_done(void)
+{
+    nrfx_uarte_event_t evt;
+
+    if (!m_uarte.state.tx_busy)
+    {
+        return false;
+    }
+
+    if (m_uarte.sink != NULL)
+    {
+        m_uarte.sink(m_uarte.p_tx_data, m_uarte.tx_len, m_uarte.state.baudrate, m_uarte.p_sink_context);
+    }
+    m_uarte.state.tx_busy = false;
+    m_uarte.state.transfers++;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.type              = NRFX_UARTE_EVT_TX_DONE;
+    evt.data.rxtx.p_data  = (uint8_t *)m_uarte.p_tx_data;
+    evt.data.rxtx.bytes   = m_uarte.tx_len;
+    m_uarte.handler(&evt, m_uarte.p_context);
+
+    return true;
+}
+
+
+size_t test_uarte_rx(uint8_t const * p_data, size_t len)
+{
+    size_t done = 0;
+
+    while ((done < len) && m_uarte.state.enabled && (m_uarte.state.rx_lent > 0))
+    {
+        nrfx_uarte_event_t evt;
+        uint8_t          * p_buf = m_uarte.p_rx[0];
+
+        memmove(&m_uarte.p_rx[0], &m_uarte.p_rx[1], sizeof(m_uarte.p_rx) - sizeof(m_uarte.p_rx[0]));
+        m_uarte.state.rx_lent--;
+        *p_buf = p_data[done++];
+
+        memset(&evt, 0, sizeof(evt));
+        evt.type             = NRFX_UARTE_EVT_RX_DONE;
+        evt.data.rxtx.p_data = p_buf;
+        evt.data.rxtx.bytes  = 1;
+        m_uarte.handler(&evt, m_uarte.p_context);
+    }
+
+    return done;
+}
+
+
+/**@brief Function for checking whether the host end of the pseudo-terminal runs at the UARTE baud rate. */
+static bool pty_baudrate_match(void)
+{
+    struct termios tio;
+
+    if (tcgetattr(m_uarte.slave_fd, &tio) != 0)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_baudrates); i++)
+    {
+        if (m_baudrates[i].bps == m_uarte.state.baudrate)
+        {
+            return cfgetospeed(&tio) == m_baudrates[i].speed;
+        }
+    }
+
+    return false;
+}
+
+
+void test_uarte_pty_set(int master_fd, int slave_fd)
+{
+    m_uarte.master_fd = master_fd;
+    m_uarte.slave_fd  = slave_fd;
+
+    (void)fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+}
+
+
+void test_uarte_pty_poll(size_t rx_max)
+{
+    uint8_t buf[256];
+    ssize_t n;
+
+    if (m_uarte.state.tx_busy && !m_uarte.tx_hold)
+    {
+        bool   lost = !pty_baudrate_match();
+        size_t done = 0;
+
+        if ((m_uarte.drop_count > 0) && (m_uarte.drop_baudrate == m_uarte.state.baudrate))
+        {
+            lost = true;
+            if (m_uarte.drop_count != UINT32_MAX)
+            {
+                m_uarte.drop_count--;
+            }
+        }
+
+        while (!lost && (done < m_uarte.tx_len))
+        {
+            n = write(m_uarte.master_fd, &m_uarte.p_tx_data[done], m_uarte.tx_len - done);
+            if (n < 0)
+            {
+                if ((errno != EINTR) && (errno != EAGAIN))
+                {
+                    break;
+                }
+                continue;
+            }
+            done += (size_t)n;
+        }
+        (void)test_uarte_tx_done();
+    }
+
+    n = read(m_uarte.master_fd, buf, MIN(rx_max, sizeof(buf)));
+    if ((n > 0) && pty_baudrate_match())
+    {
+        (void)test_uarte_rx(buf, (size_t)n);
+    }
+}
+
+
+void test_uarte_tx_drop(uint32_t baudrate, uint32_t count)
+{
+    m_uarte.drop_baudrate = baudrate;
+    m_uarte.drop_count    = count;
+}
+
+
+void test_uarte_tx_hold(bool hold)
+{
+    m_uarte.tx_hold = hold;
+}
+
+
+void test_time_set(uint64_t time_us)
+{
+    m_now_us = time_us;
+}
+
+
+uint64_t test_time_us(void)
+{
+    return m_now_us;
+}
+
+
+void test_timers_run(void)
+{
+    for (app_timer_t * p_timer = mp_timers; p_timer != NULL; p_timer = p_timer->p_next)
+    {
+        if (p_timer->active && (p_timer->expiry_us <= m_now_us))
+        {
+            if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+            {
+                p_timer->expiry_us += p_timer->period_us;
+            }
+            else
+            {
+                p_timer->active = false;
+            }
+            p_timer->handler(p_timer->p_context);
+        }
+    }
+}
+
+
+nrfx_err_t nrfx_uarte_init(nrfx_uarte_t const * p_instance, nrfx_uarte_config_t const * p_config,
+                           nrfx_uarte_event_handler_t event_handler)
+{
+    if (m_uarte.state.enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_uarte.state.baudrate = 0;
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_baudrates); i++)
+    {
+        if (m_baudrates[i].reg == p_config->baudrate)
+        {
+            m_uarte.state.baudrate = m_baudrates[i].bps;
+        }
+    }
+    if (m_uarte.state.baudrate == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_uarte.state.enabled = true;
+    m_uarte.state.hwfc    = (p_config->hwfc == NRF_UARTE_HWFC_ENABLED);
+    m_uarte.state.inits++;
+    m_uarte.state.rx_lent = 0;
+    m_uarte.state.tx_busy = false;
+    m_uarte.handler       = event_handler;
+    m_uarte.p_context     = p_config->p_context;
+
+    return NRFX_SUCCESS;
+}
+
+
+void nrfx_uarte_uninit(nrfx_uarte_t const * p_instance)
+{
+    // A transfer in progress is aborted.
+    m_uarte.state.enabled = false;
+    m_uarte.state.rx_lent = 0;
+    m_uarte.state.tx_busy = false;
+}
+
+
+nrfx_err_t nrfx_uarte_tx(nrfx_uarte_t const * p_instance, uint8_t const * p_data, size_t length)
+{
+    if (!m_uarte.state.enabled || m_uarte.state.tx_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_uarte.state.tx_busy = true;
+    m_uarte.p_tx_data     = p_data;
+    m_uarte.tx_len        = length;
+
+    return NRFX_SUCCESS;
+}
+
+
+nrfx_err_t nrfx_uarte_rx(nrfx_uarte_t const * p_instance, uint8_t * p_data, size_t length)
+{
+    if (!m_uarte.state.enabled || (length != 1) || (m_uarte.state.rx_lent == RX_LENT_MAX))
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_uarte.p_rx[m_uarte.state.rx_lent++] = p_data;
+
+    return NRFX_SUCCESS;
+}
+
+
+ret_code_t app_timer_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode,
+                            app_timer_timeout_handler_t timeout_handler)
+{
+    app_timer_t * p_timer = *p_timer_id;
+
+    p_timer->handler = timeout_handler;
+    p_timer->mode    = mode;
+    p_timer->active  = false;
+    p_timer->p_next  = mp_timers;
+    mp_timers        = p_timer;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    timer_id->p_context = p_context;
+    timer_id->period_us = (uint64_t)timeout_ticks * 1000000 / APP_TIMER_CLOCK_FREQ;
+    timer_id->expiry_us = m_now_us + timer_id->period_us;
+    timer_id->active    = true;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    timer_id->active = false;
+    return NRF_SUCCESS;
+}
+
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "%s:%u: error 0x%x\n", (char const *)p_file_name, line_num, error_code);
+    abort();
+}
+
+
+uint16_t crc16_compute(uint8_t const * p_data, uint32_t size, uint16_t const * p_crc)
+{
+    return scan_crc16(p_data, size, p_crc);
+}
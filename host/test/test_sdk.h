@@ -0,0 +1,116 @@
+/***************************************************************************************/
+/*
+ * test_sdk
+ *
+ *  Mock of the SDK functions the firmware modules call, for the tests of `make check`.
+ *  It takes the place of sim_sdk.c under the same stand-in headers of sim/, but
+ *  nothing happens on its own: the test completes the UARTE transfers, delivers the
+ *  received bytes and fires the timers when it wants to.
+ *
+ *  The UARTE can also be wired to a pseudo-terminal, so the host tools can talk to the
+ *  firmware modules. The bytes then only go through when both ends run at the same
+ *  baud rate, as on a real line.
+*/
+/***************************************************************************************/
+
+#ifndef TEST_SDK_H__
+#define TEST_SDK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief UARTE state seen by the mock. */
+typedef struct
+{
+    bool     enabled;                                                   /**< Between nrfx_uarte_init and nrfx_uarte_uninit. */
+    uint32_t baudrate;                                                  /**< Baud rate configured, in bit/s. */
+    bool     hwfc;                                                      /**< Flow control configured. */
+    uint32_t inits;                                                     /**< Calls to nrfx_uarte_init. */
+    uint32_t rx_lent;                                                   /**< Receive buffers lent and not filled yet. */
+    bool     tx_busy;                                                   /**< A transfer waits for @ref test_uarte_tx_done. */
+    uint32_t transfers;                                                 /**< Transfers completed. */
+} test_uarte_state_t;
+
+/**@brief Function receiving the bytes of each completed transfer, with the baud rate they went out at. */
+typedef void (*test_uarte_sink_t)(uint8_t const * p_data, size_t len, uint32_t baudrate, void * p_context);
+
+
+/**@brief Function for reading the UARTE state. */
+void test_uarte_state_get(test_uarte_state_t * p_state);
+
+
+/**@brief Function for setting the receiver of the bytes sent. */
+void test_uarte_sink_set(test_uarte_sink_t sink, void * p_context);
+
+
+/**@brief Function for completing the transfer in progress.
+ *
+ * @details Gives its bytes to the sink and calls the driver handler with TX_DONE.
+ *
+ * @return false if no transfer was in progress.
+ */
+bool test_uarte_tx_done(void);
+
+
+/**@brief Function for receiving bytes, one per buffer lent, as EasyDMA does.
+ *
+ * @return Number of bytes received, less than @p len if the driver ran out of buffers.
+ */
+size_t test_uarte_rx(uint8_t const * p_data, size_t len);
+
+
+/**@brief Function for wiring the UARTE to a pseudo-terminal.
+ *
+ * @param[in]   master_fd   Master side, read and written by the mock. Made non-blocking.
+ * @param[in]   slave_fd    Slave side, used by the host. Its baud rate is compared
+ *                          with the UARTE one.
+ */
+void test_uarte_pty_set(int master_fd, int slave_fd);
+
+
+/**@brief Function for moving the bytes between the UARTE and the pseudo-terminal.
+ *
+ * @details Completes the transfer in progress and receives what the host sent. Bytes
+ *          sent at a baud rate the other end does not use are lost.
+ *
+ * @param[in]   rx_max      Largest number of bytes to receive.
+ */
+void test_uarte_pty_poll(size_t rx_max);
+
+
+/**@brief Function for losing the next transfers at a baud rate, as a line that cannot carry it.
+ *
+ * @param[in]   baudrate    Baud rate of the transfers lost.
+ * @param[in]   count       Transfers to lose, UINT32_MAX for all of them.
+ */
+void test_uarte_tx_drop(uint32_t baudrate, uint32_t count);
+
+
+/**@brief Function for holding the transfers back in @ref test_uarte_pty_poll, as the host does with CTS.
+ *
+ * @param[in]   hold        The transfer in progress does not complete until released.
+ */
+void test_uarte_tx_hold(bool hold);
+
+
+/**@brief Function for setting the time app_timer runs on. */
+void test_time_set(uint64_t time_us);
+
+
+/**@brief Function for getting the time app_timer runs on. */
+uint64_t test_time_us(void);
+
+
+/**@brief Function for calling the handlers of the timers that expired at the current time. */
+void test_timers_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEST_SDK_H__
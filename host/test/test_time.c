@@ -0,0 +1,324 @@
+/***************************************************************************************/
+/*
+ * test_time
+ *
+ *  64-bit time base against a model of TIMER1. scan_time is built against the
+ *  stand-in SDK headers of test/sdk, whose timer functions are those of the model:
+ *  every register access takes some time, the counter wraps, the compare event of
+ *  the wrap is raised as the counter reaches 0, and the interrupt is taken on a
+ *  register access outside a critical region, some time after the event. So the
+ *  counter crosses the wrap while the event is pending and not serviced yet, between
+ *  the capture and the check of the event, and many reads after the wrap come before
+ *  its interrupt. Each time read must be the model time at some point of the call,
+ *  and no time may be earlier than the one before it.
+ *
+ *  scan_time.c is included, so the test can check the wrap count.
+*/
+/***************************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include "scan_time.c"
+#include "test.h"
+
+#define ROUNDS          4000                                            /**< Wraps crossed. */
+#define READS           200                                             /**< Reads around each wrap. */
+#define GAP_LONG        (1UL << 20)                                     /**< Longest time between two reads. */
+
+/**@brief Model of TIMER1. */
+typedef struct
+{
+    uint64_t time;                                                      /**< Ticks since the start, the counter is the low 32 bits. */
+    bool     running;
+    uint32_t cc[NRF_TIMER_CC_CHANNEL_COUNT];
+    bool     compare[NRF_TIMER_CC_CHANNEL_COUNT];                       /**< Compare events. */
+    uint32_t inten;
+    bool     irq_enabled;
+    uint8_t  masked;                                                    /**< Critical region depth. */
+    bool     in_irq;
+    uint32_t access_max;                                                /**< Longest register access, in ticks. */
+    uint32_t service_after;                                             /**< Accesses before a pending interrupt is taken. */
+    bool     capture_pending;                                           /**< The wrap event was pending at the last capture. */
+    bool     check_pending;                                             /**< It was found pending at the last check out of the interrupt. */
+    uint32_t state;                                                     /**< Random state of the access times. */
+} timer_model_t;
+
+NRF_TIMER_Type test_timer1;
+CoreDebug_Type test_core_debug;
+DWT_Type       test_dwt;
+
+static timer_model_t m_timer;
+
+
+/**@brief Function for running the model for a number of ticks. */
+static void timer_advance(uint32_t ticks)
+{
+    uint32_t counter = (uint32_t)m_timer.time;
+
+    if (!m_timer.running)
+    {
+        return;
+    }
+    m_timer.time += ticks;
+
+    // The counter went through counter + 1 .. counter + ticks.
+    for (uint32_t ch = 0; ch < NRF_TIMER_CC_CHANNEL_COUNT; ch++)
+    {
+        if ((uint32_t)(m_timer.cc[ch] - counter - 1) < ticks)
+        {
+            m_timer.compare[ch] = true;
+        }
+    }
+}
+
+
+/**@brief Function for taking the interrupt, once it has been pending long enough. */
+static void timer_irq_check(void)
+{
+    if (!m_timer.irq_enabled || (m_timer.masked > 0) || m_timer.in_irq ||
+        !(m_timer.inten & NRF_TIMER_INT_COMPARE1_MASK) || !m_timer.compare[NRF_TIMER_CC_CHANNEL1])
+    {
+        return;
+    }
+    if (m_timer.service_after > 0)
+    {
+        m_timer.service_after--;
+        return;
+    }
+
+    m_timer.in_irq = true;
+    TIMER1_IRQHandler();
+    m_timer.in_irq = false;
+}
+
+
+/**@brief Function for a register access, which takes some time. */
+static void timer_access(void)
+{
+    timer_advance(test_rand(&m_timer.state) % (m_timer.access_max + 1));
+    timer_irq_check();
+}
+
+
+void nrf_timer_task_trigger(NRF_TIMER_Type * p_reg, nrf_timer_task_t task)
+{
+    CHECK(p_reg == NRF_TIMER1);
+    timer_access();
+
+    switch (task)
+    {
+        case NRF_TIMER_TASK_START:
+            m_timer.running = true;
+            break;
+
+        case NRF_TIMER_TASK_STOP:
+            m_timer.running = false;
+            break;
+
+        case NRF_TIMER_TASK_CLEAR:
+            m_timer.time = 0;
+            break;
+
+        default:
+            CHECK(task >= NRF_TIMER_TASK_CAPTURE0);
+            CHECK(task < NRF_TIMER_TASK_CAPTURE0 + 4 * NRF_TIMER_CC_CHANNEL_COUNT);
+            m_timer.cc[(task - NRF_TIMER_TASK_CAPTURE0) / 4] = (uint32_t)m_timer.time;
+            m_timer.capture_pending = m_timer.compare[NRF_TIMER_CC_CHANNEL1];
+            break;
+    }
+}
+
+
+nrf_timer_task_t nrf_timer_capture_task_get(uint32_t channel)
+{
+    return (nrf_timer_task_t)(NRF_TIMER_TASK_CAPTURE0 + 4 * channel);
+}
+
+
+uint32_t nrf_timer_cc_read(NRF_TIMER_Type * p_reg, nrf_timer_cc_channel_t cc_channel)
+{
+    timer_access();
+
+    return m_timer.cc[cc_channel];
+}
+
+
+void nrf_timer_cc_write(NRF_TIMER_Type * p_reg, nrf_timer_cc_channel_t cc_channel, uint32_t cc_value)
+{
+    timer_access();
+    m_timer.cc[cc_channel] = cc_value;
+}
+
+
+bool nrf_timer_event_check(NRF_TIMER_Type * p_reg, nrf_timer_event_t event)
+{
+    bool raised;
+
+    timer_access();
+    raised = m_timer.compare[(event - NRF_TIMER_EVENT_COMPARE0) / 4];
+    if (!m_timer.in_irq)
+    {
+        m_timer.check_pending = raised;
+    }
+
+    return raised;
+}
+
+
+void nrf_timer_event_clear(NRF_TIMER_Type * p_reg, nrf_timer_event_t event)
+{
+    timer_access();
+    m_timer.compare[(event - NRF_TIMER_EVENT_COMPARE0) / 4] = false;
+}
+
+
+void nrf_timer_mode_set(NRF_TIMER_Type * p_reg, nrf_timer_mode_t mode)
+{
+    CHECK_EQ(mode, NRF_TIMER_MODE_TIMER);
+}
+
+
+void nrf_timer_bit_width_set(NRF_TIMER_Type * p_reg, nrf_timer_bit_width_t bit_width)
+{
+    CHECK_EQ(bit_width, NRF_TIMER_BIT_WIDTH_32);
+}
+
+
+void nrf_timer_frequency_set(NRF_TIMER_Type * p_reg, nrf_timer_frequency_t frequency)
+{
+    CHECK_EQ(frequency, NRF_TIMER_FREQ_1MHz);
+}
+
+
+void nrf_timer_int_enable(NRF_TIMER_Type * p_reg, uint32_t timer_int)
+{
+    m_timer.inten |= timer_int;
+}
+
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn)
+{
+    CHECK_EQ(irqn, TIMER1_IRQn);
+}
+
+
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority)
+{
+    CHECK_EQ(irqn, TIMER1_IRQn);
+}
+
+
+void NVIC_EnableIRQ(IRQn_Type irqn)
+{
+    CHECK_EQ(irqn, TIMER1_IRQn);
+    m_timer.irq_enabled = true;
+}
+
+
+uint8_t test_critical_enter(void)
+{
+    return m_timer.masked++;
+}
+
+
+void test_critical_exit(uint8_t nested)
+{
+    m_timer.masked = nested;
+    timer_irq_check();
+}
+
+
+uint32_t sd_clock_hfclk_request(void)
+{
+    return NRF_SUCCESS;
+}
+
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "%s:%u: error 0x%x\n", (char const *)p_file_name, line_num, error_code);
+    exit(EXIT_FAILURE);
+}
+
+
+int main(void)
+{
+    uint32_t state     = 1;
+    uint64_t last      = 0;
+    uint32_t corrected = 0;                                             /**< Reads after a wrap, before its interrupt. */
+    uint32_t wrapped   = 0;                                             /**< Reads that saw the event raised after the capture. */
+
+    m_timer.state = 5;
+    scan_time_init();
+    CHECK(m_timer.running);
+    CHECK(test_core_debug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk);
+    CHECK(test_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk);
+
+    for (uint32_t round = 0; round < ROUNDS; round++)
+    {
+        uint32_t wraps = (uint32_t)(m_timer.time >> 32);
+
+        // Just before the next wrap, the last interrupt taken.
+        CHECK(!m_timer.compare[NRF_TIMER_CC_CHANNEL1]);
+        CHECK_EQ(m_wraps, wraps);
+        m_timer.time = ((uint64_t)(wraps + 1) << 32) - 1 - test_rand(&state) % 64;
+
+        // Register accesses of a few ticks or a few dozens, an interrupt taken at once,
+        // soon, or long after the wrap.
+        m_timer.access_max = (round % 2) ? 3 : 40;
+        switch (round % 3)
+        {
+            case 0:
+                m_timer.service_after = 0;
+                break;
+
+            case 1:
+                m_timer.service_after = test_rand(&state) % 8;
+                break;
+
+            default:
+                m_timer.service_after = 100 + test_rand(&state) % 4000;
+                break;
+        }
+
+        for (uint32_t i = 0; i < READS; i++)
+        {
+            uint64_t before = m_timer.time;
+            uint64_t now    = scan_time_us_get();
+            uint64_t after  = m_timer.time;
+
+            CHECK((now >= before) && (now <= after));
+            CHECK(now >= last);
+            if ((now < before) || (now > after) || (now < last))
+            {
+                fprintf(stderr, "read %u of round %u: %llx not in %llx..%llx, last %llx\n", i, round,
+                        (unsigned long long)now, (unsigned long long)before, (unsigned long long)after,
+                        (unsigned long long)last);
+                return test_result("test_time");
+            }
+            last = now;
+
+            corrected += m_timer.capture_pending && ((uint32_t)now < (1UL << 31));
+            wrapped   += !m_timer.capture_pending && m_timer.check_pending;
+
+            // The rest of the main loop, now and then for long.
+            timer_advance((test_rand(&state) % 16 == 0) ? test_rand(&state) % GAP_LONG
+                                                        : test_rand(&state) % 64);
+            timer_irq_check();
+        }
+
+        // The interrupt is taken before the next wrap.
+        m_timer.service_after = 0;
+        timer_irq_check();
+    }
+
+    // Both sides of the wrap were read with the event pending.
+    CHECK(corrected > ROUNDS * 10);
+    CHECK(wrapped > 0);
+    CHECK_EQ(m_wraps, ROUNDS);
+
+    printf("test_time: %u wraps, %u reads before the interrupt, %u wraps between capture and check\n",
+           m_wraps, corrected, wrapped);
+
+    return test_result("test_time");
+}
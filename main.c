@@ -14,47 +14,81 @@
 #include <stdio.h>
 #include <string.h>
 #include "nordic_common.h"
+#include "nrf.h"
 #include "nrf_sdm.h"
 #include "ble.h"
 #include "ble_hci.h"
-#include "ble_db_discovery.h"
 #include "ble_srv_common.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
-#include "nrf_sdh_soc.h"
 #include "nrf_pwr_mgmt.h"
 #include "app_util.h"
 #include "app_error.h"
-#include "ble_dis_c.h"
-#include "ble_rscs_c.h"
 #include "app_util.h"
+#include "app_util_platform.h"
 #include "app_timer.h"
-#include "bsp_btn_ble.h"
-#include "peer_manager.h"
-#include "peer_manager_handler.h"
-#include "fds.h"
-#include "nrf_fstorage.h"
-#include "ble_conn_state.h"
-#include "nrf_ble_gatt.h"
 #include "nrf_pwr_mgmt.h"
-#include "nrf_ble_scan.h"
+#include "scan_adapt.h"
+#include "scan_agg.h"
+#include "scan_beacon.h"
+#include "scan_chain.h"
+#include "scan_cmd.h"
+#include "scan_dedup.h"
+#include "scan_filter.h"
+#include "scan_frame.h"
+#include "scan_output.h"
+#include "scan_phy.h"
+#include "scan_report.h"
+#include "scan_ring.h"
+#include "scan_time.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
 
-#define APP_BLE_CONN_CFG_TAG        1                                   /**< Tag that identifies the BLE configuration of the SoftDevice. */
 #define APP_BLE_OBSERVER_PRIO       3                                   /**< BLE observer priority of the application. There is no need to modify this value. */
-#define APP_SOC_OBSERVER_PRIO       1                                   /**< SoC observer priority of the application. There is no need to modify this value. */
+#define APP_BLE_TIME_OBSERVER_PRIO  0                                   /**< BLE observer priority of the report timestamping, ahead of every other observer. */
 
 #define SCAN_INTERVAL               0x0320                              /**< Determines scan interval in units of 0.625 millisecond. */
 #define SCAN_WINDOW                 0x0320                              /**< Determines scan window in units of 0.625 millisecond. */
 #define SCAN_DURATION           	0x0000                              /**< Duration of the scanning in units of 10 milliseconds. If set to 0x0000, scanning continues until it is explicitly disabled. */
 
-NRF_BLE_SCAN_DEF(m_scan);                                   /**< Scanning Module instance. */
+#define SCAN_TIMEOUT_UNIT_MS        10                                  /**< Unit of the scan timeout. */
 
-static bool                  m_memory_access_in_progress;   /**< Flag to keep track of ongoing operations on persistent memory. */
+#define ADAPT_HOLD_MIN              2                                   /**< Periods the scan window is held after a cut, at first. */
+#define ADAPT_HOLD_MAX              64                                  /**< Periods the scan window is held after a cut, at most. */
+
+#define DEDUP_SWEEP_INTERVAL_US     250000                              /**< Interval between two sweeps of the duplicate table, in microseconds. */
+#define DEDUP_ENABLED               (SCANNER_DEDUP_ENABLED && !SCANNER_RSSI_AGG_ENABLED)   /**< RSSI summaries replace the reports, there is nothing to deduplicate. */
+#define PROFILE_ENABLED             (SCANNER_STATS_ENABLED && SCANNER_PROFILE_ENABLED)     /**< The profile record follows the statistics record. */
+#define BEACON_ENABLED              (SCANNER_BEACON_ENABLED && (SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY))  /**< The text output keeps the hexdump. */
+#define OUTPUT_FLAGS_BUILT          ((DEDUP_ENABLED ? SCAN_OUTPUT_FLAG_DEDUP : 0)                    \
+                                   | (BEACON_ENABLED ? SCAN_OUTPUT_FLAG_BEACON : 0)                  \
+                                   | (SCANNER_RSSI_AGG_ENABLED ? SCAN_OUTPUT_FLAG_RSSI_AGG : 0))     /**< Output modes the host can switch on, all of them at boot. */
+#define SCAN_INTERVAL_MIN           (2 * BLE_GAP_SCAN_WINDOW_MIN)       /**< Shortest interval accepted from the host, room for a window on each PHY. */
+
+#if SCANNER_CHAIN_ENABLED
+SCAN_CHAIN_DEF(m_chain, SCANNER_CHAIN_COUNT);               /**< Extended advertising chains being reassembled. */
+#endif
+#if DEDUP_ENABLED
+SCAN_DEDUP_DEF(m_dedup, SCANNER_DEDUP_TABLE_SIZE);          /**< Advertisers whose duplicate reports are dropped. */
+static uint64_t              m_dedup_sweep_us;              /**< Time of the next sweep of the duplicate table. */
+
+STATIC_ASSERT(IS_POWER_OF_TWO(SCANNER_DEDUP_TABLE_SIZE));
+#endif
+#if SCANNER_FILTER_ENABLED
+SCAN_FILTER_DEF(m_filter, SCANNER_FILTER_COUNT);            /**< Filters the reports go through before being queued. */
+
+STATIC_ASSERT(SCANNER_FILTER_COUNT <= SCAN_FILTER_COUNT_MAX);
+#endif
+#if SCANNER_RSSI_AGG_ENABLED
+SCAN_AGG_DEF(m_agg, SCANNER_RSSI_AGG_DEVICES);              /**< RSSI of the devices heard in the current window. */
+
+STATIC_ASSERT(IS_POWER_OF_TWO(SCANNER_RSSI_AGG_DEVICES) && (SCANNER_RSSI_AGG_DEVICES < 0xFFFF));
+#endif
+
+STATIC_ASSERT(SCANNER_REPORT_DATA_MAX >= BLE_GAP_SCAN_BUFFER_EXTENDED_MIN);
 
 static ble_gap_scan_params_t m_scan_param =                 /**< Scan parameters requested for scanning and connection. */
 {
@@ -63,13 +97,151 @@ static ble_gap_scan_params_t m_scan_param =                 /**< Scan parameters
     .window        = SCAN_WINDOW,
     .filter_policy = BLE_GAP_SCAN_FP_ACCEPT_ALL,
     .timeout       = SCAN_DURATION,
-//    .scan_phys     = BLE_GAP_PHY_CODED,                                 // Choose only one of the following scan_phys
-    .scan_phys     = BLE_GAP_PHY_1MBPS,
-//    .scan_phys     = BLE_GAP_PHY_2MBPS,
+    .scan_phys     = BLE_GAP_PHY_1MBPS,                      // Set by the PHY schedule.
     .extended      = 1,
 };
 
+/**@brief Primary PHYs scanned. Extended advertisements are followed on the secondary
+ *        channels whatever their PHY, 2M included.
+ */
+static scan_phy_step_t       m_phy_steps[SCAN_PHY_STEPS_MAX] =
+{
+#if SCANNER_PHY_ROTATE_ENABLED
+    { .phys = BLE_GAP_PHY_1MBPS, .dwell_ms = SCANNER_PHY_DWELL_1M_MS },
+    { .phys = BLE_GAP_PHY_CODED, .dwell_ms = SCANNER_PHY_DWELL_CODED_MS },
+#else
+    { .phys = SCANNER_SCAN_PHYS, .dwell_ms = 0 },
+#endif
+};
+static uint8_t               m_phy_step_count = SCANNER_PHY_ROTATE_ENABLED ? 2 : 1;  /**< Steps in use, the host can change them. */
+
+static scan_phy_sched_t      m_phy_sched;                   /**< Current step of the PHY schedule. */
+static uint16_t              m_scan_window = SCAN_WINDOW;   /**< Scan window, set by the window controller. */
+static uint16_t              m_scan_window_max = SCAN_WINDOW;   /**< Scan window requested, the widest the controller opens. */
+static volatile bool         m_scanning;                    /**< Scanning has been started and not stopped by the host. */
+#if OUTPUT_FLAGS_BUILT || (SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY)
+static uint8_t               m_output_flags = OUTPUT_FLAGS_BUILT;   /**< Records sent, @ref SCAN_OUTPUT_FLAGS. */
+#endif
+
+/**@brief Counters of the report pipeline, reported in the statistics record. */
+static struct
+{
+    uint32_t reports_sent;                                  /**< Advertising reports queued for output. */
+    uint32_t summaries_sent;                                /**< ALIVE and RSSI summaries queued for output. */
+    uint32_t drop_output;                                   /**< Reports the output refused. */
+    uint32_t drop_filtered;                                 /**< Reassembled chains the report filters rejected. */
+    uint64_t sleep_us;                                      /**< Time spent sleeping in the main loop. */
+} m_counters;
+
+#if SCANNER_STATS_ENABLED
+APP_TIMER_DEF(m_stats_timer);                               /**< Period of the statistics record. */
+static volatile bool         m_stats_pending;               /**< A statistics record is due. */
+#endif
+
+#if PROFILE_ENABLED
+/**@brief CPU cycles spent on the reports, reported in the profile record. */
+static struct
+{
+    uint32_t adv_reports;                                   /**< Reports handled by the BLE observer. */
+    uint64_t adv_report_cycles;                             /**< Cycles the BLE observer spent on them. */
+    uint32_t adv_report_cycles_max;                         /**< Longest report since the last record. */
+    uint64_t loop_cycles;                                   /**< Cycles the main loop was awake. */
+    uint32_t wake_cycles;                                   /**< Cycle counter when the main loop last woke up. */
+} m_profile;
+static bool                  m_profile_pending;             /**< A profile record is due. */
+#endif
+
+#if SCANNER_ADAPT_ENABLED
+APP_TIMER_DEF(m_adapt_timer);                               /**< Period of the scan window controller. */
+static scan_adapt_t          m_adapt;                       /**< Scan window controller. */
+static volatile bool         m_adapt_pending;               /**< A period of the controller has ended. */
+#endif
+
+static uint64_t              m_adv_report_us;               /**< Dispatch time of the advertising report being handled. */
+
+static uint8_t               m_scan_spare[SCANNER_REPORT_DATA_MAX]; /**< Scan buffer lent when the report queue is full, and when scanning starts. */
+static ble_data_t            m_scan_buffer;                 /**< Scan buffer lent to the SoftDevice. */
+
+static void scan_params_phy_set(scan_phy_step_t const * p_step);
 static void scan_start(void);
+static void scan_resume(void);
+static void scan_apply(void);
+#if SCANNER_ADAPT_ENABLED
+static void adapt_reset(void);
+#endif
+
+
+/**@brief Function for checking an advertising report against the report filters.
+ *
+ * @return true if the report is kept.
+ */
+static bool report_filter_check(ble_gap_evt_adv_report_t const * p_adv_report)
+{
+#if SCANNER_FILTER_ENABLED
+    scan_filter_report_t report =
+    {
+        .timestamp_us = m_adv_report_us,
+        .p_addr       = p_adv_report->peer_addr.addr,
+        .addr_type    = p_adv_report->peer_addr.addr_type,
+        .p_data       = p_adv_report->data.p_data,
+        .len          = p_adv_report->data.len,
+        .rssi         = p_adv_report->rssi,
+        .set_id       = p_adv_report->set_id,
+        .extended     = p_adv_report->type.extended_pdu,
+        .scan_rsp     = p_adv_report->type.scan_response,
+        .status       = p_adv_report->type.status,
+    };
+
+    return scan_filter_check(&m_filter, &report);
+#else
+    return true;
+#endif
+}
+
+
+#if SCANNER_FILTER_ENABLED && SCANNER_CHAIN_ENABLED
+/**@brief Function for judging a reassembled chain on its whole data.
+ *
+ * @details The observer judges the first fragment of a chain on the data it holds, and
+ *          keeps the chain when that does not decide. Runs in the main loop, which is
+ *          the only one to change the filters.
+ *
+ * @return true if the report is kept.
+ */
+static bool report_chain_filter_check(scan_report_hdr_t const * p_hdr, uint8_t const * p_data)
+{
+    scan_filter_report_t report =
+    {
+        .timestamp_us = p_hdr->timestamp_us,
+        .p_addr       = p_hdr->addr,
+        .addr_type    = p_hdr->addr_type,
+        .p_data       = p_data,
+        .len          = p_hdr->data_len,
+        .rssi         = p_hdr->rssi,
+        .set_id       = p_hdr->set_id,
+        .extended     = true,
+    };
+
+    return scan_filter_match(&m_filter, &report);
+}
+#endif
+
+
+/**@brief Function for timestamping the advertising reports.
+ *
+ * @details Runs first for every BLE event, so the timestamp does not depend on the
+ *          time the other observers take.
+ *
+ * @param[in]   p_ble_evt   Bluetooth stack event.
+ * @param[in]   p_context   Unused.
+ */
+static void ble_time_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_REPORT)
+    {
+        m_adv_report_us = scan_time_us_get();
+    }
+}
 
 
 /**@brief Function for handling BLE events.
@@ -84,44 +256,106 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     {
         case BLE_GAP_EVT_ADV_REPORT:
         {
-            NRF_LOG_RAW_HEXDUMP_INFO (m_scan.scan_buffer.p_data, m_scan.scan_buffer.len);
-            NRF_LOG_RAW_INFO ("----------------------------------\r\n");
-        }
+#if PROFILE_ENABLED
+            uint32_t cycles = scan_time_cycles_get();
+#endif
+            // The data is already in the queue slot lent to the SoftDevice, only the
+            // header is filled here. It is formatted and sent from the main loop. A
+            // report the filters reject leaves the slot to the next one.
+            ble_gap_evt_adv_report_t const * p_adv_report = &p_ble_evt->evt.gap_evt.params.adv_report;
 
-        default:
-            break;
-    }
-}
+            if (report_filter_check(p_adv_report))
+            {
+                scan_ring_slot_t * p_slot = scan_ring_alloc();
 
+                if (p_slot != NULL)
+                {
+                    uint16_t len = MIN(p_adv_report->data.len, sizeof(p_slot->data));
 
-/**
- * @brief SoftDevice SoC event handler.
- *
- * @param[in] evt_id    SoC event.
- * @param[in] p_context Context.
- */
-static void soc_evt_handler(uint32_t evt_id, void * p_context)
-{
-    switch (evt_id)
-    {
-        case NRF_EVT_FLASH_OPERATION_SUCCESS:
-        /* fall through */
-        case NRF_EVT_FLASH_OPERATION_ERROR:
+                    // Received into the spare buffer: the queue was full, or scanning has
+                    // just been started. A slot freed since then takes a copy; this only
+                    // happens on the report after an overflow or a scan start.
+                    if (p_adv_report->data.p_data != p_slot->data)
+                    {
+                        memcpy(p_slot->data, p_adv_report->data.p_data, len);
+                    }
+                    scan_report_hdr_fill(p_adv_report, m_adv_report_us, &p_slot->hdr);
+                    p_slot->hdr.data_len = len;
+                    scan_ring_publish();
+                }
+                else
+                {
+                    scan_ring_drop();
+                }
+            }
+
+            scan_resume();
+
+#if PROFILE_ENABLED
+            cycles = scan_time_cycles_get() - cycles;
+            m_profile.adv_reports++;
+            m_profile.adv_report_cycles    += cycles;
+            m_profile.adv_report_cycles_max = MAX(m_profile.adv_report_cycles_max, cycles);
+#endif
+        } break;
 
-            if (m_memory_access_in_progress)
+        case BLE_GAP_EVT_TIMEOUT:
+            // Unless the host stopped scanning meanwhile.
+            if ((p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN) && m_scanning)
             {
-                m_memory_access_in_progress = false;
+                // The dwell time of the current PHY is over.
+                scan_phy_step_t const * p_step = scan_phy_sched_next(&m_phy_sched, scan_time_us_get());
+
+                scan_params_phy_set(p_step);
+                NRF_LOG_DEBUG("Scanning PHY 0x%x.", p_step->phys);
                 scan_start();
             }
             break;
 
         default:
-            // No implementation needed.
             break;
     }
 }
 
 
+/**@brief Function for configuring the BLE stack for scanning only.
+ *
+ * @details No connection can be made, there are no vendor specific UUIDs and the
+ *          attribute table has the smallest size the SoftDevice accepts, so that the
+ *          SoftDevice takes as little RAM as possible.
+ *
+ * @param[in] ram_start Start address of the application RAM.
+ */
+static void ble_cfg_set(uint32_t ram_start)
+{
+    ret_code_t err_code;
+    ble_cfg_t  ble_cfg;
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.gap_cfg.role_count_cfg.adv_set_count      = BLE_GAP_ADV_SET_COUNT_DEFAULT;
+    ble_cfg.gap_cfg.role_count_cfg.periph_role_count  = 0;
+    ble_cfg.gap_cfg.role_count_cfg.central_role_count = 0;
+    ble_cfg.gap_cfg.role_count_cfg.central_sec_count  = 0;
+    err_code = sd_ble_cfg_set(BLE_GAP_CFG_ROLE_COUNT, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.common_cfg.vs_uuid_cfg.vs_uuid_count = 0;
+    err_code = sd_ble_cfg_set(BLE_COMMON_CFG_VS_UUID, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.gatts_cfg.attr_tab_size.attr_tab_size = BLE_GATTS_ATTR_TAB_SIZE_MIN;
+    err_code = sd_ble_cfg_set(BLE_GATTS_CFG_ATTR_TAB_SIZE, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.gatts_cfg.service_changed.service_changed = 0;
+    err_code = sd_ble_cfg_set(BLE_GATTS_CFG_SERVICE_CHANGED, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for initializing the BLE stack.
  *
  * @details Initializes the SoftDevice and the BLE event interrupt.
@@ -133,73 +367,125 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_enable_request();
     APP_ERROR_CHECK(err_code);
 
-    // Configure the BLE stack using the default settings.
+    // Configure the BLE stack for scanning only.
     // Fetch the start address of the application RAM.
     uint32_t ram_start = 0;
-    err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
+    err_code = nrf_sdh_ble_app_ram_start_get(&ram_start);
     APP_ERROR_CHECK(err_code);
+    ble_cfg_set(ram_start);
 
-    // Enable BLE stack.
+    // Enable BLE stack. The SoftDevice writes back the RAM it actually needs, and
+    // nrf_sdh_ble_enable logs it when APP_RAM_START of the linker script differs.
+    uint32_t const app_ram_start = ram_start;
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
-    // Register handlers for BLE and SoC events.
+    // Whatever the SoftDevice does not take belongs to the report arena: a start
+    // above what it needs would waste RAM unnoticed, so stop here as for too little.
+    if (ram_start != app_ram_start)
+    {
+        NRF_LOG_ERROR("APP_RAM_START is 0x%08x, set it to 0x%08x in the linker script.",
+                      app_ram_start, ram_start);
+        APP_ERROR_CHECK(NRF_ERROR_INVALID_STATE);
+    }
+
+    // The time base asks the SoftDevice for the crystal oscillator.
+    scan_time_init();
+
+    // Register handlers for BLE events.
+    NRF_SDH_BLE_OBSERVER(m_ble_time_observer, APP_BLE_TIME_OBSERVER_PRIO, ble_time_evt_handler, NULL);
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
-    NRF_SDH_SOC_OBSERVER(m_soc_observer, APP_SOC_OBSERVER_PRIO, soc_evt_handler, NULL);
 }
 
 
-/**@brief Function for handling Scanning Module events.
+/**@brief Function for setting the scan parameters of a step of the PHY schedule.
+ *
+ * @details The timeout of the scan is the dwell time of the step. When both PHYs are
+ *          scanned at once, each one gets half of the interval.
  */
-static void scan_evt_handler(scan_evt_t const * p_scan_evt)
+static void scan_params_phy_set(scan_phy_step_t const * p_step)
 {
-    switch(p_scan_evt->scan_evt_id)
-    {
-        case NRF_BLE_SCAN_EVT_SCAN_TIMEOUT:
-        {
-            NRF_LOG_INFO("Scan timed out.");
-            scan_start();
-        } break;
-
-        default:
-          break;
-    }
+    m_scan_param.scan_phys = p_step->phys;
+    m_scan_param.timeout   = (uint16_t)(p_step->dwell_ms / SCAN_TIMEOUT_UNIT_MS);
+    m_scan_param.window    = (p_step->phys == (BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_CODED))
+                           ? MIN(m_scan_window, m_scan_param.interval / 2)
+                           : m_scan_window;
 }
 
 
-/**@brief Function for initializing the scanning and setting the filters.
+/**@brief Function for initializing the scan parameters with the first step of the PHY schedule.
  */
 static void scan_init(void)
 {
-    ret_code_t          err_code;
-    nrf_ble_scan_init_t init_scan;
+    scan_params_phy_set(scan_phy_sched_init(&m_phy_sched, m_phy_steps, m_phy_step_count,
+                                            scan_time_us_get()));
+}
+
+
+/**@brief Function for starting scanning, or restarting it with new parameters.
+ *
+ * @details Scanning starts with the spare buffer. A report of the previous scan may
+ *          still be on its way to the observer, in the slot that was lent for it, so
+ *          that slot cannot be lent again until the report has been published.
+ */
+static void scan_start(void)
+{
+    ret_code_t err_code;
+
+    // Not scanning after a timeout.
+    (void)sd_ble_gap_scan_stop();
 
-    memset(&init_scan, 0, sizeof(init_scan));
+    m_scan_buffer.p_data = m_scan_spare;
+    m_scan_buffer.len    = sizeof(m_scan_spare);
 
-    init_scan.connect_if_match = false;
-    init_scan.conn_cfg_tag     = APP_BLE_CONN_CFG_TAG;
-    init_scan.p_scan_param     = &m_scan_param;
+#if SCANNER_FILTER_ENABLED
+    // The chains of the previous scan are not followed any further.
+    scan_filter_chains_reset(&m_filter, (uint64_t)SCANNER_CHAIN_TIMEOUT_MS * 1000);
+#endif
 
-    err_code = nrf_ble_scan_init(&m_scan, &init_scan, scan_evt_handler);
+    err_code = sd_ble_gap_scan_start(&m_scan_param, &m_scan_buffer);
     APP_ERROR_CHECK(err_code);
+    m_scanning = true;
 }
 
 
-/**@brief Function for starting scanning.
+/**@brief Function for applying new scan parameters, by restarting the current step of
+ *        the PHY schedule.
+ *
+ * @details Runs in a critical region, the BLE observer moves the schedule on. Nothing
+ *          is started while the host keeps scanning stopped, the parameters are used
+ *          when it starts it again.
  */
-static void scan_start(void)
+static void scan_apply(void)
 {
-    ret_code_t err_code;
-
-    // If there is any pending write to flash, defer scanning until it completes.
-    if (nrf_fstorage_is_busy(NULL))
+    CRITICAL_REGION_ENTER();
+    scan_params_phy_set(scan_phy_sched_current(&m_phy_sched));
+    if (m_scanning)
     {
-        m_memory_access_in_progress = true;
-        return;
+        scan_start();
     }
+    CRITICAL_REGION_EXIT();
+}
 
-    err_code = nrf_ble_scan_start(&m_scan);
-    APP_ERROR_CHECK(err_code);
+
+/**@brief Function for resuming scanning after an advertising report.
+ *
+ * @details The SoftDevice pauses after each report until it is given a buffer for the
+ *          next one: the next free slot of the report queue, so that the report needs
+ *          no copy, or the spare buffer if the queue is full. The slot is published by
+ *          the observer and released by the main loop once the report has been sent.
+ *
+ *          Fails when scanning was restarted while the report was on its way, which
+ *          is fine: the new scan already has a buffer.
+ */
+static void scan_resume(void)
+{
+    scan_ring_slot_t * p_slot = scan_ring_alloc();
+
+    m_scan_buffer.p_data = (p_slot != NULL) ? p_slot->data : m_scan_spare;
+    m_scan_buffer.len    = SCANNER_REPORT_DATA_MAX;
+
+    (void)sd_ble_gap_scan_start(NULL, &m_scan_buffer);
 }
 
 
@@ -213,11 +499,271 @@ static void log_init(void)
 }
 
 
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+#if SCANNER_FILTER_ENABLED
+/**@brief Function for handling @ref SCAN_CMD_FILTER_CLEAR and @ref SCAN_CMD_FILTER_ADD.
+ *
+ * @details The filters are changed in a critical region, the BLE observer checks
+ *          the reports against them.
+ */
+static uint8_t filter_cmd_handle(uint8_t cmd, uint8_t const * p_payload, uint16_t len)
+{
+    bool done;
+
+    if (cmd == SCAN_CMD_FILTER_CLEAR)
+    {
+        scan_cmd_filter_clear_t clear;
+
+        if (len != sizeof(clear))
+        {
+            return SCAN_CMD_STATUS_INVALID;
+        }
+        memcpy(&clear, p_payload, sizeof(clear));
+
+        CRITICAL_REGION_ENTER();
+        done = scan_filter_clear(&m_filter, clear.mode);
+        CRITICAL_REGION_EXIT();
+
+        return done ? SCAN_CMD_STATUS_OK : SCAN_CMD_STATUS_INVALID;
+    }
+    else
+    {
+        scan_filter_rule_t rule;
+
+        if (len != sizeof(rule))
+        {
+            return SCAN_CMD_STATUS_INVALID;
+        }
+        memcpy(&rule, p_payload, sizeof(rule));
+        if (!scan_filter_rule_is_valid(&rule))
+        {
+            return SCAN_CMD_STATUS_INVALID;
+        }
+
+        CRITICAL_REGION_ENTER();
+        done = scan_filter_add(&m_filter, &rule);
+        CRITICAL_REGION_EXIT();
+
+        return done ? SCAN_CMD_STATUS_OK : SCAN_CMD_STATUS_FULL;
+    }
+}
+#endif
+
+
+/**@brief Function for stopping scanning until the host starts it again. */
+static void scan_stop(void)
+{
+    CRITICAL_REGION_ENTER();
+    m_scanning = false;
+    (void)sd_ble_gap_scan_stop();
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for handling @ref SCAN_CMD_SCAN_PARAMS.
+ *
+ * @details The new window is also the widest the window controller opens, which
+ *          starts over from it.
+ */
+static uint8_t scan_params_cmd_handle(uint8_t const * p_payload, uint16_t len)
+{
+    scan_cmd_scan_params_t params;
+
+    if (len != sizeof(params))
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+    memcpy(&params, p_payload, sizeof(params));
+
+    if ((params.interval < SCAN_INTERVAL_MIN) || (params.window < BLE_GAP_SCAN_WINDOW_MIN)
+        || (params.window > params.interval) || (params.active > 1))
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+
+    CRITICAL_REGION_ENTER();
+    m_scan_param.interval = params.interval;
+    m_scan_param.active   = params.active;
+    m_scan_window_max     = params.window;
+    m_scan_window         = params.window;
+    CRITICAL_REGION_EXIT();
+
+#if SCANNER_ADAPT_ENABLED
+    adapt_reset();
+#endif
+    scan_apply();
+
+    return SCAN_CMD_STATUS_OK;
+}
+
+
+/**@brief Function for handling @ref SCAN_CMD_SCAN_PHYS.
+ *
+ * @details The PHY schedule starts over from its first step.
+ */
+static uint8_t scan_phys_cmd_handle(uint8_t const * p_payload, uint16_t len)
+{
+    scan_cmd_scan_phys_t phys;
+    bool                 rotate;
+
+    if (len != sizeof(phys))
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+    memcpy(&phys, p_payload, sizeof(phys));
+
+    // A dwell time shorter than the timeout unit would be no timeout at all.
+    if ((phys.phys == 0) || ((phys.phys & ~(BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_CODED)) != 0)
+        || ((phys.dwell_1m_ms != 0) && (phys.dwell_1m_ms < SCAN_TIMEOUT_UNIT_MS))
+        || ((phys.dwell_coded_ms != 0) && (phys.dwell_coded_ms < SCAN_TIMEOUT_UNIT_MS)))
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+    rotate = (phys.phys == (BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_CODED))
+          && (phys.dwell_1m_ms != 0) && (phys.dwell_coded_ms != 0);
+
+    CRITICAL_REGION_ENTER();
+    if (rotate)
+    {
+        m_phy_steps[0].phys     = BLE_GAP_PHY_1MBPS;
+        m_phy_steps[0].dwell_ms = phys.dwell_1m_ms;
+        m_phy_steps[1].phys     = BLE_GAP_PHY_CODED;
+        m_phy_steps[1].dwell_ms = phys.dwell_coded_ms;
+        m_phy_step_count        = 2;
+    }
+    else
+    {
+        m_phy_steps[0].phys     = phys.phys;
+        m_phy_steps[0].dwell_ms = 0;
+        m_phy_step_count        = 1;
+    }
+    (void)scan_phy_sched_init(&m_phy_sched, m_phy_steps, m_phy_step_count, scan_time_us_get());
+    CRITICAL_REGION_EXIT();
+
+    scan_apply();
+
+    return SCAN_CMD_STATUS_OK;
+}
+
+
+/**@brief Function for handling @ref SCAN_CMD_OUTPUT_MODE. */
+static uint8_t output_mode_cmd_handle(uint8_t const * p_payload, uint16_t len)
+{
+    scan_cmd_output_mode_t mode;
+
+    if (len != sizeof(mode))
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+    memcpy(&mode, p_payload, sizeof(mode));
+
+    if ((mode.flags & ~OUTPUT_FLAGS_BUILT) != 0)
+    {
+        return SCAN_CMD_STATUS_INVALID;
+    }
+    m_output_flags = mode.flags;
+
+    return SCAN_CMD_STATUS_OK;
+}
+
+
+/**@brief Function for handling the host commands that act on the scanner.
+ *
+ * @details Runs in the main loop. Scan parameters are applied by restarting scanning,
+ *          between two advertising reports.
+ */
+static uint8_t cmd_handler(uint8_t cmd, uint8_t const * p_payload, uint16_t len)
+{
+    switch (cmd)
+    {
+#if SCANNER_FILTER_ENABLED
+        case SCAN_CMD_FILTER_CLEAR:
+        case SCAN_CMD_FILTER_ADD:
+            return filter_cmd_handle(cmd, p_payload, len);
+#endif
+
+        case SCAN_CMD_SCAN_START:
+            if (len != 0)
+            {
+                return SCAN_CMD_STATUS_INVALID;
+            }
+            m_scanning = true;
+            scan_apply();
+            return SCAN_CMD_STATUS_OK;
+
+        case SCAN_CMD_SCAN_STOP:
+            if (len != 0)
+            {
+                return SCAN_CMD_STATUS_INVALID;
+            }
+            scan_stop();
+            return SCAN_CMD_STATUS_OK;
+
+        case SCAN_CMD_SCAN_PARAMS:
+            return scan_params_cmd_handle(p_payload, len);
+
+        case SCAN_CMD_SCAN_PHYS:
+            return scan_phys_cmd_handle(p_payload, len);
+
+        case SCAN_CMD_OUTPUT_MODE:
+            return output_mode_cmd_handle(p_payload, len);
+
+#if SCANNER_STATS_ENABLED
+        case SCAN_CMD_STATS_GET:
+            if (len != 0)
+            {
+                return SCAN_CMD_STATUS_INVALID;
+            }
+            // Sent after the response, from the main loop.
+            m_stats_pending = true;
+            return SCAN_CMD_STATUS_OK;
+#endif
+
+        default:
+            return SCAN_CMD_STATUS_UNSUPPORTED;
+    }
+}
+
+
+/**@brief Function for initializing the binary output of the advertising reports
+ *        and the handling of the host commands.
+ */
+static void output_init(void)
+{
+    ret_code_t err_code = scan_output_init();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = scan_cmd_init(cmd_handler);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+#if SCANNER_STATS_ENABLED
+/**@brief Function for handling the end of a statistics period.
+ *
+ * @details Runs in interrupt context, the record is made in the main loop.
+ */
+static void stats_timeout_handler(void * p_context)
+{
+    m_stats_pending = true;
+}
+#endif
+
+
 /**@brief Function for initializing the timer. */
 static void timer_init(void)
 {
     ret_code_t err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
+
+#if SCANNER_STATS_ENABLED
+    err_code = app_timer_create(&m_stats_timer, APP_TIMER_MODE_REPEATED, stats_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_stats_timer, APP_TIMER_TICKS(SCANNER_STATS_PERIOD_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+#endif
 }
 
 
@@ -231,15 +777,484 @@ static void power_management_init(void)
 }
 
 
+#if SCANNER_ADAPT_ENABLED
+/**@brief Function for handling the end of a period of the scan window controller.
+ *
+ * @details Runs in interrupt context, the controller itself runs in the main loop.
+ */
+static void adapt_timeout_handler(void * p_context)
+{
+    m_adapt_pending = true;
+}
+
+
+/**@brief Function for sampling the report queue for the scan window controller. */
+static void adapt_input_get(scan_adapt_input_t * p_input)
+{
+    scan_ring_stats_t stats;
+
+    scan_ring_stats_get(&stats);
+
+    p_input->published  = stats.published;
+    p_input->overflows  = stats.overflows;
+    p_input->queued     = scan_ring_count();
+    p_input->queue_size = scan_ring_size();
+}
+
+
+/**@brief Function for (re)starting the scan window controller from the requested window. */
+static void adapt_reset(void)
+{
+    scan_adapt_config_t const config =
+    {
+        .window_min = MIN(MSEC_TO_UNITS(SCANNER_ADAPT_WINDOW_MIN_MS, UNIT_0_625_MS), m_scan_window_max),
+        .window_max = m_scan_window_max,
+        .step       = MSEC_TO_UNITS(SCANNER_ADAPT_STEP_MS, UNIT_0_625_MS),
+        .hold_min   = ADAPT_HOLD_MIN,
+        .hold_max   = ADAPT_HOLD_MAX,
+    };
+    scan_adapt_input_t input;
+
+    adapt_input_get(&input);
+    scan_adapt_init(&m_adapt, &config, &input);
+}
+
+
+/**@brief Function for starting the scan window controller. */
+static void adapt_init(void)
+{
+    ret_code_t err_code;
+
+    adapt_reset();
+
+    err_code = app_timer_create(&m_adapt_timer, APP_TIMER_MODE_REPEATED, adapt_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_adapt_timer, APP_TIMER_TICKS(SCANNER_ADAPT_PERIOD_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for running the scan window controller once per period.
+ *
+ * @details A new window restarts scanning at once. When the PHYs are scanned in turns,
+ *          it is applied at the next PHY instead, so the dwell times are kept.
+ */
+static void adapt_process(void)
+{
+    scan_adapt_input_t input;
+    uint16_t           window;
+
+    if (!m_adapt_pending)
+    {
+        return;
+    }
+    m_adapt_pending = false;
+
+    adapt_input_get(&input);
+    window = scan_adapt_update(&m_adapt, &input);
+    if (window == m_scan_window)
+    {
+        return;
+    }
+
+    NRF_LOG_DEBUG("Scan window %u (%u reports).", window, m_adapt.rate);
+    m_scan_window = window;
+
+    if (scan_phy_sched_current(&m_phy_sched)->dwell_ms == 0)
+    {
+        scan_apply();
+    }
+}
+#endif
+
+
+#if DEDUP_ENABLED
+/**@brief Function for sending the summary of an advertiser whose reports are dropped. */
+static bool alive_send(scan_alive_t const * p_alive, void * p_context)
+{
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    if (scan_output_send(SCAN_FRAME_TYPE_ALIVE, p_alive, sizeof(*p_alive), NULL, 0) != NRF_SUCCESS)
+    {
+        return false;
+    }
+#else
+    NRF_LOG_RAW_HEXDUMP_INFO (p_alive->addr, sizeof(p_alive->addr));
+    NRF_LOG_RAW_INFO ("alive %d dBm, %u duplicates\r\n", p_alive->rssi, p_alive->count);
+#endif
+    m_counters.summaries_sent++;
+    return true;
+}
+
+
+/**@brief Function for sending the due summaries and forgetting the silent advertisers.
+ *
+ * @details The table is swept every DEDUP_SWEEP_INTERVAL_US. If the output fills up,
+ *          the sweep goes on from where it stopped the next time.
+ */
+static void dedup_process(void)
+{
+    uint64_t now_us = scan_time_us_get();
+
+    if (now_us < m_dedup_sweep_us)
+    {
+        return;
+    }
+
+    if (scan_dedup_sweep(&m_dedup, now_us, alive_send, NULL))
+    {
+        m_dedup_sweep_us = now_us + DEDUP_SWEEP_INTERVAL_US;
+    }
+}
+#endif
+
+
+#if SCANNER_RSSI_AGG_ENABLED
+/**@brief Function for sending the RSSI summary of a device. */
+static bool rssi_summary_send(scan_rssi_summary_t const * p_summary, void * p_context)
+{
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    if (scan_output_send(SCAN_FRAME_TYPE_RSSI_SUMMARY, p_summary, sizeof(*p_summary), NULL, 0) != NRF_SUCCESS)
+    {
+        return false;
+    }
+#else
+    NRF_LOG_RAW_HEXDUMP_INFO (p_summary->addr, sizeof(p_summary->addr));
+    NRF_LOG_RAW_INFO ("rssi %d/%d/%d dBm, %u reports\r\n",
+                      p_summary->rssi_min, p_summary->rssi_mean, p_summary->rssi_max, p_summary->count);
+#endif
+    m_counters.summaries_sent++;
+    return true;
+}
+#endif
+
+
+#if BEACON_ENABLED
+/**@brief Function for sending a report as a BEACON record, if its data holds a beacon.
+ *
+ * @return NRF_ERROR_NOT_FOUND if it does not, the result of scan_output_send otherwise.
+ */
+static ret_code_t beacon_send(scan_report_hdr_t const * p_hdr, uint8_t const * p_data)
+{
+    scan_beacon_hdr_t  beacon_hdr;
+    scan_beacon_body_t body;
+    scan_beacon_type_t type = scan_beacon_decode(p_data, p_hdr->data_len, &body);
+
+    if (type == SCAN_BEACON_NONE)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    beacon_hdr.timestamp_us = p_hdr->timestamp_us;
+    memcpy(beacon_hdr.addr, p_hdr->addr, sizeof(beacon_hdr.addr));
+    beacon_hdr.addr_type    = p_hdr->addr_type;
+    beacon_hdr.rssi         = p_hdr->rssi;
+    beacon_hdr.type         = type;
+
+    return scan_output_send(SCAN_FRAME_TYPE_BEACON,
+                            &beacon_hdr, sizeof(beacon_hdr),
+                            (uint8_t const *)&body, scan_beacon_body_len(type));
+}
+#endif
+
+
+/**@brief Function for formatting and sending one advertising report, reassembled if it was chained.
+ *
+ * @details With the RSSI aggregation on, the report only feeds it. With the beacon
+ *          decoding on, a beacon is sent decoded instead. The host can switch each
+ *          of them off, see @ref SCAN_CMD_OUTPUT_MODE.
+ *
+ * @return false if the output cannot take the report now.
+ */
+static bool report_send(scan_report_hdr_t const * p_hdr, uint8_t const * p_data, void * p_context)
+{
+#if SCANNER_FILTER_ENABLED && SCANNER_CHAIN_ENABLED
+    if ((p_hdr->flags & SCAN_REPORT_FLAG_EXTENDED_PDU) && !report_chain_filter_check(p_hdr, p_data))
+    {
+        m_counters.drop_filtered++;
+        return true;
+    }
+#endif
+#if SCANNER_RSSI_AGG_ENABLED
+    if (m_output_flags & SCAN_OUTPUT_FLAG_RSSI_AGG)
+    {
+        return scan_agg_add(&m_agg, p_hdr, rssi_summary_send, NULL);
+    }
+#endif
+#if DEDUP_ENABLED
+    if ((m_output_flags & SCAN_OUTPUT_FLAG_DEDUP)
+        && (scan_dedup_check(&m_dedup, p_hdr, p_data) == SCAN_DEDUP_DUPLICATE))
+    {
+        return true;
+    }
+#endif
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    ret_code_t err_code = NRF_ERROR_NOT_FOUND;
+#if BEACON_ENABLED
+    if (m_output_flags & SCAN_OUTPUT_FLAG_BEACON)
+    {
+        err_code = beacon_send(p_hdr, p_data);
+    }
+#endif
+    if (err_code == NRF_ERROR_NOT_FOUND)
+    {
+        err_code = scan_output_send(SCAN_FRAME_TYPE_ADV_REPORT,
+                                    p_hdr, sizeof(*p_hdr),
+                                    p_data, p_hdr->data_len);
+    }
+    if (err_code == NRF_ERROR_NO_MEM)
+    {
+        return false;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        m_counters.drop_output++;
+        return true;
+    }
+#else
+    NRF_LOG_RAW_HEXDUMP_INFO (p_data, p_hdr->data_len);
+    NRF_LOG_RAW_INFO ("----------------------------------\r\n");
+#endif
+    m_counters.reports_sent++;
+#if DEDUP_ENABLED
+    if (m_output_flags & SCAN_OUTPUT_FLAG_DEDUP)
+    {
+        scan_dedup_record(&m_dedup, p_hdr, p_data);
+    }
+#endif
+    return true;
+}
+
+
+/**@brief Function for formatting and sending the queued advertising reports.
+ *
+ * @details Stops when the output cannot take more data. The remaining reports stay
+ *          queued until the output drains, new reports are dropped by the ring
+ *          (and counted) if it fills up meanwhile. Whatever has been encoded is
+ *          then handed over to EasyDMA.
+ *
+ *          With SCANNER_CHAIN_ENABLED, the fragments of a chain are held until its
+ *          last one and sent together. With SCANNER_RSSI_AGG_ENABLED, the reports
+ *          only feed the RSSI aggregation and the summaries of the windows that
+ *          ended are sent instead.
+ */
+static void reports_process(void)
+{
+    scan_ring_slot_t const * p_slot;
+
+    while ((p_slot = scan_ring_peek()) != NULL)
+    {
+#if SCANNER_CHAIN_ENABLED
+        if (!scan_chain_add(&m_chain, &p_slot->hdr, p_slot->data, report_send, NULL))
+#else
+        if (!report_send(&p_slot->hdr, p_slot->data, NULL))
+#endif
+        {
+            break;
+        }
+        scan_ring_release();
+    }
+
+#if SCANNER_CHAIN_ENABLED
+    (void)scan_chain_flush(&m_chain, scan_time_us_get(), report_send, NULL);
+#endif
+
+#if SCANNER_RSSI_AGG_ENABLED
+    (void)scan_agg_flush(&m_agg, scan_time_us_get(), rssi_summary_send, NULL);
+#endif
+#if DEDUP_ENABLED
+    dedup_process();
+#endif
+
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    scan_output_flush();
+#endif
+}
+
+
+#if SCANNER_STATS_ENABLED
+/**@brief Function for sending the statistics record, once per period.
+ *
+ * @details If the output is full, the record is sent on the next wake up.
+ */
+static void stats_process(void)
+{
+    static uint64_t     last_us;
+    static uint64_t     last_sleep_us;
+    scan_stats_t        stats;
+    scan_ring_stats_t   ring;
+    uint64_t            elapsed_us;
+    uint64_t            sleep_us;
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    scan_output_stats_t output;
+#endif
+
+    if (!m_stats_pending)
+    {
+        return;
+    }
+
+    scan_ring_stats_get(&ring);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.timestamp_us     = scan_time_us_get();
+    stats.reports_received = ring.published + ring.overflows;
+    stats.reports_sent     = m_counters.reports_sent;
+    stats.summaries_sent   = m_counters.summaries_sent;
+    stats.drop_queue_full  = ring.overflows;
+    stats.drop_output      = m_counters.drop_output;
+    stats.queue_high_water = ring.high_water;
+    stats.queue_size       = (uint16_t)MIN(scan_ring_size(), UINT16_MAX);
+    stats.scan_window      = m_scan_window;
+#if DEDUP_ENABLED
+    stats.drop_duplicate   = m_dedup.duplicates;
+#endif
+#if SCANNER_FILTER_ENABLED
+    stats.drop_filtered     = m_filter.rejected + m_counters.drop_filtered;
+    stats.reports_received += m_filter.rejected;
+#endif
+
+    elapsed_us = stats.timestamp_us - last_us;
+    sleep_us   = m_counters.sleep_us - last_sleep_us;
+    if (elapsed_us > sleep_us)
+    {
+        stats.cpu_load = (uint16_t)((elapsed_us - sleep_us) * 10000 / elapsed_us);
+    }
+
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    scan_output_stats_get(&output);
+    stats.tx_bytes          = output.tx_bytes;
+    stats.tx_busy           = output.busy;
+    stats.output_high_water = output.fill_high_water;
+    stats.output_size       = SCANNER_OUTPUT_BUFFER_SIZE;
+
+    if (scan_output_send(SCAN_FRAME_TYPE_STATS, &stats, sizeof(stats), NULL, 0) != NRF_SUCCESS)
+    {
+        return;
+    }
+#else
+    NRF_LOG_INFO("%u reports, %u sent, %u dropped, %u duplicates, %u filtered.",
+                 stats.reports_received, stats.reports_sent, stats.drop_queue_full, stats.drop_duplicate,
+                 stats.drop_filtered);
+    NRF_LOG_INFO("Queue high water %u, CPU load %u.%02u%%.",
+                 stats.queue_high_water, stats.cpu_load / 100, stats.cpu_load % 100);
+#endif
+
+    m_stats_pending = false;
+    last_us         = stats.timestamp_us;
+    last_sleep_us   = m_counters.sleep_us;
+#if PROFILE_ENABLED
+    m_profile_pending = true;
+#endif
+}
+#endif
+
+
+#if PROFILE_ENABLED
+/**@brief Function for sending the profile record, after each statistics record.
+ *
+ * @details The binary record carries the counters since boot, the text output the
+ *          cycles per report over the last period. If the output is full, the record
+ *          is sent on the next wake up.
+ */
+static void profile_process(void)
+{
+    scan_profile_t profile;
+
+    if (!m_profile_pending)
+    {
+        return;
+    }
+
+    memset(&profile, 0, sizeof(profile));
+    profile.timestamp_us = scan_time_us_get();
+    profile.cpu_hz       = SystemCoreClock;
+    profile.loop_cycles  = m_profile.loop_cycles;
+
+    // Updated by the BLE observer.
+    CRITICAL_REGION_ENTER();
+    profile.adv_reports           = m_profile.adv_reports;
+    profile.adv_report_cycles     = m_profile.adv_report_cycles;
+    profile.adv_report_cycles_max = m_profile.adv_report_cycles_max;
+    CRITICAL_REGION_EXIT();
+
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    if (scan_output_send(SCAN_FRAME_TYPE_PROFILE, &profile, sizeof(profile), NULL, 0) != NRF_SUCCESS)
+    {
+        return;
+    }
+#else
+    static scan_profile_t last;
+    uint32_t              reports = MAX(profile.adv_reports - last.adv_reports, 1);
+
+    NRF_LOG_INFO("Profile: %u reports, %u cycles per report in the handler (max %u), %u in the main loop.",
+                 profile.adv_reports - last.adv_reports,
+                 (uint32_t)((profile.adv_report_cycles - last.adv_report_cycles) / reports),
+                 profile.adv_report_cycles_max,
+                 (uint32_t)((profile.loop_cycles - last.loop_cycles) / reports));
+    last = profile;
+#endif
+
+    m_profile_pending               = false;
+    m_profile.adv_report_cycles_max = 0;
+}
+
+
+/**@brief Function for counting the cycles the main loop has been awake since it woke up.
+ *
+ * @details Called on every pass, the main loop does not sleep while logs are pending.
+ */
+static void profile_loop_count(void)
+{
+    uint32_t cycles = scan_time_cycles_get();
+
+    m_profile.loop_cycles += cycles - m_profile.wake_cycles;
+    m_profile.wake_cycles  = cycles;
+}
+#endif
+
+
 /**@brief Function for handling the idle state (main loop).
  *
- * @details Handles any pending log operations, then sleeps until the next event occurs.
+ * @details Handles the host commands, sends the queued reports and the statistics and
+ *          handles any pending log operations, then sleeps until the next event occurs.
+ *          A new report, a received byte, the end of a UART transfer and the timers all
+ *          wake the CPU up. The time spent asleep is accounted for the CPU load, the
+ *          cycles spent awake for the profile.
  */
 static void idle_state_handle(void)
 {
-    if (NRF_LOG_PROCESS() == false)
+    bool log_pending;
+
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    scan_cmd_process();
+#endif
+#if SCANNER_ADAPT_ENABLED
+    adapt_process();
+#endif
+    reports_process();
+
+#if SCANNER_STATS_ENABLED
+    stats_process();
+#endif
+#if PROFILE_ENABLED
+    profile_process();
+#endif
+
+    log_pending = NRF_LOG_PROCESS();
+#if PROFILE_ENABLED
+    profile_loop_count();
+#endif
+
+    if (log_pending == false)
     {
+        uint64_t sleep_us = scan_time_us_get();
+
         nrf_pwr_mgmt_run();
+#if PROFILE_ENABLED
+        m_profile.wake_cycles = scan_time_cycles_get();
+#endif
+        m_counters.sleep_us += scan_time_us_get() - sleep_us;
     }
 }
 
@@ -249,19 +1264,40 @@ int main(void)
 {
 
     // Initialize.
+    scan_ring_init();
+#if DEDUP_ENABLED
+    scan_dedup_init(&m_dedup, (uint64_t)SCANNER_DEDUP_SUMMARY_MS * 1000,
+                    (uint64_t)SCANNER_DEDUP_EXPIRY_MS * 1000);
+#endif
+#if SCANNER_RSSI_AGG_ENABLED
+    scan_agg_init(&m_agg, (uint64_t)SCANNER_RSSI_AGG_WINDOW_MS * 1000);
+#endif
+#if SCANNER_CHAIN_ENABLED
+    scan_chain_init(&m_chain, (uint64_t)SCANNER_CHAIN_TIMEOUT_MS * 1000);
+#endif
     log_init();
     timer_init();
+#if SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY
+    output_init();
+#endif
     power_management_init();
     ble_stack_init();
     scan_init();
+#if SCANNER_ADAPT_ENABLED
+    adapt_init();
+#endif
 
     // Start execution.
     NRF_LOG_RAW_INFO(    " ----------------\r\n");
     NRF_LOG_RAW_INFO(	 "| Beacon scanner |");
     NRF_LOG_RAW_INFO("\r\n ----------------\r\n");
+    NRF_LOG_INFO("Report queue: %u reports.", scan_ring_size());
     
     scan_start();
 
+#if PROFILE_ENABLED
+    m_profile.wake_cycles = scan_time_cycles_get();
+#endif
 
     // Enter main loop.
     for (;;)
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# size_report.py
+#
+#  Prints the flash and RAM used by every module of the image, read from the map file
+#  written by the linker. Only the input sections kept in the image are counted, so the
+#  totals match what arm-none-eabi-size reports for the .out file, less the alignment
+#  padding.
+#
+#      text    Code and constants, in flash.
+#      data    Initialized variables, in RAM with their initial value in flash.
+#      bss     Zeroed variables, heap and stack, in RAM only.
+#
+#  Objects taken from a library are counted under the name of the library.
+#
+#  Usage: size_report.py [--csv] [--sort text|data|bss|flash|ram|name] <file.map>
+#
+
+import argparse
+import os
+import re
+import sys
+
+RAM_START = 0x20000000
+BSS_SECTIONS = ('.bss', '.heap', '.stack', '.noinit')
+NOT_LOADED = ('/DISCARD/', '.debug', '.comment', '.ARM.attributes', '.stab', '.gnu.attributes')
+
+OUTPUT_SECTION = re.compile(r'^(\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+).*)?$')
+INPUT_SECTION = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$')
+CONTINUATION = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+
+
+def module_name(path):
+    path = path.strip()
+    archive = re.match(r'^(.*\.a)\((.*)\)$', path)
+    if archive:
+        return os.path.basename(archive.group(1))
+    name = os.path.basename(path)
+    for ext in ('.o', '.obj'):
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    for ext in ('.c', '.S', '.s'):
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    return name
+
+
+def section_kind(output, name, addr):
+    if output.startswith(BSS_SECTIONS) or name.startswith(BSS_SECTIONS) or name == 'COMMON':
+        return 'bss'
+    if addr >= RAM_START:
+        return 'data'
+    return 'text'
+
+
+def parse(lines):
+    modules = {}
+    output = None
+    pending = None
+    in_map = False
+
+    def add(name, addr, size, path):
+        if size == 0:
+            return
+        kind = section_kind(output, name, addr)
+        sizes = modules.setdefault(module_name(path), {'text': 0, 'data': 0, 'bss': 0})
+        sizes[kind] += size
+
+    for line in lines:
+        line = line.rstrip('\r\n')
+        if not in_map:
+            in_map = line.startswith('Linker script and memory map')
+            continue
+        if pending is not None:
+            m = CONTINUATION.match(line)
+            if m:
+                add(pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3))
+            pending = None
+            continue
+        if line.startswith('/DISCARD/'):
+            output = '/DISCARD/'
+            continue
+        m = OUTPUT_SECTION.match(line)
+        if m:
+            output = m.group(1)
+            continue
+        if output is None or output.startswith(NOT_LOADED):
+            continue
+        m = INPUT_SECTION.match(line)
+        if m and not m.group(1).startswith('*'):
+            if m.group(2) is None:
+                pending = m.group(1)
+            else:
+                add(m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4))
+    return modules
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Flash and RAM used by every module.')
+    parser.add_argument('map', help='map file written by the linker')
+    parser.add_argument('--csv', action='store_true', help='print comma separated values')
+    parser.add_argument('--sort', default='flash',
+                        choices=('text', 'data', 'bss', 'flash', 'ram', 'name'),
+                        help='sort key, largest first (default: flash)')
+    args = parser.parse_args()
+
+    try:
+        with open(args.map) as f:
+            modules = parse(f)
+    except OSError as e:
+        sys.exit('size_report: %s' % e)
+    if not modules:
+        sys.exit('size_report: no sections found in %s' % args.map)
+
+    rows = []
+    for name, s in modules.items():
+        rows.append((name, s['text'], s['data'], s['bss'],
+                     s['text'] + s['data'], s['data'] + s['bss']))
+    keys = {'name': 0, 'text': 1, 'data': 2, 'bss': 3, 'flash': 4, 'ram': 5}
+    key = keys[args.sort]
+    rows.sort(key=lambda r: (r[key], r[0]) if key == 0 else (-r[key], r[0]))
+    total = ('total',) + tuple(sum(r[i] for r in rows) for i in range(1, 6))
+
+    if args.csv:
+        print('module,text,data,bss,flash,ram')
+        for r in rows + [total]:
+            print('%s,%d,%d,%d,%d,%d' % r)
+        return
+
+    width = max(len(r[0]) for r in rows + [total])
+    fmt = '%-' + str(width) + 's %8s %8s %8s %8s %8s'
+    print(fmt % ('module', 'text', 'data', 'bss', 'flash', 'ram'))
+    for r in rows:
+        print(fmt % r)
+    print(fmt % total)
+
+
+if __name__ == '__main__':
+    main()
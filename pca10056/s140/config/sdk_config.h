@@ -54,14 +54,212 @@
 #define APP_SHUTDOWN_HANDLER_PRIORITY 1
 #endif
 
-// <o> BLE_DIS_C_STRING_MAX_LEN - Maximal length of the string retrieved from the Device Information Client module. 
-#ifndef BLE_DIS_C_STRING_MAX_LEN
-#define BLE_DIS_C_STRING_MAX_LEN 30
+// <o> SCANNER_OUTPUT_FORMAT  - Format of the advertising reports sent through the serial port.
+ 
+// <i> In binary mode the scanner owns the UART, so the logger must use another backend (RTT).
+// <i> The nrf_log backends follow this setting: RTT in binary mode, UART in text mode.
+// <0=> Text hexdump (nrf_log) 
+// <1=> Binary frames 
+
+#ifndef SCANNER_OUTPUT_FORMAT
+#define SCANNER_OUTPUT_FORMAT 1
+#endif
+
+// <o> SCANNER_OUTPUT_BUFFER_SIZE - Size of each of the two EasyDMA buffers of the binary output. 
+#ifndef SCANNER_OUTPUT_BUFFER_SIZE
+#define SCANNER_OUTPUT_BUFFER_SIZE 2048
+#endif
+
+// <o> SCANNER_UART_BAUDRATE  - Baud rate of the binary output at boot. The host can change it at runtime.
+ 
+// <115200=> 115200 baud 
+// <230400=> 230400 baud 
+// <460800=> 460800 baud 
+// <921600=> 921600 baud 
+// <1000000=> 1000000 baud 
+
+#ifndef SCANNER_UART_BAUDRATE
+#define SCANNER_UART_BAUDRATE 115200
+#endif
+
+// <q> SCANNER_UART_HWFC  - Use RTS/CTS flow control at boot.
+ 
+
+#ifndef SCANNER_UART_HWFC
+#define SCANNER_UART_HWFC 0
 #endif
 
-// <o> BLE_GATT_DB_MAX_CHARS - The maximum number of characteristics present in a service record. 
-#ifndef BLE_GATT_DB_MAX_CHARS
-#define BLE_GATT_DB_MAX_CHARS 9
+// <o> SCANNER_BAUD_CONFIRM_MS - Time given to the host to confirm a baud rate change, in ms. 
+// <i> If the host does not send a HELLO at the new baud rate in time, the scanner goes back to the previous one.
+
+#ifndef SCANNER_BAUD_CONFIRM_MS
+#define SCANNER_BAUD_CONFIRM_MS 1000
+#endif
+
+// <o> SCANNER_CMD_MAX_LEN - Longest command payload accepted from the host. 
+#ifndef SCANNER_CMD_MAX_LEN
+#define SCANNER_CMD_MAX_LEN 64
+#endif
+
+// <o> SCANNER_REPORT_DATA_MAX - Advertising data bytes kept per queued report. 
+// <i> Size of the scan buffers: the SoftDevice receives the reports straight into the
+// <i> queue. Must be at least 255 (BLE_GAP_SCAN_BUFFER_EXTENDED_MIN). The report queue takes
+// <i> all the RAM left free by the rest of the image, its size in reports is printed by the build.
+
+#ifndef SCANNER_REPORT_DATA_MAX
+#define SCANNER_REPORT_DATA_MAX 255
+#endif
+
+// <o> SCANNER_SCAN_PHYS  - Primary PHYs scanned when SCANNER_PHY_ROTATE_ENABLED is not set.
+ 
+// <i> Extended advertisements are followed on their secondary PHY (1M, 2M or Coded) in any case.
+// <1=> 1M 
+// <4=> Coded 
+// <5=> 1M and Coded at once 
+
+#ifndef SCANNER_SCAN_PHYS
+#define SCANNER_SCAN_PHYS 1
+#endif
+
+// <e> SCANNER_PHY_ROTATE_ENABLED - Scan the 1M and the Coded PHYs in turns.
+//==========================================================
+#ifndef SCANNER_PHY_ROTATE_ENABLED
+#define SCANNER_PHY_ROTATE_ENABLED 0
+#endif
+// <o> SCANNER_PHY_DWELL_1M_MS - Time spent on the 1M PHY, in ms (multiple of 10). 
+#ifndef SCANNER_PHY_DWELL_1M_MS
+#define SCANNER_PHY_DWELL_1M_MS 3000
+#endif
+
+// <o> SCANNER_PHY_DWELL_CODED_MS - Time spent on the Coded PHY, in ms (multiple of 10). 
+#ifndef SCANNER_PHY_DWELL_CODED_MS
+#define SCANNER_PHY_DWELL_CODED_MS 1000
+#endif
+
+// </e>
+
+// <e> SCANNER_ADAPT_ENABLED - Shrink the scan window when the output cannot keep up with the reports, widen it again when it can.
+//==========================================================
+#ifndef SCANNER_ADAPT_ENABLED
+#define SCANNER_ADAPT_ENABLED 1
+#endif
+// <o> SCANNER_ADAPT_PERIOD_MS - Period of the scan window controller, in ms. 
+#ifndef SCANNER_ADAPT_PERIOD_MS
+#define SCANNER_ADAPT_PERIOD_MS 1000
+#endif
+
+// <o> SCANNER_ADAPT_WINDOW_MIN_MS - Narrowest scan window, in ms. 
+#ifndef SCANNER_ADAPT_WINDOW_MIN_MS
+#define SCANNER_ADAPT_WINDOW_MIN_MS 50
+#endif
+
+// <o> SCANNER_ADAPT_STEP_MS - Widening of the scan window per period when there is headroom, in ms. 
+#ifndef SCANNER_ADAPT_STEP_MS
+#define SCANNER_ADAPT_STEP_MS 25
+#endif
+
+// </e>
+
+// <e> SCANNER_STATS_ENABLED - Send a statistics record periodically.
+//==========================================================
+#ifndef SCANNER_STATS_ENABLED
+#define SCANNER_STATS_ENABLED 1
+#endif
+// <o> SCANNER_STATS_PERIOD_MS - Period of the statistics record, in ms. 
+#ifndef SCANNER_STATS_PERIOD_MS
+#define SCANNER_STATS_PERIOD_MS 1000
+#endif
+
+// <q> SCANNER_PROFILE_ENABLED  - Count the CPU cycles spent per advertising report and send them after each statistics record.
+ 
+
+#ifndef SCANNER_PROFILE_ENABLED
+#define SCANNER_PROFILE_ENABLED 0
+#endif
+
+// </e>
+
+// <e> SCANNER_CHAIN_ENABLED - Send the fragments of an extended advertising chain as a single report.
+//==========================================================
+#ifndef SCANNER_CHAIN_ENABLED
+#define SCANNER_CHAIN_ENABLED 1
+#endif
+// <o> SCANNER_CHAIN_COUNT - Chains reassembled at a time, each with a buffer of 1650 bytes. 
+// <i> When more chains are interleaved, the one with the oldest fragment is sent truncated.
+
+#ifndef SCANNER_CHAIN_COUNT
+#define SCANNER_CHAIN_COUNT 4
+#endif
+
+// <o> SCANNER_CHAIN_TIMEOUT_MS - Time without fragments after which a chain is sent truncated, in ms. 
+#ifndef SCANNER_CHAIN_TIMEOUT_MS
+#define SCANNER_CHAIN_TIMEOUT_MS 200
+#endif
+
+// </e>
+
+// <e> SCANNER_DEDUP_ENABLED - Drop the reports that repeat the last advertising data forwarded for the same advertiser.
+//==========================================================
+#ifndef SCANNER_DEDUP_ENABLED
+#define SCANNER_DEDUP_ENABLED 1
+#endif
+// <o> SCANNER_DEDUP_TABLE_SIZE - Entries of the duplicate table (power of 2). Up to 3/4 of them track an advertiser each. 
+#ifndef SCANNER_DEDUP_TABLE_SIZE
+#define SCANNER_DEDUP_TABLE_SIZE 256
+#endif
+
+// <o> SCANNER_DEDUP_SUMMARY_MS - Period of the "still alive" summary of an advertiser whose reports are dropped, in ms. 
+// <i> 0 disables the summaries.
+
+#ifndef SCANNER_DEDUP_SUMMARY_MS
+#define SCANNER_DEDUP_SUMMARY_MS 1000
+#endif
+
+// <o> SCANNER_DEDUP_EXPIRY_MS - Time after which a silent advertiser is forgotten, in ms. 
+#ifndef SCANNER_DEDUP_EXPIRY_MS
+#define SCANNER_DEDUP_EXPIRY_MS 10000
+#endif
+
+// </e>
+
+// <e> SCANNER_FILTER_ENABLED - Check the advertising reports against the filters set by the host before queuing them.
+//==========================================================
+#ifndef SCANNER_FILTER_ENABLED
+#define SCANNER_FILTER_ENABLED 1
+#endif
+// <o> SCANNER_FILTER_COUNT - Filters the host can set, RSSI floor excluded (at most 32). 
+#ifndef SCANNER_FILTER_COUNT
+#define SCANNER_FILTER_COUNT 8
+#endif
+
+// </e>
+
+// <e> SCANNER_RSSI_AGG_ENABLED - Send one RSSI summary per device and window instead of the advertising reports.
+//==========================================================
+#ifndef SCANNER_RSSI_AGG_ENABLED
+#define SCANNER_RSSI_AGG_ENABLED 0
+#endif
+// <o> SCANNER_RSSI_AGG_WINDOW_MS - Length of the aggregation windows, in ms. 
+#ifndef SCANNER_RSSI_AGG_WINDOW_MS
+#define SCANNER_RSSI_AGG_WINDOW_MS 1000
+#endif
+
+// <o> SCANNER_RSSI_AGG_DEVICES - Devices tracked at a time (power of 2). 
+// <i> When a window sees more devices, the least recently heard one is summarized early.
+
+#ifndef SCANNER_RSSI_AGG_DEVICES
+#define SCANNER_RSSI_AGG_DEVICES 1024
+#endif
+
+// </e>
+
+// <q> SCANNER_BEACON_ENABLED  - Send iBeacon, AltBeacon and Eddystone advertisements as decoded BEACON records.
+ 
+// <i> The identifiers and measurements of the beacon replace the advertising report and its raw data.
+// <i> Binary output only, the text output keeps the hexdump.
+
+#ifndef SCANNER_BEACON_ENABLED
+#define SCANNER_BEACON_ENABLED 0
 #endif
 
 // </h> 
@@ -74,7 +272,7 @@
  
 
 #ifndef BSP_BTN_BLE_ENABLED
-#define BSP_BTN_BLE_ENABLED 1
+#define BSP_BTN_BLE_ENABLED 0
 #endif
 
 // </h> 
@@ -94,7 +292,7 @@
  
 
 #ifndef BLE_DB_DISCOVERY_ENABLED
-#define BLE_DB_DISCOVERY_ENABLED 1
+#define BLE_DB_DISCOVERY_ENABLED 0
 #endif
 
 // <q> BLE_DTM_ENABLED  - ble_dtm - Module for testing RF/PHY using DTM commands
@@ -115,7 +313,7 @@
  
 
 #ifndef NRF_BLE_GATT_ENABLED
-#define NRF_BLE_GATT_ENABLED 1
+#define NRF_BLE_GATT_ENABLED 0
 #endif
 
 // <e> NRF_BLE_QWR_ENABLED - nrf_ble_qwr - Queued writes support module (prepare/execute write)
@@ -133,7 +331,7 @@
 // <e> NRF_BLE_SCAN_ENABLED - nrf_ble_scan - Scanning Module
 //==========================================================
 #ifndef NRF_BLE_SCAN_ENABLED
-#define NRF_BLE_SCAN_ENABLED 1
+#define NRF_BLE_SCAN_ENABLED 0
 #endif
 // <o> NRF_BLE_SCAN_BUFFER - Data length for an advertising set. 
 #ifndef NRF_BLE_SCAN_BUFFER
@@ -234,7 +432,7 @@
 // <e> PEER_MANAGER_ENABLED - peer_manager - Peer Manager
 //==========================================================
 #ifndef PEER_MANAGER_ENABLED
-#define PEER_MANAGER_ENABLED 1
+#define PEER_MANAGER_ENABLED 0
 #endif
 // <o> PM_MAX_REGISTRANTS - Number of event handlers that can be registered. 
 #ifndef PM_MAX_REGISTRANTS
@@ -425,7 +623,7 @@
 // <e> BLE_DIS_C_ENABLED - ble_dis_c - Device Information Client
 //==========================================================
 #ifndef BLE_DIS_C_ENABLED
-#define BLE_DIS_C_ENABLED 1
+#define BLE_DIS_C_ENABLED 0
 #endif
 // <o> BLE_DIS_C_QUEUE_SIZE - Size of the queue used for processing pending read requests. 
 #ifndef BLE_DIS_C_QUEUE_SIZE
@@ -631,7 +829,7 @@
  
 
 #ifndef BLE_RSCS_C_ENABLED
-#define BLE_RSCS_C_ENABLED 1
+#define BLE_RSCS_C_ENABLED 0
 #endif
 
 // <q> BLE_RSCS_ENABLED  - ble_rscs - Running Speed and Cadence Service
@@ -4395,7 +4593,7 @@
 #endif
 // <o> NRFX_UARTE0_ENABLED - Enable UARTE0 instance 
 #ifndef NRFX_UARTE0_ENABLED
-#define NRFX_UARTE0_ENABLED 0
+#define NRFX_UARTE0_ENABLED 1
 #endif
 
 // <o> NRFX_UARTE1_ENABLED - Enable UARTE1 instance 
@@ -4517,7 +4715,7 @@
 // <e> NRFX_UART_ENABLED - nrfx_uart - UART peripheral driver
 //==========================================================
 #ifndef NRFX_UART_ENABLED
-#define NRFX_UART_ENABLED 1
+#define NRFX_UART_ENABLED 0
 #endif
 // <o> NRFX_UART0_ENABLED - Enable UART0 instance 
 #ifndef NRFX_UART0_ENABLED
@@ -5870,7 +6068,7 @@
  
 
 #ifndef UART_LEGACY_SUPPORT
-#define UART_LEGACY_SUPPORT 1
+#define UART_LEGACY_SUPPORT 0
 #endif
 
 // <e> UART0_ENABLED - Enable UART0 instance
@@ -6537,7 +6735,7 @@
 // <e> FDS_ENABLED - fds - Flash data storage module
 //==========================================================
 #ifndef FDS_ENABLED
-#define FDS_ENABLED 1
+#define FDS_ENABLED 0
 #endif
 // <h> Pages - Virtual page settings
 
@@ -7059,7 +7257,7 @@
 // <e> NRF_FSTORAGE_ENABLED - nrf_fstorage - Flash abstraction library
 //==========================================================
 #ifndef NRF_FSTORAGE_ENABLED
-#define NRF_FSTORAGE_ENABLED 1
+#define NRF_FSTORAGE_ENABLED 0
 #endif
 // <h> nrf_fstorage - Common settings
 
@@ -7502,9 +7700,15 @@
 //==========================================================
 // <e> NRF_LOG_BACKEND_RTT_ENABLED - nrf_log_backend_rtt - Log RTT backend
 //==========================================================
+// <i> Follows SCANNER_OUTPUT_FORMAT by default: on with the binary output, which owns the UART.
+
 #ifndef NRF_LOG_BACKEND_RTT_ENABLED
+#if SCANNER_OUTPUT_FORMAT == 1
+#define NRF_LOG_BACKEND_RTT_ENABLED 1
+#else
 #define NRF_LOG_BACKEND_RTT_ENABLED 0
 #endif
+#endif
 // <o> NRF_LOG_BACKEND_RTT_TEMP_BUFFER_SIZE - Size of buffer for partially processed strings. 
 // <i> Size of the buffer is a trade-off between RAM usage and processing.
 // <i> if buffer is smaller then strings will often be fragmented.
@@ -7535,9 +7739,15 @@
 
 // <e> NRF_LOG_BACKEND_UART_ENABLED - nrf_log_backend_uart - Log UART backend
 //==========================================================
+// <i> Follows SCANNER_OUTPUT_FORMAT by default: on with the text output, which is the log itself.
+
 #ifndef NRF_LOG_BACKEND_UART_ENABLED
+#if SCANNER_OUTPUT_FORMAT == 1
+#define NRF_LOG_BACKEND_UART_ENABLED 0
+#else
 #define NRF_LOG_BACKEND_UART_ENABLED 1
 #endif
+#endif
 // <o> NRF_LOG_BACKEND_UART_TX_PIN - UART TX pin 
 #ifndef NRF_LOG_BACKEND_UART_TX_PIN
 #define NRF_LOG_BACKEND_UART_TX_PIN 6
@@ -12442,14 +12652,14 @@
 
 // <o> NRF_SDH_BLE_CENTRAL_LINK_COUNT - Maximum number of central links. 
 #ifndef NRF_SDH_BLE_CENTRAL_LINK_COUNT
-#define NRF_SDH_BLE_CENTRAL_LINK_COUNT 1
+#define NRF_SDH_BLE_CENTRAL_LINK_COUNT 0
 #endif
 
 // <o> NRF_SDH_BLE_TOTAL_LINK_COUNT - Total link count. 
 // <i> Maximum number of total concurrent connections using the default configuration.
 
 #ifndef NRF_SDH_BLE_TOTAL_LINK_COUNT
-#define NRF_SDH_BLE_TOTAL_LINK_COUNT 1
+#define NRF_SDH_BLE_TOTAL_LINK_COUNT 0
 #endif
 
 // <o> NRF_SDH_BLE_GAP_EVENT_LENGTH - GAP event length. 
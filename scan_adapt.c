@@ -0,0 +1,105 @@
+/***************************************************************************************/
+/*
+ * scan_adapt
+ *
+ *  Closed loop control of the scan window.
+ *
+ *  The number of reports grows with the window. If d reports out of p + d were
+ *  dropped during a period, the output kept up with p of them: the window is scaled
+ *  by p / (p + d), and by 7/8 more to leave some margin. A queue more than 3/4 full
+ *  is about to drop, it cuts the window by 1/8.
+ *
+ *  During a cut period the output ran flat out, so the reports published then are
+ *  what it can take. Half as many later means the load went down: waiting out the
+ *  hold would only keep the window narrow for nothing.
+*/
+/***************************************************************************************/
+
+#include "scan_adapt.h"
+
+
+static uint16_t window_clamp(scan_adapt_config_t const * p_config, uint32_t window)
+{
+    if (window < p_config->window_min)
+    {
+        return p_config->window_min;
+    }
+    if (window > p_config->window_max)
+    {
+        return p_config->window_max;
+    }
+
+    return (uint16_t)window;
+}
+
+
+void scan_adapt_init(scan_adapt_t              * p_adapt,
+                     scan_adapt_config_t const * p_config,
+                     scan_adapt_input_t  const * p_input)
+{
+    p_adapt->config    = *p_config;
+    p_adapt->window    = p_config->window_max;
+    p_adapt->hold      = 0;
+    p_adapt->backoff   = p_config->hold_min;
+    p_adapt->published = p_input->published;
+    p_adapt->overflows = p_input->overflows;
+    p_adapt->rate      = 0;
+    p_adapt->rate_cut  = 0;
+    p_adapt->cuts      = 0;
+}
+
+
+uint16_t scan_adapt_update(scan_adapt_t * p_adapt, scan_adapt_input_t const * p_input)
+{
+    scan_adapt_config_t const * p_config  = &p_adapt->config;
+    uint32_t                    published = p_input->published - p_adapt->published;
+    uint32_t                    dropped   = p_input->overflows - p_adapt->overflows;
+    uint32_t                    window    = p_adapt->window;
+
+    p_adapt->published = p_input->published;
+    p_adapt->overflows = p_input->overflows;
+    p_adapt->rate      = published;
+
+    if (dropped != 0 || (p_input->queued * 4 > p_input->queue_size * 3))
+    {
+        if (dropped != 0)
+        {
+            window  = (uint32_t)((uint64_t)window * published / (published + dropped));
+            window -= window / 8;
+        }
+        else
+        {
+            window -= window / 8;
+        }
+
+        p_adapt->hold     = p_adapt->backoff;
+        p_adapt->backoff  = (p_adapt->backoff * 2 > p_config->hold_max) ? p_config->hold_max
+                                                                        : p_adapt->backoff * 2;
+        p_adapt->rate_cut = published;
+        p_adapt->cuts++;
+    }
+    else if ((p_adapt->hold != 0) && (published * 2 >= p_adapt->rate_cut))
+    {
+        p_adapt->hold--;
+    }
+    else if (p_input->queued * 4 <= p_input->queue_size)
+    {
+        if (p_adapt->hold != 0)
+        {
+            // Far fewer reports than at the last cut, the hold is over.
+            p_adapt->hold    = 0;
+            p_adapt->backoff = p_config->hold_min;
+        }
+
+        window += p_config->step;
+        if (window >= p_config->window_max)
+        {
+            // The load went down, the next cut is a new situation.
+            p_adapt->backoff = p_config->hold_min;
+        }
+    }
+
+    p_adapt->window = window_clamp(p_config, window);
+
+    return p_adapt->window;
+}
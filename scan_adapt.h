@@ -0,0 +1,90 @@
+/***************************************************************************************/
+/*
+ * scan_adapt
+ *
+ *  Closed loop control of the scan window.
+ *
+ *  Every period the controller looks at the reports published into the queue, the
+ *  reports dropped because it was full and how full it is. When the output cannot
+ *  keep up, the window is cut in proportion to the reports lost. When there is
+ *  headroom again, it is widened step by step.
+ *
+ *  After every cut the controller holds the window for a while before widening it.
+ *  The hold time doubles each time widening leads to a new cut, so under a steady
+ *  load the window settles just under the capacity of the output instead of
+ *  oscillating around it. It goes back to its minimum once the window reaches its
+ *  maximum without loss. The hold ends early when the load goes down, which shows as
+ *  far fewer reports than the output took at the last cut.
+ *
+ *  The controller does not depend on the SDK, so the host tools can build it.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_ADAPT_H__
+#define SCAN_ADAPT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Controller settings. Windows are in any unit, the scanner uses 0.625 ms. */
+typedef struct
+{
+    uint16_t window_min;
+    uint16_t window_max;                                                /**< Also the initial window. */
+    uint16_t step;                                                      /**< Widening per period. */
+    uint8_t  hold_min;                                                  /**< Periods held after a cut, at least. */
+    uint8_t  hold_max;                                                  /**< Periods held after a cut, at most. */
+} scan_adapt_config_t;
+
+/**@brief Measurements of the report queue, sampled once per period. */
+typedef struct
+{
+    uint32_t published;                                                 /**< Reports queued since boot. */
+    uint32_t overflows;                                                 /**< Reports dropped since boot because the queue was full. */
+    uint32_t queued;                                                    /**< Reports in the queue now. */
+    uint32_t queue_size;                                                /**< Capacity of the queue. */
+} scan_adapt_input_t;
+
+/**@brief Controller. */
+typedef struct
+{
+    scan_adapt_config_t config;
+    uint16_t            window;                                         /**< Current window. */
+    uint8_t             hold;                                           /**< Periods left before widening again. */
+    uint8_t             backoff;                                        /**< Hold time after the next cut. */
+    uint32_t            published;                                      /**< Counters at the previous period. */
+    uint32_t            overflows;
+    uint32_t            rate;                                           /**< Reports published in the last period. */
+    uint32_t            rate_cut;                                       /**< Reports published in the period of the last cut. */
+    uint32_t            cuts;                                           /**< Times the window was cut. */
+} scan_adapt_t;
+
+
+/**@brief Function for initializing the controller.
+ *
+ * @param[out]  p_adapt     Controller.
+ * @param[in]   p_config    Settings, copied.
+ * @param[in]   p_input     Measurements now, the reference of the first period.
+ */
+void scan_adapt_init(scan_adapt_t              * p_adapt,
+                     scan_adapt_config_t const * p_config,
+                     scan_adapt_input_t  const * p_input);
+
+
+/**@brief Function for running the controller at the end of a period.
+ *
+ * @param[in]   p_adapt     Controller.
+ * @param[in]   p_input     Measurements now.
+ *
+ * @return Window to use for the next period.
+ */
+uint16_t scan_adapt_update(scan_adapt_t * p_adapt, scan_adapt_input_t const * p_input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_ADAPT_H__
@@ -0,0 +1,299 @@
+/***************************************************************************************/
+/*
+ * scan_agg
+ *
+ *  Per-device RSSI aggregation.
+ *
+ *  The entries are found through a chained hash table and kept in a doubly linked
+ *  list ordered by the time of their last report. Entries are linked by index, so
+ *  the table does not depend on where it is placed in RAM.
+ *
+ *  A device touched in the current window is moved to the head of the list, so the
+ *  devices whose window ended are all at the tail: the flush only walks those. That
+ *  only holds if the windows never go back, so late reports are clamped to the
+ *  latest window.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_agg.h"
+
+#define FNV_OFFSET      2166136261u
+#define FNV_PRIME       16777619u
+
+
+static uint16_t bucket_get(scan_agg_t const * p_agg, uint8_t const * p_addr, uint8_t addr_type)
+{
+    uint32_t hash = FNV_OFFSET;
+
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        hash ^= p_addr[i];
+        hash *= FNV_PRIME;
+    }
+    hash ^= addr_type;
+    hash *= FNV_PRIME;
+
+    return (uint16_t)(hash & (p_agg->capacity - 1));
+}
+
+
+static uint64_t window_start(scan_agg_t const * p_agg, uint64_t timestamp_us)
+{
+    return timestamp_us - (timestamp_us % p_agg->window_us);
+}
+
+
+static void lru_unlink(scan_agg_t * p_agg, uint16_t idx)
+{
+    scan_agg_entry_t * p_entry = &p_agg->p_entries[idx];
+
+    if (p_entry->lru_prev != SCAN_AGG_INVALID_IDX)
+    {
+        p_agg->p_entries[p_entry->lru_prev].lru_next = p_entry->lru_next;
+    }
+    else
+    {
+        p_agg->lru_head = p_entry->lru_next;
+    }
+
+    if (p_entry->lru_next != SCAN_AGG_INVALID_IDX)
+    {
+        p_agg->p_entries[p_entry->lru_next].lru_prev = p_entry->lru_prev;
+    }
+    else
+    {
+        p_agg->lru_tail = p_entry->lru_prev;
+    }
+}
+
+
+static void lru_push(scan_agg_t * p_agg, uint16_t idx)
+{
+    scan_agg_entry_t * p_entry = &p_agg->p_entries[idx];
+
+    p_entry->lru_prev = SCAN_AGG_INVALID_IDX;
+    p_entry->lru_next = p_agg->lru_head;
+
+    if (p_agg->lru_head != SCAN_AGG_INVALID_IDX)
+    {
+        p_agg->p_entries[p_agg->lru_head].lru_prev = idx;
+    }
+    else
+    {
+        p_agg->lru_tail = idx;
+    }
+    p_agg->lru_head = idx;
+}
+
+
+static uint16_t entry_find(scan_agg_t const * p_agg, uint8_t const * p_addr, uint8_t addr_type)
+{
+    uint16_t idx = p_agg->p_buckets[bucket_get(p_agg, p_addr, addr_type)];
+
+    while (idx != SCAN_AGG_INVALID_IDX)
+    {
+        scan_agg_entry_t const * p_entry = &p_agg->p_entries[idx];
+
+        if ((p_entry->addr_type == addr_type) && (memcmp(p_entry->addr, p_addr, 6) == 0))
+        {
+            break;
+        }
+        idx = p_entry->hash_next;
+    }
+
+    return idx;
+}
+
+
+/**@brief Function for removing an entry and returning it to the free list. */
+static void entry_free(scan_agg_t * p_agg, uint16_t idx)
+{
+    scan_agg_entry_t * p_entry = &p_agg->p_entries[idx];
+    uint16_t         * p_link  = &p_agg->p_buckets[bucket_get(p_agg, p_entry->addr, p_entry->addr_type)];
+
+    while (*p_link != idx)
+    {
+        p_link = &p_agg->p_entries[*p_link].hash_next;
+    }
+    *p_link = p_entry->hash_next;
+
+    lru_unlink(p_agg, idx);
+
+    p_entry->hash_next = p_agg->free_head;
+    p_agg->free_head   = idx;
+    p_agg->count--;
+}
+
+
+/**@brief Function for producing the summary of the current window of an entry. */
+static bool summary_send(scan_agg_entry_t const   * p_entry,
+                         uint8_t                    flags,
+                         scan_agg_summary_handler_t handler,
+                         void                     * p_context)
+{
+    int32_t             sum     = p_entry->rssi_sum;
+    int32_t             half    = p_entry->count / 2;
+    scan_rssi_summary_t summary =
+    {
+        .window_us = p_entry->window_us,
+        .addr_type = p_entry->addr_type,
+        .flags     = flags,
+        .rssi_min  = p_entry->rssi_min,
+        .rssi_max  = p_entry->rssi_max,
+        // Round half away from zero; the RSSI is almost always negative.
+        .rssi_mean = (int8_t)((sum < 0) ? (sum - half) / p_entry->count
+                                        : (sum + half) / p_entry->count),
+        .count     = p_entry->count,
+    };
+
+    memcpy(summary.addr, p_entry->addr, sizeof(summary.addr));
+
+    return handler(&summary, p_context);
+}
+
+
+static void window_reset(scan_agg_entry_t * p_entry, uint64_t window_us)
+{
+    p_entry->window_us = window_us;
+    p_entry->rssi_sum  = 0;
+    p_entry->count     = 0;
+    p_entry->rssi_min  = INT8_MAX;
+    p_entry->rssi_max  = INT8_MIN;
+}
+
+
+void scan_agg_init(scan_agg_t * p_agg, uint64_t window_us)
+{
+    for (uint16_t i = 0; i < p_agg->capacity; i++)
+    {
+        p_agg->p_buckets[i]           = SCAN_AGG_INVALID_IDX;
+        p_agg->p_entries[i].hash_next = (i + 1 < p_agg->capacity) ? i + 1 : SCAN_AGG_INVALID_IDX;
+    }
+
+    p_agg->count     = 0;
+    p_agg->free_head = 0;
+    p_agg->lru_head  = SCAN_AGG_INVALID_IDX;
+    p_agg->lru_tail  = SCAN_AGG_INVALID_IDX;
+    p_agg->window_us      = window_us;
+    p_agg->window_last_us = 0;
+    p_agg->evictions      = 0;
+    p_agg->late           = 0;
+}
+
+
+bool scan_agg_add(scan_agg_t                * p_agg,
+                  scan_report_hdr_t const   * p_hdr,
+                  scan_agg_summary_handler_t  handler,
+                  void                      * p_context)
+{
+    uint64_t           window_us = window_start(p_agg, p_hdr->timestamp_us);
+    uint16_t           idx       = entry_find(p_agg, p_hdr->addr, p_hdr->addr_type);
+    bool               late      = (window_us < p_agg->window_last_us);
+    scan_agg_entry_t * p_entry;
+
+    // Moving a window back would close the current one early and put an old window
+    // at the head of the list.
+    if (late)
+    {
+        window_us = p_agg->window_last_us;
+    }
+
+    if (idx != SCAN_AGG_INVALID_IDX)
+    {
+        p_entry = &p_agg->p_entries[idx];
+
+        if (p_entry->window_us != window_us)
+        {
+            if (!summary_send(p_entry, 0, handler, p_context))
+            {
+                return false;
+            }
+            window_reset(p_entry, window_us);
+        }
+        lru_unlink(p_agg, idx);
+    }
+    else
+    {
+        if (p_agg->free_head == SCAN_AGG_INVALID_IDX)
+        {
+            uint16_t victim = p_agg->lru_tail;
+            bool     early  = (p_agg->p_entries[victim].window_us == window_us);
+
+            if (!summary_send(&p_agg->p_entries[victim],
+                              early ? SCAN_RSSI_SUMMARY_FLAG_EVICTED : 0,
+                              handler, p_context))
+            {
+                return false;
+            }
+            if (early)
+            {
+                p_agg->evictions++;
+            }
+            entry_free(p_agg, victim);
+        }
+
+        idx              = p_agg->free_head;
+        p_entry          = &p_agg->p_entries[idx];
+        p_agg->free_head = p_entry->hash_next;
+        p_agg->count++;
+
+        memcpy(p_entry->addr, p_hdr->addr, sizeof(p_entry->addr));
+        p_entry->addr_type = p_hdr->addr_type;
+
+        uint16_t bucket = bucket_get(p_agg, p_hdr->addr, p_hdr->addr_type);
+
+        p_entry->hash_next       = p_agg->p_buckets[bucket];
+        p_agg->p_buckets[bucket] = idx;
+
+        window_reset(p_entry, window_us);
+    }
+
+    // Saturate rather than wrap, a window never sees that many reports in practice.
+    if (p_entry->count < UINT16_MAX)
+    {
+        p_entry->rssi_sum += p_hdr->rssi;
+        p_entry->count++;
+    }
+    if (p_hdr->rssi < p_entry->rssi_min)
+    {
+        p_entry->rssi_min = p_hdr->rssi;
+    }
+    if (p_hdr->rssi > p_entry->rssi_max)
+    {
+        p_entry->rssi_max = p_hdr->rssi;
+    }
+
+    lru_push(p_agg, idx);
+
+    p_agg->window_last_us = window_us;
+    p_agg->late          += late;
+
+    return true;
+}
+
+
+bool scan_agg_flush(scan_agg_t                * p_agg,
+                    uint64_t                    now_us,
+                    scan_agg_summary_handler_t  handler,
+                    void                      * p_context)
+{
+    uint64_t window_us = window_start(p_agg, now_us);
+
+    while (p_agg->lru_tail != SCAN_AGG_INVALID_IDX)
+    {
+        uint16_t idx = p_agg->lru_tail;
+
+        if (p_agg->p_entries[idx].window_us >= window_us)
+        {
+            break;
+        }
+        if (!summary_send(&p_agg->p_entries[idx], 0, handler, p_context))
+        {
+            return false;
+        }
+        entry_free(p_agg, idx);
+    }
+
+    return true;
+}
@@ -0,0 +1,130 @@
+/***************************************************************************************/
+/*
+ * scan_agg
+ *
+ *  Per-device RSSI aggregation.
+ *
+ *  Instead of forwarding every report, the RSSI of each device (peer address) is
+ *  aggregated over fixed windows and one summary (min, max, mean and count) is
+ *  produced per device and window. The number of devices tracked at a time is fixed:
+ *  when a new device does not fit, the least recently heard one is evicted and its
+ *  summary is produced early.
+ *
+ *  The module has no SDK dependencies so the host tools can build it too. It is not
+ *  reentrant: all functions of an instance must be called from the same context.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_AGG_H__
+#define SCAN_AGG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_AGG_INVALID_IDX    0xFFFF                                  /**< End of the lists of entries. */
+
+/**@brief Macro for defining an aggregation table.
+ *
+ * @param   _name       Name of the instance.
+ * @param   _capacity   Number of devices tracked at a time (power of 2, less than 65536).
+ */
+#define SCAN_AGG_DEF(_name, _capacity)                                              \
+    static scan_agg_entry_t _name##_entries[_capacity];                             \
+    static uint16_t         _name##_buckets[_capacity];                             \
+    static scan_agg_t _name =                                                       \
+    {                                                                               \
+        .p_entries = _name##_entries,                                               \
+        .p_buckets = _name##_buckets,                                               \
+        .capacity  = (_capacity),                                                   \
+    }
+
+/**@brief A tracked device. */
+typedef struct
+{
+    uint64_t window_us;                                                 /**< Start of the current window. */
+    int32_t  rssi_sum;
+    uint16_t count;
+    uint16_t hash_next;                                                 /**< Next entry of the bucket, or of the free list. */
+    uint16_t lru_prev;                                                  /**< More recently heard device. */
+    uint16_t lru_next;                                                  /**< Less recently heard device. */
+    uint8_t  addr[6];
+    uint8_t  addr_type;
+    int8_t   rssi_min;
+    int8_t   rssi_max;
+} scan_agg_entry_t;
+
+/**@brief Aggregation table. Define it with @ref SCAN_AGG_DEF. */
+typedef struct
+{
+    scan_agg_entry_t * p_entries;
+    uint16_t         * p_buckets;                                       /**< First entry of each hash bucket. */
+    uint16_t           capacity;
+    uint16_t           count;                                           /**< Devices tracked. */
+    uint16_t           free_head;
+    uint16_t           lru_head;                                        /**< Most recently heard device. */
+    uint16_t           lru_tail;                                        /**< Least recently heard device. */
+    uint64_t           window_us;                                       /**< Window length. */
+    uint64_t           window_last_us;                                  /**< Start of the latest window a report was added to. */
+    uint32_t           evictions;                                       /**< Windows closed early. */
+    uint32_t           late;                                            /**< Reports older than the latest window, added to it. */
+} scan_agg_t;
+
+/**@brief Handler for the summaries.
+ *
+ * @return false if the summary could not be sent. It is produced again on the next call.
+ */
+typedef bool (*scan_agg_summary_handler_t)(scan_rssi_summary_t const * p_summary, void * p_context);
+
+
+/**@brief Function for emptying a table.
+ *
+ * @param[in]   p_agg       Table.
+ * @param[in]   window_us   Length of the aggregation windows.
+ */
+void scan_agg_init(scan_agg_t * p_agg, uint64_t window_us);
+
+
+/**@brief Function for adding the RSSI of a report.
+ *
+ * @details If the report starts a new window for its device, or if a device has to be
+ *          evicted to make room, the pending summary is produced first. A report that
+ *          belongs to a window older than the latest one, such as a chained report
+ *          reassembled after later reports, is added to the latest window.
+ *
+ * @param[in]   p_agg       Table.
+ * @param[in]   p_hdr       Report metadata.
+ * @param[in]   handler     Summary handler.
+ * @param[in]   p_context   Passed to @p handler.
+ *
+ * @return false if @p handler refused a summary. The report was not added.
+ */
+bool scan_agg_add(scan_agg_t                * p_agg,
+                  scan_report_hdr_t const   * p_hdr,
+                  scan_agg_summary_handler_t  handler,
+                  void                      * p_context);
+
+
+/**@brief Function for producing the summaries of the windows that ended.
+ *
+ * @param[in]   p_agg       Table.
+ * @param[in]   now_us      Current time, in the time base of the report timestamps.
+ * @param[in]   handler     Summary handler.
+ * @param[in]   p_context   Passed to @p handler.
+ *
+ * @return false if @p handler refused a summary.
+ */
+bool scan_agg_flush(scan_agg_t                * p_agg,
+                    uint64_t                    now_us,
+                    scan_agg_summary_handler_t  handler,
+                    void                      * p_context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_AGG_H__
@@ -0,0 +1,273 @@
+/***************************************************************************************/
+/*
+ * scan_beacon
+ *
+ *  Decoding of the common beacon formats.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_beacon.h"
+
+#define AD_TYPE_SERVICE_DATA_16     0x16                                /**< Service Data - 16-bit UUID. */
+#define AD_TYPE_MANUFACTURER_DATA   0xFF                                /**< Manufacturer Specific Data. */
+
+#define APPLE_COMPANY_ID            0x004C
+#define IBEACON_PREFIX              0x1502                              /**< Type and length of the iBeacon data, as a little endian word. */
+#define IBEACON_LEN                 25                                  /**< Company ID, prefix, UUID, major, minor and measured power. */
+
+#define ALTBEACON_CODE              0xACBE                              /**< Beacon code 0xBEAC, as a little endian word. */
+#define ALTBEACON_LEN               26                                  /**< Company ID, beacon code, beacon ID, reference RSSI and reserved byte. */
+
+#define EDDYSTONE_UUID              0xFEAA
+#define EDDYSTONE_FRAME_UID         0x00
+#define EDDYSTONE_FRAME_URL         0x10
+#define EDDYSTONE_FRAME_TLM         0x20
+#define EDDYSTONE_FRAME_EID         0x30
+#define EDDYSTONE_UID_LEN           18                                  /**< Frame type, TX power, namespace and instance. The 2 reserved bytes are optional. */
+#define EDDYSTONE_URL_LEN_MIN       4                                   /**< Frame type, TX power, scheme and 1 byte of URL. */
+#define EDDYSTONE_TLM_LEN           14                                  /**< Frame type, version, battery, temperature, count and uptime. */
+#define EDDYSTONE_TLM_VERSION       0x00                                /**< Unencrypted telemetry. */
+#define EDDYSTONE_EID_LEN           10                                  /**< Frame type, TX power and identifier. */
+#define EDDYSTONE_SCHEME_COUNT      4
+
+
+static char const * const m_url_schemes[EDDYSTONE_SCHEME_COUNT] =
+{
+    "http://www.", "https://www.", "http://", "https://",
+};
+
+static char const * const m_url_codes[] =
+{
+    ".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+    ".com",  ".org",  ".edu",  ".net",  ".info",  ".biz",  ".gov",
+};
+
+
+static uint16_t le16(uint8_t const * p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static uint16_t be16(uint8_t const * p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+
+static uint32_t be32(uint8_t const * p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+/**@brief Function for decoding the data of a Manufacturer Specific Data AD structure. */
+static scan_beacon_type_t manufacturer_decode(uint8_t const      * p_data,
+                                              uint8_t              len,
+                                              scan_beacon_body_t * p_body)
+{
+    if ((len == IBEACON_LEN)
+        && (le16(&p_data[0]) == APPLE_COMPANY_ID)
+        && (le16(&p_data[2]) == IBEACON_PREFIX))
+    {
+        memcpy(p_body->ibeacon.uuid, &p_data[4], sizeof(p_body->ibeacon.uuid));
+        p_body->ibeacon.major          = be16(&p_data[20]);
+        p_body->ibeacon.minor          = be16(&p_data[22]);
+        p_body->ibeacon.measured_power = (int8_t)p_data[24];
+        return SCAN_BEACON_IBEACON;
+    }
+
+    if ((len == ALTBEACON_LEN) && (le16(&p_data[2]) == ALTBEACON_CODE))
+    {
+        p_body->altbeacon.company_id = le16(&p_data[0]);
+        memcpy(p_body->altbeacon.beacon_id, &p_data[4], sizeof(p_body->altbeacon.beacon_id));
+        p_body->altbeacon.ref_rssi     = (int8_t)p_data[24];
+        p_body->altbeacon.mfg_reserved = p_data[25];
+        return SCAN_BEACON_ALTBEACON;
+    }
+
+    return SCAN_BEACON_NONE;
+}
+
+
+/**@brief Function for decoding an Eddystone frame, the service data that follows the UUID. */
+static scan_beacon_type_t eddystone_decode(uint8_t const      * p_data,
+                                           uint8_t              len,
+                                           scan_beacon_body_t * p_body)
+{
+    if (len == 0)
+    {
+        return SCAN_BEACON_NONE;
+    }
+
+    switch (p_data[0])
+    {
+        case EDDYSTONE_FRAME_UID:
+            if (len < EDDYSTONE_UID_LEN)
+            {
+                break;
+            }
+            p_body->eddystone_uid.tx_power = (int8_t)p_data[1];
+            memcpy(p_body->eddystone_uid.namespace_id, &p_data[2], sizeof(p_body->eddystone_uid.namespace_id));
+            memcpy(p_body->eddystone_uid.instance_id, &p_data[12], sizeof(p_body->eddystone_uid.instance_id));
+            return SCAN_BEACON_EDDYSTONE_UID;
+
+        case EDDYSTONE_FRAME_URL:
+        {
+            uint8_t url_len = len - 3;
+
+            if ((len < EDDYSTONE_URL_LEN_MIN) || (url_len > SCAN_EDDYSTONE_URL_MAX)
+                || (p_data[2] >= EDDYSTONE_SCHEME_COUNT))
+            {
+                break;
+            }
+            memset(&p_body->eddystone_url, 0, sizeof(p_body->eddystone_url));
+            p_body->eddystone_url.tx_power = (int8_t)p_data[1];
+            p_body->eddystone_url.scheme   = p_data[2];
+            p_body->eddystone_url.url_len  = url_len;
+            memcpy(p_body->eddystone_url.url, &p_data[3], url_len);
+            return SCAN_BEACON_EDDYSTONE_URL;
+        }
+
+        case EDDYSTONE_FRAME_TLM:
+            if ((len < EDDYSTONE_TLM_LEN) || (p_data[1] != EDDYSTONE_TLM_VERSION))
+            {
+                break;
+            }
+            p_body->eddystone_tlm.battery_mv  = be16(&p_data[2]);
+            p_body->eddystone_tlm.temperature = (int16_t)be16(&p_data[4]);
+            p_body->eddystone_tlm.adv_count   = be32(&p_data[6]);
+            p_body->eddystone_tlm.uptime_ds   = be32(&p_data[10]);
+            return SCAN_BEACON_EDDYSTONE_TLM;
+
+        case EDDYSTONE_FRAME_EID:
+            if (len < EDDYSTONE_EID_LEN)
+            {
+                break;
+            }
+            p_body->eddystone_eid.tx_power = (int8_t)p_data[1];
+            memcpy(p_body->eddystone_eid.eid, &p_data[2], sizeof(p_body->eddystone_eid.eid));
+            return SCAN_BEACON_EDDYSTONE_EID;
+
+        default:
+            break;
+    }
+
+    return SCAN_BEACON_NONE;
+}
+
+
+scan_beacon_type_t scan_beacon_decode(uint8_t const      * p_data,
+                                      uint16_t             len,
+                                      scan_beacon_body_t * p_body)
+{
+    uint16_t offset = 0;
+
+    // Each AD structure is a length byte, then the AD type and its data.
+    while (offset + 2 <= len)
+    {
+        uint8_t            ad_len = p_data[offset];
+        uint8_t const    * p_ad   = &p_data[offset + 2];
+        scan_beacon_type_t type   = SCAN_BEACON_NONE;
+
+        // A zero length ends the significant part of the data.
+        if ((ad_len == 0) || (ad_len > len - offset - 1))
+        {
+            break;
+        }
+
+        switch (p_data[offset + 1])
+        {
+            case AD_TYPE_MANUFACTURER_DATA:
+                type = manufacturer_decode(p_ad, ad_len - 1, p_body);
+                break;
+
+            case AD_TYPE_SERVICE_DATA_16:
+                if ((ad_len >= 3) && (le16(p_ad) == EDDYSTONE_UUID))
+                {
+                    type = eddystone_decode(p_ad + 2, ad_len - 3, p_body);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (type != SCAN_BEACON_NONE)
+        {
+            return type;
+        }
+
+        offset += ad_len + 1;
+    }
+
+    return SCAN_BEACON_NONE;
+}
+
+
+uint8_t scan_beacon_body_len(uint8_t type)
+{
+    switch (type)
+    {
+        case SCAN_BEACON_IBEACON:
+            return sizeof(scan_ibeacon_t);
+
+        case SCAN_BEACON_ALTBEACON:
+            return sizeof(scan_altbeacon_t);
+
+        case SCAN_BEACON_EDDYSTONE_UID:
+            return sizeof(scan_eddystone_uid_t);
+
+        case SCAN_BEACON_EDDYSTONE_URL:
+            return sizeof(scan_eddystone_url_t);
+
+        case SCAN_BEACON_EDDYSTONE_TLM:
+            return sizeof(scan_eddystone_tlm_t);
+
+        case SCAN_BEACON_EDDYSTONE_EID:
+            return sizeof(scan_eddystone_eid_t);
+
+        default:
+            return 0;
+    }
+}
+
+
+size_t scan_beacon_url_expand(scan_eddystone_url_t const * p_url, char * p_buf, size_t size)
+{
+    size_t len = 0;
+
+    // Appends the expansion of every byte, one character at a time to cut it cleanly.
+    for (int i = -1; i < p_url->url_len && i < SCAN_EDDYSTONE_URL_MAX; i++)
+    {
+        char const * p_text;
+        char         single[2] = { '?', '\0' };
+
+        if (i < 0)
+        {
+            p_text = (p_url->scheme < EDDYSTONE_SCHEME_COUNT) ? m_url_schemes[p_url->scheme] : "";
+        }
+        else if (p_url->url[i] < sizeof(m_url_codes) / sizeof(m_url_codes[0]))
+        {
+            p_text = m_url_codes[p_url->url[i]];
+        }
+        else
+        {
+            if ((p_url->url[i] > ' ') && (p_url->url[i] < 0x7F))
+            {
+                single[0] = (char)p_url->url[i];
+            }
+            p_text = single;
+        }
+
+        for (; *p_text != '\0' && len + 1 < size; p_text++)
+        {
+            p_buf[len++] = *p_text;
+        }
+    }
+
+    p_buf[len] = '\0';
+
+    return len;
+}
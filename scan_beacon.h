@@ -0,0 +1,65 @@
+/***************************************************************************************/
+/*
+ * scan_beacon
+ *
+ *  Decoding of the common beacon formats: iBeacon, AltBeacon and the Eddystone UID,
+ *  URL, TLM (unencrypted) and EID frames.
+ *
+ *  The advertising data is walked once, AD structure by AD structure; the first one
+ *  that holds a known beacon gives its identifiers and measurements in the compact
+ *  form of the BEACON records (see scan_frame.h). A malformed AD structure ends the
+ *  walk.
+ *
+ *  The module has no SDK dependencies so the host tools can build it too, and decode
+ *  the advertising reports of a scanner that does not do it.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_BEACON_H__
+#define SCAN_BEACON_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for decoding the beacon of an advertising report.
+ *
+ * @param[in]   p_data      Advertising data.
+ * @param[in]   len         Length of @p p_data.
+ * @param[out]  p_body      Decoded beacon. Unchanged if none is found.
+ *
+ * @return Type of the beacon, @ref SCAN_BEACON_NONE if the data holds none.
+ */
+scan_beacon_type_t scan_beacon_decode(uint8_t const      * p_data,
+                                      uint16_t             len,
+                                      scan_beacon_body_t * p_body);
+
+
+/**@brief Function for getting the length of the body of a beacon type.
+ *
+ * @return Bytes that follow @ref scan_beacon_hdr_t in a BEACON record, 0 if the type is unknown.
+ */
+uint8_t scan_beacon_body_len(uint8_t type);
+
+
+/**@brief Function for expanding the URL of an Eddystone-URL frame.
+ *
+ * @details Reserved bytes are replaced by '?'. The URL is cut to fit @p size.
+ *
+ * @param[in]   p_url       Decoded frame.
+ * @param[out]  p_buf       Buffer for the URL, NUL terminated.
+ * @param[in]   size        Size of @p p_buf, at least 1.
+ *
+ * @return Length of the URL written.
+ */
+size_t scan_beacon_url_expand(scan_eddystone_url_t const * p_url, char * p_buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_BEACON_H__
@@ -0,0 +1,338 @@
+/***************************************************************************************/
+/*
+ * scan_chain
+ *
+ *  Reassembly of extended advertising chains.
+ *
+ *  The pool is small (a few chains at a time), so the entries are searched linearly.
+ *  Every handler call is made before the state it depends on is changed, or the
+ *  change is undone if the handler refuses, so a refused report can be added again.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_chain.h"
+
+#define SKIP_COUNT(_p)  (2 * (_p)->count)                               /**< Chains closed early remembered. */
+
+
+static uint8_t report_status(scan_report_hdr_t const * p_hdr)
+{
+    return (p_hdr->flags & SCAN_REPORT_FLAG_STATUS_Msk) >> SCAN_REPORT_FLAG_STATUS_Pos;
+}
+
+
+static uint8_t * entry_data(scan_chain_t const * p_chain, uint32_t idx)
+{
+    return &p_chain->p_data[idx * SCAN_REPORT_CHAIN_DATA_MAX];
+}
+
+
+static bool key_match(scan_report_hdr_t const * p_a, scan_report_hdr_t const * p_b)
+{
+    return (p_a->set_id == p_b->set_id)
+        && (p_a->addr_type == p_b->addr_type)
+        && (((p_a->flags ^ p_b->flags) & SCAN_REPORT_FLAG_SCAN_RESPONSE) == 0)
+        && (memcmp(p_a->addr, p_b->addr, sizeof(p_a->addr)) == 0);
+}
+
+
+static bool skip_match(scan_chain_key_t const * p_skip, scan_report_hdr_t const * p_hdr)
+{
+    return p_skip->used
+        && (p_skip->set_id == p_hdr->set_id)
+        && (p_skip->addr_type == p_hdr->addr_type)
+        && (p_skip->scan_rsp == ((p_hdr->flags & SCAN_REPORT_FLAG_SCAN_RESPONSE) != 0))
+        && (memcmp(p_skip->addr, p_hdr->addr, sizeof(p_skip->addr)) == 0);
+}
+
+
+/**@brief Function for finding the chain of a report. Returns count if there is none. */
+static uint32_t entry_find(scan_chain_t const * p_chain, scan_report_hdr_t const * p_hdr)
+{
+    for (uint32_t i = 0; i < p_chain->count; i++)
+    {
+        if (p_chain->p_entries[i].used && key_match(&p_chain->p_entries[i].hdr, p_hdr))
+        {
+            return i;
+        }
+    }
+    return p_chain->count;
+}
+
+
+/**@brief Function for remembering a chain closed early, so its next fragments are dropped.
+ *
+ * @details A free slot is taken first. Only when every slot holds a chain still
+ *          dropping fragments is the oldest one overwritten: its remaining fragments
+ *          will be produced as a chain of their own.
+ */
+static void skip_add(scan_chain_t * p_chain, scan_report_hdr_t const * p_hdr)
+{
+    scan_chain_key_t * p_skip;
+
+    for (uint32_t i = 0; i < SKIP_COUNT(p_chain); i++)
+    {
+        if (!p_chain->p_skips[p_chain->skip_idx].used)
+        {
+            break;
+        }
+        p_chain->skip_idx = (p_chain->skip_idx + 1 == SKIP_COUNT(p_chain)) ? 0 : p_chain->skip_idx + 1;
+    }
+    p_skip = &p_chain->p_skips[p_chain->skip_idx];
+
+    memcpy(p_skip->addr, p_hdr->addr, sizeof(p_skip->addr));
+    p_skip->addr_type = p_hdr->addr_type;
+    p_skip->set_id    = p_hdr->set_id;
+    p_skip->scan_rsp  = (p_hdr->flags & SCAN_REPORT_FLAG_SCAN_RESPONSE) != 0;
+    p_skip->data_id   = p_hdr->data_id;
+    p_skip->used      = true;
+
+    p_chain->skip_idx = (p_chain->skip_idx + 1 == SKIP_COUNT(p_chain)) ? 0 : p_chain->skip_idx + 1;
+}
+
+
+/**@brief Function for dropping the fragments of the chains closed early.
+ *
+ * @return true if the report belongs to such a chain and must be dropped.
+ */
+static bool skip_check(scan_chain_t * p_chain, scan_report_hdr_t const * p_hdr)
+{
+    for (uint32_t i = 0; i < SKIP_COUNT(p_chain); i++)
+    {
+        scan_chain_key_t * p_skip = &p_chain->p_skips[i];
+
+        if (!skip_match(p_skip, p_hdr))
+        {
+            continue;
+        }
+
+        // A new chain of the same advertiser: the old one is over.
+        if (p_skip->data_id != p_hdr->data_id)
+        {
+            p_skip->used = false;
+            return false;
+        }
+
+        if (report_status(p_hdr) != SCAN_REPORT_STATUS_MORE_DATA)
+        {
+            p_skip->used = false;
+        }
+        p_chain->skipped++;
+        return true;
+    }
+    return false;
+}
+
+
+/**@brief Function for adding data to a chain, as much as the buffer can take. */
+static void entry_append(scan_chain_t * p_chain, uint32_t idx, uint8_t const * p_data, uint16_t len)
+{
+    scan_chain_entry_t * p_entry = &p_chain->p_entries[idx];
+    uint16_t             room    = SCAN_REPORT_CHAIN_DATA_MAX - p_entry->hdr.data_len;
+
+    if (len > room)
+    {
+        len                = room;
+        p_entry->truncated = true;
+    }
+
+    memcpy(entry_data(p_chain, idx) + p_entry->hdr.data_len, p_data, len);
+    p_entry->hdr.data_len += len;
+}
+
+
+/**@brief Function for producing a chain and freeing its entry.
+ *
+ * @param[in]   status      Status of the last fragment received.
+ */
+static bool entry_produce(scan_chain_t       * p_chain,
+                          uint32_t             idx,
+                          uint8_t              status,
+                          scan_chain_handler_t handler,
+                          void               * p_context)
+{
+    scan_chain_entry_t * p_entry = &p_chain->p_entries[idx];
+    scan_report_hdr_t    hdr     = p_entry->hdr;
+
+    hdr.flags &= ~(SCAN_REPORT_FLAG_STATUS_Msk | SCAN_REPORT_FLAG_TRUNCATED);
+    hdr.flags |= (status << SCAN_REPORT_FLAG_STATUS_Pos) & SCAN_REPORT_FLAG_STATUS_Msk;
+    if (p_entry->truncated || (status != SCAN_REPORT_STATUS_COMPLETE))
+    {
+        hdr.flags |= SCAN_REPORT_FLAG_TRUNCATED;
+    }
+
+    if (!handler(&hdr, entry_data(p_chain, idx), p_context))
+    {
+        return false;
+    }
+
+    p_chain->chains++;
+    if ((hdr.flags & SCAN_REPORT_FLAG_TRUNCATED) != 0)
+    {
+        p_chain->truncated++;
+    }
+    p_entry->used = false;
+    return true;
+}
+
+
+/**@brief Function for getting a free entry, closing the chain with the oldest fragment if needed.
+ *
+ * @return Entry, or count if the handler refused the chain closed.
+ */
+static uint32_t entry_alloc(scan_chain_t * p_chain, scan_chain_handler_t handler, void * p_context)
+{
+    uint32_t oldest = 0;
+
+    for (uint32_t i = 0; i < p_chain->count; i++)
+    {
+        if (!p_chain->p_entries[i].used)
+        {
+            return i;
+        }
+        if (p_chain->p_entries[i].last_us < p_chain->p_entries[oldest].last_us)
+        {
+            oldest = i;
+        }
+    }
+
+    if (!entry_produce(p_chain, oldest, SCAN_REPORT_STATUS_TRUNCATED, handler, p_context))
+    {
+        return p_chain->count;
+    }
+    p_chain->evictions++;
+    skip_add(p_chain, &p_chain->p_entries[oldest].hdr);
+    return oldest;
+}
+
+
+void scan_chain_init(scan_chain_t * p_chain, uint64_t timeout_us)
+{
+    memset(p_chain->p_entries, 0, p_chain->count * sizeof(p_chain->p_entries[0]));
+    memset(p_chain->p_skips, 0, SKIP_COUNT(p_chain) * sizeof(p_chain->p_skips[0]));
+
+    p_chain->skip_idx   = 0;
+    p_chain->timeout_us = timeout_us;
+    p_chain->chains     = 0;
+    p_chain->truncated  = 0;
+    p_chain->evictions  = 0;
+    p_chain->skipped    = 0;
+}
+
+
+bool scan_chain_add(scan_chain_t            * p_chain,
+                    scan_report_hdr_t const * p_hdr,
+                    uint8_t const           * p_data,
+                    scan_chain_handler_t      handler,
+                    void                    * p_context)
+{
+    uint8_t              status = report_status(p_hdr);
+    uint32_t             idx;
+    scan_chain_entry_t * p_entry;
+
+    // Legacy advertising is never chained.
+    if ((p_hdr->flags & SCAN_REPORT_FLAG_EXTENDED_PDU) == 0)
+    {
+        return handler(p_hdr, p_data, p_context);
+    }
+
+    idx = entry_find(p_chain, p_hdr);
+
+    // The advertiser started another chain: the end of the previous one was lost.
+    if ((idx != p_chain->count) && (p_chain->p_entries[idx].hdr.data_id != p_hdr->data_id))
+    {
+        if (!entry_produce(p_chain, idx, SCAN_REPORT_STATUS_TRUNCATED, handler, p_context))
+        {
+            return false;
+        }
+        idx = p_chain->count;
+    }
+
+    if ((idx == p_chain->count) && skip_check(p_chain, p_hdr))
+    {
+        return true;
+    }
+
+    if (status == SCAN_REPORT_STATUS_MORE_DATA)
+    {
+        if (idx == p_chain->count)
+        {
+            idx = entry_alloc(p_chain, handler, p_context);
+            if (idx == p_chain->count)
+            {
+                return false;
+            }
+
+            p_entry               = &p_chain->p_entries[idx];
+            p_entry->hdr          = *p_hdr;
+            p_entry->hdr.data_len = 0;
+            p_entry->used         = true;
+            p_entry->truncated    = false;
+        }
+
+        entry_append(p_chain, idx, p_data, p_hdr->data_len);
+        p_chain->p_entries[idx].last_us = p_hdr->timestamp_us;
+        return true;
+    }
+
+    if (idx == p_chain->count)
+    {
+        scan_report_hdr_t hdr;
+
+        if (status == SCAN_REPORT_STATUS_COMPLETE)
+        {
+            return handler(p_hdr, p_data, p_context);
+        }
+
+        // A chain cut by the SoftDevice after its first fragment.
+        hdr        = *p_hdr;
+        hdr.flags |= SCAN_REPORT_FLAG_TRUNCATED;
+        if (!handler(&hdr, p_data, p_context))
+        {
+            return false;
+        }
+        p_chain->truncated++;
+        return true;
+    }
+
+    // Last fragment of a chain. Undo the append if the chain is refused.
+    p_entry = &p_chain->p_entries[idx];
+    {
+        uint16_t len       = p_entry->hdr.data_len;
+        bool     truncated = p_entry->truncated;
+
+        entry_append(p_chain, idx, p_data, p_hdr->data_len);
+        if (!entry_produce(p_chain, idx, status, handler, p_context))
+        {
+            p_entry->hdr.data_len = len;
+            p_entry->truncated    = truncated;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool scan_chain_flush(scan_chain_t          * p_chain,
+                      uint64_t                now_us,
+                      scan_chain_handler_t    handler,
+                      void                  * p_context)
+{
+    for (uint32_t i = 0; i < p_chain->count; i++)
+    {
+        scan_chain_entry_t * p_entry = &p_chain->p_entries[i];
+
+        if (!p_entry->used || (now_us < p_entry->last_us + p_chain->timeout_us))
+        {
+            continue;
+        }
+
+        if (!entry_produce(p_chain, i, SCAN_REPORT_STATUS_TRUNCATED, handler, p_context))
+        {
+            return false;
+        }
+        skip_add(p_chain, &p_entry->hdr);
+    }
+    return true;
+}
@@ -0,0 +1,151 @@
+/***************************************************************************************/
+/*
+ * scan_chain
+ *
+ *  Reassembly of extended advertising chains.
+ *
+ *  The SoftDevice reports the data of an AUX_CHAIN_IND chain in fragments of at most
+ *  SCANNER_REPORT_DATA_MAX bytes, all of them but the last with the status "more data".
+ *  The fragments are gathered per advertiser and advertising SID in a small pool of
+ *  buffers of SCAN_REPORT_CHAIN_DATA_MAX bytes, and the chain is produced as a single
+ *  report once its last fragment arrives. Chains from several advertisers can be
+ *  interleaved. Reports that are not part of a chain go through untouched.
+ *
+ *  A report whose data is not complete (chain cut by the SoftDevice, longer than a
+ *  buffer, closed early to make room for another chain, or silent for too long) is
+ *  produced with whatever was received and SCAN_REPORT_FLAG_TRUNCATED. The fragments
+ *  that still arrive for a chain closed early are dropped rather than produced as a
+ *  chain of their own.
+ *
+ *  The module has no SDK dependencies so the host tools can build it too. It is not
+ *  reentrant: all functions of an instance must be called from the same context.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_CHAIN_H__
+#define SCAN_CHAIN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Macro for defining a reassembly pool.
+ *
+ * @param   _name       Name of the instance.
+ * @param   _count      Number of chains reassembled at a time.
+ */
+#define SCAN_CHAIN_DEF(_name, _count)                                               \
+    static scan_chain_entry_t _name##_entries[_count];                              \
+    static scan_chain_key_t   _name##_skips[2 * (_count)];                          \
+    static uint8_t            _name##_data[_count][SCAN_REPORT_CHAIN_DATA_MAX];     \
+    static scan_chain_t _name =                                                     \
+    {                                                                               \
+        .p_entries = _name##_entries,                                               \
+        .p_skips   = _name##_skips,                                                 \
+        .p_data    = &_name##_data[0][0],                                           \
+        .count     = (_count),                                                      \
+    }
+
+/**@brief A chain closed early, whose remaining fragments are dropped. */
+typedef struct
+{
+    uint8_t  addr[6];
+    uint8_t  addr_type;
+    uint8_t  set_id;
+    uint8_t  scan_rsp;                                                  /**< Scan responses are chained apart from the advertisements. */
+    bool     used;
+    uint16_t data_id;
+} scan_chain_key_t;
+
+/**@brief A chain being reassembled. */
+typedef struct
+{
+    scan_report_hdr_t hdr;                                              /**< Header of the first fragment. data_len counts the data gathered so far. */
+    uint64_t          last_us;                                          /**< Time of the last fragment. */
+    bool              used;
+    bool              truncated;                                        /**< Data was left out because the buffer was full. */
+} scan_chain_entry_t;
+
+/**@brief Reassembly pool. Define it with @ref SCAN_CHAIN_DEF. */
+typedef struct
+{
+    scan_chain_entry_t * p_entries;
+    scan_chain_key_t   * p_skips;                                       /**< Chains closed early, twice as many as entries. */
+    uint8_t            * p_data;                                        /**< One buffer of SCAN_REPORT_CHAIN_DATA_MAX bytes per entry. */
+    uint32_t             count;
+    uint32_t             skip_idx;                                      /**< Next slot of p_skips to overwrite. */
+    uint64_t             timeout_us;
+    uint32_t             chains;                                        /**< Chains produced, complete or not. */
+    uint32_t             truncated;                                     /**< Reports produced with SCAN_REPORT_FLAG_TRUNCATED. */
+    uint32_t             evictions;                                     /**< Chains closed early to make room for another one. */
+    uint32_t             skipped;                                       /**< Fragments dropped because their chain was closed early. */
+} scan_chain_t;
+
+/**@brief Handler for the reports produced.
+ *
+ * @param[in]   p_hdr       Report metadata. data_len is the length of @p p_data.
+ * @param[in]   p_data      Advertising data, only valid during the call.
+ * @param[in]   p_context   Context given with the report.
+ *
+ * @return false if the report could not be taken. It is produced again on the next call.
+ */
+typedef bool (*scan_chain_handler_t)(scan_report_hdr_t const * p_hdr,
+                                     uint8_t const           * p_data,
+                                     void                    * p_context);
+
+
+/**@brief Function for emptying a pool.
+ *
+ * @param[in]   p_chain     Pool.
+ * @param[in]   timeout_us  Time after the last fragment at which a chain is given up.
+ */
+void scan_chain_init(scan_chain_t * p_chain, uint64_t timeout_us);
+
+
+/**@brief Function for adding an advertising report.
+ *
+ * @details A fragment is kept and nothing is produced until the last one of its chain.
+ *          If no buffer is free, the chain with the oldest fragment is produced first,
+ *          truncated. Any other report is produced at once, after the fragments of its
+ *          chain if there are any.
+ *
+ * @param[in]   p_chain     Pool.
+ * @param[in]   p_hdr       Report metadata. data_len is the length of @p p_data.
+ * @param[in]   p_data      Advertising data.
+ * @param[in]   handler     Report handler.
+ * @param[in]   p_context   Passed to @p handler.
+ *
+ * @return false if @p handler refused a report. The report was not added.
+ */
+bool scan_chain_add(scan_chain_t            * p_chain,
+                    scan_report_hdr_t const * p_hdr,
+                    uint8_t const           * p_data,
+                    scan_chain_handler_t      handler,
+                    void                    * p_context);
+
+
+/**@brief Function for giving up the chains that stopped receiving fragments.
+ *
+ * @details Chains whose last fragment is older than the timeout are produced, truncated.
+ *
+ * @param[in]   p_chain     Pool.
+ * @param[in]   now_us      Current time, in the time base of the report timestamps.
+ * @param[in]   handler     Report handler.
+ * @param[in]   p_context   Passed to @p handler.
+ *
+ * @return false if @p handler refused a report.
+ */
+bool scan_chain_flush(scan_chain_t          * p_chain,
+                      uint64_t                now_us,
+                      scan_chain_handler_t    handler,
+                      void                  * p_context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_CHAIN_H__
@@ -0,0 +1,220 @@
+/***************************************************************************************/
+/*
+ * scan_cmd
+ *
+ *  Handling of the commands sent by the host over the serial link.
+ *
+ *  A baud rate change is a three-step handshake: the response to the command goes
+ *  out at the old baud rate, the link switches once it has been sent, and a HELLO is
+ *  sent at the new baud rate. The host then has SCANNER_BAUD_CONFIRM_MS to send a
+ *  HELLO back; if it does not, the host could not follow and the previous
+ *  configuration is restored.
+ *
+ *  The host only changes its own baud rate once it has read the response, so the
+ *  first HELLO may reach it at the wrong rate. The HELLO is repeated
+ *  CONFIRM_HELLO_COUNT times over the confirmation time.
+ *
+ *  The host sends a command again when it gets no response, so a command is only
+ *  carried out once its response is sure to be queued. Otherwise it is answered with
+ *  BUSY as soon as there is room, and the host sends it again: a FILTER_ADD applied
+ *  without its response would be added twice.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "sdk_common.h"
+#include "scan_cmd.h"
+#include "scan_frame.h"
+#include "scan_output.h"
+#include "app_timer.h"
+#include "app_error.h"
+
+#define CONFIRM_HELLO_COUNT     4                                       /**< HELLOs sent at the new baud rate while waiting for the host. */
+
+APP_TIMER_DEF(m_confirm_timer);                                         /**< Baud rate change confirmation timer, one tick per HELLO. */
+
+static bool               m_hello_pending;                              /**< A HELLO must be sent. */
+static bool               m_busy_pending;                               /**< A BUSY response must be sent. */
+static uint8_t            m_busy_cmd;                                   /**< Command it answers. */
+static bool               m_confirm_pending;                            /**< Waiting for the host to confirm a baud rate change. */
+static uint8_t            m_confirm_hellos;                             /**< HELLOs sent at the new baud rate so far. */
+static volatile bool      m_confirm_tick;                               /**< Set by the confirmation timer. */
+static uint32_t           m_prev_baudrate;                              /**< Configuration to restore if the change is not confirmed. */
+static bool               m_prev_hwfc;
+static scan_cmd_handler_t m_app_handler;                                /**< Handler of the application commands. */
+
+
+/**@brief Function for handling a tick of the confirmation timer. */
+static void confirm_timeout_handler(void * p_context)
+{
+    m_confirm_tick = true;
+}
+
+
+/**@brief Function for sending a command response without data.
+ *
+ * @return NRF_SUCCESS if the response has been queued.
+ */
+static ret_code_t rsp_send(uint8_t cmd, uint8_t status)
+{
+    scan_cmd_rsp_t rsp =
+    {
+        .cmd    = cmd,
+        .status = status,
+    };
+
+    return scan_output_send(SCAN_FRAME_TYPE_CMD_RSP, &rsp, sizeof(rsp), NULL, 0);
+}
+
+
+/**@brief Function for sending the link parameters.
+ *
+ * @return NRF_SUCCESS if the frame has been queued.
+ */
+static ret_code_t hello_send(void)
+{
+    scan_hello_t hello;
+    bool         hwfc;
+
+    memset(&hello, 0, sizeof(hello));
+    hello.version = SCAN_PROTOCOL_VERSION;
+    scan_output_uart_config_get(&hello.baudrate, &hwfc);
+    hello.flags   = hwfc ? SCAN_LINK_FLAG_HWFC : 0;
+
+    return scan_output_send(SCAN_FRAME_TYPE_HELLO, &hello, sizeof(hello), NULL, 0);
+}
+
+
+/**@brief Function for handling @ref SCAN_CMD_UART_CONFIG. */
+static void uart_config_handle(uint8_t const * p_payload, uint16_t len)
+{
+    scan_cmd_uart_config_t cmd;
+    uint32_t               baudrate;
+    bool                   hwfc;
+
+    if (len != sizeof(cmd))
+    {
+        UNUSED_RETURN_VALUE(rsp_send(SCAN_CMD_UART_CONFIG, SCAN_CMD_STATUS_INVALID));
+        return;
+    }
+    memcpy(&cmd, p_payload, sizeof(cmd));
+
+    if (!scan_output_baudrate_is_supported(cmd.baudrate))
+    {
+        UNUSED_RETURN_VALUE(rsp_send(SCAN_CMD_UART_CONFIG, SCAN_CMD_STATUS_INVALID));
+        return;
+    }
+    if (m_confirm_pending || scan_output_switch_pending())
+    {
+        UNUSED_RETURN_VALUE(rsp_send(SCAN_CMD_UART_CONFIG, SCAN_CMD_STATUS_BUSY));
+        return;
+    }
+
+    // Only switch if the host gets the response, otherwise it will retry.
+    if (rsp_send(SCAN_CMD_UART_CONFIG, SCAN_CMD_STATUS_OK) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    scan_output_uart_config_get(&baudrate, &hwfc);
+    if (scan_output_uart_config_set(cmd.baudrate, (cmd.flags & SCAN_LINK_FLAG_HWFC) != 0) == NRF_SUCCESS)
+    {
+        m_prev_baudrate   = baudrate;
+        m_prev_hwfc       = hwfc;
+        m_confirm_pending = true;
+        m_confirm_hellos  = 0;
+        m_hello_pending   = true;
+    }
+}
+
+
+/**@brief Function for handling a frame received from the host. */
+static void cmd_handler(uint8_t type, uint8_t const * p_payload, uint16_t len)
+{
+    switch (type)
+    {
+        case SCAN_CMD_HELLO:
+            if (m_confirm_pending && (m_confirm_hellos > 0))
+            {
+                // The host follows at the new baud rate.
+                m_confirm_pending = false;
+                UNUSED_RETURN_VALUE(app_timer_stop(m_confirm_timer));
+            }
+            m_hello_pending = true;
+            break;
+
+        case SCAN_CMD_UART_CONFIG:
+            uart_config_handle(p_payload, len);
+            break;
+
+        default:
+            if (!scan_output_has_room(sizeof(scan_cmd_rsp_t)))
+            {
+                // Not carried out. Only the last command refused is answered, the host
+                // sends the others again once they time out.
+                m_busy_pending = true;
+                m_busy_cmd     = type;
+                break;
+            }
+            UNUSED_RETURN_VALUE(rsp_send(type, (m_app_handler != NULL) ? m_app_handler(type, p_payload, len)
+                                                                       : SCAN_CMD_STATUS_UNSUPPORTED));
+            break;
+    }
+}
+
+
+ret_code_t scan_cmd_init(scan_cmd_handler_t app_handler)
+{
+    m_app_handler     = app_handler;
+    m_hello_pending   = true;
+    m_busy_pending    = false;
+    m_confirm_pending = false;
+    m_confirm_tick    = false;
+
+    return app_timer_create(&m_confirm_timer, APP_TIMER_MODE_REPEATED, confirm_timeout_handler);
+}
+
+
+void scan_cmd_process(void)
+{
+    scan_output_rx_process(cmd_handler);
+
+    if (m_busy_pending && (rsp_send(m_busy_cmd, SCAN_CMD_STATUS_BUSY) == NRF_SUCCESS))
+    {
+        m_busy_pending = false;
+    }
+
+    if (m_confirm_tick)
+    {
+        m_confirm_tick = false;
+        if (m_confirm_pending && (m_confirm_hellos >= CONFIRM_HELLO_COUNT))
+        {
+            // The host did not follow, go back to where it can hear us.
+            m_confirm_pending = false;
+            UNUSED_RETURN_VALUE(app_timer_stop(m_confirm_timer));
+            if (scan_output_uart_config_set(m_prev_baudrate, m_prev_hwfc) == NRF_SUCCESS)
+            {
+                m_hello_pending = true;
+            }
+        }
+        else if (m_confirm_pending)
+        {
+            m_hello_pending = true;
+        }
+    }
+
+    if (m_hello_pending && !scan_output_switch_pending())
+    {
+        if (hello_send() == NRF_SUCCESS)
+        {
+            m_hello_pending = false;
+            if (m_confirm_pending && (m_confirm_hellos++ == 0))
+            {
+                ret_code_t err_code = app_timer_start(m_confirm_timer,
+                                                      APP_TIMER_TICKS(SCANNER_BAUD_CONFIRM_MS / CONFIRM_HELLO_COUNT),
+                                                      NULL);
+                APP_ERROR_CHECK(err_code);
+            }
+        }
+    }
+}
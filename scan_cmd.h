@@ -0,0 +1,54 @@
+/***************************************************************************************/
+/*
+ * scan_cmd
+ *
+ *  Handling of the commands sent by the host over the serial link.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_CMD_H__
+#define SCAN_CMD_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Handler of the commands carried out by the application.
+ *
+ * @details Called from @ref scan_cmd_process for the commands the link handling does
+ *          not know, once there is room for the response, which is sent with the
+ *          status returned. A command that comes while the output is full is answered
+ *          with SCAN_CMD_STATUS_BUSY instead and the handler is not called.
+ *
+ * @param[in]   cmd         Command, @ref scan_cmd_type_t.
+ * @param[in]   p_payload   Payload of the command.
+ * @param[in]   len         Length of the payload.
+ *
+ * @return @ref scan_cmd_status_t of the response, SCAN_CMD_STATUS_UNSUPPORTED for an unknown command.
+ */
+typedef uint8_t (*scan_cmd_handler_t)(uint8_t cmd, uint8_t const * p_payload, uint16_t len);
+
+
+/**@brief Function for initializing the command handling.
+ *
+ * @details Announces the link parameters with a HELLO frame. Call it after the
+ *          output and app_timer have been initialized.
+ *
+ * @param[in]   app_handler Handler of the application commands. Can be NULL.
+ *
+ * @return NRF_SUCCESS or an error code from app_timer.
+ */
+ret_code_t scan_cmd_init(scan_cmd_handler_t app_handler);
+
+
+/**@brief Function for handling the received commands. Call it from the main loop. */
+void scan_cmd_process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_CMD_H__
@@ -0,0 +1,272 @@
+/***************************************************************************************/
+/*
+ * scan_dedup
+ *
+ *  Duplicate suppression of advertising reports.
+ *
+ *  Linear probing over a power of 2 table, filled to 3/4 at most so a lookup always
+ *  reaches a free entry. A free entry has a key hash of 0. Entries are removed with
+ *  backward shift deletion, so no tombstones are needed.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_dedup.h"
+
+#define FNV_OFFSET      2166136261u
+#define FNV_PRIME       16777619u
+
+#define IDX_MASK(_p)    ((_p)->capacity - 1)
+#define MAX_COUNT(_p)   ((_p)->capacity - (_p)->capacity / 4)
+
+
+/**@brief Function for hashing a buffer (FNV-1a). */
+static uint32_t hash_update(uint32_t hash, uint8_t const * p_data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        hash ^= p_data[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+static bool is_scan_rsp(scan_report_hdr_t const * p_hdr)
+{
+    return (p_hdr->flags & SCAN_REPORT_FLAG_SCAN_RESPONSE) != 0;
+}
+
+
+static uint32_t key_hash(scan_report_hdr_t const * p_hdr)
+{
+    uint8_t  tail[3] = { p_hdr->addr_type, p_hdr->set_id, is_scan_rsp(p_hdr) };
+    uint32_t hash;
+
+    hash = hash_update(FNV_OFFSET, p_hdr->addr, sizeof(p_hdr->addr));
+    hash = hash_update(hash, tail, sizeof(tail));
+
+    // 0 marks the free entries.
+    return (hash != 0) ? hash : 1;
+}
+
+
+static uint32_t data_hash(scan_report_hdr_t const * p_hdr, uint8_t const * p_data)
+{
+    return hash_update(FNV_OFFSET, p_data, p_hdr->data_len);
+}
+
+
+/**@brief Function for finding the entry of an advertiser.
+ *
+ * @return Index of the entry, or of the free entry where it would be inserted.
+ */
+static uint32_t entry_find(scan_dedup_t const * p_dedup, scan_report_hdr_t const * p_hdr, uint32_t hash)
+{
+    uint32_t idx = hash & IDX_MASK(p_dedup);
+
+    for (;;)
+    {
+        scan_dedup_entry_t const * p_entry = &p_dedup->p_entries[idx];
+
+        if (p_entry->key_hash == 0)
+        {
+            return idx;
+        }
+        if ((p_entry->key_hash == hash)                           &&
+            (memcmp(p_entry->addr, p_hdr->addr, sizeof(p_entry->addr)) == 0) &&
+            (p_entry->addr_type == p_hdr->addr_type)             &&
+            (p_entry->set_id == p_hdr->set_id)                   &&
+            (p_entry->scan_rsp == is_scan_rsp(p_hdr)))
+        {
+            return idx;
+        }
+        idx = (idx + 1) & IDX_MASK(p_dedup);
+    }
+}
+
+
+/**@brief Function for removing an entry.
+ *
+ * @details The entries that follow it in the same probe sequence are moved back, so
+ *          that a lookup never stops at the hole too early.
+ */
+static void entry_remove(scan_dedup_t * p_dedup, uint32_t idx)
+{
+    uint32_t mask = IDX_MASK(p_dedup);
+    uint32_t next = idx;
+
+    p_dedup->count--;
+
+    for (;;)
+    {
+        uint32_t home;
+
+        p_dedup->p_entries[idx].key_hash = 0;
+
+        // Find the next entry that may take the hole: one whose home is not
+        // cyclically within (idx, next].
+        do
+        {
+            next = (next + 1) & mask;
+            if (p_dedup->p_entries[next].key_hash == 0)
+            {
+                return;
+            }
+            home = p_dedup->p_entries[next].key_hash & mask;
+        } while ((idx <= next) ? ((idx < home) && (home <= next))
+                               : ((idx < home) || (home <= next)));
+
+        p_dedup->p_entries[idx] = p_dedup->p_entries[next];
+        idx = next;
+    }
+}
+
+
+void scan_dedup_init(scan_dedup_t * p_dedup, uint64_t summary_us, uint64_t expiry_us)
+{
+    for (uint32_t i = 0; i < p_dedup->capacity; i++)
+    {
+        p_dedup->p_entries[i].key_hash = 0;
+    }
+
+    p_dedup->count      = 0;
+    p_dedup->sweep_idx  = 0;
+    p_dedup->summary_us = summary_us;
+    p_dedup->expiry_us  = expiry_us;
+    p_dedup->duplicates = 0;
+    p_dedup->untracked  = 0;
+}
+
+
+scan_dedup_result_t scan_dedup_check(scan_dedup_t            * p_dedup,
+                                     scan_report_hdr_t const * p_hdr,
+                                     uint8_t const           * p_data)
+{
+    scan_dedup_entry_t * p_entry;
+    uint32_t             hash;
+
+    // The fragments of a chain are only meaningful together.
+    if ((p_hdr->flags & SCAN_REPORT_FLAG_STATUS_Msk) != 0)
+    {
+        return SCAN_DEDUP_UNTRACKED;
+    }
+
+    hash    = key_hash(p_hdr);
+    p_entry = &p_dedup->p_entries[entry_find(p_dedup, p_hdr, hash)];
+
+    if (p_entry->key_hash == 0)
+    {
+        return (p_dedup->count < MAX_COUNT(p_dedup)) ? SCAN_DEDUP_NEW : SCAN_DEDUP_UNTRACKED;
+    }
+
+    if (p_entry->data_hash != data_hash(p_hdr, p_data))
+    {
+        return SCAN_DEDUP_CHANGED;
+    }
+
+    p_entry->last_seen_us = p_hdr->timestamp_us;
+    p_entry->rssi         = p_hdr->rssi;
+    if (p_entry->duplicates < UINT16_MAX)
+    {
+        p_entry->duplicates++;
+    }
+    p_dedup->duplicates++;
+
+    return SCAN_DEDUP_DUPLICATE;
+}
+
+
+void scan_dedup_record(scan_dedup_t            * p_dedup,
+                       scan_report_hdr_t const * p_hdr,
+                       uint8_t const           * p_data)
+{
+    scan_dedup_entry_t * p_entry;
+    uint32_t             hash;
+
+    if ((p_hdr->flags & SCAN_REPORT_FLAG_STATUS_Msk) != 0)
+    {
+        return;
+    }
+
+    hash    = key_hash(p_hdr);
+    p_entry = &p_dedup->p_entries[entry_find(p_dedup, p_hdr, hash)];
+
+    if (p_entry->key_hash == 0)
+    {
+        if (p_dedup->count >= MAX_COUNT(p_dedup))
+        {
+            p_dedup->untracked++;
+            return;
+        }
+
+        memcpy(p_entry->addr, p_hdr->addr, sizeof(p_entry->addr));
+        p_entry->key_hash  = hash;
+        p_entry->addr_type = p_hdr->addr_type;
+        p_entry->set_id    = p_hdr->set_id;
+        p_entry->scan_rsp  = is_scan_rsp(p_hdr);
+        p_dedup->count++;
+    }
+
+    p_entry->data_hash    = data_hash(p_hdr, p_data);
+    p_entry->last_seen_us = p_hdr->timestamp_us;
+    p_entry->last_sent_us = p_hdr->timestamp_us;
+    p_entry->rssi         = p_hdr->rssi;
+    p_entry->duplicates   = 0;
+}
+
+
+bool scan_dedup_sweep(scan_dedup_t               * p_dedup,
+                      uint64_t                     now_us,
+                      scan_dedup_summary_handler_t handler,
+                      void                       * p_context)
+{
+    uint32_t visited = 0;
+
+    while (visited < p_dedup->capacity)
+    {
+        uint32_t             idx     = p_dedup->sweep_idx;
+        scan_dedup_entry_t * p_entry = &p_dedup->p_entries[idx];
+
+        if (p_entry->key_hash != 0)
+        {
+            if ((now_us > p_entry->last_seen_us) &&
+                (now_us - p_entry->last_seen_us >= p_dedup->expiry_us))
+            {
+                // Another entry may have moved into this one, visit it again.
+                entry_remove(p_dedup, idx);
+                continue;
+            }
+
+            if ((p_dedup->summary_us != 0)                    &&
+                (p_entry->duplicates != 0)                    &&
+                (now_us > p_entry->last_sent_us)              &&
+                (now_us - p_entry->last_sent_us >= p_dedup->summary_us))
+            {
+                scan_alive_t alive =
+                {
+                    .timestamp_us = p_entry->last_seen_us,
+                    .addr_type    = p_entry->addr_type,
+                    .set_id       = p_entry->set_id,
+                    .flags        = p_entry->scan_rsp ? SCAN_REPORT_FLAG_SCAN_RESPONSE : 0,
+                    .rssi         = p_entry->rssi,
+                    .count        = p_entry->duplicates,
+                };
+
+                memcpy(alive.addr, p_entry->addr, sizeof(alive.addr));
+                if (!handler(&alive, p_context))
+                {
+                    return false;
+                }
+                p_entry->last_sent_us = now_us;
+                p_entry->duplicates   = 0;
+            }
+        }
+
+        p_dedup->sweep_idx = (idx + 1) & IDX_MASK(p_dedup);
+        visited++;
+    }
+
+    return true;
+}
@@ -0,0 +1,136 @@
+/***************************************************************************************/
+/*
+ * scan_dedup
+ *
+ *  Duplicate suppression of advertising reports.
+ *
+ *  A fixed size, open addressing hash table tracks every advertiser, keyed by its
+ *  address and advertising SID. Each entry keeps a hash of the last advertising data
+ *  forwarded: a report is forwarded when the advertiser is new or its data changed,
+ *  and dropped otherwise. For the advertisers that keep sending the same data, a
+ *  periodic "still alive" summary with the last RSSI is produced instead.
+ *
+ *  The module has no SDK dependencies so the host tools can build it too. It is not
+ *  reentrant: all functions of an instance must be called from the same context.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_DEDUP_H__
+#define SCAN_DEDUP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Macro for defining a duplicate suppression table.
+ *
+ * @param   _name       Name of the instance.
+ * @param   _capacity   Number of entries (power of 2). At most 3/4 of them are used.
+ */
+#define SCAN_DEDUP_DEF(_name, _capacity)                                            \
+    static scan_dedup_entry_t _name##_entries[_capacity];                           \
+    static scan_dedup_t _name =                                                     \
+    {                                                                               \
+        .p_entries = _name##_entries,                                               \
+        .capacity  = (_capacity),                                                   \
+    }
+
+/**@brief Result of @ref scan_dedup_check. */
+typedef enum
+{
+    SCAN_DEDUP_NEW,                                                     /**< Unknown advertiser. Forward the report. */
+    SCAN_DEDUP_CHANGED,                                                 /**< The advertising data changed. Forward the report. */
+    SCAN_DEDUP_DUPLICATE,                                               /**< Same data as the last forwarded report. Drop it. */
+    SCAN_DEDUP_UNTRACKED,                                               /**< The table is full or the report is a fragment. Forward it. */
+} scan_dedup_result_t;
+
+/**@brief A tracked advertiser. */
+typedef struct
+{
+    uint64_t last_seen_us;                                              /**< Time of the last report. */
+    uint64_t last_sent_us;                                              /**< Time of the last forwarded report or summary. */
+    uint32_t key_hash;                                                  /**< Hash of the key, 0 if the entry is free. */
+    uint32_t data_hash;                                                 /**< Hash of the last forwarded advertising data. */
+    uint8_t  addr[6];
+    uint8_t  addr_type;
+    uint8_t  set_id;
+    uint8_t  scan_rsp;                                                  /**< Scan responses are tracked apart from the advertisements. */
+    int8_t   rssi;                                                      /**< RSSI of the last report. */
+    uint16_t duplicates;                                                /**< Reports dropped since the last forwarded report or summary. */
+} scan_dedup_entry_t;
+
+/**@brief Duplicate suppression table. Define it with @ref SCAN_DEDUP_DEF. */
+typedef struct
+{
+    scan_dedup_entry_t * p_entries;
+    uint32_t             capacity;
+    uint32_t             count;                                         /**< Entries in use. */
+    uint32_t             sweep_idx;                                     /**< Next entry visited by @ref scan_dedup_sweep. */
+    uint64_t             summary_us;
+    uint64_t             expiry_us;
+    uint32_t             duplicates;                                    /**< Reports dropped. */
+    uint32_t             untracked;                                     /**< Reports forwarded because the table was full. */
+} scan_dedup_t;
+
+/**@brief Handler for the summaries produced by @ref scan_dedup_sweep.
+ *
+ * @return false if the summary could not be sent. The sweep stops and the summary is
+ *         produced again on the next sweep.
+ */
+typedef bool (*scan_dedup_summary_handler_t)(scan_alive_t const * p_alive, void * p_context);
+
+
+/**@brief Function for emptying a table.
+ *
+ * @param[in]   p_dedup     Table.
+ * @param[in]   summary_us  Period of the summaries of an advertiser whose reports are dropped.
+ *                          0 disables the summaries.
+ * @param[in]   expiry_us   Time after which a silent advertiser is forgotten.
+ */
+void scan_dedup_init(scan_dedup_t * p_dedup, uint64_t summary_us, uint64_t expiry_us);
+
+
+/**@brief Function for checking whether a report must be forwarded.
+ *
+ * @details Only duplicates update the table. When the report is forwarded, call
+ *          @ref scan_dedup_record once it has been accepted by the output, so a report
+ *          refused for lack of room is not taken as sent.
+ *
+ * @param[in]   p_dedup     Table.
+ * @param[in]   p_hdr       Report metadata.
+ * @param[in]   p_data      Advertising data, p_hdr->data_len bytes.
+ */
+scan_dedup_result_t scan_dedup_check(scan_dedup_t            * p_dedup,
+                                     scan_report_hdr_t const * p_hdr,
+                                     uint8_t const           * p_data);
+
+
+/**@brief Function for recording a forwarded report. */
+void scan_dedup_record(scan_dedup_t            * p_dedup,
+                       scan_report_hdr_t const * p_hdr,
+                       uint8_t const           * p_data);
+
+
+/**@brief Function for producing the due summaries and forgetting the silent advertisers.
+ *
+ * @param[in]   p_dedup     Table.
+ * @param[in]   now_us      Current time, in the time base of the report timestamps.
+ * @param[in]   handler     Summary handler.
+ * @param[in]   p_context   Passed to @p handler.
+ *
+ * @return true if the whole table was visited, false if @p handler refused a summary.
+ */
+bool scan_dedup_sweep(scan_dedup_t               * p_dedup,
+                      uint64_t                     now_us,
+                      scan_dedup_summary_handler_t handler,
+                      void                       * p_context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_DEDUP_H__
@@ -0,0 +1,528 @@
+/***************************************************************************************/
+/*
+ * scan_filter
+ *
+ *  Early rejection of advertising reports.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_filter.h"
+
+#define AD_TYPE_UUID16_INCOMPLETE   0x02
+#define AD_TYPE_UUID16_COMPLETE     0x03
+#define AD_TYPE_UUID32_INCOMPLETE   0x04
+#define AD_TYPE_UUID32_COMPLETE     0x05
+#define AD_TYPE_UUID128_INCOMPLETE  0x06
+#define AD_TYPE_UUID128_COMPLETE    0x07
+#define AD_TYPE_SERVICE_DATA_16     0x16
+#define AD_TYPE_SERVICE_DATA_32     0x20
+#define AD_TYPE_SERVICE_DATA_128    0x21
+#define AD_TYPE_MANUFACTURER_DATA   0xFF
+
+#define ADDR_LEN                    6
+#define APPLE_COMPANY_ID            0x004C
+#define IBEACON_PREFIX              0x1502                              /**< Type and length of the iBeacon data, as a little endian word. */
+#define IBEACON_LEN                 25                                  /**< Company ID, prefix, UUID, major, minor and measured power. */
+#define IBEACON_UUID_OFFSET         4
+
+/**@brief Verdict of the filters on a report. */
+typedef enum
+{
+    VERDICT_REJECT,
+    VERDICT_KEEP,
+    VERDICT_UNDECIDED,                                                  /**< Depends on data of the chain not received yet. */
+} verdict_t;
+
+
+static uint16_t le16(uint8_t const * p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+/**@brief Function for reading an address written most significant byte first. */
+static uint64_t addr_be(uint8_t const * p)
+{
+    uint64_t addr = 0;
+
+    for (uint8_t i = 0; i < ADDR_LEN; i++)
+    {
+        addr = (addr << 8) | p[i];
+    }
+
+    return addr;
+}
+
+
+/**@brief Function for reading an address stored least significant byte first. */
+static uint64_t addr_le(uint8_t const * p)
+{
+    uint64_t addr = 0;
+
+    for (uint8_t i = ADDR_LEN; i > 0; i--)
+    {
+        addr = (addr << 8) | p[i - 1];
+    }
+
+    return addr;
+}
+
+
+static bool chain_expired(scan_filter_t const * p_filter, scan_filter_chain_t const * p_chain, uint64_t now_us)
+{
+    return (p_filter->chain_timeout_us != 0) && (now_us >= p_chain->last_us + p_filter->chain_timeout_us);
+}
+
+
+/**@brief Function for finding the chain of a fragment, forgetting those timed out on the way.
+ *
+ * @return The chain, NULL if the fragment is the first one of its chain.
+ */
+static scan_filter_chain_t * chain_find(scan_filter_t * p_filter, scan_filter_report_t const * p_report)
+{
+    for (uint32_t i = 0; i < SCAN_FILTER_CHAIN_COUNT; i++)
+    {
+        scan_filter_chain_t * p_chain = &p_filter->chains[i];
+
+        if (!p_chain->used)
+        {
+            continue;
+        }
+        if (chain_expired(p_filter, p_chain, p_report->timestamp_us))
+        {
+            p_chain->used = false;
+            continue;
+        }
+        if ((p_chain->set_id == p_report->set_id)
+            && (p_chain->addr_type == p_report->addr_type)
+            && (p_chain->scan_rsp == p_report->scan_rsp)
+            && (memcmp(p_chain->addr, p_report->p_addr, ADDR_LEN) == 0))
+        {
+            return p_chain;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**@brief Function for following a new chain, in place of the one silent for the longest
+ *        time if there is no room left. The fragments still to come of that one are
+ *        then judged as a new chain.
+ */
+static void chain_add(scan_filter_t * p_filter, scan_filter_report_t const * p_report, bool keep)
+{
+    scan_filter_chain_t * p_chain = &p_filter->chains[0];
+
+    for (uint32_t i = 0; i < SCAN_FILTER_CHAIN_COUNT; i++)
+    {
+        if (!p_filter->chains[i].used)
+        {
+            p_chain = &p_filter->chains[i];
+            break;
+        }
+        if (p_filter->chains[i].last_us < p_chain->last_us)
+        {
+            p_chain = &p_filter->chains[i];
+        }
+    }
+
+    memcpy(p_chain->addr, p_report->p_addr, ADDR_LEN);
+    p_chain->addr_type = p_report->addr_type;
+    p_chain->set_id    = p_report->set_id;
+    p_chain->scan_rsp  = p_report->scan_rsp;
+    p_chain->last_us   = p_report->timestamp_us;
+    p_chain->keep      = keep;
+    p_chain->used      = true;
+}
+
+
+static bool rule_needs_ad(uint8_t type)
+{
+    return (type == SCAN_FILTER_COMPANY_ID) || (type == SCAN_FILTER_UUID_PREFIX);
+}
+
+
+/**@brief Function for matching a UUID against a UUID prefix filter.
+ *
+ * @param[in]   p_uuid      UUID as advertised.
+ * @param[in]   size        Size of the UUID: 2, 4 or 16 bytes.
+ * @param[in]   reversed    true if it is advertised least significant byte first.
+ */
+static bool uuid_match(scan_filter_rule_t const * p_rule, uint8_t const * p_uuid, uint8_t size, bool reversed)
+{
+    if (p_rule->len > size)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < p_rule->len; i++)
+    {
+        if (p_rule->value[i] != (reversed ? p_uuid[size - 1 - i] : p_uuid[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**@brief Function for matching the UUIDs of an AD structure against a UUID prefix filter. */
+static bool ad_uuid_match(scan_filter_rule_t const * p_rule, uint8_t ad_type, uint8_t const * p_ad, uint8_t len)
+{
+    uint8_t size;
+
+    switch (ad_type)
+    {
+        case AD_TYPE_UUID16_INCOMPLETE:
+        case AD_TYPE_UUID16_COMPLETE:
+            size = 2;
+            break;
+
+        case AD_TYPE_UUID32_INCOMPLETE:
+        case AD_TYPE_UUID32_COMPLETE:
+            size = 4;
+            break;
+
+        case AD_TYPE_UUID128_INCOMPLETE:
+        case AD_TYPE_UUID128_COMPLETE:
+            size = 16;
+            break;
+
+        case AD_TYPE_SERVICE_DATA_16:
+            return (len >= 2) && uuid_match(p_rule, p_ad, 2, true);
+
+        case AD_TYPE_SERVICE_DATA_32:
+            return (len >= 4) && uuid_match(p_rule, p_ad, 4, true);
+
+        case AD_TYPE_SERVICE_DATA_128:
+            return (len >= 16) && uuid_match(p_rule, p_ad, 16, true);
+
+        case AD_TYPE_MANUFACTURER_DATA:
+            // The proximity UUID of an iBeacon is advertised most significant byte first.
+            return (len == IBEACON_LEN)
+                   && (le16(&p_ad[0]) == APPLE_COMPANY_ID)
+                   && (le16(&p_ad[2]) == IBEACON_PREFIX)
+                   && uuid_match(p_rule, &p_ad[IBEACON_UUID_OFFSET], 16, false);
+
+        default:
+            return false;
+    }
+
+    // A list of service UUIDs.
+    for (uint8_t pos = 0; pos + size <= len; pos += size)
+    {
+        if (uuid_match(p_rule, &p_ad[pos], size, true))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**@brief Function for walking the AD structures of a report for the filters that need them.
+ *
+ * @param[in]   pending     Filters to match, one bit each.
+ *
+ * @return Filters matched among @p pending.
+ */
+static uint32_t ad_match(scan_filter_t const * p_filter, uint8_t const * p_data, uint16_t len, uint32_t pending)
+{
+    uint32_t matched = 0;
+    uint16_t offset  = 0;
+
+    while ((offset + 2 <= len) && (pending != 0))
+    {
+        uint8_t         ad_len  = p_data[offset];
+        uint8_t         ad_type = p_data[offset + 1];
+        uint8_t const * p_ad    = &p_data[offset + 2];
+
+        if ((ad_len == 0) || (ad_len > len - offset - 1))
+        {
+            break;
+        }
+
+        for (uint32_t rules = pending; rules != 0; rules &= rules - 1)
+        {
+            uint8_t                    i      = (uint8_t)__builtin_ctz(rules);
+            scan_filter_rule_t const * p_rule = &p_filter->p_rules[i];
+            bool                       match;
+
+            if (p_rule->type == SCAN_FILTER_COMPANY_ID)
+            {
+                match = (ad_type == AD_TYPE_MANUFACTURER_DATA) && (ad_len >= 3)
+                        && (le16(p_ad) == le16(p_rule->value));
+            }
+            else
+            {
+                match = ad_uuid_match(p_rule, ad_type, p_ad, ad_len - 1);
+            }
+
+            if (match)
+            {
+                matched |= 1u << i;
+                if (p_filter->mode == SCAN_FILTER_MODE_ANY)
+                {
+                    return matched;
+                }
+            }
+        }
+        pending &= ~matched;
+
+        offset += ad_len + 1;
+    }
+
+    return matched;
+}
+
+
+/**@brief Function for judging a report against the filters.
+ *
+ * @param[in]   partial     The data is the first fragment of a chain: a filter it does
+ *                          not match may still match the rest, the verdict is then
+ *                          @ref VERDICT_UNDECIDED unless the other filters decide.
+ */
+static verdict_t report_judge(scan_filter_t const * p_filter, scan_filter_report_t const * p_report, bool partial)
+{
+    uint32_t all     = (p_filter->count == 32) ? UINT32_MAX : ((1u << p_filter->count) - 1);
+    uint32_t matched = 0;
+    uint32_t unknown = 0;                                               /**< Filters the rest of the chain decides. */
+
+    if (p_report->rssi < p_filter->rssi_min)
+    {
+        return VERDICT_REJECT;
+    }
+    if (p_filter->count == 0)
+    {
+        return VERDICT_KEEP;
+    }
+
+    // The filters that do not walk the AD structures first.
+    for (uint32_t rules = all & ~p_filter->ad_rules; rules != 0; rules &= rules - 1)
+    {
+        uint8_t                    i      = (uint8_t)__builtin_ctz(rules);
+        scan_filter_rule_t const * p_rule = &p_filter->p_rules[i];
+        bool                       match  = true;
+
+        switch (p_rule->type)
+        {
+            case SCAN_FILTER_ADDR_PREFIX:
+                for (uint8_t j = 0; (j < p_rule->len) && match; j++)
+                {
+                    match = (p_rule->value[j] == p_report->p_addr[ADDR_LEN - 1 - j]);
+                }
+                break;
+
+            case SCAN_FILTER_ADDR_RANGE:
+            {
+                uint64_t addr = addr_le(p_report->p_addr);
+
+                match = (addr >= addr_be(&p_rule->value[0])) && (addr <= addr_be(&p_rule->value[ADDR_LEN]));
+            } break;
+
+            case SCAN_FILTER_DATA:
+                if (p_rule->offset + p_rule->len > p_report->len)
+                {
+                    // Past the end of a first fragment, the bytes are still to come.
+                    unknown |= partial ? (1u << i) : 0;
+                    match    = false;
+                    break;
+                }
+                for (uint8_t j = 0; (j < p_rule->len) && match; j++)
+                {
+                    match = ((p_report->p_data[p_rule->offset + j] & p_rule->mask[j]) == p_rule->value[j]);
+                }
+                break;
+
+            default:
+                match = false;
+                break;
+        }
+
+        if (unknown & (1u << i))
+        {
+            continue;
+        }
+        if (match)
+        {
+            if (p_filter->mode == SCAN_FILTER_MODE_ANY)
+            {
+                return VERDICT_KEEP;
+            }
+            matched |= 1u << i;
+        }
+        else if (p_filter->mode == SCAN_FILTER_MODE_ALL)
+        {
+            return VERDICT_REJECT;
+        }
+    }
+
+    if (p_filter->ad_rules != 0)
+    {
+        uint32_t ad_matched = ad_match(p_filter, p_report->p_data, p_report->len, p_filter->ad_rules);
+
+        // An AD structure not found in a first fragment may be in the next ones.
+        matched |= ad_matched;
+        unknown |= partial ? (p_filter->ad_rules & ~ad_matched) : 0;
+    }
+
+    if (p_filter->mode == SCAN_FILTER_MODE_ANY)
+    {
+        return (matched != 0) ? VERDICT_KEEP : ((unknown != 0) ? VERDICT_UNDECIDED : VERDICT_REJECT);
+    }
+    if ((matched | unknown) != all)
+    {
+        return VERDICT_REJECT;
+    }
+
+    return (unknown != 0) ? VERDICT_UNDECIDED : VERDICT_KEEP;
+}
+
+
+bool scan_filter_clear(scan_filter_t * p_filter, uint8_t mode)
+{
+    if ((mode != SCAN_FILTER_MODE_ANY) && (mode != SCAN_FILTER_MODE_ALL))
+    {
+        return false;
+    }
+
+    p_filter->count           = 0;
+    p_filter->mode            = mode;
+    p_filter->rssi_min        = INT8_MIN;
+    p_filter->ad_rules        = 0;
+
+    // The chains in progress were judged on the old filters.
+    memset(p_filter->chains, 0, sizeof(p_filter->chains));
+
+    return true;
+}
+
+
+bool scan_filter_rule_is_valid(scan_filter_rule_t const * p_rule)
+{
+    switch (p_rule->type)
+    {
+        case SCAN_FILTER_COMPANY_ID:
+            return p_rule->len == 2;
+
+        case SCAN_FILTER_UUID_PREFIX:
+        case SCAN_FILTER_DATA:
+            return (p_rule->len >= 1) && (p_rule->len <= SCAN_FILTER_VALUE_MAX);
+
+        case SCAN_FILTER_ADDR_PREFIX:
+            return (p_rule->len >= 1) && (p_rule->len <= ADDR_LEN);
+
+        case SCAN_FILTER_ADDR_RANGE:
+            return p_rule->len == 2 * ADDR_LEN;
+
+        case SCAN_FILTER_RSSI_MIN:
+            return p_rule->len == 1;
+
+        default:
+            return false;
+    }
+}
+
+
+bool scan_filter_add(scan_filter_t * p_filter, scan_filter_rule_t const * p_rule)
+{
+    scan_filter_rule_t * p_new;
+
+    if (!scan_filter_rule_is_valid(p_rule))
+    {
+        return false;
+    }
+
+    if (p_rule->type == SCAN_FILTER_RSSI_MIN)
+    {
+        p_filter->rssi_min = (int8_t)p_rule->value[0];
+        return true;
+    }
+
+    if ((p_filter->count >= p_filter->capacity) || (p_filter->count >= SCAN_FILTER_COUNT_MAX))
+    {
+        return false;
+    }
+
+    p_new = &p_filter->p_rules[p_filter->count];
+    memset(p_new, 0, sizeof(*p_new));
+    p_new->type   = p_rule->type;
+    p_new->len    = p_rule->len;
+    p_new->offset = p_rule->offset;
+    memcpy(p_new->value, p_rule->value, p_rule->len);
+    if (p_rule->type == SCAN_FILTER_DATA)
+    {
+        // Masked once here, so a report byte only needs to be masked.
+        for (uint8_t i = 0; i < p_rule->len; i++)
+        {
+            p_new->mask[i]   = p_rule->mask[i];
+            p_new->value[i] &= p_rule->mask[i];
+        }
+    }
+
+    if (rule_needs_ad(p_rule->type))
+    {
+        p_filter->ad_rules |= 1u << p_filter->count;
+    }
+    p_filter->count++;
+
+    return true;
+}
+
+
+bool scan_filter_check(scan_filter_t * p_filter, scan_filter_report_t const * p_report)
+{
+    bool                  fragment = p_report->extended && (p_report->status == SCAN_REPORT_STATUS_MORE_DATA);
+    scan_filter_chain_t * p_chain  = p_report->extended ? chain_find(p_filter, p_report) : NULL;
+    bool                  keep;
+
+    if (p_chain != NULL)
+    {
+        // A fragment following the first one of its chain.
+        keep             = p_chain->keep;
+        p_chain->last_us = p_report->timestamp_us;
+        if (!fragment)
+        {
+            p_chain->used = false;
+        }
+    }
+    else
+    {
+        verdict_t verdict = report_judge(p_filter, p_report, fragment);
+
+        // Undecided, the chain is kept until it is judged whole.
+        keep = (verdict != VERDICT_REJECT);
+        if (verdict == VERDICT_UNDECIDED)
+        {
+            p_filter->undecided++;
+        }
+        if (fragment)
+        {
+            chain_add(p_filter, p_report, keep);
+        }
+    }
+
+    if (!keep)
+    {
+        p_filter->rejected++;
+    }
+
+    return keep;
+}
+
+
+bool scan_filter_match(scan_filter_t const * p_filter, scan_filter_report_t const * p_report)
+{
+    return report_judge(p_filter, p_report, false) == VERDICT_KEEP;
+}
+
+
+void scan_filter_chains_reset(scan_filter_t * p_filter, uint64_t timeout_us)
+{
+    memset(p_filter->chains, 0, sizeof(p_filter->chains));
+    p_filter->chain_timeout_us = timeout_us;
+}
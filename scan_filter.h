@@ -0,0 +1,164 @@
+/***************************************************************************************/
+/*
+ * scan_filter
+ *
+ *  Early rejection of advertising reports.
+ *
+ *  The filters are checked on the report as the SoftDevice gives it, before it takes
+ *  a place in the report queue. The RSSI floor is checked first, then the address and
+ *  data byte filters, and the advertising data is only walked, once, if a company ID
+ *  or UUID filter is still undecided.
+ *
+ *  The fragments of an extended advertising chain are kept or rejected together: the
+ *  first fragment is judged on the data it holds, and the next ones share its verdict.
+ *  When that data does not decide (a data filter past its end, a company ID or UUID
+ *  not found in it, which may be in a later fragment) the chain is kept, and the
+ *  reassembled report must be judged again with scan_filter_match. The chains in
+ *  progress are told apart by address, address type, advertising SID and scan
+ *  response, and forgotten after their last fragment, after the reassembly timeout,
+ *  or when scanning restarts.
+ *
+ *  The module has no SDK dependencies so the host tools can build it too. It is not
+ *  reentrant: changing the filters from the main loop while reports are checked from
+ *  the BLE event handler needs a critical region.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_FILTER_H__
+#define SCAN_FILTER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_FILTER_COUNT_MAX   32                                      /**< Most filters of an instance, RSSI floor excluded. */
+#define SCAN_FILTER_CHAIN_COUNT 8                                       /**< Chains in progress followed at a time. */
+
+/**@brief Macro for defining a set of report filters.
+ *
+ * @param   _name       Name of the instance.
+ * @param   _count      Filters it holds, RSSI floor excluded. At most @ref SCAN_FILTER_COUNT_MAX.
+ */
+#define SCAN_FILTER_DEF(_name, _count)                                              \
+    static scan_filter_rule_t _name##_rules[_count];                                \
+    static scan_filter_t _name =                                                    \
+    {                                                                               \
+        .p_rules  = _name##_rules,                                                  \
+        .capacity = (_count),                                                       \
+        .rssi_min = INT8_MIN,                                                       \
+    }
+
+/**@brief A report, as the filters see it. */
+typedef struct
+{
+    uint64_t        timestamp_us;                                       /**< Reception time, for the chains in progress. */
+    uint8_t const * p_addr;                                             /**< Peer address, least significant byte first. */
+    uint8_t         addr_type;                                          /**< BLE_GAP_ADDR_TYPE_*. */
+    uint8_t const * p_data;                                             /**< Advertising data. */
+    uint16_t        len;                                                /**< Length of the advertising data. */
+    int8_t          rssi;                                               /**< Received signal strength in dBm. */
+    uint8_t         set_id;                                             /**< Advertising SID, or @ref SCAN_REPORT_SET_ID_INVALID. */
+    bool            extended;                                           /**< Extended advertising PDU. */
+    bool            scan_rsp;                                           /**< Scan response, chained apart from the advertisement. */
+    uint8_t         status;                                             /**< SCAN_REPORT_STATUS_*. */
+} scan_filter_report_t;
+
+/**@brief Verdict of a chain in progress, shared by its fragments. */
+typedef struct
+{
+    uint64_t last_us;                                                   /**< Time of the last fragment. */
+    uint8_t  addr[6];
+    uint8_t  addr_type;
+    uint8_t  set_id;
+    bool     scan_rsp;
+    bool     used;
+    bool     keep;
+} scan_filter_chain_t;
+
+/**@brief A set of report filters. */
+typedef struct
+{
+    scan_filter_rule_t * p_rules;
+    uint8_t              capacity;
+    uint8_t              count;                                         /**< Filters in use. */
+    uint8_t              mode;                                          /**< @ref scan_filter_mode_t. */
+    int8_t               rssi_min;                                      /**< RSSI floor, INT8_MIN if none. */
+    uint32_t             ad_rules;                                      /**< Filters that need the AD structures, one bit each. */
+    scan_filter_chain_t  chains[SCAN_FILTER_CHAIN_COUNT];               /**< Chains in progress. */
+    uint64_t             chain_timeout_us;                              /**< Time without fragments after which a chain is forgotten, 0 for never. */
+    uint32_t             rejected;                                      /**< Reports rejected since boot. */
+    uint32_t             undecided;                                     /**< Chains kept undecided on their first fragment. */
+} scan_filter_t;
+
+
+/**@brief Function for removing every filter, RSSI floor included.
+ *
+ * @param[in]   p_filter    Instance.
+ * @param[in]   mode        @ref scan_filter_mode_t of the filters added next.
+ *
+ * @return false if the mode is unknown, the filters are then left as they are.
+ */
+bool scan_filter_clear(scan_filter_t * p_filter, uint8_t mode);
+
+
+/**@brief Function for checking a filter before adding it.
+ *
+ * @return true if its type is known and its length suits the type.
+ */
+bool scan_filter_rule_is_valid(scan_filter_rule_t const * p_rule);
+
+
+/**@brief Function for adding a filter.
+ *
+ * @details A @ref SCAN_FILTER_RSSI_MIN filter replaces the RSSI floor and takes no room.
+ *
+ * @return false if the filter is not valid or there is no room left.
+ */
+bool scan_filter_add(scan_filter_t * p_filter, scan_filter_rule_t const * p_rule);
+
+
+/**@brief Function for checking a report against the filters.
+ *
+ * @details A fragment takes the verdict of its chain. The first fragment of a chain
+ *          is judged on the data it holds, and kept if that does not decide.
+ *
+ * @param[in]   p_filter    Instance.
+ * @param[in]   p_report    Report received.
+ *
+ * @return true if the report is kept, false if it is rejected.
+ */
+bool scan_filter_check(scan_filter_t * p_filter, scan_filter_report_t const * p_report);
+
+
+/**@brief Function for judging a reassembled chain on its whole data.
+ *
+ * @details The chain fields of the report are not used and nothing is counted, so it
+ *          can be called from another context than @ref scan_filter_check, as long as
+ *          the filters are not changed meanwhile. A chain whose first fragment decided
+ *          is given the same verdict again.
+ *
+ * @return true if the report is kept.
+ */
+bool scan_filter_match(scan_filter_t const * p_filter, scan_filter_report_t const * p_report);
+
+
+/**@brief Function for forgetting the chains in progress.
+ *
+ * @details To be called when scanning starts or restarts: the SoftDevice does not go
+ *          on with the chains of the previous scan.
+ *
+ * @param[in]   p_filter    Instance.
+ * @param[in]   timeout_us  Time without fragments after which a chain is forgotten,
+ *                          the reassembly timeout. 0 for never.
+ */
+void scan_filter_chains_reset(scan_filter_t * p_filter, uint64_t timeout_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_FILTER_H__
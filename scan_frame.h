@@ -0,0 +1,412 @@
+/***************************************************************************************/
+/*
+ * scan_frame
+ *
+ *  Binary framing of the scanner output stream. Every record sent through the
+ *  serial port is wrapped in a frame:
+ *
+ *      | SOF (0xA5) | type | length (LE16) | payload ... | CRC16 (LE16) |
+ *
+ *  The CRC is CRC-16/CCITT (poly 0x1021, init 0xFFFF) computed over type, length
+ *  and payload, so a receiver that loses sync can scan for the next SOF byte and
+ *  validate the candidate frame.
+ *
+ *  The wire format definitions in this header are shared with the host tools.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_FRAME_H__
+#define SCAN_FRAME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_FRAME_SOF              0xA5                                /**< Start of frame marker. */
+#define SCAN_FRAME_HEADER_LEN       4                                   /**< SOF, type and length fields. */
+#define SCAN_FRAME_CRC_LEN          2                                   /**< Length of the trailing CRC. */
+#define SCAN_FRAME_OVERHEAD         (SCAN_FRAME_HEADER_LEN + SCAN_FRAME_CRC_LEN)
+#define SCAN_FRAME_MAX_PAYLOAD      1792                                /**< Largest payload accepted by the decoders, room for a reassembled chain. */
+
+/**@brief Record types carried in the type field of a frame. */
+typedef enum
+{
+    SCAN_FRAME_TYPE_ADV_REPORT = 0x01,                                  /**< One advertising report: @ref scan_report_hdr_t followed by the advertising data. */
+    SCAN_FRAME_TYPE_HELLO      = 0x02,                                  /**< Link parameters, @ref scan_hello_t. Sent at boot, after a baud rate change and in reply to @ref SCAN_CMD_HELLO. */
+    SCAN_FRAME_TYPE_CMD_RSP    = 0x03,                                  /**< Response to a command: @ref scan_cmd_rsp_t, followed by command specific data. */
+    SCAN_FRAME_TYPE_ALIVE      = 0x04,                                  /**< Summary of an advertiser whose duplicate reports were dropped, @ref scan_alive_t. */
+    SCAN_FRAME_TYPE_RSSI_SUMMARY = 0x05,                                /**< RSSI of one device over one aggregation window, @ref scan_rssi_summary_t. */
+    SCAN_FRAME_TYPE_STATS      = 0x06,                                  /**< Periodic runtime statistics, @ref scan_stats_t. */
+    SCAN_FRAME_TYPE_PROFILE    = 0x07,                                  /**< CPU cycles spent on the reports, @ref scan_profile_t. Sent after each statistics record with SCANNER_PROFILE_ENABLED. */
+    SCAN_FRAME_TYPE_BEACON     = 0x08,                                  /**< A decoded beacon, in place of its advertising report: @ref scan_beacon_hdr_t followed by the body of its type. */
+} scan_frame_type_t;
+
+/**@brief Commands sent by the host, carried in the type field of a frame. */
+typedef enum
+{
+    SCAN_CMD_HELLO             = 0x80,                                  /**< No payload. Asks for a @ref SCAN_FRAME_TYPE_HELLO and confirms a baud rate change. */
+    SCAN_CMD_UART_CONFIG       = 0x81,                                  /**< Change the link configuration, @ref scan_cmd_uart_config_t. */
+    SCAN_CMD_FILTER_CLEAR      = 0x82,                                  /**< Remove every report filter, @ref scan_cmd_filter_clear_t. */
+    SCAN_CMD_FILTER_ADD        = 0x83,                                  /**< Add a report filter, @ref scan_filter_rule_t. */
+    SCAN_CMD_SCAN_START        = 0x84,                                  /**< No payload. Start scanning, with the current parameters. */
+    SCAN_CMD_SCAN_STOP         = 0x85,                                  /**< No payload. Stop scanning, the reports already queued are still sent. */
+    SCAN_CMD_SCAN_PARAMS       = 0x86,                                  /**< Change the scan interval, window and type, @ref scan_cmd_scan_params_t. */
+    SCAN_CMD_SCAN_PHYS         = 0x87,                                  /**< Change the primary PHYs scanned, @ref scan_cmd_scan_phys_t. */
+    SCAN_CMD_OUTPUT_MODE       = 0x88,                                  /**< Change the records sent, @ref scan_cmd_output_mode_t. */
+    SCAN_CMD_STATS_GET         = 0x89,                                  /**< No payload. Send a @ref SCAN_FRAME_TYPE_STATS record now. */
+} scan_cmd_type_t;
+
+/**@brief Status codes of @ref scan_cmd_rsp_t. */
+typedef enum
+{
+    SCAN_CMD_STATUS_OK          = 0x00,
+    SCAN_CMD_STATUS_INVALID     = 0x01,                                 /**< Malformed command or out of range parameter. */
+    SCAN_CMD_STATUS_UNSUPPORTED = 0x02,                                 /**< Unknown command. */
+    SCAN_CMD_STATUS_BUSY        = 0x03,                                 /**< The command cannot be applied now, or was not for lack of output room. Send it again. */
+    SCAN_CMD_STATUS_FULL        = 0x04,                                 /**< No room left for what the command adds. */
+} scan_cmd_status_t;
+
+#define SCAN_PROTOCOL_VERSION               2                           /**< Version reported in @ref scan_hello_t. */
+
+#define SCAN_LINK_FLAG_HWFC                 (1 << 0)                    /**< RTS/CTS flow control, in @ref scan_hello_t and @ref scan_cmd_uart_config_t. */
+
+/**@defgroup SCAN_OUTPUT_FLAGS Bits of @ref scan_cmd_output_mode_t::flags
+ * @{ */
+#define SCAN_OUTPUT_FLAG_DEDUP              (1 << 0)                    /**< Duplicate reports are replaced by ALIVE summaries. Needs SCANNER_DEDUP_ENABLED. */
+#define SCAN_OUTPUT_FLAG_BEACON             (1 << 1)                    /**< Beacons are sent as BEACON records. Needs SCANNER_BEACON_ENABLED. */
+#define SCAN_OUTPUT_FLAG_RSSI_AGG           (1 << 2)                    /**< Reports are replaced by RSSI summaries. Needs SCANNER_RSSI_AGG_ENABLED. */
+/** @} */
+
+/**@defgroup SCAN_REPORT_FLAGS Bits of @ref scan_report_hdr_t::flags
+ * @{ */
+#define SCAN_REPORT_FLAG_CONNECTABLE        (1 << 0)
+#define SCAN_REPORT_FLAG_SCANNABLE          (1 << 1)
+#define SCAN_REPORT_FLAG_DIRECTED           (1 << 2)
+#define SCAN_REPORT_FLAG_SCAN_RESPONSE      (1 << 3)
+#define SCAN_REPORT_FLAG_EXTENDED_PDU       (1 << 4)
+#define SCAN_REPORT_FLAG_STATUS_Pos         5                           /**< Data status, BLE_GAP_ADV_DATA_STATUS_*. */
+#define SCAN_REPORT_FLAG_STATUS_Msk         (3 << SCAN_REPORT_FLAG_STATUS_Pos)
+#define SCAN_REPORT_FLAG_TRUNCATED          (1 << 7)                    /**< Part of the advertising data is missing: the chain was cut, lost a fragment or did not fit. */
+/** @} */
+
+#define SCAN_REPORT_STATUS_COMPLETE         0                           /**< BLE_GAP_ADV_DATA_STATUS_COMPLETE. */
+#define SCAN_REPORT_STATUS_MORE_DATA        1                           /**< BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_MORE_DATA: a fragment of a chain. */
+#define SCAN_REPORT_STATUS_TRUNCATED        2                           /**< BLE_GAP_ADV_DATA_STATUS_INCOMPLETE_TRUNCATED. */
+
+#define SCAN_REPORT_CHAIN_DATA_MAX          1650                        /**< Longest advertising data of an extended advertising chain. */
+
+#define SCAN_RSSI_SUMMARY_FLAG_EVICTED      (1 << 0)                    /**< The window was closed early to make room for another device. */
+
+/**@brief Beacon formats, in @ref scan_beacon_hdr_t::type. */
+typedef enum
+{
+    SCAN_BEACON_NONE            = 0x00,                                 /**< Not a beacon the scanner decodes. */
+    SCAN_BEACON_IBEACON         = 0x01,                                 /**< @ref scan_ibeacon_t. */
+    SCAN_BEACON_ALTBEACON       = 0x02,                                 /**< @ref scan_altbeacon_t. */
+    SCAN_BEACON_EDDYSTONE_UID   = 0x03,                                 /**< @ref scan_eddystone_uid_t. */
+    SCAN_BEACON_EDDYSTONE_URL   = 0x04,                                 /**< @ref scan_eddystone_url_t. */
+    SCAN_BEACON_EDDYSTONE_TLM   = 0x05,                                 /**< @ref scan_eddystone_tlm_t, unencrypted telemetry only. */
+    SCAN_BEACON_EDDYSTONE_EID   = 0x06,                                 /**< @ref scan_eddystone_eid_t. */
+} scan_beacon_type_t;
+
+#define SCAN_EDDYSTONE_URL_MAX              17                          /**< Longest encoded URL of an Eddystone-URL frame. */
+#define SCAN_EDDYSTONE_TEMP_INVALID         (-32768)                    /**< Temperature not supported by the beacon. */
+
+/**@brief Report filter types, in @ref scan_filter_rule_t::type. */
+typedef enum
+{
+    SCAN_FILTER_COMPANY_ID      = 0x01,                                 /**< Manufacturer specific data of a company. value: company ID (LE16). */
+    SCAN_FILTER_UUID_PREFIX     = 0x02,                                 /**< A service UUID, service data UUID or iBeacon UUID starting with value, most significant byte first. */
+    SCAN_FILTER_ADDR_PREFIX     = 0x03,                                 /**< Peer address starting with value, most significant byte first. */
+    SCAN_FILTER_ADDR_RANGE      = 0x04,                                 /**< Peer address between value[0..5] and value[6..11] included, most significant byte first. */
+    SCAN_FILTER_RSSI_MIN        = 0x05,                                 /**< RSSI of at least value[0] dBm. Applies on top of the other filters, whatever the mode. */
+    SCAN_FILTER_DATA            = 0x06,                                 /**< Advertising data bytes from offset, ANDed with mask, equal to value. */
+} scan_filter_type_t;
+
+/**@brief How the report filters other than @ref SCAN_FILTER_RSSI_MIN combine. */
+typedef enum
+{
+    SCAN_FILTER_MODE_ANY        = 0x00,                                 /**< A report is kept if it matches one filter at least. */
+    SCAN_FILTER_MODE_ALL        = 0x01,                                 /**< A report is kept if it matches every filter. */
+} scan_filter_mode_t;
+
+#define SCAN_FILTER_VALUE_MAX               16                          /**< Longest value of a report filter. */
+
+#define SCAN_REPORT_TX_POWER_INVALID        127                         /**< TX power not present in the report. */
+#define SCAN_REPORT_SET_ID_INVALID          0xFF                        /**< Advertising SID not present in the report. */
+
+#pragma pack(push, 1)
+
+/**@brief Metadata sent in front of the advertising data of every report.
+ *
+ * @details Multi-byte fields are little endian. Field values use the encoding of
+ *          the SoftDevice API (ble_gap_evt_adv_report_t).
+ */
+typedef struct
+{
+    uint64_t timestamp_us;                                              /**< Reception time, microseconds since boot. */
+    uint8_t  addr[6];                                                   /**< Peer address, least significant byte first. */
+    uint8_t  addr_type;                                                 /**< BLE_GAP_ADDR_TYPE_*. */
+    uint8_t  flags;                                                     /**< See @ref SCAN_REPORT_FLAGS. */
+    int8_t   rssi;                                                      /**< Received signal strength in dBm. */
+    int8_t   tx_power;                                                  /**< Advertised TX power in dBm, or @ref SCAN_REPORT_TX_POWER_INVALID. */
+    uint8_t  primary_phy;                                               /**< BLE_GAP_PHY_* of the primary channel. */
+    uint8_t  secondary_phy;                                             /**< BLE_GAP_PHY_* of the secondary channel, 0 if not used. */
+    uint8_t  ch_index;                                                  /**< Channel index the report was received on. */
+    uint8_t  set_id;                                                    /**< Advertising SID, or @ref SCAN_REPORT_SET_ID_INVALID. */
+    uint16_t data_id;                                                   /**< Advertising data ID (12 bits). */
+    uint16_t data_len;                                                  /**< Length of the advertising data following this header. */
+} scan_report_hdr_t;
+
+/**@brief Payload of @ref SCAN_FRAME_TYPE_ALIVE.
+ *
+ * @details Sent periodically for an advertiser that keeps sending the same advertising
+ *          data, in place of the reports dropped since its last report or summary.
+ */
+typedef struct
+{
+    uint64_t timestamp_us;                                              /**< Time of the last report received. */
+    uint8_t  addr[6];                                                   /**< Peer address, least significant byte first. */
+    uint8_t  addr_type;                                                 /**< BLE_GAP_ADDR_TYPE_*. */
+    uint8_t  set_id;                                                    /**< Advertising SID, or @ref SCAN_REPORT_SET_ID_INVALID. */
+    uint8_t  flags;                                                     /**< @ref SCAN_REPORT_FLAG_SCAN_RESPONSE if it summarizes scan responses. */
+    int8_t   rssi;                                                      /**< RSSI of the last report received, in dBm. */
+    uint16_t count;                                                     /**< Reports dropped. */
+} scan_alive_t;
+
+/**@brief Payload of @ref SCAN_FRAME_TYPE_RSSI_SUMMARY.
+ *
+ * @details Windows are aligned on multiples of their length in the time base of the
+ *          report timestamps. A device that is not heard during a window gets no
+ *          summary for it.
+ */
+typedef struct
+{
+    uint64_t window_us;                                                 /**< Start of the window. */
+    uint8_t  addr[6];                                                   /**< Peer address, least significant byte first. */
+    uint8_t  addr_type;                                                 /**< BLE_GAP_ADDR_TYPE_*. */
+    uint8_t  flags;                                                     /**< SCAN_RSSI_SUMMARY_FLAG_*. */
+    int8_t   rssi_min;                                                  /**< Lowest RSSI, in dBm. */
+    int8_t   rssi_max;                                                  /**< Highest RSSI, in dBm. */
+    int8_t   rssi_mean;                                                 /**< Mean RSSI rounded to the nearest dBm. */
+    uint8_t  reserved;
+    uint16_t count;                                                     /**< Reports received during the window. */
+} scan_rssi_summary_t;
+
+/**@brief Payload of @ref SCAN_FRAME_TYPE_STATS.
+ *
+ * @details Counters run since boot and wrap around; rates are obtained from the
+ *          difference between two records.
+ */
+typedef struct
+{
+    uint64_t timestamp_us;                                              /**< Time the record was made. */
+    uint32_t reports_received;                                          /**< Advertising reports received from the SoftDevice. */
+    uint32_t reports_sent;                                              /**< Advertising reports queued for output. */
+    uint32_t summaries_sent;                                            /**< ALIVE and RSSI_SUMMARY records queued for output. */
+    uint32_t drop_queue_full;                                           /**< Reports dropped because the report queue was full. */
+    uint32_t drop_duplicate;                                            /**< Reports dropped as duplicates. */
+    uint32_t drop_output;                                               /**< Reports the output refused (too long to be framed). */
+    uint32_t tx_bytes;                                                  /**< Bytes sent through the UART. */
+    uint32_t tx_busy;                                                   /**< Records held back because the UART could not keep up. */
+    uint16_t queue_high_water;                                          /**< Most reports queued at once. */
+    uint16_t queue_size;                                                /**< Capacity of the report queue. */
+    uint16_t output_high_water;                                         /**< Most bytes waiting in an output buffer. */
+    uint16_t output_size;                                               /**< Size of an output buffer. */
+    uint16_t scan_window;                                               /**< Current scan window, in units of 0.625 ms. */
+    uint16_t cpu_load;                                                  /**< Time the CPU was awake since the previous record, in 1/10000. */
+    uint32_t drop_filtered;                                             /**< Reports rejected by the report filters. Missing before protocol version 2. */
+} scan_stats_t;
+
+/**@brief Payload of @ref SCAN_FRAME_TYPE_PROFILE.
+ *
+ * @details Cycles of the CPU cycle counter. Counters run since boot; the cycles per
+ *          report over a period are obtained from the difference between two records.
+ */
+typedef struct
+{
+    uint64_t timestamp_us;                                              /**< Time the record was made. */
+    uint32_t cpu_hz;                                                    /**< Frequency of the cycle counter. */
+    uint32_t adv_reports;                                               /**< Advertising reports handled by the BLE observer. */
+    uint64_t adv_report_cycles;                                         /**< Cycles the BLE observer spent on them, from the event to the resumed scan. */
+    uint32_t adv_report_cycles_max;                                     /**< Longest handling of a report since the previous record. */
+    uint32_t reserved;
+    uint64_t loop_cycles;                                               /**< Cycles the main loop was awake: commands, formatting, framing and logs, interrupts included. */
+} scan_profile_t;
+
+/**@brief Header of @ref SCAN_FRAME_TYPE_BEACON.
+ *
+ * @details Identifiers are kept in the byte order they are advertised in, which is
+ *          the order they are written in. Numbers are converted to little endian.
+ */
+typedef struct
+{
+    uint64_t timestamp_us;                                              /**< Reception time, microseconds since boot. */
+    uint8_t  addr[6];                                                   /**< Peer address, least significant byte first. */
+    uint8_t  addr_type;                                                 /**< BLE_GAP_ADDR_TYPE_*. */
+    int8_t   rssi;                                                      /**< Received signal strength in dBm. */
+    uint8_t  type;                                                      /**< @ref scan_beacon_type_t, tells the body that follows. */
+} scan_beacon_hdr_t;
+
+/**@brief Body of an iBeacon. */
+typedef struct
+{
+    uint8_t  uuid[16];                                                  /**< Proximity UUID. */
+    uint16_t major;
+    uint16_t minor;
+    int8_t   measured_power;                                            /**< RSSI at 1 m, in dBm. */
+} scan_ibeacon_t;
+
+/**@brief Body of an AltBeacon. */
+typedef struct
+{
+    uint16_t company_id;                                                /**< Manufacturer of the beacon. */
+    uint8_t  beacon_id[20];                                             /**< Beacon identifier, by convention a 16-byte UUID and two 2-byte values. */
+    int8_t   ref_rssi;                                                  /**< RSSI at 1 m, in dBm. */
+    uint8_t  mfg_reserved;                                              /**< Manufacturer specific byte. */
+} scan_altbeacon_t;
+
+/**@brief Body of an Eddystone-UID frame. */
+typedef struct
+{
+    int8_t   tx_power;                                                  /**< RSSI at 0 m, in dBm. */
+    uint8_t  namespace_id[10];
+    uint8_t  instance_id[6];
+} scan_eddystone_uid_t;
+
+/**@brief Body of an Eddystone-URL frame. The URL is kept encoded, see scan_beacon_url_expand. */
+typedef struct
+{
+    int8_t   tx_power;                                                  /**< RSSI at 0 m, in dBm. */
+    uint8_t  scheme;                                                    /**< URL scheme prefix code. */
+    uint8_t  url_len;                                                   /**< Bytes of url used. */
+    uint8_t  url[SCAN_EDDYSTONE_URL_MAX];                               /**< Encoded URL, the rest is zero. */
+} scan_eddystone_url_t;
+
+/**@brief Body of an unencrypted Eddystone-TLM frame. */
+typedef struct
+{
+    uint16_t battery_mv;                                                /**< Battery voltage in mV, 0 if not supported. */
+    int16_t  temperature;                                               /**< Temperature in 1/256 degrees Celsius, or @ref SCAN_EDDYSTONE_TEMP_INVALID. */
+    uint32_t adv_count;                                                 /**< Frames advertised since power-up. */
+    uint32_t uptime_ds;                                                 /**< Time since power-up, in 0.1 s. */
+} scan_eddystone_tlm_t;
+
+/**@brief Body of an Eddystone-EID frame. */
+typedef struct
+{
+    int8_t   tx_power;                                                  /**< RSSI at 0 m, in dBm. */
+    uint8_t  eid[8];                                                    /**< Ephemeral identifier. */
+} scan_eddystone_eid_t;
+
+/**@brief Body of @ref SCAN_FRAME_TYPE_BEACON, according to @ref scan_beacon_hdr_t::type.
+ *
+ * @details Only the member of the type is sent, the frame is no longer than needed.
+ */
+typedef union
+{
+    scan_ibeacon_t       ibeacon;
+    scan_altbeacon_t     altbeacon;
+    scan_eddystone_uid_t eddystone_uid;
+    scan_eddystone_url_t eddystone_url;
+    scan_eddystone_tlm_t eddystone_tlm;
+    scan_eddystone_eid_t eddystone_eid;
+} scan_beacon_body_t;
+
+/**@brief Payload of @ref SCAN_FRAME_TYPE_HELLO. */
+typedef struct
+{
+    uint8_t  version;                                                   /**< @ref SCAN_PROTOCOL_VERSION. */
+    uint8_t  flags;                                                     /**< @ref SCAN_LINK_FLAG_HWFC. */
+    uint32_t baudrate;                                                  /**< Current baud rate. */
+} scan_hello_t;
+
+/**@brief Payload of @ref SCAN_CMD_UART_CONFIG.
+ *
+ * @details The scanner answers at the current baud rate, then switches and sends a
+ *          @ref SCAN_FRAME_TYPE_HELLO at the new one. The host must answer with
+ *          @ref SCAN_CMD_HELLO within SCANNER_BAUD_CONFIRM_MS, otherwise the scanner
+ *          goes back to the previous configuration.
+ */
+typedef struct
+{
+    uint32_t baudrate;                                                  /**< 115200, 230400, 460800, 921600 or 1000000. */
+    uint8_t  flags;                                                     /**< @ref SCAN_LINK_FLAG_HWFC. */
+} scan_cmd_uart_config_t;
+
+/**@brief Payload of @ref SCAN_CMD_FILTER_CLEAR.
+ *
+ * @details With no filter, every report is kept.
+ */
+typedef struct
+{
+    uint8_t  mode;                                                      /**< @ref scan_filter_mode_t of the filters added next. */
+} scan_cmd_filter_clear_t;
+
+/**@brief Payload of @ref SCAN_CMD_SCAN_PARAMS.
+ *
+ * @details Applied by restarting scanning, which also restarts the current step of
+ *          the PHY schedule. With SCANNER_ADAPT_ENABLED, the window is the widest the
+ *          controller opens.
+ */
+typedef struct
+{
+    uint16_t interval;                                                  /**< Scan interval in 0.625 ms units, 8 to 65535: room for the shortest window on each PHY when both are scanned at once. */
+    uint16_t window;                                                    /**< Scan window in 0.625 ms units, 4 to interval. */
+    uint8_t  active;                                                    /**< 1 to ask for scan responses, 0 otherwise. */
+} scan_cmd_scan_params_t;
+
+/**@brief Payload of @ref SCAN_CMD_SCAN_PHYS.
+ *
+ * @details With both PHYs and both dwell times set, the PHYs are scanned in turns.
+ *          Otherwise they are scanned together, each one for half of the interval.
+ */
+typedef struct
+{
+    uint8_t  phys;                                                      /**< BLE_GAP_PHY_1MBPS and/or BLE_GAP_PHY_CODED. */
+    uint16_t dwell_1m_ms;                                               /**< Time on the 1M PHY per turn, at least 10 ms. */
+    uint16_t dwell_coded_ms;                                            /**< Time on the Coded PHY per turn, at least 10 ms. */
+} scan_cmd_scan_phys_t;
+
+/**@brief Payload of @ref SCAN_CMD_OUTPUT_MODE.
+ *
+ * @details A flag whose feature is not built in makes the command invalid.
+ */
+typedef struct
+{
+    uint8_t  flags;                                                     /**< @ref SCAN_OUTPUT_FLAGS. */
+} scan_cmd_output_mode_t;
+
+/**@brief A report filter, payload of @ref SCAN_CMD_FILTER_ADD.
+ *
+ * @details Filters are applied to every advertising report as the SoftDevice gives
+ *          it, before it is queued. The fragments of an extended advertising chain
+ *          share the verdict of the first one, judged on the data it holds. A chain
+ *          that data does not decide is kept, and judged again once reassembled.
+ */
+typedef struct
+{
+    uint8_t  type;                                                      /**< @ref scan_filter_type_t. */
+    uint8_t  len;                                                       /**< Bytes of value (and mask) used. */
+    uint8_t  offset;                                                    /**< @ref SCAN_FILTER_DATA: first advertising data byte compared. */
+    uint8_t  reserved;
+    uint8_t  value[SCAN_FILTER_VALUE_MAX];
+    uint8_t  mask[SCAN_FILTER_VALUE_MAX];                               /**< @ref SCAN_FILTER_DATA: bits compared. */
+} scan_filter_rule_t;
+
+/**@brief Header of @ref SCAN_FRAME_TYPE_CMD_RSP. */
+typedef struct
+{
+    uint8_t  cmd;                                                       /**< Command being answered, @ref scan_cmd_type_t. */
+    uint8_t  status;                                                    /**< @ref scan_cmd_status_t. */
+} scan_cmd_rsp_t;
+
+#pragma pack(pop)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_FRAME_H__
@@ -0,0 +1,434 @@
+/***************************************************************************************/
+/*
+ * scan_output
+ *
+ *  Serial link of the scanner over UARTE with EasyDMA.
+ *
+ *  Transmit: two buffers are used in turns. Frames are encoded into the fill buffer
+ *  while EasyDMA sends the other one, so the CPU never touches the UART per byte.
+ *  Only the main loop swaps the buffers and starts transfers; the UARTE interrupt
+ *  just marks the transfer as finished, which also wakes the main loop up.
+ *
+ *  Receive: commands from the host are short and rare. EasyDMA receives them one byte
+ *  at a time into two alternating bytes, the interrupt pushes each byte into a small
+ *  ring and the main loop reassembles the frames.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "sdk_common.h"
+#include "scan_output.h"
+#include "scan_frame.h"
+#include "nrfx_uarte.h"
+#include "app_error.h"
+#include "crc16.h"
+#include "boards.h"
+
+#define RX_RING_SIZE        64                                              /**< Bytes buffered between the UARTE interrupt and the main loop. */
+#define RX_RING_MASK        (RX_RING_SIZE - 1)
+
+STATIC_ASSERT(SCANNER_OUTPUT_BUFFER_SIZE >= SCAN_FRAME_MAX_PAYLOAD + SCAN_FRAME_OVERHEAD);
+STATIC_ASSERT(SCANNER_OUTPUT_BUFFER_SIZE <= UINT16_MAX);
+STATIC_ASSERT(IS_POWER_OF_TWO(RX_RING_SIZE));
+
+#if NRF_LOG_BACKEND_UART_ENABLED && (SCANNER_OUTPUT_FORMAT == SCANNER_OUTPUT_FORMAT_BINARY)
+#error "The binary scanner output owns the UART. Use the RTT backend of nrf_log instead."
+#endif
+
+/**@brief States of the receive frame parser. */
+typedef enum
+{
+    RX_STATE_SOF,
+    RX_STATE_TYPE,
+    RX_STATE_LEN_LO,
+    RX_STATE_LEN_HI,
+    RX_STATE_PAYLOAD,
+    RX_STATE_CRC_LO,
+    RX_STATE_CRC_HI,
+} rx_state_t;
+
+/**@brief Supported baud rates and their register values. */
+static const struct
+{
+    uint32_t             bps;
+    nrf_uarte_baudrate_t reg;
+} m_baudrates[] =
+{
+    {  115200, NRF_UARTE_BAUDRATE_115200  },
+    {  230400, NRF_UARTE_BAUDRATE_230400  },
+    {  460800, NRF_UARTE_BAUDRATE_460800  },
+    {  921600, NRF_UARTE_BAUDRATE_921600  },
+    { 1000000, NRF_UARTE_BAUDRATE_1000000 },
+};
+
+static nrfx_uarte_t     m_uarte = NRFX_UARTE_INSTANCE(0);                   /**< UARTE used for the scanner link. */
+
+static uint8_t          m_buf[2][SCANNER_OUTPUT_BUFFER_SIZE];               /**< Ping-pong buffers, in RAM for EasyDMA. */
+static uint8_t          m_fill_idx;                                         /**< Buffer being filled by the CPU. */
+static uint16_t         m_fill_len;                                         /**< Bytes written into the fill buffer. */
+static volatile bool    m_tx_busy;                                          /**< EasyDMA is sending the other buffer. */
+static scan_output_stats_t m_stats;                                         /**< Transmit counters. */
+
+static uint32_t         m_baudrate;                                         /**< Current baud rate. */
+static bool             m_hwfc;                                             /**< Current flow control setting. */
+static uint32_t         m_next_baudrate;                                    /**< Baud rate to switch to. */
+static bool             m_next_hwfc;                                        /**< Flow control setting to switch to. */
+static bool             m_switch_pending;                                   /**< A configuration change waits for the transmitter to drain. */
+
+static uint8_t          m_rx_dma[2];                                        /**< EasyDMA receive bytes. */
+static uint8_t          m_rx_ring[RX_RING_SIZE];                            /**< Received bytes, written by the interrupt. */
+static volatile uint32_t m_rx_wr;                                           /**< Owned by the UARTE interrupt. */
+static volatile uint32_t m_rx_rd;                                           /**< Owned by the main loop. */
+
+static rx_state_t       m_rx_state;                                         /**< Receive frame parser state. */
+static uint8_t          m_rx_frame[SCANNER_CMD_MAX_LEN + SCAN_FRAME_HEADER_LEN];
+static uint16_t         m_rx_len;                                           /**< Payload length of the frame being received. */
+static uint16_t         m_rx_pos;                                           /**< Payload bytes received so far. */
+static uint16_t         m_rx_crc;                                           /**< Received CRC. */
+
+
+/**@brief Function for mapping a baud rate to its register value.
+ *
+ * @return true if the baud rate is supported.
+ */
+static bool baudrate_reg_get(uint32_t bps, nrf_uarte_baudrate_t * p_reg)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_baudrates); i++)
+    {
+        if (m_baudrates[i].bps == bps)
+        {
+            *p_reg = m_baudrates[i].reg;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**@brief Function for handling UARTE events.
+ */
+static void uarte_event_handler(nrfx_uarte_event_t const * p_event, void * p_context)
+{
+    switch (p_event->type)
+    {
+        case NRFX_UARTE_EVT_TX_DONE:
+            m_tx_busy = false;
+            break;
+
+        case NRFX_UARTE_EVT_RX_DONE:
+        {
+            uint8_t * p_byte = p_event->data.rxtx.p_data;
+
+            // Drop the byte if the main loop is late, the frame CRC catches it.
+            if ((p_event->data.rxtx.bytes == 1) && (m_rx_wr - m_rx_rd < RX_RING_SIZE))
+            {
+                m_rx_ring[m_rx_wr & RX_RING_MASK] = *p_byte;
+                m_rx_wr = m_rx_wr + 1;
+            }
+
+            // Queue the byte buffer again, behind the one now receiving.
+            UNUSED_RETURN_VALUE(nrfx_uarte_rx(&m_uarte, p_byte, 1));
+        } break;
+
+        case NRFX_UARTE_EVT_ERROR:
+            // Framing or overrun error. The reception was aborted, start it over.
+            UNUSED_RETURN_VALUE(nrfx_uarte_rx(&m_uarte, &m_rx_dma[0], 1));
+            UNUSED_RETURN_VALUE(nrfx_uarte_rx(&m_uarte, &m_rx_dma[1], 1));
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+/**@brief Function for starting the UARTE with the current configuration. */
+static ret_code_t uarte_start(void)
+{
+    nrfx_uarte_config_t config = NRFX_UARTE_DEFAULT_CONFIG;
+    ret_code_t          err_code;
+
+    config.pseltxd = TX_PIN_NUMBER;
+    config.pselrxd = RX_PIN_NUMBER;
+    if (m_hwfc)
+    {
+        config.pselcts = CTS_PIN_NUMBER;
+        config.pselrts = RTS_PIN_NUMBER;
+        config.hwfc    = NRF_UARTE_HWFC_ENABLED;
+    }
+    if (!baudrate_reg_get(m_baudrate, &config.baudrate))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = nrfx_uarte_init(&m_uarte, &config, uarte_event_handler);
+    VERIFY_SUCCESS(err_code);
+
+    // Two single byte buffers, so reception never stops between bytes.
+    err_code = nrfx_uarte_rx(&m_uarte, &m_rx_dma[0], 1);
+    VERIFY_SUCCESS(err_code);
+
+    return nrfx_uarte_rx(&m_uarte, &m_rx_dma[1], 1);
+}
+
+
+ret_code_t scan_output_init(void)
+{
+    m_fill_idx       = 0;
+    m_fill_len       = 0;
+    m_tx_busy        = false;
+    m_baudrate       = SCANNER_UART_BAUDRATE;
+    m_hwfc           = SCANNER_UART_HWFC;
+    m_switch_pending = false;
+    m_rx_wr          = 0;
+    m_rx_rd          = 0;
+    m_rx_state       = RX_STATE_SOF;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    return uarte_start();
+}
+
+
+void scan_output_flush(void)
+{
+    if (m_tx_busy)
+    {
+        return;
+    }
+
+    if (m_fill_len == 0)
+    {
+        if (m_switch_pending)
+        {
+            // Everything queued before the change is out, apply it.
+            m_switch_pending = false;
+            m_baudrate       = m_next_baudrate;
+            m_hwfc           = m_next_hwfc;
+
+            nrfx_uarte_uninit(&m_uarte);
+            m_rx_state = RX_STATE_SOF;
+            APP_ERROR_CHECK(uarte_start());
+        }
+        return;
+    }
+
+    m_tx_busy = true;
+    if (nrfx_uarte_tx(&m_uarte, m_buf[m_fill_idx], m_fill_len) != NRFX_SUCCESS)
+    {
+        m_tx_busy = false;
+        return;
+    }
+
+    m_stats.tx_bytes += m_fill_len;
+
+    // The previous buffer has been sent completely, it becomes the fill buffer.
+    m_fill_idx ^= 1;
+    m_fill_len  = 0;
+}
+
+
+ret_code_t scan_output_send(uint8_t         type,
+                            void const    * p_head,
+                            uint16_t        head_len,
+                            uint8_t const * p_body,
+                            uint16_t        body_len)
+{
+    uint32_t  len = (uint32_t)head_len + body_len;
+    uint8_t * p_frame;
+    uint16_t  crc;
+
+    if (len > SCAN_FRAME_MAX_PAYLOAD)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    if (m_switch_pending)
+    {
+        // Hold new frames back until they can go out with the new configuration.
+        scan_output_flush();
+        if (m_switch_pending)
+        {
+            m_stats.busy++;
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    if (m_fill_len + len + SCAN_FRAME_OVERHEAD > SCANNER_OUTPUT_BUFFER_SIZE)
+    {
+        // Hand the full buffer over to EasyDMA if it is done with the other one.
+        scan_output_flush();
+        if (m_fill_len + len + SCAN_FRAME_OVERHEAD > SCANNER_OUTPUT_BUFFER_SIZE)
+        {
+            m_stats.busy++;
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    // The frame is copied into the fill buffer rather than sent from where it lies:
+    // the UARTE sends one contiguous buffer per transfer, so a frame sent in place
+    // would take three transfers (header, payload, CRC) and an interrupt for each,
+    // hold its report slot until sent, and could not share a transfer with others.
+    // The CRC reads the payload anyway.
+    p_frame = &m_buf[m_fill_idx][m_fill_len];
+
+    p_frame[0] = SCAN_FRAME_SOF;
+    p_frame[1] = type;
+    p_frame[2] = (uint8_t)(len & 0xFF);
+    p_frame[3] = (uint8_t)(len >> 8);
+    if (head_len > 0)
+    {
+        memcpy(&p_frame[SCAN_FRAME_HEADER_LEN], p_head, head_len);
+    }
+    if (body_len > 0)
+    {
+        memcpy(&p_frame[SCAN_FRAME_HEADER_LEN + head_len], p_body, body_len);
+    }
+
+    // The CRC covers everything but the SOF byte.
+    crc = crc16_compute(&p_frame[1], SCAN_FRAME_HEADER_LEN - 1 + len, NULL);
+    p_frame[SCAN_FRAME_HEADER_LEN + len]     = (uint8_t)(crc & 0xFF);
+    p_frame[SCAN_FRAME_HEADER_LEN + len + 1] = (uint8_t)(crc >> 8);
+
+    m_fill_len += len + SCAN_FRAME_OVERHEAD;
+
+    m_stats.frames++;
+    if (m_fill_len > m_stats.fill_high_water)
+    {
+        m_stats.fill_high_water = m_fill_len;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+bool scan_output_has_room(uint16_t len)
+{
+    if (m_switch_pending || (m_fill_len + len + SCAN_FRAME_OVERHEAD > SCANNER_OUTPUT_BUFFER_SIZE))
+    {
+        scan_output_flush();
+    }
+
+    return !m_switch_pending && (m_fill_len + len + SCAN_FRAME_OVERHEAD <= SCANNER_OUTPUT_BUFFER_SIZE);
+}
+
+
+ret_code_t scan_output_uart_config_set(uint32_t baudrate, bool hwfc)
+{
+    nrf_uarte_baudrate_t reg;
+
+    if (!baudrate_reg_get(baudrate, &reg))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_switch_pending)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_next_baudrate  = baudrate;
+    m_next_hwfc      = hwfc;
+    m_switch_pending = true;
+
+    return NRF_SUCCESS;
+}
+
+
+bool scan_output_baudrate_is_supported(uint32_t baudrate)
+{
+    nrf_uarte_baudrate_t reg;
+
+    return baudrate_reg_get(baudrate, &reg);
+}
+
+
+void scan_output_uart_config_get(uint32_t * p_baudrate, bool * p_hwfc)
+{
+    *p_baudrate = m_baudrate;
+    *p_hwfc     = m_hwfc;
+}
+
+
+void scan_output_stats_get(scan_output_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+bool scan_output_switch_pending(void)
+{
+    return m_switch_pending;
+}
+
+
+void scan_output_rx_process(scan_output_rx_handler_t handler)
+{
+    while (m_rx_rd != m_rx_wr)
+    {
+        uint8_t byte = m_rx_ring[m_rx_rd & RX_RING_MASK];
+
+        m_rx_rd = m_rx_rd + 1;
+
+        switch (m_rx_state)
+        {
+            case RX_STATE_SOF:
+                if (byte == SCAN_FRAME_SOF)
+                {
+                    m_rx_frame[0] = byte;
+                    m_rx_state    = RX_STATE_TYPE;
+                }
+                break;
+
+            case RX_STATE_TYPE:
+                m_rx_frame[1] = byte;
+                m_rx_state    = RX_STATE_LEN_LO;
+                break;
+
+            case RX_STATE_LEN_LO:
+                m_rx_frame[2] = byte;
+                m_rx_state    = RX_STATE_LEN_HI;
+                break;
+
+            case RX_STATE_LEN_HI:
+                m_rx_frame[3] = byte;
+                m_rx_len      = (uint16_t)(m_rx_frame[2] | (byte << 8));
+                m_rx_pos      = 0;
+                if (m_rx_len > SCANNER_CMD_MAX_LEN)
+                {
+                    m_rx_state = RX_STATE_SOF;
+                }
+                else
+                {
+                    m_rx_state = (m_rx_len > 0) ? RX_STATE_PAYLOAD : RX_STATE_CRC_LO;
+                }
+                break;
+
+            case RX_STATE_PAYLOAD:
+                m_rx_frame[SCAN_FRAME_HEADER_LEN + m_rx_pos++] = byte;
+                if (m_rx_pos == m_rx_len)
+                {
+                    m_rx_state = RX_STATE_CRC_LO;
+                }
+                break;
+
+            case RX_STATE_CRC_LO:
+                m_rx_crc   = byte;
+                m_rx_state = RX_STATE_CRC_HI;
+                break;
+
+            case RX_STATE_CRC_HI:
+                m_rx_crc  |= (uint16_t)(byte << 8);
+                m_rx_state = RX_STATE_SOF;
+                if (m_rx_crc == crc16_compute(&m_rx_frame[1], SCAN_FRAME_HEADER_LEN - 1 + m_rx_len, NULL))
+                {
+                    handler(m_rx_frame[1], &m_rx_frame[SCAN_FRAME_HEADER_LEN], m_rx_len);
+                }
+                break;
+
+            default:
+                m_rx_state = RX_STATE_SOF;
+                break;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/***************************************************************************************/
+/*
+ * scan_output
+ *
+ *  Serial link of the scanner. The module owns the UARTE: it sends the binary records
+ *  with EasyDMA from two buffers used in turns, receives the frames sent by the host
+ *  and applies baud rate and flow control changes at runtime.
+ *
+ *  All functions must be called from the main loop.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_OUTPUT_H__
+#define SCAN_OUTPUT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCANNER_OUTPUT_FORMAT_TEXT      0                               /**< Reports are hexdumped through nrf_log. */
+#define SCANNER_OUTPUT_FORMAT_BINARY    1                               /**< Reports are sent as binary frames. */
+
+/**@brief Transmit counters. */
+typedef struct
+{
+    uint32_t tx_bytes;                                                  /**< Bytes handed over to EasyDMA. */
+    uint32_t frames;                                                    /**< Frames queued. */
+    uint32_t busy;                                                      /**< Frames refused because both buffers were in use. */
+    uint16_t fill_high_water;                                           /**< Largest number of bytes queued in a buffer. */
+} scan_output_stats_t;
+
+/**@brief Handler for the frames received from the host.
+ *
+ * @param[in]   type        Frame type.
+ * @param[in]   p_payload   Frame payload, only valid during the call.
+ * @param[in]   len         Payload length.
+ */
+typedef void (*scan_output_rx_handler_t)(uint8_t type, uint8_t const * p_payload, uint16_t len);
+
+
+/**@brief Function for initializing the UARTE used for the scanner link.
+ *
+ * @details The link starts at SCANNER_UART_BAUDRATE, with flow control if
+ *          SCANNER_UART_HWFC is set.
+ *
+ * @return NRF_SUCCESS or an error code from the UARTE driver.
+ */
+ret_code_t scan_output_init(void);
+
+
+/**@brief Function for queueing a record for transmission.
+ *
+ * @details The record payload is made of a header and a body, given separately so the
+ *          caller does not need to assemble them. The record is framed (see
+ *          @ref scan_frame.h) directly into the fill buffer, either as a whole or not
+ *          at all. It is sent on the next @ref scan_output_flush.
+ *
+ * @param[in]   type        Record type.
+ * @param[in]   p_head      Record header. Can be NULL if @p head_len is 0.
+ * @param[in]   head_len    Length of the header.
+ * @param[in]   p_body      Record body. Can be NULL if @p body_len is 0.
+ * @param[in]   body_len    Length of the body.
+ *
+ * @retval NRF_SUCCESS              The frame has been queued.
+ * @retval NRF_ERROR_INVALID_LENGTH The payload is too long to be framed.
+ * @retval NRF_ERROR_NO_MEM         Both buffers are in use. Nothing is queued.
+ */
+ret_code_t scan_output_send(uint8_t         type,
+                            void const    * p_head,
+                            uint16_t        head_len,
+                            uint8_t const * p_body,
+                            uint16_t        body_len);
+
+
+/**@brief Function for checking whether a frame would be queued now.
+ *
+ * @details Hands the fill buffer over to EasyDMA first if that makes room. Until the
+ *          next call that sends or flushes, @ref scan_output_send then queues a frame
+ *          of this length.
+ *
+ * @param[in]   len         Length of the payload.
+ *
+ * @return true if there is room and no configuration change is pending.
+ */
+bool scan_output_has_room(uint16_t len);
+
+
+/**@brief Function for starting the transfer of the fill buffer.
+ *
+ * @details Does nothing if the previous transfer is still ongoing or if there is
+ *          nothing to send. Call it every time the main loop wakes up.
+ */
+void scan_output_flush(void);
+
+
+/**@brief Function for changing the baud rate and flow control of the link.
+ *
+ * @details The change is applied once every frame queued before this call has been
+ *          sent. Meanwhile @ref scan_output_send refuses new frames.
+ *
+ * @param[in]   baudrate    115200, 230400, 460800, 921600 or 1000000.
+ * @param[in]   hwfc        Use RTS/CTS flow control.
+ *
+ * @retval NRF_SUCCESS              The change is scheduled.
+ * @retval NRF_ERROR_INVALID_PARAM  Unsupported baud rate.
+ * @retval NRF_ERROR_BUSY           Another change is still pending.
+ */
+ret_code_t scan_output_uart_config_set(uint32_t baudrate, bool hwfc);
+
+
+/**@brief Function for checking whether a baud rate is supported. */
+bool scan_output_baudrate_is_supported(uint32_t baudrate);
+
+
+/**@brief Function for getting the configuration the link is running with. */
+void scan_output_uart_config_get(uint32_t * p_baudrate, bool * p_hwfc);
+
+
+/**@brief Function for checking whether a configuration change is still pending. */
+bool scan_output_switch_pending(void);
+
+
+/**@brief Function for reading the transmit counters. */
+void scan_output_stats_get(scan_output_stats_t * p_stats);
+
+
+/**@brief Function for handling the bytes received from the host.
+ *
+ * @details Reassembles the frames and calls @p handler for each one with a valid CRC.
+ *
+ * @param[in]   handler     Frame handler.
+ */
+void scan_output_rx_process(scan_output_rx_handler_t handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_OUTPUT_H__
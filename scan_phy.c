@@ -0,0 +1,54 @@
+/***************************************************************************************/
+/*
+ * scan_phy
+ *
+ *  Scheduler of the primary PHYs scanned.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_phy.h"
+
+
+scan_phy_step_t const * scan_phy_sched_init(scan_phy_sched_t      * p_sched,
+                                            scan_phy_step_t const * p_steps,
+                                            uint8_t                 count,
+                                            uint64_t                now_us)
+{
+    memset(p_sched, 0, sizeof(*p_sched));
+
+    p_sched->p_steps       = p_steps;
+    p_sched->count         = (count > SCAN_PHY_STEPS_MAX) ? SCAN_PHY_STEPS_MAX : count;
+    p_sched->step_start_us = now_us;
+
+    return &p_steps[0];
+}
+
+
+scan_phy_step_t const * scan_phy_sched_current(scan_phy_sched_t const * p_sched)
+{
+    return &p_sched->p_steps[p_sched->current];
+}
+
+
+scan_phy_step_t const * scan_phy_sched_next(scan_phy_sched_t * p_sched, uint64_t now_us)
+{
+    if (now_us > p_sched->step_start_us)
+    {
+        p_sched->time_us[p_sched->current] += now_us - p_sched->step_start_us;
+    }
+    p_sched->step_start_us = now_us;
+
+    // A step without dwell time never ends, a timeout there only restarts it.
+    if (p_sched->p_steps[p_sched->current].dwell_ms != 0)
+    {
+        p_sched->current++;
+        if (p_sched->current >= p_sched->count)
+        {
+            p_sched->current = 0;
+            p_sched->cycles++;
+        }
+    }
+
+    return &p_sched->p_steps[p_sched->current];
+}
@@ -0,0 +1,79 @@
+/***************************************************************************************/
+/*
+ * scan_phy
+ *
+ *  Scheduler of the primary PHYs scanned.
+ *
+ *  The schedule is a list of steps, each one scanning a set of PHYs for a dwell
+ *  time. Scanning is started with the dwell time as timeout and the scanner moves to
+ *  the next step when the timeout expires. A single step with no dwell time scans
+ *  its PHYs continuously.
+ *
+ *  The scheduler does not read any clock, the caller gives it the time, so the host
+ *  tools can build it and drive it with a simulated clock.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_PHY_H__
+#define SCAN_PHY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_PHY_STEPS_MAX      4                                       /**< Longest schedule. */
+
+/**@brief A step of the schedule. */
+typedef struct
+{
+    uint8_t  phys;                                                      /**< BLE_GAP_PHY_* mask scanned during the step. */
+    uint32_t dwell_ms;                                                  /**< Dwell time, 0 to stay on this step. */
+} scan_phy_step_t;
+
+/**@brief Scheduler. */
+typedef struct
+{
+    scan_phy_step_t const * p_steps;
+    uint8_t                 count;
+    uint8_t                 current;                                    /**< Index of the current step. */
+    uint64_t                step_start_us;                              /**< Start of the current step. */
+    uint64_t                time_us[SCAN_PHY_STEPS_MAX];                /**< Time spent on each step, current one excluded. */
+    uint32_t                cycles;                                     /**< Complete runs of the schedule. */
+} scan_phy_sched_t;
+
+
+/**@brief Function for starting a schedule.
+ *
+ * @param[out]  p_sched     Scheduler.
+ * @param[in]   p_steps     Steps, kept by the scheduler. 1 to @ref SCAN_PHY_STEPS_MAX.
+ * @param[in]   count       Number of steps.
+ * @param[in]   now_us      Current time.
+ *
+ * @return First step.
+ */
+scan_phy_step_t const * scan_phy_sched_init(scan_phy_sched_t      * p_sched,
+                                            scan_phy_step_t const * p_steps,
+                                            uint8_t                 count,
+                                            uint64_t                now_us);
+
+
+/**@brief Function for getting the current step. */
+scan_phy_step_t const * scan_phy_sched_current(scan_phy_sched_t const * p_sched);
+
+
+/**@brief Function for moving to the next step, when the dwell time has expired.
+ *
+ * @param[in]   p_sched     Scheduler.
+ * @param[in]   now_us      Current time.
+ *
+ * @return Next step.
+ */
+scan_phy_step_t const * scan_phy_sched_next(scan_phy_sched_t * p_sched, uint64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_PHY_H__
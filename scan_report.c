@@ -0,0 +1,39 @@
+/***************************************************************************************/
+/*
+ * scan_report
+ *
+ *  Conversion of the SoftDevice advertising reports to the records sent by the
+ *  scanner.
+*/
+/***************************************************************************************/
+
+#include <string.h>
+#include "scan_report.h"
+
+
+void scan_report_hdr_fill(ble_gap_evt_adv_report_t const * p_report,
+                          uint64_t                         timestamp_us,
+                          scan_report_hdr_t              * p_hdr)
+{
+    uint8_t flags = 0;
+
+    flags |= p_report->type.connectable   ? SCAN_REPORT_FLAG_CONNECTABLE   : 0;
+    flags |= p_report->type.scannable     ? SCAN_REPORT_FLAG_SCANNABLE     : 0;
+    flags |= p_report->type.directed      ? SCAN_REPORT_FLAG_DIRECTED      : 0;
+    flags |= p_report->type.scan_response ? SCAN_REPORT_FLAG_SCAN_RESPONSE : 0;
+    flags |= p_report->type.extended_pdu  ? SCAN_REPORT_FLAG_EXTENDED_PDU  : 0;
+    flags |= (p_report->type.status << SCAN_REPORT_FLAG_STATUS_Pos) & SCAN_REPORT_FLAG_STATUS_Msk;
+
+    p_hdr->timestamp_us  = timestamp_us;
+    memcpy(p_hdr->addr, p_report->peer_addr.addr, sizeof(p_hdr->addr));
+    p_hdr->addr_type     = p_report->peer_addr.addr_type;
+    p_hdr->flags         = flags;
+    p_hdr->rssi          = p_report->rssi;
+    p_hdr->tx_power      = p_report->tx_power;
+    p_hdr->primary_phy   = p_report->primary_phy;
+    p_hdr->secondary_phy = p_report->secondary_phy;
+    p_hdr->ch_index      = p_report->ch_index;
+    p_hdr->set_id        = p_report->set_id;
+    p_hdr->data_id       = p_report->data_id;
+    p_hdr->data_len      = p_report->data.len;
+}
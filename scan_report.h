@@ -0,0 +1,35 @@
+/***************************************************************************************/
+/*
+ * scan_report
+ *
+ *  Conversion of the SoftDevice advertising reports to the records sent by the
+ *  scanner.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_REPORT_H__
+#define SCAN_REPORT_H__
+
+#include <stdint.h>
+#include "ble_gap.h"
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for filling the record header of an advertising report.
+ *
+ * @param[in]   p_report        Advertising report received from the SoftDevice.
+ * @param[in]   timestamp_us    Reception time of the report.
+ * @param[out]  p_hdr           Header to fill.
+ */
+void scan_report_hdr_fill(ble_gap_evt_adv_report_t const * p_report,
+                          uint64_t                         timestamp_us,
+                          scan_report_hdr_t              * p_hdr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_REPORT_H__
@@ -0,0 +1,134 @@
+/***************************************************************************************/
+/*
+ * scan_ring
+ *
+ *  Single-producer/single-consumer ring of advertising report slots.
+ *
+ *  Both indices are free-running and only give the number of slots in use. Each side
+ *  also keeps the position of its next slot, which wraps at the size of the ring, so
+ *  the size does not need to be a power of two. The producer only writes m_wr and
+ *  m_wr_pos, the consumer only writes m_rd and m_rd_pos. A memory barrier orders the
+ *  slot contents against the index update on each side.
+ *
+ *  The linker script turns the size of the arena into a number of slots with
+ *  __report_slot_size__, defined below, and checks that the arena is large enough.
+*/
+/***************************************************************************************/
+
+#include "sdk_common.h"
+#include "scan_ring.h"
+#include "nrf.h"
+
+#define SLOT_SIZE       (26 + SCANNER_REPORT_DATA_MAX)                 /**< sizeof(scan_ring_slot_t), spelled out for the assembler. */
+
+STATIC_ASSERT(sizeof(scan_ring_slot_t) == SLOT_SIZE);
+
+__asm__(".global __report_slot_size__\n"
+        ".set __report_slot_size__, " STRINGIFY(SLOT_SIZE) "\n");
+
+extern uint8_t __report_arena_start__[];                        /**< Start of the report arena, from the linker script. */
+extern uint8_t __report_arena_end__[];                          /**< End of the report arena, from the linker script. */
+
+static scan_ring_slot_t * m_slots;                              /**< Report slots. */
+static uint32_t          m_size;                                /**< Number of slots. */
+static volatile uint32_t m_wr;                                  /**< Write index, owned by the producer. */
+static volatile uint32_t m_rd;                                  /**< Read index, owned by the consumer. */
+static uint32_t          m_wr_pos;                              /**< Slot of the write index, owned by the producer. */
+static uint32_t          m_rd_pos;                              /**< Slot of the read index, owned by the consumer. */
+static volatile uint32_t m_overflows;                           /**< Written by the producer only. */
+static volatile uint32_t m_high_water;                          /**< Written by the producer only. */
+
+
+void scan_ring_init(void)
+{
+    m_slots      = (scan_ring_slot_t *)__report_arena_start__;
+    m_size       = (uint32_t)(__report_arena_end__ - __report_arena_start__) / sizeof(scan_ring_slot_t);
+    m_wr         = 0;
+    m_rd         = 0;
+    m_wr_pos     = 0;
+    m_rd_pos     = 0;
+    m_overflows  = 0;
+    m_high_water = 0;
+}
+
+
+uint32_t scan_ring_size(void)
+{
+    return m_size;
+}
+
+
+scan_ring_slot_t * scan_ring_alloc(void)
+{
+    if (m_wr - m_rd >= m_size)
+    {
+        return NULL;
+    }
+
+    return &m_slots[m_wr_pos];
+}
+
+
+void scan_ring_publish(void)
+{
+    uint32_t wr = m_wr + 1;
+    uint32_t used;
+
+    m_wr_pos = (m_wr_pos + 1 == m_size) ? 0 : m_wr_pos + 1;
+
+    // The slot must be complete before the consumer can see it.
+    __DMB();
+    m_wr = wr;
+
+    used = wr - m_rd;
+    if (used > m_high_water)
+    {
+        m_high_water = used;
+    }
+}
+
+
+void scan_ring_drop(void)
+{
+    m_overflows++;
+}
+
+
+scan_ring_slot_t const * scan_ring_peek(void)
+{
+    uint32_t rd = m_rd;
+
+    if (rd == m_wr)
+    {
+        return NULL;
+    }
+
+    // Do not read the slot before the index that published it.
+    __DMB();
+
+    return &m_slots[m_rd_pos];
+}
+
+
+void scan_ring_release(void)
+{
+    m_rd_pos = (m_rd_pos + 1 == m_size) ? 0 : m_rd_pos + 1;
+
+    // Done with the slot before handing it back to the producer.
+    __DMB();
+    m_rd = m_rd + 1;
+}
+
+
+uint32_t scan_ring_count(void)
+{
+    return m_wr - m_rd;
+}
+
+
+void scan_ring_stats_get(scan_ring_stats_t * p_stats)
+{
+    p_stats->published  = m_wr;
+    p_stats->overflows  = m_overflows;
+    p_stats->high_water = m_high_water;
+}
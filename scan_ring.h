@@ -0,0 +1,93 @@
+/***************************************************************************************/
+/*
+ * scan_ring
+ *
+ *  Single-producer/single-consumer ring of advertising report slots.
+ *
+ *  The slots double as the scan buffers of the SoftDevice. The SoftDevice observer is
+ *  the only producer: it lends the next free slot to the SoftDevice, which receives
+ *  the next report straight into it, then publishes the slot and lends the following
+ *  one. The main loop is the only consumer: it encodes and sends the published slots,
+ *  then releases them. No locks are needed, each index is written by one side only.
+ *
+ *  The slots live in the report arena, the RAM the linker script leaves between the
+ *  heap and the stack, so the ring takes whatever RAM the rest of the image does not
+ *  use. The build prints the number of slots.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_RING_H__
+#define SCAN_RING_H__
+
+#include <stdint.h>
+#include "scan_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief A report slot. */
+typedef struct
+{
+    scan_report_hdr_t hdr;                                              /**< Report metadata. hdr.data_len bytes of @ref data are valid. */
+    uint8_t           data[SCANNER_REPORT_DATA_MAX];                    /**< Advertising data. Lent to the SoftDevice as scan buffer. */
+} scan_ring_slot_t;
+
+/**@brief Ring counters. */
+typedef struct
+{
+    uint32_t published;                                                 /**< Slots published by the producer. */
+    uint32_t overflows;                                                 /**< Reports dropped because the ring was full. */
+    uint32_t high_water;                                                /**< Highest number of slots in use. */
+} scan_ring_stats_t;
+
+
+/**@brief Function for emptying the ring and clearing its counters. */
+void scan_ring_init(void);
+
+
+/**@brief Function for getting the number of slots of the ring. */
+uint32_t scan_ring_size(void);
+
+
+/**@brief Function for getting the next free slot (producer side).
+ *
+ * @details The same slot is returned until @ref scan_ring_publish is called, and it is
+ *          not visible to the consumer before.
+ *
+ * @return Free slot, or NULL if the ring is full.
+ */
+scan_ring_slot_t * scan_ring_alloc(void);
+
+
+/**@brief Function for publishing the slot returned by @ref scan_ring_alloc (producer side). */
+void scan_ring_publish(void);
+
+
+/**@brief Function for counting a report dropped because the ring was full (producer side). */
+void scan_ring_drop(void);
+
+
+/**@brief Function for getting the oldest published slot (consumer side).
+ *
+ * @return Published slot, or NULL if the ring is empty.
+ */
+scan_ring_slot_t const * scan_ring_peek(void);
+
+
+/**@brief Function for releasing the slot returned by @ref scan_ring_peek (consumer side). */
+void scan_ring_release(void);
+
+
+/**@brief Function for getting the number of published slots not yet released. */
+uint32_t scan_ring_count(void);
+
+
+/**@brief Function for reading the ring counters. */
+void scan_ring_stats_get(scan_ring_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_RING_H__
@@ -0,0 +1,103 @@
+/***************************************************************************************/
+/*
+ * scan_time
+ *
+ *  Free-running 64-bit time base used to timestamp the advertising reports.
+ *
+ *  TIMER1 counts at 1 MHz on 32 bits, clocked from the crystal oscillator so the
+ *  timestamps keep the accuracy of the crystal. The counter wraps every 71 minutes;
+ *  compare channel 1, set to 0, interrupts on every wrap and the wraps are counted
+ *  to extend it to 64 bits. The counter is read through capture channel 0.
+ *
+ *  The DWT cycle counter of the Cortex-M4 is started as well, for profiling.
+*/
+/***************************************************************************************/
+
+#include "sdk_common.h"
+#include "scan_time.h"
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_timer.h"
+#include "app_error.h"
+#include "app_util_platform.h"
+
+#define TIME_TIMER          NRF_TIMER1
+#define TIME_TIMER_IRQn     TIMER1_IRQn
+#define TIME_CC_CAPTURE     NRF_TIMER_CC_CHANNEL0                       /**< Channel the counter is captured into. */
+#define TIME_CC_WRAP        NRF_TIMER_CC_CHANNEL1                       /**< Channel that detects the wraps. */
+#define TIME_EVENT_WRAP     NRF_TIMER_EVENT_COMPARE1
+#define TIME_INT_WRAP       NRF_TIMER_INT_COMPARE1_MASK
+
+static volatile uint32_t m_wraps;                               /**< Number of counter wraps. */
+
+
+void TIMER1_IRQHandler(void)
+{
+    if (nrf_timer_event_check(TIME_TIMER, TIME_EVENT_WRAP))
+    {
+        nrf_timer_event_clear(TIME_TIMER, TIME_EVENT_WRAP);
+        m_wraps++;
+    }
+}
+
+
+void scan_time_init(void)
+{
+    // The internal RC oscillator is off by up to 1.5 %, keep the crystal running.
+    ret_code_t err_code = sd_clock_hfclk_request();
+    APP_ERROR_CHECK(err_code);
+
+    m_wraps = 0;
+
+    nrf_timer_task_trigger(TIME_TIMER, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(TIME_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_mode_set(TIME_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(TIME_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(TIME_TIMER, NRF_TIMER_FREQ_1MHz);
+
+    // The compare event fires when the counter rolls over to 0.
+    nrf_timer_cc_write(TIME_TIMER, TIME_CC_WRAP, 0);
+    nrf_timer_event_clear(TIME_TIMER, TIME_EVENT_WRAP);
+    nrf_timer_int_enable(TIME_TIMER, TIME_INT_WRAP);
+
+    NVIC_ClearPendingIRQ(TIME_TIMER_IRQn);
+    NVIC_SetPriority(TIME_TIMER_IRQn, APP_IRQ_PRIORITY_HIGH);
+    NVIC_EnableIRQ(TIME_TIMER_IRQn);
+
+    nrf_timer_task_trigger(TIME_TIMER, NRF_TIMER_TASK_START);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+uint64_t scan_time_us_get(void)
+{
+    uint32_t wraps;
+    uint32_t counter;
+
+    // The capture channel is shared by every caller: capture and read it without
+    // being preempted, and sample the wrap count at the same time.
+    CRITICAL_REGION_ENTER();
+
+    nrf_timer_task_trigger(TIME_TIMER, nrf_timer_capture_task_get(TIME_CC_CAPTURE));
+    counter = nrf_timer_cc_read(TIME_TIMER, TIME_CC_CAPTURE);
+    wraps   = m_wraps;
+
+    // A wrap not yet counted happened before the capture if the value is small.
+    if (nrf_timer_event_check(TIME_TIMER, TIME_EVENT_WRAP) && (counter < (1UL << 31)))
+    {
+        wraps++;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return ((uint64_t)wraps << 32) | counter;
+}
+
+
+uint32_t scan_time_cycles_get(void)
+{
+    return DWT->CYCCNT;
+}
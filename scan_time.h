@@ -0,0 +1,46 @@
+/***************************************************************************************/
+/*
+ * scan_time
+ *
+ *  Free-running 64-bit time base used to timestamp the advertising reports.
+*/
+/***************************************************************************************/
+
+#ifndef SCAN_TIME_H__
+#define SCAN_TIME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Function for starting the time base.
+ *
+ * @details Uses TIMER1 and keeps the high frequency crystal oscillator running,
+ *          through the SoftDevice. Also starts the CPU cycle counter. Call it after
+ *          the SoftDevice has been enabled.
+ */
+void scan_time_init(void);
+
+
+/**@brief Function for getting the time elapsed since @ref scan_time_init, in microseconds.
+ *
+ * @details Safe to call from any interrupt priority.
+ */
+uint64_t scan_time_us_get(void);
+
+
+/**@brief Function for reading the CPU cycle counter.
+ *
+ * @details The counter runs at SystemCoreClock, wraps around every 67 s at 64 MHz and
+ *          stops while the CPU sleeps: the difference between two readings taken a
+ *          short time apart is the number of cycles the code in between took.
+ */
+uint32_t scan_time_cycles_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_TIME_H__